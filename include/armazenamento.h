@@ -0,0 +1,300 @@
+#ifndef ARMAZENAMENTO_H
+#define ARMAZENAMENTO_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "arquivo.h"
+
+/*
+ * Camada de acesso aos registros dos arquivos de lista (livro.dat, usuario.dat, emprestimo.dat).
+ *
+ * Por padrão os acessos passam pelo cache de páginas (cache_paginas.h): as páginas lidas ficam
+ * em memória com substituição LRU e as gravações só chegam ao disco quando a página é substituída,
+ * quando o arquivo é descarregado (descarregar_arquivo_dados) ou fechado. Compilando com
+ * -DARMAZENAMENTO_MMAP (apenas sistemas POSIX), cada arquivo aberto por abrir_arquivo_dados é
+ * mapeado em memória uma única vez durante a execução do programa: cabeçalho e registros passam
+ * a ser lidos e gravados diretamente no mapeamento, sem chamadas de sistema por registro, e o
+ * cache de páginas não é usado.
+ *
+ * Com o diário aberto (diario.h), as gravações nos arquivos acompanhados não chegam ao cache nem
+ * ao mapeamento: ficam no diário até o grupo de operações ser sincronizado, e as leituras
+ * enxergam essas gravações pendentes por cima do conteúdo dos arquivos.
+ *
+ * Código que lê ou grava os arquivos de lista diretamente por stdio (junção, carga em lote) deve
+ * chamar descarregar_caminho_dados antes de abri-los e, se os alterar, descartar_caminho_dados
+ * depois de fechá-los (e, com o diário aberto, diario_checkpoint antes de alterá-los).
+ *
+ * Os arquivos de índice (árvores B+, índices hash e listas dos índices invertidos) passam pelo
+ * cache de páginas nas duas compilações, com abrir_arquivo_indice e ler/escrever_arquivo_indice:
+ * cada nó ou balde lido de novo vem da memória, sem uma chamada de sistema por leitura. Os índices
+ * não passam pelo diário.
+ */
+
+// tamanho mínimo de cada extensão do arquivo quando uma gravação passa do fim do mapeamento
+#ifndef EXTENSAO_MAPA
+#define EXTENSAO_MAPA (1L * 1024 * 1024)
+#endif
+
+#define MAX_ARQUIVOS_MAPEADOS   8
+#define MAX_ARQUIVOS_ABERTOS    32
+
+/*
+ * compartilhar_arquivos_dados - indica que os arquivos de lista são usados também por outros processos
+ *
+ * Chamada ao abrir a base em modo compartilhado (biblioteca.h), antes de abrir os arquivos. Daí em
+ * diante os arquivos abertos por abrir_arquivo_dados não têm buffer no stdio e, com
+ * ARMAZENAMENTO_MMAP, não são truncados no encerramento (o último processo a fechar a base chama
+ * encolher_arquivos_dados). O chamador descarta as páginas em cache quando outro processo altera
+ * um arquivo (descartar_caminho_dados).
+ */
+void compartilhar_arquivos_dados(void);
+
+/*
+ * abrir_arquivo_dados - abre um arquivo de lista com fopen e o associa ao seu mapeamento
+ *
+ * @caminho - caminho completo para o arquivo de lista
+ * @modo - modo do fopen ("rb" ou "r+b")
+ *
+ * Pós-condições:
+ *	- Retorna o arquivo aberto ou NULL se o fopen falhar.
+ *	- O arquivo é registrado no cache de páginas (ou mapeado, com ARMAZENAMENTO_MMAP) na primeira
+ *	abertura do caminho; se isso não for possível, os acessos ao arquivo continuam por stdio.
+ *	- Retorna NULL se o caminho estiver no cache e não houver espaço para mais um arquivo aberto.
+ */
+FILE* abrir_arquivo_dados(const char* caminho, const char* modo);
+
+/*
+ * fechar_arquivo_dados - fecha um arquivo aberto por abrir_arquivo_dados
+ *
+ * @arquivo - arquivo a ser fechado (NULL é ignorado)
+ *
+ * Pós-condições:
+ *	- As páginas sujas do arquivo são gravadas e o arquivo é fechado. Quando era o último FILE
+ *	aberto pelo caminho, suas páginas saem do cache, e a próxima abertura lê o conteúdo atual do
+ *	arquivo (o mapeamento, com ARMAZENAMENTO_MMAP, continua disponível).
+ *	- Retorna 0 em caso de sucesso ou valor diferente de 0 se a gravação ou o fclose falharem.
+ */
+int fechar_arquivo_dados(FILE* arquivo);
+
+/*
+ * descarregar_arquivo_dados - grava no disco as alterações pendentes de um arquivo de lista
+ *
+ * @arquivo - arquivo aberto por abrir_arquivo_dados (NULL é ignorado)
+ *
+ * Pós-condições:
+ *	- As páginas sujas do arquivo no cache são gravadas e o buffer do stdio é esvaziado.
+ *	- Retorna SUCESSO (0) ou ERRO_ARQUIVO_SEEK (-1) / ERRO_ARQUIVO_WRITE (-2) em caso de erro.
+ */
+int descarregar_arquivo_dados(FILE* arquivo);
+
+/*
+ * descarregar_caminho_dados - grava as páginas sujas de um caminho antes de ele ser lido por stdio
+ *
+ * @caminho - caminho completo do arquivo de lista
+ *
+ * Pós-condições:
+ *	- Se o caminho é acompanhado pelo diário, o grupo atual é sincronizado antes (diario_sincronizar).
+ *	- Retorna SUCESSO (0) também quando o caminho não está no cache (ou com ARMAZENAMENTO_MMAP).
+ *	- Retorna ERRO_ARQUIVO_SEEK (-1) / ERRO_ARQUIVO_WRITE (-2) se alguma página não puder ser gravada.
+ */
+int descarregar_caminho_dados(const char* caminho);
+
+/*
+ * descartar_caminho_dados - retira do cache as páginas de um caminho alterado por stdio
+ *
+ * @caminho - caminho completo do arquivo de lista
+ *
+ * Pós-condições:
+ *	- As próximas leituras do caminho buscam o conteúdo atual do arquivo. Com ARMAZENAMENTO_MMAP,
+ *	um mapeamento maior que o arquivo (truncado por outro processo) é refeito com o tamanho atual.
+ *	- Retorna SUCESSO (0) ou o erro da gravação de páginas sujas que ainda existiam.
+ */
+int descartar_caminho_dados(const char* caminho);
+
+/*
+ * encolher_arquivos_dados - remove dos arquivos mapeados o excesso além do tamanho ocupado
+ *
+ * Com ARMAZENAMENTO_MMAP, cada arquivo maior que cabeçalho + pos_topo registros é truncado para
+ * esse tamanho e mapeado de novo; sem ARMAZENAMENTO_MMAP, não faz nada. Usada pelo diário quando o
+ * último processo fecha a base compartilhada, com a trava de abertura segurando quem estiver
+ * chegando (diario_fechar); sem compartilhamento, o excesso é removido em encerrar_armazenamento.
+ *
+ * Pré-condições:
+ *	- Nenhum outro processo pode estar usando os arquivos e não pode haver gravações pendentes no diário.
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_WRITE (-2) se o ftruncate falhar ou ERRO_ARQUIVO_READ (-3)
+ *	se o arquivo não puder ser mapeado de novo.
+ */
+int encolher_arquivos_dados(void);
+
+/*
+ * aplicar_gravacao_dados - grava bytes de um arquivo acompanhado pelo diário, sem passar por ele
+ *
+ * @caminho - caminho completo do arquivo de lista
+ * @deslocamento - posição do primeiro byte no arquivo
+ * @tamanho - quantidade de bytes
+ * @origem - bytes a serem gravados
+ *
+ * Usada por diario_sincronizar depois do fsync do diário. A gravação vai para o cache de páginas
+ * (ou para o mapeamento), como as gravações feitas sem diário.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ABRIR_ARQUIVO (-10) ou ERRO_ARQUIVO_SEEK (-1) / ERRO_ARQUIVO_WRITE (-2).
+ */
+int aplicar_gravacao_dados(const char* caminho, long deslocamento, size_t tamanho, const void* origem);
+
+/*
+ * sincronizar_caminho_dados - grava as páginas sujas de um caminho e faz fsync do arquivo
+ *
+ * Pós-condições:
+ *	- Com ARMAZENAMENTO_MMAP, o mapeamento é sincronizado com msync.
+ *	- Retorna SUCESSO (0), ERRO_ABRIR_ARQUIVO (-10) ou ERRO_ARQUIVO_SEEK (-1) / ERRO_ARQUIVO_WRITE (-2).
+ */
+int sincronizar_caminho_dados(const char* caminho);
+
+/*
+ * acessar_registro - obtém o registro de uma posição do arquivo de lista
+ *
+ * @arquivo - arquivo aberto por abrir_arquivo_dados (ou fopen)
+ * @posicao - posição do registro na lista
+ * @tamanho_registro - tamanho de cada registro (ex.: sizeof(REGISTRO_LIVRO))
+ * @copia - área com tamanho_registro bytes, usada quando o arquivo não está mapeado
+ *
+ * Pós-condições:
+ *	- Retorna um ponteiro para o registro: dentro do mapeamento (sem cópia) ou para copia (também
+ *	quando o registro tem gravações pendentes no diário).
+ *	- O ponteiro só é válido até a próxima gravação ou fechamento do arquivo.
+ *	- Retorna NULL em caso de falha de posicionamento ou leitura.
+ */
+const void* acessar_registro(FILE* arquivo, int posicao, size_t tamanho_registro, void* copia);
+
+/*
+ * ler_registro - copia o registro de uma posição do arquivo de lista
+ *
+ * @arquivo - arquivo aberto por abrir_arquivo_dados (ou fopen)
+ * @posicao - posição do registro na lista
+ * @tamanho_registro - tamanho de cada registro
+ * @destino - área que recebe o registro
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_READ (-3) em caso de erro.
+ */
+int ler_registro(FILE* arquivo, int posicao, size_t tamanho_registro, void* destino);
+
+/*
+ * escrever_registro - grava um registro em uma posição do arquivo de lista
+ *
+ * @arquivo - arquivo aberto para escrita por abrir_arquivo_dados (ou fopen)
+ * @posicao - posição do registro na lista
+ * @tamanho_registro - tamanho de cada registro
+ * @registro - dados a serem gravados
+ *
+ * Com o arquivo mapeado, gravações além do fim do mapeamento aumentam o arquivo em múltiplos
+ * de EXTENSAO_MAPA e o mapeamento é refeito; o excesso é removido em encerrar_armazenamento
+ * ou, com a base compartilhada, quando o último processo a fecha (encolher_arquivos_dados).
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_WRITE (-2) em caso de erro.
+ */
+int escrever_registro(FILE* arquivo, int posicao, size_t tamanho_registro, const void* registro);
+
+/*
+ * ler_cabecalho_dados - copia o cabeçalho de um arquivo de lista
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ou ERRO_ARQUIVO_SEEK (-1) / ERRO_ARQUIVO_READ (-3) em caso de erro.
+ */
+int ler_cabecalho_dados(FILE* arquivo, CABECALHO* cabecalho);
+
+/*
+ * escrever_cabecalho_dados - grava o cabeçalho de um arquivo de lista
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ou ERRO_ARQUIVO_SEEK (-1) / ERRO_ARQUIVO_WRITE (-2) em caso de erro.
+ */
+int escrever_cabecalho_dados(FILE* arquivo, const CABECALHO* cabecalho);
+
+/*
+ * abrir_arquivo_indice - abre um arquivo de índice com fopen e o registra no cache de páginas
+ *
+ * @caminho - caminho completo do arquivo de índice
+ * @modo - modo do fopen ("rb" ou "r+b")
+ *
+ * Todos os FILE abertos pelo mesmo caminho enxergam as mesmas páginas. Sem cache (desativado ou
+ * com a tabela cheia), os acessos continuam por stdio, sem buffer.
+ *
+ * Pré-condições:
+ *	- Índices recriados por fopen (construção, reconstrução ou carga em lote) não podem ter FILE
+ *	aberto por esta função enquanto são gravados.
+ * Pós-condições:
+ *	- Retorna o arquivo aberto ou NULL se o fopen falhar.
+ */
+FILE* abrir_arquivo_indice(const char* caminho, const char* modo);
+
+/*
+ * fechar_arquivo_indice - fecha um arquivo aberto por abrir_arquivo_indice
+ *
+ * Pós-condições:
+ *	- As páginas sujas são gravadas; quando era o último FILE aberto pelo caminho, suas páginas
+ *	saem do cache e a próxima abertura lê o conteúdo atual do arquivo.
+ *	- Retorna 0 em caso de sucesso ou valor diferente de 0 se a gravação ou o fclose falharem.
+ */
+int fechar_arquivo_indice(FILE* arquivo);
+
+/*
+ * ler_arquivo_indice - copia bytes de um deslocamento do arquivo de índice
+ *
+ * @arquivo - arquivo aberto por abrir_arquivo_indice (ou fopen, lido por stdio)
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_READ (-3), inclusive quando a
+ *	região passa do fim do arquivo.
+ */
+int ler_arquivo_indice(FILE* arquivo, long deslocamento, size_t tamanho, void* destino);
+
+/*
+ * escrever_arquivo_indice - grava bytes em um deslocamento do arquivo de índice
+ *
+ * Com o cache, a gravação só chega ao disco em descarregar_arquivo_indice ou no fechamento.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_WRITE (-2).
+ */
+int escrever_arquivo_indice(FILE* arquivo, long deslocamento, size_t tamanho, const void* origem);
+
+/*
+ * tamanho_arquivo_indice - retorna o tamanho do arquivo de índice, com as gravações ainda no cache
+ *
+ * Pós-condições:
+ *	- Retorna -1 em caso de erro.
+ */
+long tamanho_arquivo_indice(FILE* arquivo);
+
+/*
+ * descarregar_arquivo_indice - grava no arquivo as páginas sujas do índice
+ *
+ * Chamada ao fim de cada inserção ou remoção: outro processo (ou a reconstrução por fopen) lê o
+ * arquivo em disco.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou ERRO_ARQUIVO_SEEK (-1) / ERRO_ARQUIVO_WRITE (-2) em caso de erro.
+ */
+int descarregar_arquivo_indice(FILE* arquivo);
+
+/*
+ * encerrar_armazenamento - grava as páginas pendentes e libera o cache, ou desfaz todos os mapeamentos
+ *
+ * Registrada com atexit na primeira abertura. Os índices abertos por abrir_arquivo_indice também
+ * têm as páginas gravadas. Com ARMAZENAMENTO_MMAP, arquivos aumentados por
+ * extensões são truncados de volta para o tamanho ocupado (cabeçalho + pos_topo registros), exceto
+ * depois de compartilhar_arquivos_dados.
+ *
+ * Pré-condições:
+ *	- Nenhum arquivo aberto por abrir_arquivo_dados ou abrir_arquivo_indice deve estar em uso.
+ */
+void encerrar_armazenamento(void);
+
+#endif // ARMAZENAMENTO_H
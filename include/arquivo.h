@@ -1,6 +1,14 @@
 #ifndef ARQUIVO_H
 #define ARQUIVO_H
 #include<stdio.h>
+#include<stddef.h>
+
+#define ASSINATURA_CABECALHO 0x31424942	// "BIB1"
+#define VERSAO_CABECALHO 5
+#define VERSAO_DATAS_NUMERICAS 2	// a partir desta versão, emprestimo.dat guarda as datas em número de dias
+#define VERSAO_LISTA_DEVOLVIDOS 3	// a partir desta versão, o cabeçalho tem pos_devolvidos (CABECALHO_VERSAO_1 antes dela)
+#define VERSAO_EMPRESTIMOS_USUARIO 4	// a partir desta versão, USUARIO e EMPRESTIMO têm o encadeamento dos empréstimos de cada usuário
+#define VERSAO_EMPRESTIMOS_LIVRO 5	// a partir desta versão, REGISTRO_LIVRO e EMPRESTIMO têm o encadeamento dos empréstimos de cada livro
 
 /*
  * CABECALHO - struct que armazena dados de controle da lista encadeada em arquivo
@@ -8,13 +16,74 @@
  * @pos_cabeca - posição do primeiro nó da lista encadeada de registros ativos
  * @pos_topo   - próxima posição livre no final do arquivo (usada se não houver posições livres reutilizáveis)
  * @pos_livre  - posição do primeiro nó da lista de registros removidos (espaços livres reutilizáveis)
+ * @assinatura - ASSINATURA_CABECALHO; arquivos sem ela têm o cabeçalho antigo (CABECALHO_VERSAO_0)
+ * @versao     - versão do cabeçalho (VERSAO_CABECALHO)
+ * @num_ativos - quantidade de registros na lista de ativos
+ * @num_livres - quantidade de registros na lista de livres
+ * @emprestimos_abertos - emprestimo.dat: empréstimos sem data de devolução (0 nos demais arquivos)
+ * @exemplares_disponiveis - livro.dat: soma dos exemplares disponíveis de todos os livros (0 nos demais arquivos)
+ * @pos_devolvidos - emprestimo.dat: primeiro nó da lista de empréstimos devolvidos (-1 nos demais arquivos)
+ *
+ * Em emprestimo.dat há duas listas de registros ativos: pos_cabeca encadeia os empréstimos em
+ * aberto e pos_devolvidos, o histórico de empréstimos devolvidos.
+ *
+ * Os contadores são atualizados junto com o restante do cabeçalho pelos cadastros, empréstimos,
+ * devoluções e pela carga em lote, permitindo contagens sem percorrer as listas.
  */
 typedef struct CABECALHO {
     int pos_cabeca;
     int pos_topo;
     int pos_livre;
+    int assinatura;
+    int versao;
+    int num_ativos;
+    int num_livres;
+    int emprestimos_abertos;
+    int exemplares_disponiveis;
+    int pos_devolvidos;
 } CABECALHO;
 
+/*
+ * CABECALHO_VERSAO_0 - cabeçalho dos arquivos gravados antes dos contadores
+ *
+ * Tem os três primeiros campos de CABECALHO; os registros começam logo depois dele.
+ * Arquivos nesse formato são convertidos por inicializar_base_de_dados.
+ */
+typedef struct {
+    int pos_cabeca;
+    int pos_topo;
+    int pos_livre;
+} CABECALHO_VERSAO_0;
+
+/*
+ * CABECALHO_VERSAO_1 - cabeçalho das versões 1 e 2, anteriores a VERSAO_LISTA_DEVOLVIDOS
+ *
+ * Tem os campos de CABECALHO até exemplares_disponiveis; os registros começam logo depois dele.
+ */
+typedef struct {
+    int pos_cabeca;
+    int pos_topo;
+    int pos_livre;
+    int assinatura;
+    int versao;
+    int num_ativos;
+    int num_livres;
+    int emprestimos_abertos;
+    int exemplares_disponiveis;
+} CABECALHO_VERSAO_1;
+
+/*
+ * tamanho_cabecalho_gravado - tamanho do cabeçalho com que um arquivo de lista foi gravado
+ *
+ * @cabecalho - início do arquivo, lido como CABECALHO (campos não lidos zerados)
+ * @lido - quantidade de bytes efetivamente lidos
+ *
+ * Pós-condições:
+ *	- Retorna sizeof(CABECALHO_VERSAO_0) para arquivos sem assinatura, sizeof(CABECALHO_VERSAO_1)
+ *	para versões anteriores a VERSAO_LISTA_DEVOLVIDOS e sizeof(CABECALHO) para as demais.
+ */
+size_t tamanho_cabecalho_gravado(const CABECALHO* cabecalho, size_t lido);
+
 /*
  * le_cabecalho - funcao que le o cabecalho do arquivo com as informacoes da lista
  *
@@ -56,12 +125,75 @@ int escreve_cabecalho(FILE* arq, CABECALHO* cab);
  *	- O ponteiro arq deve ser válido (não nulo)
  *
  * Pós-condições:
- *	- Um cabeçalho é escrito no início do arquivo, marcando a lista como vazia:
+ *	- Um cabeçalho é escrito no início do arquivo, marcando a lista como vazia (contadores zerados)
  *	- Retorno 0 caso sucesso
  *	- Retorno negativo caso erro
  */
 int cria_lista_vazia(FILE* arq);
 
+#define REGISTROS_POR_BLOCO 256
+
+/*
+ * visitante_registro - função chamada para cada registro ativo em uma varredura sequencial
+ *
+ * @registro - ponteiro para o registro lido (REGISTRO_LIVRO, USUARIO ou EMPRESTIMO)
+ * @posicao - posição do registro no arquivo
+ * @contexto - ponteiro repassado pelo chamador da varredura
+ *
+ * Deve retornar SUCESSO (0) para continuar ou um código de erro para interromper a varredura.
+ */
+typedef int (*visitante_registro)(const void* registro, int posicao, void* contexto);
+
+/*
+ * varrer_registros_ativos - visita todos os registros ativos de um arquivo de lista em ordem física
+ *
+ * @arquivo - arquivo de lista aberto para leitura
+ * @tamanho_registro - tamanho de cada registro (ex.: sizeof(REGISTRO_LIVRO))
+ * @deslocamento_proximo - deslocamento do campo de encadeamento dentro do registro (ex.: offsetof(REGISTRO_LIVRO, prox))
+ * @visitar - função chamada para cada registro ativo, com sua posição no arquivo
+ * @contexto - ponteiro repassado para a função visitar
+ *
+ * Em vez de seguir a lista encadeada (um fseek por registro), o arquivo é lido do início ao fim
+ * em blocos de REGISTROS_POR_BLOCO registros, pulando as posições da lista de livres.
+ *
+ * Pré-condições:
+ *	- O arquivo deve estar aberto para leitura e conter um cabeçalho válido.
+ * Pós-condições:
+ *	- A ordem de visita é a ordem física, não a ordem da lista encadeada.
+ *	- Retorna SUCESSO (0) ou o primeiro erro encontrado (inclusive o retornado pela função visitar).
+ */
+int varrer_registros_ativos(
+	FILE* arquivo,
+	size_t tamanho_registro,
+	size_t deslocamento_proximo,
+	visitante_registro visitar,
+	void* contexto
+);
+
+/*
+ * recalcular_contadores - recalcula os contadores do cabeçalho com uma varredura do arquivo
+ *
+ * @arquivo - arquivo de lista aberto por stdio em modo leitura/escrita (sem o cache de páginas)
+ * @tamanho_registro - tamanho de cada registro
+ * @deslocamento_proximo - deslocamento do campo de encadeamento dentro do registro
+ * @contabilizar - função chamada para cada registro ativo com o CABECALHO como contexto, para os
+ * contadores específicos do arquivo (ex.: contabilizar_livro); NULL se não houver
+ *
+ * Usada na conversão de arquivos antigos; durante o uso normal os contadores são mantidos pelas operações.
+ *
+ * Pré-condições:
+ *	- O arquivo deve ter o cabeçalho atual (CABECALHO).
+ * Pós-condições:
+ *	- num_ativos, num_livres, emprestimos_abertos e exemplares_disponiveis são recalculados e gravados.
+ *	- Retorna SUCESSO (0), ERRO_ESCREVER_CABECALHO (-12) ou os erros de varrer_registros_ativos.
+ */
+int recalcular_contadores(
+	FILE* arquivo,
+	size_t tamanho_registro,
+	size_t deslocamento_proximo,
+	visitante_registro contabilizar
+);
+
 /*
  * inicializar_base_de_dados - inicializa arquivos binários de usuários, livros e empréstimos
  *
@@ -79,7 +211,28 @@ int cria_lista_vazia(FILE* arq);
  *		"\caminho\para\diretorio\".
  *	- O diretório deve possuir permissões de leitura e escrita.
  * Pós-condições:
+ *	- Se o diretório tiver um diário (diario.h) deixado por uma execução interrompida, as operações
+ *	confirmadas nele são reaplicadas antes de qualquer outra etapa (diario_recuperar) e todos os
+ *	índices abaixo são reconstruídos.
  *	- Os arquivos binários para listas encadeadas são criados e inicializados com cabeçalho, caso não existam.
+ *	- As colunas de texto dos livros (livro.col e livro.str) são criadas; um livro.dat num formato
+ *	antigo, com os textos ou suas referências dentro do registro, é convertido (converter_livros_formato_antigo).
+ *	- Arquivos com um cabeçalho antigo (CABECALHO_VERSAO_0 ou CABECALHO_VERSAO_1) ou de versão
+ *	anterior são convertidos para o cabeçalho atual, com os contadores calculados a partir das
+ *	listas; arquivos de uma versão mais nova são recusados.
+ *	- Um emprestimo.dat de versão anterior é convertido pelo
+ *	converter_emprestimos_formato_antigo: datas em texto passam a número de dias e a lista única é
+ *	separada nas listas de empréstimos abertos e devolvidos.
+ *	- Bases anteriores a VERSAO_EMPRESTIMOS_USUARIO (usuario.dat ou emprestimo.dat) recebem os
+ *	campos de encadeamento por usuário, e as listas de empréstimos de cada usuário são montadas
+ *	por reconstruir_emprestimos_usuarios.
+ *	- Do mesmo modo, bases anteriores a VERSAO_EMPRESTIMOS_LIVRO (livro.dat ou emprestimo.dat)
+ *	recebem o encadeamento por livro, montado por reconstruir_emprestimos_livros.
+ *	- O índice hash de livros (livro.idx), a árvore B+ de títulos (livro_titulo.idx), os índices
+ *	invertidos de autores e de trigramas (livro_autor.* e livro_trigrama.*), a árvore B+ de
+ *	usuários (usuario.idx), o índice de empréstimos abertos (emprestimo.idx) e a árvore B+ de
+ *	datas de empréstimo e devolução (emprestimo_data.idx) são construídos a partir das listas,
+ *	caso não existam.
  *	- Se os arquivos existirem e estarem inicializados, a função não faz nada.
  *	- Retorna SUCESSO (0) em caso de sucesso.
  *	- Retorna valores negativos em caso de erro:
@@ -110,7 +263,13 @@ int inicializar_base_de_dados(char* caminho_diretorio);
  *		- Linhas iniciadas por 'E' realizam emprestimo, e devolucao se houver data.
  *	- Informacoes sao normalizadas com trim e limitadas ao tamanho maximo de cada campo.
  *	- Mensagens de erro sao impressas para entradas mal formatadas ou com conflitos de ID.
- *	- Retorna SUCESSO (0) ao final do processamento, mesmo com erros parciais.
+ *	- As linhas sao interpretadas em paralelo (ver executar_lote), mas aplicadas na ordem do
+ *	arquivo; as mensagens de erro trazem o numero original da linha.
+ *	- Os arquivos de dados ficam abertos durante todo o lote (ver carga_iniciar); registros novos
+ *	são gravados em blocos sequenciais, cada cabeçalho é gravado uma vez e os índices são
+ *	montados apenas ao final.
+ *	- Retorna SUCESSO (0) ao final do processamento, mesmo com erros parciais nas linhas.
+ *	- Retorna um código de erro negativo se os arquivos de dados não puderem ser abertos ou gravados.
  *
  * Erros tratados internamente:
  *	- ERRO_ABRIR_ARQUIVO (-10): erro ao abrir o arquivo de lote.
@@ -0,0 +1,185 @@
+#ifndef ARVORE_BMAIS_H
+#define ARVORE_BMAIS_H
+
+#include <stdio.h>
+
+#define TAM_PAGINA_BMAIS 4096
+#define TAM_MAX_CHAVE_BMAIS 256
+
+/*
+ * CABECALHO_ARVORE_BMAIS - struct que armazena dados de controle da árvore B+ em arquivo
+ *
+ * @tamanho_chave  - tamanho fixo (em bytes) das chaves armazenadas na árvore
+ * @ordem          - número máximo de chaves por nó
+ * @raiz           - número da página do nó raiz
+ * @num_paginas    - quantidade de páginas do arquivo (incluindo a página do cabeçalho)
+ * @primeira_folha - número da página da folha mais à esquerda (início das varreduras)
+ * @num_chaves     - quantidade total de chaves armazenadas
+ *
+ * O arquivo é dividido em páginas de TAM_PAGINA_BMAIS bytes. A página 0 guarda o cabeçalho
+ * e as demais guardam nós. As chaves são comparadas byte a byte (memcmp), então chaves
+ * numéricas devem ser codificadas em big-endian (ver arvore_bmais_codificar_inteiro).
+ * As folhas são encadeadas da esquerda para a direita, permitindo varreduras ordenadas.
+ */
+typedef struct {
+	int tamanho_chave;
+	int ordem;
+	int raiz;
+	int num_paginas;
+	int primeira_folha;
+	int num_chaves;
+} CABECALHO_ARVORE_BMAIS;
+
+/*
+ * visitante_bmais - função chamada para cada chave encontrada em uma varredura
+ *
+ * @chave - ponteiro para os bytes da chave
+ * @valor - valor associado à chave
+ * @contexto - ponteiro repassado pelo chamador da varredura
+ *
+ * Deve retornar 0 para continuar a varredura ou qualquer outro valor para interrompê-la.
+ */
+typedef int (*visitante_bmais)(const unsigned char* chave, int valor, void* contexto);
+
+/*
+ * arvore_bmais_codificar_inteiro - codifica um inteiro sem sinal como chave de 4 bytes
+ *
+ * @valor - valor a ser codificado
+ * @destino - buffer com pelo menos 4 bytes
+ *
+ * Pós-condições:
+ *	- destino recebe o valor em big-endian, de forma que memcmp preserve a ordem numérica.
+ */
+void arvore_bmais_codificar_inteiro(unsigned int valor, unsigned char* destino);
+
+/*
+ * arvore_bmais_decodificar_inteiro - decodifica um inteiro codificado por arvore_bmais_codificar_inteiro
+ *
+ * @origem - buffer com pelo menos 4 bytes
+ *
+ * Pós-condições:
+ *	- Retorna o valor inteiro sem sinal representado pelos 4 primeiros bytes.
+ */
+unsigned int arvore_bmais_decodificar_inteiro(const unsigned char* origem);
+
+/*
+ * arvore_bmais_criar - cria (ou sobrescreve) um arquivo de árvore B+ vazia
+ *
+ * @caminho - caminho completo para o arquivo da árvore
+ * @tamanho_chave - tamanho fixo das chaves, entre 1 e TAM_MAX_CHAVE_BMAIS
+ *
+ * Pré-condições:
+ *	- O diretório do caminho deve existir e possuir permissão de escrita.
+ * Pós-condições:
+ *	- O arquivo é criado com o cabeçalho e uma folha raiz vazia.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível criar o arquivo.
+ *		- ERRO_ESCREVER_INDICE (-28): não foi possível escrever as páginas iniciais.
+ */
+int arvore_bmais_criar(const char* caminho, int tamanho_chave);
+
+/*
+ * arvore_bmais_construir - cria um arquivo de árvore B+ a partir de chaves já ordenadas
+ *
+ * @caminho - caminho completo para o arquivo da árvore
+ * @tamanho_chave - tamanho fixo das chaves
+ * @chaves - vetor contínuo com quantidade * tamanho_chave bytes, em ordem crescente e sem repetições
+ * @valores - valores associados a cada chave
+ * @quantidade - número de chaves
+ *
+ * A árvore é montada de baixo para cima (folhas primeiro), gravando cada página uma única vez.
+ * As folhas são preenchidas até 3/4 da capacidade para acomodar inserções futuras sem divisões.
+ *
+ * Pré-condições:
+ *	- As chaves devem estar ordenadas por memcmp e não podem se repetir.
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna ERRO_ABRIR_ARQUIVO (-10) ou ERRO_ESCREVER_INDICE (-28) em caso de erro.
+ */
+int arvore_bmais_construir(const char* caminho, int tamanho_chave, const unsigned char* chaves, const int* valores, int quantidade);
+
+/*
+ * arvore_bmais_inserir - insere (ou atualiza) uma chave na árvore
+ *
+ * @caminho - caminho completo para o arquivo da árvore
+ * @chave - ponteiro para os bytes da chave (tamanho_chave bytes)
+ * @valor - valor associado à chave
+ *
+ * Pré-condições:
+ *	- O arquivo deve ter sido criado por arvore_bmais_criar ou arvore_bmais_construir.
+ * Pós-condições:
+ *	- Se a chave já existir, seu valor é substituído.
+ *	- Nós cheios são divididos e a altura da árvore cresce quando a raiz é dividida.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível abrir o arquivo.
+ *		- ERRO_LER_INDICE (-27): falha na leitura de alguma página.
+ *		- ERRO_ESCREVER_INDICE (-28): falha na escrita de alguma página.
+ */
+int arvore_bmais_inserir(const char* caminho, const unsigned char* chave, int valor);
+
+/*
+ * arvore_bmais_buscar - busca o valor associado a uma chave
+ *
+ * @caminho - caminho completo para o arquivo da árvore
+ * @chave - ponteiro para os bytes da chave
+ * @valor - ponteiro onde o valor encontrado será armazenado
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) se a chave foi encontrada.
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ENCONTRAR_CHAVE (-29): a chave não existe na árvore.
+ *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível abrir o arquivo.
+ *		- ERRO_LER_INDICE (-27): falha na leitura de alguma página.
+ */
+int arvore_bmais_buscar(const char* caminho, const unsigned char* chave, int* valor);
+
+/*
+ * arvore_bmais_percorrer_intervalo - visita, em ordem crescente, as chaves de um intervalo fechado
+ *
+ * @caminho - caminho completo para o arquivo da árvore
+ * @chave_inicial - menor chave do intervalo (NULL para começar da primeira chave)
+ * @chave_final - maior chave do intervalo (NULL para ir até a última chave)
+ * @visitar - função chamada para cada chave do intervalo
+ * @contexto - ponteiro repassado para a função visitar
+ *
+ * A busca desce até a folha da chave inicial e segue o encadeamento das folhas, lendo
+ * apenas as páginas que contêm chaves do intervalo: O(log n + k).
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ao final da varredura (inclusive se interrompida pela função visitar).
+ *	- Retorna ERRO_ABRIR_ARQUIVO (-10) ou ERRO_LER_INDICE (-27) em caso de erro.
+ */
+int arvore_bmais_percorrer_intervalo(
+	const char* caminho,
+	const unsigned char* chave_inicial,
+	const unsigned char* chave_final,
+	visitante_bmais visitar,
+	void* contexto
+);
+
+/*
+ * Versões de arvore_bmais_inserir, arvore_bmais_buscar e arvore_bmais_percorrer_intervalo sobre uma
+ * árvore já aberta
+ *
+ * @arquivo - arquivo da árvore aberto com abrir_arquivo_indice (armazenamento.h), "rb" para buscar e
+ * percorrer, "r+b" para inserir; os nós são lidos e gravados pelo cache de páginas
+ *
+ * Mesmos demais parâmetros e códigos de retorno, exceto ERRO_ABRIR_ARQUIVO: o arquivo não é aberto
+ * nem fechado a cada chamada. Usadas pelas operações sobre uma BIBLIOTECA, que mantém os índices abertos.
+ *
+ * Pós-condições:
+ *	- A inserção grava no arquivo as páginas alteradas antes de retornar (descarregar_arquivo_indice).
+ */
+int arvore_bmais_inserir_arquivo(FILE* arquivo, const unsigned char* chave, int valor);
+int arvore_bmais_buscar_arquivo(FILE* arquivo, const unsigned char* chave, int* valor);
+int arvore_bmais_percorrer_intervalo_arquivo(
+	FILE* arquivo,
+	const unsigned char* chave_inicial,
+	const unsigned char* chave_final,
+	visitante_bmais visitar,
+	void* contexto
+);
+
+#endif // ARVORE_BMAIS_H
@@ -0,0 +1,360 @@
+#ifndef BIBLIOTECA_H
+#define BIBLIOTECA_H
+
+#include <stdio.h>
+
+#include "arquivo.h"
+#include "textos.h"
+#include "utils.h"
+
+// arquivos de lista de um BIBLIOTECA, usados como máscara nas travas
+#define BIBLIOTECA_LIVROS	1u
+#define BIBLIOTECA_USUARIOS	2u
+#define BIBLIOTECA_EMPRESTIMOS	4u
+#define BIBLIOTECA_TODOS	(BIBLIOTECA_LIVROS | BIBLIOTECA_USUARIOS | BIBLIOTECA_EMPRESTIMOS)
+
+// índices de um arquivo de lista mantidos abertos ao mesmo tempo (livros: hash, títulos e o dicionário e as
+// listas de autores e de trigramas)
+#define MAX_INDICES_ARQUIVO	6
+
+/*
+ * INDICE_ABERTO - índice de um arquivo de lista mantido aberto por biblioteca_indice
+ *
+ * @extensao - extensão que, no lugar da do arquivo de lista, dá o caminho do índice (NULL se livre)
+ * @arquivo - índice aberto
+ */
+typedef struct {
+	const char* extensao;
+	FILE* arquivo;
+} INDICE_ABERTO;
+
+/*
+ * ARQUIVO_BIBLIOTECA - arquivo de lista mantido aberto por um BIBLIOTECA
+ *
+ * @arquivo - arquivo aberto em modo leitura/escrita (NULL se não foi aberto)
+ * @cabecalho - cópia residente do cabeçalho, sempre igual à gravada no arquivo
+ * @caminho - caminho completo do arquivo (usado para localizar os índices)
+ * @indices - índices do arquivo abertos na primeira consulta por biblioteca_indice e mantidos
+ * abertos até o arquivo ser fechado
+ */
+typedef struct {
+	FILE* arquivo;
+	CABECALHO cabecalho;
+	char caminho[TAM_MAX_CAMINHO];
+	INDICE_ABERTO indices[MAX_INDICES_ARQUIVO];
+} ARQUIVO_BIBLIOTECA;
+
+/*
+ * BIBLIOTECA - base de dados aberta: arquivos de livros, usuários e empréstimos com seus cabeçalhos
+ *
+ * @livros - livro.dat
+ * @usuarios - usuario.dat
+ * @emprestimos - emprestimo.dat
+ * @textos_livros - colunas de texto dos livros (livro.col e livro.str), abertas junto com livros
+ * @saida - onde consultas e listagens exibem os resultados (stdout; o servidor troca pela resposta de cada pedido)
+ * @transacao - 1 entre biblioteca_iniciar_transacao e a confirmação ou o desfazimento da transação
+ * @compartilhada - 1 se a base foi aberta por biblioteca_abrir e pode estar aberta por outros processos
+ * @nivel_travas - chamadas de biblioteca_travar_* ainda sem biblioteca_destravar
+ * @travas_cabecalho / @travas_registros - máscaras dos arquivos com a trava de cabeçalho
+ * (sempre exclusiva) e a trava de registros (compartilhada ou exclusiva) deste processo
+ *
+ * Criado uma vez por biblioteca_abrir e passado às funções biblioteca_*, que não abrem
+ * arquivos nem leem cabeçalhos a cada chamada. Enquanto a base aberta por biblioteca_abrir
+ * existir, as gravações nos arquivos de lista passam pelo diário (diario.h). As funções baseadas em caminho
+ * (cadastrar_livro, emprestar_livro, ...) abrem um BIBLIOTECA temporário e o repassam.
+ *
+ * Vários processos podem abrir a mesma base com biblioteca_abrir. Cada arquivo de lista tem duas
+ * regiões travadas com fcntl (trava.h): o cabeçalho, que só quem grava trava (em modo exclusivo),
+ * e os registros. Consultas travam os registros em modo compartilhado e rodam em paralelo entre
+ * si e com a parte de uma gravação que precede a confirmação (localizar registros, ler a lista de
+ * livres, gravar os textos). Quem grava trava os cabeçalhos dos arquivos que altera durante toda
+ * a operação, o que serializa as alterações de cada lista, e os registros em modo exclusivo só
+ * da confirmação até a atualização dos índices. As travas são sempre obtidas na ordem livros,
+ * usuários, empréstimos (e cabeçalho antes de registros), o que evita esperas circulares. As funções
+ * baseadas em caminho não participam das travas.
+ */
+typedef struct {
+	ARQUIVO_BIBLIOTECA livros;
+	ARQUIVO_BIBLIOTECA usuarios;
+	ARQUIVO_BIBLIOTECA emprestimos;
+	AREA_TEXTOS textos_livros;
+	FILE* saida;
+	int transacao;
+	int compartilhada;
+	int nivel_travas;
+	unsigned int travas_cabecalho;
+	unsigned int travas_registros;
+} BIBLIOTECA;
+
+/*
+ * biblioteca_abrir - inicializa a base de dados de um diretório e a mantém aberta
+ *
+ * @caminho_diretorio - diretório dos arquivos binários (mesmo formato de inicializar_base_de_dados)
+ *
+ * A base pode estar aberta ao mesmo tempo por outros processos com biblioteca_abrir: o diário é
+ * aberto em modo compartilhado (diario.h) e as funções biblioteca_* travam os arquivos que usam.
+ *
+ * Pós-condições:
+ *	- Os arquivos e índices são criados se necessário (inicializar_base_de_dados), pelo primeiro
+ *	processo a abrir a base.
+ *	- O diário da base é aberto (NOME_ARQUIVO_DIARIO no diretório) e fechado por biblioteca_fechar.
+ *	- Páginas dos arquivos de lista ainda em cache de uma abertura anterior são descartadas: cabeçalhos
+ *	e registros são lidos de novo, com as alterações feitas por outros processos nesse intervalo.
+ *	- Retorna o BIBLIOTECA aberto, que deve ser liberado com biblioteca_fechar.
+ *	- Retorna NULL se a base não puder ser inicializada ou aberta, ou se estiver aberta por
+ *	outro processo com biblioteca_abrir_exclusiva.
+ */
+BIBLIOTECA* biblioteca_abrir(char* caminho_diretorio);
+
+/*
+ * biblioteca_abrir_exclusiva - inicializa a base de um diretório e a mantém aberta só para este processo
+ *
+ * @caminho_diretorio - diretório dos arquivos binários
+ *
+ * Sem travas por operação e com confirmação em grupo no diário: para um único processo que
+ * concentra todos os acessos à base.
+ *
+ * Pós-condições:
+ *	- Como biblioteca_abrir; retorna NULL também se a base estiver aberta por qualquer outro processo.
+ */
+BIBLIOTECA* biblioteca_abrir_exclusiva(char* caminho_diretorio);
+
+/*
+ * biblioteca_fechar - fecha os arquivos e libera um BIBLIOTECA criado por biblioteca_abrir
+ *
+ * @biblioteca - base aberta (NULL é ignorado)
+ *
+ * Uma transação em andamento é desfeita.
+ */
+void biblioteca_fechar(BIBLIOTECA* biblioteca);
+
+/*
+ * biblioteca_abrir_arquivos - abre apenas os arquivos informados em um BIBLIOTECA já alocado
+ *
+ * @biblioteca - estrutura a ser preenchida
+ * @caminho_arquivo_livro / @caminho_arquivo_usuario / @caminho_arquivo_emprestimo - caminhos
+ * dos arquivos binários; NULL indica que o arquivo não será usado
+ *
+ * Usada pelas funções baseadas em caminho, que recebem apenas os arquivos de que precisam.
+ *
+ * Pré-condições:
+ *	- Os arquivos informados devem existir e estar inicializados com cabeçalho; com o arquivo de
+ *	livros, a área de textos (livro.col e livro.str) também deve existir (inicializar_base_de_dados).
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) em caso de sucesso; os arquivos devem ser fechados com biblioteca_fechar_arquivos.
+ *	- Retorna valores negativos em caso de erro (nada fica aberto):
+ *		- ERRO_ABRIR_ARQUIVO (-10): algum arquivo não pôde ser aberto.
+ *		- ERRO_LER_CABECALHO (-11): algum cabeçalho não pôde ser lido.
+ */
+int biblioteca_abrir_arquivos(
+	BIBLIOTECA* biblioteca,
+	const char* caminho_arquivo_livro,
+	const char* caminho_arquivo_usuario,
+	const char* caminho_arquivo_emprestimo
+);
+
+/*
+ * biblioteca_fechar_arquivos - fecha os arquivos abertos por biblioteca_abrir_arquivos
+ */
+void biblioteca_fechar_arquivos(BIBLIOTECA* biblioteca);
+
+/*
+ * biblioteca_travar_leitura - trava para consulta os arquivos de lista informados
+ *
+ * @biblioteca - base aberta
+ * @arquivos - máscara de BIBLIOTECA_LIVROS, BIBLIOTECA_USUARIOS e BIBLIOTECA_EMPRESTIMOS
+ *
+ * Espera as gravações em andamento em outros processos. Os arquivos alterados por outro processo
+ * desde a última trava têm as páginas em cache e o cabeçalho residente atualizados; uma gravação
+ * que outro processo deixou pela metade é terminada antes (diario_reparar). Chamadas aninhadas
+ * (ex.: dentro de uma transação) não travam de novo. Sem outros processos, só conta o nível das chamadas.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou ERRO_TRAVAR_ARQUIVO (-33) / o erro do reparo (nada fica travado);
+ *	toda chamada com sucesso deve ser seguida de biblioteca_destravar.
+ */
+int biblioteca_travar_leitura(BIBLIOTECA* biblioteca, unsigned int arquivos);
+
+/*
+ * biblioteca_travar_escrita - trava para alteração os arquivos de lista informados
+ *
+ * @biblioteca - base aberta
+ * @arquivos - máscara dos arquivos que a operação pode alterar ou ler
+ *
+ * Trava os cabeçalhos, o que exclui os outros processos que gravam nesses arquivos; os registros
+ * são travados em modo exclusivo só em biblioteca_confirmar_operacao.
+ *
+ * Pós-condições:
+ *	- Como biblioteca_travar_leitura.
+ */
+int biblioteca_travar_escrita(BIBLIOTECA* biblioteca, unsigned int arquivos);
+
+/*
+ * biblioteca_destravar - desfaz a última chamada de biblioteca_travar_leitura ou biblioteca_travar_escrita
+ *
+ * Na última, as operações aplicadas são publicadas aos outros processos (diario_concluir_aplicacao)
+ * e as travas são liberadas; se o diário passou do tamanho de checkpoint, o checkpoint é feito em seguida
+ * (também sem outros processos: só aqui a operação já atualizou os índices).
+ */
+void biblioteca_destravar(BIBLIOTECA* biblioteca);
+
+/*
+ * biblioteca_gravar_cabecalho - grava um novo cabeçalho e, em caso de sucesso, o torna residente
+ *
+ * @arquivo - arquivo da biblioteca
+ * @cabecalho - cabeçalho atualizado
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou ERRO_ESCREVER_CABECALHO (-12); em caso de erro a cópia residente não muda.
+ */
+int biblioteca_gravar_cabecalho(ARQUIVO_BIBLIOTECA* arquivo, const CABECALHO* cabecalho);
+
+/*
+ * biblioteca_indice - retorna um índice de um arquivo da biblioteca, abrindo-o na primeira chamada
+ *
+ * @arquivo - arquivo da biblioteca
+ * @extensao - extensão do índice no lugar da do arquivo (".idx" para livro.idx, usuario.idx e
+ * emprestimo.idx, EXTENSAO_INDICE_TITULO, EXTENSAO_LISTAS_AUTOR etc.); deve ser uma constante,
+ * guardada para as próximas chamadas
+ *
+ * O índice é aberto por abrir_arquivo_indice (armazenamento.h): nós, baldes e listas lidos de novo
+ * vêm do cache de páginas, e cada inserção grava as páginas alteradas no arquivo ao terminar.
+ *
+ * Pós-condições:
+ *	- Retorna o índice aberto (leitura/escrita, ou só leitura se a escrita não for permitida) ou
+ *	NULL se ele não existir ou não houver espaço para mais um índice; nesse caso o chamador o
+ *	reconstrói e chama a função de novo.
+ */
+FILE* biblioteca_indice(ARQUIVO_BIBLIOTECA* arquivo, const char* extensao);
+
+/*
+ * biblioteca_fechar_indices - fecha os índices mantidos abertos por biblioteca_indice
+ *
+ * Chamada antes de reconstruir um índice e quando outro processo altera o arquivo (a carga em lote
+ * apaga os índices e os cria de novo, e um FILE aberto continuaria no arquivo apagado).
+ */
+void biblioteca_fechar_indices(ARQUIVO_BIBLIOTECA* arquivo);
+
+/*
+ * biblioteca_iniciar_operacao - marca o início de uma operação que grava vários registros e cabeçalhos
+ *
+ * @biblioteca - base aberta
+ *
+ * Com o diário aberto (diario.h), as gravações feitas até biblioteca_confirmar_operacao formam
+ * uma única operação: na recuperação, ou todas são reaplicadas ou nenhuma. Sem diário, não tem efeito.
+ */
+void biblioteca_iniciar_operacao(BIBLIOTECA* biblioteca);
+
+/*
+ * biblioteca_confirmar_operacao - confirma a operação iniciada por biblioteca_iniciar_operacao
+ *
+ * Deve ser chamada depois da última gravação nos arquivos de lista e antes da atualização dos
+ * índices, cuja reconstrução (quando o índice está ausente) lê as listas por stdio.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou o erro de diario_confirmar_operacao (a operação é desfeita).
+ */
+int biblioteca_confirmar_operacao(BIBLIOTECA* biblioteca);
+
+/*
+ * biblioteca_desfazer_operacao - descarta as gravações da operação em andamento e relê os cabeçalhos residentes
+ *
+ * Sem diário, as gravações já feitas permanecem nos arquivos. Depois de biblioteca_confirmar_operacao,
+ * só relê os cabeçalhos.
+ */
+void biblioteca_desfazer_operacao(BIBLIOTECA* biblioteca);
+
+/*
+ * biblioteca_sincronizar - torna duráveis as operações já confirmadas
+ *
+ * @biblioteca - base aberta
+ *
+ * Na base aberta por biblioteca_abrir_exclusiva, uma operação confirmada espera o grupo do diário
+ * completar para ir ao disco; esta função encerra o grupo atual com um único fsync. Nas demais
+ * bases, cada operação já está no disco quando termina e a função não tem efeito.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou o erro de diario_sincronizar.
+ */
+int biblioteca_sincronizar(BIBLIOTECA* biblioteca);
+
+/*
+ * biblioteca_iniciar_transacao - inicia uma transação com várias operações
+ *
+ * @biblioteca - base aberta por biblioteca_abrir
+ *
+ * Com outros processos usando a base, todos os arquivos ficam travados para escrita até a
+ * confirmação ou o desfazimento.
+ *
+ * Cadastros, empréstimos e devoluções feitos até biblioteca_confirmar_transacao acumulam as suas
+ * gravações em memória como uma única operação do diário; cada uma delas continua podendo falhar
+ * sozinha (só as suas gravações são desfeitas). As buscas e consultas por índice enxergam as
+ * alterações da transação; as listagens que leem os arquivos diretamente (ex.: livros emprestados),
+ * só depois da confirmação.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou ERRO_TRANSACAO (-32) se já houver uma transação em andamento ou a
+ *	base estiver sem diário.
+ */
+int biblioteca_iniciar_transacao(BIBLIOTECA* biblioteca);
+
+/*
+ * biblioteca_confirmar_transacao - grava a transação em andamento de forma durável
+ *
+ * @biblioteca - base com transação iniciada
+ *
+ * As gravações de todas as operações são fundidas por arquivo e posição (um cabeçalho alterado
+ * por cada operação é gravado uma vez; registros vizinhos, em um bloco) e vão ao diário em um
+ * único registro, seguido de um único fsync; só então chegam aos arquivos de dados.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) quando a transação está no disco.
+ *	- Retorna ERRO_TRANSACAO (-32) sem transação em andamento.
+ *	- Retorna o erro de diario_confirmar_operacao (a transação é desfeita como em
+ *	biblioteca_desfazer_transacao) ou de diario_sincronizar (a transação fica confirmada, mas
+ *	pode não estar no disco).
+ */
+int biblioteca_confirmar_transacao(BIBLIOTECA* biblioteca);
+
+/*
+ * biblioteca_desfazer_transacao - descarta todas as operações da transação em andamento
+ *
+ * @biblioteca - base com transação iniciada
+ *
+ * Os cabeçalhos residentes são relidos. Os índices, que não passam pelo diário, já foram
+ * atualizados pelas operações da transação: os dos arquivos alterados são reconstruídos.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_TRANSACAO (-32) sem transação em andamento ou o erro da
+ *	reconstrução de algum índice.
+ */
+int biblioteca_desfazer_transacao(BIBLIOTECA* biblioteca);
+
+/*
+ * biblioteca_recarregar - reabre os arquivos e relê os cabeçalhos
+ *
+ * @biblioteca - base aberta
+ *
+ * Necessária depois que os arquivos forem alterados por outro caminho (ex.: carga em lote).
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou os erros de biblioteca_abrir_arquivos (nesse caso os arquivos ficam fechados).
+ */
+int biblioteca_recarregar(BIBLIOTECA* biblioteca);
+
+/*
+ * biblioteca_processar_lote - executa um arquivo de lote sobre a base aberta
+ *
+ * @biblioteca - base aberta
+ * @caminho_arquivo_lote - caminho do arquivo texto de lote
+ *
+ * A carga em lote (processar_lote) mantém seus próprios arquivos e blocos; depois dela os
+ * arquivos da base são reabertos para que os cabeçalhos residentes reflitam a carga.
+ *
+ * Pós-condições:
+ *	- Retorna o valor de processar_lote, ou o erro de biblioteca_recarregar se a reabertura falhar.
+ *	- Retorna ERRO_TRANSACAO (-32), sem executar o lote, se houver uma transação em andamento.
+ */
+int biblioteca_processar_lote(BIBLIOTECA* biblioteca, const char* caminho_arquivo_lote);
+
+#endif // BIBLIOTECA_H
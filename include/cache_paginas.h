@@ -0,0 +1,136 @@
+#ifndef CACHE_PAGINAS_H
+#define CACHE_PAGINAS_H
+
+#include <stddef.h>
+
+/*
+ * Cache de páginas compartilhado pelos arquivos de lista (livro.dat, usuario.dat, emprestimo.dat)
+ * e pelos arquivos de índice (árvores B+, índices hash e listas dos índices invertidos).
+ *
+ * Os arquivos são divididos em páginas de TAM_PAGINA_CACHE bytes. As páginas lidas ficam em
+ * memória até serem substituídas pela menos usada recentemente (LRU); gravações só alteram a
+ * página em memória, que é marcada como suja e gravada no arquivo quando for substituída ou
+ * quando o chamador pedir (cache_paginas_descarregar). O cache abre o seu próprio FILE para
+ * cada arquivo, sem buffer do stdio, de modo que qualquer FILE aberto pelo mesmo caminho enxerga
+ * as mesmas páginas; o arquivo só fica registrado enquanto houver um FILE aberto pelo caminho.
+ *
+ * Não é seguro para uso por várias threads ao mesmo tempo.
+ */
+
+// tamanho de cada página do cache
+#ifndef TAM_PAGINA_CACHE
+#define TAM_PAGINA_CACHE        4096
+#endif
+
+// memória total reservada para as páginas; 0 desativa o cache
+#ifndef LIMITE_MEMORIA_CACHE
+#define LIMITE_MEMORIA_CACHE    (1L * 1024 * 1024)
+#endif
+
+#define MAX_ARQUIVOS_CACHE      16
+
+/*
+ * cache_paginas_abrir - registra um arquivo no cache, reservando a memória na primeira chamada
+ *
+ * @caminho - caminho completo do arquivo de lista
+ *
+ * Pós-condições:
+ *	- Retorna o identificador do arquivo no cache (>= 0); o mesmo caminho recebe o mesmo identificador
+ *	enquanto não for fechado (cache_paginas_fechar).
+ *	- Retorna ERRO_ABRIR_ARQUIVO (-10) se o arquivo não puder ser aberto ou não houver espaço na tabela.
+ *	- Retorna ERRO_ALOCAR_MEMORIA (-30) se o cache estiver desativado ou sem memória.
+ */
+int cache_paginas_abrir(const char* caminho);
+
+/*
+ * cache_paginas_buscar - retorna o identificador de um caminho já registrado
+ *
+ * Pós-condições:
+ *	- Retorna o identificador (>= 0) ou -1 se o caminho não estiver no cache.
+ */
+int cache_paginas_buscar(const char* caminho);
+
+/*
+ * cache_paginas_ler - copia bytes do arquivo, carregando as páginas que faltarem
+ *
+ * @arquivo - identificador retornado por cache_paginas_abrir
+ * @deslocamento - posição do primeiro byte no arquivo
+ * @tamanho - quantidade de bytes
+ * @destino - área que recebe os bytes
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna ERRO_ARQUIVO_SEEK (-1) para deslocamentos negativos.
+ *	- Retorna ERRO_ARQUIVO_READ (-3) se a região passar do fim do arquivo ou a leitura falhar.
+ *	- Retorna ERRO_ARQUIVO_WRITE (-2) se uma página suja substituída não puder ser gravada.
+ */
+int cache_paginas_ler(int arquivo, long deslocamento, size_t tamanho, void* destino);
+
+/*
+ * cache_paginas_escrever - grava bytes nas páginas do arquivo, marcando-as como sujas
+ *
+ * @arquivo - identificador retornado por cache_paginas_abrir
+ * @deslocamento - posição do primeiro byte no arquivo
+ * @tamanho - quantidade de bytes
+ * @origem - bytes a serem gravados
+ *
+ * Gravações além do fim do arquivo aumentam o seu tamanho; o arquivo em disco só muda quando
+ * as páginas são gravadas.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna ERRO_ARQUIVO_SEEK (-1) para deslocamentos negativos.
+ *	- Retorna ERRO_ARQUIVO_WRITE (-2) se o arquivo for somente leitura ou uma página não puder ser gravada.
+ *	- Retorna ERRO_ARQUIVO_READ (-3) se uma página não puder ser carregada.
+ */
+int cache_paginas_escrever(int arquivo, long deslocamento, size_t tamanho, const void* origem);
+
+/*
+ * cache_paginas_tamanho - retorna o tamanho do arquivo, incluindo as gravações ainda não descarregadas
+ *
+ * O tamanho não é conferido no disco: um arquivo aumentado fora do cache só é percebido por uma
+ * leitura além do fim conhecido ou depois de cache_paginas_descartar.
+ */
+long cache_paginas_tamanho(int arquivo);
+
+/*
+ * cache_paginas_descarregar - grava no arquivo todas as suas páginas sujas
+ *
+ * Pós-condições:
+ *	- As páginas continuam no cache, agora limpas.
+ *	- Retorna SUCESSO (0) ou ERRO_ARQUIVO_SEEK (-1) / ERRO_ARQUIVO_WRITE (-2) na primeira falha.
+ */
+int cache_paginas_descarregar(int arquivo);
+
+/*
+ * cache_paginas_descartar - grava as páginas sujas e retira do cache todas as páginas do arquivo
+ *
+ * Usada depois que o arquivo foi alterado fora do cache (ex.: carga em lote por stdio), para que
+ * as próximas leituras busquem o conteúdo novo.
+ *
+ * Pós-condições:
+ *	- Retorna o resultado da gravação das páginas sujas; as páginas são descartadas mesmo em caso de erro.
+ */
+int cache_paginas_descartar(int arquivo);
+
+/*
+ * cache_paginas_fechar - grava as páginas sujas, retira o arquivo do cache e fecha o seu FILE
+ *
+ * Chamada quando o último FILE aberto pelo caminho é fechado: outro processo pode alterar o arquivo
+ * antes da próxima abertura, que volta a registrá-lo e lê o conteúdo atual.
+ *
+ * Pós-condições:
+ *	- O identificador deixa de ser válido e pode ser reaproveitado por outro caminho.
+ *	- Retorna o resultado da gravação das páginas sujas; o arquivo é retirado mesmo em caso de erro.
+ */
+int cache_paginas_fechar(int arquivo);
+
+/*
+ * cache_paginas_encerrar - grava todas as páginas sujas, fecha os arquivos e libera a memória do cache
+ *
+ * Pós-condições:
+ *	- Todos os identificadores deixam de ser válidos.
+ */
+void cache_paginas_encerrar(void);
+
+#endif // CACHE_PAGINAS_H
@@ -0,0 +1,195 @@
+#ifndef CARGA_H
+#define CARGA_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "arquivo.h"
+#include "livro.h"
+#include "usuario.h"
+#include "emprestimo.h"
+#include "tabela_hash.h"
+#include "textos.h"
+#include "utils.h"
+
+#define REGISTROS_POR_BLOCO_CARGA 4096
+
+/*
+ * ARQUIVO_CARGA - arquivo de lista mantido aberto durante uma carga em lote
+ *
+ * @arquivo              - arquivo binário aberto em modo leitura/escrita
+ * @cabecalho            - cópia em memória do cabeçalho (gravada apenas ao final da carga)
+ * @tamanho_registro     - tamanho de cada registro (ex.: sizeof(REGISTRO_LIVRO))
+ * @deslocamento_proximo - deslocamento do campo de encadeamento dentro do registro
+ * @bloco                - registros anexados ao final do arquivo e ainda não gravados
+ * @inicio_bloco         - posição do primeiro registro do bloco
+ * @registros_no_bloco   - quantidade de registros no bloco
+ *
+ * Registros novos são acumulados no bloco e gravados com uma única escrita sequencial
+ * de até REGISTROS_POR_BLOCO_CARGA registros.
+ */
+typedef struct {
+	FILE* arquivo;
+	CABECALHO cabecalho;
+	size_t tamanho_registro;
+	size_t deslocamento_proximo;
+	unsigned char* bloco;
+	int inicio_bloco;
+	int registros_no_bloco;
+} ARQUIVO_CARGA;
+
+/*
+ * CARGA_LOTE - estado de uma carga em lote de livros, usuários e empréstimos
+ *
+ * @livros, @usuarios, @emprestimos - arquivos de dados mantidos abertos durante a carga
+ * @textos_livros       - área de textos dos livros, aberta só para anexar (textos gravados em sequência)
+ * @caminho_livro, @caminho_usuario, @caminho_emprestimo - caminhos usados para gravar os índices ao final
+ * @indice_livros       - código do livro -> índice nos vetores abaixo
+ * @posicoes_livros     - posição de cada livro no arquivo
+ * @exemplares_livros   - quantidade atual de exemplares de cada livro
+ * @emprestimos_livros  - início atual da lista de empréstimos de cada livro
+ * @livros_alterados    - indica se a quantidade de exemplares e o início da lista precisam ser regravados
+ * @num_livros          - quantidade de livros conhecidos
+ * @capacidade_livros   - capacidade dos vetores de livros
+ * @indice_usuarios     - código do usuário -> posição no arquivo
+ * @emprestimos_abertos - chave_emprestimo(usuário, livro) -> posição do empréstimo sem devolução
+ * @emprestimos_usuarios - código do usuário -> início da sua lista de empréstimos, só para os usuários
+ *                        que emprestaram na carga; primeiro_emprestimo é regravado em carga_finalizar
+ * @devolucoes          - quantidade de devoluções feitas na carga; os empréstimos devolvidos só
+ *                        passam da lista de abertos para a de devolvidos em carga_finalizar
+ *
+ * As verificações de código repetido, de existência e de empréstimo aberto são feitas
+ * nessas tabelas em memória; os índices em disco só são montados em carga_finalizar.
+ */
+typedef struct {
+	ARQUIVO_CARGA livros;
+	ARQUIVO_CARGA usuarios;
+	ARQUIVO_CARGA emprestimos;
+	AREA_TEXTOS textos_livros;
+	char caminho_livro[TAM_MAX_CAMINHO];
+	char caminho_usuario[TAM_MAX_CAMINHO];
+	char caminho_emprestimo[TAM_MAX_CAMINHO];
+	TABELA_HASH* indice_livros;
+	int* posicoes_livros;
+	int* exemplares_livros;
+	int* emprestimos_livros;
+	unsigned char* livros_alterados;
+	int num_livros;
+	int capacidade_livros;
+	TABELA_HASH* indice_usuarios;
+	TABELA_HASH* emprestimos_abertos;
+	TABELA_HASH* emprestimos_usuarios;
+	int devolucoes;
+} CARGA_LOTE;
+
+/*
+ * carga_iniciar - abre os arquivos de dados e carrega as tabelas em memória para uma carga em lote
+ *
+ * @carga - estrutura a ser inicializada
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ * @caminho_arquivo_livro - caminho completo para o arquivo binário de livros
+ * @caminho_arquivo_usuario - caminho completo para o arquivo binário de usuários
+ *
+ * Cada arquivo é lido uma única vez, sequencialmente, para montar as tabelas de livros,
+ * usuários e empréstimos abertos já existentes.
+ *
+ * Pré-condições:
+ *	- Os arquivos devem existir e estar inicializados com cabeçalhos válidos.
+ * Pós-condições:
+ *	- Em caso de sucesso, a carga deve ser encerrada com carga_finalizar.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valores negativos em caso de erro (nada precisa ser liberado pelo chamador):
+ *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível abrir algum arquivo.
+ *		- ERRO_LER_CABECALHO (-11): não foi possível ler o cabeçalho de algum arquivo.
+ *		- ERRO_ARQUIVO_SEEK (-1) / ERRO_ARQUIVO_READ (-3): falha na leitura dos registros.
+ *		- ERRO_ALOCAR_MEMORIA (-30): memória insuficiente para as tabelas.
+ */
+int carga_iniciar(
+	CARGA_LOTE* carga,
+	const char* caminho_arquivo_emprestimo,
+	const char* caminho_arquivo_livro,
+	const char* caminho_arquivo_usuario
+);
+
+/*
+ * carga_cadastrar_livro - equivalente de cadastrar_livro dentro de uma carga em lote
+ *
+ * @carga - carga iniciada por carga_iniciar
+ * @livro - livro a ser cadastrado
+ *
+ * Pós-condições:
+ *	- Os textos do livro são acrescentados à área de textos e o registro é inserido no início
+ *	da lista (reaproveitando posições livres, se houver).
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna ERRO_CONFLITO_ID (-23) se o código já estiver em uso.
+ *	- Retorna outro código negativo em caso de falha de E/S ou de memória.
+ */
+int carga_cadastrar_livro(CARGA_LOTE* carga, LIVRO livro);
+
+/*
+ * carga_cadastrar_usuario - equivalente de cadastrar_usuario dentro de uma carga em lote
+ *
+ * @carga - carga iniciada por carga_iniciar
+ * @usuario - usuário a ser cadastrado
+ *
+ * Pós-condições:
+ *	- O usuário é inserido no início da lista (reaproveitando posições livres, se houver).
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna ERRO_CONFLITO_ID (-23) se o código já estiver em uso.
+ *	- Retorna outro código negativo em caso de falha de E/S ou de memória.
+ */
+int carga_cadastrar_usuario(CARGA_LOTE* carga, USUARIO usuario);
+
+/*
+ * carga_emprestar_livro - equivalente de emprestar_livro dentro de uma carga em lote
+ *
+ * @carga - carga iniciada por carga_iniciar
+ * @codigo_usuario - código do usuário
+ * @codigo_livro - código do livro
+ * @data_emprestimo - data do empréstimo, em número de dias (ver converter_data)
+ *
+ * Pós-condições:
+ *	- O empréstimo é inserido no início da lista e das listas de empréstimos do usuário e do livro,
+ *	e a quantidade de exemplares do livro é decrementada.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valores negativos em caso de erro, na mesma ordem de verificação de emprestar_livro:
+ *		- ERRO_CONFLITO_ID (-23): já existe empréstimo aberto para o par.
+ *		- ERRO_ENCONTRAR_USUARIO (-16) / ERRO_ENCONTRAR_LIVRO (-15): código inexistente.
+ *		- ERRO_LIVROS_ESGOTADOS (-17): não há exemplares disponíveis.
+ *		- Outro código negativo em caso de falha de E/S ou de memória.
+ */
+int carga_emprestar_livro(CARGA_LOTE* carga, unsigned int codigo_usuario, unsigned int codigo_livro, int data_emprestimo);
+
+/*
+ * carga_devolver_livro - equivalente de devolver_livro dentro de uma carga em lote
+ *
+ * @carga - carga iniciada por carga_iniciar
+ * @codigo_usuario - código do usuário
+ * @codigo_livro - código do livro
+ * @data_devolucao - data da devolução, em número de dias (ver converter_data)
+ *
+ * Pós-condições:
+ *	- A data de devolução é registrada e a quantidade de exemplares do livro é incrementada.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna ERRO_ENCONTRAR_EMPRESTIMO (-20) ou ERRO_ENCONTRAR_LIVRO (-15) se não houver o que devolver.
+ *	- Retorna outro código negativo em caso de falha de E/S.
+ */
+int carga_devolver_livro(CARGA_LOTE* carga, unsigned int codigo_usuario, unsigned int codigo_livro, int data_devolucao);
+
+/*
+ * carga_finalizar - grava tudo o que ficou pendente e encerra a carga em lote
+ *
+ * @carga - carga iniciada por carga_iniciar
+ *
+ * Grava os textos e os blocos pendentes, as quantidades de exemplares e os inícios das listas de
+ * empréstimos dos livros e usuários alterados e cada cabeçalho uma única vez. Depois monta os índices (livro.idx, usuario.idx, emprestimo.idx) de uma só vez
+ * a partir das tabelas em memória.
+ *
+ * Pós-condições:
+ *	- Os arquivos são fechados e a memória da carga é liberada, mesmo em caso de erro.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna o primeiro erro de gravação encontrado, caso contrário.
+ */
+int carga_finalizar(CARGA_LOTE* carga);
+
+#endif // CARGA_H
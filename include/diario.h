@@ -0,0 +1,363 @@
+#ifndef DIARIO_H
+#define DIARIO_H
+
+#include <stddef.h>
+
+/*
+ * Diário de gravações (write-ahead log) dos arquivos de lista de uma base aberta por biblioteca_abrir.
+ *
+ * Cada operação lógica (cadastro, empréstimo, devolução) grava vários registros e cabeçalhos em
+ * arquivos diferentes. Com o diário aberto, essas gravações não vão direto aos arquivos: ficam em
+ * memória (as leituras as enxergam por cima do conteúdo dos arquivos) até a operação ser confirmada
+ * ou desfeita. Na confirmação, a operação inteira é acrescentada a NOME_ARQUIVO_DIARIO como um único
+ * registro com soma de verificação.
+ *
+ * Confirmação em grupo: o fsync do diário não é feito a cada operação. As operações confirmadas se
+ * acumulam até DIARIO_OPERACOES_POR_GRUPO (ou DIARIO_LIMITE_MEMORIA bytes pendentes) e um único
+ * fsync torna o grupo inteiro durável; só então as gravações do grupo são aplicadas aos arquivos
+ * (cache de páginas ou mapeamento). Assim nenhum arquivo de lista recebe bytes que não estejam
+ * no diário em disco. Uma queda de energia pode perder as operações do último grupo, mas nunca
+ * deixa uma operação pela metade; uma queda só do processo não perde nada, pois cada registro
+ * já foi entregue ao sistema operacional na confirmação.
+ *
+ * Operações aninhadas: uma operação iniciada dentro de outra (ex.: um empréstimo dentro de uma
+ * transação de biblioteca.h) é um ponto de retorno. Confirmá-la só a junta à de fora; desfazê-la
+ * descarta apenas as suas gravações. Só a confirmação do nível mais externo vai ao diário, e nela
+ * as gravações sobrepostas ou contíguas do mesmo arquivo são fundidas em uma só, com o conteúdo
+ * final da região: um cabeçalho regravado por várias operações é registrado e aplicado uma vez.
+ *
+ * Checkpoint: quando o diário passa de DIARIO_TAMANHO_CHECKPOINT bytes, ao fechar a base e antes de
+ * alterações por stdio (carga em lote), as páginas são gravadas, os arquivos de lista recebem fsync
+ * e o diário é esvaziado (fica só o cabeçalho). O de tamanho é feito por biblioteca_destravar, depois que
+ * a operação atualizou os índices.
+ *
+ * Vários processos (DIARIO_COMPARTILHADO): todos os processos com a base aberta acrescentam
+ * registros ao mesmo diário. Como os outros processos leem os arquivos de lista, não há
+ * confirmação em grupo: cada operação recebe o seu fsync e é aplicada aos arquivos na
+ * confirmação, com os arquivos travados pelo chamador (biblioteca.h). O cabeçalho do diário guarda,
+ * para cada arquivo, uma geração incrementada a cada operação aplicada (quem a encontra mudada
+ * descarta o que guarda do arquivo; as gerações são zeradas pelo primeiro processo a abrir a base,
+ * então só valem enquanto ela está aberta) e a marca do registro em aplicação, que permite a outro processo
+ * terminar a aplicação de um processo que parou no meio dela (diario_reparar). O diário é
+ * esvaziado pelo último processo a fechar a base.
+ *
+ * Recuperação: um diário com registros depois do cabeçalho quando nenhum processo está com a base
+ * aberta indica que a execução anterior foi interrompida. inicializar_base_de_dados reaplica os
+ * registros íntegros em ordem (as gravações são imagens completas dos bytes, então reaplicar é
+ * seguro) e os índices, que não passam pelo diário, são reconstruídos. Como o diário só é esvaziado
+ * entre operações, uma operação confirmada que parou antes de atualizar os índices sempre está nele.
+ *
+ * As colunas de texto dos livros (livro.col e livro.str) e os índices não passam pelo diário.
+ * Não é seguro para uso por várias threads ao mesmo tempo.
+ */
+
+#define NOME_ARQUIVO_DIARIO	"diario.log"
+#define ASSINATURA_DIARIO	0x32414944	// "DIA2"
+#define ASSINATURA_DIARIO_V1	0x31414944	// "DIA1": sem as entradas dos arquivos, só lido pela recuperação
+
+// modos de abertura do diário
+#define DIARIO_EXCLUSIVO	0	// um único processo usa a base
+#define DIARIO_COMPARTILHADO	1	// vários processos usam a base ao mesmo tempo
+
+// situação de um arquivo acompanhado (diario_situacao)
+#define DIARIO_ARQUIVO_ALTERADO		1	// outro processo aplicou operações desde a última consulta
+#define DIARIO_APLICACAO_INTERROMPIDA	2	// um processo parou no meio da aplicação de um registro
+
+// operações confirmadas que compartilham um fsync do diário
+#ifndef DIARIO_OPERACOES_POR_GRUPO
+#define DIARIO_OPERACOES_POR_GRUPO	64
+#endif
+
+// bytes de gravações pendentes que antecipam o fim do grupo
+#ifndef DIARIO_LIMITE_MEMORIA
+#define DIARIO_LIMITE_MEMORIA	(256L * 1024)
+#endif
+
+// tamanho do diário a partir do qual é feito um checkpoint
+#ifndef DIARIO_TAMANHO_CHECKPOINT
+#define DIARIO_TAMANHO_CHECKPOINT	(4L * 1024 * 1024)
+#endif
+
+// níveis de operações aninhadas (uma transação com as suas operações usa dois)
+#define MAX_OPERACOES_ANINHADAS	8
+
+#define MAX_ARQUIVOS_DIARIO	8
+#define TAM_NOME_ARQUIVO_DIARIO	32
+
+/*
+ * GRUPO_DIARIO - grupo de operações confirmadas separado por diario_separar_grupo
+ *
+ * @descritor - descritor do diário para o fsync (-1 se não havia operações a sincronizar)
+ * @gravacoes / @operacoes - gravações pendentes e operações que formam o grupo
+ * @aplicados - grupos aplicados até a separação
+ */
+typedef struct {
+	int descritor;
+	int gravacoes;
+	int operacoes;
+	unsigned long aplicados;
+} GRUPO_DIARIO;
+
+/*
+ * diario_abrir - abre (ou cria) o diário de um diretório e registra este processo como usuário da base
+ *
+ * @caminho_diretorio - diretório da base (mesmo formato de inicializar_base_de_dados)
+ * @nomes - nomes dos arquivos de lista dentro do diretório (ex.: "livro.dat")
+ * @quantidade - quantidade de nomes (até MAX_ARQUIVOS_DIARIO)
+ * @modo - DIARIO_EXCLUSIVO ou DIARIO_COMPARTILHADO
+ * @sozinho - recebe 1 se nenhum outro processo está com a base aberta
+ *
+ * Espera outro processo terminar de abrir ou de fechar a base. As gravações só passam pelo diário
+ * depois de diario_preparar; antes dela, com sozinho igual a 1, o chamador deve inicializar a base
+ * (inicializar_base_de_dados recupera o diário de uma execução interrompida).
+ *
+ * Pré-condições:
+ *	- Nenhum outro diário deve estar aberto.
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_TRAVA_OCUPADA (-34) se a base estiver aberta por outro processo
+ *	em modo exclusivo (ou, em modo exclusivo, por qualquer outro processo), ERRO_TRAVAR_ARQUIVO (-33)
+ *	ou ERRO_ABRIR_ARQUIVO (-10) (nesse caso as gravações continuam indo direto aos arquivos).
+ */
+int diario_abrir(const char* caminho_diretorio, const char* const nomes[], int quantidade, int modo, int* sozinho);
+
+/*
+ * diario_preparar - passa a acompanhar as gravações dos arquivos informados em diario_abrir
+ *
+ * Sozinho, o processo grava um diário vazio com a lista de arquivos; caso contrário, confere a
+ * lista do diário preparado pelo primeiro processo. Libera a abertura da base para outros processos.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_WRITE (-2) ou ERRO_ABRIR_ARQUIVO (-10) se a lista não
+ *	conferir; em caso de erro o diário é fechado.
+ */
+int diario_preparar(void);
+
+/*
+ * diario_fechar - faz o checkpoint final e fecha o diário
+ *
+ * Em modo compartilhado, o checkpoint só é feito pelo último processo a fechar a base.
+ *
+ * Pós-condições:
+ *	- Uma operação em andamento é desfeita; as confirmadas são aplicadas e gravadas nos arquivos.
+ *	- Retorna SUCESSO (0) ou o primeiro erro encontrado; em caso de erro os registros ficam no
+ *	diário e são reaplicados na próxima inicialização.
+ */
+int diario_fechar(void);
+
+/*
+ * diario_aberto - indica se há um diário aberto
+ */
+int diario_aberto(void);
+
+/*
+ * diario_arquivo - identificador de um caminho entre os arquivos acompanhados
+ *
+ * Pós-condições:
+ *	- Retorna o identificador (>= 0) ou -1 se não houver diário aberto ou o caminho não for acompanhado.
+ */
+int diario_arquivo(const char* caminho);
+
+/*
+ * diario_situacao - consulta, em modo compartilhado, o que outros processos fizeram com um arquivo
+ *
+ * @arquivo - identificador retornado por diario_arquivo
+ *
+ * Pré-condições:
+ *	- O chamador deve ter o arquivo travado (biblioteca.h), para que a situação não mude depois da consulta.
+ * Pós-condições:
+ *	- Retorna uma combinação de DIARIO_ARQUIVO_ALTERADO (só uma vez por alteração) e
+ *	DIARIO_APLICACAO_INTERROMPIDA; 0 em modo exclusivo ou sem diário.
+ */
+int diario_situacao(int arquivo);
+
+/*
+ * diario_reparar - termina a aplicação de um registro interrompida por outro processo
+ *
+ * @arquivo - identificador de um arquivo com DIARIO_APLICACAO_INTERROMPIDA
+ *
+ * Se o registro marcado está íntegro no diário, as suas gravações no arquivo são refeitas; se não,
+ * a operação não chegou a ser confirmada e a região reservada a ela é anulada. Nos dois casos a
+ * marca é retirada por diario_concluir_aplicacao.
+ *
+ * Pré-condições:
+ *	- O chamador deve ter o arquivo travado para escrita.
+ * Pós-condições:
+ *	- Retorna 1 se as gravações foram refeitas (os índices do arquivo devem ser reconstruídos),
+ *	0 se não havia nada a refazer, ou valores negativos em caso de erro.
+ */
+int diario_reparar(int arquivo);
+
+/*
+ * diario_concluir_aplicacao - publica aos outros processos as operações aplicadas por este
+ *
+ * Incrementa a geração dos arquivos alterados desde a última chamada e retira as suas marcas de
+ * aplicação. Deve ser chamada antes de liberar as travas dos arquivos. Em modo exclusivo, não tem efeito.
+ */
+void diario_concluir_aplicacao(void);
+
+/*
+ * diario_registrar_alteracao - inclui arquivos alterados fora do diário na próxima diario_concluir_aplicacao
+ *
+ * @arquivos - máscara com o bit (1 << identificador) de cada arquivo (ex.: carga em lote)
+ */
+void diario_registrar_alteracao(unsigned int arquivos);
+
+/*
+ * diario_checkpoint_pendente - indica que o diário passou de DIARIO_TAMANHO_CHECKPOINT e deve
+ * receber diario_checkpoint quando a operação terminar (em modo compartilhado, com todos os arquivos travados)
+ *
+ * Em modo exclusivo, a aplicação de um grupo não faz o checkpoint por conta própria: ela pode
+ * acontecer na confirmação de uma operação que ainda vai atualizar os índices, e o diário esvaziado
+ * nesse ponto não levaria a recuperação a reconstruí-los.
+ */
+int diario_checkpoint_pendente(void);
+
+/*
+ * diario_iniciar_operacao - marca o início de uma operação lógica, possivelmente dentro de outra
+ *
+ * Sem diário aberto, não tem efeito. Gravações feitas fora de uma operação são confirmadas uma a uma.
+ * Em modo compartilhado, o chamador deve ter travado os arquivos que a operação altera.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou ERRO_TRANSACAO (-32) se já houver MAX_OPERACOES_ANINHADAS
+ *	níveis abertos (nada é iniciado).
+ */
+int diario_iniciar_operacao(void);
+
+/*
+ * diario_confirmar_operacao - confirma a operação em andamento
+ *
+ * Dentro de outra operação, as gravações apenas passam a pertencer a ela.
+ *
+ * Pós-condições:
+ *	- A operação é acrescentada ao diário e passa a fazer parte do grupo atual; o grupo é
+ *	sincronizado se atingir DIARIO_OPERACOES_POR_GRUPO ou DIARIO_LIMITE_MEMORIA. Em modo
+ *	compartilhado, a operação é sincronizada e aplicada aos arquivos imediatamente.
+ *	- Retorna SUCESSO (0), também sem diário aberto ou sem operação em andamento.
+ *	- Retorna ERRO_ARQUIVO_WRITE (-2) se o diário não puder ser gravado; a operação é desfeita.
+ */
+int diario_confirmar_operacao(void);
+
+/*
+ * diario_desfazer_operacao - descarta as gravações da operação em andamento
+ *
+ * Sem operação em andamento (ou depois de diario_confirmar_operacao), não tem efeito. Em uma
+ * operação aninhada, as gravações feitas antes dela pela operação de fora continuam pendentes.
+ */
+void diario_desfazer_operacao(void);
+
+/*
+ * diario_arquivos_alterados - arquivos com gravações na operação mais externa em andamento
+ *
+ * Pós-condições:
+ *	- Retorna uma máscara com o bit (1 << identificador) de cada arquivo alterado; 0 sem operação.
+ */
+unsigned int diario_arquivos_alterados(void);
+
+/*
+ * diario_sincronizar - encerra o grupo atual: um fsync do diário e aplicação das gravações confirmadas
+ *
+ * Chamada também por descarregar_caminho_dados, para que leituras por stdio enxerguem as operações
+ * confirmadas. As gravações de uma operação em andamento continuam pendentes.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_WRITE (-2) se o fsync falhar (nada é aplicado) ou o erro
+ *	da aplicação de alguma gravação.
+ */
+int diario_sincronizar(void);
+
+/*
+ * diario_separar_grupo - encerra o grupo atual como diario_sincronizar, mas deixa o fsync para depois
+ *
+ * @grupo - recebe o grupo separado
+ *
+ * Para um processo com várias threads: separação e aplicação são feitas com o diário reservado à
+ * thread, e diario_gravar_grupo (o fsync), sem reserva, enquanto outras threads confirmam operações
+ * em um novo grupo e leem as gravações pendentes. Se o grupo for aplicado antes, por diario_sincronizar
+ * ou pela aplicação de um grupo separado depois, diario_aplicar_grupo não tem efeito.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou ERRO_ARQUIVO_WRITE (-2) se os registros não puderem ser enviados ao sistema.
+ */
+int diario_separar_grupo(GRUPO_DIARIO* grupo);
+
+/*
+ * diario_gravar_grupo - faz o fsync do diário que torna duráveis as operações de um grupo separado
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou ERRO_ARQUIVO_WRITE (-2).
+ */
+int diario_gravar_grupo(const GRUPO_DIARIO* grupo);
+
+/*
+ * diario_aplicar_grupo - aplica aos arquivos as gravações de um grupo separado, depois de diario_gravar_grupo
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou o erro da aplicação de alguma gravação (as gravações continuam pendentes).
+ */
+int diario_aplicar_grupo(const GRUPO_DIARIO* grupo);
+
+/*
+ * diario_checkpoint - sincroniza o grupo, grava os arquivos acompanhados no disco e esvazia o diário
+ *
+ * Deve ser chamada antes de alterar os arquivos acompanhados por stdio, para que uma recuperação
+ * não reaplique gravações antigas por cima das novas. Em modo compartilhado, o chamador deve ter
+ * todos os arquivos travados para escrita; com uma aplicação interrompida, o diário não é esvaziado.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou o primeiro erro encontrado (o diário só é esvaziado em caso de sucesso).
+ */
+int diario_checkpoint(void);
+
+/*
+ * diario_anotar - registra uma gravação em um arquivo acompanhado
+ *
+ * @arquivo - identificador retornado por diario_arquivo
+ * @deslocamento - posição do primeiro byte no arquivo
+ * @tamanho - quantidade de bytes
+ * @origem - bytes gravados (copiados)
+ *
+ * Usada pela camada de armazenamento no lugar da gravação direta.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) para deslocamentos negativos ou
+ *	ERRO_ALOCAR_MEMORIA (-30) se não houver memória para a gravação.
+ */
+int diario_anotar(int arquivo, long deslocamento, size_t tamanho, const void* origem);
+
+/*
+ * diario_pendente - indica se alguma gravação pendente alcança a região informada
+ */
+int diario_pendente(int arquivo, long deslocamento, size_t tamanho);
+
+/*
+ * diario_sobrepor - copia para destino os bytes pendentes que alcançam a região informada
+ *
+ * @destino - conteúdo da região lido do arquivo (ou zerado, se a região passa do fim dele)
+ *
+ * Pós-condições:
+ *	- As gravações são aplicadas na ordem em que foram feitas.
+ *	- Retorna 1 se alguma gravação pendente cobre a região inteira, 0 caso contrário.
+ */
+int diario_sobrepor(int arquivo, long deslocamento, size_t tamanho, void* destino);
+
+/*
+ * diario_recuperar - reaplica o diário deixado por uma execução interrompida
+ *
+ * @caminho_diretorio - diretório da base, terminado pelo separador
+ * @interrompida - recebe 1 se havia registros no diário (os índices devem ser reconstruídos) e 0 caso contrário
+ *
+ * Os registros são lidos até o fim do diário ou até o primeiro incompleto ou com soma de
+ * verificação errada (operação que não chegou a ser confirmada em disco) que não tenha os seus
+ * bytes reservados por uma marca de aplicação.
+ *
+ * Pré-condições:
+ *	- Nenhum outro processo pode estar com a base aberta (diario_abrir informou sozinho).
+ * Pós-condições:
+ *	- As gravações dos registros íntegros são feitas nos arquivos, que recebem fsync; o diário é esvaziado.
+ *	- Retorna SUCESSO (0) ou ERRO_ABRIR_ARQUIVO (-10) / ERRO_ARQUIVO_WRITE (-2) se a
+ *	reaplicação falhar (o diário é mantido).
+ */
+int diario_recuperar(const char* caminho_diretorio, int* interrompida);
+
+#endif // DIARIO_H
@@ -1,29 +1,196 @@
 #ifndef EMPRESTIMO_H
 #define EMPRESTIMO_H
 
+#include <stdio.h>
+
+#include "biblioteca.h"
+
 #define MAX_DATA 10
 
+// índice de datas (emprestimo_data.idx): árvore B+ com chave tipo de data + data + posição
+#define EXTENSAO_INDICE_DATAS	"_data.idx"
+#define TAM_CHAVE_DATA		9
+
+// datas consultadas por listar_emprestimos_periodo
+#define PERIODO_EMPRESTIMO	0
+#define PERIODO_DEVOLUCAO	1
+
 /*
  * EMPRESTIMO - struct que armazena informações do nó de empréstimo
  *
  * @codigo_usuario - identificador único do usuário
  * @codigo_livro - identificador único do livro
- * @data_emprestimo - data que livro foi emprestado (no formato DD/MM/AAAA)
- * @data_devolucao - data que livro foi devolvido (no formato DD/MM/AAAA)
- * @proximo - inteiro que indica posicao do próximo nó de empréstimo
+ * @data_emprestimo - data que livro foi emprestado, em número de dias (ver converter_data)
+ * @data_devolucao - data que livro foi devolvido, em número de dias (DATA_NULA se não foi devolvido)
+ * @proximo - inteiro que indica posicao do próximo nó da mesma lista (abertos ou devolvidos)
+ * @proximo_usuario - posição do empréstimo anterior do mesmo usuário (-1 no primeiro)
+ * @proximo_livro - posição do empréstimo anterior do mesmo livro (-1 no primeiro)
  *
  * A estrutura armazena informações para o empréstimo de um livro para um 
- * usuário. Todos os campos são obrigatórios, exceto 'data_devolucao'. Ele pode
- * assumir valor nulo, através da atribuição do caractere '\0' ao índice 0.
+ * usuário. Todos os campos são obrigatórios, exceto 'data_devolucao', que
+ * vale DATA_NULA enquanto o empréstimo está aberto. Empréstimos abertos ficam na lista
+ * iniciada em pos_cabeca; a devolução move o registro para a lista iniciada em pos_devolvidos.
+ *
+ * Além disso, os empréstimos de cada usuário, abertos ou devolvidos, formam uma lista própria,
+ * do último registrado para o primeiro, iniciada em USUARIO.primeiro_emprestimo e encadeada por
+ * proximo_usuario. Da mesma forma, os empréstimos de cada livro formam uma lista iniciada em
+ * REGISTRO_LIVRO.primeiro_emprestimo e encadeada por proximo_livro. A devolução não altera
+ * nenhuma das duas.
  */
 typedef struct {
 	unsigned int codigo_usuario;
 	unsigned int codigo_livro;
-	char data_emprestimo[MAX_DATA + 1];
-	char data_devolucao[MAX_DATA + 1];
+	int data_emprestimo;
+	int data_devolucao;
 	int proximo;
+	int proximo_usuario;
+	int proximo_livro;
 } EMPRESTIMO;
 
+/*
+ * chave_emprestimo - monta a chave composta do índice de empréstimos abertos
+ *
+ * @codigo_usuario - código do usuário do empréstimo
+ * @codigo_livro - código do livro do empréstimo
+ *
+ * Pós-condições:
+ *	- Retorna um inteiro de 64 bits com o código do usuário nos 32 bits altos e o do livro nos 32 bits baixos.
+ */
+unsigned long long chave_emprestimo(unsigned int codigo_usuario, unsigned int codigo_livro);
+
+/*
+ * contabilizar_emprestimo - conta um EMPRESTIMO sem devolução no cabeçalho (ver recalcular_contadores)
+ *
+ * @registro - EMPRESTIMO ativo
+ * @posicao - posição do registro (não usada)
+ * @contexto - CABECALHO de emprestimo.dat
+ *
+ * Pós-condições:
+ *	- emprestimos_abertos é incrementado se o empréstimo não tiver data de devolução; retorna SUCESSO (0).
+ */
+int contabilizar_emprestimo(const void* registro, int posicao, void* contexto);
+
+/*
+ * reconstruir_indice_emprestimo - recria o índice de empréstimos abertos (emprestimo.idx) percorrendo a lista
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ *
+ * O índice é uma tabela hash cuja chave composta reúne os códigos do usuário e do livro;
+ * apenas empréstimos sem data de devolução são indexados.
+ *
+ * Pré-condições:
+ *	- O arquivo deve existir e estar inicializado com um cabeçalho válido.
+ * Pós-condições:
+ *	- O arquivo de índice é recriado contendo apenas os empréstimos sem data de devolução.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna código de erro negativo em caso de falha.
+ */
+int reconstruir_indice_emprestimo(const char* caminho_arquivo_emprestimo);
+
+/*
+ * reconstruir_indice_datas_emprestimo - recria o índice de datas (emprestimo_data.idx) percorrendo a lista
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ *
+ * O índice é uma árvore B+ cuja chave tem TAM_CHAVE_DATA bytes: o tipo da data (PERIODO_EMPRESTIMO
+ * ou PERIODO_DEVOLUCAO), a data e a posição do empréstimo, as duas em big-endian. Cada empréstimo
+ * tem uma chave com a data do empréstimo e, se já foi devolvido, outra com a data da devolução.
+ *
+ * Pré-condições:
+ *	- O arquivo deve existir e estar inicializado com um cabeçalho válido.
+ * Pós-condições:
+ *	- O arquivo de índice é recriado com as datas de todos os empréstimos da lista.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna código de erro negativo em caso de falha.
+ */
+int reconstruir_indice_datas_emprestimo(const char* caminho_arquivo_emprestimo);
+
+/*
+ * converter_emprestimos_formato_antigo - converte um emprestimo.dat de versão anterior para o formato atual
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ *
+ * Arquivos com cabeçalho anterior a VERSAO_DATAS_NUMERICAS (inclusive CABECALHO_VERSAO_0) guardam
+ * as datas como texto DD/MM/AAAA de 11 bytes; os registros são convertidos para EMPRESTIMO nas
+ * mesmas posições (a lista de livres e emprestimo.idx continuam válidos). Uma data de devolução
+ * preenchida mas inválida vira DATA_DESCONHECIDA, para que o empréstimo continue devolvido.
+ * Arquivos anteriores a VERSAO_LISTA_DEVOLVIDOS têm uma única lista, que é separada nas listas de
+ * empréstimos abertos e devolvidos, mantendo a ordem. Registros anteriores a VERSAO_EMPRESTIMOS_USUARIO
+ * recebem proximo_usuario = -1, e os anteriores a VERSAO_EMPRESTIMOS_LIVRO, proximo_livro = -1; os
+ * encadeamentos são montados depois, por reconstruir_emprestimos_usuarios e
+ * reconstruir_emprestimos_livros. O arquivo recebe o cabeçalho atual, com os contadores calculados.
+ *
+ * Pós-condições:
+ *	- Arquivos já no formato atual não são alterados.
+ *	- Retorna SUCESSO (0), ERRO_VERSAO_CABECALHO (-31) se o arquivo for de uma versão mais nova,
+ *	ou outro código de erro negativo; em caso de erro o arquivo original não é alterado.
+ */
+int converter_emprestimos_formato_antigo(const char* caminho_arquivo_emprestimo);
+
+/*
+ * reconstruir_emprestimos_usuarios - refaz as listas de empréstimos de cada usuário
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ * @caminho_arquivo_usuario - caminho completo para o arquivo binário de usuários
+ *
+ * Os dois arquivos são lidos uma vez, sequencialmente; os empréstimos são ordenados pela data do
+ * empréstimo (e pela posição, nas datas iguais) e encadeados da data mais recente para a mais antiga.
+ * Usada na conversão de bases anteriores a VERSAO_EMPRESTIMOS_USUARIO; durante o uso normal as
+ * listas são mantidas pelos empréstimos.
+ *
+ * Pré-condições:
+ *	- Os arquivos devem estar no formato atual.
+ * Pós-condições:
+ *	- USUARIO.primeiro_emprestimo e EMPRESTIMO.proximo_usuario são regravados em todos os registros;
+ *	empréstimos de usuários inexistentes ficam fora de qualquer lista.
+ *	- Retorna SUCESSO (0) ou um código de erro negativo.
+ */
+int reconstruir_emprestimos_usuarios(const char* caminho_arquivo_emprestimo, const char* caminho_arquivo_usuario);
+
+/*
+ * reconstruir_emprestimos_livros - refaz as listas de empréstimos de cada livro
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ * @caminho_arquivo_livro - caminho completo para o arquivo binário de livros
+ *
+ * Equivalente a reconstruir_emprestimos_usuarios para REGISTRO_LIVRO.primeiro_emprestimo e
+ * EMPRESTIMO.proximo_livro; usada na conversão de bases anteriores a VERSAO_EMPRESTIMOS_LIVRO.
+ *
+ * Pré-condições:
+ *	- Os arquivos devem estar no formato atual.
+ * Pós-condições:
+ *	- REGISTRO_LIVRO.primeiro_emprestimo e EMPRESTIMO.proximo_livro são regravados em todos os
+ *	registros; empréstimos de livros inexistentes ficam fora de qualquer lista.
+ *	- Retorna SUCESSO (0) ou um código de erro negativo.
+ */
+int reconstruir_emprestimos_livros(const char* caminho_arquivo_emprestimo, const char* caminho_arquivo_livro);
+
+/*
+ * localizar_emprestimo_aberto - busca o empréstimo sem devolução de um par (usuário, livro) pelo índice emprestimo.idx
+ *
+ * @emprestimos - arquivo de empréstimos da biblioteca, que mantém o índice aberto (biblioteca_indice_hash)
+ * @codigo_usuario - código do usuário do empréstimo
+ * @codigo_livro - código do livro do empréstimo
+ * @emprestimo - ponteiro onde o registro encontrado será armazenado
+ * @posicao - ponteiro onde a posição do registro no arquivo será armazenada
+ *
+ * Pré-condições:
+ *	- O arquivo deve estar aberto e inicializado com um cabeçalho válido.
+ * Pós-condições:
+ *	- Se o índice não existir ou estiver desatualizado, ele é reconstruído a partir da lista.
+ *	- Em caso de sucesso, *emprestimo e *posicao recebem o registro e sua posição.
+ *	- Retorna SUCESSO (0) se existir empréstimo aberto para o par informado.
+ *	- Retorna ERRO_ENCONTRAR_EMPRESTIMO (-20) caso não exista.
+ *	- Retorna outro código de erro negativo em caso de falha de leitura.
+ */
+int localizar_emprestimo_aberto(
+	ARQUIVO_BIBLIOTECA* emprestimos,
+	unsigned int codigo_usuario,
+	unsigned int codigo_livro,
+	EMPRESTIMO* emprestimo,
+	int* posicao
+);
+
 /*
  * emprestar_livro - função que registra um novo empréstimo
  *
@@ -39,10 +206,12 @@ typedef struct {
  *	- Arquivos de empréstimo e livro podem ser aberto em modo leitura e escrita.
  *	- Arquivo de usuário pode ser aberto em modo leitura.
  *	- Códigos de usuario e livro devem ser válidos.
- *	- Data do empréstimo deve estar no formato adequado (DD/MM/AAAA).
+ *	- Data do empréstimo em número de dias (converter_data ou obter_data_atual).
  * Pós-condições:
  *	- Um novo registro de empréstimo é registrado, reutilizando posições livres se existirem.
  *	- O cabeçalho do arquivo é atualizado para refletir a nova cabeça da lista encadeada e possíveis posições livres.
+ *	- O empréstimo passa a iniciar a lista de empréstimos do usuário (USUARIO.primeiro_emprestimo)
+ *	e a do livro (REGISTRO_LIVRO.primeiro_emprestimo).
  *	- A quantidade de exemplares do livro é decrementada em 1.
  *	- Retorna SUCESSO (0) em caso de sucesso na operação.
  *	- Retorna valores negativos em caso de erro:
@@ -64,7 +233,7 @@ int emprestar_livro(
 	const char* caminho_arquivo_usuario, 
 	const unsigned int codigo_usuario, 
 	const unsigned int codigo_livro,
-	const char* data_emprestimo
+	const int data_emprestimo
 );
 
 /*
@@ -81,7 +250,7 @@ int emprestar_livro(
  *	- Caminhos para os arquivos devem ser válidos.
  *	- Arquivos de empréstimo e livro podem ser abertos em modo leitura e escrita.
  *	- Códigos de usuario e livro devem ser válidos.
- *	- Data da devolução deve estar no formato adequado (DD/MM/AAAA).
+ *	- Data da devolução em número de dias (converter_data ou obter_data_atual).
  * Pós-condições:
  *	- A data de devolução é registrada no nó de empréstimo
  *	- A quantidade de exemplares do livro é incrementada em 1.
@@ -99,7 +268,7 @@ int devolver_livro(
 	const char* caminho_arquivo_livro,
 	const unsigned int codigo_usuario,
 	const unsigned int codigo_livro,
-	const char* data_devolucao
+	const int data_devolucao
 );
 
 /*
@@ -120,10 +289,185 @@ int devolver_livro(
  *		- Título do livro.
  *		- Data do empréstimo.
  *	- Caso não haja nenhum empréstimo, uma mensagem informando isso será exibida.
+ *	- Livros e usuários são lidos uma única vez por juntar_emprestimos_abertos (junção hash,
+ *	ou por ordenação externa quando as tabelas não cabem em LIMITE_MEMORIA_JUNCAO).
  */
 int listar_livros_emprestados(
 	const char* caminho_arquivo_emprestimo,
 	const char* caminho_arquivo_livro,
 	const char* caminho_arquivo_usuario
 );
+
+/*
+ * listar_emprestimos_periodo - exibe os empréstimos feitos ou devolvidos entre duas datas
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ * @periodo - PERIODO_EMPRESTIMO (data do empréstimo) ou PERIODO_DEVOLUCAO (data da devolução)
+ * @data_inicial - primeira data do período, em número de dias
+ * @data_final - última data do período, em número de dias
+ *
+ * A consulta desce a árvore de datas (emprestimo_data.idx) até a data inicial e segue as folhas
+ * até a final, lendo apenas os empréstimos do período.
+ *
+ * Pré-condições:
+ *	- O arquivo deve existir e estar inicializado com cabeçalho.
+ * Pós-condições:
+ *	- Para cada empréstimo do período, em ordem de data, são exibidos os códigos do usuário e do
+ *	livro e as datas de empréstimo e devolução.
+ *	- Caso não haja nenhum empréstimo no período, uma mensagem informando isso será exibida.
+ *	- Se o índice não existir ou não puder ser lido, ele é reconstruído a partir da lista.
+ *	- Retorna SUCESSO (0), ERRO_CAMPOS_INVALIDOS (-24) para período desconhecido ou outro
+ *	código de erro negativo.
+ */
+int listar_emprestimos_periodo(
+	const char* caminho_arquivo_emprestimo,
+	int periodo,
+	int data_inicial,
+	int data_final
+);
+
+/*
+ * percorrer_emprestimos_periodo - visita os empréstimos feitos ou devolvidos entre duas datas
+ *
+ * @biblioteca - base aberta com o arquivo de empréstimos
+ * @periodo - PERIODO_EMPRESTIMO ou PERIODO_DEVOLUCAO
+ * @data_inicial / @data_final - período, em número de dias (inclusive)
+ * @visitar - função chamada com cada EMPRESTIMO do período e sua posição, em ordem de data
+ * @contexto - ponteiro repassado para a função visitar
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou o primeiro erro encontrado (inclusive o retornado pela função visitar).
+ */
+int percorrer_emprestimos_periodo(
+	BIBLIOTECA* biblioteca,
+	int periodo,
+	int data_inicial,
+	int data_final,
+	visitante_registro visitar,
+	void* contexto
+);
+
+/*
+ * listar_emprestimos_usuario - exibe todos os empréstimos de um usuário, do último registrado ao primeiro
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ * @caminho_arquivo_usuario - caminho completo para o arquivo binário de usuários
+ * @codigo_usuario - código do usuário
+ *
+ * O usuário é localizado pela árvore B+ de usuários e a consulta segue a lista dos seus
+ * empréstimos (USUARIO.primeiro_emprestimo e EMPRESTIMO.proximo_usuario), lendo apenas eles.
+ *
+ * Pré-condições:
+ *	- Os arquivos devem existir e estar inicializados com cabeçalho.
+ * Pós-condições:
+ *	- Para cada empréstimo do usuário, aberto ou devolvido, são exibidos os códigos do usuário e
+ *	do livro e as datas de empréstimo e devolução.
+ *	- Caso o usuário não tenha empréstimos, uma mensagem informando isso será exibida.
+ *	- Retorna SUCESSO (0), ERRO_ENCONTRAR_USUARIO (-16) se o usuário não existir ou outro código
+ *	de erro negativo.
+ */
+int listar_emprestimos_usuario(
+	const char* caminho_arquivo_emprestimo,
+	const char* caminho_arquivo_usuario,
+	unsigned int codigo_usuario
+);
+
+/*
+ * percorrer_emprestimos_usuario - visita os empréstimos de um usuário, do último registrado ao primeiro
+ *
+ * @biblioteca - base aberta com os arquivos de empréstimos e de usuários
+ * @codigo_usuario - código do usuário
+ * @visitar - função chamada com cada EMPRESTIMO do usuário e sua posição
+ * @contexto - ponteiro repassado para a função visitar
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ENCONTRAR_USUARIO (-16), ERRO_LER_EMPRESTIMO (-19) se a lista
+ *	estiver corrompida ou o primeiro erro encontrado (inclusive o retornado pela função visitar).
+ */
+int percorrer_emprestimos_usuario(
+	BIBLIOTECA* biblioteca,
+	unsigned int codigo_usuario,
+	visitante_registro visitar,
+	void* contexto
+);
+
+/*
+ * listar_emprestimos_livro - exibe a circulação de um livro: quem está com ele e o histórico de devoluções
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ * @caminho_arquivo_livro - caminho completo para o arquivo binário de livros
+ * @codigo_livro - código do livro
+ *
+ * O livro é localizado pelo índice hash de livros e a consulta segue a lista dos seus
+ * empréstimos (REGISTRO_LIVRO.primeiro_emprestimo e EMPRESTIMO.proximo_livro), lendo apenas eles.
+ *
+ * Pré-condições:
+ *	- Os arquivos devem existir e estar inicializados com cabeçalho.
+ * Pós-condições:
+ *	- São exibidos primeiro os empréstimos em aberto (os usuários que estão com exemplares do
+ *	livro) e depois os devolvidos, cada grupo do último registrado ao primeiro, com os códigos do
+ *	usuário e do livro e as datas de empréstimo e devolução.
+ *	- Caso o livro não tenha empréstimos, uma mensagem informando isso será exibida.
+ *	- Retorna SUCESSO (0), ERRO_ENCONTRAR_LIVRO (-15) se o livro não existir ou outro código
+ *	de erro negativo.
+ */
+int listar_emprestimos_livro(
+	const char* caminho_arquivo_emprestimo,
+	const char* caminho_arquivo_livro,
+	unsigned int codigo_livro
+);
+
+/*
+ * percorrer_emprestimos_livro - visita os empréstimos de um livro, do último registrado ao primeiro
+ *
+ * @biblioteca - base aberta com os arquivos de empréstimos e de livros
+ * @codigo_livro - código do livro
+ * @visitar - função chamada com cada EMPRESTIMO do livro e sua posição; os que têm data_devolucao
+ * igual a DATA_NULA estão com o usuário
+ * @contexto - ponteiro repassado para a função visitar
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ENCONTRAR_LIVRO (-15), ERRO_LER_EMPRESTIMO (-19) se a lista
+ *	estiver corrompida ou o primeiro erro encontrado (inclusive o retornado pela função visitar).
+ */
+int percorrer_emprestimos_livro(
+	BIBLIOTECA* biblioteca,
+	unsigned int codigo_livro,
+	visitante_registro visitar,
+	void* contexto
+);
+
+/*
+ * Versões de emprestar_livro, devolver_livro, listar_livros_emprestados, listar_emprestimos_periodo,
+ * listar_emprestimos_usuario e listar_emprestimos_livro sobre uma BIBLIOTECA aberta (biblioteca_abrir)
+ *
+ * Mesmos parâmetros, saída e códigos de retorno, trocando os caminhos dos arquivos pela biblioteca.
+ * Usam os arquivos e cabeçalhos residentes; a listagem continua sendo feita pela junção, que lê
+ * os arquivos pelos caminhos guardados na biblioteca.
+ *
+ * Pré-condições:
+ *	- Os arquivos usados pela operação devem estar abertos na biblioteca.
+ * Pós-condições:
+ *	- As gravações são descarregadas antes de atualizar os índices, e o cabeçalho residente
+ *	de empréstimos só é alterado quando a gravação tem sucesso.
+ *	- Confirmada a operação, a falha em algum índice não é retornada: os índices de empréstimos
+ *	são reconstruídos a partir da lista.
+ */
+int biblioteca_emprestar_livro(
+	BIBLIOTECA* biblioteca,
+	const unsigned int codigo_usuario,
+	const unsigned int codigo_livro,
+	const int data_emprestimo
+);
+int biblioteca_devolver_livro(
+	BIBLIOTECA* biblioteca,
+	const unsigned int codigo_usuario,
+	const unsigned int codigo_livro,
+	const int data_devolucao
+);
+int biblioteca_listar_livros_emprestados(BIBLIOTECA* biblioteca);
+int biblioteca_listar_emprestimos_periodo(BIBLIOTECA* biblioteca, int periodo, int data_inicial, int data_final);
+int biblioteca_listar_emprestimos_usuario(BIBLIOTECA* biblioteca, unsigned int codigo_usuario);
+int biblioteca_listar_emprestimos_livro(BIBLIOTECA* biblioteca, unsigned int codigo_livro);
+
 #endif
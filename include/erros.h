@@ -26,7 +26,16 @@ typedef enum {
 	ERRO_CONFLITO_ID		= -23,
 	ERRO_CAMPOS_INVALIDOS		= -24,
 	ERRO_OBTER_DATA			= -25,
-	ERRO_DATA_INVALIDA		= -26
+	ERRO_DATA_INVALIDA		= -26,
+	ERRO_LER_INDICE			= -27,
+	ERRO_ESCREVER_INDICE		= -28,
+	ERRO_ENCONTRAR_CHAVE		= -29,
+	ERRO_ALOCAR_MEMORIA		= -30,
+	ERRO_VERSAO_CABECALHO		= -31,
+	ERRO_TRANSACAO			= -32,
+	ERRO_TRAVAR_ARQUIVO		= -33,
+	ERRO_TRAVA_OCUPADA		= -34,
+	ERRO_SOCKET			= -35
 } codigo_erro;
 
 #endif // _ERROS_H
@@ -0,0 +1,156 @@
+#ifndef INDICE_HASH_H
+#define INDICE_HASH_H
+
+#include <stdio.h>
+
+#define NUM_BALDES_INICIAL 1024
+
+#define BALDE_VAZIO    0
+#define BALDE_OCUPADO  1
+#define BALDE_REMOVIDO 2
+
+/*
+ * CABECALHO_INDICE_HASH - struct que armazena dados de controle do arquivo de índice hash
+ *
+ * @num_baldes    - quantidade de baldes da tabela (sempre potência de 2)
+ * @num_ocupados  - quantidade de baldes com uma chave válida
+ * @num_removidos - quantidade de baldes marcados como removidos (lápides)
+ */
+typedef struct {
+	int num_baldes;
+	int num_ocupados;
+	int num_removidos;
+} CABECALHO_INDICE_HASH;
+
+/*
+ * BALDE_INDICE_HASH - struct que armazena uma entrada da tabela hash em arquivo
+ *
+ * @chave   - chave indexada (ex.: código do livro)
+ * @posicao - posição do registro associado no arquivo de dados
+ * @estado  - BALDE_VAZIO, BALDE_OCUPADO ou BALDE_REMOVIDO
+ *
+ * A tabela utiliza endereçamento aberto com sondagem linear. Baldes removidos
+ * são mantidos como lápides para não interromper as sequências de sondagem.
+ */
+typedef struct {
+	unsigned long long chave;
+	int posicao;
+	int estado;
+} BALDE_INDICE_HASH;
+
+/*
+ * indice_hash_criar - cria (ou sobrescreve) um arquivo de índice hash vazio
+ *
+ * @caminho - caminho completo para o arquivo de índice
+ * @num_baldes - quantidade mínima de baldes (arredondada para potência de 2)
+ *
+ * Pré-condições:
+ *	- O diretório do caminho deve existir e possuir permissão de escrita.
+ * Pós-condições:
+ *	- O arquivo de índice é criado com todos os baldes vazios.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível criar o arquivo.
+ *		- ERRO_ESCREVER_INDICE (-28): não foi possível escrever a tabela.
+ */
+int indice_hash_criar(const char* caminho, int num_baldes);
+
+/*
+ * indice_hash_construir - cria um arquivo de índice hash já preenchido com um conjunto de chaves
+ *
+ * @caminho - caminho completo para o arquivo de índice
+ * @chaves - vetor com as chaves a serem indexadas
+ * @posicoes - vetor com as posições associadas a cada chave
+ * @quantidade - número de elementos dos vetores
+ *
+ * Essa função monta a tabela inteira em memória e grava o arquivo com uma única escrita
+ * sequencial, sendo bem mais rápida que chamar indice_hash_inserir para cada chave.
+ *
+ * Pré-condições:
+ *	- O diretório do caminho deve existir e possuir permissão de escrita.
+ * Pós-condições:
+ *	- O arquivo de índice é (re)criado contendo todas as chaves informadas.
+ *	- Em caso de chaves repetidas, prevalece a última posição informada.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível criar o arquivo.
+ *		- ERRO_ESCREVER_INDICE (-28): não foi possível escrever a tabela.
+ */
+int indice_hash_construir(const char* caminho, const unsigned long long* chaves, const int* posicoes, int quantidade);
+
+/*
+ * indice_hash_buscar - busca a posição associada a uma chave no índice
+ *
+ * @caminho - caminho completo para o arquivo de índice
+ * @chave - chave procurada
+ * @posicao - ponteiro onde a posição encontrada será armazenada
+ *
+ * Pré-condições:
+ *	- O arquivo de índice deve ter sido criado por indice_hash_criar.
+ * Pós-condições:
+ *	- Se a chave existir, *posicao recebe a posição associada.
+ *	- Retorna SUCESSO (0) se a chave foi encontrada.
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ENCONTRAR_CHAVE (-29): a chave não está no índice.
+ *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível abrir o índice.
+ *		- ERRO_LER_INDICE (-27): falha na leitura do índice.
+ */
+int indice_hash_buscar(const char* caminho, unsigned long long chave, int* posicao);
+
+/*
+ * indice_hash_inserir - insere (ou atualiza) uma chave no índice
+ *
+ * @caminho - caminho completo para o arquivo de índice
+ * @chave - chave a ser inserida
+ * @posicao - posição do registro associado à chave
+ *
+ * Pré-condições:
+ *	- O arquivo de índice deve ter sido criado por indice_hash_criar.
+ * Pós-condições:
+ *	- A chave passa a apontar para a posição informada.
+ *	- Caso a ocupação ultrapasse 75% dos baldes, a tabela é reconstruída com o dobro do tamanho.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível abrir o índice.
+ *		- ERRO_LER_INDICE (-27): falha na leitura do índice.
+ *		- ERRO_ESCREVER_INDICE (-28): falha na escrita do índice.
+ */
+int indice_hash_inserir(const char* caminho, unsigned long long chave, int posicao);
+
+/*
+ * indice_hash_remover - remove uma chave do índice
+ *
+ * @caminho - caminho completo para o arquivo de índice
+ * @chave - chave a ser removida
+ *
+ * Pré-condições:
+ *	- O arquivo de índice deve ter sido criado por indice_hash_criar.
+ * Pós-condições:
+ *	- O balde da chave é marcado como removido.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ENCONTRAR_CHAVE (-29): a chave não está no índice.
+ *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível abrir o índice.
+ *		- ERRO_LER_INDICE (-27): falha na leitura do índice.
+ *		- ERRO_ESCREVER_INDICE (-28): falha na escrita do índice.
+ */
+int indice_hash_remover(const char* caminho, unsigned long long chave);
+
+/*
+ * Versões de indice_hash_buscar, indice_hash_inserir e indice_hash_remover sobre um índice já aberto
+ *
+ * @arquivo - arquivo de índice aberto com abrir_arquivo_indice (armazenamento.h), "rb" para buscar,
+ * "r+b" para inserir e remover
+ *
+ * Mesmos demais parâmetros e códigos de retorno, exceto ERRO_ABRIR_ARQUIVO: o arquivo não é aberto
+ * nem fechado a cada chamada, e o cabeçalho e os baldes sondados são lidos do cache de páginas.
+ * Usadas pelas operações sobre uma BIBLIOTECA, que mantém o índice aberto.
+ *
+ * Pós-condições:
+ *	- Inserção e remoção gravam no arquivo as páginas alteradas antes de retornar.
+ */
+int indice_hash_buscar_arquivo(FILE* arquivo, unsigned long long chave, int* posicao);
+int indice_hash_inserir_arquivo(FILE* arquivo, unsigned long long chave, int posicao);
+int indice_hash_remover_arquivo(FILE* arquivo, unsigned long long chave);
+
+#endif // INDICE_HASH_H
@@ -0,0 +1,125 @@
+#ifndef INDICE_INVERTIDO_H
+#define INDICE_INVERTIDO_H
+
+#include <stdio.h>
+
+/*
+ * Índice invertido em disco: para cada termo (chave de tamanho fixo), a lista ordenada das
+ * posições dos registros que o contêm.
+ *
+ * São dois arquivos:
+ *	- dicionário (ex.: livro_autor.idx): árvore B+ (arvore_bmais) que associa cada termo ao
+ *	deslocamento da sua lista no arquivo de listas;
+ *	- listas (ex.: livro_autor.pst): cada lista ocupa uma extensão contínua, com um
+ *	CABECALHO_LISTA_POSICOES seguido das posições em ordem crescente, gravadas como diferenças
+ *	entre posições consecutivas em inteiros de tamanho variável (7 bits por byte).
+ *
+ * Uma consulta faz uma busca no dicionário e uma única leitura contínua da lista, com custo
+ * proporcional ao tamanho do resultado. Quando uma inserção não cabe na extensão, a lista é
+ * copiada para o fim do arquivo com o dobro da capacidade e o dicionário passa a apontar para a
+ * cópia; o espaço antigo só é recuperado quando o índice é reconstruído.
+ */
+
+#define EXTENSAO_LISTAS_INVERTIDO ".pst"
+
+// capacidade mínima, em bytes, da extensão de uma lista
+#define CAPACIDADE_MINIMA_LISTA 16
+
+/*
+ * CABECALHO_LISTA_POSICOES - cabeçalho de uma lista no arquivo de listas
+ *
+ * @capacidade - bytes reservados para as diferenças logo após o cabeçalho
+ * @usados     - bytes ocupados pelas diferenças
+ * @quantidade - quantidade de posições da lista
+ * @ultima     - maior posição da lista (-1 se vazia); a primeira diferença é contada a partir de -1
+ */
+typedef struct {
+	int capacidade;
+	int usados;
+	int quantidade;
+	int ultima;
+} CABECALHO_LISTA_POSICOES;
+
+/*
+ * visitante_posicao - função chamada para cada posição da lista de um termo
+ *
+ * Deve retornar 0 para continuar a varredura ou qualquer outro valor para interrompê-la.
+ */
+typedef int (*visitante_posicao)(int posicao, void* contexto);
+
+/*
+ * indice_invertido_construir - cria (ou sobrescreve) um índice invertido de uma só vez
+ *
+ * @caminho - caminho do dicionário (o arquivo de listas troca a extensão por EXTENSAO_LISTAS_INVERTIDO)
+ * @tamanho_termo - tamanho fixo dos termos, entre 1 e TAM_MAX_CHAVE_BMAIS
+ * @termos - vetor contínuo com quantidade * tamanho_termo bytes
+ * @posicoes - posição associada a cada termo
+ * @quantidade - número de pares (termo, posição)
+ *
+ * As listas são gravadas em sequência, com uma folga de 1/4 para inserções futuras, e o
+ * dicionário é montado de baixo para cima (arvore_bmais_construir).
+ *
+ * Pré-condições:
+ *	- Os pares devem estar ordenados por termo (memcmp) e, no mesmo termo, por posição.
+ * Pós-condições:
+ *	- Pares repetidos são gravados uma única vez.
+ *	- Retorna SUCESSO (0), ERRO_ABRIR_ARQUIVO (-10), ERRO_ESCREVER_INDICE (-28) ou ERRO_ALOCAR_MEMORIA (-30).
+ */
+int indice_invertido_construir(const char* caminho, int tamanho_termo, const unsigned char* termos, const int* posicoes, int quantidade);
+
+/*
+ * indice_invertido_inserir - acrescenta uma posição à lista de um termo
+ *
+ * @caminho - caminho do dicionário
+ * @termo - bytes do termo (tamanho_termo do dicionário)
+ * @posicao - posição a ser acrescentada (não negativa)
+ *
+ * Posições maiores que a última são apenas acrescentadas ao fim da lista; as demais fazem a
+ * lista ser regravada em ordem.
+ *
+ * Pós-condições:
+ *	- Se o termo não existir, uma lista nova é criada; se a posição já estiver na lista, nada muda.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna ERRO_ABRIR_ARQUIVO (-10) se algum dos arquivos não existir.
+ *	- Retorna ERRO_LER_INDICE (-27), ERRO_ESCREVER_INDICE (-28) ou ERRO_ALOCAR_MEMORIA (-30) em caso de erro.
+ */
+int indice_invertido_inserir(const char* caminho, const unsigned char* termo, int posicao);
+
+/*
+ * indice_invertido_percorrer - visita, em ordem crescente, as posições da lista de um termo
+ *
+ * @caminho - caminho do dicionário
+ * @termo - bytes do termo
+ * @visitar - função chamada para cada posição
+ * @contexto - ponteiro repassado para a função visitar
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ao final da varredura (inclusive se o termo não existir ou se a
+ *	varredura for interrompida pela função visitar).
+ *	- Retorna ERRO_ABRIR_ARQUIVO (-10) se algum dos arquivos não existir.
+ *	- Retorna ERRO_LER_INDICE (-27) ou ERRO_ALOCAR_MEMORIA (-30) em caso de erro.
+ */
+int indice_invertido_percorrer(const char* caminho, const unsigned char* termo, visitante_posicao visitar, void* contexto);
+
+/*
+ * Versões de indice_invertido_inserir e indice_invertido_percorrer sobre um índice já aberto
+ *
+ * @dicionario - dicionário aberto com abrir_arquivo_indice (armazenamento.h)
+ * @listas - arquivo de listas aberto com abrir_arquivo_indice ("rb" para percorrer, "r+b" para inserir)
+ *
+ * Mesmos demais parâmetros e códigos de retorno, exceto ERRO_ABRIR_ARQUIVO: os arquivos não são
+ * abertos nem fechados a cada chamada, e os nós do dicionário e as listas são lidos do cache de
+ * páginas. Usadas pelas operações sobre uma BIBLIOTECA, que mantém os índices abertos.
+ *
+ * Pós-condições:
+ *	- A inserção grava no arquivo as páginas alteradas antes de retornar, as listas antes do dicionário.
+ */
+int indice_invertido_inserir_arquivo(FILE* dicionario, FILE* listas, const unsigned char* termo, int posicao);
+int indice_invertido_percorrer_arquivo(FILE* dicionario, FILE* listas, const unsigned char* termo, visitante_posicao visitar, void* contexto);
+
+/*
+ * indice_invertido_apagar - remove o dicionário e o arquivo de listas
+ */
+void indice_invertido_apagar(const char* caminho);
+
+#endif // INDICE_INVERTIDO_H
@@ -0,0 +1,134 @@
+#ifndef JUNCAO_H
+#define JUNCAO_H
+
+#include <stddef.h>
+
+#include "livro.h"
+#include "usuario.h"
+#include "emprestimo.h"
+
+// memória máxima (em bytes) usada pela junção; acima disso é usada a junção por ordenação
+#ifndef LIMITE_MEMORIA_JUNCAO
+#define LIMITE_MEMORIA_JUNCAO (64L * 1024 * 1024)
+#endif
+
+#define MAX_VIAS_INTERCALACAO 16
+
+/*
+ * EMPRESTIMO_DETALHADO - struct que armazena um empréstimo aberto junto com os dados do usuário e do livro
+ *
+ * @codigo_usuario - código do usuário do empréstimo
+ * @nome_usuario - nome do usuário (vazio se o usuário não existir)
+ * @codigo_livro - código do livro do empréstimo
+ * @titulo_livro - título do livro (vazio se o livro não existir)
+ * @data_emprestimo - data em que o livro foi emprestado, em número de dias (ver formatar_data)
+ */
+typedef struct {
+	unsigned int codigo_usuario;
+	char nome_usuario[MAX_NOME + 1];
+	unsigned int codigo_livro;
+	char titulo_livro[MAX_TITULO + 1];
+	int data_emprestimo;
+} EMPRESTIMO_DETALHADO;
+
+/*
+ * visitante_juncao - função chamada para cada linha produzida pela junção
+ *
+ * @emprestimo - empréstimo aberto com os dados de usuário e livro preenchidos
+ * @contexto - ponteiro repassado pelo chamador da junção
+ *
+ * Deve retornar SUCESSO (0) para continuar ou qualquer outro valor para interromper a junção.
+ */
+typedef int (*visitante_juncao)(const EMPRESTIMO_DETALHADO* emprestimo, void* contexto);
+
+/*
+ * juncao_hash_emprestimos_abertos - junta empréstimos abertos, livros e usuários com tabelas hash em memória
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ * @caminho_arquivo_livro - caminho completo para o arquivo binário de livros
+ * @caminho_arquivo_usuario - caminho completo para o arquivo binário de usuários
+ * @visitar - função chamada para cada empréstimo aberto, na ordem da lista de empréstimos
+ * @contexto - ponteiro repassado para a função visitar
+ *
+ * Os arquivos de livros e de usuários são lidos uma única vez, sequencialmente e em blocos,
+ * montando tabelas código -> título/nome. Em seguida a lista de empréstimos é percorrida
+ * e cada empréstimo aberto é completado com consultas O(1) às tabelas.
+ *
+ * Pré-condições:
+ *	- Os arquivos devem existir e estar inicializados com cabeçalhos válidos.
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ao final da junção (inclusive se interrompida pela função visitar).
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível abrir algum arquivo.
+ *		- ERRO_LER_CABECALHO (-11): não foi possível ler o cabeçalho de algum arquivo.
+ *		- ERRO_ARQUIVO_SEEK (-1) / ERRO_ARQUIVO_READ (-3): falha na leitura dos registros.
+ *		- ERRO_ALOCAR_MEMORIA (-30): memória insuficiente para as tabelas.
+ */
+int juncao_hash_emprestimos_abertos(
+	const char* caminho_arquivo_emprestimo,
+	const char* caminho_arquivo_livro,
+	const char* caminho_arquivo_usuario,
+	visitante_juncao visitar,
+	void* contexto
+);
+
+/*
+ * juncao_ordenacao_emprestimos_abertos - junta empréstimos abertos, livros e usuários por ordenação e intercalação
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ * @caminho_arquivo_livro - caminho completo para o arquivo binário de livros
+ * @caminho_arquivo_usuario - caminho completo para o arquivo binário de usuários
+ * @limite_memoria - quantidade máxima de bytes usada em cada ordenação
+ * @visitar - função chamada para cada empréstimo aberto, na ordem da lista de empréstimos
+ * @contexto - ponteiro repassado para a função visitar
+ *
+ * Variante com memória limitada: empréstimos, livros e usuários são copiados para arquivos
+ * temporários, ordenados externamente (corridas ordenadas + intercalação de até
+ * MAX_VIAS_INTERCALACAO vias) e juntados por intercalação. Ao final os empréstimos são
+ * reordenados pela posição original na lista antes de serem entregues à função visitar.
+ *
+ * Pré-condições:
+ *	- Os arquivos devem existir e estar inicializados com cabeçalhos válidos.
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ao final da junção (inclusive se interrompida pela função visitar).
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível abrir algum arquivo ou criar um temporário.
+ *		- ERRO_LER_CABECALHO (-11): não foi possível ler o cabeçalho de algum arquivo.
+ *		- ERRO_ARQUIVO_SEEK (-1) / ERRO_ARQUIVO_READ (-3) / ERRO_ARQUIVO_WRITE (-2): falha de E/S.
+ *		- ERRO_ALOCAR_MEMORIA (-30): memória insuficiente para os blocos de ordenação.
+ */
+int juncao_ordenacao_emprestimos_abertos(
+	const char* caminho_arquivo_emprestimo,
+	const char* caminho_arquivo_livro,
+	const char* caminho_arquivo_usuario,
+	size_t limite_memoria,
+	visitante_juncao visitar,
+	void* contexto
+);
+
+/*
+ * juntar_emprestimos_abertos - junta empréstimos abertos com livros e usuários escolhendo a estratégia
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ * @caminho_arquivo_livro - caminho completo para o arquivo binário de livros
+ * @caminho_arquivo_usuario - caminho completo para o arquivo binário de usuários
+ * @visitar - função chamada para cada empréstimo aberto, na ordem da lista de empréstimos
+ * @contexto - ponteiro repassado para a função visitar
+ *
+ * A escolha usa os contadores dos cabeçalhos: sem empréstimos abertos nenhum arquivo é lido;
+ * a junção hash é usada quando a estimativa de memória das tabelas de livros e usuários (um
+ * texto por registro ativo) cabe em LIMITE_MEMORIA_JUNCAO; caso contrário (ou se faltar
+ * memória), usa a junção por ordenação.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou um dos erros de juncao_hash_emprestimos_abertos/juncao_ordenacao_emprestimos_abertos.
+ */
+int juntar_emprestimos_abertos(
+	const char* caminho_arquivo_emprestimo,
+	const char* caminho_arquivo_livro,
+	const char* caminho_arquivo_usuario,
+	visitante_juncao visitar,
+	void* contexto
+);
+
+#endif // JUNCAO_H
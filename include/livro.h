@@ -3,10 +3,64 @@
 
 #include <stdio.h>
 
+#include "biblioteca.h"
+#include "indice_invertido.h"
+#include "textos.h"
+
+// limites dos campos na entrada e no LIVRO em memória; o formato em disco não limita os textos
 #define MAX_TITULO 150
 #define MAX_AUTOR 200
 #define MAX_EDITORA 50
 
+// colunas de texto dos livros na área de textos (livro.col / livro.str)
+#define COLUNA_TITULO           0
+#define COLUNA_AUTOR            1
+#define COLUNA_EDITORA          2
+#define COLUNAS_TEXTO_LIVRO     3
+
+/*
+ * Índice de títulos (livro_titulo.idx): árvore B+ com chave = TAM_TITULO_INDICE primeiros bytes
+ * do título (completados com '\0') seguidos do código em big-endian, e valor = posição em livro.dat.
+ * A ordem das chaves é a ordem alfabética (strcmp) dos títulos; títulos que só diferem depois
+ * dos TAM_TITULO_INDICE primeiros bytes ficam em ordem de código na árvore, e as buscas os leem de
+ * livro.str e os reordenam pelo título completo antes de exibi-los.
+ */
+#define EXTENSAO_INDICE_TITULO  "_titulo.idx"
+#define TAM_TITULO_INDICE       64
+#define TAM_CHAVE_TITULO        (TAM_TITULO_INDICE + 4)
+
+/*
+ * Índice de autores (livro_autor.idx e livro_autor.pst): índice invertido (indice_invertido.h) com
+ * termo = TAM_AUTOR_INDICE primeiros bytes do autor (completados com '\0') e, para cada termo, as
+ * posições dos livros em livro.dat. Autores que só diferem depois desses bytes dividem a mesma
+ * lista e são conferidos em livro.str.
+ */
+#define EXTENSAO_INDICE_AUTOR   "_autor.idx"
+#define EXTENSAO_LISTAS_AUTOR   "_autor" EXTENSAO_LISTAS_INVERTIDO
+#define TAM_AUTOR_INDICE        64
+
+/*
+ * Índice de trigramas (livro_trigrama.idx e livro_trigrama.pst): índice invertido com os
+ * trigramas (trigramas.h) de título, autor e editora normalizados e, para cada trigrama, as
+ * posições dos livros que o contêm. Usado na busca por trecho com tolerância a diferenças.
+ */
+#define EXTENSAO_INDICE_TRIGRAMA "_trigrama.idx"
+#define EXTENSAO_LISTAS_TRIGRAMA "_trigrama" EXTENSAO_LISTAS_INVERTIDO
+#define MAX_TRIGRAMAS_LIVRO     (MAX_TITULO + MAX_AUTOR + MAX_EDITORA)
+#define MAX_RESULTADOS_TEXTO    20
+
+// filtros por varredura de livro.str (filtrar_livros)
+#define FILTRO_CONTEM           0
+#define FILTRO_COMECA_COM       1
+#define FILTRO_IGUAL            2
+
+// posições cujas referências são lidas de uma vez e maior trecho de livro.str lido de uma vez na varredura
+#define POSICOES_BLOCO_VARREDURA 4096
+#define TAM_BLOCO_VARREDURA     (1024 * 1024)
+
+// tempo mínimo, em segundos, de cada medida de medir_varredura_livros
+#define TEMPO_MEDIDA_VARREDURA  0.25
+
 /*
  * LIVRO - struct que armazena informações do livro
  *
@@ -30,6 +84,179 @@ typedef struct {
     int prox;
 } LIVRO;
 
+/*
+ * REGISTRO_LIVRO - registro de tamanho fixo gravado em livro.dat (colunas quentes)
+ *
+ * @codigo, @edicao, @ano, @exemplares, @prox - mesmos campos de LIVRO
+ * @primeiro_emprestimo - posição em emprestimo.dat do último empréstimo registrado para o livro (-1 se não houver)
+ *
+ * Título, autor e editora (colunas frias) ficam na área de textos: livro.col guarda, para cada
+ * posição, as referências dos três textos e livro.str, os textos. Contagens, varreduras,
+ * reconstrução do índice e empréstimos/devoluções leem apenas os 24 bytes do registro.
+ */
+typedef struct {
+    int codigo;
+    int edicao;
+    int ano;
+    int exemplares;
+    int prox;
+    int primeiro_emprestimo;
+} REGISTRO_LIVRO;
+
+/*
+ * preparar_registro_livro - copia as colunas quentes de um LIVRO para o registro de livro.dat
+ *
+ * O registro é de um livro novo: primeiro_emprestimo recebe -1.
+ */
+void preparar_registro_livro(const LIVRO* livro, REGISTRO_LIVRO* registro);
+
+/*
+ * gravar_textos_livro - grava título, autor e editora de um livro na área de textos
+ *
+ * @textos - área de textos dos livros aberta para gravação
+ * @posicao - posição do registro do livro em livro.dat
+ * @livro - livro com os textos
+ *
+ * Pós-condições:
+ *	- Os textos são acrescentados a livro.str e suas referências gravadas na posição em livro.col.
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_WRITE (-2).
+ */
+int gravar_textos_livro(AREA_TEXTOS* textos, int posicao, const LIVRO* livro);
+
+/*
+ * montar_livro - preenche um LIVRO a partir do registro e da área de textos
+ *
+ * @textos - área de textos dos livros aberta para leitura
+ * @posicao - posição do registro em livro.dat
+ * @registro - registro lido de livro.dat
+ * @livro - estrutura a ser preenchida
+ *
+ * Pós-condições:
+ *	- Textos maiores que os campos de LIVRO são truncados.
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_READ (-3).
+ */
+int montar_livro(AREA_TEXTOS* textos, int posicao, const REGISTRO_LIVRO* registro, LIVRO* livro);
+
+/*
+ * contabilizar_livro - soma os exemplares de um REGISTRO_LIVRO ao cabeçalho (ver recalcular_contadores)
+ *
+ * @registro - REGISTRO_LIVRO ativo
+ * @posicao - posição do registro (não usada)
+ * @contexto - CABECALHO de livro.dat
+ *
+ * Pós-condições:
+ *	- exemplares_disponiveis é incrementado; retorna SUCESSO (0).
+ */
+int contabilizar_livro(const void* registro, int posicao, void* contexto);
+
+/*
+ * converter_livros_formato_antigo - converte livro.dat de formatos anteriores para REGISTRO_LIVRO
+ *
+ * @nome_arq - caminho do arquivo binário de livros
+ *
+ * Formatos reconhecidos, pela ausência dos arquivos da área de textos:
+ *	- sem livro.str: cada registro é um LIVRO com título, autor e editora em vetores de
+ *	151, 201 e 51 bytes;
+ *	- com livro.str e sem livro.col: as referências dos textos ficam dentro do registro.
+ * Os dois formatos usam o cabeçalho antigo (CABECALHO_VERSAO_0); o arquivo convertido recebe o
+ * cabeçalho atual, com os contadores calculados.
+ * Os registros são regravados na mesma posição (a lista encadeada, a lista de livres e o
+ * índice livro.idx continuam válidos). Um arquivo vazio apenas ganha a área de textos.
+ *
+ * Pré-condições:
+ *	- O arquivo deve ter um cabeçalho válido.
+ * Pós-condições:
+ *	- livro.dat é substituído pelo arquivo convertido; livro.col (e livro.str, se não existir) são criados.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valores negativos em caso de erro (livro.dat não é alterado):
+ *		- ERRO_ABRIR_ARQUIVO (-10): algum arquivo não pôde ser aberto ou criado.
+ *		- ERRO_LER_CABECALHO (-11): cabeçalho inválido.
+ *		- ERRO_ARQUIVO_READ (-3): o arquivo é menor que pos_topo registros do formato esperado.
+ *		- ERRO_ARQUIVO_WRITE (-2) / ERRO_ARQUIVO_SEEK (-1): falha ao gravar os novos arquivos.
+ *		- ERRO_ALOCAR_MEMORIA (-30): falta de memória.
+ */
+int converter_livros_formato_antigo(const char *nome_arq);
+
+/*
+ * localizar_livro - Busca um livro pelo código utilizando o índice hash do arquivo (livro.idx)
+ *
+ * @livros  - arquivo de livros da biblioteca, que mantém o índice aberto (biblioteca_indice_hash)
+ * @codigo  - código do livro procurado
+ * @livro   - ponteiro onde o registro encontrado será armazenado (os textos podem ser lidos com montar_livro)
+ * @pos     - ponteiro onde a posição do registro no arquivo será armazenada
+ *
+ * Pré-condições:
+ *	- O arquivo deve estar aberto e inicializado com um cabeçalho válido
+ *
+ * Pós-condições:
+ *	- Se o índice não existir ou estiver desatualizado, ele é reconstruído a partir da lista
+ *	- Em caso de sucesso, *livro e *pos recebem o registro e sua posição
+ *	- Retorna SUCESSO (0) se o livro foi encontrado
+ *	- Retorna ERRO_ENCONTRAR_LIVRO (-15) se não existir livro com o código informado
+ *	- Retorna outro código de erro negativo em caso de falha de leitura
+ */
+int localizar_livro(ARQUIVO_BIBLIOTECA *livros, unsigned int codigo, REGISTRO_LIVRO *livro, int *pos);
+
+/*
+ * reconstruir_indice_livro - Recria o índice hash (livro.idx) percorrendo a lista de livros
+ *
+ * @nome_arq - nome do arquivo binário contendo os livros
+ *
+ * Pré-condições:
+ *	- O arquivo deve existir e estar inicializado com um cabeçalho válido
+ *
+ * Pós-condições:
+ *	- O arquivo de índice é recriado contendo todos os livros da lista
+ *	- Retorna SUCESSO (0) em caso de sucesso
+ *	- Retorna código de erro negativo em caso de falha
+ */
+int reconstruir_indice_livro(const char *nome_arq);
+
+/*
+ * reconstruir_indice_titulo - Recria o índice de títulos (livro_titulo.idx) percorrendo a lista de livros
+ *
+ * @nome_arq - nome do arquivo binário contendo os livros
+ *
+ * Pré-condições:
+ *	- O arquivo e sua área de textos devem existir, com um cabeçalho válido
+ *
+ * Pós-condições:
+ *	- O índice é recriado de uma só vez, com as chaves ordenadas em memória
+ *	- Retorna SUCESSO (0) em caso de sucesso
+ *	- Retorna código de erro negativo em caso de falha
+ */
+int reconstruir_indice_titulo(const char *nome_arq);
+
+/*
+ * reconstruir_indice_autor - Recria o índice de autores (livro_autor.idx e livro_autor.pst) percorrendo a lista de livros
+ *
+ * @nome_arq - nome do arquivo binário contendo os livros
+ *
+ * Pré-condições:
+ *	- O arquivo e sua área de textos devem existir, com um cabeçalho válido
+ *
+ * Pós-condições:
+ *	- O índice é recriado de uma só vez, com as listas de posições compactadas
+ *	- Retorna SUCESSO (0) em caso de sucesso
+ *	- Retorna código de erro negativo em caso de falha
+ */
+int reconstruir_indice_autor(const char *nome_arq);
+
+/*
+ * reconstruir_indice_trigramas - Recria o índice de trigramas (livro_trigrama.idx e livro_trigrama.pst) percorrendo a lista de livros
+ *
+ * @nome_arq - nome do arquivo binário contendo os livros
+ *
+ * Pré-condições:
+ *	- O arquivo e sua área de textos devem existir, com um cabeçalho válido
+ *
+ * Pós-condições:
+ *	- O índice é recriado de uma só vez
+ *	- Retorna SUCESSO (0) em caso de sucesso
+ *	- Retorna código de erro negativo em caso de falha
+ */
+int reconstruir_indice_trigramas(const char *nome_arq);
+
 /*
  * cadastrar_livro - Insere um novo livro na lista encadeada mantida em arquivo binário
  *
@@ -91,28 +318,124 @@ int listar_todos_livros(const char *nome_arq);
  *	- O arquivo pode ser aberto para leitura
  *
  * Pós-condições:
- *	- Títulos dos livros do autor são impressos na tela
+ *	- Títulos dos livros do autor são impressos na tela (busca pelo índice de autores)
  *	- Retorna SUCESSO (0) em caso de sucesso
  *	- Retorna código negativo em caso de erro
  */
 int buscar_autor_livro(const char *nome_arq, const char *autor);
 
 /*
- * buscar_titulo_livro - Busca e imprime os dados de um livro com base no título
+ * buscar_titulo_livro - Busca e imprime os dados dos livros com um título
  *
  * @nome_arq - nome do arquivo binário contendo os livros
- * @titulo   - título do livro a ser buscado
+ * @titulo   - título completo a ser buscado
  *
  * Pré-condições:
  *	- O arquivo deve estar aberto para leitura
  *
  * Pós-condições:
- *	- Dados do livro encontrado são exibidos na tela
+ *	- Dados de todos os livros com o título são exibidos, em ordem de código (busca pelo índice de títulos)
  *	- Retorna SUCESSO (0) em caso de sucesso
  *	- Retorna código de erro negativo se não encontrado ou ocorrer erro de leitura
  */
 int buscar_titulo_livro(const char *nome_arq, const char *titulo);
 
+/*
+ * buscar_prefixo_titulo_livro - Lista, em ordem alfabética, os livros cujo título começa com um prefixo
+ *
+ * @nome_arq - nome do arquivo binário contendo os livros
+ * @prefixo  - início do título (vazio lista todos os livros)
+ *
+ * Pré-condições:
+ *	- O arquivo pode ser aberto para leitura
+ *
+ * Pós-condições:
+ *	- Os livros encontrados são impressos em ordem de título (e de código, entre títulos iguais)
+ *	- Retorna SUCESSO (0), inclusive se nenhum livro for encontrado
+ *	- Retorna valor negativo em caso de erro
+ */
+int buscar_prefixo_titulo_livro(const char *nome_arq, const char *prefixo);
+
+/*
+ * listar_livros_intervalo_titulo - Lista, em ordem alfabética, os livros com título dentro de uma faixa
+ *
+ * @nome_arq       - nome do arquivo binário contendo os livros
+ * @titulo_inicial - menor título da faixa
+ * @titulo_final   - maior título da faixa (inclusive)
+ *
+ * Pré-condições:
+ *	- O arquivo pode ser aberto para leitura
+ *
+ * Pós-condições:
+ *	- Os livros com titulo_inicial <= título <= titulo_final (ordem de strcmp) são impressos
+ *	- Retorna SUCESSO (0), inclusive se nenhum livro for encontrado
+ *	- Retorna valor negativo em caso de erro
+ */
+int listar_livros_intervalo_titulo(const char *nome_arq, const char *titulo_inicial, const char *titulo_final);
+
+/*
+ * buscar_texto_livro - Busca livros por trecho de título, autor ou editora, tolerando diferenças
+ *
+ * @nome_arq - nome do arquivo binário contendo os livros
+ * @consulta - texto procurado (maiúsculas, acentos e pontuação são ignorados)
+ *
+ * As listas do índice de trigramas dos trigramas da consulta são juntas: a semelhança de um livro
+ * é a quantidade de trigramas da consulta que ele contém, e só os livros com todos eles (a
+ * interseção das listas) são conferidos como trecho exato. Nenhum livro fora das listas é lido.
+ *
+ * Pré-condições:
+ *	- O arquivo pode ser aberto para leitura
+ *
+ * Pós-condições:
+ *	- Até MAX_RESULTADOS_TEXTO livros são impressos por relevância: primeiro os que contêm a
+ *	consulta como trecho, depois os que compartilham mais trigramas com ela (ao menos metade)
+ *	- Retorna SUCESSO (0), inclusive se nenhum livro for encontrado
+ *	- Retorna valor negativo em caso de erro
+ */
+int buscar_texto_livro(const char *nome_arq, const char *consulta);
+
+/*
+ * filtrar_livros - Lista os livros cujo título, autor ou editora atende a um filtro, varrendo livro.str
+ *
+ * @nome_arq      - nome do arquivo binário contendo os livros
+ * @coluna        - COLUNA_TITULO, COLUNA_AUTOR ou COLUNA_EDITORA
+ * @operacao      - FILTRO_CONTEM, FILTRO_COMECA_COM ou FILTRO_IGUAL
+ * @ignorar_caixa - 1 para não diferenciar letras maiúsculas e minúsculas (ASCII)
+ * @padrao        - texto procurado
+ *
+ * Filtros sem índice: as referências e os textos da coluna são lidos em blocos e avaliados pelo
+ * núcleo de varredura (varredura.h), que usa AVX2 ou SSE2 quando o processador suporta. As buscas
+ * exatas por título e por autor também recorrem a essa varredura quando o índice não pode ser usado.
+ *
+ * Pré-condições:
+ *	- O arquivo pode ser aberto para leitura
+ *
+ * Pós-condições:
+ *	- Os livros que atendem ao filtro são impressos em ordem de posição no arquivo
+ *	- Retorna SUCESSO (0), inclusive se nenhum livro for encontrado
+ *	- Retorna ERRO_CAMPOS_INVALIDOS (-24) para coluna ou operação desconhecida
+ *	- Retorna valor negativo em caso de erro
+ */
+int filtrar_livros(const char *nome_arq, int coluna, int operacao, int ignorar_caixa, const char *padrao);
+
+/*
+ * medir_varredura_livros - Mede a vazão (GB/s) da varredura de textos em cada nível disponível
+ *
+ * @nome_arq - nome do arquivo binário contendo os livros
+ * @padrao   - texto procurado nos títulos
+ *
+ * Para cada nível do núcleo de varredura (AVX2, SSE2, escalar) são medidos o núcleo sozinho,
+ * sobre livro.str inteiro em memória, e o filtro "título contém" completo, com leitura dos arquivos.
+ *
+ * Pré-condições:
+ *	- O arquivo pode ser aberto para leitura
+ *
+ * Pós-condições:
+ *	- Uma tabela com as vazões é impressa; o nível máximo volta a ser usado ao final
+ *	- Retorna SUCESSO (0) ou valor negativo em caso de erro
+ */
+int medir_varredura_livros(const char *nome_arq, const char *padrao);
+
 /*
 * calcular_total_livros - retorna a quantia total de livros
 * @nome_arq - nome do arquivo binário contendo os livros
@@ -127,4 +450,42 @@ int buscar_titulo_livro(const char *nome_arq, const char *titulo);
 *
 */
 int calcular_total_livros(const char *nome_arq);
+
+/*
+ * Versões das funções acima sobre uma BIBLIOTECA aberta (biblioteca_abrir)
+ *
+ * Mesmos parâmetros, saída e códigos de retorno, trocando o caminho do arquivo pela biblioteca.
+ * Usam o arquivo de livros, sua área de textos e o cabeçalho residentes, sem abrir os arquivos
+ * nem ler o cabeçalho a cada chamada; as funções baseadas em caminho abrem uma BIBLIOTECA temporária e as chamam.
+ *
+ * Pré-condições:
+ *	- biblioteca->livros deve estar aberto.
+ * Pós-condições:
+ *	- biblioteca_cadastrar_livro atualiza o cabeçalho residente apenas quando a gravação tem sucesso.
+ *	- Confirmado o cadastro, a falha em algum índice não é retornada: os índices são reconstruídos
+ *	a partir da lista (ou removidos, para a próxima consulta os reconstruir).
+ */
+int biblioteca_cadastrar_livro(BIBLIOTECA* biblioteca, LIVRO livro);
+int biblioteca_imprimir_livro(BIBLIOTECA* biblioteca, int codigo);
+int biblioteca_listar_todos_livros(BIBLIOTECA* biblioteca);
+int biblioteca_buscar_autor_livro(BIBLIOTECA* biblioteca, const char *autor);
+int biblioteca_buscar_titulo_livro(BIBLIOTECA* biblioteca, const char *titulo);
+int biblioteca_buscar_prefixo_titulo_livro(BIBLIOTECA* biblioteca, const char *prefixo);
+int biblioteca_listar_livros_intervalo_titulo(BIBLIOTECA* biblioteca, const char *titulo_inicial, const char *titulo_final);
+int biblioteca_buscar_texto_livro(BIBLIOTECA* biblioteca, const char *consulta);
+int biblioteca_filtrar_livros(BIBLIOTECA* biblioteca, int coluna, int operacao, int ignorar_caixa, const char *padrao);
+int biblioteca_medir_varredura_livros(BIBLIOTECA* biblioteca, const char *padrao);
+int biblioteca_calcular_total_livros(BIBLIOTECA* biblioteca);
+
+/*
+ * biblioteca_consultar_livro - lê os dados de um livro pelo código, sem exibi-los
+ *
+ * @biblioteca - base aberta
+ * @codigo - código do livro
+ * @livro - recebe o livro, com os textos lidos de livro.str
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ENCONTRAR_LIVRO (-15) ou outro código de erro negativo (livro indefinido).
+ */
+int biblioteca_consultar_livro(BIBLIOTECA* biblioteca, int codigo, LIVRO* livro);
 #endif
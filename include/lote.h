@@ -0,0 +1,86 @@
+#ifndef LOTE_H
+#define LOTE_H
+
+#include <stdio.h>
+
+#include "livro.h"
+#include "usuario.h"
+#include "emprestimo.h"
+#include "carga.h"
+
+// tamanho de cada linha lida do arquivo de lote (linhas maiores são divididas, como no fgets)
+#define TAM_LINHA_LOTE          512
+// quantidade de linhas em cada pedaço entregue às threads de interpretação
+#define LINHAS_POR_PEDACO       256
+#define MAX_THREADS_LOTE        16
+
+// quantidade de threads de interpretação; 0 usa o número de processadores disponíveis
+#ifndef NUM_THREADS_LOTE
+#define NUM_THREADS_LOTE        0
+#endif
+
+/*
+ * TIPO_LINHA_LOTE - classificação de uma linha do arquivo de lote após a interpretação
+ */
+typedef enum {
+	LINHA_BRANCO = 0,
+	LINHA_DESCONHECIDA,
+	LINHA_LIVRO,
+	LINHA_USUARIO,
+	LINHA_EMPRESTIMO
+} TIPO_LINHA_LOTE;
+
+/*
+ * LINHA_LOTE - resultado da interpretação de uma linha do arquivo de lote
+ *
+ * @tipo - tipo da linha (L, U, E, em branco ou desconhecida)
+ * @lidos - quantidade de campos reconhecidos pelo sscanf
+ * @livro / @usuario / @emprestimo - registro montado a partir dos campos, conforme o tipo
+ *
+ * Em linhas 'E', as datas já vêm convertidas em número de dias: data_devolucao fica DATA_NULA
+ * quando a linha não traz devolução, e uma data inválida deixa lidos em 0 (campos incorretos).
+ */
+typedef struct {
+	TIPO_LINHA_LOTE tipo;
+	int lidos;
+	union {
+		LIVRO livro;
+		USUARIO usuario;
+		EMPRESTIMO emprestimo;
+	} registro;
+} LINHA_LOTE;
+
+/*
+ * interpretar_linha_lote - converte uma linha do arquivo de lote em um registro
+ *
+ * @linha - linha lida do arquivo (modificada: o '\n' e os espaços das pontas são removidos)
+ * @saida - estrutura que recebe o tipo da linha e o registro montado
+ *
+ * Não acessa arquivos nem estado global, podendo ser chamada por várias threads ao mesmo tempo.
+ *
+ * Pré-condições:
+ *	- linha deve ser uma string válida com no máximo TAM_LINHA_LOTE - 1 caracteres.
+ * Pós-condições:
+ *	- saida->tipo indica como a linha deve ser aplicada; campos ausentes ficam refletidos em saida->lidos.
+ */
+void interpretar_linha_lote(char* linha, LINHA_LOTE* saida);
+
+/*
+ * executar_lote - lê, interpreta e aplica todas as linhas de um arquivo de lote
+ *
+ * @arquivo - arquivo de lote aberto para leitura
+ * @carga - carga em lote iniciada por carga_iniciar, onde as linhas são aplicadas
+ *
+ * Funciona como um pipeline: uma thread leitora divide o arquivo em pedaços de
+ * LINHAS_POR_PEDACO linhas, NUM_THREADS_LOTE threads interpretam os pedaços em paralelo
+ * (interpretar_linha_lote) e a thread chamadora aplica os pedaços na ordem do arquivo.
+ * Sem suporte a threads, ou com um único processador, as mesmas etapas são executadas em sequência.
+ *
+ * Pós-condições:
+ *	- As linhas são aplicadas na ordem do arquivo e as mensagens de erro trazem o número original da linha.
+ *	- Retorna SUCESSO (0) ao final, mesmo com erros parciais nas linhas.
+ *	- Retorna ERRO_ALOCAR_MEMORIA (-30) se não houver memória para os pedaços (nenhuma linha é aplicada).
+ */
+int executar_lote(FILE* arquivo, CARGA_LOTE* carga);
+
+#endif // LOTE_H
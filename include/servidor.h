@@ -0,0 +1,121 @@
+#ifndef SERVIDOR_H
+#define SERVIDOR_H
+
+#include "biblioteca.h"
+
+// tamanho máximo de um pedido (uma linha, com o '\n', ou os dados de um pedido binário)
+#define TAM_PEDIDO_SERVIDOR	1024
+// espaço de leitura de cada conexão: vários pedidos binários pequenos são lidos de uma vez
+#define TAM_BUFFER_CONEXAO	16384
+#define MAX_CONEXOES_SERVIDOR	1024
+// pedidos de uma conexão binária à espera ou em execução; além disso, a conexão deixa de ser lida
+#define MAX_PEDIDOS_CONEXAO	1024
+#define MAX_THREADS_SERVIDOR	64
+// tempo máximo, em segundos, que um cliente pode levar para receber uma resposta antes de ser desconectado
+#define ESPERA_ENVIO_SERVIDOR	10
+
+// quantidade de threads que executam os pedidos; 0 usa o número de processadores disponíveis mais um
+#ifndef NUM_THREADS_SERVIDOR
+#define NUM_THREADS_SERVIDOR	0
+#endif
+
+// bytes que abrem uma conexão binária (nenhum pedido de texto começa com '\0')
+#define ASSINATURA_PROTOCOLO_BINARIO	"\0BIB"
+#define TAM_ASSINATURA_PROTOCOLO	4
+
+// cabeçalho de um pedido binário: tamanho dos dados (4), identificador (4) e operação (1)
+#define TAM_CABECALHO_PEDIDO	9
+// cabeçalho de uma resposta binária: tamanho dos dados (4), identificador (4) e retorno (4)
+#define TAM_CABECALHO_RESPOSTA	12
+
+// operações do protocolo binário
+#define PEDIDO_TEXTO		0	// dados: um pedido do protocolo de texto, sem o '\n'
+#define PEDIDO_LIVRO		1	// dados: código do livro
+#define PEDIDO_EMPRESTAR	2	// dados: código do usuário, código do livro e data
+#define PEDIDO_DEVOLVER		3	// dados: código do usuário, código do livro e data
+#define PEDIDO_BUSCAR_TITULO	4	// dados: título
+#define PEDIDO_BUSCAR_PREFIXO	5	// dados: início do título
+#define PEDIDO_BUSCAR_AUTOR	6	// dados: autor
+#define PEDIDO_BUSCAR_TEXTO	7	// dados: trecho
+#define NUM_PEDIDOS_BINARIOS	8
+
+/*
+ * Servidor da biblioteca: atende, por um socket local (Unix domain socket), as mesmas operações
+ * do menu sobre uma única base aberta, compartilhada por todas as conexões. Cada conexão usa um
+ * de dois protocolos, escolhido pelos primeiros bytes que o cliente envia.
+ *
+ * Protocolo de texto: cada pedido é uma linha com o comando e os campos separados por ';', como
+ * no arquivo de lote:
+ *
+ *	livro;<codigo>				imprimir dados do livro
+ *	livros					listar todos os livros
+ *	titulo;<titulo>				busca por título
+ *	prefixo;<inicio do titulo>		busca por início do título
+ *	faixa_titulos;<inicial>;<final>		livros por faixa de título
+ *	autor;<autor>				busca por autor
+ *	texto;<trecho>				busca por trecho de texto
+ *	filtrar;<coluna>;<operacao>;<ignorar caixa>;<padrao>	filtro sem índice (COLUNA_*, FILTRO_*)
+ *	total					total de livros
+ *	usuarios;<inicial>;<final>		usuários por faixa de código
+ *	emprestados				livros emprestados
+ *	periodo;<E|D>;<data inicial>;<data final>	empréstimos (E) ou devoluções (D) no período
+ *	emprestimos_usuario;<codigo>		empréstimos de um usuário
+ *	circulacao;<codigo>			circulação de um livro
+ *	cadastrar_livro;<campos>		mesmos campos da linha L do lote
+ *	cadastrar_usuario;<campos>		mesmos campos da linha U do lote
+ *	emprestar;<usuario>;<livro>[;<data>]	sem data, usa a data atual
+ *	devolver;<usuario>;<livro>[;<data>]
+ *	sair					encerra a conexão
+ *
+ * As datas vêm no formato DD/MM/AAAA. Cada resposta começa com uma linha "<retorno>;<tamanho>",
+ * onde retorno é SUCESSO (0) ou um código de erros.h e tamanho é a quantidade de bytes que vêm em
+ * seguida: o texto que a operação exibiria na tela (vazio para os cadastros, empréstimos e devoluções).
+ * Um cliente pode enviar vários pedidos sem esperar as respostas; elas chegam na ordem dos pedidos.
+ *
+ * Protocolo binário: a conexão começa com ASSINATURA_PROTOCOLO_BINARIO, seguida de pedidos com
+ * TAM_CABECALHO_PEDIDO bytes de cabeçalho (tamanho dos dados, identificador escolhido pelo cliente
+ * e operação PEDIDO_*) e os dados. Inteiros têm 4 bytes em ordem de rede (big-endian); datas são
+ * números de dias (converter_data), e DATA_NULA usa a data atual; textos ocupam o resto dos dados,
+ * sem '\0'. Cada resposta tem TAM_CABECALHO_RESPOSTA bytes de cabeçalho (tamanho dos dados, o
+ * identificador do pedido e o retorno) e os dados: para PEDIDO_LIVRO, código, edição, ano e
+ * exemplares seguidos de título, autor e editora, cada um com o tamanho em 2 bytes; para os
+ * empréstimos e devoluções, nada; para as buscas e PEDIDO_TEXTO, o texto exibido pela operação.
+ * O cliente pode manter até MAX_PEDIDOS_CONEXAO pedidos em andamento (os seguintes esperam na
+ * conexão) e as respostas chegam na ordem em que os pedidos terminam, que pode não ser a do envio.
+ *
+ * Um pedido maior que TAM_PEDIDO_SERVIDOR, uma assinatura errada ou "sair" encerram a conexão
+ * depois das respostas dos pedidos já recebidos.
+ */
+
+/*
+ * servidor_executar - atende conexões no socket informado até receber SIGINT ou SIGTERM
+ *
+ * @biblioteca - base aberta por biblioteca_abrir_exclusiva, usada por todas as conexões
+ * @caminho_socket - caminho do socket a ser criado (um arquivo antigo no caminho é removido)
+ *
+ * A thread chamadora acompanha todas as conexões (poll): aceita as novas, lê os pedidos e os
+ * coloca numa fila única, de onde NUM_THREADS_SERVIDOR threads os executam e enviam as respostas.
+ * Uma conexão de texto tem um pedido por vez na fila, o que mantém a ordem das respostas; uma
+ * binária, até MAX_PEDIDOS_CONEXAO, executados por qualquer thread.
+ *
+ * As threads compartilham a mesma BIBLIOTECA (cabeçalhos residentes, cache de páginas e diário),
+ * e as operações sobre ela são executadas uma de cada vez (a base não pode ser usada por duas
+ * threads ao mesmo tempo); ler pedidos e enviar respostas acontece em paralelo. Um cadastro,
+ * empréstimo ou devolução só é respondido depois de estar no disco: o fsync do diário é feito
+ * sem a trava da base (diario_gravar_grupo), por uma thread de cada vez, e as operações confirmadas
+ * enquanto ele acontece vão juntas no próximo; as consultas que chegam nesse meio tempo são
+ * respondidas antes.
+ *
+ * Transações e carga em lote não são atendidas: valeriam para a base inteira, e não só para
+ * a conexão que as pedisse.
+ *
+ * Pré-condições:
+ *	- Sistema POSIX (no Windows, retorna ERRO_SOCKET sem atender conexões).
+ * Pós-condições:
+ *	- As conexões abertas são encerradas, o socket é removido e a base continua aberta.
+ *	- Retorna SUCESSO (0) ao ser interrompido por sinal, ERRO_SOCKET (-35) se o socket não puder
+ *	ser criado ou ERRO_ALOCAR_MEMORIA (-30) se nenhuma thread puder ser criada.
+ */
+int servidor_executar(BIBLIOTECA* biblioteca, const char* caminho_socket);
+
+#endif // SERVIDOR_H
@@ -0,0 +1,84 @@
+#ifndef TABELA_HASH_H
+#define TABELA_HASH_H
+
+#define CAPACIDADE_TABELA_HASH_INICIAL 64
+
+/*
+ * TABELA_HASH - tabela hash em memória que associa chaves de 64 bits a valores inteiros
+ *
+ * @chaves     - vetor com as chaves de cada posição
+ * @valores    - vetor com o valor associado a cada chave
+ * @ocupados   - vetor que indica se cada posição contém uma chave (1) ou está vazia (0)
+ * @capacidade - quantidade de posições da tabela (sempre potência de 2)
+ * @quantidade - quantidade de chaves armazenadas
+ *
+ * A tabela utiliza endereçamento aberto com sondagem linear e dobra de tamanho sempre
+ * que a ocupação ultrapassa 50%. A remoção desloca as chaves seguintes da sondagem,
+ * dispensando lápides.
+ */
+typedef struct {
+	unsigned long long* chaves;
+	int* valores;
+	unsigned char* ocupados;
+	int capacidade;
+	int quantidade;
+} TABELA_HASH;
+
+/*
+ * tabela_hash_criar - aloca uma tabela hash vazia
+ *
+ * @capacidade_inicial - quantidade esperada de chaves (a tabela cresce se necessário)
+ *
+ * Pós-condições:
+ *	- Retorna um ponteiro para a tabela criada, que deve ser liberada com tabela_hash_destruir.
+ *	- Retorna NULL caso não haja memória disponível.
+ */
+TABELA_HASH* tabela_hash_criar(int capacidade_inicial);
+
+/*
+ * tabela_hash_destruir - libera a memória de uma tabela hash
+ *
+ * @tabela - tabela a ser liberada (pode ser NULL)
+ */
+void tabela_hash_destruir(TABELA_HASH* tabela);
+
+/*
+ * tabela_hash_inserir - insere (ou atualiza) uma chave na tabela
+ *
+ * @tabela - tabela criada por tabela_hash_criar
+ * @chave - chave a ser inserida
+ * @valor - valor associado à chave
+ *
+ * Pós-condições:
+ *	- Se a chave já existir, seu valor é substituído.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna ERRO_ALOCAR_MEMORIA (-30) se não for possível aumentar a tabela.
+ */
+int tabela_hash_inserir(TABELA_HASH* tabela, unsigned long long chave, int valor);
+
+/*
+ * tabela_hash_buscar - busca o valor associado a uma chave
+ *
+ * @tabela - tabela criada por tabela_hash_criar
+ * @chave - chave procurada
+ * @valor - ponteiro onde o valor encontrado será armazenado (pode ser NULL)
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) se a chave foi encontrada.
+ *	- Retorna ERRO_ENCONTRAR_CHAVE (-29) caso contrário.
+ */
+int tabela_hash_buscar(const TABELA_HASH* tabela, unsigned long long chave, int* valor);
+
+/*
+ * tabela_hash_remover - remove uma chave da tabela
+ *
+ * @tabela - tabela criada por tabela_hash_criar
+ * @chave - chave a ser removida
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) se a chave foi removida.
+ *	- Retorna ERRO_ENCONTRAR_CHAVE (-29) se a chave não estava na tabela.
+ */
+int tabela_hash_remover(TABELA_HASH* tabela, unsigned long long chave);
+
+#endif // TABELA_HASH_H
@@ -0,0 +1,196 @@
+#ifndef TEXTOS_H
+#define TEXTOS_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * Área de textos: colunas de texto de um arquivo de lista, guardadas fora dos registros.
+ *
+ * São dois arquivos auxiliares ao lado do arquivo de lista (ex.: livro.dat):
+ *	- referências (livro.col): para cada posição da lista, num_colunas REFERENCIA_TEXTO de
+ *	tamanho fixo, na mesma ordem dos registros;
+ *	- textos (livro.str): os bytes dos textos, gravados um após o outro, sem '\0' nem preenchimento.
+ *
+ * O arquivo de lista fica apenas com os campos usados nas varreduras, contagens e atualizações
+ * de quantidade; os textos só são lidos quando exibidos ou comparados. A área de textos só
+ * cresce: textos não são alterados nem removidos depois de gravados.
+ */
+
+#define EXTENSAO_REFERENCIAS_TEXTO ".col"
+#define EXTENSAO_TEXTOS ".str"
+
+#define MAX_COLUNAS_TEXTO 4
+
+/*
+ * REFERENCIA_TEXTO - localização de um texto no arquivo de textos
+ *
+ * @deslocamento - posição do primeiro byte do texto no arquivo
+ * @tamanho - quantidade de bytes do texto (0 para texto vazio)
+ */
+typedef struct {
+	unsigned int deslocamento;
+	unsigned int tamanho;
+} REFERENCIA_TEXTO;
+
+/*
+ * AREA_TEXTOS - área de textos aberta
+ *
+ * @referencias - arquivo de referências
+ * @arquivo - arquivo de textos
+ * @tamanho - tamanho atual do arquivo de textos; o próximo texto é gravado a partir daqui
+ * @num_colunas - quantidade de referências por posição (até MAX_COLUNAS_TEXTO)
+ * @somente_anexar - 1 se os textos foram abertos em modo "a" (gravações sem posicionamento, sem leituras)
+ * @posicao_referencias - deslocamento atual do arquivo de referências depois de uma gravação
+ * (-1 se desconhecido); gravações em posições consecutivas não reposicionam o arquivo
+ */
+typedef struct {
+	FILE* referencias;
+	FILE* arquivo;
+	long tamanho;
+	int num_colunas;
+	int somente_anexar;
+	long posicao_referencias;
+} AREA_TEXTOS;
+
+/*
+ * textos_abrir - abre a área de textos de um arquivo de lista
+ *
+ * @area - estrutura a ser preenchida
+ * @caminho_lista - caminho completo do arquivo de lista (as extensões são trocadas por
+ * EXTENSAO_REFERENCIAS_TEXTO e EXTENSAO_TEXTOS)
+ * @num_colunas - quantidade de colunas de texto por registro
+ * @modo - "rb" (consultas), "r+b" (consultas e gravações) ou "ab" (gravações; os textos são
+ * apenas acrescentados, sem reposicionar o arquivo a cada texto; usado pela carga em lote)
+ *
+ * Pré-condições:
+ *	- Os dois arquivos devem existir.
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ABRIR_ARQUIVO (-10) ou ERRO_ARQUIVO_SEEK (-1).
+ *	- Em caso de erro, nada fica aberto.
+ */
+int textos_abrir(AREA_TEXTOS* area, const char* caminho_lista, int num_colunas, const char* modo);
+
+/*
+ * textos_criar - cria (ou esvazia) os arquivos da área de textos de um arquivo de lista
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou ERRO_ABRIR_ARQUIVO (-10).
+ */
+int textos_criar(const char* caminho_lista);
+
+/*
+ * textos_fechar - fecha uma área de textos (area->arquivo NULL é ignorado)
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou ERRO_ARQUIVO_WRITE (-2) se os dados pendentes não puderem ser gravados.
+ */
+int textos_fechar(AREA_TEXTOS* area);
+
+/*
+ * textos_descarregar - grava nos arquivos o que ainda está no buffer do stdio (area->arquivo NULL é ignorado)
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou ERRO_ARQUIVO_WRITE (-2).
+ */
+int textos_descarregar(AREA_TEXTOS* area);
+
+/*
+ * textos_medir - relê o tamanho do arquivo de textos, que pode ter sido aumentado por outro processo
+ *
+ * Pós-condições:
+ *	- O próximo texto é gravado no fim atual do arquivo; as referências em buffer são gravadas antes.
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_WRITE (-2).
+ */
+int textos_medir(AREA_TEXTOS* area);
+
+/*
+ * textos_gravar - acrescenta um texto ao final do arquivo de textos
+ *
+ * @area - área aberta em "r+b" ou "ab"
+ * @texto - texto terminado em '\0'
+ * @referencia - ponteiro onde a localização do texto é armazenada
+ *
+ * Pós-condições:
+ *	- Textos vazios não ocupam espaço (referência {0, 0}).
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_WRITE (-2).
+ */
+int textos_gravar(AREA_TEXTOS* area, const char* texto, REFERENCIA_TEXTO* referencia);
+
+/*
+ * textos_gravar_referencias - grava as referências de uma posição da lista
+ *
+ * @area - área aberta em "r+b" ou "ab"
+ * @posicao - posição do registro no arquivo de lista
+ * @referencias - num_colunas referências
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_WRITE (-2).
+ */
+int textos_gravar_referencias(AREA_TEXTOS* area, int posicao, const REFERENCIA_TEXTO* referencias);
+
+/*
+ * textos_ler_referencias - lê as referências de uma posição da lista
+ *
+ * @area - área aberta
+ * @posicao - posição do registro no arquivo de lista
+ * @referencias - vetor que recebe num_colunas referências
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_READ (-3).
+ */
+int textos_ler_referencias(AREA_TEXTOS* area, int posicao, REFERENCIA_TEXTO* referencias);
+
+/*
+ * textos_ler_referencias_intervalo - lê de uma só vez as referências de posições consecutivas
+ *
+ * @area - área aberta
+ * @posicao - primeira posição
+ * @quantidade - quantidade de posições
+ * @referencias - vetor que recebe quantidade * num_colunas referências, posição a posição
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_READ (-3).
+ */
+int textos_ler_referencias_intervalo(AREA_TEXTOS* area, int posicao, int quantidade, REFERENCIA_TEXTO* referencias);
+
+/*
+ * textos_ler - copia um texto para um buffer terminado em '\0'
+ *
+ * @area - área aberta em "rb" ou "r+b"
+ * @referencia - localização do texto
+ * @destino - buffer de destino
+ * @capacidade - tamanho do buffer (incluindo o '\0'); textos maiores são truncados
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_READ (-3).
+ */
+int textos_ler(AREA_TEXTOS* area, REFERENCIA_TEXTO referencia, char* destino, size_t capacidade);
+
+/*
+ * textos_ler_trecho - copia um trecho contínuo do arquivo de textos, sem acrescentar '\0'
+ *
+ * @area - área aberta em "rb" ou "r+b"
+ * @deslocamento - primeiro byte do trecho
+ * @tamanho - quantidade de bytes
+ * @destino - buffer com pelo menos tamanho bytes
+ *
+ * Usado pelas varreduras, que leem em blocos os textos de várias posições de uma vez.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_READ (-3).
+ */
+int textos_ler_trecho(AREA_TEXTOS* area, long deslocamento, size_t tamanho, char* destino);
+
+/*
+ * textos_igual - compara um texto da área com um texto em memória
+ *
+ * Textos de tamanhos diferentes são descartados sem acesso ao arquivo.
+ *
+ * Pós-condições:
+ *	- Retorna 1 se forem iguais, 0 se forem diferentes.
+ *	- Retorna ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_READ (-3) em caso de erro.
+ */
+int textos_igual(AREA_TEXTOS* area, REFERENCIA_TEXTO referencia, const char* texto);
+
+#endif // TEXTOS_H
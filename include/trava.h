@@ -0,0 +1,43 @@
+#ifndef TRAVA_H
+#define TRAVA_H
+
+#include <stdio.h>
+
+/*
+ * Travas de regiões de arquivos entre processos (fcntl), usadas para que vários processos
+ * abram a mesma base ao mesmo tempo (biblioteca.h).
+ *
+ * Uma região travada em modo compartilhado pode ser travada da mesma forma por outros processos;
+ * em modo exclusivo, por nenhum outro. As travas valem só entre processos que também as pedem
+ * (não impedem leituras e gravações) e são liberadas pelo sistema quando o processo termina.
+ *
+ * No Linux são usadas travas da descrição de arquivo aberto (F_OFD_SETLK): pertencem ao FILE
+ * usado para obtê-las e não são afetadas por outros descritores do mesmo arquivo no processo.
+ * Nos demais sistemas POSIX são usadas as travas tradicionais (F_SETLK), que pertencem ao
+ * processo e são perdidas quando qualquer descritor do arquivo é fechado. No Windows não têm efeito.
+ */
+
+typedef enum {
+	TRAVA_LIVRE,		// libera a região
+	TRAVA_COMPARTILHADA,	// leitura: outros processos também podem ler
+	TRAVA_EXCLUSIVA		// escrita: nenhum outro processo trava a região
+} tipo_trava;
+
+/*
+ * travar_regiao - trava, converte ou libera uma região de um arquivo
+ *
+ * @arquivo - arquivo aberto para leitura (trava compartilhada) ou escrita (exclusiva)
+ * @tipo - TRAVA_COMPARTILHADA, TRAVA_EXCLUSIVA ou TRAVA_LIVRE
+ * @inicio - primeiro byte da região
+ * @tamanho - quantidade de bytes (0 vai até o fim do arquivo, inclusive bytes acrescentados depois)
+ * @esperar - 1 para esperar a liberação por outro processo, 0 para falhar imediatamente
+ *
+ * Uma região já travada pelo mesmo FILE muda de modo (a conversão também pode esperar).
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_TRAVA_OCUPADA (-34) se esperar for 0 e outro processo tiver
+ *	a região em modo incompatível, ou ERRO_TRAVAR_ARQUIVO (-33) em outros erros.
+ */
+int travar_regiao(FILE* arquivo, tipo_trava tipo, long inicio, long tamanho, int esperar);
+
+#endif // TRAVA_H
@@ -0,0 +1,52 @@
+#ifndef TRIGRAMAS_H
+#define TRIGRAMAS_H
+
+#include <stddef.h>
+
+/*
+ * Trigramas: sequências de 3 bytes consecutivos de um texto normalizado, usadas como termos do
+ * índice invertido de busca textual (livro_trigrama.idx).
+ *
+ * Na normalização, letras ASCII viram minúsculas, letras acentuadas em UTF-8 (Latin-1, ex.: "Ç",
+ * "ã") viram a letra sem acento e qualquer sequência de caracteres que não sejam letras ou
+ * dígitos vira um único espaço. Assim "Dom  Casmurro!" e "dom casmurro" têm os mesmos trigramas,
+ * e um trecho do texto normalizado tem todos os seus trigramas no texto completo.
+ */
+
+#define TAM_TRIGRAMA 3
+
+/*
+ * normalizar_texto - normaliza um texto para extração de trigramas e comparação
+ *
+ * @texto - texto original, terminado em '\0'
+ * @destino - buffer que recebe o texto normalizado, sem espaços no início e no fim
+ * @capacidade - tamanho do buffer (incluindo o '\0'); strlen(texto) + 1 sempre é suficiente
+ *
+ * Pós-condições:
+ *	- Retorna o tamanho do texto normalizado.
+ */
+size_t normalizar_texto(const char* texto, char* destino, size_t capacidade);
+
+/*
+ * extrair_trigramas - acrescenta a um vetor os trigramas de um texto normalizado
+ *
+ * @normalizado - texto já normalizado (normalizar_texto)
+ * @trigramas - vetor contínuo de trigramas (TAM_TRIGRAMA bytes cada)
+ * @quantidade - quantidade de trigramas já presentes no vetor
+ * @capacidade - quantidade máxima de trigramas do vetor
+ *
+ * Pós-condições:
+ *	- Retorna a nova quantidade de trigramas do vetor; os que não couberem são descartados.
+ *	- Textos com menos de TAM_TRIGRAMA bytes não têm trigramas.
+ */
+int extrair_trigramas(const char* normalizado, unsigned char* trigramas, int quantidade, int capacidade);
+
+/*
+ * ordenar_trigramas - ordena um vetor de trigramas (memcmp) e remove os repetidos
+ *
+ * Pós-condições:
+ *	- Retorna a quantidade de trigramas distintos, no início do vetor.
+ */
+int ordenar_trigramas(unsigned char* trigramas, int quantidade);
+
+#endif // TRIGRAMAS_H
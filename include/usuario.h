@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include "erros.h"
+#include "biblioteca.h"
 
 #define MAX_NOME 50
 
@@ -12,11 +13,16 @@
  * @codigo - identificador único do usuário
  * @nome - nome do usuário
  * @proximo - identificador para o próximo usuário na lista encadeada
+ * @primeiro_emprestimo - posição em emprestimo.dat do último empréstimo registrado para o usuário (-1 se não houver)
+ *
+ * primeiro_emprestimo inicia a lista dos empréstimos do usuário (ver EMPRESTIMO.proximo_usuario);
+ * é mantido pelos empréstimos, e os cadastros sempre o iniciam com -1.
  */
 typedef struct usuario {
 	unsigned int codigo;
 	char nome[MAX_NOME + 1];
 	int proximo;
+	int primeiro_emprestimo;
 } USUARIO;
 
 /*
@@ -30,7 +36,8 @@ typedef struct usuario {
  *	- O arquivo deve conter um cabeçalho válido para gerenciar a lista encadeada de usuários.
  *
  * Pós-condições:
- *	- Um novo registro de usuário é inserido no arquivo, reutilizando posições livres se existirem.
+ *	- Um novo registro de usuário é inserido no arquivo, reutilizando posições livres se existirem,
+ *	ainda sem empréstimos (primeiro_emprestimo = -1).
  *	- O cabeçalho do arquivo é atualizado para refletir a nova cabeça da lista encadeada e possíveis posições livres.
  *	- Retorna SUCESSO (0) em caso de sucesso.
  *	- Retorna valores negativos em caso de erro:
@@ -43,4 +50,88 @@ typedef struct usuario {
  */
 int cadastrar_usuario(const char *nome_arquivo, USUARIO usuario);
 
+/*
+ * localizar_usuario - busca um usuário pelo código utilizando a árvore B+ do arquivo (usuario.idx)
+ *
+ * @usuarios - arquivo de usuários da biblioteca, que mantém a árvore aberta (biblioteca_indice)
+ * @codigo - código do usuário procurado
+ * @usuario - ponteiro onde o registro encontrado será armazenado
+ * @posicao - ponteiro onde a posição do registro no arquivo será armazenada
+ *
+ * Pré-condições:
+ *	- O arquivo deve estar aberto e conter um cabeçalho válido.
+ * Pós-condições:
+ *	- Se o índice não existir ou estiver desatualizado, ele é reconstruído a partir da lista.
+ *	- Retorna SUCESSO (0) se o usuário foi encontrado.
+ *	- Retorna ERRO_ENCONTRAR_USUARIO (-16) se não existir usuário com o código informado.
+ *	- Retorna outro valor negativo em caso de falha de leitura.
+ */
+int localizar_usuario(ARQUIVO_BIBLIOTECA *usuarios, unsigned int codigo, USUARIO *usuario, int *posicao);
+
+/*
+ * construir_indice_usuario - monta a árvore B+ de usuários (usuario.idx) a partir de pares código/posição
+ *
+ * @nome_arquivo - caminho para o arquivo binário de usuários
+ * @codigos - códigos dos usuários, em qualquer ordem
+ * @posicoes - posição de cada usuário no arquivo de dados
+ * @quantidade - número de usuários
+ *
+ * Usada quando os pares já estão em memória (ex.: carga em lote), evitando percorrer a lista.
+ *
+ * Pós-condições:
+ *	- O arquivo de índice é recriado; em códigos repetidos apenas um deles é mantido.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna ERRO_ESCREVER_INDICE (-28) ou ERRO_ABRIR_ARQUIVO (-10) em caso de erro.
+ */
+int construir_indice_usuario(const char *nome_arquivo, const unsigned int *codigos, const int *posicoes, int quantidade);
+
+/*
+ * reconstruir_indice_usuario - recria a árvore B+ de usuários (usuario.idx) a partir da lista
+ *
+ * @nome_arquivo - caminho para o arquivo binário de usuários
+ *
+ * Pré-condições:
+ *	- O arquivo deve existir e conter um cabeçalho válido.
+ * Pós-condições:
+ *	- A árvore é montada de baixo para cima com os códigos ordenados.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valor negativo em caso de erro.
+ */
+int reconstruir_indice_usuario(const char *nome_arquivo);
+
+/*
+ * listar_usuarios_intervalo - lista, em ordem crescente de código, os usuários de uma faixa de códigos
+ *
+ * @nome_arquivo - caminho para o arquivo binário de usuários
+ * @codigo_inicial - menor código da faixa (inclusive)
+ * @codigo_final - maior código da faixa (inclusive)
+ *
+ * Pré-condições:
+ *	- O arquivo deve existir e conter um cabeçalho válido.
+ * Pós-condições:
+ *	- Código e nome de cada usuário da faixa são exibidos na tela.
+ *	- Caso nenhum usuário seja encontrado, uma mensagem informando isso é exibida.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ABRIR_ARQUIVO (-10): falha ao abrir o arquivo.
+ *		- ERRO_LER_INDICE (-27): falha ao percorrer a árvore B+.
+ *		- ERRO_LER_USUARIO (-13): falha ao ler o nó do usuário no arquivo.
+ */
+int listar_usuarios_intervalo(const char *nome_arquivo, unsigned int codigo_inicial, unsigned int codigo_final);
+
+/*
+ * Versões de cadastrar_usuario e listar_usuarios_intervalo sobre uma BIBLIOTECA aberta (biblioteca_abrir)
+ *
+ * Mesmos parâmetros, saída e códigos de retorno, usando o arquivo de usuários e o cabeçalho
+ * residentes em vez de abrir o arquivo a cada chamada.
+ *
+ * Pré-condições:
+ *	- biblioteca->usuarios deve estar aberto.
+ * Pós-condições:
+ *	- biblioteca_cadastrar_usuario atualiza o cabeçalho residente apenas quando a gravação tem sucesso.
+ *	- Confirmado o cadastro, a falha na árvore B+ não é retornada: ela é reconstruída a partir da lista.
+ */
+int biblioteca_cadastrar_usuario(BIBLIOTECA* biblioteca, USUARIO usuario);
+int biblioteca_listar_usuarios_intervalo(BIBLIOTECA* biblioteca, unsigned int codigo_inicial, unsigned int codigo_final);
+
 #endif // _USUARIO_H
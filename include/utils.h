@@ -88,19 +88,79 @@ unsigned int ler_unsigned_int_direto();
 void construir_caminho_completo(char* caminho_base, const char* nome_arquivo);
 
 /*
- * obter_data_atual - obtém a data atual formatada como string
+ * trocar_extensao - monta o caminho de um arquivo auxiliar trocando a extensão do caminho original
  *
- * @buffer - buffer onde a data será escrita
- * @tamanho - tamanho máximo do buffer
+ * @destino - buffer onde o novo caminho será escrito (tamanho mínimo TAM_MAX_CAMINHO)
+ * @caminho - caminho original (ex.: "/dados/livro.dat")
+ * @extensao - nova extensão, incluindo o ponto (ex.: ".idx")
+ *
+ * Pre-condicoes:
+ *	- destino deve ter espaco para TAM_MAX_CAMINHO caracteres.
+ *	- caminho e extensao devem ser strings validas.
+ *
+ * Pos-condicoes:
+ *	- destino recebe o caminho original com a extensao trocada (ex.: "/dados/livro.idx").
+ *	- Caso o nome do arquivo nao tenha extensao, a nova extensao e apenas concatenada.
+ */
+void trocar_extensao(char* destino, const char* caminho, const char* extensao);
+
+/*
+ * substituir_arquivo - troca um arquivo pelo arquivo temporário que o reescreveu
+ *
+ * @origem - arquivo novo (ex.: "/dados/livro_conv.dat")
+ * @destino - arquivo a ser substituído (ex.: "/dados/livro.dat")
+ *
+ * Pos-condicoes:
+ *	- Retorna 0 em caso de sucesso ou valor diferente de 0 se a troca falhar.
+ *	- No Windows, que não renomeia sobre um arquivo existente, destino é removido antes.
+ */
+int substituir_arquivo(const char* origem, const char* destino);
+
+/*
+ * Datas são guardadas como número de dias: 1 corresponde a 01/01/0001 e cada dia seguinte soma 1,
+ * de forma que datas podem ser comparadas, subtraídas e indexadas como inteiros.
+ * DATA_NULA (0) indica ausência de data (ex.: empréstimo ainda não devolvido).
+ */
+#define DATA_NULA 0
+#define DATA_DESCONHECIDA -1	// data registrada que não pôde ser interpretada (bases antigas)
+#define TAM_DATA_TEXTO 11	// "DD/MM/AAAA" com '\0'
+
+/*
+ * converter_data - converte uma data no formato DD/MM/AAAA em número de dias
+ *
+ * @texto - data em texto; dia e mês podem ter um ou dois dígitos, o ano tem quatro
+ * @dias - ponteiro onde o número de dias será armazenado
+ *
+ * Pos-condicoes:
+ *	- Retorna SUCESSO (0) e preenche *dias se a data existir no calendário (anos 0001 a 9999).
+ *	- Retorna ERRO_DATA_INVALIDA (-26) caso contrário; *dias não é alterado.
+ */
+int converter_data(const char* texto, int* dias);
+
+/*
+ * formatar_data - escreve um número de dias no formato DD/MM/AAAA
+ *
+ * @dias - data em número de dias (ver converter_data)
+ * @buffer - buffer com pelo menos TAM_DATA_TEXTO bytes
+ * @tamanho - tamanho do buffer
+ *
+ * Pos-condicoes:
+ *	- DATA_NULA é escrita como texto vazio e DATA_DESCONHECIDA como "--/--/----".
+ */
+void formatar_data(int dias, char* buffer, size_t tamanho);
+
+/*
+ * obter_data_atual - obtém a data atual (local) em número de dias
+ *
+ * @dias - ponteiro onde a data será armazenada
  *
  * Pré-condições:
- *	- 'buffer' deve ser um ponteiro v�lido com espa�o suficiente.
+ *	- 'dias' deve ser um ponteiro válido.
  * Pós-condições:
- *	- Em caso de sucesso, grava a data atual no formato DD/MM/AAAA no buffer.
  *	- Retorna SUCESSO (0) se a operação for bem-sucedida.
- *	- Retorna ERRO_OBTER_DATA (-12) se não for possível obter a data.
+ *	- Retorna ERRO_OBTER_DATA (-25) se não for possível obter a data.
  */
-int obter_data_atual(char *buffer, size_t tamanho);
+int obter_data_atual(int *dias);
 
 /*
  * ler_inteiro_seguro - le um valor inteiro da entrada padrao com validacao de caracteres
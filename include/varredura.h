@@ -0,0 +1,71 @@
+#ifndef VARREDURA_H
+#define VARREDURA_H
+
+#include <stddef.h>
+
+/*
+ * Núcleo de varredura: comparações e buscas de trechos sobre blocos de bytes, usadas pelos
+ * filtros que percorrem a área de textos inteira (livro.str) sem índice.
+ *
+ * Há três implementações, escolhidas em tempo de execução pela maior que o processador suportar:
+ *	- NIVEL_VARREDURA_AVX2: 32 bytes por instrução (x86 com AVX2);
+ *	- NIVEL_VARREDURA_SSE2: 16 bytes por instrução (todo x86-64);
+ *	- NIVEL_VARREDURA_ESCALAR: um byte por vez, em qualquer plataforma.
+ * As versões vetoriais só existem com GCC ou Clang em x86; compilando com
+ * -DVARREDURA_SOMENTE_ESCALAR, apenas a escalar é usada.
+ *
+ * A busca de trechos compara, a cada bloco, o primeiro e o último byte do padrão com todas as
+ * posições do bloco de uma vez, e só confere o padrão inteiro nas posições em que os dois batem.
+ * Com ignorar_caixa, letras ASCII maiúsculas e minúsculas são equivalentes (acentos não).
+ */
+
+#define NIVEL_VARREDURA_ESCALAR	0
+#define NIVEL_VARREDURA_SSE2	1
+#define NIVEL_VARREDURA_AVX2	2
+
+/*
+ * varredura_nivel_maximo - maior nível suportado pelo processador (e pela compilação)
+ */
+int varredura_nivel_maximo(void);
+
+/*
+ * varredura_definir_nivel - escolhe o nível usado pelas funções de varredura
+ *
+ * @nivel - nível desejado; valores acima de varredura_nivel_maximo() são reduzidos a ele
+ *
+ * Por padrão é usado o nível máximo; trocar o nível serve para comparações de desempenho.
+ *
+ * Pós-condições:
+ *	- Retorna o nível efetivamente usado.
+ */
+int varredura_definir_nivel(int nivel);
+
+/*
+ * varredura_nome_nivel - nome de um nível para exibição ("AVX2", "SSE2" ou "escalar")
+ */
+const char* varredura_nome_nivel(int nivel);
+
+/*
+ * varredura_procurar - procura a primeira ocorrência de um padrão num bloco de bytes
+ *
+ * @texto - bloco onde procurar (não precisa terminar em '\0')
+ * @tamanho - tamanho do bloco
+ * @padrao - padrão procurado
+ * @tamanho_padrao - tamanho do padrão
+ * @ignorar_caixa - 1 para tratar letras ASCII maiúsculas e minúsculas como iguais
+ *
+ * Pós-condições:
+ *	- Retorna o deslocamento da primeira ocorrência ou tamanho se não houver nenhuma.
+ *	- Um padrão vazio ocorre no deslocamento 0.
+ */
+size_t varredura_procurar(const char* texto, size_t tamanho, const char* padrao, size_t tamanho_padrao, int ignorar_caixa);
+
+/*
+ * varredura_iguais - compara dois blocos de bytes do mesmo tamanho
+ *
+ * Pós-condições:
+ *	- Retorna 1 se forem iguais (com ignorar_caixa, sem diferenciar letras ASCII maiúsculas e minúsculas), 0 caso contrário.
+ */
+int varredura_iguais(const char* a, const char* b, size_t tamanho, int ignorar_caixa);
+
+#endif // VARREDURA_H
@@ -0,0 +1,776 @@
+#include "../include/armazenamento.h"
+#include "../include/arquivo.h"
+#include "../include/cache_paginas.h"
+#include "../include/diario.h"
+#include "../include/erros.h"
+#include "../include/utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define fsync _commit
+#else
+#include <unistd.h>
+#endif
+
+#if defined(ARMAZENAMENTO_MMAP) && !defined(_WIN32)
+#define USAR_MAPEAMENTO
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef USAR_MAPEAMENTO
+
+/*
+ * MAPA_ARQUIVO - mapeamento de um arquivo de lista, mantido durante toda a execução
+ *
+ * @caminho - caminho usado na abertura (chave de busca do mapeamento)
+ * @descritor - descritor aberto em leitura/escrita usado no mmap e no ftruncate
+ * @base - início do mapeamento (NULL enquanto o arquivo estiver vazio)
+ * @tamanho_mapa - quantidade de bytes mapeados
+ * @tamanho_registro - tamanho dos registros acessados (usado para truncar o arquivo no encerramento)
+ * @estendido - indica se o arquivo foi aumentado por extensões além do tamanho ocupado
+ */
+typedef struct {
+        char caminho[TAM_MAX_CAMINHO];
+        int descritor;
+        unsigned char* base;
+        size_t tamanho_mapa;
+        size_t tamanho_registro;
+        int estendido;
+} MAPA_ARQUIVO;
+
+/*
+ * ASSOCIACAO_MAPA - liga um FILE* aberto por abrir_arquivo_dados ao mapeamento do seu arquivo
+ */
+typedef struct {
+        FILE* arquivo;
+        MAPA_ARQUIVO* mapa;
+} ASSOCIACAO_MAPA;
+
+static MAPA_ARQUIVO mapas[MAX_ARQUIVOS_MAPEADOS];
+static int num_mapas = 0;
+static ASSOCIACAO_MAPA associacoes[MAX_ARQUIVOS_ABERTOS];
+static int encerramento_registrado = 0;
+
+/*
+ * remapear - função interna que refaz o mapeamento com um novo tamanho
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou ERRO_ARQUIVO_READ (-3) se o mmap falhar (o mapa fica vazio).
+ */
+static int remapear(MAPA_ARQUIVO* mapa, size_t novo_tamanho) {
+        if(mapa->base != NULL)
+                munmap(mapa->base, mapa->tamanho_mapa);
+        mapa->base = NULL;
+        mapa->tamanho_mapa = 0;
+
+        if(novo_tamanho == 0)
+                return SUCESSO;
+
+        void* base = mmap(NULL, novo_tamanho, PROT_READ | PROT_WRITE, MAP_SHARED, mapa->descritor, 0);
+        if(base == MAP_FAILED)
+                return ERRO_ARQUIVO_READ;
+
+        mapa->base = base;
+        mapa->tamanho_mapa = novo_tamanho;
+        return SUCESSO;
+}
+
+/*
+ * garantir_mapa - função interna que garante que os bytes [0, fim) estejam mapeados
+ *
+ * @mapa - mapeamento do arquivo
+ * @fim - deslocamento final (exclusivo) que será acessado
+ * @escrita - se diferente de 0, o arquivo é aumentado quando for menor que fim
+ *
+ * O arquivo pode ter crescido por outro caminho (ex.: carga em lote por stdio), por isso o
+ * tamanho real é consultado antes de aumentar. Aumentos são feitos em múltiplos de EXTENSAO_MAPA.
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) se a região estiver mapeada.
+ *      - Retorna ERRO_ARQUIVO_READ (-3) em leituras além do fim do arquivo ou falha no mmap.
+ *      - Retorna ERRO_ARQUIVO_WRITE (-2) se não for possível aumentar o arquivo.
+ */
+static int garantir_mapa(MAPA_ARQUIVO* mapa, size_t fim, int escrita) {
+        if(fim <= mapa->tamanho_mapa)
+                return SUCESSO;
+
+        struct stat info;
+        if(fstat(mapa->descritor, &info) != 0)
+                return ERRO_ARQUIVO_READ;
+
+        size_t tamanho_arquivo = (size_t)info.st_size;
+        if(tamanho_arquivo < fim) {
+                if(!escrita)
+                        return ERRO_ARQUIVO_READ;
+
+                size_t novo_tamanho = (fim + EXTENSAO_MAPA - 1) / EXTENSAO_MAPA * EXTENSAO_MAPA;
+                if(ftruncate(mapa->descritor, (off_t)novo_tamanho) != 0)
+                        return ERRO_ARQUIVO_WRITE;
+                tamanho_arquivo = novo_tamanho;
+                mapa->estendido = 1;
+        }
+
+        return remapear(mapa, tamanho_arquivo);
+}
+
+/*
+ * obter_mapa - função interna que retorna o mapeamento de um caminho, criando-o na primeira vez
+ *
+ * Pós-condições:
+ *      - Retorna NULL se não houver espaço na tabela ou se o arquivo não puder ser mapeado.
+ */
+static MAPA_ARQUIVO* obter_mapa(const char* caminho) {
+        for(int i = 0; i < num_mapas; i++)
+                if(strcmp(mapas[i].caminho, caminho) == 0)
+                        return &mapas[i];
+
+        if(num_mapas == MAX_ARQUIVOS_MAPEADOS || strlen(caminho) >= TAM_MAX_CAMINHO)
+                return NULL;
+
+        MAPA_ARQUIVO* mapa = &mapas[num_mapas];
+        memset(mapa, 0, sizeof(MAPA_ARQUIVO));
+        strcpy(mapa->caminho, caminho);
+
+        mapa->descritor = open(caminho, O_RDWR);
+        if(mapa->descritor < 0)
+                return NULL;
+
+        struct stat info;
+        if(fstat(mapa->descritor, &info) != 0 || remapear(mapa, (size_t)info.st_size) != SUCESSO) {
+                close(mapa->descritor);
+                return NULL;
+        }
+
+        if(!encerramento_registrado) {
+                atexit(encerrar_armazenamento);
+                encerramento_registrado = 1;
+        }
+
+        num_mapas++;
+        return mapa;
+}
+
+/*
+ * tamanho_ocupado - função interna que calcula, pelo cabeçalho no mapeamento, o tamanho ocupado
+ * pelo arquivo (cabeçalho + pos_topo registros)
+ *
+ * Pós-condições:
+ *      - Retorna 0 se o tamanho dos registros ainda não for conhecido ou o cabeçalho não estiver mapeado.
+ */
+static size_t tamanho_ocupado(const MAPA_ARQUIVO* mapa) {
+        if(mapa->tamanho_registro == 0 || mapa->base == NULL || mapa->tamanho_mapa < sizeof(CABECALHO))
+                return 0;
+
+        CABECALHO cabecalho;
+        memcpy(&cabecalho, mapa->base, sizeof(CABECALHO));
+        if(cabecalho.pos_topo < 0)
+                return 0;
+        return sizeof(CABECALHO) + (size_t)cabecalho.pos_topo * mapa->tamanho_registro;
+}
+
+/*
+ * mapa_de - função interna que retorna o mapeamento associado a um arquivo aberto (ou NULL)
+ */
+static MAPA_ARQUIVO* mapa_de(FILE* arquivo) {
+        if(arquivo == NULL)
+                return NULL;
+        for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++)
+                if(associacoes[i].arquivo == arquivo)
+                        return associacoes[i].mapa;
+        return NULL;
+}
+
+/*
+ * regiao_mapeada - função interna que retorna o endereço de [deslocamento, deslocamento + tamanho) no mapa
+ *
+ * Pós-condições:
+ *      - Retorna NULL (com o erro em *erro) se a região não puder ser mapeada.
+ */
+static unsigned char* regiao_mapeada(MAPA_ARQUIVO* mapa, long deslocamento, size_t tamanho, int escrita, int* erro) {
+        if(deslocamento < 0) {
+                *erro = ERRO_ARQUIVO_SEEK;
+                return NULL;
+        }
+
+        *erro = garantir_mapa(mapa, (size_t)deslocamento + tamanho, escrita);
+        if(*erro != SUCESSO)
+                return NULL;
+
+        return mapa->base + deslocamento;
+}
+
+#else
+
+/*
+ * ASSOCIACAO_CACHE - liga um FILE* aberto por abrir_arquivo_dados ao seu arquivo no cache de páginas
+ */
+typedef struct {
+        FILE* arquivo;
+        int cache;
+} ASSOCIACAO_CACHE;
+
+static ASSOCIACAO_CACHE associacoes[MAX_ARQUIVOS_ABERTOS];
+static int encerramento_registrado = 0;
+
+/*
+ * cache_de - função interna que retorna o identificador no cache de um arquivo aberto (ou -1)
+ */
+static int cache_de(FILE* arquivo) {
+        if(arquivo == NULL)
+                return -1;
+        for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++)
+                if(associacoes[i].arquivo == arquivo)
+                        return associacoes[i].cache;
+        return -1;
+}
+
+#endif // USAR_MAPEAMENTO
+
+/*
+ * ASSOCIACAO_DIARIO - liga um FILE* aberto por abrir_arquivo_dados ao seu arquivo no diário (diario.h)
+ */
+typedef struct {
+        FILE* arquivo;
+        int diario;
+} ASSOCIACAO_DIARIO;
+
+static ASSOCIACAO_DIARIO acompanhados[MAX_ARQUIVOS_ABERTOS];
+
+// arquivos de lista usados também por outros processos (compartilhar_arquivos_dados)
+static int arquivos_compartilhados = 0;
+
+/*
+ * ASSOCIACAO_INDICE - liga um FILE* aberto por abrir_arquivo_indice ao seu arquivo no cache de páginas
+ */
+typedef struct {
+        FILE* arquivo;
+        int cache;
+} ASSOCIACAO_INDICE;
+
+static ASSOCIACAO_INDICE indices_abertos[MAX_ARQUIVOS_ABERTOS];
+
+/*
+ * contar_indices_cache - função interna que conta os índices abertos ligados a um arquivo do cache
+ */
+static int contar_indices_cache(int cache) {
+        int quantidade = 0;
+        for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++)
+                if(indices_abertos[i].arquivo != NULL && indices_abertos[i].cache == cache)
+                        quantidade++;
+        return quantidade;
+}
+
+/*
+ * cache_de_indice - função interna que retorna o identificador no cache de um índice aberto (ou -1)
+ */
+static int cache_de_indice(FILE* arquivo) {
+        if(arquivo == NULL)
+                return -1;
+        for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++)
+                if(indices_abertos[i].arquivo == arquivo)
+                        return indices_abertos[i].cache;
+        return -1;
+}
+
+/*
+ * diario_de - função interna que retorna o identificador no diário de um arquivo aberto (ou -1)
+ */
+static int diario_de(FILE* arquivo) {
+        if(arquivo == NULL || !diario_aberto())
+                return -1;
+        for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++)
+                if(acompanhados[i].arquivo == arquivo)
+                        return acompanhados[i].diario;
+        return -1;
+}
+
+/*
+ * ler_arquivo - função interna que copia bytes de um deslocamento do arquivo de lista, sem o diário
+ */
+static int ler_arquivo(FILE* arquivo, long deslocamento, size_t tamanho, void* destino) {
+#ifdef USAR_MAPEAMENTO
+        MAPA_ARQUIVO* mapa = mapa_de(arquivo);
+        if(mapa != NULL) {
+                int erro;
+                const unsigned char* origem = regiao_mapeada(mapa, deslocamento, tamanho, 0, &erro);
+                if(origem == NULL)
+                        return erro;
+                memcpy(destino, origem, tamanho);
+                return SUCESSO;
+        }
+#else
+        int cache = cache_de(arquivo);
+        if(cache >= 0)
+                return cache_paginas_ler(cache, deslocamento, tamanho, destino);
+#endif
+        if(fseek(arquivo, deslocamento, SEEK_SET) != 0)
+                return ERRO_ARQUIVO_SEEK;
+        if(fread(destino, tamanho, 1, arquivo) != 1)
+                return ERRO_ARQUIVO_READ;
+        return SUCESSO;
+}
+
+/*
+ * ler_dados - função interna que copia bytes de um deslocamento do arquivo de lista
+ *
+ * As gravações ainda pendentes no diário são copiadas por cima do conteúdo do arquivo; uma região
+ * que só existe no diário (registro novo além do fim do arquivo) é lida inteiramente dele.
+ */
+static int ler_dados(FILE* arquivo, long deslocamento, size_t tamanho, void* destino) {
+        int retorno = ler_arquivo(arquivo, deslocamento, tamanho, destino);
+
+        int diario = diario_de(arquivo);
+        if(diario < 0 || retorno == ERRO_ARQUIVO_SEEK)
+                return retorno;
+
+        if(retorno != SUCESSO)
+                memset(destino, 0, tamanho);
+        if(diario_sobrepor(diario, deslocamento, tamanho, destino) && retorno == ERRO_ARQUIVO_READ)
+                retorno = SUCESSO;
+        return retorno;
+}
+
+/*
+ * gravar_dados - função interna que grava bytes em um deslocamento do arquivo de lista, sem o diário
+ */
+static int gravar_dados(FILE* arquivo, long deslocamento, size_t tamanho, const void* origem) {
+#ifdef USAR_MAPEAMENTO
+        MAPA_ARQUIVO* mapa = mapa_de(arquivo);
+        if(mapa != NULL) {
+                int erro;
+                unsigned char* destino = regiao_mapeada(mapa, deslocamento, tamanho, 1, &erro);
+                if(destino == NULL)
+                        return erro == ERRO_ARQUIVO_READ ? ERRO_ARQUIVO_WRITE : erro;
+                memcpy(destino, origem, tamanho);
+                return SUCESSO;
+        }
+#else
+        int cache = cache_de(arquivo);
+        if(cache >= 0)
+                return cache_paginas_escrever(cache, deslocamento, tamanho, origem);
+#endif
+        if(fseek(arquivo, deslocamento, SEEK_SET) != 0)
+                return ERRO_ARQUIVO_SEEK;
+        if(fwrite(origem, tamanho, 1, arquivo) != 1)
+                return ERRO_ARQUIVO_WRITE;
+        return SUCESSO;
+}
+
+/*
+ * escrever_dados - função interna que grava bytes em um deslocamento do arquivo de lista
+ *
+ * Com o diário aberto, a gravação fica nele até a operação ser confirmada e o grupo sincronizado.
+ */
+static int escrever_dados(FILE* arquivo, long deslocamento, size_t tamanho, const void* origem) {
+        int diario = diario_de(arquivo);
+        if(diario >= 0)
+                return diario_anotar(diario, deslocamento, tamanho, origem);
+        return gravar_dados(arquivo, deslocamento, tamanho, origem);
+}
+
+void compartilhar_arquivos_dados(void) {
+        arquivos_compartilhados = 1;
+}
+
+FILE* abrir_arquivo_dados(const char* caminho, const char* modo) {
+        FILE* arquivo = fopen(caminho, modo);
+
+        // o buffer do stdio guardaria trechos que outro processo pode ter alterado
+        if(arquivo != NULL && arquivos_compartilhados)
+                setvbuf(arquivo, NULL, _IONBF, 0);
+
+        int diario = diario_arquivo(caminho);
+        if(arquivo != NULL && diario >= 0) {
+                for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++) {
+                        if(acompanhados[i].arquivo == NULL) {
+                                acompanhados[i].arquivo = arquivo;
+                                acompanhados[i].diario = diario;
+                                break;
+                        }
+                }
+        }
+#ifdef USAR_MAPEAMENTO
+        if(arquivo == NULL)
+                return NULL;
+
+        MAPA_ARQUIVO* mapa = obter_mapa(caminho);
+        if(mapa == NULL)
+                return arquivo;     // sem mapeamento: acessos continuam por stdio
+
+        for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++) {
+                if(associacoes[i].arquivo == NULL) {
+                        associacoes[i].arquivo = arquivo;
+                        associacoes[i].mapa = mapa;
+                        break;
+                }
+        }
+#else
+        if(arquivo == NULL)
+                return NULL;
+
+        int cache = cache_paginas_abrir(caminho);
+        if(cache < 0)
+                return arquivo;     // cache desativado ou cheio: o caminho nunca passa pelo cache, acessos por stdio
+
+        for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++) {
+                if(associacoes[i].arquivo == NULL) {
+                        associacoes[i].arquivo = arquivo;
+                        associacoes[i].cache = cache;
+
+                        if(!encerramento_registrado) {
+                                atexit(encerrar_armazenamento);
+                                encerramento_registrado = 1;
+                        }
+                        return arquivo;
+                }
+        }
+
+        // sem associação, leituras por stdio não enxergariam as páginas sujas do cache
+        for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++)
+                if(acompanhados[i].arquivo == arquivo)
+                        acompanhados[i].arquivo = NULL;
+        fclose(arquivo);
+        arquivo = NULL;
+#endif
+        return arquivo;
+}
+
+int fechar_arquivo_dados(FILE* arquivo) {
+        if(arquivo == NULL)
+                return 0;
+
+        int retorno = SUCESSO;
+        for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++) {
+                if(acompanhados[i].arquivo == arquivo) {
+                        acompanhados[i].arquivo = NULL;
+                        break;
+                }
+        }
+#ifdef USAR_MAPEAMENTO
+        for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++) {
+                if(associacoes[i].arquivo == arquivo) {
+                        associacoes[i].arquivo = NULL;
+                        associacoes[i].mapa = NULL;
+                        break;
+                }
+        }
+#else
+        int cache = cache_de(arquivo);
+        if(cache >= 0) {
+                int outros = 0;
+                for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++) {
+                        if(associacoes[i].arquivo == arquivo) {
+                                associacoes[i].arquivo = NULL;
+                                associacoes[i].cache = -1;
+                        } else if(associacoes[i].arquivo != NULL && associacoes[i].cache == cache) {
+                                outros++;
+                        }
+                }
+
+                // sem nenhum FILE aberto, outro processo pode alterar o arquivo antes da próxima
+                // abertura: as páginas não são reaproveitadas e o caminho é lido de novo
+                retorno = outros > 0 ? cache_paginas_descarregar(cache) : cache_paginas_fechar(cache);
+        }
+#endif
+        int fechamento = fclose(arquivo);
+        return retorno != SUCESSO ? retorno : fechamento;
+}
+
+int descarregar_arquivo_dados(FILE* arquivo) {
+        if(arquivo == NULL)
+                return SUCESSO;
+
+        int retorno = SUCESSO;
+#ifndef USAR_MAPEAMENTO
+        int cache = cache_de(arquivo);
+        if(cache >= 0)
+                retorno = cache_paginas_descarregar(cache);
+#endif
+        if(fflush(arquivo) != 0 && retorno == SUCESSO)
+                retorno = ERRO_ARQUIVO_WRITE;
+        return retorno;
+}
+
+int descarregar_caminho_dados(const char* caminho) {
+        // as operações confirmadas no diário passam a estar no arquivo
+        if(diario_arquivo(caminho) >= 0) {
+                int retorno = diario_sincronizar();
+                if(retorno != SUCESSO)
+                        return retorno;
+        }
+#ifndef USAR_MAPEAMENTO
+        int cache = cache_paginas_buscar(caminho);
+        if(cache >= 0)
+                return cache_paginas_descarregar(cache);
+#else
+        (void)caminho;
+#endif
+        return SUCESSO;
+}
+
+int descartar_caminho_dados(const char* caminho) {
+#ifndef USAR_MAPEAMENTO
+        int cache = cache_paginas_buscar(caminho);
+        if(cache >= 0)
+                return cache_paginas_descartar(cache);
+#else
+        // o último processo a fechar a base pode ter removido as extensões: o mapeamento não pode
+        // continuar além do fim do arquivo
+        for(int i = 0; i < num_mapas; i++) {
+                struct stat info;
+                if(strcmp(mapas[i].caminho, caminho) == 0 && fstat(mapas[i].descritor, &info) == 0 && (size_t)info.st_size < mapas[i].tamanho_mapa)
+                        return remapear(&mapas[i], (size_t)info.st_size);
+        }
+#endif
+        return SUCESSO;
+}
+
+int encolher_arquivos_dados(void) {
+        int retorno = SUCESSO;
+#ifdef USAR_MAPEAMENTO
+        for(int i = 0; i < num_mapas; i++) {
+                MAPA_ARQUIVO* mapa = &mapas[i];
+                size_t ocupado = tamanho_ocupado(mapa);
+
+                // o arquivo pode ter sido aumentado por outro processo: vale o tamanho real
+                struct stat info;
+                if(ocupado == 0 || fstat(mapa->descritor, &info) != 0 || (size_t)info.st_size <= ocupado)
+                        continue;
+
+                remapear(mapa, 0);
+                if(ftruncate(mapa->descritor, (off_t)ocupado) != 0)
+                        retorno = ERRO_ARQUIVO_WRITE;
+                else
+                        mapa->estendido = 0;
+                if(fstat(mapa->descritor, &info) != 0 || remapear(mapa, (size_t)info.st_size) != SUCESSO)
+                        retorno = ERRO_ARQUIVO_READ;
+        }
+#endif
+        return retorno;
+}
+
+int aplicar_gravacao_dados(const char* caminho, long deslocamento, size_t tamanho, const void* origem) {
+        int diario = diario_arquivo(caminho);
+        FILE* aberto = NULL;
+        for(int i = 0; i < MAX_ARQUIVOS_ABERTOS && aberto == NULL; i++)
+                if(acompanhados[i].arquivo != NULL && acompanhados[i].diario == diario)
+                        aberto = acompanhados[i].arquivo;
+
+        if(aberto == NULL) {
+                FILE* arquivo = abrir_arquivo_dados(caminho, "r+b");
+                if(arquivo == NULL)
+                        return ERRO_ABRIR_ARQUIVO;
+                int retorno = gravar_dados(arquivo, deslocamento, tamanho, origem);
+                int fechamento = fechar_arquivo_dados(arquivo);
+                return retorno != SUCESSO ? retorno : (fechamento != 0 ? ERRO_ARQUIVO_WRITE : SUCESSO);
+        }
+
+        int retorno = gravar_dados(aberto, deslocamento, tamanho, origem);
+
+        // sem cache nem mapeamento, os outros FILE* do caminho podem ter o trecho antigo no buffer do stdio
+        for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++)
+                if(acompanhados[i].arquivo != NULL && acompanhados[i].diario == diario && fflush(acompanhados[i].arquivo) != 0 && retorno == SUCESSO)
+                        retorno = ERRO_ARQUIVO_WRITE;
+        return retorno;
+}
+
+int sincronizar_caminho_dados(const char* caminho) {
+        int retorno = SUCESSO;
+#ifdef USAR_MAPEAMENTO
+        for(int i = 0; i < num_mapas; i++)
+                if(strcmp(mapas[i].caminho, caminho) == 0 && mapas[i].base != NULL && msync(mapas[i].base, mapas[i].tamanho_mapa, MS_SYNC) != 0)
+                        retorno = ERRO_ARQUIVO_WRITE;
+#else
+        int cache = cache_paginas_buscar(caminho);
+        if(cache >= 0)
+                retorno = cache_paginas_descarregar(cache);
+#endif
+        int diario = diario_arquivo(caminho);
+        for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++)
+                if(acompanhados[i].arquivo != NULL && acompanhados[i].diario == diario && fflush(acompanhados[i].arquivo) != 0 && retorno == SUCESSO)
+                        retorno = ERRO_ARQUIVO_WRITE;
+        if(retorno != SUCESSO)
+                return retorno;
+
+        FILE* arquivo = fopen(caminho, "r+b");
+        if(arquivo == NULL)
+                return ERRO_ABRIR_ARQUIVO;
+        if(fsync(fileno(arquivo)) != 0)
+                retorno = ERRO_ARQUIVO_WRITE;
+        fclose(arquivo);
+
+        return retorno;
+}
+
+const void* acessar_registro(FILE* arquivo, int posicao, size_t tamanho_registro, void* copia) {
+        long deslocamento = sizeof(CABECALHO) + (long)posicao * (long)tamanho_registro;
+#ifdef USAR_MAPEAMENTO
+        MAPA_ARQUIVO* mapa = mapa_de(arquivo);
+        if(mapa != NULL && !diario_pendente(diario_de(arquivo), deslocamento, tamanho_registro)) {
+                int erro;
+                mapa->tamanho_registro = tamanho_registro;
+                return regiao_mapeada(mapa, deslocamento, tamanho_registro, 0, &erro);
+        }
+#endif
+        return ler_dados(arquivo, deslocamento, tamanho_registro, copia) == SUCESSO ? copia : NULL;
+}
+
+int ler_registro(FILE* arquivo, int posicao, size_t tamanho_registro, void* destino) {
+#ifdef USAR_MAPEAMENTO
+        MAPA_ARQUIVO* mapa = mapa_de(arquivo);
+        if(mapa != NULL)
+                mapa->tamanho_registro = tamanho_registro;
+#endif
+        return ler_dados(arquivo, sizeof(CABECALHO) + (long)posicao * (long)tamanho_registro, tamanho_registro, destino);
+}
+
+int escrever_registro(FILE* arquivo, int posicao, size_t tamanho_registro, const void* registro) {
+#ifdef USAR_MAPEAMENTO
+        MAPA_ARQUIVO* mapa = mapa_de(arquivo);
+        if(mapa != NULL)
+                mapa->tamanho_registro = tamanho_registro;
+#endif
+        return escrever_dados(arquivo, sizeof(CABECALHO) + (long)posicao * (long)tamanho_registro, tamanho_registro, registro);
+}
+
+int ler_cabecalho_dados(FILE* arquivo, CABECALHO* cabecalho) {
+        return ler_dados(arquivo, 0, sizeof(CABECALHO), cabecalho);
+}
+
+int escrever_cabecalho_dados(FILE* arquivo, const CABECALHO* cabecalho) {
+        return escrever_dados(arquivo, 0, sizeof(CABECALHO), cabecalho);
+}
+
+FILE* abrir_arquivo_indice(const char* caminho, const char* modo) {
+        FILE* arquivo = fopen(caminho, modo);
+        if(arquivo == NULL)
+                return NULL;
+
+        int cache = cache_paginas_abrir(caminho);
+        for(int i = 0; cache >= 0 && i < MAX_ARQUIVOS_ABERTOS; i++) {
+                if(indices_abertos[i].arquivo == NULL) {
+                        indices_abertos[i].arquivo = arquivo;
+                        indices_abertos[i].cache = cache;
+
+                        if(!encerramento_registrado) {
+                                atexit(encerrar_armazenamento);
+                                encerramento_registrado = 1;
+                        }
+                        return arquivo;
+                }
+        }
+
+        // tabela cheia: gravações por stdio deixariam desatualizadas as páginas do caminho no cache
+        if(cache >= 0) {
+                if(contar_indices_cache(cache) == 0)
+                        cache_paginas_fechar(cache);
+                fclose(arquivo);
+                return NULL;
+        }
+
+        // sem cache, cada leitura vai ao arquivo: o buffer do stdio guardaria trechos gravados por
+        // outro FILE do mesmo caminho ou por outro processo
+        setvbuf(arquivo, NULL, _IONBF, 0);
+        return arquivo;
+}
+
+int fechar_arquivo_indice(FILE* arquivo) {
+        if(arquivo == NULL)
+                return 0;
+
+        int retorno = SUCESSO;
+        int cache = cache_de_indice(arquivo);
+        if(cache >= 0) {
+                for(int i = 0; i < MAX_ARQUIVOS_ABERTOS; i++) {
+                        if(indices_abertos[i].arquivo == arquivo) {
+                                indices_abertos[i].arquivo = NULL;
+                                indices_abertos[i].cache = -1;
+                                break;
+                        }
+                }
+
+                // como nos arquivos de lista: sem FILE aberto, o índice pode ser recriado ou alterado por
+                // outro processo antes da próxima abertura
+                retorno = contar_indices_cache(cache) > 0 ? cache_paginas_descarregar(cache) : cache_paginas_fechar(cache);
+        }
+
+        int fechamento = fclose(arquivo);
+        return retorno != SUCESSO ? retorno : fechamento;
+}
+
+int ler_arquivo_indice(FILE* arquivo, long deslocamento, size_t tamanho, void* destino) {
+        int cache = cache_de_indice(arquivo);
+        if(cache >= 0)
+                return cache_paginas_ler(cache, deslocamento, tamanho, destino);
+
+        if(fseek(arquivo, deslocamento, SEEK_SET) != 0)
+                return ERRO_ARQUIVO_SEEK;
+        if(fread(destino, tamanho, 1, arquivo) != 1)
+                return ERRO_ARQUIVO_READ;
+        return SUCESSO;
+}
+
+int escrever_arquivo_indice(FILE* arquivo, long deslocamento, size_t tamanho, const void* origem) {
+        int cache = cache_de_indice(arquivo);
+        if(cache >= 0)
+                return cache_paginas_escrever(cache, deslocamento, tamanho, origem);
+
+        if(fseek(arquivo, deslocamento, SEEK_SET) != 0)
+                return ERRO_ARQUIVO_SEEK;
+        if(fwrite(origem, tamanho, 1, arquivo) != 1)
+                return ERRO_ARQUIVO_WRITE;
+        return SUCESSO;
+}
+
+long tamanho_arquivo_indice(FILE* arquivo) {
+        int cache = cache_de_indice(arquivo);
+        if(cache >= 0)
+                return cache_paginas_tamanho(cache);
+
+        if(fseek(arquivo, 0, SEEK_END) != 0)
+                return -1;
+        return ftell(arquivo);
+}
+
+int descarregar_arquivo_indice(FILE* arquivo) {
+        int retorno = SUCESSO;
+        int cache = cache_de_indice(arquivo);
+        if(cache >= 0)
+                retorno = cache_paginas_descarregar(cache);
+        if(fflush(arquivo) != 0 && retorno == SUCESSO)
+                retorno = ERRO_ARQUIVO_WRITE;
+        return retorno;
+}
+
+void encerrar_armazenamento(void) {
+#ifdef USAR_MAPEAMENTO
+        for(int i = 0; i < num_mapas; i++) {
+                MAPA_ARQUIVO* mapa = &mapas[i];
+
+                // tamanho ocupado de acordo com o cabeçalho, lido antes de desfazer o mapeamento; com a
+                // base compartilhada, o excesso só é removido pelo último processo (encolher_arquivos_dados)
+                size_t ocupado = 0;
+                if(mapa->estendido && !arquivos_compartilhados)
+                        ocupado = tamanho_ocupado(mapa);
+
+                remapear(mapa, 0);
+                if(ocupado > 0 && ftruncate(mapa->descritor, (off_t)ocupado) != 0)
+                        ocupado = 0;    // o excesso fica no arquivo; os acessos usam apenas pos_topo
+                close(mapa->descritor);
+        }
+        num_mapas = 0;
+        memset(associacoes, 0, sizeof(associacoes));
+#else
+        memset(associacoes, 0, sizeof(associacoes));
+#endif
+        // com ARMAZENAMENTO_MMAP, o cache guarda só os índices
+        cache_paginas_encerrar();
+        memset(indices_abertos, 0, sizeof(indices_abertos));
+}
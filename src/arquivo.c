@@ -1,9 +1,14 @@
 #include "../include/arquivo.h"
+#include "../include/armazenamento.h"
+#include "../include/diario.h"
+#include "../include/indice_invertido.h"
 #include "../include/erros.h"
 #include "../include/utils.h"
 #include "../include/emprestimo.h"
 #include "../include/livro.h"
 #include "../include/usuario.h"
+#include "../include/carga.h"
+#include "../include/lote.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -12,8 +17,13 @@
 #define NOME_ARQUIVO_EMPRESTIMO "emprestimo.dat"
 #define NOME_ARQUIVO_LIVRO      "livro.dat"
 #define NOME_ARQUIVO_USUARIO    "usuario.dat"
-// Em caso de alteração da constante MAX_BUFFER_TEMP, alterar tamanho do sscanf na função 'processar_lote' para MAX_BUFFER_TEMP - 1
-#define MAX_BUFFER_TEMP         256
+#define NOME_INDICE_LIVRO       "livro.idx"
+#define NOME_INDICE_TITULO      "livro_titulo.idx"
+#define NOME_INDICE_AUTOR       "livro_autor.idx"
+#define NOME_INDICE_TRIGRAMA    "livro_trigrama.idx"
+#define NOME_INDICE_USUARIO     "usuario.idx"
+#define NOME_INDICE_EMPRESTIMO  "emprestimo.idx"
+#define NOME_INDICE_DATAS_EMPRESTIMO "emprestimo_data.idx"
 
 /*
  * inicializar_arquivo - função interna que inicializa um arquivo binário com cabeçalho
@@ -26,6 +36,8 @@
  * Pós-condições:
  *      - Caso o arquivo não exista, um arquivo binário é criado com a estrutura de cabeçalho.
  *      - Caso o arquivo exista, verifica-se se possui um cabeçalho válido. Se não tiver, cria um.
+ *      - Um arquivo com o cabeçalho antigo (CABECALHO_VERSAO_0) é considerado válido; a conversão
+ *      fica a cargo de atualizar_cabecalho.
  *      - Caso o arquivo exista e tenha um cabeçalho válido, nada é feito.
  *      - Retorna SUCESSO (0) em caso de sucesso.
  *      - Retorna valores negativos em caso de erro:
@@ -44,8 +56,9 @@ static int inicializar_arquivo(const char* caminho) {
                 return ERRO_ARQUIVO_SEEK;
         }
 
-        CABECALHO cabecalho;
-        if (fread(&cabecalho, sizeof(CABECALHO), 1, arquivo) != 1) {
+        // basta o trecho comum aos dois formatos: um arquivo antigo pode ser menor que o cabeçalho atual
+        CABECALHO_VERSAO_0 cabecalho;
+        if (fread(&cabecalho, sizeof(CABECALHO_VERSAO_0), 1, arquivo) != 1) {
                 // arquivo novo ou corrompido, criar novo cabeçalho
                 int retorno = cria_lista_vazia(arquivo);
                 if(retorno < 0) {
@@ -58,6 +71,324 @@ static int inicializar_arquivo(const char* caminho) {
         return SUCESSO;
 }
 
+/*
+ * varrer_registros_ativos - visita todos os registros ativos de um arquivo de lista em ordem física
+ *
+ * @arquivo - arquivo de lista aberto para leitura
+ * @tamanho_registro - tamanho de cada registro (ex.: sizeof(REGISTRO_LIVRO))
+ * @deslocamento_proximo - deslocamento do campo de encadeamento dentro do registro
+ * @visitar - função chamada para cada registro ativo, com sua posição no arquivo
+ * @contexto - ponteiro repassado para a função visitar
+ *
+ * As posições da lista de livres são marcadas primeiro; depois o arquivo é lido do início
+ * ao fim em blocos de REGISTROS_POR_BLOCO registros, pulando as posições livres.
+ * A ordem de visita é a ordem física, não a ordem da lista encadeada.
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou o primeiro erro encontrado (inclusive o retornado pela função visitar).
+ */
+int varrer_registros_ativos(
+        FILE* arquivo,
+        size_t tamanho_registro,
+        size_t deslocamento_proximo,
+        visitante_registro visitar,
+        void* contexto
+) {
+        CABECALHO cabecalho;
+        if(fseek(arquivo, 0, SEEK_SET) != 0 || fread(&cabecalho, sizeof(CABECALHO), 1, arquivo) != 1)
+                return ERRO_LER_CABECALHO;
+
+        int retorno = SUCESSO;
+        if(cabecalho.pos_topo <= 0)
+                return SUCESSO;
+
+        unsigned char* livres = calloc((size_t)cabecalho.pos_topo / 8 + 1, 1);
+        unsigned char* bloco = malloc(REGISTROS_POR_BLOCO * tamanho_registro);
+        if(livres == NULL || bloco == NULL) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_vetores;
+        }
+
+        // marcar posições da lista de livres (limitado a pos_topo passos para não entrar em ciclo)
+        int pos = cabecalho.pos_livre;
+        for(int passos = 0; pos >= 0 && pos < cabecalho.pos_topo && passos < cabecalho.pos_topo; passos++) {
+                livres[pos / 8] |= (unsigned char)(1 << (pos % 8));
+                if(fseek(arquivo, sizeof(CABECALHO) + (long)pos * tamanho_registro + deslocamento_proximo, SEEK_SET) != 0) {
+                        retorno = ERRO_ARQUIVO_SEEK;
+                        goto liberar_vetores;
+                }
+                if(fread(&pos, sizeof(int), 1, arquivo) != 1) {
+                        retorno = ERRO_ARQUIVO_READ;
+                        goto liberar_vetores;
+                }
+        }
+
+        if(fseek(arquivo, sizeof(CABECALHO), SEEK_SET) != 0) {
+                retorno = ERRO_ARQUIVO_SEEK;
+                goto liberar_vetores;
+        }
+
+        for(int base = 0; base < cabecalho.pos_topo; base += REGISTROS_POR_BLOCO) {
+                int quantidade = cabecalho.pos_topo - base;
+                if(quantidade > REGISTROS_POR_BLOCO)
+                        quantidade = REGISTROS_POR_BLOCO;
+
+                if(fread(bloco, tamanho_registro, quantidade, arquivo) != (size_t)quantidade) {
+                        retorno = ERRO_ARQUIVO_READ;
+                        goto liberar_vetores;
+                }
+
+                for(int i = 0; i < quantidade; i++) {
+                        int posicao = base + i;
+                        if(livres[posicao / 8] & (1 << (posicao % 8)))
+                                continue;
+                        retorno = visitar(bloco + i * tamanho_registro, posicao, contexto);
+                        if(retorno != SUCESSO)
+                                goto liberar_vetores;
+                }
+        }
+
+liberar_vetores:
+        free(livres);
+        free(bloco);
+
+        return retorno;
+}
+
+/*
+ * CONTAGEM_CABECALHO - contexto da varredura de recalcular_contadores
+ */
+typedef struct {
+        CABECALHO* cabecalho;
+        visitante_registro contabilizar;
+} CONTAGEM_CABECALHO;
+
+static int contar_registro(const void* registro, int posicao, void* contexto) {
+        CONTAGEM_CABECALHO* contagem = contexto;
+        contagem->cabecalho->num_ativos++;
+        if(contagem->contabilizar == NULL)
+                return SUCESSO;
+        return contagem->contabilizar(registro, posicao, contagem->cabecalho);
+}
+
+int recalcular_contadores(
+        FILE* arquivo,
+        size_t tamanho_registro,
+        size_t deslocamento_proximo,
+        visitante_registro contabilizar
+) {
+        CABECALHO cabecalho;
+        if(fseek(arquivo, 0, SEEK_SET) != 0 || fread(&cabecalho, sizeof(CABECALHO), 1, arquivo) != 1)
+                return ERRO_LER_CABECALHO;
+
+        cabecalho.num_ativos = 0;
+        cabecalho.emprestimos_abertos = 0;
+        cabecalho.exemplares_disponiveis = 0;
+
+        CONTAGEM_CABECALHO contagem = { &cabecalho, contabilizar };
+        int retorno = varrer_registros_ativos(arquivo, tamanho_registro, deslocamento_proximo, contar_registro, &contagem);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        // a varredura considera ativa toda posição abaixo de pos_topo fora da lista de livres
+        cabecalho.num_livres = cabecalho.pos_topo - cabecalho.num_ativos;
+
+        if(fseek(arquivo, 0, SEEK_SET) != 0 || fwrite(&cabecalho, sizeof(CABECALHO), 1, arquivo) != 1)
+                return ERRO_ESCREVER_CABECALHO;
+
+        return SUCESSO;
+}
+
+size_t tamanho_cabecalho_gravado(const CABECALHO* cabecalho, size_t lido) {
+        if(lido < sizeof(CABECALHO_VERSAO_1) || cabecalho->assinatura != ASSINATURA_CABECALHO)
+                return sizeof(CABECALHO_VERSAO_0);
+        if(cabecalho->versao < VERSAO_LISTA_DEVOLVIDOS)
+                return sizeof(CABECALHO_VERSAO_1);
+        return sizeof(CABECALHO);
+}
+
+/*
+ * atualizar_cabecalho - função interna que converte um arquivo de lista para o cabeçalho atual
+ *
+ * @caminho - caminho completo do arquivo de lista
+ * @tamanho_registro - tamanho de cada registro
+ * @deslocamento_proximo - deslocamento do campo de encadeamento dentro do registro
+ * @contabilizar - contadores específicos do arquivo (ver recalcular_contadores)
+ * @versao_registro - primeira versão gravada com o registro atual (0 se ele nunca mudou)
+ * @tamanho_registro_anterior - tamanho do registro nas versões anteriores a versao_registro
+ *
+ * Os registros de um arquivo com cabeçalho antigo (CABECALHO_VERSAO_0 ou CABECALHO_VERSAO_1) ou
+ * com registros menores são copiados para um arquivo temporário, logo após o cabeçalho atual;
+ * os contadores são calculados no temporário, que então substitui o original. As posições dos
+ * registros não mudam. Os campos acrescentados ao final do registro são encadeamentos e começam
+ * em -1 (todos os bytes em 0xFF). Se só a versão mudou, apenas o cabeçalho é regravado.
+ *
+ * Pós-condições:
+ *      - Arquivos já na versão atual não são alterados.
+ *      - Retorna SUCESSO (0), ERRO_VERSAO_CABECALHO (-31) se o arquivo for de uma versão mais nova,
+ *      ou outro código de erro negativo; em caso de erro o arquivo original não é alterado.
+ */
+static int atualizar_cabecalho(
+        const char* caminho,
+        size_t tamanho_registro,
+        size_t deslocamento_proximo,
+        visitante_registro contabilizar,
+        int versao_registro,
+        size_t tamanho_registro_anterior
+) {
+        // a conversão lê o arquivo por stdio: alterações ainda no cache de páginas precisam estar no arquivo
+        if(descarregar_caminho_dados(caminho) != SUCESSO)
+                return ERRO_ARQUIVO_WRITE;
+
+        FILE* antigo = fopen(caminho, "r+b");
+        if(antigo == NULL)
+                return ERRO_ABRIR_ARQUIVO;
+
+        int retorno = SUCESSO;
+        char caminho_novo[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_novo, caminho, "_conv.dat");
+        CABECALHO cabecalho;
+        memset(&cabecalho, 0, sizeof(CABECALHO));
+        size_t lido = fread(&cabecalho, 1, sizeof(CABECALHO), antigo);
+        long inicio = (long)tamanho_cabecalho_gravado(&cabecalho, lido);
+        int versao = inicio == (long)sizeof(CABECALHO_VERSAO_0) ? 0 : cabecalho.versao;
+        size_t tamanho_antigo = versao < versao_registro ? tamanho_registro_anterior : tamanho_registro;
+        if(versao >= VERSAO_CABECALHO) {
+                fclose(antigo);
+                return versao > VERSAO_CABECALHO ? ERRO_VERSAO_CABECALHO : SUCESSO;
+        }
+
+        // mesmo cabeçalho e mesmo registro: basta gravar a versão nova
+        if(inicio == (long)sizeof(CABECALHO) && tamanho_antigo == tamanho_registro) {
+                cabecalho.versao = VERSAO_CABECALHO;
+                if(fseek(antigo, 0, SEEK_SET) != 0 || fwrite(&cabecalho, sizeof(CABECALHO), 1, antigo) != 1)
+                        retorno = ERRO_ESCREVER_CABECALHO;
+                if(fclose(antigo) != 0 && retorno == SUCESSO)
+                        retorno = ERRO_ESCREVER_CABECALHO;
+                descartar_caminho_dados(caminho);
+                return retorno;
+        }
+
+        long tamanho;
+        if(lido < sizeof(CABECALHO_VERSAO_0) || cabecalho.pos_topo < 0) {
+                retorno = ERRO_LER_CABECALHO;
+                goto fechar_antigo;
+        }
+        if(fseek(antigo, 0, SEEK_END) != 0 || (tamanho = ftell(antigo)) < 0 || fseek(antigo, inicio, SEEK_SET) != 0) {
+                retorno = ERRO_ARQUIVO_SEEK;
+                goto fechar_antigo;
+        }
+        if(tamanho < inicio + (long)cabecalho.pos_topo * (long)tamanho_antigo) {
+                retorno = ERRO_ARQUIVO_READ;
+                goto fechar_antigo;
+        }
+
+        FILE* novo = fopen(caminho_novo, "w+b");
+        if(novo == NULL) {
+                retorno = ERRO_ABRIR_ARQUIVO;
+                goto fechar_antigo;
+        }
+
+        unsigned char* bloco_antigo = malloc(REGISTROS_POR_BLOCO * tamanho_antigo);
+        unsigned char* bloco = malloc(REGISTROS_POR_BLOCO * tamanho_registro);
+        if(bloco_antigo == NULL || bloco == NULL) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_blocos;
+        }
+
+        // os três primeiros campos são os mesmos; os contadores são preenchidos por recalcular_contadores
+        if(inicio < (long)sizeof(CABECALHO))
+                cabecalho.pos_devolvidos = -1;
+        cabecalho.assinatura = ASSINATURA_CABECALHO;
+        cabecalho.versao = VERSAO_CABECALHO;
+        cabecalho.num_ativos = cabecalho.num_livres = 0;
+        cabecalho.emprestimos_abertos = cabecalho.exemplares_disponiveis = 0;
+        if(fwrite(&cabecalho, sizeof(CABECALHO), 1, novo) != 1) {
+                retorno = ERRO_ARQUIVO_WRITE;
+                goto liberar_blocos;
+        }
+
+        for(int base = 0; base < cabecalho.pos_topo; base += REGISTROS_POR_BLOCO) {
+                int quantidade = cabecalho.pos_topo - base;
+                if(quantidade > REGISTROS_POR_BLOCO)
+                        quantidade = REGISTROS_POR_BLOCO;
+                if(fread(bloco_antigo, tamanho_antigo, quantidade, antigo) != (size_t)quantidade) {
+                        retorno = ERRO_ARQUIVO_READ;
+                        goto liberar_blocos;
+                }
+                for(int i = 0; i < quantidade; i++) {
+                        unsigned char* registro = bloco + (size_t)i * tamanho_registro;
+                        memcpy(registro, bloco_antigo + (size_t)i * tamanho_antigo, tamanho_antigo);
+                        memset(registro + tamanho_antigo, 0xFF, tamanho_registro - tamanho_antigo);
+                }
+                if(fwrite(bloco, tamanho_registro, quantidade, novo) != (size_t)quantidade) {
+                        retorno = ERRO_ARQUIVO_WRITE;
+                        goto liberar_blocos;
+                }
+        }
+
+        retorno = recalcular_contadores(novo, tamanho_registro, deslocamento_proximo, contabilizar);
+
+liberar_blocos:
+        free(bloco_antigo);
+        free(bloco);
+        if(fclose(novo) != 0 && retorno == SUCESSO)
+                retorno = ERRO_ARQUIVO_WRITE;
+fechar_antigo:
+        fclose(antigo);
+
+        if(retorno == SUCESSO && substituir_arquivo(caminho_novo, caminho) != 0)
+                retorno = ERRO_ABRIR_ARQUIVO;
+        if(retorno != SUCESSO)
+                remove(caminho_novo);
+
+        // páginas do arquivo antigo guardadas no cache ficaram desatualizadas
+        descartar_caminho_dados(caminho);
+
+        return retorno;
+}
+
+/*
+ * versao_gravada - função interna que lê a versão do cabeçalho de um arquivo de lista
+ *
+ * Pós-condições:
+ *      - Retorna a versão gravada, 0 para arquivos sem assinatura (CABECALHO_VERSAO_0) ou um
+ *      código de erro negativo se o arquivo não puder ser lido.
+ */
+static int versao_gravada(const char* caminho) {
+        if(descarregar_caminho_dados(caminho) != SUCESSO)
+                return ERRO_ARQUIVO_WRITE;
+
+        FILE* arquivo = fopen(caminho, "rb");
+        if(arquivo == NULL)
+                return ERRO_ABRIR_ARQUIVO;
+
+        CABECALHO cabecalho;
+        memset(&cabecalho, 0, sizeof(CABECALHO));
+        size_t lido = fread(&cabecalho, 1, sizeof(CABECALHO), arquivo);
+        fclose(arquivo);
+
+        if(tamanho_cabecalho_gravado(&cabecalho, lido) == sizeof(CABECALHO_VERSAO_0))
+                return 0;
+        return cabecalho.versao;
+}
+
+/*
+ * arquivo_existe - função interna que verifica se um arquivo pode ser aberto para leitura
+ *
+ * @caminho - caminho completo para o arquivo
+ *
+ * Pós-condições:
+ *      - Retorna 1 se o arquivo existe e pode ser lido, 0 caso contrário.
+ */
+static int arquivo_existe(const char* caminho) {
+        FILE* arquivo = fopen(caminho, "rb");
+        if(arquivo == NULL)
+                return 0;
+        fclose(arquivo);
+        return 1;
+}
+
 /*
  * cria_lista_vazia - Inicializa um arquivo binário com uma lista encadeada vazia
  *
@@ -74,9 +405,13 @@ static int inicializar_arquivo(const char* caminho) {
  */
 int cria_lista_vazia(FILE *arq) {
         CABECALHO cab;
+        memset(&cab, 0, sizeof(CABECALHO));
         cab.pos_cabeca = -1;
         cab.pos_topo = 0;
         cab.pos_livre = -1;
+        cab.pos_devolvidos = -1;
+        cab.assinatura = ASSINATURA_CABECALHO;
+        cab.versao = VERSAO_CABECALHO;
 
         if (fseek(arq, 0, SEEK_SET) != 0) {
                 return ERRO_ARQUIVO_SEEK;
@@ -104,12 +439,7 @@ int cria_lista_vazia(FILE *arq) {
 CABECALHO* le_cabecalho(FILE *arq) {
         CABECALHO *cab = malloc(sizeof(CABECALHO));
         if (!cab) return NULL;
-        if (fseek(arq, 0, SEEK_SET) != 0) {
-                free(cab);
-                return NULL;
-        }
-
-        if (fread(cab, sizeof(CABECALHO), 1, arq) != 1) {
+        if (ler_cabecalho_dados(arq, cab) != SUCESSO) {
                 free(cab);
                 return NULL;
         }
@@ -132,13 +462,7 @@ CABECALHO* le_cabecalho(FILE *arq) {
  *	- Retorna valor negativo caso ocorra erro
  */
 int escreve_cabecalho(FILE* arq,CABECALHO* cab) {
-        if (fseek(arq, 0, SEEK_SET) != 0)
-                return ERRO_ARQUIVO_SEEK;
-
-        if (fwrite(cab, sizeof(CABECALHO), 1, arq) != 1)
-                return ERRO_ARQUIVO_WRITE;
-
-        return SUCESSO;
+        return escrever_cabecalho_dados(arq, cab);
 }
 
 
@@ -160,6 +484,18 @@ int escreve_cabecalho(FILE* arq,CABECALHO* cab) {
  *	- O diretório deve possuir permissões de leitura e escrita.
  * Pós-condições:
  *	- Os arquivos binários para listas encadeadas são criados e inicializados com cabeçalho, caso não existam.
+ *	- As colunas de texto dos livros (livro.col e livro.str) são criadas; um livro.dat num formato
+ *	antigo, com os textos ou suas referências dentro do registro, é convertido (converter_livros_formato_antigo).
+ *	- Um emprestimo.dat com as datas em texto é convertido para datas em número de dias
+ *	(converter_emprestimos_formato_antigo).
+ *	- Em bases anteriores a VERSAO_EMPRESTIMOS_USUARIO, as listas de empréstimos de cada usuário
+ *	são montadas (reconstruir_emprestimos_usuarios); anteriores a VERSAO_EMPRESTIMOS_LIVRO, as de
+ *	cada livro (reconstruir_emprestimos_livros).
+ *	- O índice hash de livros (livro.idx), a árvore B+ de títulos (livro_titulo.idx), os índices
+ *	invertidos de autores e de trigramas (livro_autor.* e livro_trigrama.*), a árvore B+ de
+ *	usuários (usuario.idx), o índice de empréstimos abertos (emprestimo.idx) e a árvore B+ de
+ *	datas de empréstimo e devolução (emprestimo_data.idx) são construídos a partir das listas,
+ *	caso não existam.
  *	- Se os arquivos existirem e estarem inicializados, a função não faz nada.
  *	- Retorna SUCESSO (0) em caso de sucesso.
  *	- Retorna valores negativos em caso de erro:
@@ -177,6 +513,12 @@ int inicializar_base_de_dados(char *caminho_diretorio) {
 
         normalizar_para_sep(caminho_base);
 
+        // diário deixado por uma execução interrompida: as operações confirmadas voltam aos arquivos
+        // antes de qualquer leitura, e os índices (que não passam pelo diário) são refeitos no final
+        int interrompida;
+        if(diario_recuperar(caminho_base, &interrompida) != SUCESSO)
+                return ERRO_INICIALIZAR_ARQUIVO;
+
         char caminho_completo_emprestimo[TAM_MAX_CAMINHO];
         snprintf(caminho_completo_emprestimo, TAM_MAX_CAMINHO, "%s%s", caminho_base, NOME_ARQUIVO_EMPRESTIMO);
 
@@ -194,6 +536,91 @@ int inicializar_base_de_dados(char *caminho_diretorio) {
                 return ERRO_INICIALIZAR_ARQUIVO;
         }
 
+        // bases anteriores a VERSAO_EMPRESTIMOS_USUARIO ou VERSAO_EMPRESTIMOS_LIVRO: os empréstimos de cada
+        // usuário e de cada livro são encadeados depois da conversão
+        int versao_emprestimos = versao_gravada(caminho_completo_emprestimo);
+        int versao_usuarios = versao_gravada(caminho_completo_usuario);
+        int versao_livros = versao_gravada(caminho_completo_livro);
+        if(versao_emprestimos < 0 || versao_usuarios < 0 || versao_livros < 0)
+                return ERRO_INICIALIZAR_ARQUIVO;
+
+        // livro.dat sem arquivo de referências: base nova ou gravada num formato com os textos (ou suas referências) dentro do registro
+        char caminho_referencias_livro[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_referencias_livro, caminho_completo_livro, EXTENSAO_REFERENCIAS_TEXTO);
+        if(!arquivo_existe(caminho_referencias_livro) && converter_livros_formato_antigo(caminho_completo_livro) != SUCESSO)
+                return ERRO_INICIALIZAR_ARQUIVO;
+
+        // emprestimo.dat de versão anterior: datas em texto, lista única ou registros sem proximo_usuario
+        if(converter_emprestimos_formato_antigo(caminho_completo_emprestimo) != SUCESSO)
+                return ERRO_INICIALIZAR_ARQUIVO;
+
+        // cabeçalhos antigos: sem assinatura (gravados antes dos contadores), sem pos_devolvidos ou de
+        // versão anterior; em usuario.dat e livro.dat, registros que terminam antes de primeiro_emprestimo
+        if(
+                (atualizar_cabecalho(caminho_completo_livro, sizeof(REGISTRO_LIVRO), offsetof(REGISTRO_LIVRO, prox), contabilizar_livro,
+                        VERSAO_EMPRESTIMOS_LIVRO, offsetof(REGISTRO_LIVRO, primeiro_emprestimo)) != SUCESSO) ||
+                (atualizar_cabecalho(caminho_completo_usuario, sizeof(USUARIO), offsetof(USUARIO, proximo), NULL,
+                        VERSAO_EMPRESTIMOS_USUARIO, offsetof(USUARIO, primeiro_emprestimo)) != SUCESSO) ||
+                (atualizar_cabecalho(caminho_completo_emprestimo, sizeof(EMPRESTIMO), offsetof(EMPRESTIMO, proximo), contabilizar_emprestimo, 0, sizeof(EMPRESTIMO)) != SUCESSO)
+        ) {
+                return ERRO_INICIALIZAR_ARQUIVO;
+        }
+
+        if(
+                (versao_emprestimos < VERSAO_EMPRESTIMOS_USUARIO || versao_usuarios < VERSAO_EMPRESTIMOS_USUARIO) &&
+                reconstruir_emprestimos_usuarios(caminho_completo_emprestimo, caminho_completo_usuario) != SUCESSO
+        ) {
+                return ERRO_INICIALIZAR_ARQUIVO;
+        }
+        if(
+                (versao_emprestimos < VERSAO_EMPRESTIMOS_LIVRO || versao_livros < VERSAO_EMPRESTIMOS_LIVRO) &&
+                reconstruir_emprestimos_livros(caminho_completo_emprestimo, caminho_completo_livro) != SUCESSO
+        ) {
+                return ERRO_INICIALIZAR_ARQUIVO;
+        }
+
+        // índices (hash de livros, árvores B+ de títulos e de usuários, índices invertidos de autores e de trigramas, hash de empréstimos abertos e árvore B+ de datas de empréstimo): criados a partir das listas caso ainda não existam
+        char caminho_indice_livro[TAM_MAX_CAMINHO];
+        snprintf(caminho_indice_livro, TAM_MAX_CAMINHO, "%s%s", caminho_base, NOME_INDICE_LIVRO);
+        char caminho_indice_titulo[TAM_MAX_CAMINHO];
+        snprintf(caminho_indice_titulo, TAM_MAX_CAMINHO, "%s%s", caminho_base, NOME_INDICE_TITULO);
+        char caminho_indice_autor[TAM_MAX_CAMINHO], caminho_listas_autor[TAM_MAX_CAMINHO];
+        snprintf(caminho_indice_autor, TAM_MAX_CAMINHO, "%s%s", caminho_base, NOME_INDICE_AUTOR);
+        trocar_extensao(caminho_listas_autor, caminho_indice_autor, EXTENSAO_LISTAS_INVERTIDO);
+        char caminho_indice_trigrama[TAM_MAX_CAMINHO], caminho_listas_trigrama[TAM_MAX_CAMINHO];
+        snprintf(caminho_indice_trigrama, TAM_MAX_CAMINHO, "%s%s", caminho_base, NOME_INDICE_TRIGRAMA);
+        trocar_extensao(caminho_listas_trigrama, caminho_indice_trigrama, EXTENSAO_LISTAS_INVERTIDO);
+        char caminho_indice_usuario[TAM_MAX_CAMINHO];
+        snprintf(caminho_indice_usuario, TAM_MAX_CAMINHO, "%s%s", caminho_base, NOME_INDICE_USUARIO);
+        char caminho_indice_emprestimo[TAM_MAX_CAMINHO];
+        snprintf(caminho_indice_emprestimo, TAM_MAX_CAMINHO, "%s%s", caminho_base, NOME_INDICE_EMPRESTIMO);
+        char caminho_indice_datas[TAM_MAX_CAMINHO];
+        snprintf(caminho_indice_datas, TAM_MAX_CAMINHO, "%s%s", caminho_base, NOME_INDICE_DATAS_EMPRESTIMO);
+
+        if(interrompida) {
+                const char* indices[] = {
+                        caminho_indice_livro, caminho_indice_titulo, caminho_indice_autor, caminho_listas_autor,
+                        caminho_indice_trigrama, caminho_listas_trigrama, caminho_indice_usuario,
+                        caminho_indice_emprestimo, caminho_indice_datas
+                };
+                for(size_t i = 0; i < sizeof(indices) / sizeof(indices[0]); i++)
+                        remove(indices[i]);
+        }
+
+        if(
+                (!arquivo_existe(caminho_indice_livro) && reconstruir_indice_livro(caminho_completo_livro) != SUCESSO) ||
+                (!arquivo_existe(caminho_indice_titulo) && reconstruir_indice_titulo(caminho_completo_livro) != SUCESSO) ||
+                ((!arquivo_existe(caminho_indice_autor) || !arquivo_existe(caminho_listas_autor)) &&
+                        reconstruir_indice_autor(caminho_completo_livro) != SUCESSO) ||
+                ((!arquivo_existe(caminho_indice_trigrama) || !arquivo_existe(caminho_listas_trigrama)) &&
+                        reconstruir_indice_trigramas(caminho_completo_livro) != SUCESSO) ||
+                (!arquivo_existe(caminho_indice_usuario) && reconstruir_indice_usuario(caminho_completo_usuario) != SUCESSO) ||
+                (!arquivo_existe(caminho_indice_emprestimo) && reconstruir_indice_emprestimo(caminho_completo_emprestimo) != SUCESSO) ||
+                (!arquivo_existe(caminho_indice_datas) && reconstruir_indice_datas_emprestimo(caminho_completo_emprestimo) != SUCESSO)
+        ) {
+                return ERRO_INICIALIZAR_ARQUIVO;
+        }
+
         return SUCESSO;
 }
 
@@ -220,7 +647,13 @@ int inicializar_base_de_dados(char *caminho_diretorio) {
  *              - Linhas iniciadas por 'E' realizam emprestimo, e devolucao se houver data.
  *      - Informacoes sao normalizadas com trim e limitadas ao tamanho maximo de cada campo.
  *      - Mensagens de erro sao impressas para entradas mal formatadas ou com conflitos de ID.
- *      - Retorna SUCESSO (0) ao final do processamento, mesmo com erros parciais.
+ *      - As linhas sao interpretadas em paralelo (ver executar_lote), mas aplicadas na ordem do
+ *      arquivo; as mensagens de erro trazem o numero original da linha.
+ *      - Os arquivos de dados ficam abertos durante todo o lote (ver carga_iniciar); registros novos
+ *      são gravados em blocos sequenciais, cada cabeçalho é gravado uma vez e os índices são
+ *      montados apenas ao final.
+ *      - Retorna SUCESSO (0) ao final do processamento, mesmo com erros parciais nas linhas.
+ *      - Retorna um código de erro negativo se os arquivos de dados não puderem ser abertos ou gravados.
  *
  * Erros tratados internamente:
  *      - ERRO_ABRIR_ARQUIVO (-10): erro ao abrir o arquivo de lote.
@@ -239,129 +672,21 @@ int processar_lote(
                 return ERRO_ABRIR_ARQUIVO;
         }
 
-        char linha[512];
-        int numero_linha = 1;
-
-        while (fgets(linha, sizeof(linha), arquivo)) {
-                linha[strcspn(linha, "\n")] = '\0';
-                trim(linha);
-                if (linha[0] == 'L') {
-                        LIVRO livro;
-                        char titulo_temp[MAX_BUFFER_TEMP], autor_temp[MAX_BUFFER_TEMP], editora_temp[MAX_BUFFER_TEMP];
-
-                        int lidos = sscanf(linha + 2, "%u;%255[^;];%255[^;];%255[^;];%u;%u;%u",
-                                &livro.codigo,
-                                titulo_temp,
-                                autor_temp,
-                                editora_temp,
-                                &livro.edicao,
-                                &livro.ano,
-                                &livro.exemplares
-                        );
-                        trim(titulo_temp);
-                        trim(autor_temp);
-                        trim(editora_temp);
-
-                        strncpy(livro.titulo, titulo_temp, MAX_TITULO);
-                        livro.titulo[MAX_TITULO] = '\0';
-
-                        strncpy(livro.autor, autor_temp, MAX_AUTOR);
-                        livro.autor[MAX_AUTOR] = '\0';
-
-                        strncpy(livro.editora, editora_temp, MAX_EDITORA);
-                        livro.editora[MAX_EDITORA] = '\0';
-
-                        int r1 = ERRO_CAMPOS_INVALIDOS;
-                        // avaliação em curto-circuito
-                        if(lidos != 7 || (r1 = cadastrar_livro(caminho_arquivo_livro, livro)) != SUCESSO) {
-                                printf("Erro ao processar livro na linha %d", numero_linha);
-                        }
-
-                        if(r1 == ERRO_CAMPOS_INVALIDOS) {
-                                printf(": Campos incorretos\n");
-                        }
-                        if(r1 == ERRO_CONFLITO_ID)
-                                printf(": Codigo de livro já utilizado\n");
-
-                } else if (linha[0] == 'U') {
-                        USUARIO usuario;
-                        char nome_temp[MAX_BUFFER_TEMP];
-
-                        int lidos = sscanf(linha + 2, "%u;%255[^\n]", &usuario.codigo, nome_temp);
-
-                        trim(nome_temp);
-                        strncpy(usuario.nome, nome_temp, MAX_NOME);
-                        usuario.nome[MAX_NOME] = '\0';
-
-                        int r2 = ERRO_CAMPOS_INVALIDOS;
-                        if (lidos != 2 || (r2 = cadastrar_usuario(caminho_arquivo_usuario, usuario)) != SUCESSO) {
-                                printf("Erro ao processar usuario na linha %d", numero_linha);
-                        }
-
-                        if(r2 == ERRO_CAMPOS_INVALIDOS) {
-                                printf(": Campos incorretos\n");
-                        }
-                        if(r2 == ERRO_CONFLITO_ID)
-                                printf(": Codigo de usuario ja utilizado\n");
-
-                } else if (linha[0] == 'E') {
-                        int cod_usuario, cod_livro;
-                        char data_emp[MAX_DATA + 1], data_dev[MAX_DATA + 1] = "";
-                        char data_emp_temp[MAX_BUFFER_TEMP], data_dev_temp[MAX_BUFFER_TEMP] = "";
-
-                        int lidos = sscanf(linha + 2, "%u;%u;%255[^;];%255[^\n]", &cod_usuario, &cod_livro, data_emp_temp, data_dev_temp);
-
-                        trim(data_emp_temp);
-                        trim(data_dev_temp);
-
-                        strncpy(data_emp, data_emp_temp, MAX_DATA);
-                        data_emp[MAX_DATA] = '\0';
-                        strncpy(data_dev, data_dev_temp, MAX_DATA);
-                        data_dev[MAX_DATA] = '\0';
-                        if (lidos < 3) {
-                                printf("Erro ao processar emprestimo na linha %d: Campos incorretos\n", numero_linha);
-                        }
-                        else {
-                                int r3 = ERRO_CAMPOS_INVALIDOS;
-                                if (
-                                        (r3 = emprestar_livro(
-                                                caminho_arquivo_emprestimo,
-                                                caminho_arquivo_livro,
-                                                caminho_arquivo_usuario,
-                                                cod_usuario,
-                                                cod_livro,
-                                                data_emp
-                                        )) != SUCESSO
-                                ) {
-                                        printf("Erro ao emprestar livro na linha %d", numero_linha);
-                                }
-                                if(r3 == ERRO_CONFLITO_ID)
-                                        printf(": Codigos de livro e usuario ja utilizados\n");
-                                // Se foi fornecida a data de devolução
-                                if (lidos == 4 && strlen(data_dev) > 0) {
-                                        if (
-                                                devolver_livro(
-                                                        caminho_arquivo_emprestimo,
-                                                        caminho_arquivo_livro,
-                                                        cod_usuario,
-                                                        cod_livro,
-                                                        data_dev
-                                                ) != SUCESSO
-                                        ) {
-                                                printf("\nErro ao devolver livro na linha %d\n", numero_linha);
-                                        }
-                                }
-                        }
-
-                }
-                else {
-                        if(!linha_em_branco(linha))
-                                printf("Linha %d com tipo desconhecido: \"%s\"\n", numero_linha, linha);
-                }
-
-                numero_linha++;
+        // carga em lote: arquivos abertos uma única vez, verificações em memória e índices montados ao final
+        CARGA_LOTE carga;
+        int retorno = carga_iniciar(&carga, caminho_arquivo_emprestimo, caminho_arquivo_livro, caminho_arquivo_usuario);
+        if(retorno != SUCESSO) {
+                fclose(arquivo);
+                return retorno;
         }
 
+        // leitura, interpretação (em paralelo) e aplicação em ordem das linhas
+        retorno = executar_lote(arquivo, &carga);
+
         fclose(arquivo);
-        return SUCESSO;
+        if(retorno != SUCESSO) {
+                carga_finalizar(&carga);
+                return retorno;
+        }
+        return carga_finalizar(&carga);
 }
@@ -0,0 +1,693 @@
+#include "../include/armazenamento.h"
+#include "../include/arvore_bmais.h"
+#include "../include/erros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// bytes do início de cada página de nó ocupados por folha, num_chaves e proxima
+#define TAM_CABECALHO_NO (3 * sizeof(int))
+
+/*
+ * NO_BMAIS - representação em memória de um nó da árvore
+ *
+ * @folha - 1 se o nó é folha, 0 se é nó interno
+ * @num_chaves - quantidade de chaves em uso
+ * @proxima - página da próxima folha (apenas folhas; -1 se for a última)
+ * @chaves - chaves do nó, contíguas, cada uma com tamanho_chave bytes
+ * @ponteiros - em nós internos, páginas dos filhos (num_chaves + 1);
+ *		em folhas, valores associados às chaves (num_chaves)
+ *
+ * Os vetores comportam uma chave e um ponteiro a mais do que a ordem permite, para que
+ * o nó possa transbordar em memória antes de ser dividido.
+ */
+typedef struct {
+        int folha;
+        int num_chaves;
+        int proxima;
+        unsigned char chaves[TAM_PAGINA_BMAIS + TAM_MAX_CHAVE_BMAIS];
+        int ponteiros[TAM_PAGINA_BMAIS / sizeof(int) + 2];
+} NO_BMAIS;
+
+/*
+ * calcular_ordem - função interna que calcula quantas chaves cabem em uma página
+ *
+ * @tamanho_chave - tamanho fixo das chaves
+ *
+ * Pós-condições:
+ *      - Retorna a maior ordem tal que cabeçalho do nó, chaves e ponteiros caibam em uma página.
+ */
+static int calcular_ordem(int tamanho_chave) {
+        return (int)((TAM_PAGINA_BMAIS - TAM_CABECALHO_NO - sizeof(int)) / (tamanho_chave + sizeof(int)));
+}
+
+/*
+ * arvore_bmais_codificar_inteiro - codifica um inteiro sem sinal como chave de 4 bytes
+ *
+ * @valor - valor a ser codificado
+ * @destino - buffer com pelo menos 4 bytes
+ *
+ * Pós-condições:
+ *      - destino recebe o valor em big-endian, de forma que memcmp preserve a ordem numérica.
+ */
+void arvore_bmais_codificar_inteiro(unsigned int valor, unsigned char* destino) {
+        destino[0] = (unsigned char)(valor >> 24);
+        destino[1] = (unsigned char)(valor >> 16);
+        destino[2] = (unsigned char)(valor >> 8);
+        destino[3] = (unsigned char)valor;
+}
+
+/*
+ * arvore_bmais_decodificar_inteiro - decodifica um inteiro codificado por arvore_bmais_codificar_inteiro
+ *
+ * @origem - buffer com pelo menos 4 bytes
+ *
+ * Pós-condições:
+ *      - Retorna o valor inteiro sem sinal representado pelos 4 primeiros bytes.
+ */
+unsigned int arvore_bmais_decodificar_inteiro(const unsigned char* origem) {
+        return ((unsigned int)origem[0] << 24) |
+               ((unsigned int)origem[1] << 16) |
+               ((unsigned int)origem[2] << 8) |
+               (unsigned int)origem[3];
+}
+
+/*
+ * le_cabecalho_arvore - função interna que lê o cabeçalho (página 0) da árvore
+ *
+ * @arquivo - arquivo da árvore aberto para leitura
+ * @cabecalho - ponteiro onde o cabeçalho será armazenado
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou ERRO_LER_INDICE (-27) se o cabeçalho não puder ser lido ou for inválido.
+ */
+static int le_cabecalho_arvore(FILE* arquivo, CABECALHO_ARVORE_BMAIS* cabecalho) {
+        if(
+                ler_arquivo_indice(arquivo, 0, sizeof(CABECALHO_ARVORE_BMAIS), cabecalho) != SUCESSO ||
+                cabecalho->tamanho_chave <= 0 ||
+                cabecalho->tamanho_chave > TAM_MAX_CHAVE_BMAIS
+        ) {
+                return ERRO_LER_INDICE;
+        }
+        return SUCESSO;
+}
+
+/*
+ * escreve_cabecalho_arvore - função interna que grava o cabeçalho (página 0) da árvore
+ *
+ * @arquivo - arquivo da árvore aberto para escrita
+ * @cabecalho - cabeçalho a ser gravado
+ *
+ * Pós-condições:
+ *      - A página 0 inteira é gravada (o restante é preenchido com zeros).
+ *      - Retorna SUCESSO (0) ou ERRO_ESCREVER_INDICE (-28).
+ */
+static int escreve_cabecalho_arvore(FILE* arquivo, CABECALHO_ARVORE_BMAIS* cabecalho) {
+        unsigned char pagina[TAM_PAGINA_BMAIS];
+        memset(pagina, 0, sizeof(pagina));
+        memcpy(pagina, cabecalho, sizeof(CABECALHO_ARVORE_BMAIS));
+
+        if(escrever_arquivo_indice(arquivo, 0, TAM_PAGINA_BMAIS, pagina) != SUCESSO)
+                return ERRO_ESCREVER_INDICE;
+        return SUCESSO;
+}
+
+/*
+ * le_no - função interna que lê e desserializa um nó
+ *
+ * @arquivo - arquivo da árvore aberto para leitura
+ * @cabecalho - cabeçalho da árvore (define tamanho de chave e ordem)
+ * @pagina - número da página do nó
+ * @no - ponteiro onde o nó será armazenado
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou ERRO_LER_INDICE (-27).
+ */
+static int le_no(FILE* arquivo, CABECALHO_ARVORE_BMAIS* cabecalho, int pagina, NO_BMAIS* no) {
+        unsigned char bruto[TAM_PAGINA_BMAIS];
+        if(
+                pagina <= 0 ||
+                ler_arquivo_indice(arquivo, (long)pagina * TAM_PAGINA_BMAIS, TAM_PAGINA_BMAIS, bruto) != SUCESSO
+        ) {
+                return ERRO_LER_INDICE;
+        }
+
+        size_t bytes_chaves = (size_t)cabecalho->ordem * cabecalho->tamanho_chave;
+        memcpy(&no->folha, bruto, sizeof(int));
+        memcpy(&no->num_chaves, bruto + sizeof(int), sizeof(int));
+        memcpy(&no->proxima, bruto + 2 * sizeof(int), sizeof(int));
+        if(no->num_chaves < 0 || no->num_chaves > cabecalho->ordem)
+                return ERRO_LER_INDICE;
+
+        memcpy(no->chaves, bruto + TAM_CABECALHO_NO, bytes_chaves);
+        memcpy(no->ponteiros, bruto + TAM_CABECALHO_NO + bytes_chaves, (cabecalho->ordem + 1) * sizeof(int));
+        return SUCESSO;
+}
+
+/*
+ * escreve_no - função interna que serializa e grava um nó
+ *
+ * @arquivo - arquivo da árvore aberto para escrita
+ * @cabecalho - cabeçalho da árvore (define tamanho de chave e ordem)
+ * @pagina - número da página do nó
+ * @no - nó a ser gravado (num_chaves não pode ultrapassar a ordem)
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou ERRO_ESCREVER_INDICE (-28).
+ */
+static int escreve_no(FILE* arquivo, CABECALHO_ARVORE_BMAIS* cabecalho, int pagina, NO_BMAIS* no) {
+        unsigned char bruto[TAM_PAGINA_BMAIS];
+        size_t bytes_chaves = (size_t)cabecalho->ordem * cabecalho->tamanho_chave;
+
+        memset(bruto, 0, sizeof(bruto));
+        memcpy(bruto, &no->folha, sizeof(int));
+        memcpy(bruto + sizeof(int), &no->num_chaves, sizeof(int));
+        memcpy(bruto + 2 * sizeof(int), &no->proxima, sizeof(int));
+        memcpy(bruto + TAM_CABECALHO_NO, no->chaves, (size_t)no->num_chaves * cabecalho->tamanho_chave);
+        memcpy(bruto + TAM_CABECALHO_NO + bytes_chaves, no->ponteiros, (cabecalho->ordem + 1) * sizeof(int));
+
+        if(escrever_arquivo_indice(arquivo, (long)pagina * TAM_PAGINA_BMAIS, TAM_PAGINA_BMAIS, bruto) != SUCESSO)
+                return ERRO_ESCREVER_INDICE;
+        return SUCESSO;
+}
+
+/*
+ * posicao_chave - função interna que faz busca binária da primeira chave >= chave procurada
+ *
+ * @no - nó onde a busca é feita
+ * @tamanho_chave - tamanho das chaves
+ * @chave - chave procurada
+ * @igual - recebe 1 se a chave na posição retornada é igual à procurada, 0 caso contrário
+ *
+ * Pós-condições:
+ *      - Retorna um índice entre 0 e num_chaves.
+ */
+static int posicao_chave(NO_BMAIS* no, int tamanho_chave, const unsigned char* chave, int* igual) {
+        int inicio = 0, fim = no->num_chaves;
+        while(inicio < fim) {
+                int meio = (inicio + fim) / 2;
+                if(memcmp(no->chaves + (size_t)meio * tamanho_chave, chave, tamanho_chave) < 0)
+                        inicio = meio + 1;
+                else
+                        fim = meio;
+        }
+        *igual = inicio < no->num_chaves &&
+                 memcmp(no->chaves + (size_t)inicio * tamanho_chave, chave, tamanho_chave) == 0;
+        return inicio;
+}
+
+/*
+ * filho_para_chave - função interna que escolhe o filho de um nó interno que cobre a chave
+ *
+ * @no - nó interno
+ * @tamanho_chave - tamanho das chaves
+ * @chave - chave procurada
+ *
+ * Pós-condições:
+ *      - Retorna o índice do filho: chaves iguais à chave separadora ficam à direita.
+ */
+static int filho_para_chave(NO_BMAIS* no, int tamanho_chave, const unsigned char* chave) {
+        int igual;
+        int indice = posicao_chave(no, tamanho_chave, chave, &igual);
+        return igual ? indice + 1 : indice;
+}
+
+/*
+ * inserir_recursivo - função interna que insere a chave na subárvore e propaga divisões
+ *
+ * @arquivo - arquivo da árvore aberto em modo leitura/escrita
+ * @cabecalho - cabeçalho da árvore (num_paginas e num_chaves são atualizados)
+ * @pagina - página da raiz da subárvore
+ * @chave - chave a ser inserida
+ * @valor - valor associado
+ * @dividiu - recebe 1 se o nó da página foi dividido
+ * @chave_promovida - recebe a chave separadora a ser inserida no pai (se dividiu)
+ * @pagina_nova - recebe a página do novo nó à direita (se dividiu)
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0), ERRO_LER_INDICE (-27) ou ERRO_ESCREVER_INDICE (-28).
+ */
+static int inserir_recursivo(
+        FILE* arquivo,
+        CABECALHO_ARVORE_BMAIS* cabecalho,
+        int pagina,
+        const unsigned char* chave,
+        int valor,
+        int* dividiu,
+        unsigned char* chave_promovida,
+        int* pagina_nova
+) {
+        int tam = cabecalho->tamanho_chave;
+        NO_BMAIS* no = malloc(sizeof(NO_BMAIS));
+        if(no == NULL)
+                return ERRO_ESCREVER_INDICE;
+
+        int retorno = le_no(arquivo, cabecalho, pagina, no);
+        if(retorno != SUCESSO)
+                goto liberar_no;
+
+        *dividiu = 0;
+        int igual;
+
+        if(no->folha) {
+                int indice = posicao_chave(no, tam, chave, &igual);
+                if(igual) {
+                        // chave já existente: apenas substituir o valor
+                        no->ponteiros[indice] = valor;
+                        retorno = escreve_no(arquivo, cabecalho, pagina, no);
+                        goto liberar_no;
+                }
+
+                memmove(no->chaves + (size_t)(indice + 1) * tam, no->chaves + (size_t)indice * tam, (size_t)(no->num_chaves - indice) * tam);
+                memmove(&no->ponteiros[indice + 1], &no->ponteiros[indice], (no->num_chaves - indice) * sizeof(int));
+                memcpy(no->chaves + (size_t)indice * tam, chave, tam);
+                no->ponteiros[indice] = valor;
+                no->num_chaves++;
+                cabecalho->num_chaves++;
+        }
+        else {
+                int indice = filho_para_chave(no, tam, chave);
+                int filho_dividiu, pagina_filho_nova;
+                unsigned char chave_filho[TAM_MAX_CHAVE_BMAIS];
+
+                retorno = inserir_recursivo(arquivo, cabecalho, no->ponteiros[indice], chave, valor, &filho_dividiu, chave_filho, &pagina_filho_nova);
+                if(retorno != SUCESSO || !filho_dividiu)
+                        goto liberar_no;
+
+                // encaixar a chave separadora do filho dividido
+                memmove(no->chaves + (size_t)(indice + 1) * tam, no->chaves + (size_t)indice * tam, (size_t)(no->num_chaves - indice) * tam);
+                memmove(&no->ponteiros[indice + 2], &no->ponteiros[indice + 1], (no->num_chaves - indice) * sizeof(int));
+                memcpy(no->chaves + (size_t)indice * tam, chave_filho, tam);
+                no->ponteiros[indice + 1] = pagina_filho_nova;
+                no->num_chaves++;
+        }
+
+        if(no->num_chaves <= cabecalho->ordem) {
+                retorno = escreve_no(arquivo, cabecalho, pagina, no);
+                goto liberar_no;
+        }
+
+        // nó transbordou: dividir ao meio
+        NO_BMAIS* direito = malloc(sizeof(NO_BMAIS));
+        if(direito == NULL) {
+                retorno = ERRO_ESCREVER_INDICE;
+                goto liberar_no;
+        }
+
+        int meio = no->num_chaves / 2;
+        direito->folha = no->folha;
+        *pagina_nova = cabecalho->num_paginas++;
+
+        if(no->folha) {
+                // folha: a primeira chave da direita é copiada para o pai
+                direito->num_chaves = no->num_chaves - meio;
+                memcpy(direito->chaves, no->chaves + (size_t)meio * tam, (size_t)direito->num_chaves * tam);
+                memcpy(direito->ponteiros, &no->ponteiros[meio], direito->num_chaves * sizeof(int));
+                direito->proxima = no->proxima;
+                no->proxima = *pagina_nova;
+                no->num_chaves = meio;
+                memcpy(chave_promovida, direito->chaves, tam);
+        }
+        else {
+                // nó interno: a chave do meio sobe para o pai e não fica em nenhum dos lados
+                direito->num_chaves = no->num_chaves - meio - 1;
+                memcpy(direito->chaves, no->chaves + (size_t)(meio + 1) * tam, (size_t)direito->num_chaves * tam);
+                memcpy(direito->ponteiros, &no->ponteiros[meio + 1], (direito->num_chaves + 1) * sizeof(int));
+                direito->proxima = -1;
+                memcpy(chave_promovida, no->chaves + (size_t)meio * tam, tam);
+                no->num_chaves = meio;
+        }
+
+        if(
+                (retorno = escreve_no(arquivo, cabecalho, pagina, no)) == SUCESSO &&
+                (retorno = escreve_no(arquivo, cabecalho, *pagina_nova, direito)) == SUCESSO
+        ) {
+                *dividiu = 1;
+        }
+        free(direito);
+
+liberar_no:
+        free(no);
+
+        return retorno;
+}
+
+/*
+ * descer_ate_folha - função interna que desce da raiz até a folha que cobre a chave
+ *
+ * @arquivo - arquivo da árvore aberto para leitura
+ * @cabecalho - cabeçalho da árvore
+ * @chave - chave procurada
+ * @no - recebe a folha encontrada
+ * @pagina - recebe o número da página da folha
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou ERRO_LER_INDICE (-27).
+ */
+static int descer_ate_folha(FILE* arquivo, CABECALHO_ARVORE_BMAIS* cabecalho, const unsigned char* chave, NO_BMAIS* no, int* pagina) {
+        *pagina = cabecalho->raiz;
+        int retorno = le_no(arquivo, cabecalho, *pagina, no);
+        while(retorno == SUCESSO && !no->folha) {
+                *pagina = no->ponteiros[filho_para_chave(no, cabecalho->tamanho_chave, chave)];
+                retorno = le_no(arquivo, cabecalho, *pagina, no);
+        }
+        return retorno;
+}
+
+/*
+ * arvore_bmais_criar - cria (ou sobrescreve) um arquivo de árvore B+ vazia
+ *
+ * @caminho - caminho completo para o arquivo da árvore
+ * @tamanho_chave - tamanho fixo das chaves, entre 1 e TAM_MAX_CHAVE_BMAIS
+ *
+ * Pré-condições:
+ *      - O diretório do caminho deve existir e possuir permissão de escrita.
+ * Pós-condições:
+ *      - O arquivo é criado com o cabeçalho e uma folha raiz vazia.
+ *      - Retorna SUCESSO (0) em caso de sucesso.
+ *      - Retorna valores negativos em caso de erro:
+ *              - ERRO_ABRIR_ARQUIVO (-10): não foi possível criar o arquivo.
+ *              - ERRO_ESCREVER_INDICE (-28): não foi possível escrever as páginas iniciais.
+ */
+int arvore_bmais_criar(const char* caminho, int tamanho_chave) {
+        return arvore_bmais_construir(caminho, tamanho_chave, NULL, NULL, 0);
+}
+
+/*
+ * arvore_bmais_construir - cria um arquivo de árvore B+ a partir de chaves já ordenadas
+ *
+ * @caminho - caminho completo para o arquivo da árvore
+ * @tamanho_chave - tamanho fixo das chaves
+ * @chaves - vetor contínuo com quantidade * tamanho_chave bytes, em ordem crescente e sem repetições
+ * @valores - valores associados a cada chave
+ * @quantidade - número de chaves
+ *
+ * A árvore é montada de baixo para cima (folhas primeiro), gravando cada página uma única vez.
+ * As folhas são preenchidas até 3/4 da capacidade para acomodar inserções futuras sem divisões.
+ *
+ * Pré-condições:
+ *      - As chaves devem estar ordenadas por memcmp e não podem se repetir.
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) em caso de sucesso.
+ *      - Retorna ERRO_ABRIR_ARQUIVO (-10) ou ERRO_ESCREVER_INDICE (-28) em caso de erro.
+ */
+int arvore_bmais_construir(const char* caminho, int tamanho_chave, const unsigned char* chaves, const int* valores, int quantidade) {
+        if(tamanho_chave <= 0 || tamanho_chave > TAM_MAX_CHAVE_BMAIS)
+                return ERRO_ESCREVER_INDICE;
+
+        CABECALHO_ARVORE_BMAIS cabecalho;
+        cabecalho.tamanho_chave = tamanho_chave;
+        cabecalho.ordem = calcular_ordem(tamanho_chave);
+        cabecalho.num_paginas = 1;
+        cabecalho.num_chaves = quantidade;
+        cabecalho.primeira_folha = 1;
+
+        FILE* arquivo = fopen(caminho, "w+b");
+        if(!arquivo)
+                return ERRO_ABRIR_ARQUIVO;
+
+        int retorno = SUCESSO;
+        int preenchimento = cabecalho.ordem * 3 / 4;
+        if(preenchimento < 2)
+                preenchimento = 2;
+
+        // páginas e menores chaves do nível que está sendo montado
+        int num_nos = quantidade == 0 ? 1 : (quantidade + preenchimento - 1) / preenchimento;
+        int* paginas = malloc(num_nos * sizeof(int));
+        unsigned char* menores = malloc((size_t)num_nos * tamanho_chave);
+        NO_BMAIS* no = malloc(sizeof(NO_BMAIS));
+        if(paginas == NULL || menores == NULL || no == NULL) {
+                retorno = ERRO_ESCREVER_INDICE;
+                goto liberar_memoria;
+        }
+
+        // nível das folhas
+        for(int i = 0; i < num_nos; i++) {
+                int inicio = i * preenchimento;
+                int fim = inicio + preenchimento < quantidade ? inicio + preenchimento : quantidade;
+
+                no->folha = 1;
+                no->num_chaves = fim - inicio;
+                no->proxima = i + 1 < num_nos ? cabecalho.num_paginas + 1 : -1;
+                if(no->num_chaves > 0) {
+                        memcpy(no->chaves, chaves + (size_t)inicio * tamanho_chave, (size_t)no->num_chaves * tamanho_chave);
+                        memcpy(no->ponteiros, valores + inicio, no->num_chaves * sizeof(int));
+                        memcpy(menores + (size_t)i * tamanho_chave, no->chaves, tamanho_chave);
+                }
+                paginas[i] = cabecalho.num_paginas++;
+                if((retorno = escreve_no(arquivo, &cabecalho, paginas[i], no)) != SUCESSO)
+                        goto liberar_memoria;
+        }
+
+        // níveis internos: agrupar os nós do nível anterior até restar apenas a raiz
+        while(num_nos > 1) {
+                int filhos_por_no = preenchimento + 1;
+                int num_pais = (num_nos + filhos_por_no - 1) / filhos_por_no;
+
+                for(int i = 0; i < num_pais; i++) {
+                        int inicio = i * filhos_por_no;
+                        int fim = inicio + filhos_por_no < num_nos ? inicio + filhos_por_no : num_nos;
+
+                        no->folha = 0;
+                        no->proxima = -1;
+                        no->num_chaves = fim - inicio - 1;
+                        for(int j = inicio; j < fim; j++) {
+                                no->ponteiros[j - inicio] = paginas[j];
+                                if(j > inicio)
+                                        memcpy(no->chaves + (size_t)(j - inicio - 1) * tamanho_chave, menores + (size_t)j * tamanho_chave, tamanho_chave);
+                        }
+
+                        int pagina = cabecalho.num_paginas++;
+                        if((retorno = escreve_no(arquivo, &cabecalho, pagina, no)) != SUCESSO)
+                                goto liberar_memoria;
+
+                        // reaproveitar os vetores: o pai i ocupa a posição i do próximo nível
+                        memmove(menores + (size_t)i * tamanho_chave, menores + (size_t)inicio * tamanho_chave, tamanho_chave);
+                        paginas[i] = pagina;
+                }
+                num_nos = num_pais;
+        }
+
+        cabecalho.raiz = paginas[0];
+        retorno = escreve_cabecalho_arvore(arquivo, &cabecalho);
+
+liberar_memoria:
+        free(paginas);
+        free(menores);
+        free(no);
+        if(fclose(arquivo) != 0 && retorno == SUCESSO)
+                retorno = ERRO_ESCREVER_INDICE;
+
+        return retorno;
+}
+
+/*
+ * arvore_bmais_inserir_arquivo - insere (ou atualiza) uma chave na árvore
+ *
+ * @arquivo - arquivo da árvore aberto para leitura/escrita
+ * @chave - ponteiro para os bytes da chave (tamanho_chave bytes)
+ * @valor - valor associado à chave
+ *
+ * Pré-condições:
+ *      - O arquivo deve ter sido criado por arvore_bmais_criar ou arvore_bmais_construir.
+ * Pós-condições:
+ *      - Se a chave já existir, seu valor é substituído.
+ *      - Nós cheios são divididos e a altura da árvore cresce quando a raiz é dividida.
+ *      - Retorna SUCESSO (0) em caso de sucesso.
+ *      - Retorna valores negativos em caso de erro:
+ *              - ERRO_LER_INDICE (-27): falha na leitura de alguma página.
+ *              - ERRO_ESCREVER_INDICE (-28): falha na escrita de alguma página.
+ */
+int arvore_bmais_inserir_arquivo(FILE* arquivo, const unsigned char* chave, int valor) {
+        CABECALHO_ARVORE_BMAIS cabecalho;
+        int retorno = le_cabecalho_arvore(arquivo, &cabecalho);
+        if(retorno != SUCESSO)
+                goto descarregar_arquivo;
+
+        int dividiu, pagina_nova;
+        unsigned char chave_promovida[TAM_MAX_CHAVE_BMAIS];
+        retorno = inserir_recursivo(arquivo, &cabecalho, cabecalho.raiz, chave, valor, &dividiu, chave_promovida, &pagina_nova);
+        if(retorno != SUCESSO)
+                goto descarregar_arquivo;
+
+        if(dividiu) {
+                // raiz dividida: criar nova raiz com os dois nós como filhos
+                NO_BMAIS* raiz = malloc(sizeof(NO_BMAIS));
+                if(raiz == NULL) {
+                        retorno = ERRO_ESCREVER_INDICE;
+                        goto descarregar_arquivo;
+                }
+                raiz->folha = 0;
+                raiz->num_chaves = 1;
+                raiz->proxima = -1;
+                memcpy(raiz->chaves, chave_promovida, cabecalho.tamanho_chave);
+                raiz->ponteiros[0] = cabecalho.raiz;
+                raiz->ponteiros[1] = pagina_nova;
+
+                cabecalho.raiz = cabecalho.num_paginas++;
+                retorno = escreve_no(arquivo, &cabecalho, cabecalho.raiz, raiz);
+                free(raiz);
+                if(retorno != SUCESSO)
+                        goto descarregar_arquivo;
+        }
+
+        retorno = escreve_cabecalho_arvore(arquivo, &cabecalho);
+
+descarregar_arquivo:
+        // o arquivo continua aberto: as páginas alteradas vão para o disco ao fim de cada inserção
+        if(descarregar_arquivo_indice(arquivo) != SUCESSO && retorno == SUCESSO)
+                retorno = ERRO_ESCREVER_INDICE;
+
+        return retorno;
+}
+
+/*
+ * arvore_bmais_inserir - abre a árvore pelo caminho e chama arvore_bmais_inserir_arquivo
+ */
+int arvore_bmais_inserir(const char* caminho, const unsigned char* chave, int valor) {
+        FILE* arquivo = abrir_arquivo_indice(caminho, "r+b");
+        if(!arquivo)
+                return ERRO_ABRIR_ARQUIVO;
+
+        int retorno = arvore_bmais_inserir_arquivo(arquivo, chave, valor);
+        if(fechar_arquivo_indice(arquivo) != 0 && retorno == SUCESSO)
+                retorno = ERRO_ESCREVER_INDICE;
+
+        return retorno;
+}
+
+/*
+ * arvore_bmais_buscar_arquivo - busca o valor associado a uma chave
+ *
+ * @arquivo - arquivo da árvore aberto para leitura
+ * @chave - ponteiro para os bytes da chave
+ * @valor - ponteiro onde o valor encontrado será armazenado
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) se a chave foi encontrada.
+ *      - Retorna valores negativos em caso de erro:
+ *              - ERRO_ENCONTRAR_CHAVE (-29): a chave não existe na árvore.
+ *              - ERRO_LER_INDICE (-27): falha na leitura de alguma página.
+ */
+int arvore_bmais_buscar_arquivo(FILE* arquivo, const unsigned char* chave, int* valor) {
+        CABECALHO_ARVORE_BMAIS cabecalho;
+        NO_BMAIS* no = malloc(sizeof(NO_BMAIS));
+        int retorno = no == NULL ? ERRO_LER_INDICE : le_cabecalho_arvore(arquivo, &cabecalho);
+        if(retorno != SUCESSO)
+                goto liberar_no;
+
+        int pagina, igual;
+        retorno = descer_ate_folha(arquivo, &cabecalho, chave, no, &pagina);
+        if(retorno != SUCESSO)
+                goto liberar_no;
+
+        int indice = posicao_chave(no, cabecalho.tamanho_chave, chave, &igual);
+        if(!igual) {
+                retorno = ERRO_ENCONTRAR_CHAVE;
+                goto liberar_no;
+        }
+        *valor = no->ponteiros[indice];
+
+liberar_no:
+        free(no);
+
+        return retorno;
+}
+
+/*
+ * arvore_bmais_buscar - abre a árvore pelo caminho e chama arvore_bmais_buscar_arquivo
+ */
+int arvore_bmais_buscar(const char* caminho, const unsigned char* chave, int* valor) {
+        FILE* arquivo = abrir_arquivo_indice(caminho, "rb");
+        if(!arquivo)
+                return ERRO_ABRIR_ARQUIVO;
+
+        int retorno = arvore_bmais_buscar_arquivo(arquivo, chave, valor);
+        fechar_arquivo_indice(arquivo);
+
+        return retorno;
+}
+
+/*
+ * arvore_bmais_percorrer_intervalo_arquivo - visita, em ordem crescente, as chaves de um intervalo fechado
+ *
+ * @arquivo - arquivo da árvore aberto para leitura
+ * @chave_inicial - menor chave do intervalo (NULL para começar da primeira chave)
+ * @chave_final - maior chave do intervalo (NULL para ir até a última chave)
+ * @visitar - função chamada para cada chave do intervalo
+ * @contexto - ponteiro repassado para a função visitar
+ *
+ * A busca desce até a folha da chave inicial e segue o encadeamento das folhas, lendo
+ * apenas as páginas que contêm chaves do intervalo: O(log n + k).
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ao final da varredura (inclusive se interrompida pela função visitar).
+ *      - Retorna ERRO_LER_INDICE (-27) em caso de erro.
+ */
+int arvore_bmais_percorrer_intervalo_arquivo(
+        FILE* arquivo,
+        const unsigned char* chave_inicial,
+        const unsigned char* chave_final,
+        visitante_bmais visitar,
+        void* contexto
+) {
+        CABECALHO_ARVORE_BMAIS cabecalho;
+        NO_BMAIS* no = malloc(sizeof(NO_BMAIS));
+        int retorno = no == NULL ? ERRO_LER_INDICE : le_cabecalho_arvore(arquivo, &cabecalho);
+        if(retorno != SUCESSO)
+                goto liberar_no;
+
+        int pagina, indice = 0, igual;
+        if(chave_inicial == NULL) {
+                pagina = cabecalho.primeira_folha;
+                retorno = le_no(arquivo, &cabecalho, pagina, no);
+        }
+        else {
+                retorno = descer_ate_folha(arquivo, &cabecalho, chave_inicial, no, &pagina);
+                if(retorno == SUCESSO)
+                        indice = posicao_chave(no, cabecalho.tamanho_chave, chave_inicial, &igual);
+        }
+
+        int tam = cabecalho.tamanho_chave;
+        while(retorno == SUCESSO) {
+                for(; indice < no->num_chaves; indice++) {
+                        const unsigned char* chave = no->chaves + (size_t)indice * tam;
+                        if(chave_final != NULL && memcmp(chave, chave_final, tam) > 0)
+                                goto liberar_no;
+                        if(visitar(chave, no->ponteiros[indice], contexto) != 0)
+                                goto liberar_no;
+                }
+
+                if(no->proxima == -1)
+                        break;
+                pagina = no->proxima;
+                indice = 0;
+                retorno = le_no(arquivo, &cabecalho, pagina, no);
+        }
+
+liberar_no:
+        free(no);
+
+        return retorno;
+}
+
+/*
+ * arvore_bmais_percorrer_intervalo - abre a árvore pelo caminho e chama arvore_bmais_percorrer_intervalo_arquivo
+ */
+int arvore_bmais_percorrer_intervalo(
+        const char* caminho,
+        const unsigned char* chave_inicial,
+        const unsigned char* chave_final,
+        visitante_bmais visitar,
+        void* contexto
+) {
+        FILE* arquivo = abrir_arquivo_indice(caminho, "rb");
+        if(!arquivo)
+                return ERRO_ABRIR_ARQUIVO;
+
+        int retorno = arvore_bmais_percorrer_intervalo_arquivo(arquivo, chave_inicial, chave_final, visitar, contexto);
+        fechar_arquivo_indice(arquivo);
+
+        return retorno;
+}
@@ -0,0 +1,699 @@
+#include "../include/biblioteca.h"
+#include "../include/arquivo.h"
+#include "../include/armazenamento.h"
+#include "../include/diario.h"
+#include "../include/emprestimo.h"
+#include "../include/erros.h"
+#include "../include/livro.h"
+#include "../include/textos.h"
+#include "../include/trava.h"
+#include "../include/usuario.h"
+#include "../include/utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * abrir_arquivo_biblioteca - função interna que abre um arquivo de lista e lê seu cabeçalho
+ *
+ * @arquivo - estrutura que recebe o arquivo aberto, o cabeçalho e o caminho
+ * @caminho - caminho completo do arquivo (NULL deixa a estrutura vazia)
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ABRIR_ARQUIVO (-10) ou ERRO_LER_CABECALHO (-11).
+ *	- Em caso de erro nada fica aberto.
+ */
+static int abrir_arquivo_biblioteca(ARQUIVO_BIBLIOTECA* arquivo, const char* caminho) {
+        arquivo->arquivo = NULL;
+        memset(arquivo->indices, 0, sizeof(arquivo->indices));
+        arquivo->caminho[0] = '\0';
+        if(caminho == NULL)
+                return SUCESSO;
+
+        strncpy(arquivo->caminho, caminho, TAM_MAX_CAMINHO - 1);
+        arquivo->caminho[TAM_MAX_CAMINHO - 1] = '\0';
+
+        arquivo->arquivo = abrir_arquivo_dados(arquivo->caminho, "r+b");
+        if(arquivo->arquivo == NULL)
+                return ERRO_ABRIR_ARQUIVO;
+
+        if(ler_cabecalho_dados(arquivo->arquivo, &arquivo->cabecalho) != SUCESSO) {
+                fechar_arquivo_dados(arquivo->arquivo);
+                arquivo->arquivo = NULL;
+                return ERRO_LER_CABECALHO;
+        }
+
+        return SUCESSO;
+}
+
+/*
+ * fechar_arquivo_biblioteca - função interna que fecha um arquivo aberto por abrir_arquivo_biblioteca
+ */
+static void fechar_arquivo_biblioteca(ARQUIVO_BIBLIOTECA* arquivo) {
+        biblioteca_fechar_indices(arquivo);
+        fechar_arquivo_dados(arquivo->arquivo);
+        arquivo->arquivo = NULL;
+}
+
+FILE* biblioteca_indice(ARQUIVO_BIBLIOTECA* arquivo, const char* extensao) {
+        INDICE_ABERTO* livre = NULL;
+        for(int i = 0; i < MAX_INDICES_ARQUIVO; i++) {
+                INDICE_ABERTO* indice = &arquivo->indices[i];
+                if(indice->extensao != NULL && strcmp(indice->extensao, extensao) == 0)
+                        return indice->arquivo;
+                if(indice->extensao == NULL && livre == NULL)
+                        livre = indice;
+        }
+        if(livre == NULL)
+                return NULL;
+
+        char caminho_indice[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_indice, arquivo->caminho, extensao);
+        FILE* aberto = abrir_arquivo_indice(caminho_indice, "r+b");
+        if(aberto == NULL)
+                aberto = abrir_arquivo_indice(caminho_indice, "rb");
+        if(aberto == NULL)
+                return NULL;
+
+        livre->extensao = extensao;
+        livre->arquivo = aberto;
+        return aberto;
+}
+
+void biblioteca_fechar_indices(ARQUIVO_BIBLIOTECA* arquivo) {
+        for(int i = 0; i < MAX_INDICES_ARQUIVO; i++) {
+                if(arquivo->indices[i].extensao != NULL)
+                        fechar_arquivo_indice(arquivo->indices[i].arquivo);
+                arquivo->indices[i].extensao = NULL;
+                arquivo->indices[i].arquivo = NULL;
+        }
+}
+
+int biblioteca_abrir_arquivos(
+        BIBLIOTECA* biblioteca,
+        const char* caminho_arquivo_livro,
+        const char* caminho_arquivo_usuario,
+        const char* caminho_arquivo_emprestimo
+) {
+        int retorno;
+
+        biblioteca->usuarios.arquivo = NULL;
+        biblioteca->emprestimos.arquivo = NULL;
+        biblioteca->textos_livros.arquivo = NULL;
+        biblioteca->saida = stdout;
+        biblioteca->transacao = 0;
+        biblioteca->compartilhada = 0;
+        biblioteca->nivel_travas = 0;
+        biblioteca->travas_cabecalho = 0;
+        biblioteca->travas_registros = 0;
+
+        if((retorno = abrir_arquivo_biblioteca(&biblioteca->livros, caminho_arquivo_livro)) != SUCESSO)
+                return retorno;
+        if(caminho_arquivo_livro != NULL) {
+                if((retorno = textos_abrir(&biblioteca->textos_livros, caminho_arquivo_livro, COLUNAS_TEXTO_LIVRO, "r+b")) != SUCESSO)
+                        goto fechar_livros;
+        }
+        if((retorno = abrir_arquivo_biblioteca(&biblioteca->usuarios, caminho_arquivo_usuario)) != SUCESSO)
+                goto fechar_textos;
+        if((retorno = abrir_arquivo_biblioteca(&biblioteca->emprestimos, caminho_arquivo_emprestimo)) != SUCESSO)
+                goto fechar_usuarios;
+
+        return SUCESSO;
+
+fechar_usuarios:
+        fechar_arquivo_biblioteca(&biblioteca->usuarios);
+fechar_textos:
+        textos_fechar(&biblioteca->textos_livros);
+fechar_livros:
+        fechar_arquivo_biblioteca(&biblioteca->livros);
+
+        return retorno;
+}
+
+void biblioteca_fechar_arquivos(BIBLIOTECA* biblioteca) {
+        fechar_arquivo_biblioteca(&biblioteca->livros);
+        textos_fechar(&biblioteca->textos_livros);
+        fechar_arquivo_biblioteca(&biblioteca->usuarios);
+        fechar_arquivo_biblioteca(&biblioteca->emprestimos);
+}
+
+/*
+ * abrir_base - função interna que inicializa e abre a base de um diretório com o diário no modo informado
+ */
+static BIBLIOTECA* abrir_base(char* caminho_diretorio, int modo) {
+        char caminho_livros[TAM_MAX_CAMINHO];
+        char caminho_usuarios[TAM_MAX_CAMINHO];
+        char caminho_emprestimos[TAM_MAX_CAMINHO];
+
+        // mesmos caminhos montados por inicializar_base_de_dados
+        strncpy(caminho_livros, caminho_diretorio, TAM_MAX_CAMINHO - 1);
+        caminho_livros[TAM_MAX_CAMINHO - 1] = '\0';
+        construir_caminho_completo(caminho_livros, "livro.dat");
+
+        strncpy(caminho_usuarios, caminho_diretorio, TAM_MAX_CAMINHO - 1);
+        caminho_usuarios[TAM_MAX_CAMINHO - 1] = '\0';
+        construir_caminho_completo(caminho_usuarios, "usuario.dat");
+
+        strncpy(caminho_emprestimos, caminho_diretorio, TAM_MAX_CAMINHO - 1);
+        caminho_emprestimos[TAM_MAX_CAMINHO - 1] = '\0';
+        construir_caminho_completo(caminho_emprestimos, "emprestimo.dat");
+
+        BIBLIOTECA* biblioteca = malloc(sizeof(BIBLIOTECA));
+        if(biblioteca == NULL)
+                return NULL;
+
+        // o diário é aberto antes da inicialização: só o primeiro processo inicializa (e recupera) a base;
+        // sem diário (ex.: diretório somente leitura) as gravações vão direto aos arquivos
+        static const char* const nomes_diario[] = {"livro.dat", "usuario.dat", "emprestimo.dat"};
+        int sozinho = 1;
+        int retorno = diario_abrir(caminho_diretorio, nomes_diario, 3, modo, &sozinho);
+        if(retorno == ERRO_TRAVA_OCUPADA || retorno == ERRO_TRAVAR_ARQUIVO)
+                goto liberar_biblioteca;
+
+        if(sozinho && inicializar_base_de_dados(caminho_diretorio) < 0)
+                goto fechar_diario;
+
+        // um processo que não consegue usar o diário dos outros gravaria por fora das travas
+        if(retorno == SUCESSO && diario_preparar() != SUCESSO && !sozinho)
+                goto liberar_biblioteca;
+
+        if(modo == DIARIO_COMPARTILHADO && diario_aberto())
+                compartilhar_arquivos_dados();
+
+        // as gerações do diário só acompanham as alterações enquanto a base está aberta aqui (o primeiro
+        // processo a abrir a base as zera): o que ficou em memória de uma abertura anterior é descartado
+        descartar_caminho_dados(caminho_livros);
+        descartar_caminho_dados(caminho_usuarios);
+        descartar_caminho_dados(caminho_emprestimos);
+
+        if(biblioteca_abrir_arquivos(biblioteca, caminho_livros, caminho_usuarios, caminho_emprestimos) != SUCESSO)
+                goto fechar_diario;
+        biblioteca->compartilhada = modo == DIARIO_COMPARTILHADO && diario_aberto();
+
+        return biblioteca;
+
+fechar_diario:
+        diario_fechar();
+liberar_biblioteca:
+        free(biblioteca);
+
+        return NULL;
+}
+
+BIBLIOTECA* biblioteca_abrir(char* caminho_diretorio) {
+        return abrir_base(caminho_diretorio, DIARIO_COMPARTILHADO);
+}
+
+BIBLIOTECA* biblioteca_abrir_exclusiva(char* caminho_diretorio) {
+        return abrir_base(caminho_diretorio, DIARIO_EXCLUSIVO);
+}
+
+void biblioteca_fechar(BIBLIOTECA* biblioteca) {
+        if(biblioteca == NULL)
+                return;
+
+        if(biblioteca->transacao)
+                biblioteca_desfazer_transacao(biblioteca);
+        diario_fechar();
+        biblioteca_fechar_arquivos(biblioteca);
+        free(biblioteca);
+}
+
+/*
+ * arquivo_numero - função interna que retorna o arquivo de lista do bit (1 << numero) das máscaras BIBLIOTECA_*
+ */
+static ARQUIVO_BIBLIOTECA* arquivo_numero(BIBLIOTECA* biblioteca, int numero) {
+        ARQUIVO_BIBLIOTECA* arquivos[] = {&biblioteca->livros, &biblioteca->usuarios, &biblioteca->emprestimos};
+        return arquivos[numero];
+}
+
+/*
+ * mascara_diario - função interna que converte uma máscara de diario_arquivos_alterados em BIBLIOTECA_*
+ */
+static unsigned int mascara_diario(BIBLIOTECA* biblioteca, unsigned int alterados) {
+        unsigned int arquivos = 0;
+        for(int i = 0; i < 3; i++) {
+                int diario = diario_arquivo(arquivo_numero(biblioteca, i)->caminho);
+                if(diario >= 0 && (alterados & (1u << diario)))
+                        arquivos |= 1u << i;
+        }
+        return arquivos;
+}
+
+/*
+ * travar_arquivos - função interna que trava o cabeçalho ou os registros dos arquivos informados
+ *
+ * @arquivos - máscara BIBLIOTECA_* (arquivos não abertos são ignorados)
+ * @registros - 1 para a região dos registros (do fim do cabeçalho em diante), 0 para o cabeçalho
+ * @tipo - TRAVA_COMPARTILHADA ou TRAVA_EXCLUSIVA
+ *
+ * Os arquivos são travados em ordem, esperando outros processos. Em caso de erro, as travas já
+ * obtidas continuam registradas em biblioteca->travas_* para liberar_travas.
+ */
+static int travar_arquivos(BIBLIOTECA* biblioteca, unsigned int arquivos, int registros, tipo_trava tipo) {
+        for(int i = 0; i < 3; i++) {
+                ARQUIVO_BIBLIOTECA* arquivo = arquivo_numero(biblioteca, i);
+                if(!(arquivos & (1u << i)) || arquivo->arquivo == NULL)
+                        continue;
+
+                int retorno = registros ?
+                        travar_regiao(arquivo->arquivo, tipo, (long)sizeof(CABECALHO), 0, 1) :
+                        travar_regiao(arquivo->arquivo, tipo, 0, (long)sizeof(CABECALHO), 1);
+                if(retorno != SUCESSO)
+                        return retorno;
+
+                if(registros)
+                        biblioteca->travas_registros |= 1u << i;
+                else
+                        biblioteca->travas_cabecalho |= 1u << i;
+        }
+        return SUCESSO;
+}
+
+/*
+ * liberar_travas - função interna que libera todas as travas dos arquivos da biblioteca
+ */
+static void liberar_travas(BIBLIOTECA* biblioteca) {
+        unsigned int travados = biblioteca->travas_cabecalho | biblioteca->travas_registros;
+        for(int i = 0; i < 3; i++) {
+                ARQUIVO_BIBLIOTECA* arquivo = arquivo_numero(biblioteca, i);
+                if((travados & (1u << i)) && arquivo->arquivo != NULL)
+                        travar_regiao(arquivo->arquivo, TRAVA_LIVRE, 0, 0, 0);
+        }
+        biblioteca->travas_cabecalho = 0;
+        biblioteca->travas_registros = 0;
+}
+
+int biblioteca_gravar_cabecalho(ARQUIVO_BIBLIOTECA* arquivo, const CABECALHO* cabecalho) {
+        CABECALHO novo = *cabecalho;
+        if(escreve_cabecalho(arquivo->arquivo, &novo) != SUCESSO)
+                return ERRO_ESCREVER_CABECALHO;
+
+        // sem diário, cada operação termina com as suas páginas gravadas no disco, não só no cache
+        if(!diario_aberto())
+                descarregar_arquivo_dados(arquivo->arquivo);
+        arquivo->cabecalho = novo;
+
+        return SUCESSO;
+}
+
+void biblioteca_iniciar_operacao(BIBLIOTECA* biblioteca) {
+        (void)biblioteca;
+        diario_iniciar_operacao();
+}
+
+int biblioteca_confirmar_operacao(BIBLIOTECA* biblioteca) {
+        // os outros processos só deixam de ler os arquivos alterados enquanto a operação é aplicada
+        // (em uma transação, os registros já estão travados desde o início)
+        int retorno = SUCESSO;
+        if(biblioteca->compartilhada && !biblioteca->transacao)
+                retorno = travar_arquivos(biblioteca, mascara_diario(biblioteca, diario_arquivos_alterados()), 1, TRAVA_EXCLUSIVA);
+
+        if(retorno == SUCESSO)
+                retorno = diario_confirmar_operacao();
+        if(retorno != SUCESSO)
+                biblioteca_desfazer_operacao(biblioteca);
+        return retorno;
+}
+
+void biblioteca_desfazer_operacao(BIBLIOTECA* biblioteca) {
+        diario_desfazer_operacao();
+
+        // cabeçalhos residentes gravados pela operação voltam a ser os dos arquivos
+        ARQUIVO_BIBLIOTECA* arquivos[] = {&biblioteca->livros, &biblioteca->usuarios, &biblioteca->emprestimos};
+        for(int i = 0; i < 3; i++)
+                if(arquivos[i]->arquivo != NULL)
+                        ler_cabecalho_dados(arquivos[i]->arquivo, &arquivos[i]->cabecalho);
+}
+
+int biblioteca_sincronizar(BIBLIOTECA* biblioteca) {
+        (void)biblioteca;
+
+        // em modo compartilhado o grupo já está vazio: cada operação foi sincronizada ao ser confirmada
+        return diario_sincronizar();
+}
+
+/*
+ * reconstruir_indices - função interna que reconstrói os índices dos arquivos de lista informados
+ *
+ * @arquivos - máscara de diario_arquivos_alterados
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou o primeiro erro de reconstrução (os demais índices ainda são reconstruídos).
+ */
+static int reconstruir_indices(BIBLIOTECA* biblioteca, unsigned int arquivos) {
+        int retorno = SUCESSO;
+        int resultado;
+
+        if(arquivos & (1u << diario_arquivo(biblioteca->livros.caminho))) {
+                const char* caminho = biblioteca->livros.caminho;
+                biblioteca_fechar_indices(&biblioteca->livros);
+                if((resultado = reconstruir_indice_livro(caminho)) != SUCESSO && retorno == SUCESSO)
+                        retorno = resultado;
+                if((resultado = reconstruir_indice_titulo(caminho)) != SUCESSO && retorno == SUCESSO)
+                        retorno = resultado;
+                if((resultado = reconstruir_indice_autor(caminho)) != SUCESSO && retorno == SUCESSO)
+                        retorno = resultado;
+                if((resultado = reconstruir_indice_trigramas(caminho)) != SUCESSO && retorno == SUCESSO)
+                        retorno = resultado;
+        }
+        if(arquivos & (1u << diario_arquivo(biblioteca->usuarios.caminho))) {
+                biblioteca_fechar_indices(&biblioteca->usuarios);
+                if((resultado = reconstruir_indice_usuario(biblioteca->usuarios.caminho)) != SUCESSO && retorno == SUCESSO)
+                        retorno = resultado;
+        }
+        if(arquivos & (1u << diario_arquivo(biblioteca->emprestimos.caminho))) {
+                const char* caminho = biblioteca->emprestimos.caminho;
+                biblioteca_fechar_indices(&biblioteca->emprestimos);
+                if((resultado = reconstruir_indice_emprestimo(caminho)) != SUCESSO && retorno == SUCESSO)
+                        retorno = resultado;
+                if((resultado = reconstruir_indice_datas_emprestimo(caminho)) != SUCESSO && retorno == SUCESSO)
+                        retorno = resultado;
+        }
+
+        return retorno;
+}
+
+/*
+ * atualizar_arquivo - função interna que descarta o que o processo guarda de um arquivo alterado por outro processo
+ *
+ * Páginas em cache, cabeçalho residente e índices abertos; no arquivo de livros, também a área
+ * de textos, cujos buffers do stdio podem ter trechos antigos.
+ */
+static int atualizar_arquivo(BIBLIOTECA* biblioteca, int numero) {
+        ARQUIVO_BIBLIOTECA* arquivo = arquivo_numero(biblioteca, numero);
+        biblioteca_fechar_indices(arquivo);
+
+        int retorno = descartar_caminho_dados(arquivo->caminho);
+        if(retorno == SUCESSO && ler_cabecalho_dados(arquivo->arquivo, &arquivo->cabecalho) != SUCESSO)
+                retorno = ERRO_LER_CABECALHO;
+
+        if(retorno == SUCESSO && arquivo == &biblioteca->livros && biblioteca->textos_livros.arquivo != NULL) {
+                textos_fechar(&biblioteca->textos_livros);
+                retorno = textos_abrir(&biblioteca->textos_livros, arquivo->caminho, COLUNAS_TEXTO_LIVRO, "r+b");
+        }
+
+        return retorno;
+}
+
+/*
+ * conferir_arquivos - função interna que atualiza os arquivos travados que outros processos alteraram
+ *
+ * @interrompidos - recebe a máscara dos arquivos com aplicação interrompida (diario_reparar)
+ */
+static int conferir_arquivos(BIBLIOTECA* biblioteca, unsigned int arquivos, unsigned int* interrompidos) {
+        *interrompidos = 0;
+        for(int i = 0; i < 3; i++) {
+                ARQUIVO_BIBLIOTECA* arquivo = arquivo_numero(biblioteca, i);
+                if(!(arquivos & (1u << i)) || arquivo->arquivo == NULL)
+                        continue;
+
+                int situacao = diario_situacao(diario_arquivo(arquivo->caminho));
+                if(situacao & DIARIO_ARQUIVO_ALTERADO) {
+                        int retorno = atualizar_arquivo(biblioteca, i);
+                        if(retorno != SUCESSO)
+                                return retorno;
+                }
+                if(situacao & DIARIO_APLICACAO_INTERROMPIDA)
+                        *interrompidos |= 1u << i;
+        }
+        return SUCESSO;
+}
+
+/*
+ * reparar_arquivos - função interna que termina as aplicações interrompidas nos arquivos informados
+ *
+ * Pré-condições:
+ *	- Os cabeçalhos dos arquivos devem estar travados por este processo.
+ * Pós-condições:
+ *	- Os registros são travados em modo exclusivo durante o reparo e liberados no final; os índices
+ *	dos arquivos com gravações refeitas são reconstruídos.
+ */
+static int reparar_arquivos(BIBLIOTECA* biblioteca, unsigned int arquivos) {
+        int retorno = travar_arquivos(biblioteca, arquivos, 1, TRAVA_EXCLUSIVA);
+
+        for(int i = 0; i < 3 && retorno == SUCESSO; i++) {
+                if(!(arquivos & (1u << i)))
+                        continue;
+
+                // a aplicação interrompida pode ter deixado páginas e cabeçalho pela metade
+                ARQUIVO_BIBLIOTECA* arquivo = arquivo_numero(biblioteca, i);
+                int diario = diario_arquivo(arquivo->caminho);
+                if((retorno = atualizar_arquivo(biblioteca, i)) != SUCESSO)
+                        break;
+
+                int reparo = diario_reparar(diario);
+                if(reparo < 0) {
+                        retorno = reparo;
+                        break;
+                }
+                if(reparo > 0) {
+                        ler_cabecalho_dados(arquivo->arquivo, &arquivo->cabecalho);
+                        retorno = reconstruir_indices(biblioteca, 1u << diario);
+                }
+                diario_concluir_aplicacao();
+        }
+
+        for(int i = 0; i < 3; i++) {
+                ARQUIVO_BIBLIOTECA* arquivo = arquivo_numero(biblioteca, i);
+                if((arquivos & biblioteca->travas_registros & (1u << i)) && arquivo->arquivo != NULL)
+                        travar_regiao(arquivo->arquivo, TRAVA_LIVRE, (long)sizeof(CABECALHO), 0, 0);
+        }
+        biblioteca->travas_registros &= ~arquivos;
+
+        return retorno;
+}
+
+int biblioteca_travar_leitura(BIBLIOTECA* biblioteca, unsigned int arquivos) {
+        // sem outros processos só o nível é contado (biblioteca_destravar faz o checkpoint no último)
+        if(!biblioteca->compartilhada || biblioteca->nivel_travas > 0) {
+                biblioteca->nivel_travas++;
+                return SUCESSO;
+        }
+
+        for(;;) {
+                unsigned int interrompidos = 0;
+                int retorno = travar_arquivos(biblioteca, arquivos, 1, TRAVA_COMPARTILHADA);
+                if(retorno == SUCESSO)
+                        retorno = conferir_arquivos(biblioteca, arquivos, &interrompidos);
+                if(retorno != SUCESSO) {
+                        liberar_travas(biblioteca);
+                        return retorno;
+                }
+                if(interrompidos == 0)
+                        break;
+
+                // o reparo exige as travas de quem grava: as de leitura são soltas e obtidas de novo no final
+                liberar_travas(biblioteca);
+                retorno = travar_arquivos(biblioteca, interrompidos, 0, TRAVA_EXCLUSIVA);
+                if(retorno == SUCESSO)
+                        retorno = reparar_arquivos(biblioteca, interrompidos);
+                liberar_travas(biblioteca);
+                if(retorno != SUCESSO)
+                        return retorno;
+        }
+
+        biblioteca->nivel_travas = 1;
+        return SUCESSO;
+}
+
+int biblioteca_travar_escrita(BIBLIOTECA* biblioteca, unsigned int arquivos) {
+        // sem outros processos só o nível é contado (biblioteca_destravar faz o checkpoint no último)
+        if(!biblioteca->compartilhada || biblioteca->nivel_travas > 0) {
+                biblioteca->nivel_travas++;
+                return SUCESSO;
+        }
+
+        unsigned int interrompidos = 0;
+        int retorno = travar_arquivos(biblioteca, arquivos, 0, TRAVA_EXCLUSIVA);
+        if(retorno == SUCESSO)
+                retorno = conferir_arquivos(biblioteca, arquivos, &interrompidos);
+        if(retorno == SUCESSO && interrompidos != 0)
+                retorno = reparar_arquivos(biblioteca, interrompidos);
+
+        // textos acrescentados por outro processo (também por uma operação que não chegou a ser confirmada)
+        if(retorno == SUCESSO && (arquivos & BIBLIOTECA_LIVROS))
+                retorno = textos_medir(&biblioteca->textos_livros);
+
+        if(retorno != SUCESSO) {
+                liberar_travas(biblioteca);
+                return retorno;
+        }
+
+        biblioteca->nivel_travas = 1;
+        return SUCESSO;
+}
+
+/*
+ * checkpoint_travado - função interna que esvazia o diário compartilhado com todos os arquivos travados
+ */
+static void checkpoint_travado(BIBLIOTECA* biblioteca) {
+        if(
+                travar_arquivos(biblioteca, BIBLIOTECA_TODOS, 0, TRAVA_EXCLUSIVA) == SUCESSO &&
+                travar_arquivos(biblioteca, BIBLIOTECA_TODOS, 1, TRAVA_EXCLUSIVA) == SUCESSO
+        ) {
+                diario_checkpoint();
+        }
+        liberar_travas(biblioteca);
+}
+
+void biblioteca_destravar(BIBLIOTECA* biblioteca) {
+        if(biblioteca->nivel_travas == 0 || --biblioteca->nivel_travas > 0)
+                return;
+
+        // a operação terminou com os índices atualizados: o diário já pode ser esvaziado
+        if(!biblioteca->compartilhada) {
+                if(diario_checkpoint_pendente())
+                        diario_checkpoint();
+                return;
+        }
+
+        // a geração só muda com os arquivos ainda travados: quem travar depois enxerga a alteração
+        diario_concluir_aplicacao();
+        liberar_travas(biblioteca);
+
+        if(diario_checkpoint_pendente())
+                checkpoint_travado(biblioteca);
+}
+
+int biblioteca_iniciar_transacao(BIBLIOTECA* biblioteca) {
+        // sem diário as gravações vão direto aos arquivos e não há como desfazê-las
+        if(biblioteca->transacao || !diario_aberto())
+                return ERRO_TRANSACAO;
+
+        // a transação lê e grava qualquer arquivo, e as suas gravações só chegam a eles na confirmação
+        int retorno = biblioteca_travar_escrita(biblioteca, BIBLIOTECA_TODOS);
+        if(retorno != SUCESSO)
+                return retorno;
+        if(biblioteca->compartilhada)
+                retorno = travar_arquivos(biblioteca, BIBLIOTECA_TODOS, 1, TRAVA_EXCLUSIVA);
+
+        if(retorno == SUCESSO)
+                retorno = diario_iniciar_operacao();
+        if(retorno != SUCESSO) {
+                biblioteca_destravar(biblioteca);
+                return retorno;
+        }
+        biblioteca->transacao = 1;
+
+        return SUCESSO;
+}
+
+int biblioteca_confirmar_transacao(BIBLIOTECA* biblioteca) {
+        if(!biblioteca->transacao)
+                return ERRO_TRANSACAO;
+
+        unsigned int alterados = diario_arquivos_alterados();
+        biblioteca->transacao = 0;
+
+        // um único registro no diário para a transação inteira
+        int retorno = diario_confirmar_operacao();
+        if(retorno != SUCESSO) {
+                biblioteca_desfazer_operacao(biblioteca);
+                reconstruir_indices(biblioteca, alterados);
+        } else {
+                // e um único fsync, sem esperar o grupo completar
+                retorno = diario_sincronizar();
+        }
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+int biblioteca_desfazer_transacao(BIBLIOTECA* biblioteca) {
+        if(!biblioteca->transacao)
+                return ERRO_TRANSACAO;
+
+        unsigned int alterados = diario_arquivos_alterados();
+        biblioteca->transacao = 0;
+        biblioteca_desfazer_operacao(biblioteca);
+
+        // as entradas de índice das operações desfeitas apontariam para registros que não existem mais
+        int retorno = reconstruir_indices(biblioteca, alterados);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+int biblioteca_recarregar(BIBLIOTECA* biblioteca) {
+        char caminho_livros[TAM_MAX_CAMINHO];
+        char caminho_usuarios[TAM_MAX_CAMINHO];
+        char caminho_emprestimos[TAM_MAX_CAMINHO];
+
+        strcpy(caminho_livros, biblioteca->livros.caminho);
+        strcpy(caminho_usuarios, biblioteca->usuarios.caminho);
+        strcpy(caminho_emprestimos, biblioteca->emprestimos.caminho);
+        FILE* saida = biblioteca->saida;
+        int compartilhada = biblioteca->compartilhada;
+        int nivel_travas = biblioteca->nivel_travas;
+
+        // as travas pertencem aos arquivos fechados aqui
+        biblioteca_fechar_arquivos(biblioteca);
+
+        int retorno = biblioteca_abrir_arquivos(
+                biblioteca,
+                caminho_livros[0] != '\0' ? caminho_livros : NULL,
+                caminho_usuarios[0] != '\0' ? caminho_usuarios : NULL,
+                caminho_emprestimos[0] != '\0' ? caminho_emprestimos : NULL
+        );
+        biblioteca->saida = saida;
+        biblioteca->compartilhada = compartilhada;
+        biblioteca->nivel_travas = nivel_travas;
+
+        return retorno;
+}
+
+int biblioteca_processar_lote(BIBLIOTECA* biblioteca, const char* caminho_arquivo_lote) {
+        // as gravações pendentes da transação ficariam por cima das da carga
+        if(biblioteca->transacao)
+                return ERRO_TRANSACAO;
+
+        // a carga grava por fora do diário: nenhum outro processo pode ler nem gravar até ela terminar
+        int retorno_trava = biblioteca_travar_escrita(biblioteca, BIBLIOTECA_TODOS);
+        if(retorno_trava != SUCESSO)
+                return retorno_trava;
+        if(biblioteca->compartilhada && (retorno_trava = travar_arquivos(biblioteca, BIBLIOTECA_TODOS, 1, TRAVA_EXCLUSIVA)) != SUCESSO) {
+                biblioteca_destravar(biblioteca);
+                return retorno_trava;
+        }
+
+        // a carga abre os arquivos por conta própria: tudo o que foi gravado pela biblioteca deve estar no
+        // arquivo, e o diário não pode ter gravações antigas a reaplicar por cima das da carga
+        int retorno_diario = diario_checkpoint();
+        if(retorno_diario != SUCESSO) {
+                biblioteca_destravar(biblioteca);
+                return retorno_diario;
+        }
+        descarregar_arquivo_dados(biblioteca->livros.arquivo);
+        descarregar_arquivo_dados(biblioteca->usuarios.arquivo);
+        descarregar_arquivo_dados(biblioteca->emprestimos.arquivo);
+        textos_descarregar(&biblioteca->textos_livros);
+
+        // a carga recria os índices por fopen: nenhum pode continuar aberto (e com páginas no cache)
+        biblioteca_fechar_indices(&biblioteca->livros);
+        biblioteca_fechar_indices(&biblioteca->usuarios);
+        biblioteca_fechar_indices(&biblioteca->emprestimos);
+
+        int retorno = processar_lote(
+                caminho_arquivo_lote,
+                biblioteca->emprestimos.caminho,
+                biblioteca->livros.caminho,
+                biblioteca->usuarios.caminho
+        );
+
+        // os outros processos descartam o que guardam dos arquivos; a publicação vem antes da recarga,
+        // que fecha os arquivos e com eles as travas
+        if(biblioteca->compartilhada) {
+                diario_registrar_alteracao((1u << diario_arquivo(biblioteca->livros.caminho)) |
+                        (1u << diario_arquivo(biblioteca->usuarios.caminho)) | (1u << diario_arquivo(biblioteca->emprestimos.caminho)));
+                diario_concluir_aplicacao();
+        }
+
+        int retorno_recarga = biblioteca_recarregar(biblioteca);
+        biblioteca_destravar(biblioteca);
+        if(retorno_recarga != SUCESSO)
+                return retorno_recarga;
+
+        return retorno;
+}
@@ -0,0 +1,482 @@
+#include "../include/cache_paginas.h"
+#include "../include/erros.h"
+#include "../include/utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * ARQUIVO_CACHE - arquivo registrado no cache
+ *
+ * @caminho - caminho usado no registro (chave de busca)
+ * @arquivo - FILE aberto pelo próprio cache, sem buffer do stdio
+ * @somente_leitura - indica que o arquivo só pôde ser aberto para leitura
+ * @tamanho - tamanho do arquivo considerando as páginas sujas ainda não gravadas
+ */
+typedef struct {
+        char caminho[TAM_MAX_CAMINHO];
+        FILE* arquivo;
+        int somente_leitura;
+        long tamanho;
+} ARQUIVO_CACHE;
+
+/*
+ * PAGINA_CACHE - moldura de página do cache
+ *
+ * @arquivo - identificador do arquivo da página (-1 se a moldura estiver livre)
+ * @numero - número da página dentro do arquivo
+ * @suja - indica que a página foi alterada e ainda não foi gravada
+ * @mais_recente / @menos_recente - vizinhos na lista LRU
+ * @proxima_balde - próxima página do mesmo balde da tabela de busca
+ * @dados - TAM_PAGINA_CACHE bytes da página
+ */
+typedef struct {
+        int arquivo;
+        long numero;
+        int suja;
+        int mais_recente;
+        int menos_recente;
+        int proxima_balde;
+        unsigned char* dados;
+} PAGINA_CACHE;
+
+static ARQUIVO_CACHE arquivos[MAX_ARQUIVOS_CACHE];
+static int num_arquivos = 0;
+
+static PAGINA_CACHE* paginas = NULL;
+static unsigned char* memoria = NULL;
+static int num_paginas = 0;
+static int* baldes = NULL;
+static int num_baldes = 0;
+static int inicio_lru = -1;     // página usada mais recentemente
+static int fim_lru = -1;        // próxima página a ser substituída
+
+/*
+ * reservar_memoria - função interna que aloca as molduras na primeira utilização do cache
+ *
+ * Pós-condições:
+ *      - Todas as molduras começam livres na lista LRU.
+ *      - Retorna SUCESSO (0) ou ERRO_ALOCAR_MEMORIA (-30) se o limite de memória não comportar
+ *      duas páginas ou a alocação falhar.
+ */
+static int reservar_memoria(void) {
+        if(paginas != NULL)
+                return SUCESSO;
+
+        long quantidade = LIMITE_MEMORIA_CACHE / TAM_PAGINA_CACHE;
+        if(quantidade < 2)
+                return ERRO_ALOCAR_MEMORIA;
+
+        int quantidade_baldes = 1;
+        while(quantidade_baldes < 2 * quantidade)
+                quantidade_baldes *= 2;
+
+        paginas = malloc(quantidade * sizeof(PAGINA_CACHE));
+        memoria = malloc(quantidade * TAM_PAGINA_CACHE);
+        baldes = malloc(quantidade_baldes * sizeof(int));
+        if(paginas == NULL || memoria == NULL || baldes == NULL) {
+                free(paginas);
+                free(memoria);
+                free(baldes);
+                paginas = NULL;
+                memoria = NULL;
+                baldes = NULL;
+                return ERRO_ALOCAR_MEMORIA;
+        }
+
+        num_paginas = (int)quantidade;
+        num_baldes = quantidade_baldes;
+        for(int i = 0; i < num_baldes; i++)
+                baldes[i] = -1;
+
+        for(int i = 0; i < num_paginas; i++) {
+                paginas[i].arquivo = -1;
+                paginas[i].numero = 0;
+                paginas[i].suja = 0;
+                paginas[i].mais_recente = i - 1;
+                paginas[i].menos_recente = i + 1 < num_paginas ? i + 1 : -1;
+                paginas[i].proxima_balde = -1;
+                paginas[i].dados = memoria + (size_t)i * TAM_PAGINA_CACHE;
+        }
+        inicio_lru = 0;
+        fim_lru = num_paginas - 1;
+
+        return SUCESSO;
+}
+
+/*
+ * balde_de - função interna que calcula o balde da tabela de busca de uma página
+ */
+static int balde_de(int arquivo, long numero) {
+        unsigned long espalhamento = (unsigned long)numero * 2654435761UL + (unsigned long)arquivo * 40503UL;
+        return (int)(espalhamento & (unsigned long)(num_baldes - 1));
+}
+
+/*
+ * inserir_balde / remover_balde - funções internas que mantêm a tabela de busca das páginas ocupadas
+ */
+static void inserir_balde(int i) {
+        int balde = balde_de(paginas[i].arquivo, paginas[i].numero);
+        paginas[i].proxima_balde = baldes[balde];
+        baldes[balde] = i;
+}
+
+static void remover_balde(int i) {
+        int* elo = &baldes[balde_de(paginas[i].arquivo, paginas[i].numero)];
+        while(*elo != -1 && *elo != i)
+                elo = &paginas[*elo].proxima_balde;
+        if(*elo == i)
+                *elo = paginas[i].proxima_balde;
+        paginas[i].proxima_balde = -1;
+}
+
+/*
+ * retirar_lru - função interna que retira uma página da lista LRU
+ */
+static void retirar_lru(int i) {
+        if(paginas[i].mais_recente != -1)
+                paginas[paginas[i].mais_recente].menos_recente = paginas[i].menos_recente;
+        else
+                inicio_lru = paginas[i].menos_recente;
+
+        if(paginas[i].menos_recente != -1)
+                paginas[paginas[i].menos_recente].mais_recente = paginas[i].mais_recente;
+        else
+                fim_lru = paginas[i].mais_recente;
+}
+
+/*
+ * usar_pagina - função interna que move a página para o início da lista LRU
+ */
+static void usar_pagina(int i) {
+        if(inicio_lru == i)
+                return;
+
+        retirar_lru(i);
+        paginas[i].mais_recente = -1;
+        paginas[i].menos_recente = inicio_lru;
+        paginas[inicio_lru].mais_recente = i;
+        inicio_lru = i;
+}
+
+/*
+ * liberar_pagina - função interna que retira a página da tabela e a coloca no fim da lista LRU
+ *
+ * Molduras livres ficam no fim da lista para serem reaproveitadas antes das ocupadas.
+ */
+static void liberar_pagina(int i) {
+        remover_balde(i);
+        paginas[i].arquivo = -1;
+        paginas[i].suja = 0;
+
+        if(fim_lru == i)
+                return;
+
+        retirar_lru(i);
+        paginas[i].menos_recente = -1;
+        paginas[i].mais_recente = fim_lru;
+        paginas[fim_lru].menos_recente = i;
+        fim_lru = i;
+}
+
+/*
+ * medir_tamanho - função interna que retorna o tamanho do arquivo em disco (ou -1 em caso de erro)
+ */
+static long medir_tamanho(FILE* arquivo) {
+        if(fseek(arquivo, 0, SEEK_END) != 0)
+                return -1;
+        return ftell(arquivo);
+}
+
+/*
+ * gravar_pagina - função interna que grava uma página suja no arquivo
+ *
+ * Apenas a parte da página dentro do tamanho do arquivo é gravada.
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_WRITE (-2).
+ */
+static int gravar_pagina(int i) {
+        PAGINA_CACHE* pagina = &paginas[i];
+        if(!pagina->suja)
+                return SUCESSO;
+
+        ARQUIVO_CACHE* arquivo = &arquivos[pagina->arquivo];
+        long inicio = pagina->numero * TAM_PAGINA_CACHE;
+        long quantidade = arquivo->tamanho - inicio;
+        if(quantidade > TAM_PAGINA_CACHE)
+                quantidade = TAM_PAGINA_CACHE;
+
+        if(quantidade > 0) {
+                if(fseek(arquivo->arquivo, inicio, SEEK_SET) != 0)
+                        return ERRO_ARQUIVO_SEEK;
+                if(fwrite(pagina->dados, (size_t)quantidade, 1, arquivo->arquivo) != 1)
+                        return ERRO_ARQUIVO_WRITE;
+        }
+
+        pagina->suja = 0;
+        return SUCESSO;
+}
+
+/*
+ * obter_pagina - função interna que retorna a moldura de uma página, carregando-a se necessário
+ *
+ * @arquivo - identificador do arquivo
+ * @numero - número da página
+ * @erro - recebe o código de erro quando a página não puder ser obtida
+ *
+ * Quando não há moldura livre, a página usada há mais tempo é substituída (gravada antes, se suja).
+ * Bytes além do fim do arquivo em disco são preenchidos com zero.
+ *
+ * Pós-condições:
+ *      - Retorna o índice da moldura, já no início da lista LRU, ou -1 em caso de erro.
+ */
+static int obter_pagina(int arquivo, long numero, int* erro) {
+        int i = baldes[balde_de(arquivo, numero)];
+        while(i != -1 && (paginas[i].arquivo != arquivo || paginas[i].numero != numero))
+                i = paginas[i].proxima_balde;
+
+        if(i != -1) {
+                usar_pagina(i);
+                return i;
+        }
+
+        i = fim_lru;
+        if(paginas[i].arquivo != -1) {
+                if((*erro = gravar_pagina(i)) != SUCESSO)
+                        return -1;
+                liberar_pagina(i);
+        }
+
+        FILE* origem = arquivos[arquivo].arquivo;
+        if(fseek(origem, numero * TAM_PAGINA_CACHE, SEEK_SET) != 0) {
+                *erro = ERRO_ARQUIVO_SEEK;
+                return -1;
+        }
+
+        size_t lidos = fread(paginas[i].dados, 1, TAM_PAGINA_CACHE, origem);
+        if(ferror(origem)) {
+                clearerr(origem);
+                *erro = ERRO_ARQUIVO_READ;
+                return -1;
+        }
+        clearerr(origem);
+        memset(paginas[i].dados + lidos, 0, TAM_PAGINA_CACHE - lidos);
+
+        paginas[i].arquivo = arquivo;
+        paginas[i].numero = numero;
+        paginas[i].suja = 0;
+        inserir_balde(i);
+        usar_pagina(i);
+
+        return i;
+}
+
+/*
+ * atualizar_tamanho - função interna chamada quando uma leitura passa do tamanho conhecido
+ *
+ * O arquivo pode ter crescido por outro caminho; nesse caso as páginas limpas a partir do
+ * antigo fim do arquivo são descartadas, pois foram carregadas com zeros no lugar dos dados novos.
+ */
+static void atualizar_tamanho(int arquivo) {
+        ARQUIVO_CACHE* registro = &arquivos[arquivo];
+        long tamanho = medir_tamanho(registro->arquivo);
+        if(tamanho <= registro->tamanho)
+                return;
+
+        long primeira = registro->tamanho / TAM_PAGINA_CACHE;
+        for(int i = 0; i < num_paginas; i++)
+                if(paginas[i].arquivo == arquivo && paginas[i].numero >= primeira && !paginas[i].suja)
+                        liberar_pagina(i);
+
+        registro->tamanho = tamanho;
+}
+
+int cache_paginas_buscar(const char* caminho) {
+        for(int i = 0; i < num_arquivos; i++)
+                if(arquivos[i].arquivo != NULL && strcmp(arquivos[i].caminho, caminho) == 0)
+                        return i;
+        return -1;
+}
+
+int cache_paginas_abrir(const char* caminho) {
+        int identificador = cache_paginas_buscar(caminho);
+        if(identificador >= 0)
+                return identificador;
+
+        int retorno = reservar_memoria();
+        if(retorno != SUCESSO)
+                return retorno;
+
+        if(strlen(caminho) >= TAM_MAX_CAMINHO)
+                return ERRO_ABRIR_ARQUIVO;
+
+        // posições de arquivos fechados são reaproveitadas antes de aumentar a tabela
+        identificador = 0;
+        while(identificador < num_arquivos && arquivos[identificador].arquivo != NULL)
+                identificador++;
+        if(identificador == MAX_ARQUIVOS_CACHE)
+                return ERRO_ABRIR_ARQUIVO;
+
+        ARQUIVO_CACHE* registro = &arquivos[identificador];
+        registro->somente_leitura = 0;
+        registro->arquivo = fopen(caminho, "r+b");
+        if(registro->arquivo == NULL) {
+                registro->arquivo = fopen(caminho, "rb");
+                registro->somente_leitura = 1;
+        }
+        if(registro->arquivo == NULL)
+                return ERRO_ABRIR_ARQUIVO;
+
+        // o cache já lê e grava páginas inteiras: o buffer do stdio só duplicaria as cópias
+        setvbuf(registro->arquivo, NULL, _IONBF, 0);
+
+        registro->tamanho = medir_tamanho(registro->arquivo);
+        if(registro->tamanho < 0) {
+                fclose(registro->arquivo);
+                registro->arquivo = NULL;
+                return ERRO_ABRIR_ARQUIVO;
+        }
+
+        strcpy(registro->caminho, caminho);
+        if(identificador == num_arquivos)
+                num_arquivos++;
+        return identificador;
+}
+
+int cache_paginas_ler(int arquivo, long deslocamento, size_t tamanho, void* destino) {
+        if(deslocamento < 0)
+                return ERRO_ARQUIVO_SEEK;
+
+        if(deslocamento + (long)tamanho > arquivos[arquivo].tamanho) {
+                atualizar_tamanho(arquivo);
+                if(deslocamento + (long)tamanho > arquivos[arquivo].tamanho)
+                        return ERRO_ARQUIVO_READ;
+        }
+
+        unsigned char* saida = destino;
+        while(tamanho > 0) {
+                long numero = deslocamento / TAM_PAGINA_CACHE;
+                size_t inicio = (size_t)(deslocamento % TAM_PAGINA_CACHE);
+                size_t parte = TAM_PAGINA_CACHE - inicio < tamanho ? TAM_PAGINA_CACHE - inicio : tamanho;
+
+                int erro = SUCESSO;
+                int i = obter_pagina(arquivo, numero, &erro);
+                if(i < 0)
+                        return erro;
+                memcpy(saida, paginas[i].dados + inicio, parte);
+
+                saida += parte;
+                deslocamento += (long)parte;
+                tamanho -= parte;
+        }
+
+        return SUCESSO;
+}
+
+int cache_paginas_escrever(int arquivo, long deslocamento, size_t tamanho, const void* origem) {
+        if(deslocamento < 0)
+                return ERRO_ARQUIVO_SEEK;
+        if(arquivos[arquivo].somente_leitura)
+                return ERRO_ARQUIVO_WRITE;
+
+        // o novo tamanho vale antes da cópia: uma página substituída no meio da gravação é gravada inteira
+        if(deslocamento + (long)tamanho > arquivos[arquivo].tamanho)
+                arquivos[arquivo].tamanho = deslocamento + (long)tamanho;
+
+        const unsigned char* entrada = origem;
+        while(tamanho > 0) {
+                long numero = deslocamento / TAM_PAGINA_CACHE;
+                size_t inicio = (size_t)(deslocamento % TAM_PAGINA_CACHE);
+                size_t parte = TAM_PAGINA_CACHE - inicio < tamanho ? TAM_PAGINA_CACHE - inicio : tamanho;
+
+                int erro = SUCESSO;
+                int i = obter_pagina(arquivo, numero, &erro);
+                if(i < 0)
+                        return erro;
+                memcpy(paginas[i].dados + inicio, entrada, parte);
+                paginas[i].suja = 1;
+
+                entrada += parte;
+                deslocamento += (long)parte;
+                tamanho -= parte;
+        }
+
+        return SUCESSO;
+}
+
+long cache_paginas_tamanho(int arquivo) {
+        return arquivos[arquivo].tamanho;
+}
+
+int cache_paginas_descarregar(int arquivo) {
+        int retorno = SUCESSO;
+        for(int i = 0; i < num_paginas; i++) {
+                if(paginas[i].arquivo != arquivo || !paginas[i].suja)
+                        continue;
+
+                int erro = gravar_pagina(i);
+                if(erro != SUCESSO && retorno == SUCESSO)
+                        retorno = erro;
+        }
+
+        return retorno;
+}
+
+int cache_paginas_descartar(int arquivo) {
+        int retorno = cache_paginas_descarregar(arquivo);
+
+        for(int i = 0; i < num_paginas; i++)
+                if(paginas[i].arquivo == arquivo)
+                        liberar_pagina(i);
+
+        long tamanho = medir_tamanho(arquivos[arquivo].arquivo);
+        if(tamanho >= 0)
+                arquivos[arquivo].tamanho = tamanho;
+
+        return retorno;
+}
+
+int cache_paginas_fechar(int arquivo) {
+        int retorno = SUCESSO;
+        for(int i = 0; i < num_paginas; i++) {
+                if(paginas[i].arquivo != arquivo)
+                        continue;
+
+                int erro = gravar_pagina(i);
+                if(erro != SUCESSO && retorno == SUCESSO)
+                        retorno = erro;
+                liberar_pagina(i);
+        }
+
+        if(fclose(arquivos[arquivo].arquivo) != 0 && retorno == SUCESSO)
+                retorno = ERRO_ARQUIVO_WRITE;
+        arquivos[arquivo].arquivo = NULL;
+        arquivos[arquivo].caminho[0] = '\0';
+
+        return retorno;
+}
+
+void cache_paginas_encerrar(void) {
+        for(int i = 0; i < num_arquivos; i++) {
+                if(arquivos[i].arquivo == NULL)
+                        continue;
+                cache_paginas_descarregar(i);
+                fclose(arquivos[i].arquivo);
+                arquivos[i].arquivo = NULL;
+                arquivos[i].caminho[0] = '\0';
+        }
+        num_arquivos = 0;
+
+        free(paginas);
+        free(memoria);
+        free(baldes);
+        paginas = NULL;
+        memoria = NULL;
+        baldes = NULL;
+        num_paginas = 0;
+        num_baldes = 0;
+        inicio_lru = -1;
+        fim_lru = -1;
+}
@@ -0,0 +1,763 @@
+#include "../include/carga.h"
+#include "../include/armazenamento.h"
+#include "../include/indice_hash.h"
+#include "../include/indice_invertido.h"
+#include "../include/erros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * deslocamento_registro - função interna que calcula o deslocamento de uma posição no arquivo
+ */
+static long deslocamento_registro(const ARQUIVO_CARGA* arquivo, int posicao) {
+        return (long)sizeof(CABECALHO) + (long)posicao * (long)arquivo->tamanho_registro;
+}
+
+/*
+ * abrir_arquivo_carga - função interna que abre um arquivo de lista para a carga em lote
+ *
+ * @arquivo - estrutura a ser preenchida
+ * @caminho - caminho do arquivo binário
+ * @tamanho_registro - tamanho de cada registro
+ * @deslocamento_proximo - deslocamento do campo de encadeamento dentro do registro
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0), ERRO_ABRIR_ARQUIVO (-10), ERRO_LER_CABECALHO (-11) ou ERRO_ALOCAR_MEMORIA (-30).
+ *      - Em caso de erro, nada fica aberto ou alocado.
+ */
+static int abrir_arquivo_carga(ARQUIVO_CARGA* arquivo, const char* caminho, size_t tamanho_registro, size_t deslocamento_proximo) {
+        memset(arquivo, 0, sizeof(ARQUIVO_CARGA));
+        arquivo->tamanho_registro = tamanho_registro;
+        arquivo->deslocamento_proximo = deslocamento_proximo;
+
+        // a carga lê e grava por stdio: alterações ainda no cache de páginas precisam estar no arquivo
+        if(descarregar_caminho_dados(caminho) != SUCESSO)
+                return ERRO_ABRIR_ARQUIVO;
+
+        arquivo->arquivo = fopen(caminho, "r+b");
+        if(!arquivo->arquivo)
+                return ERRO_ABRIR_ARQUIVO;
+
+        if(fread(&arquivo->cabecalho, sizeof(CABECALHO), 1, arquivo->arquivo) != 1) {
+                fclose(arquivo->arquivo);
+                arquivo->arquivo = NULL;
+                return ERRO_LER_CABECALHO;
+        }
+
+        arquivo->bloco = malloc(REGISTROS_POR_BLOCO_CARGA * tamanho_registro);
+        if(arquivo->bloco == NULL) {
+                fclose(arquivo->arquivo);
+                arquivo->arquivo = NULL;
+                return ERRO_ALOCAR_MEMORIA;
+        }
+
+        arquivo->inicio_bloco = arquivo->cabecalho.pos_topo;
+        arquivo->registros_no_bloco = 0;
+
+        return SUCESSO;
+}
+
+/*
+ * descarregar_bloco - função interna que grava os registros acumulados com uma única escrita sequencial
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_WRITE (-2).
+ */
+static int descarregar_bloco(ARQUIVO_CARGA* arquivo) {
+        if(arquivo->registros_no_bloco == 0)
+                return SUCESSO;
+
+        if(fseek(arquivo->arquivo, deslocamento_registro(arquivo, arquivo->inicio_bloco), SEEK_SET) != 0)
+                return ERRO_ARQUIVO_SEEK;
+        if(fwrite(arquivo->bloco, arquivo->tamanho_registro, arquivo->registros_no_bloco, arquivo->arquivo) != (size_t)arquivo->registros_no_bloco)
+                return ERRO_ARQUIVO_WRITE;
+
+        arquivo->inicio_bloco += arquivo->registros_no_bloco;
+        arquivo->registros_no_bloco = 0;
+
+        return SUCESSO;
+}
+
+/*
+ * fechar_arquivo_carga - função interna que grava o bloco pendente e o cabeçalho e fecha o arquivo
+ *
+ * Pós-condições:
+ *      - O arquivo é fechado e o bloco liberado mesmo em caso de erro.
+ *      - Retorna SUCESSO (0) ou o primeiro erro de gravação.
+ */
+static int fechar_arquivo_carga(ARQUIVO_CARGA* arquivo) {
+        if(arquivo->arquivo == NULL)
+                return SUCESSO;
+
+        int retorno = descarregar_bloco(arquivo);
+        if(retorno == SUCESSO && escreve_cabecalho(arquivo->arquivo, &arquivo->cabecalho) != 0)
+                retorno = ERRO_ESCREVER_CABECALHO;
+
+        fclose(arquivo->arquivo);
+        free(arquivo->bloco);
+        arquivo->arquivo = NULL;
+        arquivo->bloco = NULL;
+
+        return retorno;
+}
+
+/*
+ * esta_no_bloco - função interna que indica se a posição ainda está no bloco não gravado
+ */
+static int esta_no_bloco(const ARQUIVO_CARGA* arquivo, int posicao) {
+        return posicao >= arquivo->inicio_bloco && posicao < arquivo->inicio_bloco + arquivo->registros_no_bloco;
+}
+
+/*
+ * ler_registro_carga - função interna que lê um registro, seja do bloco pendente ou do disco
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_READ (-3).
+ */
+static int ler_registro_carga(ARQUIVO_CARGA* arquivo, int posicao, void* registro) {
+        if(esta_no_bloco(arquivo, posicao)) {
+                memcpy(registro, arquivo->bloco + (size_t)(posicao - arquivo->inicio_bloco) * arquivo->tamanho_registro, arquivo->tamanho_registro);
+                return SUCESSO;
+        }
+
+        if(fseek(arquivo->arquivo, deslocamento_registro(arquivo, posicao), SEEK_SET) != 0)
+                return ERRO_ARQUIVO_SEEK;
+        if(fread(registro, arquivo->tamanho_registro, 1, arquivo->arquivo) != 1)
+                return ERRO_ARQUIVO_READ;
+
+        return SUCESSO;
+}
+
+/*
+ * escrever_registro_carga - função interna que grava um registro, seja no bloco pendente ou no disco
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_WRITE (-2).
+ */
+static int escrever_registro_carga(ARQUIVO_CARGA* arquivo, int posicao, const void* registro) {
+        if(esta_no_bloco(arquivo, posicao)) {
+                memcpy(arquivo->bloco + (size_t)(posicao - arquivo->inicio_bloco) * arquivo->tamanho_registro, registro, arquivo->tamanho_registro);
+                return SUCESSO;
+        }
+
+        if(fseek(arquivo->arquivo, deslocamento_registro(arquivo, posicao), SEEK_SET) != 0)
+                return ERRO_ARQUIVO_SEEK;
+        if(fwrite(registro, arquivo->tamanho_registro, 1, arquivo->arquivo) != 1)
+                return ERRO_ARQUIVO_WRITE;
+
+        return SUCESSO;
+}
+
+/*
+ * anexar_registro_carga - função interna que insere um registro no início da lista
+ *
+ * @arquivo - arquivo da carga
+ * @registro - registro a ser inserido (seu campo de encadeamento é preenchido aqui)
+ * @posicao - ponteiro onde a posição ocupada pelo registro será armazenada
+ *
+ * Segue as mesmas regras dos cadastros: reaproveita a primeira posição livre, se houver;
+ * caso contrário o registro vai para o final do arquivo (via bloco).
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou um código de erro de E/S.
+ */
+static int anexar_registro_carga(ARQUIVO_CARGA* arquivo, void* registro, int* posicao) {
+        int retorno;
+        memcpy((unsigned char*)registro + arquivo->deslocamento_proximo, &arquivo->cabecalho.pos_cabeca, sizeof(int));
+
+        if(arquivo->cabecalho.pos_livre != -1) {
+                // posições livres são anteriores à carga e, portanto, já estão no disco
+                int pos = arquivo->cabecalho.pos_livre;
+                int proximo_livre;
+                if(fseek(arquivo->arquivo, deslocamento_registro(arquivo, pos) + (long)arquivo->deslocamento_proximo, SEEK_SET) != 0)
+                        return ERRO_ARQUIVO_SEEK;
+                if(fread(&proximo_livre, sizeof(int), 1, arquivo->arquivo) != 1)
+                        return ERRO_ARQUIVO_READ;
+                if((retorno = escrever_registro_carga(arquivo, pos, registro)) != SUCESSO)
+                        return retorno;
+
+                arquivo->cabecalho.pos_livre = proximo_livre;
+                arquivo->cabecalho.num_livres--;
+                *posicao = pos;
+        }
+        else {
+                if(arquivo->registros_no_bloco == REGISTROS_POR_BLOCO_CARGA && (retorno = descarregar_bloco(arquivo)) != SUCESSO)
+                        return retorno;
+
+                memcpy(arquivo->bloco + (size_t)arquivo->registros_no_bloco * arquivo->tamanho_registro, registro, arquivo->tamanho_registro);
+                arquivo->registros_no_bloco++;
+                *posicao = arquivo->cabecalho.pos_topo++;
+        }
+
+        arquivo->cabecalho.pos_cabeca = *posicao;
+        arquivo->cabecalho.num_ativos++;
+
+        return SUCESSO;
+}
+
+/*
+ * registrar_livro - função interna que adiciona um livro às tabelas em memória
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou ERRO_ALOCAR_MEMORIA (-30).
+ */
+static int registrar_livro(CARGA_LOTE* carga, unsigned int codigo, int posicao, int exemplares, int primeiro_emprestimo) {
+        if(carga->num_livros == carga->capacidade_livros) {
+                int nova_capacidade = carga->capacidade_livros ? carga->capacidade_livros * 2 : CAPACIDADE_TABELA_HASH_INICIAL;
+                int* posicoes = realloc(carga->posicoes_livros, nova_capacidade * sizeof(int));
+                if(posicoes != NULL)
+                        carga->posicoes_livros = posicoes;
+                int* quantidades = realloc(carga->exemplares_livros, nova_capacidade * sizeof(int));
+                if(quantidades != NULL)
+                        carga->exemplares_livros = quantidades;
+                int* emprestimos = realloc(carga->emprestimos_livros, nova_capacidade * sizeof(int));
+                if(emprestimos != NULL)
+                        carga->emprestimos_livros = emprestimos;
+                unsigned char* alterados = realloc(carga->livros_alterados, nova_capacidade * sizeof(unsigned char));
+                if(alterados != NULL)
+                        carga->livros_alterados = alterados;
+                if(posicoes == NULL || quantidades == NULL || emprestimos == NULL || alterados == NULL)
+                        return ERRO_ALOCAR_MEMORIA;
+                carga->capacidade_livros = nova_capacidade;
+        }
+
+        int indice = carga->num_livros;
+        if(tabela_hash_inserir(carga->indice_livros, codigo, indice) != SUCESSO)
+                return ERRO_ALOCAR_MEMORIA;
+
+        carga->posicoes_livros[indice] = posicao;
+        carga->exemplares_livros[indice] = exemplares;
+        carga->emprestimos_livros[indice] = primeiro_emprestimo;
+        carga->livros_alterados[indice] = 0;
+        carga->num_livros++;
+
+        return SUCESSO;
+}
+
+static int carregar_livro_existente(const void* registro, int posicao, void* contexto) {
+        const REGISTRO_LIVRO* livro = registro;
+        return registrar_livro(contexto, (unsigned int)livro->codigo, posicao, livro->exemplares, livro->primeiro_emprestimo);
+}
+
+static int carregar_usuario_existente(const void* registro, int posicao, void* contexto) {
+        const USUARIO* usuario = registro;
+        CARGA_LOTE* carga = contexto;
+        return tabela_hash_inserir(carga->indice_usuarios, usuario->codigo, posicao);
+}
+
+static int carregar_emprestimo_existente(const void* registro, int posicao, void* contexto) {
+        const EMPRESTIMO* emprestimo = registro;
+        CARGA_LOTE* carga = contexto;
+        if(emprestimo->data_devolucao != DATA_NULA)
+                return SUCESSO;
+        return tabela_hash_inserir(carga->emprestimos_abertos, chave_emprestimo(emprestimo->codigo_usuario, emprestimo->codigo_livro), posicao);
+}
+
+/*
+ * liberar_tabelas_carga - função interna que libera as tabelas em memória da carga
+ */
+static void liberar_tabelas_carga(CARGA_LOTE* carga) {
+        tabela_hash_destruir(carga->indice_livros);
+        tabela_hash_destruir(carga->indice_usuarios);
+        tabela_hash_destruir(carga->emprestimos_abertos);
+        tabela_hash_destruir(carga->emprestimos_usuarios);
+        free(carga->posicoes_livros);
+        free(carga->exemplares_livros);
+        free(carga->emprestimos_livros);
+        free(carga->livros_alterados);
+        carga->indice_livros = carga->indice_usuarios = carga->emprestimos_abertos = carga->emprestimos_usuarios = NULL;
+        carga->posicoes_livros = carga->exemplares_livros = carga->emprestimos_livros = NULL;
+        carga->livros_alterados = NULL;
+}
+
+int carga_iniciar(
+        CARGA_LOTE* carga,
+        const char* caminho_arquivo_emprestimo,
+        const char* caminho_arquivo_livro,
+        const char* caminho_arquivo_usuario
+) {
+        int retorno;
+        memset(carga, 0, sizeof(CARGA_LOTE));
+
+        strncpy(carga->caminho_livro, caminho_arquivo_livro, TAM_MAX_CAMINHO - 1);
+        strncpy(carga->caminho_usuario, caminho_arquivo_usuario, TAM_MAX_CAMINHO - 1);
+        strncpy(carga->caminho_emprestimo, caminho_arquivo_emprestimo, TAM_MAX_CAMINHO - 1);
+
+        if((retorno = abrir_arquivo_carga(&carga->livros, caminho_arquivo_livro, sizeof(REGISTRO_LIVRO), offsetof(REGISTRO_LIVRO, prox))) != SUCESSO)
+                return retorno;
+
+        // textos novos só são acrescentados ao final: modo "a", sem reposicionar a cada livro
+        if((retorno = textos_abrir(&carga->textos_livros, caminho_arquivo_livro, COLUNAS_TEXTO_LIVRO, "ab")) != SUCESSO)
+                goto fechar_livros;
+
+        if((retorno = abrir_arquivo_carga(&carga->usuarios, caminho_arquivo_usuario, sizeof(USUARIO), offsetof(USUARIO, proximo))) != SUCESSO)
+                goto fechar_textos;
+        if((retorno = abrir_arquivo_carga(&carga->emprestimos, caminho_arquivo_emprestimo, sizeof(EMPRESTIMO), offsetof(EMPRESTIMO, proximo))) != SUCESSO)
+                goto fechar_usuarios;
+
+        // tabelas dimensionadas pelos contadores dos cabeçalhos (elas crescem se a carga passar disso)
+        carga->indice_livros = tabela_hash_criar(carga->livros.cabecalho.num_ativos);
+        carga->indice_usuarios = tabela_hash_criar(carga->usuarios.cabecalho.num_ativos);
+        carga->emprestimos_abertos = tabela_hash_criar(carga->emprestimos.cabecalho.emprestimos_abertos);
+        carga->emprestimos_usuarios = tabela_hash_criar(CAPACIDADE_TABELA_HASH_INICIAL);
+        if(
+                carga->indice_livros == NULL || carga->indice_usuarios == NULL ||
+                carga->emprestimos_abertos == NULL || carga->emprestimos_usuarios == NULL
+        ) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_tabelas;
+        }
+
+        // uma leitura sequencial de cada arquivo para conhecer os registros já existentes
+        if(
+                (retorno = varrer_registros_ativos(carga->livros.arquivo, sizeof(REGISTRO_LIVRO), offsetof(REGISTRO_LIVRO, prox), carregar_livro_existente, carga)) != SUCESSO ||
+                (retorno = varrer_registros_ativos(carga->usuarios.arquivo, sizeof(USUARIO), offsetof(USUARIO, proximo), carregar_usuario_existente, carga)) != SUCESSO ||
+                (retorno = varrer_registros_ativos(carga->emprestimos.arquivo, sizeof(EMPRESTIMO), offsetof(EMPRESTIMO, proximo), carregar_emprestimo_existente, carga)) != SUCESSO
+        ) {
+                goto liberar_tabelas;
+        }
+
+        return SUCESSO;
+
+liberar_tabelas:
+        liberar_tabelas_carga(carga);
+        // nada foi alterado: descartar sem gravar cabeçalhos
+        fclose(carga->emprestimos.arquivo);
+        free(carga->emprestimos.bloco);
+fechar_usuarios:
+        fclose(carga->usuarios.arquivo);
+        free(carga->usuarios.bloco);
+fechar_textos:
+        textos_fechar(&carga->textos_livros);
+fechar_livros:
+        fclose(carga->livros.arquivo);
+        free(carga->livros.bloco);
+
+        return retorno;
+}
+
+int carga_cadastrar_livro(CARGA_LOTE* carga, LIVRO livro) {
+        if(tabela_hash_buscar(carga->indice_livros, (unsigned int)livro.codigo, NULL) == SUCESSO)
+                return ERRO_CONFLITO_ID;
+
+        REGISTRO_LIVRO registro;
+        int posicao;
+        preparar_registro_livro(&livro, &registro);
+        int retorno = anexar_registro_carga(&carga->livros, &registro, &posicao);
+        if(retorno == SUCESSO)
+                retorno = gravar_textos_livro(&carga->textos_livros, posicao, &livro);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        carga->livros.cabecalho.exemplares_disponiveis += livro.exemplares;
+        return registrar_livro(carga, (unsigned int)livro.codigo, posicao, livro.exemplares, registro.primeiro_emprestimo);
+}
+
+int carga_cadastrar_usuario(CARGA_LOTE* carga, USUARIO usuario) {
+        if(tabela_hash_buscar(carga->indice_usuarios, usuario.codigo, NULL) == SUCESSO)
+                return ERRO_CONFLITO_ID;
+
+        int posicao;
+        usuario.primeiro_emprestimo = -1;
+        int retorno = anexar_registro_carga(&carga->usuarios, &usuario, &posicao);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        return tabela_hash_inserir(carga->indice_usuarios, usuario.codigo, posicao);
+}
+
+int carga_emprestar_livro(CARGA_LOTE* carga, unsigned int codigo_usuario, unsigned int codigo_livro, int data_emprestimo) {
+        unsigned long long chave = chave_emprestimo(codigo_usuario, codigo_livro);
+        if(tabela_hash_buscar(carga->emprestimos_abertos, chave, NULL) == SUCESSO)
+                return ERRO_CONFLITO_ID;
+        int posicao_usuario;
+        if(tabela_hash_buscar(carga->indice_usuarios, codigo_usuario, &posicao_usuario) != SUCESSO)
+                return ERRO_ENCONTRAR_USUARIO;
+
+        int indice_livro;
+        if(tabela_hash_buscar(carga->indice_livros, codigo_livro, &indice_livro) != SUCESSO)
+                return ERRO_ENCONTRAR_LIVRO;
+        if(carga->exemplares_livros[indice_livro] < 1)
+                return ERRO_LIVROS_ESGOTADOS;
+
+        // início da lista de empréstimos do usuário: da tabela, se já mudou nesta carga, ou do registro
+        int retorno;
+        int primeiro_emprestimo;
+        if(tabela_hash_buscar(carga->emprestimos_usuarios, codigo_usuario, &primeiro_emprestimo) != SUCESSO) {
+                USUARIO usuario;
+                if((retorno = ler_registro_carga(&carga->usuarios, posicao_usuario, &usuario)) != SUCESSO)
+                        return retorno;
+                primeiro_emprestimo = usuario.primeiro_emprestimo;
+        }
+
+        EMPRESTIMO emprestimo;
+        memset(&emprestimo, 0, sizeof(EMPRESTIMO));
+        emprestimo.codigo_usuario = codigo_usuario;
+        emprestimo.codigo_livro = codigo_livro;
+        emprestimo.data_emprestimo = data_emprestimo;
+        emprestimo.data_devolucao = DATA_NULA;
+        emprestimo.proximo_usuario = primeiro_emprestimo;
+        emprestimo.proximo_livro = carga->emprestimos_livros[indice_livro];
+
+        int posicao;
+        if(anexar_registro_carga(&carga->emprestimos, &emprestimo, &posicao) != SUCESSO)
+                return ERRO_ESCREVER_EMPRESTIMO;
+        if((retorno = tabela_hash_inserir(carga->emprestimos_usuarios, codigo_usuario, posicao)) != SUCESSO)
+                return retorno;
+
+        carga->exemplares_livros[indice_livro]--;
+        carga->emprestimos_livros[indice_livro] = posicao;
+        carga->livros_alterados[indice_livro] = 1;
+        carga->livros.cabecalho.exemplares_disponiveis--;
+        carga->emprestimos.cabecalho.emprestimos_abertos++;
+
+        return tabela_hash_inserir(carga->emprestimos_abertos, chave, posicao);
+}
+
+int carga_devolver_livro(CARGA_LOTE* carga, unsigned int codigo_usuario, unsigned int codigo_livro, int data_devolucao) {
+        unsigned long long chave = chave_emprestimo(codigo_usuario, codigo_livro);
+
+        int posicao;
+        if(tabela_hash_buscar(carga->emprestimos_abertos, chave, &posicao) != SUCESSO)
+                return ERRO_ENCONTRAR_EMPRESTIMO;
+
+        int indice_livro;
+        if(tabela_hash_buscar(carga->indice_livros, codigo_livro, &indice_livro) != SUCESSO)
+                return ERRO_ENCONTRAR_LIVRO;
+
+        EMPRESTIMO emprestimo;
+        int retorno = ler_registro_carga(&carga->emprestimos, posicao, &emprestimo);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        emprestimo.data_devolucao = data_devolucao;
+
+        if((retorno = escrever_registro_carga(&carga->emprestimos, posicao, &emprestimo)) != SUCESSO)
+                return retorno;
+
+        carga->exemplares_livros[indice_livro]++;
+        carga->livros_alterados[indice_livro] = 1;
+        carga->livros.cabecalho.exemplares_disponiveis++;
+        carga->emprestimos.cabecalho.emprestimos_abertos--;
+        carga->devolucoes++;
+        tabela_hash_remover(carga->emprestimos_abertos, chave);
+
+        return SUCESSO;
+}
+
+/*
+ * encadear_emprestimo_carga - função interna que regrava o campo de encadeamento de um empréstimo
+ */
+static int encadear_emprestimo_carga(ARQUIVO_CARGA* arquivo, int posicao, int proximo) {
+        EMPRESTIMO emprestimo;
+        int retorno = ler_registro_carga(arquivo, posicao, &emprestimo);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        emprestimo.proximo = proximo;
+        return escrever_registro_carga(arquivo, posicao, &emprestimo);
+}
+
+/*
+ * separar_devolvidos - função interna que move os empréstimos devolvidos durante a carga da
+ * lista de abertos para o início da lista de devolvidos
+ *
+ * A lista de abertos é percorrida uma única vez; os dois trechos mantêm a ordem original e só
+ * são regravados os registros cujo encadeamento muda.
+ *
+ * Pós-condições:
+ *      - pos_cabeca e pos_devolvidos do cabeçalho em memória são atualizados.
+ *      - Retorna SUCESSO (0) ou um código de erro de E/S.
+ */
+static int separar_devolvidos(CARGA_LOTE* carga) {
+        ARQUIVO_CARGA* arquivo = &carga->emprestimos;
+        CABECALHO* cabecalho = &arquivo->cabecalho;
+        int retorno;
+
+        // último registro de cada trecho e o encadeamento que ele tem gravado
+        int ultimo_aberto = -1, proximo_aberto = -1;
+        int primeiro_devolvido = -1, ultimo_devolvido = -1, proximo_devolvido = -1;
+
+        int pos = cabecalho->pos_cabeca;
+        for(int passos = 0; pos != -1 && passos < cabecalho->pos_topo; passos++) {
+                EMPRESTIMO emprestimo;
+                if((retorno = ler_registro_carga(arquivo, pos, &emprestimo)) != SUCESSO)
+                        return retorno;
+
+                if(emprestimo.data_devolucao == DATA_NULA) {
+                        if(ultimo_aberto == -1)
+                                cabecalho->pos_cabeca = pos;
+                        else if(proximo_aberto != pos && (retorno = encadear_emprestimo_carga(arquivo, ultimo_aberto, pos)) != SUCESSO)
+                                return retorno;
+                        ultimo_aberto = pos;
+                        proximo_aberto = emprestimo.proximo;
+                }
+                else {
+                        if(ultimo_devolvido == -1)
+                                primeiro_devolvido = pos;
+                        else if(proximo_devolvido != pos && (retorno = encadear_emprestimo_carga(arquivo, ultimo_devolvido, pos)) != SUCESSO)
+                                return retorno;
+                        ultimo_devolvido = pos;
+                        proximo_devolvido = emprestimo.proximo;
+                }
+
+                pos = emprestimo.proximo;
+        }
+
+        // encerrar a lista de abertos e ligar os devolvidos da carga ao histórico anterior
+        if(ultimo_aberto == -1)
+                cabecalho->pos_cabeca = -1;
+        else if(proximo_aberto != -1 && (retorno = encadear_emprestimo_carga(arquivo, ultimo_aberto, -1)) != SUCESSO)
+                return retorno;
+
+        if(ultimo_devolvido != -1) {
+                if(proximo_devolvido != cabecalho->pos_devolvidos &&
+                   (retorno = encadear_emprestimo_carga(arquivo, ultimo_devolvido, cabecalho->pos_devolvidos)) != SUCESSO)
+                        return retorno;
+                cabecalho->pos_devolvidos = primeiro_devolvido;
+        }
+
+        return SUCESSO;
+}
+
+/*
+ * gravar_livros_alterados - função interna que regrava apenas os campos de exemplares e de início da
+ * lista de empréstimos dos livros alterados
+ *
+ * Pré-condições:
+ *      - O bloco de livros já deve ter sido descarregado.
+ * Pós-condições:
+ *      - Retorna SUCESSO (0), ERRO_ARQUIVO_SEEK (-1) ou ERRO_ARQUIVO_WRITE (-2).
+ */
+static int gravar_livros_alterados(CARGA_LOTE* carga) {
+        for(int i = 0; i < carga->num_livros; i++) {
+                if(!carga->livros_alterados[i])
+                        continue;
+
+                long deslocamento = deslocamento_registro(&carga->livros, carga->posicoes_livros[i]);
+                if(fseek(carga->livros.arquivo, deslocamento + (long)offsetof(REGISTRO_LIVRO, exemplares), SEEK_SET) != 0)
+                        return ERRO_ARQUIVO_SEEK;
+                if(fwrite(&carga->exemplares_livros[i], sizeof(int), 1, carga->livros.arquivo) != 1)
+                        return ERRO_ARQUIVO_WRITE;
+                if(fseek(carga->livros.arquivo, deslocamento + (long)offsetof(REGISTRO_LIVRO, primeiro_emprestimo), SEEK_SET) != 0)
+                        return ERRO_ARQUIVO_SEEK;
+                if(fwrite(&carga->emprestimos_livros[i], sizeof(int), 1, carga->livros.arquivo) != 1)
+                        return ERRO_ARQUIVO_WRITE;
+        }
+
+        return SUCESSO;
+}
+
+/*
+ * gravar_emprestimos_usuarios - função interna que regrava primeiro_emprestimo dos usuários que emprestaram na carga
+ *
+ * Pré-condições:
+ *      - O arquivo de usuários ainda deve estar aberto (o bloco pendente pode conter usuários da carga).
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou um código de erro de E/S.
+ */
+static int gravar_emprestimos_usuarios(CARGA_LOTE* carga) {
+        const TABELA_HASH* tabela = carga->emprestimos_usuarios;
+        for(int i = 0; i < tabela->capacidade; i++) {
+                if(!tabela->ocupados[i])
+                        continue;
+
+                int posicao;
+                USUARIO usuario;
+                if(tabela_hash_buscar(carga->indice_usuarios, tabela->chaves[i], &posicao) != SUCESSO)
+                        continue;
+
+                int retorno = ler_registro_carga(&carga->usuarios, posicao, &usuario);
+                if(retorno != SUCESSO)
+                        return retorno;
+                usuario.primeiro_emprestimo = tabela->valores[i];
+                if((retorno = escrever_registro_carga(&carga->usuarios, posicao, &usuario)) != SUCESSO)
+                        return retorno;
+        }
+
+        return SUCESSO;
+}
+
+/*
+ * extrair_pares - função interna que copia as chaves e valores de uma tabela hash para vetores
+ *
+ * @tabela - tabela de origem
+ * @chaves - vetor com capacidade para tabela->quantidade chaves
+ * @valores - vetor com capacidade para tabela->quantidade valores
+ */
+static void extrair_pares(const TABELA_HASH* tabela, unsigned long long* chaves, int* valores) {
+        int quantidade = 0;
+        for(int i = 0; i < tabela->capacidade; i++) {
+                if(!tabela->ocupados[i])
+                        continue;
+                chaves[quantidade] = tabela->chaves[i];
+                valores[quantidade] = tabela->valores[i];
+                quantidade++;
+        }
+}
+
+/*
+ * apagar_indices - função interna que remove os índices, forçando a reconstrução a partir das listas
+ */
+static void apagar_indices(CARGA_LOTE* carga) {
+        char caminho_indice[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_indice, carga->caminho_livro, ".idx");
+        remove(caminho_indice);
+        trocar_extensao(caminho_indice, carga->caminho_livro, EXTENSAO_INDICE_TITULO);
+        remove(caminho_indice);
+        trocar_extensao(caminho_indice, carga->caminho_livro, EXTENSAO_INDICE_AUTOR);
+        indice_invertido_apagar(caminho_indice);
+        trocar_extensao(caminho_indice, carga->caminho_livro, EXTENSAO_INDICE_TRIGRAMA);
+        indice_invertido_apagar(caminho_indice);
+        trocar_extensao(caminho_indice, carga->caminho_usuario, ".idx");
+        remove(caminho_indice);
+        trocar_extensao(caminho_indice, carga->caminho_emprestimo, ".idx");
+        remove(caminho_indice);
+        trocar_extensao(caminho_indice, carga->caminho_emprestimo, EXTENSAO_INDICE_DATAS);
+        remove(caminho_indice);
+}
+
+/*
+ * construir_indices - função interna que monta os índices a partir das tabelas em memória (e os de títulos, autores,
+ * trigramas e datas de empréstimo, a partir da lista)
+ *
+ * Índices que não puderem ser gravados são apagados, para que sejam reconstruídos a partir
+ * das listas no próximo acesso em vez de ficarem desatualizados.
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou o primeiro erro encontrado.
+ */
+static int construir_indices(CARGA_LOTE* carga) {
+        int retorno = SUCESSO;
+        int maior = carga->num_livros;
+        if(carga->indice_usuarios->quantidade > maior)
+                maior = carga->indice_usuarios->quantidade;
+        if(carga->emprestimos_abertos->quantidade > maior)
+                maior = carga->emprestimos_abertos->quantidade;
+        if(maior < 1)
+                maior = 1;
+
+        char caminho_livros[TAM_MAX_CAMINHO], caminho_usuarios[TAM_MAX_CAMINHO], caminho_emprestimos[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_livros, carga->caminho_livro, ".idx");
+        trocar_extensao(caminho_usuarios, carga->caminho_usuario, ".idx");
+        trocar_extensao(caminho_emprestimos, carga->caminho_emprestimo, ".idx");
+
+        unsigned long long* chaves = malloc(maior * sizeof(unsigned long long));
+        int* valores = malloc(maior * sizeof(int));
+        unsigned int* codigos = malloc(maior * sizeof(unsigned int));
+        if(chaves == NULL || valores == NULL || codigos == NULL) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                apagar_indices(carga);
+                goto liberar_vetores;
+        }
+
+        // livros: a tabela guarda o índice nos vetores, trocado aqui pela posição no arquivo
+        extrair_pares(carga->indice_livros, chaves, valores);
+        for(int i = 0; i < carga->num_livros; i++)
+                valores[i] = carga->posicoes_livros[valores[i]];
+        int r = indice_hash_construir(caminho_livros, chaves, valores, carga->num_livros);
+        if(r != SUCESSO) {
+                remove(caminho_livros);
+                retorno = r;
+        }
+
+        extrair_pares(carga->indice_usuarios, chaves, valores);
+        for(int i = 0; i < carga->indice_usuarios->quantidade; i++)
+                codigos[i] = (unsigned int)chaves[i];
+        r = construir_indice_usuario(carga->caminho_usuario, codigos, valores, carga->indice_usuarios->quantidade);
+        if(r != SUCESSO) {
+                remove(caminho_usuarios);
+                if(retorno == SUCESSO)
+                        retorno = r;
+        }
+
+        extrair_pares(carga->emprestimos_abertos, chaves, valores);
+        r = indice_hash_construir(caminho_emprestimos, chaves, valores, carga->emprestimos_abertos->quantidade);
+        if(r != SUCESSO) {
+                remove(caminho_emprestimos);
+                if(retorno == SUCESSO)
+                        retorno = r;
+        }
+
+        // títulos, autores e trigramas não passam pelas tabelas da carga: os índices são montados a partir da lista, já gravada
+        r = reconstruir_indice_titulo(carga->caminho_livro);
+        if(r != SUCESSO) {
+                trocar_extensao(caminho_livros, carga->caminho_livro, EXTENSAO_INDICE_TITULO);
+                remove(caminho_livros);
+                if(retorno == SUCESSO)
+                        retorno = r;
+        }
+
+        r = reconstruir_indice_autor(carga->caminho_livro);
+        if(r != SUCESSO) {
+                trocar_extensao(caminho_livros, carga->caminho_livro, EXTENSAO_INDICE_AUTOR);
+                indice_invertido_apagar(caminho_livros);
+                if(retorno == SUCESSO)
+                        retorno = r;
+        }
+
+        r = reconstruir_indice_trigramas(carga->caminho_livro);
+        if(r != SUCESSO) {
+                trocar_extensao(caminho_livros, carga->caminho_livro, EXTENSAO_INDICE_TRIGRAMA);
+                indice_invertido_apagar(caminho_livros);
+                if(retorno == SUCESSO)
+                        retorno = r;
+        }
+
+        r = reconstruir_indice_datas_emprestimo(carga->caminho_emprestimo);
+        if(r != SUCESSO) {
+                trocar_extensao(caminho_emprestimos, carga->caminho_emprestimo, EXTENSAO_INDICE_DATAS);
+                remove(caminho_emprestimos);
+                if(retorno == SUCESSO)
+                        retorno = r;
+        }
+
+liberar_vetores:
+        free(chaves);
+        free(valores);
+        free(codigos);
+
+        return retorno;
+}
+
+int carga_finalizar(CARGA_LOTE* carga) {
+        // textos chegam ao disco antes dos registros que os referenciam
+        int retorno = textos_fechar(&carga->textos_livros);
+        if(retorno == SUCESSO)
+                retorno = descarregar_bloco(&carga->livros);
+        if(retorno == SUCESSO)
+                retorno = gravar_livros_alterados(carga);
+
+        // cada cabeçalho é gravado uma única vez, ao final
+        int r = fechar_arquivo_carga(&carga->livros);
+        if(retorno == SUCESSO)
+                retorno = r;
+        if(retorno == SUCESSO)
+                retorno = gravar_emprestimos_usuarios(carga);
+        r = fechar_arquivo_carga(&carga->usuarios);
+        if(retorno == SUCESSO)
+                retorno = r;
+        if(retorno == SUCESSO && carga->devolucoes > 0)
+                retorno = separar_devolvidos(carga);
+        r = fechar_arquivo_carga(&carga->emprestimos);
+        if(retorno == SUCESSO)
+                retorno = r;
+
+        // páginas desses arquivos guardadas no cache ficaram desatualizadas
+        descartar_caminho_dados(carga->caminho_livro);
+        descartar_caminho_dados(carga->caminho_usuario);
+        descartar_caminho_dados(carga->caminho_emprestimo);
+
+        // índices adiados: montados de uma só vez com o conteúdo final das tabelas; se a gravação
+        // dos dados falhou, as tabelas não refletem os arquivos e os índices são apenas descartados
+        if(retorno == SUCESSO)
+                retorno = construir_indices(carga);
+        else
+                apagar_indices(carga);
+
+        liberar_tabelas_carga(carga);
+
+        return retorno;
+}
@@ -0,0 +1,1174 @@
+#include "../include/diario.h"
+#include "../include/armazenamento.h"
+#include "../include/erros.h"
+#include "../include/trava.h"
+#include "../include/utils.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define fsync _commit
+#define ftruncate _chsize
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*
+ * CONTROLE_ARQUIVO_DIARIO - estado de um arquivo acompanhado, compartilhado pelos processos da base
+ *
+ * @geracao - incrementada a cada operação aplicada ao arquivo; um processo que a encontra diferente
+ * da última que viu descarta o que guarda do arquivo (páginas, cabeçalho residente)
+ * @tamanho_aplicacao - bytes reservados no diário para o registro em aplicação
+ * @aplicacao - posição no diário do registro em aplicação ao arquivo (0 se nenhum); a marca é gravada
+ * antes do registro e só é retirada por diario_concluir_aplicacao
+ */
+typedef struct {
+        unsigned int geracao;
+        unsigned int tamanho_aplicacao;
+        long long aplicacao;
+} CONTROLE_ARQUIVO_DIARIO;
+
+/*
+ * CABECALHO_DIARIO - início do arquivo do diário: os arquivos acompanhados, na ordem dos identificadores
+ *
+ * Os nomes são relativos ao diretório da base, de modo que a recuperação não depende do caminho
+ * usado na abertura.
+ */
+typedef struct {
+        unsigned int assinatura;
+        int quantidade_arquivos;
+        char nomes[MAX_ARQUIVOS_DIARIO][TAM_NOME_ARQUIVO_DIARIO];
+        CONTROLE_ARQUIVO_DIARIO controles[MAX_ARQUIVOS_DIARIO];
+} CABECALHO_DIARIO;
+
+// diários ASSINATURA_DIARIO_V1 não têm os controles: os registros começam logo depois dos nomes
+#define TAM_CABECALHO_DIARIO_V1 offsetof(CABECALHO_DIARIO, controles)
+
+// bytes do diário usados só como travas, muito além do fim do arquivo
+#define TRAVA_ABERTURA  0x7FFFFF00L             // abertura (com a recuperação) e fechamento da base
+#define TRAVA_USO       (TRAVA_ABERTURA + 1)    // compartilhada por processo com a base aberta; exclusiva no modo exclusivo
+#define TRAVA_ANEXACAO  (TRAVA_ABERTURA + 2)    // acréscimo de registros e esvaziamento do diário
+
+/*
+ * REGISTRO_DIARIO - cabeçalho do registro de uma operação confirmada
+ *
+ * @assinatura - ASSINATURA_DIARIO
+ * @quantidade - quantidade de gravações da operação
+ * @tamanho - bytes que seguem este cabeçalho (GRAVACAO_DIARIO + dados de cada gravação)
+ * @soma - soma de verificação (FNV-1a) desses bytes
+ */
+typedef struct {
+        unsigned int assinatura;
+        unsigned int quantidade;
+        unsigned int tamanho;
+        unsigned int soma;
+} REGISTRO_DIARIO;
+
+/*
+ * GRAVACAO_DIARIO - uma gravação dentro do registro, seguida de tamanho bytes com a imagem gravada
+ */
+typedef struct {
+        int arquivo;
+        int tamanho;
+        long long deslocamento;
+} GRAVACAO_DIARIO;
+
+/*
+ * GRAVACAO_PENDENTE - gravação em memória, ainda não aplicada ao arquivo
+ *
+ * @inicio - posição dos bytes gravados em dados
+ */
+typedef struct {
+        int arquivo;
+        size_t tamanho;
+        long deslocamento;
+        size_t inicio;
+} GRAVACAO_PENDENTE;
+
+static FILE* arquivo_diario = NULL;
+static char caminho_diario[TAM_MAX_CAMINHO];
+static char caminhos[MAX_ARQUIVOS_DIARIO][TAM_MAX_CAMINHO];
+static char nomes_arquivos[MAX_ARQUIVOS_DIARIO][TAM_NOME_ARQUIVO_DIARIO];
+static int num_arquivos = 0;            // 0 até diario_preparar
+static int arquivos_declarados = 0;
+static long tamanho_diario = 0;
+
+// modo da abertura e estado compartilhado com os outros processos (DIARIO_COMPARTILHADO)
+static int modo_diario = DIARIO_EXCLUSIVO;
+static int processo_unico = 0;
+static unsigned int geracoes_vistas[MAX_ARQUIVOS_DIARIO];
+static unsigned int arquivos_aplicados = 0;
+static int checkpoint_pendente = 0;
+
+static GRAVACAO_PENDENTE* gravacoes = NULL;
+static int num_gravacoes = 0;
+static int capacidade_gravacoes = 0;
+static unsigned char* dados = NULL;
+static size_t tamanho_dados = 0;
+static size_t capacidade_dados = 0;
+static int pendentes[MAX_ARQUIVOS_DIARIO];
+
+// primeira gravação de cada nível de operação em andamento e operações confirmadas ainda não aplicadas
+static int inicios_operacao[MAX_OPERACOES_ANINHADAS];
+static int profundidade = 0;
+static int operacoes_grupo = 0;
+// incrementada a cada grupo aplicado, para diario_aplicar_grupo saber se o seu já foi aplicado
+static unsigned long grupos_aplicados = 0;
+
+/*
+ * soma_verificacao - função interna que calcula a soma FNV-1a de um bloco de bytes
+ */
+static unsigned int soma_verificacao(const unsigned char* bloco, size_t tamanho) {
+        unsigned int soma = 2166136261u;
+        for(size_t i = 0; i < tamanho; i++) {
+                soma ^= bloco[i];
+                soma *= 16777619u;
+        }
+        return soma;
+}
+
+/*
+ * sincronizar_arquivo - função interna que esvazia o buffer do stdio e faz fsync do arquivo
+ */
+static int sincronizar_arquivo(FILE* arquivo) {
+        if(fflush(arquivo) != 0 || fsync(fileno(arquivo)) != 0)
+                return ERRO_ARQUIVO_WRITE;
+        return SUCESSO;
+}
+
+/*
+ * montar_caminho - função interna que junta o diretório da base e o nome de um arquivo
+ */
+static void montar_caminho(char* destino, const char* caminho_diretorio, const char* nome) {
+        strncpy(destino, caminho_diretorio, TAM_MAX_CAMINHO - 1);
+        destino[TAM_MAX_CAMINHO - 1] = '\0';
+        construir_caminho_completo(destino, nome);
+}
+
+/*
+ * descartar_gravacoes - função interna que retira as primeiras quantidade gravações pendentes
+ */
+static void descartar_gravacoes(int quantidade) {
+        if(quantidade <= 0)
+                return;
+
+        size_t bytes = quantidade < num_gravacoes ? gravacoes[quantidade].inicio : tamanho_dados;
+        memmove(gravacoes, gravacoes + quantidade, (size_t)(num_gravacoes - quantidade) * sizeof(GRAVACAO_PENDENTE));
+        memmove(dados, dados + bytes, tamanho_dados - bytes);
+        num_gravacoes -= quantidade;
+        tamanho_dados -= bytes;
+
+        memset(pendentes, 0, sizeof(pendentes));
+        for(int i = 0; i < num_gravacoes; i++) {
+                gravacoes[i].inicio -= bytes;
+                pendentes[gravacoes[i].arquivo]++;
+        }
+        for(int i = 0; i < profundidade; i++)
+                inicios_operacao[i] -= quantidade;
+}
+
+/*
+ * liberar_memoria - função interna que libera as gravações pendentes e zera o estado do diário
+ */
+static void liberar_memoria(void) {
+        free(gravacoes);
+        free(dados);
+        gravacoes = NULL;
+        dados = NULL;
+        num_gravacoes = capacidade_gravacoes = 0;
+        tamanho_dados = capacidade_dados = 0;
+        memset(pendentes, 0, sizeof(pendentes));
+        profundidade = 0;
+        operacoes_grupo = 0;
+        num_arquivos = 0;
+        arquivos_declarados = 0;
+        modo_diario = DIARIO_EXCLUSIVO;
+        processo_unico = 0;
+        arquivos_aplicados = 0;
+        checkpoint_pendente = 0;
+}
+
+/*
+ * ler_controle - função interna que lê a entrada de um arquivo acompanhado no cabeçalho do diário
+ */
+static int ler_controle(int arquivo, CONTROLE_ARQUIVO_DIARIO* controle) {
+        long deslocamento = (long)(offsetof(CABECALHO_DIARIO, controles) + (size_t)arquivo * sizeof(CONTROLE_ARQUIVO_DIARIO));
+        if(fseek(arquivo_diario, deslocamento, SEEK_SET) != 0 || fread(controle, sizeof(CONTROLE_ARQUIVO_DIARIO), 1, arquivo_diario) != 1) {
+                clearerr(arquivo_diario);
+                return ERRO_ARQUIVO_READ;
+        }
+        return SUCESSO;
+}
+
+/*
+ * gravar_controle - função interna que grava a entrada de um arquivo acompanhado no cabeçalho do diário
+ */
+static int gravar_controle(int arquivo, const CONTROLE_ARQUIVO_DIARIO* controle) {
+        long deslocamento = (long)(offsetof(CABECALHO_DIARIO, controles) + (size_t)arquivo * sizeof(CONTROLE_ARQUIVO_DIARIO));
+        if(fseek(arquivo_diario, deslocamento, SEEK_SET) != 0 || fwrite(controle, sizeof(CONTROLE_ARQUIVO_DIARIO), 1, arquivo_diario) != 1 || fflush(arquivo_diario) != 0) {
+                clearerr(arquivo_diario);
+                return ERRO_ARQUIVO_WRITE;
+        }
+        return SUCESSO;
+}
+
+int diario_abrir(const char* caminho_diretorio, const char* const nomes[], int quantidade, int modo, int* sozinho) {
+        if(arquivo_diario != NULL || quantidade < 1 || quantidade > MAX_ARQUIVOS_DIARIO)
+                return ERRO_ABRIR_ARQUIVO;
+
+        memset(nomes_arquivos, 0, sizeof(nomes_arquivos));
+        for(int i = 0; i < quantidade; i++) {
+                if(strlen(nomes[i]) >= TAM_NOME_ARQUIVO_DIARIO)
+                        return ERRO_ABRIR_ARQUIVO;
+                strcpy(nomes_arquivos[i], nomes[i]);
+                montar_caminho(caminhos[i], caminho_diretorio, nomes[i]);
+        }
+
+        // "ab" cria o diário sem esvaziar o de um processo que já esteja usando a base
+        montar_caminho(caminho_diario, caminho_diretorio, NOME_ARQUIVO_DIARIO);
+        FILE* criacao = fopen(caminho_diario, "ab");
+        if(criacao == NULL)
+                return ERRO_ABRIR_ARQUIVO;
+        fclose(criacao);
+
+        arquivo_diario = fopen(caminho_diario, "r+b");
+        if(arquivo_diario == NULL)
+                return ERRO_ABRIR_ARQUIVO;
+
+        // entre processos, o cabeçalho muda por fora e cada registro deve ir ao arquivo em uma única gravação
+        if(modo == DIARIO_COMPARTILHADO)
+                setvbuf(arquivo_diario, NULL, _IONBF, 0);
+
+        // a abertura fica travada até diario_preparar: quem chega depois espera a inicialização terminar
+        int retorno = travar_regiao(arquivo_diario, TRAVA_EXCLUSIVA, TRAVA_ABERTURA, 1, 1);
+        if(retorno == SUCESSO) {
+                retorno = travar_regiao(arquivo_diario, TRAVA_EXCLUSIVA, TRAVA_USO, 1, 0);
+                processo_unico = retorno == SUCESSO;
+                if(retorno == ERRO_TRAVA_OCUPADA && modo == DIARIO_COMPARTILHADO)
+                        retorno = travar_regiao(arquivo_diario, TRAVA_COMPARTILHADA, TRAVA_USO, 1, 0);
+        }
+        if(retorno != SUCESSO) {
+                fclose(arquivo_diario);     // as travas são liberadas com o arquivo
+                arquivo_diario = NULL;
+                return retorno;
+        }
+
+        modo_diario = modo;
+        arquivos_declarados = quantidade;
+        *sozinho = processo_unico;
+
+        return SUCESSO;
+}
+
+int diario_preparar(void) {
+        if(arquivo_diario == NULL || num_arquivos > 0)
+                return ERRO_ABRIR_ARQUIVO;
+
+        int retorno = SUCESSO;
+        CABECALHO_DIARIO cabecalho;
+        if(processo_unico) {
+                // nenhum outro processo usa a base e a recuperação já foi feita: o diário recomeça vazio
+                memset(&cabecalho, 0, sizeof(CABECALHO_DIARIO));
+                cabecalho.assinatura = ASSINATURA_DIARIO;
+                cabecalho.quantidade_arquivos = arquivos_declarados;
+                memcpy(cabecalho.nomes, nomes_arquivos, sizeof(cabecalho.nomes));
+                if(
+                        ftruncate(fileno(arquivo_diario), 0) != 0 || fseek(arquivo_diario, 0, SEEK_SET) != 0 ||
+                        fwrite(&cabecalho, sizeof(CABECALHO_DIARIO), 1, arquivo_diario) != 1 || sincronizar_arquivo(arquivo_diario) != SUCESSO
+                ) {
+                        retorno = ERRO_ARQUIVO_WRITE;
+                }
+
+#ifndef _WIN32
+                // a entrada do diário no diretório também precisa estar no disco: é ela que indica uma execução interrompida
+                char caminho_base[TAM_MAX_CAMINHO];
+                strncpy(caminho_base, caminho_diario, TAM_MAX_CAMINHO - 1);
+                caminho_base[TAM_MAX_CAMINHO - 1] = '\0';
+                caminho_base[strlen(caminho_base) - strlen(NOME_ARQUIVO_DIARIO)] = '\0';
+                int descritor = open(caminho_base, O_RDONLY);
+                if(descritor >= 0) {
+                        fsync(descritor);
+                        close(descritor);
+                }
+#endif
+
+                // os próximos processos entram junto com este
+                if(retorno == SUCESSO && modo_diario == DIARIO_COMPARTILHADO)
+                        retorno = travar_regiao(arquivo_diario, TRAVA_COMPARTILHADA, TRAVA_USO, 1, 1);
+        } else if(
+                fseek(arquivo_diario, 0, SEEK_SET) != 0 || fread(&cabecalho, sizeof(CABECALHO_DIARIO), 1, arquivo_diario) != 1 ||
+                cabecalho.assinatura != ASSINATURA_DIARIO || cabecalho.quantidade_arquivos != arquivos_declarados ||
+                memcmp(cabecalho.nomes, nomes_arquivos, sizeof(cabecalho.nomes)) != 0
+        ) {
+                // diário preparado por outro processo para outros arquivos (ou por outra versão do programa)
+                retorno = ERRO_ABRIR_ARQUIVO;
+        }
+
+        if(retorno != SUCESSO) {
+                fclose(arquivo_diario);
+                arquivo_diario = NULL;
+                liberar_memoria();
+                return retorno;
+        }
+
+        num_arquivos = arquivos_declarados;
+        for(int i = 0; i < num_arquivos; i++)
+                geracoes_vistas[i] = cabecalho.controles[i].geracao;
+        tamanho_diario = (long)sizeof(CABECALHO_DIARIO);
+        fseek(arquivo_diario, tamanho_diario, SEEK_SET);
+        travar_regiao(arquivo_diario, TRAVA_LIVRE, TRAVA_ABERTURA, 1, 0);
+
+        return SUCESSO;
+}
+
+int diario_aberto(void) {
+        return arquivo_diario != NULL && num_arquivos > 0;
+}
+
+int diario_arquivo(const char* caminho) {
+        if(arquivo_diario == NULL)
+                return -1;
+        for(int i = 0; i < num_arquivos; i++)
+                if(strcmp(caminhos[i], caminho) == 0)
+                        return i;
+        return -1;
+}
+
+int diario_situacao(int arquivo) {
+        if(arquivo < 0 || modo_diario != DIARIO_COMPARTILHADO || !diario_aberto())
+                return 0;
+
+        // sem a entrada, o processo descarta o que guarda do arquivo por precaução
+        CONTROLE_ARQUIVO_DIARIO controle;
+        if(ler_controle(arquivo, &controle) != SUCESSO)
+                return DIARIO_ARQUIVO_ALTERADO;
+
+        int situacao = 0;
+        if(controle.geracao != geracoes_vistas[arquivo]) {
+                geracoes_vistas[arquivo] = controle.geracao;
+                situacao |= DIARIO_ARQUIVO_ALTERADO;
+        }
+        if(controle.aplicacao != 0)
+                situacao |= DIARIO_APLICACAO_INTERROMPIDA;
+
+        return situacao;
+}
+
+int diario_iniciar_operacao(void) {
+        if(arquivo_diario == NULL)
+                return SUCESSO;
+        if(profundidade == MAX_OPERACOES_ANINHADAS)
+                return ERRO_TRANSACAO;
+
+        inicios_operacao[profundidade++] = num_gravacoes;
+        return SUCESSO;
+}
+
+void diario_desfazer_operacao(void) {
+        if(profundidade == 0)
+                return;
+
+        // só as gravações deste nível; as anteriores da operação de fora continuam pendentes
+        int inicio = inicios_operacao[--profundidade];
+        for(int i = inicio; i < num_gravacoes; i++)
+                pendentes[gravacoes[i].arquivo]--;
+        if(inicio < num_gravacoes)
+                tamanho_dados = gravacoes[inicio].inicio;
+        num_gravacoes = inicio;
+}
+
+unsigned int diario_arquivos_alterados(void) {
+        unsigned int arquivos = 0;
+        if(profundidade > 0)
+                for(int i = inicios_operacao[0]; i < num_gravacoes; i++)
+                        arquivos |= 1u << gravacoes[i].arquivo;
+        return arquivos;
+}
+
+/*
+ * comparar_gravacoes - função interna que ordena gravações por arquivo e deslocamento (qsort)
+ */
+static int comparar_gravacoes(const void* a, const void* b) {
+        const GRAVACAO_PENDENTE* x = a;
+        const GRAVACAO_PENDENTE* y = b;
+        if(x->arquivo != y->arquivo)
+                return x->arquivo < y->arquivo ? -1 : 1;
+        if(x->deslocamento != y->deslocamento)
+                return x->deslocamento < y->deslocamento ? -1 : 1;
+        return 0;
+}
+
+/*
+ * comparar_regiao - função interna que localiza a região fundida que contém o início de uma gravação (bsearch)
+ */
+static int comparar_regiao(const void* chave, const void* elemento) {
+        const GRAVACAO_PENDENTE* gravacao = chave;
+        const GRAVACAO_PENDENTE* regiao = elemento;
+        if(gravacao->arquivo != regiao->arquivo)
+                return gravacao->arquivo < regiao->arquivo ? -1 : 1;
+        if(gravacao->deslocamento < regiao->deslocamento)
+                return -1;
+        if(gravacao->deslocamento >= regiao->deslocamento + (long)regiao->tamanho)
+                return 1;
+        return 0;
+}
+
+/*
+ * fundir_gravacoes - função interna que funde as gravações pendentes a partir de inicio
+ *
+ * Gravações do mesmo arquivo que se sobrepõem ou se tocam viram uma única região, ordenada por
+ * arquivo e deslocamento, com o conteúdo final (as gravações são reaplicadas na ordem em que
+ * foram feitas). Os bytes resultantes nunca passam dos originais, então cabem no mesmo lugar de dados.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou ERRO_ALOCAR_MEMORIA (-30) (as gravações ficam como estavam).
+ */
+static int fundir_gravacoes(int inicio) {
+        int quantidade = num_gravacoes - inicio;
+        if(quantidade < 2)
+                return SUCESSO;
+
+        int retorno = SUCESSO;
+        size_t base = gravacoes[inicio].inicio;
+        GRAVACAO_PENDENTE* regioes = malloc((size_t)quantidade * sizeof(GRAVACAO_PENDENTE));
+        unsigned char* conteudo = malloc(tamanho_dados - base);
+        if(regioes == NULL || conteudo == NULL) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_regioes;
+        }
+
+        memcpy(regioes, gravacoes + inicio, (size_t)quantidade * sizeof(GRAVACAO_PENDENTE));
+        qsort(regioes, (size_t)quantidade, sizeof(GRAVACAO_PENDENTE), comparar_gravacoes);
+
+        int num_regioes = 0;
+        for(int i = 0; i < quantidade; i++) {
+                GRAVACAO_PENDENTE* ultima = num_regioes > 0 ? &regioes[num_regioes - 1] : NULL;
+                long fim = regioes[i].deslocamento + (long)regioes[i].tamanho;
+                if(ultima != NULL && ultima->arquivo == regioes[i].arquivo && regioes[i].deslocamento <= ultima->deslocamento + (long)ultima->tamanho) {
+                        if(fim > ultima->deslocamento + (long)ultima->tamanho)
+                                ultima->tamanho = (size_t)(fim - ultima->deslocamento);
+                } else {
+                        regioes[num_regioes++] = regioes[i];
+                }
+        }
+
+        size_t usado = 0;
+        for(int i = 0; i < num_regioes; i++) {
+                regioes[i].inicio = base + usado;
+                usado += regioes[i].tamanho;
+        }
+
+        // cada byte de uma região foi gravado por alguma das gravações que a formaram
+        for(int i = inicio; i < num_gravacoes; i++) {
+                const GRAVACAO_PENDENTE* gravacao = &gravacoes[i];
+                const GRAVACAO_PENDENTE* regiao = bsearch(gravacao, regioes, (size_t)num_regioes, sizeof(GRAVACAO_PENDENTE), comparar_regiao);
+                memcpy(conteudo + (regiao->inicio - base) + (size_t)(gravacao->deslocamento - regiao->deslocamento), dados + gravacao->inicio, gravacao->tamanho);
+                pendentes[gravacao->arquivo]--;
+        }
+        for(int i = 0; i < num_regioes; i++)
+                pendentes[regioes[i].arquivo]++;
+
+        memcpy(gravacoes + inicio, regioes, (size_t)num_regioes * sizeof(GRAVACAO_PENDENTE));
+        memcpy(dados + base, conteudo, usado);
+        num_gravacoes = inicio + num_regioes;
+        tamanho_dados = base + usado;
+
+liberar_regioes:
+        free(conteudo);
+        free(regioes);
+
+        return retorno;
+}
+
+/*
+ * anexar_registro - função interna que acrescenta um registro ao diário compartilhado por vários processos
+ *
+ * @bloco - registro completo (REGISTRO_DIARIO seguido do corpo)
+ * @arquivos - máscara dos arquivos alterados pelo registro
+ * @posicao - recebe a posição do registro no diário
+ *
+ * Antes do registro, a posição e o tamanho dele são marcados na entrada de cada arquivo alterado:
+ * se o processo terminar no meio da aplicação, outro processo sabe que registro reaplicar (diario_reparar)
+ * e a recuperação sabe que bytes pular se o registro não tiver chegado inteiro ao diário. O registro
+ * vai depois do fim do diário e de qualquer região ainda reservada por uma marca.
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_TRAVAR_ARQUIVO (-33) ou ERRO_ARQUIVO_WRITE (-2) (as marcas
+ *	e o tamanho do diário voltam a ser os anteriores).
+ */
+static int anexar_registro(const unsigned char* bloco, size_t tamanho, unsigned int arquivos, long* posicao) {
+        int retorno = travar_regiao(arquivo_diario, TRAVA_EXCLUSIVA, TRAVA_ANEXACAO, 1, 1);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        CABECALHO_DIARIO cabecalho;
+        long fim = -1;
+        if(
+                fseek(arquivo_diario, 0, SEEK_SET) != 0 || fread(&cabecalho, sizeof(CABECALHO_DIARIO), 1, arquivo_diario) != 1 ||
+                fseek(arquivo_diario, 0, SEEK_END) != 0 || (fim = ftell(arquivo_diario)) < 0
+        ) {
+                clearerr(arquivo_diario);
+                retorno = ERRO_ARQUIVO_WRITE;
+                goto liberar_anexacao;
+        }
+
+        *posicao = fim;
+        for(int i = 0; i < num_arquivos; i++) {
+                long reservado = (long)cabecalho.controles[i].aplicacao + (long)cabecalho.controles[i].tamanho_aplicacao;
+                if(cabecalho.controles[i].aplicacao != 0 && reservado > *posicao)
+                        *posicao = reservado;
+        }
+
+        int marcados = 0;
+        for(; marcados < num_arquivos && retorno == SUCESSO; marcados++) {
+                if(!(arquivos & (1u << marcados)))
+                        continue;
+                CONTROLE_ARQUIVO_DIARIO controle = cabecalho.controles[marcados];
+                controle.aplicacao = *posicao;
+                controle.tamanho_aplicacao = (unsigned int)tamanho;
+                retorno = gravar_controle(marcados, &controle);
+        }
+
+        if(
+                retorno == SUCESSO &&
+                (fseek(arquivo_diario, *posicao, SEEK_SET) != 0 || fwrite(bloco, tamanho, 1, arquivo_diario) != 1 || fflush(arquivo_diario) != 0)
+        ) {
+                clearerr(arquivo_diario);
+                retorno = ERRO_ARQUIVO_WRITE;
+        }
+
+        if(retorno != SUCESSO) {
+                // só as marcas que foram gravadas; um registro pela metade não pode ficar sem marca
+                for(int i = 0; i < marcados; i++)
+                        if(arquivos & (1u << i))
+                                gravar_controle(i, &cabecalho.controles[i]);
+                if(ftruncate(fileno(arquivo_diario), fim) != 0)
+                        clearerr(arquivo_diario);
+        }
+
+liberar_anexacao:
+        travar_regiao(arquivo_diario, TRAVA_LIVRE, TRAVA_ANEXACAO, 1, 0);
+
+        return retorno;
+}
+
+/*
+ * confirmar_compartilhada - função interna que confirma a operação mais externa com o diário compartilhado
+ *
+ * Sem confirmação em grupo: os outros processos só podem ler o que já está nos arquivos, então cada
+ * operação recebe o seu fsync e é aplicada logo em seguida (o chamador mantém as travas dos arquivos).
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), o erro de anexar_registro (a operação é desfeita) ou o erro do fsync
+ *	ou da aplicação (as gravações são descartadas; a marca do arquivo fica para diario_reparar).
+ */
+static int confirmar_compartilhada(const unsigned char* bloco, size_t tamanho, unsigned int arquivos) {
+        long posicao;
+        int retorno = anexar_registro(bloco, tamanho, arquivos, &posicao);
+        if(retorno != SUCESSO) {
+                diario_desfazer_operacao();
+                return retorno;
+        }
+        profundidade = 0;
+
+        if(sincronizar_arquivo(arquivo_diario) != SUCESSO) {
+                retorno = ERRO_ARQUIVO_WRITE;
+        } else {
+                for(int i = 0; i < num_gravacoes && retorno == SUCESSO; i++)
+                        retorno = aplicar_gravacao_dados(caminhos[gravacoes[i].arquivo], gravacoes[i].deslocamento, gravacoes[i].tamanho, dados + gravacoes[i].inicio);
+
+                // as páginas alteradas vão ao sistema operacional, onde os outros processos as leem
+                for(int i = 0; i < num_arquivos && retorno == SUCESSO; i++)
+                        if(arquivos & (1u << i))
+                                retorno = descarregar_caminho_dados(caminhos[i]);
+        }
+        descartar_gravacoes(num_gravacoes);
+
+        if(retorno == SUCESSO)
+                arquivos_aplicados |= arquivos;
+        if(posicao + (long)tamanho >= DIARIO_TAMANHO_CHECKPOINT)
+                checkpoint_pendente = 1;
+
+        return retorno;
+}
+
+int diario_confirmar_operacao(void) {
+        if(profundidade == 0)
+                return SUCESSO;
+
+        // operação aninhada: as gravações passam a ser da operação de fora
+        if(profundidade > 1) {
+                profundidade--;
+                return SUCESSO;
+        }
+
+        int inicio = inicios_operacao[0];
+        if(inicio == num_gravacoes) {
+                profundidade = 0;
+                return SUCESSO;
+        }
+
+        if(fundir_gravacoes(inicio) != SUCESSO) {
+                diario_desfazer_operacao();
+                return ERRO_ALOCAR_MEMORIA;
+        }
+
+        // registro: cabeçalho seguido de cada gravação com os seus bytes, em um único bloco
+        int quantidade = num_gravacoes - inicio;
+        size_t tamanho = (size_t)quantidade * sizeof(GRAVACAO_DIARIO) + (tamanho_dados - gravacoes[inicio].inicio);
+        unsigned char* bloco = malloc(sizeof(REGISTRO_DIARIO) + tamanho);
+        if(bloco == NULL) {
+                diario_desfazer_operacao();
+                return ERRO_ALOCAR_MEMORIA;
+        }
+
+        unsigned char* corpo = bloco + sizeof(REGISTRO_DIARIO);
+        unsigned int arquivos = 0;
+        size_t usado = 0;
+        for(int i = inicio; i < num_gravacoes; i++) {
+                GRAVACAO_DIARIO gravacao;
+                memset(&gravacao, 0, sizeof(GRAVACAO_DIARIO));
+                gravacao.arquivo = gravacoes[i].arquivo;
+                gravacao.tamanho = (int)gravacoes[i].tamanho;
+                gravacao.deslocamento = gravacoes[i].deslocamento;
+                memcpy(corpo + usado, &gravacao, sizeof(GRAVACAO_DIARIO));
+                usado += sizeof(GRAVACAO_DIARIO);
+                memcpy(corpo + usado, dados + gravacoes[i].inicio, gravacoes[i].tamanho);
+                usado += gravacoes[i].tamanho;
+                arquivos |= 1u << gravacoes[i].arquivo;
+        }
+
+        REGISTRO_DIARIO registro;
+        registro.assinatura = ASSINATURA_DIARIO;
+        registro.quantidade = (unsigned int)quantidade;
+        registro.tamanho = (unsigned int)tamanho;
+        registro.soma = soma_verificacao(corpo, tamanho);
+        memcpy(bloco, &registro, sizeof(REGISTRO_DIARIO));
+
+        int retorno = SUCESSO;
+        if(modo_diario == DIARIO_COMPARTILHADO) {
+                retorno = confirmar_compartilhada(bloco, sizeof(REGISTRO_DIARIO) + tamanho, arquivos);
+                goto liberar_bloco;
+        }
+
+        // o registro vai ao sistema operacional agora; o fsync fica para o fim do grupo
+        if(fwrite(bloco, sizeof(REGISTRO_DIARIO) + tamanho, 1, arquivo_diario) != 1 || fflush(arquivo_diario) != 0) {
+                // um registro pela metade esconderia da recuperação todos os seguintes
+                clearerr(arquivo_diario);
+                if(ftruncate(fileno(arquivo_diario), tamanho_diario) == 0)
+                        fseek(arquivo_diario, tamanho_diario, SEEK_SET);
+                diario_desfazer_operacao();
+                retorno = ERRO_ARQUIVO_WRITE;
+                goto liberar_bloco;
+        }
+
+        tamanho_diario += (long)(sizeof(REGISTRO_DIARIO) + tamanho);
+        profundidade = 0;
+        operacoes_grupo++;
+
+        if(operacoes_grupo >= DIARIO_OPERACOES_POR_GRUPO || tamanho_dados >= (size_t)DIARIO_LIMITE_MEMORIA)
+                retorno = diario_sincronizar();
+
+liberar_bloco:
+        free(bloco);
+
+        return retorno;
+}
+
+int diario_anotar(int arquivo, long deslocamento, size_t tamanho, const void* origem) {
+        if(deslocamento < 0)
+                return ERRO_ARQUIVO_SEEK;
+
+        if(num_gravacoes == capacidade_gravacoes) {
+                int nova_capacidade = capacidade_gravacoes == 0 ? 64 : capacidade_gravacoes * 2;
+                GRAVACAO_PENDENTE* novas = realloc(gravacoes, (size_t)nova_capacidade * sizeof(GRAVACAO_PENDENTE));
+                if(novas == NULL)
+                        return ERRO_ALOCAR_MEMORIA;
+                gravacoes = novas;
+                capacidade_gravacoes = nova_capacidade;
+        }
+        if(tamanho_dados + tamanho > capacidade_dados) {
+                size_t nova_capacidade = capacidade_dados == 0 ? 4096 : capacidade_dados;
+                while(nova_capacidade < tamanho_dados + tamanho)
+                        nova_capacidade *= 2;
+                unsigned char* novos = realloc(dados, nova_capacidade);
+                if(novos == NULL)
+                        return ERRO_ALOCAR_MEMORIA;
+                dados = novos;
+                capacidade_dados = nova_capacidade;
+        }
+
+        // fora de uma operação, a gravação é uma operação sozinha
+        int avulsa = profundidade == 0;
+        if(avulsa)
+                diario_iniciar_operacao();
+
+        GRAVACAO_PENDENTE* gravacao = &gravacoes[num_gravacoes++];
+        gravacao->arquivo = arquivo;
+        gravacao->tamanho = tamanho;
+        gravacao->deslocamento = deslocamento;
+        gravacao->inicio = tamanho_dados;
+        memcpy(dados + tamanho_dados, origem, tamanho);
+        tamanho_dados += tamanho;
+        pendentes[arquivo]++;
+
+        return avulsa ? diario_confirmar_operacao() : SUCESSO;
+}
+
+int diario_pendente(int arquivo, long deslocamento, size_t tamanho) {
+        if(arquivo < 0 || pendentes[arquivo] == 0)
+                return 0;
+
+        long fim = deslocamento + (long)tamanho;
+        for(int i = 0; i < num_gravacoes; i++) {
+                const GRAVACAO_PENDENTE* gravacao = &gravacoes[i];
+                if(gravacao->arquivo == arquivo && gravacao->deslocamento < fim && gravacao->deslocamento + (long)gravacao->tamanho > deslocamento)
+                        return 1;
+        }
+        return 0;
+}
+
+int diario_sobrepor(int arquivo, long deslocamento, size_t tamanho, void* destino) {
+        if(arquivo < 0 || pendentes[arquivo] == 0)
+                return 0;
+
+        int cobre = 0;
+        long fim = deslocamento + (long)tamanho;
+        for(int i = 0; i < num_gravacoes; i++) {
+                const GRAVACAO_PENDENTE* gravacao = &gravacoes[i];
+                long inicio_gravacao = gravacao->deslocamento;
+                long fim_gravacao = inicio_gravacao + (long)gravacao->tamanho;
+                if(gravacao->arquivo != arquivo || inicio_gravacao >= fim || fim_gravacao <= deslocamento)
+                        continue;
+
+                long de = inicio_gravacao > deslocamento ? inicio_gravacao : deslocamento;
+                long ate = fim_gravacao < fim ? fim_gravacao : fim;
+                memcpy((unsigned char*)destino + (de - deslocamento), dados + gravacao->inicio + (de - inicio_gravacao), (size_t)(ate - de));
+                if(inicio_gravacao <= deslocamento && fim_gravacao >= fim)
+                        cobre = 1;
+        }
+        return cobre;
+}
+
+int diario_sincronizar(void) {
+        if(arquivo_diario == NULL || operacoes_grupo == 0)
+                return SUCESSO;
+
+        // um único fsync torna duráveis todas as operações do grupo
+        if(sincronizar_arquivo(arquivo_diario) != SUCESSO)
+                return ERRO_ARQUIVO_WRITE;
+
+        int confirmadas = profundidade > 0 ? inicios_operacao[0] : num_gravacoes;
+        for(int i = 0; i < confirmadas; i++) {
+                const GRAVACAO_PENDENTE* gravacao = &gravacoes[i];
+                int retorno = aplicar_gravacao_dados(caminhos[gravacao->arquivo], gravacao->deslocamento, gravacao->tamanho, dados + gravacao->inicio);
+                if(retorno != SUCESSO)
+                        return retorno;     // as gravações continuam pendentes; reaplicá-las é seguro
+        }
+        descartar_gravacoes(confirmadas);
+        operacoes_grupo = 0;
+        grupos_aplicados++;
+
+        // o checkpoint espera o fim da operação (biblioteca_destravar): esvaziado aqui, o diário não
+        // faria a recuperação reconstruir os índices que ela ainda vai atualizar
+        if(tamanho_diario >= DIARIO_TAMANHO_CHECKPOINT)
+                checkpoint_pendente = 1;
+
+        return SUCESSO;
+}
+
+int diario_separar_grupo(GRUPO_DIARIO* grupo) {
+        grupo->descritor = -1;
+        if(arquivo_diario == NULL || operacoes_grupo == 0)
+                return SUCESSO;
+
+        // os registros já foram ao sistema operacional em diario_confirmar_operacao
+        if(fflush(arquivo_diario) != 0)
+                return ERRO_ARQUIVO_WRITE;
+
+        grupo->descritor = fileno(arquivo_diario);
+        grupo->gravacoes = profundidade > 0 ? inicios_operacao[0] : num_gravacoes;
+        grupo->operacoes = operacoes_grupo;
+        grupo->aplicados = grupos_aplicados;
+        return SUCESSO;
+}
+
+int diario_gravar_grupo(const GRUPO_DIARIO* grupo) {
+        if(grupo->descritor < 0)
+                return SUCESSO;
+        return fsync(grupo->descritor) == 0 ? SUCESSO : ERRO_ARQUIVO_WRITE;
+}
+
+int diario_aplicar_grupo(const GRUPO_DIARIO* grupo) {
+        // outro grupo aplicado depois da separação já incluiu este, com o seu próprio fsync
+        if(grupo->descritor < 0 || grupo->aplicados != grupos_aplicados)
+                return SUCESSO;
+
+        for(int i = 0; i < grupo->gravacoes; i++) {
+                const GRAVACAO_PENDENTE* gravacao = &gravacoes[i];
+                int retorno = aplicar_gravacao_dados(caminhos[gravacao->arquivo], gravacao->deslocamento, gravacao->tamanho, dados + gravacao->inicio);
+                if(retorno != SUCESSO)
+                        return retorno;
+        }
+        descartar_gravacoes(grupo->gravacoes);
+        operacoes_grupo -= grupo->operacoes;
+        grupos_aplicados++;
+
+        if(tamanho_diario >= DIARIO_TAMANHO_CHECKPOINT)
+                checkpoint_pendente = 1;
+
+        return SUCESSO;
+}
+
+void diario_concluir_aplicacao(void) {
+        if(arquivos_aplicados == 0 || modo_diario != DIARIO_COMPARTILHADO || !diario_aberto()) {
+                arquivos_aplicados = 0;
+                return;
+        }
+
+        for(int i = 0; i < num_arquivos; i++) {
+                CONTROLE_ARQUIVO_DIARIO controle;
+                if(!(arquivos_aplicados & (1u << i)) || ler_controle(i, &controle) != SUCESSO)
+                        continue;
+                controle.geracao++;
+                controle.aplicacao = 0;
+                controle.tamanho_aplicacao = 0;
+                if(gravar_controle(i, &controle) == SUCESSO)
+                        geracoes_vistas[i] = controle.geracao;
+        }
+        arquivos_aplicados = 0;
+}
+
+void diario_registrar_alteracao(unsigned int arquivos) {
+        arquivos_aplicados |= arquivos;
+}
+
+int diario_checkpoint_pendente(void) {
+        return checkpoint_pendente;
+}
+
+int diario_reparar(int arquivo) {
+        if(arquivo < 0 || modo_diario != DIARIO_COMPARTILHADO || !diario_aberto())
+                return SUCESSO;
+
+        CONTROLE_ARQUIVO_DIARIO controle;
+        int retorno = ler_controle(arquivo, &controle);
+        if(retorno != SUCESSO || controle.aplicacao == 0)
+                return retorno;
+
+        size_t tamanho = controle.tamanho_aplicacao;
+        if(tamanho < sizeof(REGISTRO_DIARIO))
+                return ERRO_ARQUIVO_READ;
+        unsigned char* bloco = calloc(tamanho, 1);
+        if(bloco == NULL)
+                return ERRO_ALOCAR_MEMORIA;
+
+        // bytes que não chegaram ao diário ficam zerados e o registro não confere
+        REGISTRO_DIARIO registro;
+        if(fseek(arquivo_diario, (long)controle.aplicacao, SEEK_SET) != 0 || fread(bloco, 1, tamanho, arquivo_diario) != tamanho)
+                clearerr(arquivo_diario);
+        memcpy(&registro, bloco, sizeof(REGISTRO_DIARIO));
+        unsigned char* corpo = bloco + sizeof(REGISTRO_DIARIO);
+
+        int integro =
+                registro.assinatura == ASSINATURA_DIARIO && registro.tamanho == tamanho - sizeof(REGISTRO_DIARIO) &&
+                soma_verificacao(corpo, registro.tamanho) == registro.soma;
+
+        if(integro) {
+                // as gravações dos outros arquivos do registro são reparadas por quem travar cada um deles
+                size_t usado = 0;
+                for(unsigned int i = 0; i < registro.quantidade && retorno == SUCESSO; i++) {
+                        GRAVACAO_DIARIO gravacao;
+                        if(usado + sizeof(GRAVACAO_DIARIO) > registro.tamanho) {
+                                retorno = ERRO_ARQUIVO_WRITE;
+                                break;
+                        }
+                        memcpy(&gravacao, corpo + usado, sizeof(GRAVACAO_DIARIO));
+                        usado += sizeof(GRAVACAO_DIARIO);
+                        if(gravacao.tamanho < 0 || usado + (size_t)gravacao.tamanho > registro.tamanho || gravacao.deslocamento < 0) {
+                                retorno = ERRO_ARQUIVO_WRITE;
+                                break;
+                        }
+                        if(gravacao.arquivo == arquivo)
+                                retorno = aplicar_gravacao_dados(caminhos[arquivo], (long)gravacao.deslocamento, (size_t)gravacao.tamanho, corpo + usado);
+                        usado += (size_t)gravacao.tamanho;
+                }
+                if(retorno == SUCESSO)
+                        retorno = descarregar_caminho_dados(caminhos[arquivo]);
+        } else {
+                // operação que não chegou inteira ao diário: não foi confirmada, e nada dela chegou aos
+                // arquivos; a região reservada vira um registro vazio para a recuperação seguir adiante
+                memset(bloco, 0, tamanho);
+                registro.assinatura = ASSINATURA_DIARIO;
+                registro.quantidade = 0;
+                registro.tamanho = (unsigned int)(tamanho - sizeof(REGISTRO_DIARIO));
+                registro.soma = soma_verificacao(corpo, registro.tamanho);
+                memcpy(bloco, &registro, sizeof(REGISTRO_DIARIO));
+                if(
+                        fseek(arquivo_diario, (long)controle.aplicacao, SEEK_SET) != 0 ||
+                        fwrite(bloco, tamanho, 1, arquivo_diario) != 1 || sincronizar_arquivo(arquivo_diario) != SUCESSO
+                ) {
+                        clearerr(arquivo_diario);
+                        retorno = ERRO_ARQUIVO_WRITE;
+                }
+        }
+        free(bloco);
+
+        if(retorno != SUCESSO)
+                return retorno;
+        arquivos_aplicados |= 1u << arquivo;
+
+        return integro;
+}
+
+/*
+ * checkpoint_compartilhado - função interna que esvazia o diário compartilhado por vários processos
+ *
+ * O chamador deve impedir novas operações em todos os arquivos (travas de biblioteca.h, ou ser o
+ * último processo com a base aberta). Com alguma aplicação interrompida ainda marcada, o diário
+ * não é esvaziado: o registro dela ainda pode ser necessário.
+ */
+static int checkpoint_compartilhado(void) {
+        checkpoint_pendente = 0;
+
+        CABECALHO_DIARIO cabecalho;
+        if(fseek(arquivo_diario, 0, SEEK_SET) != 0 || fread(&cabecalho, sizeof(CABECALHO_DIARIO), 1, arquivo_diario) != 1) {
+                clearerr(arquivo_diario);
+                return ERRO_ARQUIVO_READ;
+        }
+        for(int i = 0; i < num_arquivos; i++)
+                if(cabecalho.controles[i].aplicacao != 0)
+                        return SUCESSO;
+
+        int retorno;
+        for(int i = 0; i < num_arquivos; i++) {
+                if((retorno = sincronizar_caminho_dados(caminhos[i])) != SUCESSO)
+                        return retorno;
+        }
+
+        if((retorno = travar_regiao(arquivo_diario, TRAVA_EXCLUSIVA, TRAVA_ANEXACAO, 1, 1)) != SUCESSO)
+                return retorno;
+        if(ftruncate(fileno(arquivo_diario), (long)sizeof(CABECALHO_DIARIO)) != 0 || sincronizar_arquivo(arquivo_diario) != SUCESSO)
+                retorno = ERRO_ARQUIVO_WRITE;
+        travar_regiao(arquivo_diario, TRAVA_LIVRE, TRAVA_ANEXACAO, 1, 0);
+
+        return retorno;
+}
+
+int diario_checkpoint(void) {
+        if(arquivo_diario == NULL)
+                return SUCESSO;
+        if(modo_diario == DIARIO_COMPARTILHADO)
+                return diario_aberto() ? checkpoint_compartilhado() : SUCESSO;
+
+        checkpoint_pendente = 0;
+        int retorno = diario_sincronizar();
+        if(retorno != SUCESSO || tamanho_diario == (long)sizeof(CABECALHO_DIARIO))
+                return retorno;
+
+        for(int i = 0; i < num_arquivos; i++) {
+                if((retorno = sincronizar_caminho_dados(caminhos[i])) != SUCESSO)
+                        return retorno;
+        }
+
+        // os arquivos já têm tudo o que está no diário: só o cabeçalho continua
+        if(
+                ftruncate(fileno(arquivo_diario), (long)sizeof(CABECALHO_DIARIO)) != 0 ||
+                fseek(arquivo_diario, (long)sizeof(CABECALHO_DIARIO), SEEK_SET) != 0 ||
+                sincronizar_arquivo(arquivo_diario) != SUCESSO
+        ) {
+                return ERRO_ARQUIVO_WRITE;
+        }
+        tamanho_diario = (long)sizeof(CABECALHO_DIARIO);
+
+        return SUCESSO;
+}
+
+int diario_fechar(void) {
+        if(arquivo_diario == NULL)
+                return SUCESSO;
+
+        while(profundidade > 0)
+                diario_desfazer_operacao();
+
+        int retorno = SUCESSO;
+        if(!diario_aberto()) {
+                // aberto e não preparado: a inicialização da base falhou
+        } else if(modo_diario == DIARIO_COMPARTILHADO) {
+                // só o último processo esvazia o diário; a trava de abertura segura quem estiver chegando
+                if(travar_regiao(arquivo_diario, TRAVA_EXCLUSIVA, TRAVA_ABERTURA, 1, 1) == SUCESSO &&
+                   travar_regiao(arquivo_diario, TRAVA_EXCLUSIVA, TRAVA_USO, 1, 0) == SUCESSO) {
+                        retorno = checkpoint_compartilhado();
+                        // sem mais ninguém usando a base, as extensões dos mapeamentos podem sair
+                        if(retorno == SUCESSO)
+                                retorno = encolher_arquivos_dados();
+                }
+        } else {
+                retorno = diario_checkpoint();
+        }
+
+        // as travas são liberadas com o arquivo; esvaziado, o diário fica no diretório só com o cabeçalho
+        fclose(arquivo_diario);
+        arquivo_diario = NULL;
+        liberar_memoria();
+
+        return retorno;
+}
+
+/*
+ * reaplicar_registro - função interna que grava nos arquivos da base as gravações de um registro íntegro
+ *
+ * @destinos - arquivos da base, abertos conforme são usados
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0), ERRO_ABRIR_ARQUIVO (-10) se um arquivo não puder ser aberto ou
+ *	ERRO_ARQUIVO_WRITE (-2) se uma gravação falhar ou o registro estiver malformado.
+ */
+static int reaplicar_registro(
+        const CABECALHO_DIARIO* cabecalho,
+        const char* caminho_diretorio,
+        FILE* destinos[],
+        const unsigned char* corpo,
+        const REGISTRO_DIARIO* registro
+) {
+        size_t usado = 0;
+        for(unsigned int i = 0; i < registro->quantidade; i++) {
+                GRAVACAO_DIARIO gravacao;
+                if(usado + sizeof(GRAVACAO_DIARIO) > registro->tamanho)
+                        return ERRO_ARQUIVO_WRITE;
+                memcpy(&gravacao, corpo + usado, sizeof(GRAVACAO_DIARIO));
+                usado += sizeof(GRAVACAO_DIARIO);
+
+                if(
+                        gravacao.arquivo < 0 || gravacao.arquivo >= cabecalho->quantidade_arquivos ||
+                        gravacao.tamanho < 0 || usado + (size_t)gravacao.tamanho > registro->tamanho || gravacao.deslocamento < 0
+                ) {
+                        return ERRO_ARQUIVO_WRITE;
+                }
+
+                FILE** destino = &destinos[gravacao.arquivo];
+                if(*destino == NULL) {
+                        char caminho[TAM_MAX_CAMINHO];
+                        montar_caminho(caminho, caminho_diretorio, cabecalho->nomes[gravacao.arquivo]);
+                        if((*destino = fopen(caminho, "r+b")) == NULL)
+                                return ERRO_ABRIR_ARQUIVO;
+                }
+
+                if(fseek(*destino, (long)gravacao.deslocamento, SEEK_SET) != 0 || fwrite(corpo + usado, (size_t)gravacao.tamanho, 1, *destino) != 1)
+                        return ERRO_ARQUIVO_WRITE;
+                usado += (size_t)gravacao.tamanho;
+        }
+
+        return SUCESSO;
+}
+
+/*
+ * regiao_reservada - função interna que retorna os bytes reservados por uma marca para um registro
+ * na posição informada (0 se nenhuma marca aponta para ela)
+ */
+static long regiao_reservada(const CABECALHO_DIARIO* cabecalho, long posicao) {
+        for(int i = 0; i < cabecalho->quantidade_arquivos; i++)
+                if(cabecalho->controles[i].aplicacao == posicao && cabecalho->controles[i].tamanho_aplicacao > 0)
+                        return (long)cabecalho->controles[i].tamanho_aplicacao;
+        return 0;
+}
+
+int diario_recuperar(const char* caminho_diretorio, int* interrompida) {
+        char caminho[TAM_MAX_CAMINHO];
+        montar_caminho(caminho, caminho_diretorio, NOME_ARQUIVO_DIARIO);
+
+        // aberto por diario_abrir antes da inicialização: as travas pertencem a esse FILE
+        *interrompida = 0;
+        FILE* diario = arquivo_diario != NULL && strcmp(caminho, caminho_diario) == 0 ? arquivo_diario : fopen(caminho, "r+b");
+        if(diario == NULL)
+                return SUCESSO;
+
+        int retorno = SUCESSO;
+        FILE* destinos[MAX_ARQUIVOS_DIARIO] = {NULL};
+        unsigned char* corpo = NULL;
+
+        long tamanho_arquivo;
+        if(fseek(diario, 0, SEEK_END) != 0 || (tamanho_arquivo = ftell(diario)) < 0) {
+                retorno = ERRO_ARQUIVO_READ;
+                goto fechar_diario;
+        }
+        if(tamanho_arquivo == 0)
+                goto fechar_diario;
+
+        // diário sem cabeçalho completo: a execução anterior parou antes da primeira operação
+        CABECALHO_DIARIO cabecalho;
+        long tamanho_cabecalho = (long)TAM_CABECALHO_DIARIO_V1;
+        memset(&cabecalho, 0, sizeof(CABECALHO_DIARIO));
+        rewind(diario);
+        int valido =
+                fread(&cabecalho, TAM_CABECALHO_DIARIO_V1, 1, diario) == 1 &&
+                (cabecalho.assinatura == ASSINATURA_DIARIO_V1 || cabecalho.assinatura == ASSINATURA_DIARIO) &&
+                cabecalho.quantidade_arquivos >= 1 && cabecalho.quantidade_arquivos <= MAX_ARQUIVOS_DIARIO;
+        if(valido && cabecalho.assinatura == ASSINATURA_DIARIO) {
+                valido = fread(cabecalho.controles, sizeof(cabecalho.controles), 1, diario) == 1;
+                tamanho_cabecalho = (long)sizeof(CABECALHO_DIARIO);
+        }
+
+        // desde ASSINATURA_DIARIO o diário esvaziado continua no diretório; antes, existir bastava
+        *interrompida = !valido || cabecalho.assinatura == ASSINATURA_DIARIO_V1 || tamanho_arquivo > tamanho_cabecalho;
+        if(!valido)
+                goto fechar_diario;
+        for(int i = 0; i < cabecalho.quantidade_arquivos; i++)
+                cabecalho.nomes[i][TAM_NOME_ARQUIVO_DIARIO - 1] = '\0';
+
+        // cada registro é reaplicado por inteiro; o primeiro incompleto ou corrompido encerra a recuperação,
+        // a não ser que uma marca reserve os seus bytes (outro processo continuou anexando depois dele)
+        long posicao = tamanho_cabecalho;
+        REGISTRO_DIARIO registro;
+        while(posicao < tamanho_arquivo) {
+                int integro = fseek(diario, posicao, SEEK_SET) == 0 && fread(&registro, sizeof(REGISTRO_DIARIO), 1, diario) == 1 &&
+                              registro.assinatura == cabecalho.assinatura;
+                if(integro) {
+                        unsigned char* novo = realloc(corpo, registro.tamanho > 0 ? registro.tamanho : 1);
+                        if(novo == NULL) {
+                                retorno = ERRO_ALOCAR_MEMORIA;
+                                goto fechar_destinos;
+                        }
+                        corpo = novo;
+                        integro = fread(corpo, 1, registro.tamanho, diario) == registro.tamanho && soma_verificacao(corpo, registro.tamanho) == registro.soma;
+                }
+
+                if(!integro) {
+                        long reservado = regiao_reservada(&cabecalho, posicao);
+                        if(reservado == 0)
+                                break;
+                        clearerr(diario);
+                        posicao += reservado;
+                        continue;
+                }
+
+                if((retorno = reaplicar_registro(&cabecalho, caminho_diretorio, destinos, corpo, &registro)) != SUCESSO)
+                        goto fechar_destinos;
+                posicao += (long)sizeof(REGISTRO_DIARIO) + (long)registro.tamanho;
+        }
+
+fechar_destinos:
+        for(int i = 0; i < MAX_ARQUIVOS_DIARIO; i++) {
+                if(destinos[i] == NULL)
+                        continue;
+                if(sincronizar_arquivo(destinos[i]) != SUCESSO && retorno == SUCESSO)
+                        retorno = ERRO_ARQUIVO_WRITE;
+                fclose(destinos[i]);
+        }
+        free(corpo);
+
+        // com erro o diário fica para a próxima tentativa
+        if(retorno == SUCESSO && (ftruncate(fileno(diario), 0) != 0 || sincronizar_arquivo(diario) != SUCESSO))
+                retorno = ERRO_ARQUIVO_WRITE;
+
+fechar_diario:
+        if(diario != arquivo_diario)
+                fclose(diario);
+
+        return retorno;
+}
@@ -2,8 +2,16 @@
 #include "../include/livro.h"
 #include "../include/usuario.h"
 #include "../include/arquivo.h"
+#include "../include/armazenamento.h"
+#include "../include/arvore_bmais.h"
+#include "../include/biblioteca.h"
 #include "../include/erros.h"
+#include "../include/indice_hash.h"
+#include "../include/juncao.h"
+#include "../include/tabela_hash.h"
+#include "../include/utils.h"
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -27,12 +35,7 @@
  *	- Retorna ERRO_ARQUIVO_WRITE (-2) em caso de erro no fwrite.
  */
 static int escreve_no_emprestimo(FILE* arquivo_emprestimo, EMPRESTIMO* no_emprestimo, int posicao) {
-        if(fseek(arquivo_emprestimo, sizeof(CABECALHO) + posicao * sizeof(EMPRESTIMO), SEEK_SET) != 0)
-	        return ERRO_ARQUIVO_SEEK;
-        if(fwrite(no_emprestimo, sizeof(EMPRESTIMO), 1, arquivo_emprestimo) == 0)
-	        return ERRO_ARQUIVO_WRITE;
-
-        return SUCESSO;
+        return escrever_registro(arquivo_emprestimo, posicao, sizeof(EMPRESTIMO), no_emprestimo);
 }
 
 /*
@@ -55,10 +58,7 @@ static EMPRESTIMO* le_no_emprestimo(FILE* arquivo_emprestimo, int posicao) {
         if(no_emprestimo == NULL)
                 return NULL;
 
-        if(
-    	        fseek(arquivo_emprestimo, sizeof(CABECALHO) + posicao * sizeof(EMPRESTIMO), SEEK_SET) != 0 ||
-                fread(no_emprestimo, sizeof(EMPRESTIMO), 1, arquivo_emprestimo) != 1
-        ) {
+        if(ler_registro(arquivo_emprestimo, posicao, sizeof(EMPRESTIMO), no_emprestimo) != SUCESSO) {
     	        free(no_emprestimo);
     	        return NULL;
         }
@@ -67,602 +67,1615 @@ static EMPRESTIMO* le_no_emprestimo(FILE* arquivo_emprestimo, int posicao) {
 }
 
 /*
- * verificar_emprestimo_existente - verifica se o emprestimo ja foi registrado
+ * chave_emprestimo - monta a chave composta do índice de empréstimos abertos
  *
- * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimo
- * @codigo_usuario - código do usuario associado ao empréstimo
- * @codigo_livro - código do livro associado ao empréstimo
+ * @codigo_usuario - código do usuário do empréstimo
+ * @codigo_livro - código do livro do empréstimo
+ *
+ * Pós-condições:
+ *	- Retorna um inteiro de 64 bits com o código do usuário nos 32 bits altos e o do livro nos 32 bits baixos.
+ */
+unsigned long long chave_emprestimo(unsigned int codigo_usuario, unsigned int codigo_livro) {
+        return ((unsigned long long)codigo_usuario << 32) | codigo_livro;
+}
+
+int contabilizar_emprestimo(const void* registro, int posicao, void* contexto) {
+        (void)posicao;
+        const EMPRESTIMO* emprestimo = registro;
+        CABECALHO* cabecalho = contexto;
+        if(emprestimo->data_devolucao == DATA_NULA)
+                cabecalho->emprestimos_abertos++;
+        return SUCESSO;
+}
+
+/*
+ * reconstruir_indice_emprestimo - recria o índice de empréstimos abertos (emprestimo.idx) percorrendo a lista
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
  *
  * Pré-condições:
- *      - O caminho para o arquivo deve ser válido e pode ser lido.
- *      - O arquivo de empréstimo deve ser inicializado (conter cabeçalho);
- *      - Os códigos do usuário e livro devem ser válidos (inteiros sem sinal).
+ *	- O arquivo deve existir e estar inicializado com um cabeçalho válido.
  * Pós-condições:
- *      - Retorna SUCESSO caso não tenha conflito.
- *      - Retorna valores negativos em caso de erro:
- *              - ERRO_CONFLITO_ID: Caso seja encontrado um conflito (emprestimo sem devolução associado ao usuário e livro).
- *              - ERRO_ABRIR_ARQUIVO: Caso não seja possível abrir o arquivo informado.
- *              - ERRO_LER_CABECALHO: Caso não seja possível ler o cabeçalho do arquivo.
- *              - ERRO_ARQUIVO_SEEK: Erro no posicionamento do arquivo (erro no fseek).
- *              - ERRO_ARQUIVO_READ: Erro na leitura do arquivo (erro no fwrite).
+ *	- O arquivo de índice é recriado contendo apenas os empréstimos sem data de devolução.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível abrir algum arquivo.
+ *		- ERRO_LER_CABECALHO (-11): não foi possível ler o cabeçalho do arquivo de empréstimos.
+ *		- ERRO_ARQUIVO_SEEK (-1) / ERRO_ARQUIVO_READ (-3): falha ao percorrer a lista.
+ *		- ERRO_ESCREVER_INDICE (-28): não foi possível gravar o índice.
  */
-static int verificar_emprestimo_existente(const char* caminho_arquivo_emprestimo, unsigned int codigo_usuario, unsigned int codigo_livro) {
+int reconstruir_indice_emprestimo(const char* caminho_arquivo_emprestimo) {
         int retorno = SUCESSO;
-        FILE* arquivo = fopen(caminho_arquivo_emprestimo, "rb");
+        FILE* arquivo = abrir_arquivo_dados(caminho_arquivo_emprestimo, "rb");
         if(!arquivo) {
                 return ERRO_ABRIR_ARQUIVO;
         }
 
-        CABECALHO* cabecalho = le_cabecalho(arquivo);
-        if(!cabecalho) {
-                retorno = ERRO_LER_CABECALHO;
-                goto liberar_arquivo;
+        CABECALHO cabecalho;
+        if(ler_cabecalho_dados(arquivo, &cabecalho) != SUCESSO) {
+                fechar_arquivo_dados(arquivo);
+                return ERRO_LER_CABECALHO;
         }
 
-        int pos = cabecalho->pos_cabeca;
-        EMPRESTIMO emprestimo;
-
-        while (pos != -1) {
-                if(fseek(arquivo, sizeof(CABECALHO) + pos * sizeof(EMPRESTIMO), SEEK_SET) != 0) {
-                        retorno = ERRO_ARQUIVO_SEEK;
-                        goto liberar_cabecalho;
-                }
+        // pos_topo é um limite superior para a quantidade de empréstimos na lista
+        int capacidade = cabecalho.pos_topo > 0 ? cabecalho.pos_topo : 1;
+        unsigned long long* chaves = malloc(capacidade * sizeof(unsigned long long));
+        int* posicoes = malloc(capacidade * sizeof(int));
+        if(chaves == NULL || posicoes == NULL) {
+                retorno = ERRO_ESCREVER_INDICE;
+                goto liberar_vetores;
+        }
 
-                if(fread(&emprestimo, sizeof(EMPRESTIMO), 1, arquivo) != 1) {
+        int quantidade = 0;
+        int pos = cabecalho.pos_cabeca;
+        EMPRESTIMO copia;
+        while(pos != -1 && quantidade < capacidade) {
+                const EMPRESTIMO* emprestimo = acessar_registro(arquivo, pos, sizeof(EMPRESTIMO), &copia);
+                if(emprestimo == NULL) {
                         retorno = ERRO_ARQUIVO_READ;
-                        goto liberar_cabecalho;
+                        goto liberar_vetores;
                 }
 
-                if(emprestimo.codigo_livro == codigo_livro && emprestimo.codigo_usuario == codigo_usuario && emprestimo.data_devolucao[0] == '\0') {
-                        retorno = ERRO_CONFLITO_ID;
-                        goto liberar_cabecalho; // conflito encontrado
+                // a lista de pos_cabeca é a dos empréstimos abertos; o histórico de devolvidos não é percorrido
+                if(emprestimo->data_devolucao == DATA_NULA) {
+                        chaves[quantidade] = chave_emprestimo(emprestimo->codigo_usuario, emprestimo->codigo_livro);
+                        posicoes[quantidade] = pos;
+                        quantidade++;
                 }
 
-                pos = emprestimo.proximo;
+                pos = emprestimo->proximo;
         }
-liberar_cabecalho:
-        free(cabecalho);
-liberar_arquivo:
-        fclose(arquivo);
 
-        return retorno;
+        char caminho_indice[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_indice, caminho_arquivo_emprestimo, ".idx");
+        retorno = indice_hash_construir(caminho_indice, chaves, posicoes, quantidade);
+
+liberar_vetores:
+        free(chaves);
+        free(posicoes);
+        fechar_arquivo_dados(arquivo);
 
+        return retorno;
 }
 
 /*
- * emprestar_livro - função que registra um novo empréstimo
- *
- * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimo
- * @caminho_arquivo_livro - caminho completo para o arquivo binário de livro
- * @caminho_arquivo_usuario - caminho completo para o arquivo binário de usuário
- * @codigo_usuario - identificador do usuário que pegou livro emprestado
- * @codigo_livro - identificador do livro que foi emprestado
- * @data_emprestimo - data que o livro foi emprestado
+ * montar_chave_data - função interna que monta a chave do índice de datas
  *
- * Pré-condições:
- *	- Caminhos para os arquivos devem ser válidos.
- *	- Arquivos de empréstimo e livro podem ser aberto em modo leitura e escrita.
- *	- Arquivo de usuário pode ser aberto em modo leitura.
- *	- Códigos de usuario e livro devem ser válidos.
- *	- Data do empréstimo deve estar no formato adequado (DD/MM/AAAA).
- * Pós-condições:
- *	- Um novo registro de empréstimo é registrado, reutilizando posições livres se existirem.
- *	- O cabeçalho do arquivo é atualizado para refletir a nova cabeça da lista encadeada e possíveis posições livres.
- *	- A quantidade de exemplares do livro é decrementada em 1.
- *	- Retorna SUCESSO (0) em caso de sucesso na operação.
- *	- Retorna valores negativos em caso de erro:
- *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível abrir algum arquivo informado.
- *		- ERRO_LER_CABECALHO (-11): não foi possível ler o cabeçalho de algum arquivo informado.
- *		- ERRO_ARQUIVO_SEEK (-1): erro no posicionamento em algum arquivo (fseek).
- *		- ERRO_ARQUIVO_READ (-3): erro na leitura de algum arquivo (fread).
- *		- ERRO_ENCONTRAR_USUARIO (-16): não foi possível encontrar o usuário informado.
- *		- ERRO_ENCONTRAR_LIVRO (-15): não foi possível encontrar o livro informado.
- *		- ERRO_LIVROS_ESGOTADOS (-17): não há unidades disponíveis para empréstimo.
- *		- ERRO_ESCREVER_EMPRESTIMO (-18): não foi possível registrar o empréstimo na lista encadeada.
- *		- ERRO_LER_EMPRESTIMO (-19): não foi possível ler nó de empréstimo na lista encadeada.
- *		- ERRO_CONFLITO_ID: empréstimo já foi registrado previamente.
- *		- ERRO_LIVROS_ESGOTADOS: não há livros disponíveis para empréstimo.
+ * @periodo - PERIODO_EMPRESTIMO ou PERIODO_DEVOLUCAO
+ * @data - data em número de dias
+ * @posicao - posição do empréstimo em emprestimo.dat (desempata datas iguais)
+ * @chave - buffer com TAM_CHAVE_DATA bytes
  */
-int emprestar_livro(
-        const char* caminho_arquivo_emprestimo, 
-        const char* caminho_arquivo_livro, 
-        const char* caminho_arquivo_usuario, 
-        const unsigned int codigo_usuario, 
-        const unsigned int codigo_livro,
-        const char* data_emprestimo
-) {
-        if(verificar_emprestimo_existente(caminho_arquivo_emprestimo, codigo_usuario, codigo_livro) == ERRO_CONFLITO_ID)
-                return ERRO_CONFLITO_ID;
-
-        int retorno = SUCESSO;
+static void montar_chave_data(int periodo, int data, int posicao, unsigned char* chave) {
+        chave[0] = (unsigned char)periodo;
+        arvore_bmais_codificar_inteiro((unsigned int)data, chave + 1);
+        arvore_bmais_codificar_inteiro((unsigned int)posicao, chave + 5);
+}
 
-        // abrir arquivos
-        FILE* arquivo_emprestimo = fopen(caminho_arquivo_emprestimo, "r+b");
-        if(!arquivo_emprestimo) {
-                retorno = ERRO_ABRIR_ARQUIVO;
-                return retorno;
-        }
+/*
+ * comparar_chaves_data - função interna de comparação para qsort
+ */
+static int comparar_chaves_data(const void* a, const void* b) {
+        return memcmp(a, b, TAM_CHAVE_DATA);
+}
 
-        FILE* arquivo_livro = fopen(caminho_arquivo_livro, "r+b");
-        if(!arquivo_livro) {
-                retorno = ERRO_ABRIR_ARQUIVO;
-                goto liberar_arquivo_emprestimo;
+int reconstruir_indice_datas_emprestimo(const char* caminho_arquivo_emprestimo) {
+        int retorno = SUCESSO;
+        FILE* arquivo = abrir_arquivo_dados(caminho_arquivo_emprestimo, "rb");
+        if(!arquivo) {
+                return ERRO_ABRIR_ARQUIVO;
         }
 
-        FILE* arquivo_usuario = fopen(caminho_arquivo_usuario, "rb");
-        if(!arquivo_usuario) {
-                retorno = ERRO_ABRIR_ARQUIVO;
-                goto liberar_arquivo_livro;
+        CABECALHO cabecalho;
+        if(ler_cabecalho_dados(arquivo, &cabecalho) != SUCESSO) {
+                fechar_arquivo_dados(arquivo);
+                return ERRO_LER_CABECALHO;
         }
 
-        // procurar usuario e ver se existe
-        CABECALHO* cabecalho_usuario = le_cabecalho(arquivo_usuario);
-        if(cabecalho_usuario == NULL) {
-                retorno = ERRO_LER_CABECALHO;
-                goto liberar_arquivo_usuario;
+        // até duas chaves (empréstimo e devolução) por registro das listas
+        int capacidade = cabecalho.pos_topo > 0 ? 2 * cabecalho.pos_topo : 1;
+        unsigned char* chaves = malloc((size_t)capacidade * TAM_CHAVE_DATA);
+        int* posicoes = malloc((size_t)capacidade * sizeof(int));
+        if(chaves == NULL || posicoes == NULL) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_vetores;
         }
 
-        int posicao_atual_usuario = cabecalho_usuario->pos_cabeca;
-        USUARIO usuario;
-        int usuario_existe = 0;
-        while (posicao_atual_usuario != -1) {
-                if(fseek(arquivo_usuario, sizeof(CABECALHO) + posicao_atual_usuario * sizeof(USUARIO), SEEK_SET) != 0) {
-                        retorno = ERRO_ARQUIVO_SEEK;
-                        goto liberar_cabecalho_usuario;
-                }
+        // listas de abertos e de devolvidos (limitadas juntas a pos_topo passos, para não entrar em ciclo)
+        int quantidade = 0, passos = 0;
+        int inicios[2] = { cabecalho.pos_cabeca, cabecalho.pos_devolvidos };
+        EMPRESTIMO copia;
+        for(int lista = 0; lista < 2; lista++) {
+                int pos = inicios[lista];
+                for(; pos != -1 && passos < cabecalho.pos_topo; passos++) {
+                        const EMPRESTIMO* emprestimo = acessar_registro(arquivo, pos, sizeof(EMPRESTIMO), &copia);
+                        if(emprestimo == NULL) {
+                                retorno = ERRO_ARQUIVO_READ;
+                                goto liberar_vetores;
+                        }
 
-                if(fread(&usuario, sizeof(USUARIO), 1, arquivo_usuario) != 1) {
-                        retorno = ERRO_ARQUIVO_READ;
-                        goto liberar_cabecalho_usuario;
-                }
+                        // datas ausentes ou desconhecidas não entram no índice
+                        if(emprestimo->data_emprestimo > 0) {
+                                montar_chave_data(PERIODO_EMPRESTIMO, emprestimo->data_emprestimo, pos, chaves + (size_t)quantidade * TAM_CHAVE_DATA);
+                                posicoes[quantidade++] = pos;
+                        }
+                        if(emprestimo->data_devolucao > 0) {
+                                montar_chave_data(PERIODO_DEVOLUCAO, emprestimo->data_devolucao, pos, chaves + (size_t)quantidade * TAM_CHAVE_DATA);
+                                posicoes[quantidade++] = pos;
+                        }
 
-                if(usuario.codigo == codigo_usuario) {
-                        usuario_existe = 1;
-                        break;
+                        pos = emprestimo->proximo;
                 }
-
-                posicao_atual_usuario = usuario.proximo;
-        }
-
-        if(!usuario_existe) {
-                retorno = ERRO_ENCONTRAR_USUARIO;
-                goto liberar_cabecalho_usuario;
-        }
-
-        // procurar livro e ver se existe
-        CABECALHO* cabecalho_livro = le_cabecalho(arquivo_livro);
-        if(cabecalho_livro == NULL) {
-                retorno = ERRO_LER_CABECALHO;
-                goto liberar_cabecalho_usuario;
         }
 
-        int posicao_atual_livro = cabecalho_livro->pos_cabeca;
-        LIVRO livro;
-        int livro_existe = 0;
-        while(posicao_atual_livro != -1) {
-                if(fseek(arquivo_livro, sizeof(CABECALHO) + posicao_atual_livro * sizeof(LIVRO), SEEK_SET) != 0) {
-                        retorno = ERRO_ARQUIVO_SEEK;
-                        goto liberar_cabecalho_livro;
-                }
-
-                if(fread(&livro, sizeof(LIVRO), 1, arquivo_livro) != 1) {
-                        retorno = ERRO_ARQUIVO_READ;
-                        goto liberar_cabecalho_livro;
-                }
-
-                if(livro.codigo == codigo_livro) {
-                        livro_existe = 1;
-                        break;
-                }
+        // a posição faz parte da chave: não há repetições, e o valor pode ser lido da própria chave
+        qsort(chaves, (size_t)quantidade, TAM_CHAVE_DATA, comparar_chaves_data);
+        for(int i = 0; i < quantidade; i++)
+                posicoes[i] = (int)arvore_bmais_decodificar_inteiro(chaves + (size_t)i * TAM_CHAVE_DATA + 5);
 
-                posicao_atual_livro = livro.prox;
-        }
-        if(!livro_existe) {
-                retorno = ERRO_ENCONTRAR_LIVRO;
-                goto liberar_cabecalho_livro;
-        }
+        char caminho_indice[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_indice, caminho_arquivo_emprestimo, EXTENSAO_INDICE_DATAS);
+        retorno = arvore_bmais_construir(caminho_indice, TAM_CHAVE_DATA, chaves, posicoes, quantidade);
 
-        // verificar se há unidades de livro disponíveis
-        if(livro.exemplares < 1) {
-                retorno = ERRO_LIVROS_ESGOTADOS;
-                goto liberar_cabecalho_livro;
-        }
+liberar_vetores:
+        free(chaves);
+        free(posicoes);
+        fechar_arquivo_dados(arquivo);
 
-        // registrar emprestimo
-        EMPRESTIMO* auxiliar = NULL;
+        return retorno;
+}
 
-        CABECALHO* cabecalho_emprestimo = le_cabecalho(arquivo_emprestimo);
-        if(cabecalho_emprestimo == NULL){
-                retorno = ERRO_LER_CABECALHO;
-                goto liberar_cabecalho_livro;
+/*
+ * indexar_data - função interna que insere uma data de empréstimo ou de devolução no índice de datas
+ *
+ * Pós-condições:
+ *      - Se o índice não existir ou não puder ser lido, ele é reconstruído a partir da lista
+ *      (que já deve conter a data).
+ *      - Retorna SUCESSO (0) ou um código de erro negativo.
+ */
+static int indexar_data(ARQUIVO_BIBLIOTECA* emprestimos, int periodo, int data, int posicao) {
+        unsigned char chave[TAM_CHAVE_DATA];
+        montar_chave_data(periodo, data, posicao, chave);
+
+        FILE* indice = biblioteca_indice(emprestimos, EXTENSAO_INDICE_DATAS);
+        int retorno = indice != NULL ? arvore_bmais_inserir_arquivo(indice, chave, posicao) : ERRO_ABRIR_ARQUIVO;
+        if(retorno == ERRO_ABRIR_ARQUIVO || retorno == ERRO_LER_INDICE) {
+                biblioteca_fechar_indices(emprestimos);
+                retorno = reconstruir_indice_datas_emprestimo(emprestimos->caminho);
         }
 
-        EMPRESTIMO emprestimo;
-        emprestimo.codigo_livro = codigo_livro;
-        emprestimo.codigo_usuario = codigo_usuario;
-        strncpy(emprestimo.data_emprestimo, data_emprestimo, MAX_DATA);
-        emprestimo.data_emprestimo[MAX_DATA] = '\0';
-        emprestimo.data_devolucao[0] = '\0';
-        emprestimo.proximo = cabecalho_emprestimo->pos_cabeca;
+        return retorno;
+}
 
-        if(cabecalho_emprestimo->pos_livre == -1) {
-                if(escreve_no_emprestimo(arquivo_emprestimo, &emprestimo, cabecalho_emprestimo->pos_topo) != 0) {
-                        retorno = ERRO_ESCREVER_EMPRESTIMO;
-                        goto liberar_cabecalho_emprestimo;
-                }
-                cabecalho_emprestimo->pos_cabeca = cabecalho_emprestimo->pos_topo;
-                cabecalho_emprestimo->pos_topo++;
-        }
-        else {
-	        auxiliar = le_no_emprestimo(arquivo_emprestimo, cabecalho_emprestimo->pos_livre);
-	        if(auxiliar == NULL){
-	                retorno = ERRO_LER_EMPRESTIMO;
-	                goto liberar_cabecalho_emprestimo;
-	        }
-	        if(escreve_no_emprestimo(arquivo_emprestimo, &emprestimo, cabecalho_emprestimo->pos_livre) != 0) {
-	                retorno = ERRO_ESCREVER_EMPRESTIMO;
-	                goto liberar_auxiliar;
-	        }
-	        cabecalho_emprestimo->pos_cabeca = cabecalho_emprestimo->pos_livre;
-	        cabecalho_emprestimo->pos_livre = auxiliar->proximo;
-	        free(auxiliar);
-        }
-        if(escreve_cabecalho(arquivo_emprestimo, cabecalho_emprestimo) != 0) {
-                retorno = ERRO_ESCREVER_CABECALHO;
-                goto liberar_cabecalho_emprestimo;
-        }
+/*
+ * refazer_indices_emprestimos - função interna que reconstrói os índices de empréstimos depois de uma atualização que falhou
+ *
+ * Chamada depois de biblioteca_confirmar_operacao: a operação já está no diário e não é desfeita, os
+ * índices só ficaram desatualizados. Um índice que nem assim fica correto é removido, e a próxima
+ * consulta (ou a próxima inicialização da base) o reconstrói.
+ */
+static void refazer_indices_emprestimos(ARQUIVO_BIBLIOTECA* emprestimos) {
+        char caminho_indice[TAM_MAX_CAMINHO];
 
-        // decrementar quantidade do livro
-        livro.exemplares--;
-        if(fseek(arquivo_livro, sizeof(CABECALHO) + posicao_atual_livro * sizeof(LIVRO), SEEK_SET) != 0) {
-                retorno = ERRO_ARQUIVO_SEEK;
-                goto liberar_auxiliar;
+        biblioteca_fechar_indices(emprestimos);
+        if(reconstruir_indice_emprestimo(emprestimos->caminho) != SUCESSO) {
+                trocar_extensao(caminho_indice, emprestimos->caminho, ".idx");
+                remove(caminho_indice);
         }
-
-        if(fwrite(&livro, sizeof(LIVRO), 1, arquivo_livro) != 1) {
-                retorno = ERRO_ARQUIVO_WRITE;
-                goto liberar_auxiliar;
+        if(reconstruir_indice_datas_emprestimo(emprestimos->caminho) != SUCESSO) {
+                trocar_extensao(caminho_indice, emprestimos->caminho, EXTENSAO_INDICE_DATAS);
+                remove(caminho_indice);
         }
+}
 
-        // liberar recursos alocados
-liberar_auxiliar:
-        if(auxiliar != NULL) free(auxiliar);
-liberar_cabecalho_emprestimo:
-        free(cabecalho_emprestimo);
-liberar_cabecalho_livro:
-        free(cabecalho_livro);
-liberar_cabecalho_usuario:
-        free(cabecalho_usuario);
-liberar_arquivo_usuario:
-        fclose(arquivo_usuario);
-liberar_arquivo_livro:
-        fclose(arquivo_livro);
-liberar_arquivo_emprestimo:
-        fclose(arquivo_emprestimo);
+/*
+ * EMPRESTIMO_FORMATO_ANTIGO - registro de emprestimo.dat antes de VERSAO_DATAS_NUMERICAS (datas em texto)
+ *
+ * Os tamanhos são fixos: não acompanham MAX_DATA.
+ */
+typedef struct {
+        unsigned int codigo_usuario;
+        unsigned int codigo_livro;
+        char data_emprestimo[11];
+        char data_devolucao[11];
+        int proximo;
+} EMPRESTIMO_FORMATO_ANTIGO;
 
-        return retorno;
+/*
+ * converter_data_antiga - função interna que converte uma data em texto de um registro antigo
+ *
+ * Pós-condições:
+ *      - Retorna DATA_NULA para texto vazio, DATA_DESCONHECIDA para texto que não é uma data válida
+ *      ou a data em número de dias.
+ */
+static int converter_data_antiga(char* texto, size_t tamanho) {
+        // o vetor antigo pode ter sido preenchido até o fim, sem '\0'
+        texto[tamanho - 1] = '\0';
+        trim(texto);
+        if(texto[0] == '\0')
+                return DATA_NULA;
+
+        int dias;
+        return converter_data(texto, &dias) == SUCESSO ? dias : DATA_DESCONHECIDA;
 }
 
 /*
- * devolver_livro - registra devolução de livro
+ * separar_listas_emprestimos - função interna que divide a lista única de um emprestimo.dat antigo
+ * nas listas de empréstimos abertos (pos_cabeca) e devolvidos (pos_devolvidos)
  *
- * @caminho_arquivo_emprestimo - caminho completo para arquivo binário de empréstimos
- * @caminho_arquivo_livro - caminho completo para arquivo binário de livros
- * @caminho_arquivo_usuario - caminho completo para arquivo binário de usuários
- * @codigo_usuario - identificador do usuário que pegou livro emprestado
- * @codigo_livro - identificador do livro que foi emprestado
- * @data_devolucao - data que livro foi devolvido
+ * @arquivo - arquivo convertido, aberto para leitura e escrita, com os registros já no formato atual
+ * @cabecalho - cabeçalho do arquivo; pos_cabeca é a lista única na entrada
+ *
+ * A ordem relativa dos registros é mantida nas duas listas. Cada registro é lido uma vez e o
+ * encadeamento é regravado no último registro de cada lista.
  *
- * Pré-condições:
- *	- Caminhos para os arquivos devem ser válidos.
- *	- Arquivos de empréstimo e livro podem ser abertos em modo leitura e escrita.
- *	- Códigos de usuario e livro devem ser válidos.
- *	- Data da devolução deve estar no formato adequado (DD/MM/AAAA).
  * Pós-condições:
- *	- A data de devolução é registrada no nó de empréstimo
- *	- A quantidade de exemplares do livro é incrementada em 1.
- *	- Retorna SUCESSO (0) em caso de sucesso.
- *	- Retorna valores negativos em caso de erro:
- *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível abrir algum arquivo informado.
- *		- ERRO_LER_CABECALHO (-11): não foi possível ler o cabeçalho de algum arquivo informado.
- *		- ERRO_ARQUIVO_SEEK (-1): erro no posicionamento de algum arquivo (fseek).
- *		- ERRO_ARQUIVO_READ (-3): erro na leitura de algum arquivo (fread).
- *		- ERRO_ENCONTRAR_EMPRESTIMO (-20): não foi possível encontrar o empréstimo associado.
- *		- ERRO_ENCONTRAR_LIVRO (-15): não foi possível encontrar o livro informado.
+ *      - pos_cabeca e pos_devolvidos recebem o início das duas listas.
+ *      - Retorna SUCESSO (0) ou um código de erro de E/S.
  */
-int devolver_livro(
-        const char* caminho_arquivo_emprestimo, 
-        const char* caminho_arquivo_livro, 
-        const unsigned int codigo_usuario, 
-        const unsigned int codigo_livro,
-        const char* data_devolucao
-) {
-        int retorno = SUCESSO;
+static int separar_listas_emprestimos(FILE* arquivo, CABECALHO* cabecalho) {
+        int inicio[2] = { -1, -1 }, ultimo[2] = { -1, -1 };
+        int fim_lista = -1;
+        EMPRESTIMO emprestimo;
 
-        // abrir arquivos
-        FILE* arquivo_emprestimo = fopen(caminho_arquivo_emprestimo, "r+b");
-        if(!arquivo_emprestimo) {
-                retorno = ERRO_ABRIR_ARQUIVO;
-                return retorno;
+        int pos = cabecalho->pos_cabeca;
+        for(int passos = 0; pos >= 0 && pos < cabecalho->pos_topo && passos < cabecalho->pos_topo; passos++) {
+                if(fseek(arquivo, sizeof(CABECALHO) + (long)pos * sizeof(EMPRESTIMO), SEEK_SET) != 0)
+                        return ERRO_ARQUIVO_SEEK;
+                if(fread(&emprestimo, sizeof(EMPRESTIMO), 1, arquivo) != 1)
+                        return ERRO_ARQUIVO_READ;
+
+                int lista = emprestimo.data_devolucao != DATA_NULA;
+                if(ultimo[lista] == -1)
+                        inicio[lista] = pos;
+                else if(
+                        fseek(arquivo, sizeof(CABECALHO) + (long)ultimo[lista] * sizeof(EMPRESTIMO) + offsetof(EMPRESTIMO, proximo), SEEK_SET) != 0 ||
+                        fwrite(&pos, sizeof(int), 1, arquivo) != 1
+                ) {
+                        return ERRO_ARQUIVO_WRITE;
+                }
+                ultimo[lista] = pos;
+                pos = emprestimo.proximo;
         }
 
-        FILE* arquivo_livro = fopen(caminho_arquivo_livro, "r+b");
-        if(!arquivo_livro) {
-                retorno = ERRO_ABRIR_ARQUIVO;
-                goto liberar_arquivo_emprestimo;
-        }
-        
-        // abrir cabecalhos
-        CABECALHO* cabecalho_emprestimo = le_cabecalho(arquivo_emprestimo);
-        if(cabecalho_emprestimo == NULL) {
-                retorno = ERRO_LER_CABECALHO;
-                goto liberar_arquivo_livro;
+        // o último registro de cada lista passa a encerrá-la
+        for(int lista = 0; lista < 2; lista++) {
+                if(ultimo[lista] != -1 && (
+                        fseek(arquivo, sizeof(CABECALHO) + (long)ultimo[lista] * sizeof(EMPRESTIMO) + offsetof(EMPRESTIMO, proximo), SEEK_SET) != 0 ||
+                        fwrite(&fim_lista, sizeof(int), 1, arquivo) != 1
+                )) {
+                        return ERRO_ARQUIVO_WRITE;
+                }
         }
 
-        CABECALHO* cabecalho_livro = le_cabecalho(arquivo_livro);
-        if(cabecalho_livro == NULL) {
-                retorno = ERRO_LER_CABECALHO;
-                goto liberar_cabecalho_emprestimo;
-        }
+        cabecalho->pos_cabeca = inicio[0];
+        cabecalho->pos_devolvidos = inicio[1];
+        if(fseek(arquivo, 0, SEEK_SET) != 0 || fwrite(cabecalho, sizeof(CABECALHO), 1, arquivo) != 1)
+                return ERRO_ESCREVER_CABECALHO;
 
-        // procurar emprestimo utilizando id do usuario e id do livro
-        int posicao_atual_emprestimo = cabecalho_emprestimo->pos_cabeca;
-        int posicao_atual_livro = cabecalho_livro->pos_cabeca;
+        return SUCESSO;
+}
 
-        EMPRESTIMO no_emprestimo_atual;
-        LIVRO no_livro_atual;
+int converter_emprestimos_formato_antigo(const char* caminho_arquivo_emprestimo) {
+        char caminho_novo[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_novo, caminho_arquivo_emprestimo, "_conv.dat");
 
-        while(posicao_atual_emprestimo != -1) {
-                if(fseek(arquivo_emprestimo, sizeof(CABECALHO) + posicao_atual_emprestimo * sizeof(EMPRESTIMO), SEEK_SET) != 0) {
-                        retorno = ERRO_ARQUIVO_SEEK;
-                        goto liberar_cabecalho_livro;
-                }
+        // a conversão lê o arquivo por stdio: alterações ainda no cache de páginas precisam estar no arquivo
+        if(descarregar_caminho_dados(caminho_arquivo_emprestimo) != SUCESSO)
+                return ERRO_ARQUIVO_WRITE;
 
-                if(fread(&no_emprestimo_atual, sizeof(EMPRESTIMO), 1, arquivo_emprestimo) != 1) {
-                        retorno = ERRO_ARQUIVO_READ;
-                        goto liberar_cabecalho_livro;
-                }
+        FILE* antigo = fopen(caminho_arquivo_emprestimo, "rb");
+        if(antigo == NULL)
+                return ERRO_ABRIR_ARQUIVO;
 
-                if(
-                        no_emprestimo_atual.codigo_livro == codigo_livro && 
-                        no_emprestimo_atual.codigo_usuario == codigo_usuario && 
-                        no_emprestimo_atual.data_devolucao[0] == '\0'
-                ) {
-                        break;
-                }
+        int retorno = SUCESSO;
+        CABECALHO cabecalho;
+        memset(&cabecalho, 0, sizeof(CABECALHO));
+        size_t lido = fread(&cabecalho, 1, sizeof(CABECALHO), antigo);
+        long inicio = (long)tamanho_cabecalho_gravado(&cabecalho, lido);
+        int versao = inicio == (long)sizeof(CABECALHO_VERSAO_0) ? 0 : cabecalho.versao;
+        if(versao >= VERSAO_EMPRESTIMOS_LIVRO) {
+                fclose(antigo);
+                return versao > VERSAO_CABECALHO ? ERRO_VERSAO_CABECALHO : SUCESSO;
+        }
+
+        // registros antigos começam depois do cabeçalho com que foram gravados; antes de
+        // VERSAO_DATAS_NUMERICAS (inclusive sem assinatura) têm as datas em texto, e depois dela
+        // terminam antes de proximo_usuario ou, a partir de VERSAO_EMPRESTIMOS_USUARIO, de proximo_livro
+        int datas_texto = versao < VERSAO_DATAS_NUMERICAS;
+        size_t tamanho_antigo = datas_texto ? sizeof(EMPRESTIMO_FORMATO_ANTIGO) :
+                versao < VERSAO_EMPRESTIMOS_USUARIO ? offsetof(EMPRESTIMO, proximo_usuario) : offsetof(EMPRESTIMO, proximo_livro);
+        long tamanho;
+        if(lido < sizeof(CABECALHO_VERSAO_0) || cabecalho.pos_topo < 0) {
+                retorno = ERRO_LER_CABECALHO;
+                goto fechar_antigo;
+        }
+        if(fseek(antigo, 0, SEEK_END) != 0 || (tamanho = ftell(antigo)) < 0 || fseek(antigo, inicio, SEEK_SET) != 0) {
+                retorno = ERRO_ARQUIVO_SEEK;
+                goto fechar_antigo;
+        }
+        if(tamanho < inicio + (long)cabecalho.pos_topo * (long)tamanho_antigo) {
+                retorno = ERRO_ARQUIVO_READ;
+                goto fechar_antigo;
+        }
+
+        FILE* novo = fopen(caminho_novo, "w+b");
+        if(novo == NULL) {
+                retorno = ERRO_ABRIR_ARQUIVO;
+                goto fechar_antigo;
+        }
 
-                posicao_atual_emprestimo = no_emprestimo_atual.proximo;
+        unsigned char* bloco_antigo = malloc(REGISTROS_POR_BLOCO * tamanho_antigo);
+        EMPRESTIMO* bloco = malloc(REGISTROS_POR_BLOCO * sizeof(EMPRESTIMO));
+        if(bloco_antigo == NULL || bloco == NULL) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_blocos;
         }
 
-        if(posicao_atual_emprestimo == -1) {
-                retorno = ERRO_ENCONTRAR_EMPRESTIMO;
-                goto liberar_cabecalho_livro;
+        // cabeçalho atual; as listas são separadas e os contadores calculados depois que os registros
+        // forem gravados (os encadeamentos por usuário e por livro são montados por
+        // reconstruir_emprestimos_usuarios e reconstruir_emprestimos_livros)
+        if(versao < VERSAO_LISTA_DEVOLVIDOS)
+                cabecalho.pos_devolvidos = -1;
+        cabecalho.assinatura = ASSINATURA_CABECALHO;
+        cabecalho.versao = VERSAO_CABECALHO;
+        cabecalho.num_ativos = cabecalho.num_livres = 0;
+        cabecalho.emprestimos_abertos = cabecalho.exemplares_disponiveis = 0;
+        if(fwrite(&cabecalho, sizeof(CABECALHO), 1, novo) != 1) {
+                retorno = ERRO_ARQUIVO_WRITE;
+                goto liberar_blocos;
         }
 
-        // procurar livro
-        while(posicao_atual_livro != -1) {
-                if(fseek(arquivo_livro, sizeof(CABECALHO) + posicao_atual_livro * sizeof(LIVRO), SEEK_SET) != 0) {
-                        retorno = ERRO_ARQUIVO_SEEK;
-                        goto liberar_cabecalho_livro;
-                }
+        for(int base = 0; base < cabecalho.pos_topo; base += REGISTROS_POR_BLOCO) {
+                int quantidade = cabecalho.pos_topo - base;
+                if(quantidade > REGISTROS_POR_BLOCO)
+                        quantidade = REGISTROS_POR_BLOCO;
 
-                if(fread(&no_livro_atual, sizeof(LIVRO), 1, arquivo_livro) != 1) {
+                if(fread(bloco_antigo, tamanho_antigo, quantidade, antigo) != (size_t)quantidade) {
                         retorno = ERRO_ARQUIVO_READ;
-                        goto liberar_cabecalho_livro;
+                        goto liberar_blocos;
                 }
 
-                if(no_livro_atual.codigo == codigo_livro)
-                        break;
+                // posições da lista de livres também são convertidas: só o encadeamento importa nelas
+                for(int i = 0; i < quantidade; i++) {
+                        bloco[i].proximo_usuario = -1;
+                        bloco[i].proximo_livro = -1;
+                        if(!datas_texto) {
+                                memcpy(&bloco[i], bloco_antigo + (size_t)i * tamanho_antigo, tamanho_antigo);
+                                continue;
+                        }
 
-                posicao_atual_livro = no_livro_atual.prox;
-        }
-        if(posicao_atual_livro == -1) {
-                retorno = ERRO_ENCONTRAR_LIVRO;
-                goto liberar_cabecalho_livro;
-        }
-        // registrar devolução
-        strncpy(no_emprestimo_atual.data_devolucao, data_devolucao, MAX_DATA);
-        no_emprestimo_atual.data_devolucao[MAX_DATA] = '\0';
-        // incrementar quantidade do livro
-        no_livro_atual.exemplares++;
+                        EMPRESTIMO_FORMATO_ANTIGO* registro = (EMPRESTIMO_FORMATO_ANTIGO*)bloco_antigo + i;
+                        bloco[i].codigo_usuario = registro->codigo_usuario;
+                        bloco[i].codigo_livro = registro->codigo_livro;
+                        bloco[i].data_emprestimo = converter_data_antiga(registro->data_emprestimo, sizeof(registro->data_emprestimo));
+                        bloco[i].data_devolucao = converter_data_antiga(registro->data_devolucao, sizeof(registro->data_devolucao));
+                        bloco[i].proximo = registro->proximo;
+                }
 
-        // registrar no arquivo binário
-        if(fseek(arquivo_emprestimo, sizeof(CABECALHO) + posicao_atual_emprestimo * sizeof(EMPRESTIMO), SEEK_SET) != 0) {
-                retorno = ERRO_ARQUIVO_SEEK;
-                goto liberar_cabecalho_livro;
-        }
-        if(fwrite(&no_emprestimo_atual, sizeof(EMPRESTIMO), 1, arquivo_emprestimo) != 1) {
-                retorno = ERRO_ARQUIVO_WRITE;
-                goto liberar_cabecalho_livro;
+                if(fwrite(bloco, sizeof(EMPRESTIMO), quantidade, novo) != (size_t)quantidade) {
+                        retorno = ERRO_ARQUIVO_WRITE;
+                        goto liberar_blocos;
+                }
         }
 
-        if(fseek(arquivo_livro, sizeof(CABECALHO) + posicao_atual_livro * sizeof(LIVRO), SEEK_SET) != 0) {
-                retorno = ERRO_ARQUIVO_SEEK;
-                goto liberar_cabecalho_livro;
-        }
-        if(fwrite(&no_livro_atual, sizeof(LIVRO), 1, arquivo_livro) != 1) {
+        // a partir de VERSAO_LISTA_DEVOLVIDOS as duas listas já estão no cabeçalho gravado acima
+        if(versao < VERSAO_LISTA_DEVOLVIDOS)
+                retorno = separar_listas_emprestimos(novo, &cabecalho);
+        if(retorno == SUCESSO)
+                retorno = recalcular_contadores(novo, sizeof(EMPRESTIMO), offsetof(EMPRESTIMO, proximo), contabilizar_emprestimo);
+
+liberar_blocos:
+        free(bloco_antigo);
+        free(bloco);
+        if(fclose(novo) != 0 && retorno == SUCESSO)
                 retorno = ERRO_ARQUIVO_WRITE;
-                goto liberar_cabecalho_livro;
-        }
+fechar_antigo:
+        fclose(antigo);
 
-liberar_cabecalho_livro:
-        free(cabecalho_livro);
-liberar_cabecalho_emprestimo:
-        free(cabecalho_emprestimo);
-liberar_arquivo_livro:
-        fclose(arquivo_livro);
-liberar_arquivo_emprestimo:
-        fclose(arquivo_emprestimo);
+        if(retorno == SUCESSO && substituir_arquivo(caminho_novo, caminho_arquivo_emprestimo) != 0)
+                retorno = ERRO_ABRIR_ARQUIVO;
+        if(retorno != SUCESSO)
+                remove(caminho_novo);
+
+        // páginas do arquivo antigo guardadas no cache ficaram desatualizadas; o índice de datas,
+        // se existir, é de outra base e é refeito na inicialização
+        descartar_caminho_dados(caminho_arquivo_emprestimo);
+        if(retorno == SUCESSO) {
+                char caminho_indice[TAM_MAX_CAMINHO];
+                trocar_extensao(caminho_indice, caminho_arquivo_emprestimo, EXTENSAO_INDICE_DATAS);
+                remove(caminho_indice);
+        }
 
         return retorno;
 }
 
 /*
- * listar_livros_emprestados - exibe na tela informações sobre empréstimos
- *
- * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
- * @caminho_arquivo_livro - caminho completo para o arquivo binário de livros
- * @caminho_arquivo_usuario - caminho completo para o arquivo binário de usuários
+ * DONO_EMPRESTIMOS - struct interna: arquivo cujos registros iniciam listas de empréstimos
+ * (usuario.dat ou livro.dat) e campos que formam essas listas
  *
- * Pré-condições:
- *	- Arquivos informados devem ser válidos.
- *	- Arquivos informados podem ser abertos em modo leitura.
- * Pós-condições:
- *	- Será exibido na tela via printf para cada empréstimo (apenas os que não tiveram livros devolvidos):
- *		- Código do usuário.
- *		- Nome do usuário.
- *		- Código do livro.
- *		- Título do livro.
- *		- Data do empréstimo.
- *	- Caso não haja nenhum empréstimo, uma mensagem informando isso será exibida.
+ * @tamanho_registro, @deslocamento_proximo - registro do arquivo e encadeamento dos registros ativos
+ * @deslocamento_codigo - código no registro (unsigned int ou int)
+ * @deslocamento_primeiro - início da lista de empréstimos no registro
+ * @deslocamento_codigo_emprestimo - código do dono no EMPRESTIMO
+ * @deslocamento_proximo_emprestimo - encadeamento da lista no EMPRESTIMO
  */
-int listar_livros_emprestados(
-        const char* caminho_arquivo_emprestimo, 
-        const char* caminho_arquivo_livro, 
-        const char* caminho_arquivo_usuario
-) {
+typedef struct {
+        size_t tamanho_registro;
+        size_t deslocamento_proximo;
+        size_t deslocamento_codigo;
+        size_t deslocamento_primeiro;
+        size_t deslocamento_codigo_emprestimo;
+        size_t deslocamento_proximo_emprestimo;
+} DONO_EMPRESTIMOS;
+
+/*
+ * ORDEM_EMPRESTIMO - struct interna: empréstimo a encadear na lista do seu dono
+ */
+typedef struct {
+        int data;
+        int posicao;
+        int posicao_dono;
+} ORDEM_EMPRESTIMO;
+
+/*
+ * CONTEXTO_ENCADEAMENTO - struct interna repassada às varreduras de encadear_emprestimos
+ */
+typedef struct {
+        const DONO_EMPRESTIMOS* dono;
+        TABELA_HASH* donos;
+        ORDEM_EMPRESTIMO* emprestimos;
+        int quantidade;
+} CONTEXTO_ENCADEAMENTO;
+
+static int coletar_dono(const void* registro, int posicao, void* contexto) {
+        CONTEXTO_ENCADEAMENTO* encadeamento = contexto;
+        unsigned int codigo;
+        memcpy(&codigo, (const unsigned char*)registro + encadeamento->dono->deslocamento_codigo, sizeof(unsigned int));
+        return tabela_hash_inserir(encadeamento->donos, codigo, posicao);
+}
+
+static int coletar_emprestimo(const void* registro, int posicao, void* contexto) {
+        const EMPRESTIMO* emprestimo = registro;
+        CONTEXTO_ENCADEAMENTO* encadeamento = contexto;
+        ORDEM_EMPRESTIMO* item = &encadeamento->emprestimos[encadeamento->quantidade++];
+        item->data = emprestimo->data_emprestimo;
+        item->posicao = posicao;
+
+        unsigned int codigo;
+        memcpy(&codigo, (const unsigned char*)registro + encadeamento->dono->deslocamento_codigo_emprestimo, sizeof(unsigned int));
+        if(tabela_hash_buscar(encadeamento->donos, codigo, &item->posicao_dono) != SUCESSO)
+                item->posicao_dono = -1;
+        return SUCESSO;
+}
+
+/*
+ * comparar_ordem_emprestimos - função interna de comparação para qsort (data do empréstimo, depois posição)
+ */
+static int comparar_ordem_emprestimos(const void* a, const void* b) {
+        const ORDEM_EMPRESTIMO* x = a;
+        const ORDEM_EMPRESTIMO* y = b;
+        if(x->data != y->data)
+                return (x->data > y->data) - (x->data < y->data);
+        return (x->posicao > y->posicao) - (x->posicao < y->posicao);
+}
+
+/*
+ * gravar_campo_registros - função interna que regrava um campo inteiro em todas as posições de um arquivo de lista
+ *
+ * @arquivo - arquivo aberto por stdio em modo leitura/escrita
+ * @tamanho_registro - tamanho de cada registro
+ * @deslocamento_campo - deslocamento do campo dentro do registro
+ * @valores - novo valor do campo em cada posição
+ * @quantidade - quantidade de posições (pos_topo)
+ *
+ * O arquivo é lido e regravado em blocos de REGISTROS_POR_BLOCO registros.
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0), ERRO_ALOCAR_MEMORIA (-30) ou um código de erro de E/S.
+ */
+static int gravar_campo_registros(FILE* arquivo, size_t tamanho_registro, size_t deslocamento_campo, const int* valores, int quantidade) {
+        unsigned char* bloco = malloc(REGISTROS_POR_BLOCO * tamanho_registro);
+        if(bloco == NULL)
+                return ERRO_ALOCAR_MEMORIA;
+
         int retorno = SUCESSO;
-        // exibir código de usuário, nome de usuário, código de livro, título de livro, data de emprestimo (somente os nn devolvidos)
+        for(int base = 0; base < quantidade && retorno == SUCESSO; base += REGISTROS_POR_BLOCO) {
+                int tamanho_bloco = quantidade - base;
+                if(tamanho_bloco > REGISTROS_POR_BLOCO)
+                        tamanho_bloco = REGISTROS_POR_BLOCO;
 
-        // abrir arquivos
-        FILE* arquivo_emprestimo = fopen(caminho_arquivo_emprestimo, "rb");
-        if(!arquivo_emprestimo) {
-                retorno = ERRO_ABRIR_ARQUIVO;
-                return retorno;
+                long deslocamento = (long)sizeof(CABECALHO) + (long)base * (long)tamanho_registro;
+                if(fseek(arquivo, deslocamento, SEEK_SET) != 0 || fread(bloco, tamanho_registro, tamanho_bloco, arquivo) != (size_t)tamanho_bloco) {
+                        retorno = ERRO_ARQUIVO_READ;
+                        break;
+                }
+                for(int i = 0; i < tamanho_bloco; i++)
+                        memcpy(bloco + (size_t)i * tamanho_registro + deslocamento_campo, &valores[base + i], sizeof(int));
+                if(fseek(arquivo, deslocamento, SEEK_SET) != 0 || fwrite(bloco, tamanho_registro, tamanho_bloco, arquivo) != (size_t)tamanho_bloco)
+                        retorno = ERRO_ARQUIVO_WRITE;
         }
 
-        FILE* arquivo_livro = fopen(caminho_arquivo_livro, "rb");
-        if(!arquivo_livro) {
-                retorno = ERRO_ABRIR_ARQUIVO;
-                goto liberar_arquivo_emprestimo;
-        }
+        free(bloco);
+        return retorno;
+}
 
-        FILE* arquivo_usuario = fopen(caminho_arquivo_usuario, "rb");
-        if(!arquivo_usuario) {
+/*
+ * encadear_emprestimos - função interna que refaz as listas de empréstimos de cada registro de um
+ * arquivo (ver reconstruir_emprestimos_usuarios)
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ * @caminho_arquivo_dono - caminho completo para usuario.dat ou livro.dat
+ * @dono - registro e campos das listas
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou um código de erro negativo.
+ */
+static int encadear_emprestimos(const char* caminho_arquivo_emprestimo, const char* caminho_arquivo_dono, const DONO_EMPRESTIMOS* dono) {
+        // a reconstrução lê e grava por stdio: alterações ainda no cache de páginas precisam estar nos arquivos
+        if(descarregar_caminho_dados(caminho_arquivo_emprestimo) != SUCESSO || descarregar_caminho_dados(caminho_arquivo_dono) != SUCESSO)
+                return ERRO_ARQUIVO_WRITE;
+
+        int retorno = SUCESSO;
+        FILE* arquivo_dono = fopen(caminho_arquivo_dono, "r+b");
+        if(arquivo_dono == NULL)
+                return ERRO_ABRIR_ARQUIVO;
+        FILE* arquivo_emprestimo = fopen(caminho_arquivo_emprestimo, "r+b");
+        if(arquivo_emprestimo == NULL) {
                 retorno = ERRO_ABRIR_ARQUIVO;
-                goto liberar_arquivo_livro;
+                goto fechar_dono;
         }
 
-        // obter cabecalhos dos arquivos
-        CABECALHO* cabecalho_emprestimo = le_cabecalho(arquivo_emprestimo);
-        if(cabecalho_emprestimo == NULL) {
+        CABECALHO cabecalho_dono, cabecalho_emprestimo;
+        if(
+                fread(&cabecalho_dono, sizeof(CABECALHO), 1, arquivo_dono) != 1 ||
+                fread(&cabecalho_emprestimo, sizeof(CABECALHO), 1, arquivo_emprestimo) != 1
+        ) {
                 retorno = ERRO_LER_CABECALHO;
-                goto liberar_arquivo_usuario;
+                goto fechar_emprestimo;
         }
 
-        CABECALHO* cabecalho_livro = le_cabecalho(arquivo_livro);
-        if(cabecalho_livro == NULL) {
-                retorno = ERRO_LER_CABECALHO;
-                goto liberar_cabecalho_emprestimo;
+        // pos_topo é um limite superior para a quantidade de registros ativos
+        int topo_donos = cabecalho_dono.pos_topo > 0 ? cabecalho_dono.pos_topo : 1;
+        int topo_emprestimos = cabecalho_emprestimo.pos_topo > 0 ? cabecalho_emprestimo.pos_topo : 1;
+        CONTEXTO_ENCADEAMENTO encadeamento = { dono, NULL, NULL, 0 };
+        encadeamento.donos = tabela_hash_criar(cabecalho_dono.num_ativos);
+        encadeamento.emprestimos = malloc((size_t)topo_emprestimos * sizeof(ORDEM_EMPRESTIMO));
+        int* primeiros = malloc((size_t)topo_donos * sizeof(int));
+        int* proximos = malloc((size_t)topo_emprestimos * sizeof(int));
+        if(encadeamento.donos == NULL || encadeamento.emprestimos == NULL || primeiros == NULL || proximos == NULL) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_vetores;
         }
 
-        CABECALHO* cabecalho_usuario = le_cabecalho(arquivo_usuario);
-        if(cabecalho_usuario == NULL) {
-                retorno = ERRO_LER_CABECALHO;
-                goto liberar_cabecalho_livro;
+        if(
+                (retorno = varrer_registros_ativos(arquivo_dono, dono->tamanho_registro, dono->deslocamento_proximo, coletar_dono, &encadeamento)) != SUCESSO ||
+                (retorno = varrer_registros_ativos(arquivo_emprestimo, sizeof(EMPRESTIMO), offsetof(EMPRESTIMO, proximo), coletar_emprestimo, &encadeamento)) != SUCESSO
+        ) {
+                goto liberar_vetores;
         }
 
-        // percorrer nós de empréstimos, usuario e livros
-        int posicao_atual_emprestimo, posicao_original_emprestimo;
-        posicao_atual_emprestimo = posicao_original_emprestimo = cabecalho_emprestimo->pos_cabeca;
+        // do mais antigo para o mais recente: cada empréstimo passa a ser o início da lista do seu dono
+        for(int i = 0; i < topo_donos; i++)
+                primeiros[i] = -1;
+        for(int i = 0; i < topo_emprestimos; i++)
+                proximos[i] = -1;
+        qsort(encadeamento.emprestimos, (size_t)encadeamento.quantidade, sizeof(ORDEM_EMPRESTIMO), comparar_ordem_emprestimos);
+        for(int i = 0; i < encadeamento.quantidade; i++) {
+                ORDEM_EMPRESTIMO* item = &encadeamento.emprestimos[i];
+                if(item->posicao_dono < 0)
+                        continue;
+                proximos[item->posicao] = primeiros[item->posicao_dono];
+                primeiros[item->posicao_dono] = item->posicao;
+        }
 
-        int posicao_atual_livro, posicao_original_livro;
-        posicao_atual_livro = posicao_original_livro = cabecalho_livro->pos_cabeca;
+        retorno = gravar_campo_registros(arquivo_emprestimo, sizeof(EMPRESTIMO), dono->deslocamento_proximo_emprestimo, proximos, cabecalho_emprestimo.pos_topo);
+        if(retorno == SUCESSO)
+                retorno = gravar_campo_registros(arquivo_dono, dono->tamanho_registro, dono->deslocamento_primeiro, primeiros, cabecalho_dono.pos_topo);
+
+liberar_vetores:
+        tabela_hash_destruir(encadeamento.donos);
+        free(encadeamento.emprestimos);
+        free(primeiros);
+        free(proximos);
+fechar_emprestimo:
+        if(fclose(arquivo_emprestimo) != 0 && retorno == SUCESSO)
+                retorno = ERRO_ARQUIVO_WRITE;
+fechar_dono:
+        if(fclose(arquivo_dono) != 0 && retorno == SUCESSO)
+                retorno = ERRO_ARQUIVO_WRITE;
 
-        int posicao_atual_usuario, posicao_original_usuario;
-        posicao_atual_usuario = posicao_original_usuario = cabecalho_usuario->pos_cabeca;
+        // páginas desses arquivos guardadas no cache ficaram desatualizadas
+        descartar_caminho_dados(caminho_arquivo_emprestimo);
+        descartar_caminho_dados(caminho_arquivo_dono);
 
-        EMPRESTIMO no_emprestimo_atual;
-        LIVRO no_livro_atual;
-        USUARIO no_usuario_atual;
-
-        printf("Emprestimos efetuados (nao devolvidos):\n\n");
-        int existe_emprestimo = 0;
-        while(posicao_atual_emprestimo != -1) {
-                if(fseek(arquivo_emprestimo, sizeof(CABECALHO) + posicao_atual_emprestimo * sizeof(EMPRESTIMO), SEEK_SET) != 0) {
-                        retorno = ERRO_ARQUIVO_SEEK;
-                        goto liberar_cabecalho_usuario;
-                }
+        return retorno;
+}
 
-                if(fread(&no_emprestimo_atual, sizeof(EMPRESTIMO), 1, arquivo_emprestimo) != 1) {
-                        retorno = ERRO_ARQUIVO_READ;
-                        goto liberar_cabecalho_usuario;
-                }
+int reconstruir_emprestimos_usuarios(const char* caminho_arquivo_emprestimo, const char* caminho_arquivo_usuario) {
+        static const DONO_EMPRESTIMOS usuarios = {
+                sizeof(USUARIO), offsetof(USUARIO, proximo), offsetof(USUARIO, codigo), offsetof(USUARIO, primeiro_emprestimo),
+                offsetof(EMPRESTIMO, codigo_usuario), offsetof(EMPRESTIMO, proximo_usuario)
+        };
+        return encadear_emprestimos(caminho_arquivo_emprestimo, caminho_arquivo_usuario, &usuarios);
+}
 
-                // verificar se emprestimo foi devolvido (não é necessário exibir)
-                if(no_emprestimo_atual.data_devolucao[0] != '\0') {
-                        posicao_atual_emprestimo = no_emprestimo_atual.proximo;
-                        continue;
+int reconstruir_emprestimos_livros(const char* caminho_arquivo_emprestimo, const char* caminho_arquivo_livro) {
+        static const DONO_EMPRESTIMOS livros = {
+                sizeof(REGISTRO_LIVRO), offsetof(REGISTRO_LIVRO, prox), offsetof(REGISTRO_LIVRO, codigo), offsetof(REGISTRO_LIVRO, primeiro_emprestimo),
+                offsetof(EMPRESTIMO, codigo_livro), offsetof(EMPRESTIMO, proximo_livro)
+        };
+        return encadear_emprestimos(caminho_arquivo_emprestimo, caminho_arquivo_livro, &livros);
+}
+
+/*
+ * localizar_emprestimo_aberto - busca o empréstimo sem devolução de um par (usuário, livro) pelo índice emprestimo.idx
+ *
+ * @emprestimos - arquivo de empréstimos da biblioteca, que mantém o índice aberto (biblioteca_indice)
+ * @codigo_usuario - código do usuário do empréstimo
+ * @codigo_livro - código do livro do empréstimo
+ * @emprestimo - ponteiro onde o registro encontrado será armazenado
+ * @posicao - ponteiro onde a posição do registro no arquivo será armazenada
+ *
+ * Pré-condições:
+ *	- O arquivo deve estar aberto e inicializado com um cabeçalho válido.
+ * Pós-condições:
+ *	- Se o índice não existir ou estiver desatualizado, ele é reconstruído a partir da lista.
+ *	- Em caso de sucesso, *emprestimo e *posicao recebem o registro e sua posição.
+ *	- Retorna SUCESSO (0) se existir empréstimo aberto para o par informado.
+ *	- Retorna ERRO_ENCONTRAR_EMPRESTIMO (-20) caso não exista.
+ *	- Retorna outro código de erro negativo em caso de falha de leitura.
+ */
+int localizar_emprestimo_aberto(
+        ARQUIVO_BIBLIOTECA* emprestimos,
+        unsigned int codigo_usuario,
+        unsigned int codigo_livro,
+        EMPRESTIMO* emprestimo,
+        int* posicao
+) {
+        unsigned long long chave = chave_emprestimo(codigo_usuario, codigo_livro);
+
+        // segunda tentativa só acontece após reconstruir um índice ausente ou desatualizado
+        for(int tentativa = 0; tentativa < 2; tentativa++) {
+                FILE* indice = biblioteca_indice(emprestimos, ".idx");
+                int retorno = indice != NULL ? indice_hash_buscar_arquivo(indice, chave, posicao) : ERRO_ABRIR_ARQUIVO;
+                if(retorno == ERRO_ENCONTRAR_CHAVE)
+                        return ERRO_ENCONTRAR_EMPRESTIMO;
+
+                if(retorno == SUCESSO) {
+                        if((retorno = ler_registro(emprestimos->arquivo, *posicao, sizeof(EMPRESTIMO), emprestimo)) != SUCESSO)
+                                return retorno;
+                        if(
+                                emprestimo->codigo_usuario == codigo_usuario &&
+                                emprestimo->codigo_livro == codigo_livro &&
+                                emprestimo->data_devolucao == DATA_NULA
+                        ) {
+                                return SUCESSO;
+                        }
                 }
-                else {
-                        existe_emprestimo = 1;
+                else if(retorno != ERRO_ABRIR_ARQUIVO && retorno != ERRO_LER_INDICE) {
+                        return retorno;
                 }
 
-                // do contrário, necessário exibir. procurar informações sobre o usuário e o livro
-                while(posicao_atual_livro != -1) {
-                        if(fseek(arquivo_livro, sizeof(CABECALHO) + posicao_atual_livro * sizeof(LIVRO), SEEK_SET) != 0) {
-                                retorno = ERRO_ARQUIVO_SEEK;
-                                goto liberar_cabecalho_usuario;
-                        }
+                if(tentativa == 0) {
+                        biblioteca_fechar_indices(emprestimos);
+                        if((retorno = reconstruir_indice_emprestimo(emprestimos->caminho)) != SUCESSO)
+                                return retorno;
+                }
+        }
 
-                        if(fread(&no_livro_atual, sizeof(LIVRO), 1, arquivo_livro) != 1) {
-                                retorno = ERRO_ARQUIVO_READ;
-                                goto liberar_cabecalho_usuario;
-                        }
+        return ERRO_ENCONTRAR_EMPRESTIMO;
+}
 
-                        if(no_livro_atual.codigo == no_emprestimo_atual.codigo_livro)
-                                break;
+/*
+ * verificar_emprestimo_existente - verifica se o emprestimo ja foi registrado
+ *
+ * @emprestimos - arquivo de empréstimos aberto na biblioteca
+ * @codigo_usuario - código do usuario associado ao empréstimo
+ * @codigo_livro - código do livro associado ao empréstimo
+ *
+ * Pré-condições:
+ *      - O arquivo de empréstimo deve estar aberto e inicializado (conter cabeçalho);
+ *      - Os códigos do usuário e livro devem ser válidos (inteiros sem sinal).
+ * Pós-condições:
+ *      - Retorna SUCESSO caso não tenha conflito.
+ *      - Retorna valores negativos em caso de erro:
+ *              - ERRO_CONFLITO_ID: Caso seja encontrado um conflito (emprestimo sem devolução associado ao usuário e livro).
+ *              - ERRO_ARQUIVO_SEEK: Erro no posicionamento do arquivo (erro no fseek).
+ *              - ERRO_ARQUIVO_READ: Erro na leitura do arquivo (erro no fwrite).
+ */
+static int verificar_emprestimo_existente(ARQUIVO_BIBLIOTECA* emprestimos, unsigned int codigo_usuario, unsigned int codigo_livro) {
+        // consulta ao índice de empréstimos abertos, sem percorrer o histórico
+        EMPRESTIMO emprestimo;
+        int posicao;
+        int retorno = localizar_emprestimo_aberto(emprestimos, codigo_usuario, codigo_livro, &emprestimo, &posicao);
+        if(retorno == SUCESSO)
+                retorno = ERRO_CONFLITO_ID; // conflito encontrado
+        else if(retorno == ERRO_ENCONTRAR_EMPRESTIMO)
+                retorno = SUCESSO;
+
+        return retorno;
+}
+
+/*
+ * emprestar_livro - função que registra um novo empréstimo
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimo
+ * @caminho_arquivo_livro - caminho completo para o arquivo binário de livro
+ * @caminho_arquivo_usuario - caminho completo para o arquivo binário de usuário
+ * @codigo_usuario - identificador do usuário que pegou livro emprestado
+ * @codigo_livro - identificador do livro que foi emprestado
+ * @data_emprestimo - data que o livro foi emprestado, em número de dias
+ *
+ * Pré-condições:
+ *	- Caminhos para os arquivos devem ser válidos.
+ *	- Arquivos de empréstimo e livro podem ser aberto em modo leitura e escrita.
+ *	- Arquivo de usuário pode ser aberto em modo leitura.
+ *	- Códigos de usuario e livro devem ser válidos.
+ *	- Data do empréstimo em número de dias (converter_data ou obter_data_atual).
+ * Pós-condições:
+ *	- Um novo registro de empréstimo é registrado, reutilizando posições livres se existirem.
+ *	- O cabeçalho do arquivo é atualizado para refletir a nova cabeça da lista encadeada e possíveis posições livres.
+ *	- O empréstimo passa a iniciar a lista de empréstimos do usuário (USUARIO.primeiro_emprestimo).
+ *	- A quantidade de exemplares do livro é decrementada em 1.
+ *	- Retorna SUCESSO (0) em caso de sucesso na operação.
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível abrir algum arquivo informado.
+ *		- ERRO_LER_CABECALHO (-11): não foi possível ler o cabeçalho de algum arquivo informado.
+ *		- ERRO_ARQUIVO_SEEK (-1): erro no posicionamento em algum arquivo (fseek).
+ *		- ERRO_ARQUIVO_READ (-3): erro na leitura de algum arquivo (fread).
+ *		- ERRO_ENCONTRAR_USUARIO (-16): não foi possível encontrar o usuário informado.
+ *		- ERRO_ENCONTRAR_LIVRO (-15): não foi possível encontrar o livro informado.
+ *		- ERRO_LIVROS_ESGOTADOS (-17): não há unidades disponíveis para empréstimo.
+ *		- ERRO_ESCREVER_EMPRESTIMO (-18): não foi possível registrar o empréstimo na lista encadeada.
+ *		- ERRO_LER_EMPRESTIMO (-19): não foi possível ler nó de empréstimo na lista encadeada.
+ *		- ERRO_CONFLITO_ID: empréstimo já foi registrado previamente.
+ *		- ERRO_LIVROS_ESGOTADOS: não há livros disponíveis para empréstimo.
+ */
+int emprestar_livro(
+        const char* caminho_arquivo_emprestimo, 
+        const char* caminho_arquivo_livro, 
+        const char* caminho_arquivo_usuario, 
+        const unsigned int codigo_usuario, 
+        const unsigned int codigo_livro,
+        const int data_emprestimo
+) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, caminho_arquivo_livro, caminho_arquivo_usuario, caminho_arquivo_emprestimo);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_emprestar_livro(&biblioteca, codigo_usuario, codigo_livro, data_emprestimo);
+        biblioteca_fechar_arquivos(&biblioteca);
+
+        return retorno;
+}
+
+/*
+ * emprestar_livro_travado - função interna de biblioteca_emprestar_livro, com os arquivos já travados
+ */
+static int emprestar_livro_travado(
+        BIBLIOTECA* biblioteca,
+        const unsigned int codigo_usuario,
+        const unsigned int codigo_livro,
+        const int data_emprestimo
+) {
+        ARQUIVO_BIBLIOTECA* emprestimos = &biblioteca->emprestimos;
+        ARQUIVO_BIBLIOTECA* livros = &biblioteca->livros;
+        ARQUIVO_BIBLIOTECA* usuarios = &biblioteca->usuarios;
+        if(!emprestimos->arquivo || !livros->arquivo || !usuarios->arquivo)
+                return ERRO_ABRIR_ARQUIVO;
 
-                        posicao_atual_livro = no_livro_atual.prox;
+        if(verificar_emprestimo_existente(emprestimos, codigo_usuario, codigo_livro) == ERRO_CONFLITO_ID)
+                return ERRO_CONFLITO_ID;
+
+        int retorno = SUCESSO;
+
+        // procurar usuario e ver se existe (consulta à árvore B+ do arquivo de usuários)
+        int posicao_atual_usuario;
+        USUARIO usuario;
+        retorno = localizar_usuario(usuarios, codigo_usuario, &usuario, &posicao_atual_usuario);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        // procurar livro e ver se existe (consulta ao índice hash do arquivo de livros)
+        int posicao_atual_livro;
+        REGISTRO_LIVRO livro;
+        retorno = localizar_livro(livros, codigo_livro, &livro, &posicao_atual_livro);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        // verificar se há unidades de livro disponíveis
+        if(livro.exemplares < 1)
+                return ERRO_LIVROS_ESGOTADOS;
+
+        // registrar emprestimo (o cabeçalho residente só é alterado quando a gravação termina)
+        EMPRESTIMO* auxiliar = NULL;
+        CABECALHO cabecalho_emprestimo = emprestimos->cabecalho;
+
+        EMPRESTIMO emprestimo;
+        emprestimo.codigo_livro = codigo_livro;
+        emprestimo.codigo_usuario = codigo_usuario;
+        emprestimo.data_emprestimo = data_emprestimo;
+        emprestimo.data_devolucao = DATA_NULA;
+        emprestimo.proximo = cabecalho_emprestimo.pos_cabeca;
+        emprestimo.proximo_usuario = usuario.primeiro_emprestimo;
+        emprestimo.proximo_livro = livro.primeiro_emprestimo;
+
+        // nó, registros do usuário e do livro e os dois cabeçalhos formam uma operação do diário
+        biblioteca_iniciar_operacao(biblioteca);
+        if(cabecalho_emprestimo.pos_livre == -1) {
+                if(escreve_no_emprestimo(emprestimos->arquivo, &emprestimo, cabecalho_emprestimo.pos_topo) != 0) {
+                        retorno = ERRO_ESCREVER_EMPRESTIMO;
+                        goto desfazer_operacao;
                 }
+                cabecalho_emprestimo.pos_cabeca = cabecalho_emprestimo.pos_topo;
+                cabecalho_emprestimo.pos_topo++;
+        }
+        else {
+	        auxiliar = le_no_emprestimo(emprestimos->arquivo, cabecalho_emprestimo.pos_livre);
+	        if(auxiliar == NULL) {
+	                retorno = ERRO_LER_EMPRESTIMO;
+	                goto desfazer_operacao;
+	        }
+	        if(escreve_no_emprestimo(emprestimos->arquivo, &emprestimo, cabecalho_emprestimo.pos_livre) != 0) {
+	                retorno = ERRO_ESCREVER_EMPRESTIMO;
+	                goto desfazer_operacao;
+	        }
+	        cabecalho_emprestimo.pos_cabeca = cabecalho_emprestimo.pos_livre;
+	        cabecalho_emprestimo.pos_livre = auxiliar->proximo;
+	        cabecalho_emprestimo.num_livres--;
+        }
+        cabecalho_emprestimo.num_ativos++;
+        cabecalho_emprestimo.emprestimos_abertos++;
+        if(biblioteca_gravar_cabecalho(emprestimos, &cabecalho_emprestimo) != 0) {
+                retorno = ERRO_ESCREVER_CABECALHO;
+                goto desfazer_operacao;
+        }
 
-                while(posicao_atual_usuario != -1) {
-                        if(fseek(arquivo_usuario, sizeof(CABECALHO) + posicao_atual_usuario * sizeof(USUARIO), SEEK_SET) != 0) {
-                                retorno = ERRO_ARQUIVO_SEEK;
-                                goto liberar_cabecalho_usuario;
-                        }
+        // o novo empréstimo passa a iniciar a lista de empréstimos do usuário
+        usuario.primeiro_emprestimo = cabecalho_emprestimo.pos_cabeca;
+        if((retorno = escrever_registro(usuarios->arquivo, posicao_atual_usuario, sizeof(USUARIO), &usuario)) != SUCESSO)
+                goto desfazer_operacao;
 
-                        if(fread(&no_usuario_atual, sizeof(USUARIO), 1, arquivo_usuario) != 1) {
-                                retorno = ERRO_ARQUIVO_READ;
-                                goto liberar_cabecalho_usuario;
-                        }
+        // decrementar quantidade do livro (no registro e no total do cabeçalho); o empréstimo passa a iniciar a lista do livro
+        livro.exemplares--;
+        livro.primeiro_emprestimo = cabecalho_emprestimo.pos_cabeca;
+        if((retorno = escrever_registro(livros->arquivo, posicao_atual_livro, sizeof(REGISTRO_LIVRO), &livro)) != SUCESSO)
+                goto desfazer_operacao;
+        CABECALHO cabecalho_livro = livros->cabecalho;
+        cabecalho_livro.exemplares_disponiveis--;
+        if(biblioteca_gravar_cabecalho(livros, &cabecalho_livro) != SUCESSO) {
+                retorno = ERRO_ESCREVER_CABECALHO;
+                goto desfazer_operacao;
+        }
+
+        if((retorno = biblioteca_confirmar_operacao(biblioteca)) != SUCESSO)
+                goto liberar_auxiliar;
+
+        // registrar o empréstimo aberto no índice composto (reconstruído a partir da lista se estiver ausente)
+        FILE* indice = biblioteca_indice(emprestimos, ".idx");
+        retorno = indice != NULL ? indice_hash_inserir_arquivo(indice, chave_emprestimo(codigo_usuario, codigo_livro), cabecalho_emprestimo.pos_cabeca) : ERRO_ABRIR_ARQUIVO;
+        if(retorno == ERRO_ABRIR_ARQUIVO)
+                retorno = reconstruir_indice_emprestimo(emprestimos->caminho);
+        if(retorno == SUCESSO)
+                retorno = indexar_data(emprestimos, PERIODO_EMPRESTIMO, data_emprestimo, cabecalho_emprestimo.pos_cabeca);
+        if(retorno != SUCESSO)
+                refazer_indices_emprestimos(emprestimos);
+        retorno = SUCESSO;
+        goto liberar_auxiliar;
+
+desfazer_operacao:
+        biblioteca_desfazer_operacao(biblioteca);
+
+        // liberar recursos alocados
+liberar_auxiliar:
+        free(auxiliar);
+
+        return retorno;
+}
+
+int biblioteca_emprestar_livro(
+        BIBLIOTECA* biblioteca,
+        const unsigned int codigo_usuario,
+        const unsigned int codigo_livro,
+        const int data_emprestimo
+) {
+        int retorno = biblioteca_travar_escrita(biblioteca, BIBLIOTECA_TODOS);
+        if(retorno != SUCESSO)
+                return retorno;
 
-                        if(no_usuario_atual.codigo == no_emprestimo_atual.codigo_usuario)
+        retorno = emprestar_livro_travado(biblioteca, codigo_usuario, codigo_livro, data_emprestimo);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * mover_para_devolvidos - função interna que tira um empréstimo da lista de abertos e o coloca
+ * no início da lista de devolvidos
+ *
+ * @emprestimos - arquivo de empréstimos aberto na biblioteca
+ * @posicao - posição do empréstimo
+ * @emprestimo - registro do empréstimo; seu encadeamento é alterado aqui, e a gravação fica com o chamador
+ * @cabecalho - cópia do cabeçalho, com os inícios das listas atualizados aqui
+ *
+ * A lista é simplesmente encadeada: o anterior é procurado a partir de pos_cabeca, percorrendo
+ * apenas os empréstimos abertos.
+ *
+ * Pós-condições:
+ *      - O registro anterior na lista de abertos, se houver, é regravado apontando para o seguinte.
+ *      - Retorna SUCESSO (0), ERRO_ENCONTRAR_EMPRESTIMO (-20) se a posição não estiver na lista de
+ *      abertos ou um código de erro de E/S.
+ */
+static int mover_para_devolvidos(ARQUIVO_BIBLIOTECA* emprestimos, int posicao, EMPRESTIMO* emprestimo, CABECALHO* cabecalho) {
+        if(cabecalho->pos_cabeca == posicao) {
+                cabecalho->pos_cabeca = emprestimo->proximo;
+        }
+        else {
+                EMPRESTIMO anterior;
+                int pos = cabecalho->pos_cabeca;
+                int passos = 0;
+                for(; pos != -1 && passos < cabecalho->pos_topo; passos++) {
+                        int retorno = ler_registro(emprestimos->arquivo, pos, sizeof(EMPRESTIMO), &anterior);
+                        if(retorno != SUCESSO)
+                                return retorno;
+                        if(anterior.proximo == posicao)
                                 break;
+                        pos = anterior.proximo;
+                }
+                if(pos == -1 || passos == cabecalho->pos_topo)
+                        return ERRO_ENCONTRAR_EMPRESTIMO;
 
-                        posicao_atual_usuario = no_usuario_atual.proximo;
+                anterior.proximo = emprestimo->proximo;
+                int retorno = escrever_registro(emprestimos->arquivo, pos, sizeof(EMPRESTIMO), &anterior);
+                if(retorno != SUCESSO)
+                        return retorno;
+        }
+
+        emprestimo->proximo = cabecalho->pos_devolvidos;
+        cabecalho->pos_devolvidos = posicao;
+
+        return SUCESSO;
+}
+
+/*
+ * devolver_livro - registra devolução de livro
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para arquivo binário de empréstimos
+ * @caminho_arquivo_livro - caminho completo para arquivo binário de livros
+ * @caminho_arquivo_usuario - caminho completo para arquivo binário de usuários
+ * @codigo_usuario - identificador do usuário que pegou livro emprestado
+ * @codigo_livro - identificador do livro que foi emprestado
+ * @data_devolucao - data que livro foi devolvido, em número de dias
+ *
+ * Pré-condições:
+ *	- Caminhos para os arquivos devem ser válidos.
+ *	- Arquivos de empréstimo e livro podem ser abertos em modo leitura e escrita.
+ *	- Códigos de usuario e livro devem ser válidos.
+ *	- Data da devolução em número de dias (converter_data ou obter_data_atual).
+ * Pós-condições:
+ *	- A data de devolução é registrada no nó de empréstimo, que passa da lista de empréstimos
+ *	abertos para a de devolvidos.
+ *	- A quantidade de exemplares do livro é incrementada em 1.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ABRIR_ARQUIVO (-10): não foi possível abrir algum arquivo informado.
+ *		- ERRO_LER_CABECALHO (-11): não foi possível ler o cabeçalho de algum arquivo informado.
+ *		- ERRO_ARQUIVO_SEEK (-1): erro no posicionamento de algum arquivo (fseek).
+ *		- ERRO_ARQUIVO_READ (-3): erro na leitura de algum arquivo (fread).
+ *		- ERRO_ENCONTRAR_EMPRESTIMO (-20): não foi possível encontrar o empréstimo associado.
+ *		- ERRO_ENCONTRAR_LIVRO (-15): não foi possível encontrar o livro informado.
+ */
+int devolver_livro(
+        const char* caminho_arquivo_emprestimo, 
+        const char* caminho_arquivo_livro, 
+        const unsigned int codigo_usuario, 
+        const unsigned int codigo_livro,
+        const int data_devolucao
+) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, caminho_arquivo_livro, NULL, caminho_arquivo_emprestimo);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_devolver_livro(&biblioteca, codigo_usuario, codigo_livro, data_devolucao);
+        biblioteca_fechar_arquivos(&biblioteca);
+
+        return retorno;
+}
+
+/*
+ * devolver_livro_travado - função interna de biblioteca_devolver_livro, com os arquivos já travados
+ */
+static int devolver_livro_travado(
+        BIBLIOTECA* biblioteca,
+        const unsigned int codigo_usuario,
+        const unsigned int codigo_livro,
+        const int data_devolucao
+) {
+        ARQUIVO_BIBLIOTECA* emprestimos = &biblioteca->emprestimos;
+        ARQUIVO_BIBLIOTECA* livros = &biblioteca->livros;
+        if(!emprestimos->arquivo || !livros->arquivo)
+                return ERRO_ABRIR_ARQUIVO;
+
+        int retorno = SUCESSO;
+
+        // procurar emprestimo aberto pelo índice composto (usuário, livro)
+        int posicao_atual_emprestimo;
+        int posicao_atual_livro;
+
+        EMPRESTIMO no_emprestimo_atual;
+        REGISTRO_LIVRO no_livro_atual;
+
+        retorno = localizar_emprestimo_aberto(
+                emprestimos, codigo_usuario, codigo_livro,
+                &no_emprestimo_atual, &posicao_atual_emprestimo
+        );
+        if(retorno != SUCESSO)
+                return retorno;
+
+        // procurar livro (consulta ao índice hash do arquivo de livros)
+        retorno = localizar_livro(livros, codigo_livro, &no_livro_atual, &posicao_atual_livro);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        // registrar devolução e mover o empréstimo para o histórico (o cabeçalho residente só é alterado ao gravar)
+        // (todas as gravações até os cabeçalhos formam uma operação do diário)
+        CABECALHO cabecalho_emprestimo = emprestimos->cabecalho;
+        no_emprestimo_atual.data_devolucao = data_devolucao;
+        biblioteca_iniciar_operacao(biblioteca);
+        if((retorno = mover_para_devolvidos(emprestimos, posicao_atual_emprestimo, &no_emprestimo_atual, &cabecalho_emprestimo)) != SUCESSO)
+                goto desfazer_operacao;
+        // incrementar quantidade do livro
+        no_livro_atual.exemplares++;
+
+        // registrar no arquivo binário
+        if((retorno = escrever_registro(emprestimos->arquivo, posicao_atual_emprestimo, sizeof(EMPRESTIMO), &no_emprestimo_atual)) != SUCESSO)
+                goto desfazer_operacao;
+        if((retorno = escrever_registro(livros->arquivo, posicao_atual_livro, sizeof(REGISTRO_LIVRO), &no_livro_atual)) != SUCESSO)
+                goto desfazer_operacao;
+
+        // contadores: um empréstimo aberto a menos e um exemplar disponível a mais
+        CABECALHO cabecalho_livro = livros->cabecalho;
+        cabecalho_emprestimo.emprestimos_abertos--;
+        cabecalho_livro.exemplares_disponiveis++;
+        if(
+                biblioteca_gravar_cabecalho(emprestimos, &cabecalho_emprestimo) != SUCESSO ||
+                biblioteca_gravar_cabecalho(livros, &cabecalho_livro) != SUCESSO
+        ) {
+                retorno = ERRO_ESCREVER_CABECALHO;
+                goto desfazer_operacao;
+        }
+
+        if((retorno = biblioteca_confirmar_operacao(biblioteca)) != SUCESSO)
+                return retorno;
+
+        // o empréstimo deixa de estar aberto: remover do índice composto
+        FILE* indice = biblioteca_indice(emprestimos, ".idx");
+        if(indice == NULL || indice_hash_remover_arquivo(indice, chave_emprestimo(codigo_usuario, codigo_livro)) != SUCESSO) {
+                biblioteca_fechar_indices(emprestimos);
+                retorno = reconstruir_indice_emprestimo(emprestimos->caminho);
+        }
+        if(retorno == SUCESSO)
+                retorno = indexar_data(emprestimos, PERIODO_DEVOLUCAO, data_devolucao, posicao_atual_emprestimo);
+        if(retorno != SUCESSO)
+                refazer_indices_emprestimos(emprestimos);
+
+        return SUCESSO;
+
+desfazer_operacao:
+        biblioteca_desfazer_operacao(biblioteca);
+
+        return retorno;
+}
+
+int biblioteca_devolver_livro(
+        BIBLIOTECA* biblioteca,
+        const unsigned int codigo_usuario,
+        const unsigned int codigo_livro,
+        const int data_devolucao
+) {
+        int retorno = biblioteca_travar_escrita(biblioteca, BIBLIOTECA_LIVROS | BIBLIOTECA_EMPRESTIMOS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = devolver_livro_travado(biblioteca, codigo_usuario, codigo_livro, data_devolucao);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * CONTEXTO_EXIBICAO - struct interna repassada aos visitantes que exibem empréstimos
+ *
+ * @saida - onde os empréstimos são exibidos (saida da biblioteca)
+ * @encontrados - quantidade de empréstimos exibidos
+ */
+typedef struct {
+        FILE* saida;
+        int encontrados;
+} CONTEXTO_EXIBICAO;
+
+/*
+ * exibir_emprestimo_aberto - função interna que exibe uma linha produzida pela junção de empréstimos abertos
+ *
+ * @emprestimo - empréstimo aberto com os dados de usuário e livro
+ * @contexto - ponteiro para CONTEXTO_EXIBICAO
+ *
+ * Pós-condições:
+ *	- Os dados do empréstimo são exibidos em contexto->saida e o contador é incrementado.
+ *	- Retorna SUCESSO (0) para continuar a junção.
+ */
+static int exibir_emprestimo_aberto(const EMPRESTIMO_DETALHADO* emprestimo, void* contexto) {
+        CONTEXTO_EXIBICAO* exibicao = contexto;
+        exibicao->encontrados++;
+
+        fprintf(exibicao->saida, "Codigo de usuario: %d\n", emprestimo->codigo_usuario);
+        fprintf(exibicao->saida, "Nome do usuario: %s\n", emprestimo->nome_usuario);
+        fprintf(exibicao->saida, "Codigo de livro: %d\n", emprestimo->codigo_livro);
+        fprintf(exibicao->saida, "Titulo do livro: %s\n", emprestimo->titulo_livro);
+        char data[TAM_DATA_TEXTO];
+        formatar_data(emprestimo->data_emprestimo, data, sizeof(data));
+        fprintf(exibicao->saida, "Data de emprestimo: %s\n\n", data);
+
+        return SUCESSO;
+}
+
+/*
+ * exibir_livros_emprestados - função interna de listar_livros_emprestados, que exibe em saida
+ */
+static int exibir_livros_emprestados(
+        FILE* saida,
+        const char* caminho_arquivo_emprestimo,
+        const char* caminho_arquivo_livro,
+        const char* caminho_arquivo_usuario
+) {
+        // exibir código de usuário, nome de usuário, código de livro, título de livro, data de emprestimo (somente os nn devolvidos)
+        fprintf(saida, "Emprestimos efetuados (nao devolvidos):\n\n");
+
+        CONTEXTO_EXIBICAO exibicao = { saida, 0 };
+        int retorno = juntar_emprestimos_abertos(
+                caminho_arquivo_emprestimo, caminho_arquivo_livro, caminho_arquivo_usuario,
+                exibir_emprestimo_aberto, &exibicao
+        );
+
+        if(retorno == SUCESSO && exibicao.encontrados == 0)
+                fprintf(saida, "Nenhum emprestimo encontrado.\n");
+
+        return retorno;
+}
+
+/*
+ * listar_livros_emprestados - exibe na tela informações sobre empréstimos
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ * @caminho_arquivo_livro - caminho completo para o arquivo binário de livros
+ * @caminho_arquivo_usuario - caminho completo para o arquivo binário de usuários
+ *
+ * Pré-condições:
+ *	- Arquivos informados devem ser válidos.
+ *	- Arquivos informados podem ser abertos em modo leitura.
+ * Pós-condições:
+ *	- Será exibido na tela via printf para cada empréstimo (apenas os que não tiveram livros devolvidos):
+ *		- Código do usuário.
+ *		- Nome do usuário.
+ *		- Código do livro.
+ *		- Título do livro.
+ *		- Data do empréstimo.
+ *	- Caso não haja nenhum empréstimo, uma mensagem informando isso será exibida.
+ *	- Livros e usuários são lidos uma única vez por juntar_emprestimos_abertos (junção hash,
+ *	ou por ordenação externa quando as tabelas não cabem em LIMITE_MEMORIA_JUNCAO).
+ */
+int listar_livros_emprestados(
+        const char* caminho_arquivo_emprestimo, 
+        const char* caminho_arquivo_livro, 
+        const char* caminho_arquivo_usuario
+) {
+        return exibir_livros_emprestados(stdout, caminho_arquivo_emprestimo, caminho_arquivo_livro, caminho_arquivo_usuario);
+}
+
+/*
+ * listar_livros_emprestados_travado - função interna de biblioteca_listar_livros_emprestados, com os arquivos já travados
+ */
+static int listar_livros_emprestados_travado(BIBLIOTECA* biblioteca) {
+        // a junção lê os arquivos pelo caminho; as gravações da biblioteca já foram descarregadas
+        return exibir_livros_emprestados(
+                biblioteca->saida, biblioteca->emprestimos.caminho, biblioteca->livros.caminho, biblioteca->usuarios.caminho
+        );
+}
+
+int biblioteca_listar_livros_emprestados(BIBLIOTECA* biblioteca) {
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_TODOS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = listar_livros_emprestados_travado(biblioteca);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * CONTEXTO_PERIODO - função interna: estado de uma varredura do índice de datas
+ */
+typedef struct {
+        ARQUIVO_BIBLIOTECA* emprestimos;
+        int periodo;
+        visitante_registro visitar;
+        void* contexto;
+        int visitados;
+        int erro;
+} CONTEXTO_PERIODO;
+
+/*
+ * visitar_chave_data - função interna (visitante_bmais) que lê o empréstimo de uma chave do índice de datas
+ *
+ * Chaves cuja data não confere com o registro (índice desatualizado) são ignoradas.
+ */
+static int visitar_chave_data(const unsigned char* chave, int valor, void* contexto) {
+        CONTEXTO_PERIODO* busca = contexto;
+        EMPRESTIMO copia;
+        const EMPRESTIMO* emprestimo = acessar_registro(busca->emprestimos->arquivo, valor, sizeof(EMPRESTIMO), &copia);
+        if(emprestimo == NULL) {
+                busca->erro = ERRO_LER_EMPRESTIMO;
+                return 1;
+        }
+
+        int data = busca->periodo == PERIODO_EMPRESTIMO ? emprestimo->data_emprestimo : emprestimo->data_devolucao;
+        if((unsigned int)data != arvore_bmais_decodificar_inteiro(chave + 1))
+                return 0;
+
+        // o visitante pode acessar outros registros: ele recebe uma cópia
+        EMPRESTIMO registro = *emprestimo;
+        busca->visitados++;
+        busca->erro = busca->visitar(&registro, valor, busca->contexto);
+        return busca->erro != SUCESSO;
+}
+
+int percorrer_emprestimos_periodo(
+        BIBLIOTECA* biblioteca,
+        int periodo,
+        int data_inicial,
+        int data_final,
+        visitante_registro visitar,
+        void* contexto
+) {
+        ARQUIVO_BIBLIOTECA* emprestimos = &biblioteca->emprestimos;
+        if(!emprestimos->arquivo)
+                return ERRO_ABRIR_ARQUIVO;
+        if(periodo != PERIODO_EMPRESTIMO && periodo != PERIODO_DEVOLUCAO)
+                return ERRO_CAMPOS_INVALIDOS;
+        if(data_inicial < 1)
+                data_inicial = 1;
+        if(data_final < data_inicial)
+                return SUCESSO;
+
+        unsigned char chave_inicial[TAM_CHAVE_DATA], chave_final[TAM_CHAVE_DATA];
+        montar_chave_data(periodo, data_inicial, 0, chave_inicial);
+        montar_chave_data(periodo, data_final, -1, chave_final);
+
+        CONTEXTO_PERIODO busca = { emprestimos, periodo, visitar, contexto, 0, SUCESSO };
+        FILE* indice = biblioteca_indice(emprestimos, EXTENSAO_INDICE_DATAS);
+        int retorno = indice != NULL ? arvore_bmais_percorrer_intervalo_arquivo(indice, chave_inicial, chave_final, visitar_chave_data, &busca) : ERRO_ABRIR_ARQUIVO;
+
+        // índice ausente ou ilegível antes de qualquer visita: reconstruído a partir da lista
+        if((retorno == ERRO_ABRIR_ARQUIVO || retorno == ERRO_LER_INDICE) && busca.visitados == 0) {
+                biblioteca_fechar_indices(emprestimos);
+                if((retorno = reconstruir_indice_datas_emprestimo(emprestimos->caminho)) == SUCESSO) {
+                        indice = biblioteca_indice(emprestimos, EXTENSAO_INDICE_DATAS);
+                        retorno = indice != NULL ? arvore_bmais_percorrer_intervalo_arquivo(indice, chave_inicial, chave_final, visitar_chave_data, &busca) : ERRO_ABRIR_ARQUIVO;
                 }
+        }
+
+        return retorno != SUCESSO ? retorno : busca.erro;
+}
+
+/*
+ * exibir_emprestimo - função interna (visitante_registro) que exibe os códigos e as datas de um empréstimo
+ */
+static int exibir_emprestimo(const void* registro, int posicao, void* contexto) {
+        (void)posicao;
+        const EMPRESTIMO* emprestimo = registro;
+        CONTEXTO_EXIBICAO* exibicao = contexto;
+        exibicao->encontrados++;
+
+        char data_emprestimo[TAM_DATA_TEXTO], data_devolucao[TAM_DATA_TEXTO];
+        formatar_data(emprestimo->data_emprestimo, data_emprestimo, sizeof(data_emprestimo));
+        formatar_data(emprestimo->data_devolucao, data_devolucao, sizeof(data_devolucao));
+
+        fprintf(exibicao->saida, "Usuario: %u | Livro: %u | Emprestimo: %s | Devolucao: %s\n",
+                emprestimo->codigo_usuario, emprestimo->codigo_livro, data_emprestimo,
+                emprestimo->data_devolucao == DATA_NULA ? "em aberto" : data_devolucao);
+
+        return SUCESSO;
+}
+
+/*
+ * listar_emprestimos_periodo - exibe os empréstimos feitos ou devolvidos entre duas datas
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ * @periodo - PERIODO_EMPRESTIMO (data do empréstimo) ou PERIODO_DEVOLUCAO (data da devolução)
+ * @data_inicial - primeira data do período, em número de dias
+ * @data_final - última data do período, em número de dias
+ *
+ * Pré-condições:
+ *	- O arquivo deve existir e estar inicializado com cabeçalho.
+ * Pós-condições:
+ *	- Os empréstimos do período são exibidos em ordem de data.
+ *	- Caso não haja nenhum empréstimo no período, uma mensagem informando isso será exibida.
+ *	- Retorna SUCESSO (0), ERRO_CAMPOS_INVALIDOS (-24) para período desconhecido ou outro
+ *	código de erro negativo.
+ */
+int listar_emprestimos_periodo(
+        const char* caminho_arquivo_emprestimo,
+        int periodo,
+        int data_inicial,
+        int data_final
+) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, NULL, NULL, caminho_arquivo_emprestimo);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_listar_emprestimos_periodo(&biblioteca, periodo, data_inicial, data_final);
+        biblioteca_fechar_arquivos(&biblioteca);
+
+        return retorno;
+}
+
+/*
+ * listar_emprestimos_periodo_travado - função interna de biblioteca_listar_emprestimos_periodo, com os arquivos já travados
+ */
+static int listar_emprestimos_periodo_travado(BIBLIOTECA* biblioteca, int periodo, int data_inicial, int data_final) {
+        CONTEXTO_EXIBICAO exibicao = { biblioteca->saida, 0 };
+        int retorno = percorrer_emprestimos_periodo(biblioteca, periodo, data_inicial, data_final, exibir_emprestimo, &exibicao);
+
+        if(retorno == SUCESSO && exibicao.encontrados == 0)
+                fprintf(biblioteca->saida, "Nenhum emprestimo encontrado no periodo.\n");
+
+        return retorno;
+}
+
+int biblioteca_listar_emprestimos_periodo(BIBLIOTECA* biblioteca, int periodo, int data_inicial, int data_final) {
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_EMPRESTIMOS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = listar_emprestimos_periodo_travado(biblioteca, periodo, data_inicial, data_final);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * seguir_emprestimos - função interna que visita a lista de empréstimos de um usuário ou de um livro
+ *
+ * @emprestimos - arquivo de empréstimos aberto na biblioteca
+ * @inicio - primeiro_emprestimo do registro do usuário ou do livro
+ * @por_livro - 1 para seguir proximo_livro, 0 para seguir proximo_usuario
+ * @codigo - código do usuário ou do livro, conferido em cada empréstimo
+ * @visitar, @contexto - ver percorrer_emprestimos_usuario
+ *
+ * A lista é limitada a pos_topo passos para não entrar em ciclo; um registro de outro usuário
+ * (ou livro) indica lista corrompida.
+ */
+static int seguir_emprestimos(ARQUIVO_BIBLIOTECA* emprestimos, int inicio, int por_livro, unsigned int codigo, visitante_registro visitar, void* contexto) {
+        int pos = inicio;
+        for(int passos = 0; pos != -1; passos++) {
+                if(pos < 0 || pos >= emprestimos->cabecalho.pos_topo || passos == emprestimos->cabecalho.pos_topo)
+                        return ERRO_LER_EMPRESTIMO;
+
+                EMPRESTIMO emprestimo;
+                int retorno = ler_registro(emprestimos->arquivo, pos, sizeof(EMPRESTIMO), &emprestimo);
+                if(retorno != SUCESSO)
+                        return retorno;
+                if((por_livro ? emprestimo.codigo_livro : emprestimo.codigo_usuario) != codigo)
+                        return ERRO_LER_EMPRESTIMO;
+
+                if((retorno = visitar(&emprestimo, pos, contexto)) != SUCESSO)
+                        return retorno;
+                pos = por_livro ? emprestimo.proximo_livro : emprestimo.proximo_usuario;
+        }
+
+        return SUCESSO;
+}
+
+int percorrer_emprestimos_usuario(
+        BIBLIOTECA* biblioteca,
+        unsigned int codigo_usuario,
+        visitante_registro visitar,
+        void* contexto
+) {
+        ARQUIVO_BIBLIOTECA* emprestimos = &biblioteca->emprestimos;
+        ARQUIVO_BIBLIOTECA* usuarios = &biblioteca->usuarios;
+        if(!emprestimos->arquivo || !usuarios->arquivo)
+                return ERRO_ABRIR_ARQUIVO;
+
+        USUARIO usuario;
+        int posicao_usuario;
+        int retorno = localizar_usuario(usuarios, codigo_usuario, &usuario, &posicao_usuario);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        return seguir_emprestimos(emprestimos, usuario.primeiro_emprestimo, 0, codigo_usuario, visitar, contexto);
+}
+
+/*
+ * listar_emprestimos_usuario - exibe todos os empréstimos de um usuário, do último registrado ao primeiro
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ * @caminho_arquivo_usuario - caminho completo para o arquivo binário de usuários
+ * @codigo_usuario - código do usuário
+ *
+ * Pré-condições:
+ *	- Os arquivos devem existir e estar inicializados com cabeçalho.
+ * Pós-condições:
+ *	- Os empréstimos abertos e devolvidos do usuário são exibidos.
+ *	- Caso o usuário não tenha empréstimos, uma mensagem informando isso será exibida.
+ *	- Retorna SUCESSO (0), ERRO_ENCONTRAR_USUARIO (-16) ou outro código de erro negativo.
+ */
+int listar_emprestimos_usuario(
+        const char* caminho_arquivo_emprestimo,
+        const char* caminho_arquivo_usuario,
+        unsigned int codigo_usuario
+) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, NULL, caminho_arquivo_usuario, caminho_arquivo_emprestimo);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_listar_emprestimos_usuario(&biblioteca, codigo_usuario);
+        biblioteca_fechar_arquivos(&biblioteca);
+
+        return retorno;
+}
+
+/*
+ * listar_emprestimos_usuario_travado - função interna de biblioteca_listar_emprestimos_usuario, com os arquivos já travados
+ */
+static int listar_emprestimos_usuario_travado(BIBLIOTECA* biblioteca, unsigned int codigo_usuario) {
+        CONTEXTO_EXIBICAO exibicao = { biblioteca->saida, 0 };
+        int retorno = percorrer_emprestimos_usuario(biblioteca, codigo_usuario, exibir_emprestimo, &exibicao);
+
+        if(retorno == SUCESSO && exibicao.encontrados == 0)
+                fprintf(biblioteca->saida, "Nenhum emprestimo encontrado para o usuario.\n");
+
+        return retorno;
+}
+
+int biblioteca_listar_emprestimos_usuario(BIBLIOTECA* biblioteca, unsigned int codigo_usuario) {
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_USUARIOS | BIBLIOTECA_EMPRESTIMOS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = listar_emprestimos_usuario_travado(biblioteca, codigo_usuario);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+int percorrer_emprestimos_livro(
+        BIBLIOTECA* biblioteca,
+        unsigned int codigo_livro,
+        visitante_registro visitar,
+        void* contexto
+) {
+        ARQUIVO_BIBLIOTECA* emprestimos = &biblioteca->emprestimos;
+        ARQUIVO_BIBLIOTECA* livros = &biblioteca->livros;
+        if(!emprestimos->arquivo || !livros->arquivo)
+                return ERRO_ABRIR_ARQUIVO;
+
+        REGISTRO_LIVRO livro;
+        int posicao_livro;
+        int retorno = localizar_livro(livros, codigo_livro, &livro, &posicao_livro);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        return seguir_emprestimos(emprestimos, livro.primeiro_emprestimo, 1, codigo_livro, visitar, contexto);
+}
+
+/*
+ * CONTEXTO_CIRCULACAO - struct interna repassada a exibir_circulacao
+ *
+ * @devolvidos - 0 para exibir os empréstimos em aberto, 1 para os devolvidos
+ * @titulo - linha exibida antes do primeiro empréstimo do grupo
+ * @exibicao - saída e quantidade de empréstimos exibidos
+ */
+typedef struct {
+        int devolvidos;
+        const char* titulo;
+        CONTEXTO_EXIBICAO exibicao;
+} CONTEXTO_CIRCULACAO;
+
+/*
+ * exibir_circulacao - função interna (visitante_registro) que exibe os empréstimos de um dos grupos da circulação
+ */
+static int exibir_circulacao(const void* registro, int posicao, void* contexto) {
+        const EMPRESTIMO* emprestimo = registro;
+        CONTEXTO_CIRCULACAO* circulacao = contexto;
+        if((emprestimo->data_devolucao != DATA_NULA) != circulacao->devolvidos)
+                return SUCESSO;
+
+        if(circulacao->exibicao.encontrados == 0)
+                fprintf(circulacao->exibicao.saida, "%s\n", circulacao->titulo);
+        return exibir_emprestimo(registro, posicao, &circulacao->exibicao);
+}
+
+/*
+ * listar_emprestimos_livro - exibe a circulação de um livro: quem está com ele e o histórico de devoluções
+ *
+ * @caminho_arquivo_emprestimo - caminho completo para o arquivo binário de empréstimos
+ * @caminho_arquivo_livro - caminho completo para o arquivo binário de livros
+ * @codigo_livro - código do livro
+ *
+ * Pré-condições:
+ *	- Os arquivos devem existir e estar inicializados com cabeçalho.
+ * Pós-condições:
+ *	- Os empréstimos em aberto do livro são exibidos antes dos devolvidos.
+ *	- Caso o livro não tenha empréstimos, uma mensagem informando isso será exibida.
+ *	- Retorna SUCESSO (0), ERRO_ENCONTRAR_LIVRO (-15) ou outro código de erro negativo.
+ */
+int listar_emprestimos_livro(
+        const char* caminho_arquivo_emprestimo,
+        const char* caminho_arquivo_livro,
+        unsigned int codigo_livro
+) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, caminho_arquivo_livro, NULL, caminho_arquivo_emprestimo);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_listar_emprestimos_livro(&biblioteca, codigo_livro);
+        biblioteca_fechar_arquivos(&biblioteca);
+
+        return retorno;
+}
+
+/*
+ * listar_emprestimos_livro_travado - função interna de biblioteca_listar_emprestimos_livro, com os arquivos já travados
+ */
+static int listar_emprestimos_livro_travado(BIBLIOTECA* biblioteca, unsigned int codigo_livro) {
+        // a lista do livro é percorrida uma vez para cada grupo; as duas leem só os empréstimos dele
+        CONTEXTO_CIRCULACAO abertos = { 0, "Emprestado para:", { biblioteca->saida, 0 } };
+        CONTEXTO_CIRCULACAO devolvidos = { 1, "Historico de devolucoes:", { biblioteca->saida, 0 } };
+        int retorno = percorrer_emprestimos_livro(biblioteca, codigo_livro, exibir_circulacao, &abertos);
+        if(retorno == SUCESSO)
+                retorno = percorrer_emprestimos_livro(biblioteca, codigo_livro, exibir_circulacao, &devolvidos);
+
+        if(retorno == SUCESSO && abertos.exibicao.encontrados + devolvidos.exibicao.encontrados == 0)
+                fprintf(biblioteca->saida, "Nenhum emprestimo encontrado para o livro.\n");
+
+        return retorno;
+}
+
+int biblioteca_listar_emprestimos_livro(BIBLIOTECA* biblioteca, unsigned int codigo_livro) {
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_LIVROS | BIBLIOTECA_EMPRESTIMOS);
+        if(retorno != SUCESSO)
+                return retorno;
 
-                // livro e usuario relativos ao empréstimo encontrados. agora imprimir:
-                printf("Codigo de usuario: %d\n", no_usuario_atual.codigo);
-                printf("Nome do usuario: %s\n", no_usuario_atual.nome);
-                printf("Codigo de livro: %d\n", no_livro_atual.codigo);
-                printf("Titulo do livro: %s\n", no_livro_atual.titulo);
-                printf("Data de emprestimo: %s\n\n", no_emprestimo_atual.data_emprestimo);
-
-                // ir para o próximo nó do empréstimo
-                posicao_atual_emprestimo = no_emprestimo_atual.proximo;
-
-                // resetar posições dos livros e usuarios
-                posicao_atual_livro = posicao_original_livro;
-                posicao_atual_usuario = posicao_original_usuario;
-        }
-
-        if(!existe_emprestimo)
-                printf("Nenhum emprestimo encontrado.\n");
-
-liberar_cabecalho_usuario:
-        free(cabecalho_usuario);
-liberar_cabecalho_livro:
-        free(cabecalho_livro);
-liberar_cabecalho_emprestimo:
-        free(cabecalho_emprestimo);
-liberar_arquivo_usuario:
-        fclose(arquivo_usuario);
-liberar_arquivo_livro:
-        fclose(arquivo_livro);
-liberar_arquivo_emprestimo:
-        fclose(arquivo_emprestimo);
+        retorno = listar_emprestimos_livro_travado(biblioteca, codigo_livro);
+        biblioteca_destravar(biblioteca);
 
         return retorno;
 }
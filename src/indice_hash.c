@@ -0,0 +1,515 @@
+#include "../include/armazenamento.h"
+#include "../include/indice_hash.h"
+#include "../include/erros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * misturar_chave - função interna que espalha os bits da chave antes de escolher o balde
+ *
+ * @chave - chave a ser espalhada
+ *
+ * Pós-condições:
+ *      - Retorna um valor de 64 bits bem distribuído (finalizador do splitmix64), evitando que
+ *      códigos sequenciais caiam em baldes vizinhos e formem longas sequências de sondagem.
+ */
+static unsigned long long misturar_chave(unsigned long long chave) {
+        chave ^= chave >> 30;
+        chave *= 0xbf58476d1ce4e5b9ULL;
+        chave ^= chave >> 27;
+        chave *= 0x94d049bb133111ebULL;
+        chave ^= chave >> 31;
+        return chave;
+}
+
+/*
+ * le_cabecalho_indice - função interna que lê o cabeçalho do arquivo de índice
+ *
+ * @arquivo - ponteiro para arquivo de índice aberto para leitura
+ * @cabecalho - ponteiro onde o cabeçalho lido será armazenado
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) em caso de sucesso.
+ *      - Retorna ERRO_LER_INDICE (-27) em caso de falha na leitura.
+ */
+static int le_cabecalho_indice(FILE* arquivo, CABECALHO_INDICE_HASH* cabecalho) {
+        if(
+                ler_arquivo_indice(arquivo, 0, sizeof(CABECALHO_INDICE_HASH), cabecalho) != SUCESSO ||
+                cabecalho->num_baldes <= 0
+        ) {
+                return ERRO_LER_INDICE;
+        }
+        return SUCESSO;
+}
+
+/*
+ * escreve_cabecalho_indice - função interna que grava o cabeçalho do arquivo de índice
+ *
+ * @arquivo - ponteiro para arquivo de índice aberto para escrita
+ * @cabecalho - ponteiro para o cabeçalho a ser gravado
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) em caso de sucesso.
+ *      - Retorna ERRO_ESCREVER_INDICE (-28) em caso de falha na gravação.
+ */
+static int escreve_cabecalho_indice(FILE* arquivo, CABECALHO_INDICE_HASH* cabecalho) {
+        if(escrever_arquivo_indice(arquivo, 0, sizeof(CABECALHO_INDICE_HASH), cabecalho) != SUCESSO)
+                return ERRO_ESCREVER_INDICE;
+        return SUCESSO;
+}
+
+/*
+ * escreve_balde - função interna que grava um balde em sua posição na tabela
+ *
+ * @arquivo - ponteiro para arquivo de índice aberto para escrita
+ * @indice - índice do balde na tabela
+ * @balde - ponteiro para o balde a ser gravado
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) em caso de sucesso.
+ *      - Retorna ERRO_ESCREVER_INDICE (-28) em caso de falha na gravação.
+ */
+static int escreve_balde(FILE* arquivo, int indice, BALDE_INDICE_HASH* balde) {
+        long deslocamento = sizeof(CABECALHO_INDICE_HASH) + (long)indice * sizeof(BALDE_INDICE_HASH);
+        if(escrever_arquivo_indice(arquivo, deslocamento, sizeof(BALDE_INDICE_HASH), balde) != SUCESSO)
+                return ERRO_ESCREVER_INDICE;
+        return SUCESSO;
+}
+
+/*
+ * procurar_balde - função interna que percorre a sequência de sondagem de uma chave
+ *
+ * @arquivo - ponteiro para arquivo de índice aberto para leitura
+ * @cabecalho - cabeçalho do índice já lido
+ * @chave - chave procurada
+ * @balde_chave - recebe o índice do balde que contém a chave, ou -1 se não existir
+ * @balde_livre - recebe o primeiro balde reutilizável (removido ou vazio) da sequência, ou -1
+ * @balde - recebe o conteúdo do balde da chave, se encontrado
+ *
+ * Pós-condições:
+ *      - A sondagem para no primeiro balde vazio ou após percorrer todos os baldes.
+ *      - Retorna SUCESSO (0) em caso de sucesso, mesmo que a chave não exista.
+ *      - Retorna ERRO_LER_INDICE (-27) em caso de falha na leitura.
+ */
+static int procurar_balde(
+        FILE* arquivo,
+        CABECALHO_INDICE_HASH* cabecalho,
+        unsigned long long chave,
+        int* balde_chave,
+        int* balde_livre,
+        BALDE_INDICE_HASH* balde
+) {
+        int mascara = cabecalho->num_baldes - 1;
+        int indice = (int)(misturar_chave(chave) & (unsigned long long)mascara);
+        BALDE_INDICE_HASH atual;
+
+        *balde_chave = -1;
+        *balde_livre = -1;
+
+        for(int sondagens = 0; sondagens < cabecalho->num_baldes; sondagens++) {
+                long deslocamento = sizeof(CABECALHO_INDICE_HASH) + (long)indice * sizeof(BALDE_INDICE_HASH);
+                if(ler_arquivo_indice(arquivo, deslocamento, sizeof(BALDE_INDICE_HASH), &atual) != SUCESSO)
+                        return ERRO_LER_INDICE;
+
+                if(atual.estado == BALDE_VAZIO) {
+                        if(*balde_livre == -1)
+                                *balde_livre = indice;
+                        return SUCESSO;
+                }
+
+                if(atual.estado == BALDE_REMOVIDO) {
+                        if(*balde_livre == -1)
+                                *balde_livre = indice;
+                }
+                else if(atual.chave == chave) {
+                        *balde_chave = indice;
+                        *balde = atual;
+                        return SUCESSO;
+                }
+
+                // sondagem linear: ao chegar no fim da tabela, voltar ao início
+                indice = (indice + 1) & mascara;
+        }
+
+        return SUCESSO;
+}
+
+/*
+ * redimensionar_tabela - função interna que reconstrói a tabela com um novo número de baldes
+ *
+ * @arquivo - ponteiro para arquivo de índice aberto em modo leitura/escrita
+ * @cabecalho - cabeçalho do índice (atualizado pela função)
+ * @novo_num_baldes - novo número de baldes (potência de 2)
+ *
+ * Pós-condições:
+ *      - Todas as chaves válidas são redistribuídas na nova tabela e as lápides são descartadas.
+ *      - A tabela é regravada por completo com uma única escrita sequencial.
+ *      - Retorna SUCESSO (0) em caso de sucesso.
+ *      - Retorna ERRO_LER_INDICE (-27) ou ERRO_ESCREVER_INDICE (-28) em caso de falha.
+ */
+static int redimensionar_tabela(FILE* arquivo, CABECALHO_INDICE_HASH* cabecalho, int novo_num_baldes) {
+        int retorno = SUCESSO;
+        BALDE_INDICE_HASH* antigos = malloc((size_t)cabecalho->num_baldes * sizeof(BALDE_INDICE_HASH));
+        BALDE_INDICE_HASH* novos = calloc((size_t)novo_num_baldes, sizeof(BALDE_INDICE_HASH));
+        if(antigos == NULL || novos == NULL) {
+                retorno = ERRO_ESCREVER_INDICE;
+                goto liberar_tabelas;
+        }
+
+        if(ler_arquivo_indice(arquivo, sizeof(CABECALHO_INDICE_HASH), (size_t)cabecalho->num_baldes * sizeof(BALDE_INDICE_HASH), antigos) != SUCESSO) {
+                retorno = ERRO_LER_INDICE;
+                goto liberar_tabelas;
+        }
+
+        int mascara = novo_num_baldes - 1;
+        for(int i = 0; i < cabecalho->num_baldes; i++) {
+                if(antigos[i].estado != BALDE_OCUPADO)
+                        continue;
+
+                int indice = (int)(misturar_chave(antigos[i].chave) & (unsigned long long)mascara);
+                while(novos[indice].estado == BALDE_OCUPADO)
+                        indice = (indice + 1) & mascara;
+                novos[indice] = antigos[i];
+        }
+
+        cabecalho->num_baldes = novo_num_baldes;
+        cabecalho->num_removidos = 0;
+
+        if(escreve_cabecalho_indice(arquivo, cabecalho) != SUCESSO) {
+                retorno = ERRO_ESCREVER_INDICE;
+                goto liberar_tabelas;
+        }
+        if(escrever_arquivo_indice(arquivo, sizeof(CABECALHO_INDICE_HASH), (size_t)novo_num_baldes * sizeof(BALDE_INDICE_HASH), novos) != SUCESSO)
+                retorno = ERRO_ESCREVER_INDICE;
+
+liberar_tabelas:
+        free(antigos);
+        free(novos);
+
+        return retorno;
+}
+
+/*
+ * indice_hash_criar - cria (ou sobrescreve) um arquivo de índice hash vazio
+ *
+ * @caminho - caminho completo para o arquivo de índice
+ * @num_baldes - quantidade mínima de baldes (arredondada para potência de 2)
+ *
+ * Pré-condições:
+ *      - O diretório do caminho deve existir e possuir permissão de escrita.
+ * Pós-condições:
+ *      - O arquivo de índice é criado com todos os baldes vazios.
+ *      - Retorna SUCESSO (0) em caso de sucesso.
+ *      - Retorna valores negativos em caso de erro:
+ *              - ERRO_ABRIR_ARQUIVO (-10): não foi possível criar o arquivo.
+ *              - ERRO_ESCREVER_INDICE (-28): não foi possível escrever a tabela.
+ */
+int indice_hash_criar(const char* caminho, int num_baldes) {
+        CABECALHO_INDICE_HASH cabecalho;
+        cabecalho.num_baldes = NUM_BALDES_INICIAL;
+        while(cabecalho.num_baldes < num_baldes)
+                cabecalho.num_baldes *= 2;
+        cabecalho.num_ocupados = 0;
+        cabecalho.num_removidos = 0;
+
+        FILE* arquivo = fopen(caminho, "wb");
+        if(!arquivo)
+                return ERRO_ABRIR_ARQUIVO;
+
+        int retorno = SUCESSO;
+        BALDE_INDICE_HASH* baldes = calloc((size_t)cabecalho.num_baldes, sizeof(BALDE_INDICE_HASH));
+        if(
+                baldes == NULL ||
+                fwrite(&cabecalho, sizeof(CABECALHO_INDICE_HASH), 1, arquivo) != 1 ||
+                fwrite(baldes, sizeof(BALDE_INDICE_HASH), cabecalho.num_baldes, arquivo) != (size_t)cabecalho.num_baldes
+        ) {
+                retorno = ERRO_ESCREVER_INDICE;
+        }
+
+        free(baldes);
+        if(fclose(arquivo) != 0)
+                retorno = ERRO_ESCREVER_INDICE;
+
+        return retorno;
+}
+
+/*
+ * indice_hash_construir - cria um arquivo de índice hash já preenchido com um conjunto de chaves
+ *
+ * @caminho - caminho completo para o arquivo de índice
+ * @chaves - vetor com as chaves a serem indexadas
+ * @posicoes - vetor com as posições associadas a cada chave
+ * @quantidade - número de elementos dos vetores
+ *
+ * Essa função monta a tabela inteira em memória e grava o arquivo com uma única escrita
+ * sequencial, sendo bem mais rápida que chamar indice_hash_inserir para cada chave.
+ *
+ * Pré-condições:
+ *      - O diretório do caminho deve existir e possuir permissão de escrita.
+ * Pós-condições:
+ *      - O arquivo de índice é (re)criado contendo todas as chaves informadas.
+ *      - Em caso de chaves repetidas, prevalece a última posição informada.
+ *      - Retorna SUCESSO (0) em caso de sucesso.
+ *      - Retorna valores negativos em caso de erro:
+ *              - ERRO_ABRIR_ARQUIVO (-10): não foi possível criar o arquivo.
+ *              - ERRO_ESCREVER_INDICE (-28): não foi possível escrever a tabela.
+ */
+int indice_hash_construir(const char* caminho, const unsigned long long* chaves, const int* posicoes, int quantidade) {
+        CABECALHO_INDICE_HASH cabecalho;
+        cabecalho.num_baldes = NUM_BALDES_INICIAL;
+        // manter ocupação inicial abaixo de 50%, deixando folga para inserções futuras
+        while(cabecalho.num_baldes < quantidade * 2)
+                cabecalho.num_baldes *= 2;
+        cabecalho.num_ocupados = 0;
+        cabecalho.num_removidos = 0;
+
+        BALDE_INDICE_HASH* baldes = calloc((size_t)cabecalho.num_baldes, sizeof(BALDE_INDICE_HASH));
+        if(baldes == NULL)
+                return ERRO_ESCREVER_INDICE;
+
+        int mascara = cabecalho.num_baldes - 1;
+        for(int i = 0; i < quantidade; i++) {
+                int indice = (int)(misturar_chave(chaves[i]) & (unsigned long long)mascara);
+                while(baldes[indice].estado == BALDE_OCUPADO && baldes[indice].chave != chaves[i])
+                        indice = (indice + 1) & mascara;
+
+                if(baldes[indice].estado != BALDE_OCUPADO)
+                        cabecalho.num_ocupados++;
+                baldes[indice].chave = chaves[i];
+                baldes[indice].posicao = posicoes[i];
+                baldes[indice].estado = BALDE_OCUPADO;
+        }
+
+        FILE* arquivo = fopen(caminho, "wb");
+        if(!arquivo) {
+                free(baldes);
+                return ERRO_ABRIR_ARQUIVO;
+        }
+
+        int retorno = SUCESSO;
+        if(
+                fwrite(&cabecalho, sizeof(CABECALHO_INDICE_HASH), 1, arquivo) != 1 ||
+                fwrite(baldes, sizeof(BALDE_INDICE_HASH), cabecalho.num_baldes, arquivo) != (size_t)cabecalho.num_baldes
+        ) {
+                retorno = ERRO_ESCREVER_INDICE;
+        }
+
+        free(baldes);
+        if(fclose(arquivo) != 0)
+                retorno = ERRO_ESCREVER_INDICE;
+
+        return retorno;
+}
+
+/*
+ * indice_hash_buscar_arquivo - busca a posição associada a uma chave no índice
+ *
+ * @arquivo - arquivo de índice aberto para leitura
+ * @chave - chave procurada
+ * @posicao - ponteiro onde a posição encontrada será armazenada
+ *
+ * Pré-condições:
+ *      - O arquivo de índice deve ter sido criado por indice_hash_criar.
+ * Pós-condições:
+ *      - Se a chave existir, *posicao recebe a posição associada.
+ *      - Retorna SUCESSO (0) se a chave foi encontrada.
+ *      - Retorna valores negativos em caso de erro:
+ *              - ERRO_ENCONTRAR_CHAVE (-29): a chave não está no índice.
+ *              - ERRO_LER_INDICE (-27): falha na leitura do índice.
+ */
+int indice_hash_buscar_arquivo(FILE* arquivo, unsigned long long chave, int* posicao) {
+        CABECALHO_INDICE_HASH cabecalho;
+        int balde_chave, balde_livre;
+        BALDE_INDICE_HASH balde;
+
+        int retorno = le_cabecalho_indice(arquivo, &cabecalho);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = procurar_balde(arquivo, &cabecalho, chave, &balde_chave, &balde_livre, &balde);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        if(balde_chave == -1)
+                return ERRO_ENCONTRAR_CHAVE;
+
+        *posicao = balde.posicao;
+        return SUCESSO;
+}
+
+/*
+ * indice_hash_buscar - abre o índice pelo caminho e chama indice_hash_buscar_arquivo
+ */
+int indice_hash_buscar(const char* caminho, unsigned long long chave, int* posicao) {
+        FILE* arquivo = abrir_arquivo_indice(caminho, "rb");
+        if(!arquivo)
+                return ERRO_ABRIR_ARQUIVO;
+
+        int retorno = indice_hash_buscar_arquivo(arquivo, chave, posicao);
+        fechar_arquivo_indice(arquivo);
+
+        return retorno;
+}
+
+/*
+ * indice_hash_inserir_arquivo - insere (ou atualiza) uma chave no índice
+ *
+ * @arquivo - arquivo de índice aberto para leitura/escrita
+ * @chave - chave a ser inserida
+ * @posicao - posição do registro associado à chave
+ *
+ * Pré-condições:
+ *      - O arquivo de índice deve ter sido criado por indice_hash_criar.
+ * Pós-condições:
+ *      - A chave passa a apontar para a posição informada.
+ *      - Caso a ocupação ultrapasse 75% dos baldes, a tabela é reconstruída com o dobro do tamanho.
+ *      - Retorna SUCESSO (0) em caso de sucesso.
+ *      - Retorna valores negativos em caso de erro:
+ *              - ERRO_LER_INDICE (-27): falha na leitura do índice.
+ *              - ERRO_ESCREVER_INDICE (-28): falha na escrita do índice.
+ */
+int indice_hash_inserir_arquivo(FILE* arquivo, unsigned long long chave, int posicao) {
+        CABECALHO_INDICE_HASH cabecalho;
+        int balde_chave, balde_livre;
+        BALDE_INDICE_HASH balde;
+
+        int retorno = le_cabecalho_indice(arquivo, &cabecalho);
+        if(retorno != SUCESSO)
+                goto descarregar_arquivo;
+
+        // manter no máximo 75% dos baldes em uso (ocupados + lápides)
+        if((long)(cabecalho.num_ocupados + cabecalho.num_removidos + 1) * 4 > (long)cabecalho.num_baldes * 3) {
+                int novo_num_baldes = cabecalho.num_baldes;
+                if((long)(cabecalho.num_ocupados + 1) * 2 > cabecalho.num_baldes)
+                        novo_num_baldes *= 2;
+
+                retorno = redimensionar_tabela(arquivo, &cabecalho, novo_num_baldes);
+                if(retorno != SUCESSO)
+                        goto descarregar_arquivo;
+        }
+
+        retorno = procurar_balde(arquivo, &cabecalho, chave, &balde_chave, &balde_livre, &balde);
+        if(retorno != SUCESSO)
+                goto descarregar_arquivo;
+
+        if(balde_chave != -1) {
+                // chave já indexada: apenas atualizar posição
+                balde.posicao = posicao;
+                retorno = escreve_balde(arquivo, balde_chave, &balde);
+                goto descarregar_arquivo;
+        }
+
+        if(balde_livre == -1) {
+                retorno = ERRO_ESCREVER_INDICE;
+                goto descarregar_arquivo;
+        }
+
+        BALDE_INDICE_HASH anterior;
+        if(ler_arquivo_indice(arquivo, sizeof(CABECALHO_INDICE_HASH) + (long)balde_livre * sizeof(BALDE_INDICE_HASH), sizeof(BALDE_INDICE_HASH), &anterior) != SUCESSO) {
+                retorno = ERRO_LER_INDICE;
+                goto descarregar_arquivo;
+        }
+        if(anterior.estado == BALDE_REMOVIDO)
+                cabecalho.num_removidos--;
+
+        balde.chave = chave;
+        balde.posicao = posicao;
+        balde.estado = BALDE_OCUPADO;
+        cabecalho.num_ocupados++;
+
+        retorno = escreve_balde(arquivo, balde_livre, &balde);
+        if(retorno != SUCESSO)
+                goto descarregar_arquivo;
+
+        retorno = escreve_cabecalho_indice(arquivo, &cabecalho);
+
+descarregar_arquivo:
+        // o arquivo continua aberto: as páginas alteradas vão para o disco ao fim de cada inserção
+        if(descarregar_arquivo_indice(arquivo) != SUCESSO && retorno == SUCESSO)
+                retorno = ERRO_ESCREVER_INDICE;
+
+        return retorno;
+}
+
+/*
+ * indice_hash_inserir - abre o índice pelo caminho e chama indice_hash_inserir_arquivo
+ */
+int indice_hash_inserir(const char* caminho, unsigned long long chave, int posicao) {
+        FILE* arquivo = abrir_arquivo_indice(caminho, "r+b");
+        if(!arquivo)
+                return ERRO_ABRIR_ARQUIVO;
+
+        int retorno = indice_hash_inserir_arquivo(arquivo, chave, posicao);
+        if(fechar_arquivo_indice(arquivo) != 0 && retorno == SUCESSO)
+                retorno = ERRO_ESCREVER_INDICE;
+
+        return retorno;
+}
+
+/*
+ * indice_hash_remover_arquivo - remove uma chave do índice
+ *
+ * @arquivo - arquivo de índice aberto para leitura/escrita
+ * @chave - chave a ser removida
+ *
+ * Pré-condições:
+ *      - O arquivo de índice deve ter sido criado por indice_hash_criar.
+ * Pós-condições:
+ *      - O balde da chave é marcado como removido.
+ *      - Retorna SUCESSO (0) em caso de sucesso.
+ *      - Retorna valores negativos em caso de erro:
+ *              - ERRO_ENCONTRAR_CHAVE (-29): a chave não está no índice.
+ *              - ERRO_LER_INDICE (-27): falha na leitura do índice.
+ *              - ERRO_ESCREVER_INDICE (-28): falha na escrita do índice.
+ */
+int indice_hash_remover_arquivo(FILE* arquivo, unsigned long long chave) {
+        CABECALHO_INDICE_HASH cabecalho;
+        int balde_chave, balde_livre;
+        BALDE_INDICE_HASH balde;
+
+        int retorno = le_cabecalho_indice(arquivo, &cabecalho);
+        if(retorno != SUCESSO)
+                goto descarregar_arquivo;
+
+        retorno = procurar_balde(arquivo, &cabecalho, chave, &balde_chave, &balde_livre, &balde);
+        if(retorno != SUCESSO)
+                goto descarregar_arquivo;
+
+        if(balde_chave == -1) {
+                retorno = ERRO_ENCONTRAR_CHAVE;
+                goto descarregar_arquivo;
+        }
+
+        balde.estado = BALDE_REMOVIDO;
+        cabecalho.num_ocupados--;
+        cabecalho.num_removidos++;
+
+        retorno = escreve_balde(arquivo, balde_chave, &balde);
+        if(retorno != SUCESSO)
+                goto descarregar_arquivo;
+
+        retorno = escreve_cabecalho_indice(arquivo, &cabecalho);
+
+descarregar_arquivo:
+        if(descarregar_arquivo_indice(arquivo) != SUCESSO && retorno == SUCESSO)
+                retorno = ERRO_ESCREVER_INDICE;
+
+        return retorno;
+}
+
+/*
+ * indice_hash_remover - abre o índice pelo caminho e chama indice_hash_remover_arquivo
+ */
+int indice_hash_remover(const char* caminho, unsigned long long chave) {
+        FILE* arquivo = abrir_arquivo_indice(caminho, "r+b");
+        if(!arquivo)
+                return ERRO_ABRIR_ARQUIVO;
+
+        int retorno = indice_hash_remover_arquivo(arquivo, chave);
+        if(fechar_arquivo_indice(arquivo) != 0 && retorno == SUCESSO)
+                retorno = ERRO_ESCREVER_INDICE;
+
+        return retorno;
+}
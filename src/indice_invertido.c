@@ -0,0 +1,442 @@
+#include "../include/indice_invertido.h"
+#include "../include/armazenamento.h"
+#include "../include/arvore_bmais.h"
+#include "../include/utils.h"
+#include "../include/erros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// maior quantidade de bytes de uma diferença codificada (32 bits, 7 por byte)
+#define TAM_MAX_DIFERENCA 5
+
+/*
+ * codificar_diferenca - função interna que grava um inteiro sem sinal com 7 bits por byte
+ *
+ * @valor - valor a ser codificado
+ * @destino - buffer com pelo menos TAM_MAX_DIFERENCA bytes
+ *
+ * O bit mais alto de cada byte indica que o valor continua no byte seguinte; diferenças
+ * pequenas (posições próximas) ocupam um único byte.
+ *
+ * Pós-condições:
+ *      - Retorna a quantidade de bytes gravados.
+ */
+static int codificar_diferenca(unsigned int valor, unsigned char* destino) {
+        int tamanho = 0;
+        while(valor >= 0x80) {
+                destino[tamanho++] = (unsigned char)(valor | 0x80);
+                valor >>= 7;
+        }
+        destino[tamanho++] = (unsigned char)valor;
+        return tamanho;
+}
+
+/*
+ * decodificar_lista - função interna que converte as diferenças de uma lista em posições
+ *
+ * @bytes - diferenças gravadas por codificar_diferenca
+ * @usados - quantidade de bytes das diferenças
+ * @posicoes - vetor que recebe as posições (capacidade para a quantidade da lista)
+ * @quantidade - quantidade de posições esperada
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou ERRO_LER_INDICE (-27) se as diferenças não formarem a lista esperada.
+ */
+static int decodificar_lista(const unsigned char* bytes, int usados, int* posicoes, int quantidade) {
+        int anterior = -1;
+        int lidos = 0;
+        for(int i = 0; i < quantidade; i++) {
+                unsigned int valor = 0;
+                int deslocamento = 0;
+                do {
+                        if(lidos >= usados || deslocamento > 28)
+                                return ERRO_LER_INDICE;
+                        valor |= (unsigned int)(bytes[lidos] & 0x7F) << deslocamento;
+                        deslocamento += 7;
+                } while(bytes[lidos++] & 0x80);
+
+                anterior += (int)valor;
+                posicoes[i] = anterior;
+        }
+
+        return lidos == usados ? SUCESSO : ERRO_LER_INDICE;
+}
+
+/*
+ * codificar_lista - função interna que converte posições crescentes em diferenças
+ *
+ * @posicoes - posições em ordem crescente e sem repetições
+ * @quantidade - quantidade de posições
+ * @bytes - buffer com pelo menos quantidade * TAM_MAX_DIFERENCA bytes
+ *
+ * Pós-condições:
+ *      - Retorna a quantidade de bytes gravados.
+ */
+static int codificar_lista(const int* posicoes, int quantidade, unsigned char* bytes) {
+        int usados = 0;
+        int anterior = -1;
+        for(int i = 0; i < quantidade; i++) {
+                usados += codificar_diferenca((unsigned int)(posicoes[i] - anterior), bytes + usados);
+                anterior = posicoes[i];
+        }
+        return usados;
+}
+
+/*
+ * le_lista - função interna que lê o cabeçalho e as diferenças de uma lista
+ *
+ * @listas - arquivo de listas aberto para leitura
+ * @deslocamento - início da lista no arquivo
+ * @cabecalho - ponteiro onde o cabeçalho da lista é armazenado
+ * @bytes - ponteiro que recebe as diferenças (alocadas com malloc; o chamador libera)
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0), ERRO_LER_INDICE (-27) ou ERRO_ALOCAR_MEMORIA (-30).
+ */
+static int le_lista(FILE* listas, long deslocamento, CABECALHO_LISTA_POSICOES* cabecalho, unsigned char** bytes) {
+        *bytes = NULL;
+        if(
+                ler_arquivo_indice(listas, deslocamento, sizeof(CABECALHO_LISTA_POSICOES), cabecalho) != SUCESSO ||
+                cabecalho->usados < 0 || cabecalho->usados > cabecalho->capacidade || cabecalho->quantidade < 0
+        ) {
+                return ERRO_LER_INDICE;
+        }
+
+        // uma posição a mais por lista: o chamador pode acrescentar uma diferença sem realocar
+        *bytes = malloc((size_t)cabecalho->usados + TAM_MAX_DIFERENCA);
+        if(*bytes == NULL)
+                return ERRO_ALOCAR_MEMORIA;
+        long inicio_bytes = deslocamento + (long)sizeof(CABECALHO_LISTA_POSICOES);
+        if(cabecalho->usados > 0 && ler_arquivo_indice(listas, inicio_bytes, (size_t)cabecalho->usados, *bytes) != SUCESSO) {
+                free(*bytes);
+                *bytes = NULL;
+                return ERRO_LER_INDICE;
+        }
+
+        return SUCESSO;
+}
+
+/*
+ * anexar_lista - função interna que grava uma lista numa extensão nova, no fim do arquivo de listas
+ *
+ * @listas - arquivo de listas aberto para escrita
+ * @cabecalho - cabeçalho da lista (capacidade já definida, maior ou igual a usados)
+ * @bytes - diferenças da lista
+ * @deslocamento - ponteiro que recebe o início da extensão
+ *
+ * A extensão inteira é gravada de uma vez (com zeros depois das diferenças), de forma que a
+ * próxima lista anexada comece depois da capacidade reservada.
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0), ERRO_ESCREVER_INDICE (-28) ou ERRO_ALOCAR_MEMORIA (-30).
+ */
+static int anexar_lista(FILE* listas, const CABECALHO_LISTA_POSICOES* cabecalho, const unsigned char* bytes, int* deslocamento) {
+        long fim = tamanho_arquivo_indice(listas);
+        if(fim < 0)
+                return ERRO_ESCREVER_INDICE;
+
+        size_t tamanho = sizeof(CABECALHO_LISTA_POSICOES) + (size_t)cabecalho->capacidade;
+        unsigned char* extensao = calloc(1, tamanho);
+        if(extensao == NULL)
+                return ERRO_ALOCAR_MEMORIA;
+        memcpy(extensao, cabecalho, sizeof(CABECALHO_LISTA_POSICOES));
+        memcpy(extensao + sizeof(CABECALHO_LISTA_POSICOES), bytes, (size_t)cabecalho->usados);
+
+        int retorno = escrever_arquivo_indice(listas, fim, tamanho, extensao) == SUCESSO ? SUCESSO : ERRO_ESCREVER_INDICE;
+        free(extensao);
+
+        if(retorno == SUCESSO)
+                *deslocamento = (int)fim;
+        return retorno;
+}
+
+int indice_invertido_construir(const char* caminho, int tamanho_termo, const unsigned char* termos, const int* posicoes, int quantidade) {
+        int retorno = SUCESSO;
+        char caminho_listas[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_listas, caminho, EXTENSAO_LISTAS_INVERTIDO);
+
+        FILE* listas = fopen(caminho_listas, "wb");
+        if(listas == NULL)
+                return ERRO_ABRIR_ARQUIVO;
+
+        // um termo e uma extensão por par, no pior caso
+        int capacidade = quantidade > 0 ? quantidade : 1;
+        unsigned char* chaves = malloc((size_t)capacidade * (size_t)tamanho_termo);
+        int* deslocamentos = malloc((size_t)capacidade * sizeof(int));
+        int* lista = malloc((size_t)capacidade * sizeof(int));
+        unsigned char* bytes = malloc((size_t)capacidade * TAM_MAX_DIFERENCA);
+        if(chaves == NULL || deslocamentos == NULL || lista == NULL || bytes == NULL) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_vetores;
+        }
+
+        int num_termos = 0;
+        int inicio = 0;
+        while(inicio < quantidade) {
+                const unsigned char* termo = termos + (size_t)inicio * tamanho_termo;
+
+                // posições do mesmo termo, já em ordem; repetidas são descartadas
+                int tamanho_lista = 0;
+                int fim = inicio;
+                while(fim < quantidade && memcmp(termos + (size_t)fim * tamanho_termo, termo, (size_t)tamanho_termo) == 0) {
+                        if(tamanho_lista == 0 || posicoes[fim] != lista[tamanho_lista - 1])
+                                lista[tamanho_lista++] = posicoes[fim];
+                        fim++;
+                }
+
+                CABECALHO_LISTA_POSICOES cabecalho;
+                cabecalho.usados = codificar_lista(lista, tamanho_lista, bytes);
+                cabecalho.capacidade = cabecalho.usados + cabecalho.usados / 4;
+                if(cabecalho.capacidade < CAPACIDADE_MINIMA_LISTA)
+                        cabecalho.capacidade = CAPACIDADE_MINIMA_LISTA;
+                cabecalho.quantidade = tamanho_lista;
+                cabecalho.ultima = lista[tamanho_lista - 1];
+
+                if((retorno = anexar_lista(listas, &cabecalho, bytes, &deslocamentos[num_termos])) != SUCESSO)
+                        goto liberar_vetores;
+                memcpy(chaves + (size_t)num_termos * tamanho_termo, termo, (size_t)tamanho_termo);
+                num_termos++;
+
+                inicio = fim;
+        }
+
+        // as listas chegam ao disco antes do dicionário que aponta para elas
+        if(fclose(listas) != 0) {
+                listas = NULL;
+                retorno = ERRO_ESCREVER_INDICE;
+                goto liberar_vetores;
+        }
+        listas = NULL;
+
+        retorno = arvore_bmais_construir(caminho, tamanho_termo, chaves, deslocamentos, num_termos);
+
+liberar_vetores:
+        if(listas != NULL)
+                fclose(listas);
+        free(chaves);
+        free(deslocamentos);
+        free(lista);
+        free(bytes);
+
+        return retorno;
+}
+
+/*
+ * regravar_lista - função interna que insere uma posição fora de ordem e regrava a lista
+ *
+ * @dicionario - dicionário aberto para leitura e escrita
+ * @listas - arquivo de listas aberto para leitura e escrita
+ * @termo - termo da lista
+ * @deslocamento - início atual da lista
+ * @cabecalho - cabeçalho atual da lista
+ * @bytes - diferenças atuais da lista
+ * @posicao - posição a ser inserida
+ *
+ * Pós-condições:
+ *      - A lista é regravada no lugar, se couber, ou numa extensão nova (com o dicionário atualizado).
+ *      - Retorna SUCESSO (0) ou um código de erro negativo.
+ */
+static int regravar_lista(
+        FILE* dicionario,
+        FILE* listas,
+        const unsigned char* termo,
+        int deslocamento,
+        CABECALHO_LISTA_POSICOES* cabecalho,
+        const unsigned char* bytes,
+        int posicao
+) {
+        int retorno = SUCESSO;
+        int* lista = malloc(((size_t)cabecalho->quantidade + 1) * sizeof(int));
+        unsigned char* novos = malloc(((size_t)cabecalho->quantidade + 1) * TAM_MAX_DIFERENCA);
+        if(lista == NULL || novos == NULL) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_vetores;
+        }
+
+        if((retorno = decodificar_lista(bytes, cabecalho->usados, lista, cabecalho->quantidade)) != SUCESSO)
+                goto liberar_vetores;
+
+        int i = cabecalho->quantidade;
+        while(i > 0 && lista[i - 1] > posicao)
+                i--;
+        if(i > 0 && lista[i - 1] == posicao)
+                goto liberar_vetores;
+
+        memmove(lista + i + 1, lista + i, (size_t)(cabecalho->quantidade - i) * sizeof(int));
+        lista[i] = posicao;
+        cabecalho->quantidade++;
+        cabecalho->usados = codificar_lista(lista, cabecalho->quantidade, novos);
+
+        if(cabecalho->usados <= cabecalho->capacidade) {
+                if(
+                        escrever_arquivo_indice(listas, deslocamento, sizeof(CABECALHO_LISTA_POSICOES), cabecalho) != SUCESSO ||
+                        escrever_arquivo_indice(listas, deslocamento + (long)sizeof(CABECALHO_LISTA_POSICOES), (size_t)cabecalho->usados, novos) != SUCESSO
+                ) {
+                        retorno = ERRO_ESCREVER_INDICE;
+                }
+                goto liberar_vetores;
+        }
+
+        cabecalho->capacidade *= 2;
+        if(cabecalho->capacidade < cabecalho->usados)
+                cabecalho->capacidade = cabecalho->usados;
+        if(
+                (retorno = anexar_lista(listas, cabecalho, novos, &deslocamento)) == SUCESSO &&
+                descarregar_arquivo_indice(listas) != SUCESSO
+        ) {
+                retorno = ERRO_ESCREVER_INDICE;
+        }
+        if(retorno == SUCESSO)
+                retorno = arvore_bmais_inserir_arquivo(dicionario, termo, deslocamento);
+
+liberar_vetores:
+        free(lista);
+        free(novos);
+
+        return retorno;
+}
+
+int indice_invertido_inserir_arquivo(FILE* dicionario, FILE* listas, const unsigned char* termo, int posicao) {
+        CABECALHO_LISTA_POSICOES cabecalho;
+        unsigned char* bytes = NULL;
+        unsigned char diferenca[TAM_MAX_DIFERENCA];
+        int deslocamento;
+        int retorno = arvore_bmais_buscar_arquivo(dicionario, termo, &deslocamento);
+
+        if(retorno == ERRO_ENCONTRAR_CHAVE) {
+                // termo novo: lista com uma posição numa extensão mínima
+                cabecalho.usados = codificar_diferenca((unsigned int)(posicao + 1), diferenca);
+                cabecalho.capacidade = CAPACIDADE_MINIMA_LISTA;
+                cabecalho.quantidade = 1;
+                cabecalho.ultima = posicao;
+                if(
+                        (retorno = anexar_lista(listas, &cabecalho, diferenca, &deslocamento)) == SUCESSO &&
+                        descarregar_arquivo_indice(listas) != SUCESSO
+                ) {
+                        retorno = ERRO_ESCREVER_INDICE;
+                }
+                if(retorno == SUCESSO)
+                        retorno = arvore_bmais_inserir_arquivo(dicionario, termo, deslocamento);
+                goto descarregar_listas;
+        }
+        if(retorno != SUCESSO)
+                goto descarregar_listas;
+
+        if((retorno = le_lista(listas, deslocamento, &cabecalho, &bytes)) != SUCESSO)
+                goto descarregar_listas;
+
+        if(posicao <= cabecalho.ultima) {
+                retorno = regravar_lista(dicionario, listas, termo, deslocamento, &cabecalho, bytes, posicao);
+                goto descarregar_listas;
+        }
+
+        // caso comum: posição maior que todas as da lista, acrescentada ao fim
+        int tamanho = codificar_diferenca((unsigned int)(posicao - cabecalho.ultima), diferenca);
+        cabecalho.quantidade++;
+        cabecalho.ultima = posicao;
+
+        if(cabecalho.usados + tamanho <= cabecalho.capacidade) {
+                long fim_lista = deslocamento + (long)sizeof(CABECALHO_LISTA_POSICOES) + cabecalho.usados;
+                cabecalho.usados += tamanho;
+                if(
+                        escrever_arquivo_indice(listas, fim_lista, (size_t)tamanho, diferenca) != SUCESSO ||
+                        escrever_arquivo_indice(listas, deslocamento, sizeof(CABECALHO_LISTA_POSICOES), &cabecalho) != SUCESSO
+                ) {
+                        retorno = ERRO_ESCREVER_INDICE;
+                }
+                goto descarregar_listas;
+        }
+
+        // extensão cheia: a lista é copiada para o fim do arquivo com o dobro da capacidade
+        memcpy(bytes + cabecalho.usados, diferenca, (size_t)tamanho);
+        cabecalho.usados += tamanho;
+        cabecalho.capacidade *= 2;
+        if(cabecalho.capacidade < cabecalho.usados)
+                cabecalho.capacidade = cabecalho.usados;
+        if(
+                (retorno = anexar_lista(listas, &cabecalho, bytes, &deslocamento)) == SUCESSO &&
+                descarregar_arquivo_indice(listas) != SUCESSO
+        ) {
+                retorno = ERRO_ESCREVER_INDICE;
+        }
+        if(retorno == SUCESSO)
+                retorno = arvore_bmais_inserir_arquivo(dicionario, termo, deslocamento);
+
+descarregar_listas:
+        free(bytes);
+        if(descarregar_arquivo_indice(listas) != SUCESSO && retorno == SUCESSO)
+                retorno = ERRO_ESCREVER_INDICE;
+
+        return retorno;
+}
+
+int indice_invertido_inserir(const char* caminho, const unsigned char* termo, int posicao) {
+        char caminho_listas[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_listas, caminho, EXTENSAO_LISTAS_INVERTIDO);
+
+        FILE* listas = abrir_arquivo_indice(caminho_listas, "r+b");
+        FILE* dicionario = listas != NULL ? abrir_arquivo_indice(caminho, "r+b") : NULL;
+        int retorno = dicionario != NULL ? indice_invertido_inserir_arquivo(dicionario, listas, termo, posicao) : ERRO_ABRIR_ARQUIVO;
+
+        if(fechar_arquivo_indice(dicionario) != 0 && retorno == SUCESSO)
+                retorno = ERRO_ESCREVER_INDICE;
+        if(fechar_arquivo_indice(listas) != 0 && retorno == SUCESSO)
+                retorno = ERRO_ESCREVER_INDICE;
+
+        return retorno;
+}
+
+int indice_invertido_percorrer_arquivo(FILE* dicionario, FILE* listas, const unsigned char* termo, visitante_posicao visitar, void* contexto) {
+        CABECALHO_LISTA_POSICOES cabecalho;
+        unsigned char* bytes = NULL;
+        int* lista = NULL;
+        int deslocamento;
+        int retorno = arvore_bmais_buscar_arquivo(dicionario, termo, &deslocamento);
+        if(retorno == ERRO_ENCONTRAR_CHAVE)
+                return SUCESSO;
+        if(retorno != SUCESSO || (retorno = le_lista(listas, deslocamento, &cabecalho, &bytes)) != SUCESSO)
+                goto liberar_vetores;
+
+        lista = malloc(((size_t)cabecalho.quantidade + 1) * sizeof(int));
+        if(lista == NULL) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_vetores;
+        }
+        if((retorno = decodificar_lista(bytes, cabecalho.usados, lista, cabecalho.quantidade)) != SUCESSO)
+                goto liberar_vetores;
+
+        for(int i = 0; i < cabecalho.quantidade; i++) {
+                if(visitar(lista[i], contexto) != 0)
+                        break;
+        }
+
+liberar_vetores:
+        free(bytes);
+        free(lista);
+
+        return retorno;
+}
+
+int indice_invertido_percorrer(const char* caminho, const unsigned char* termo, visitante_posicao visitar, void* contexto) {
+        char caminho_listas[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_listas, caminho, EXTENSAO_LISTAS_INVERTIDO);
+
+        // o arquivo de listas é aberto antes da busca para que sua falta seja percebida mesmo sem o termo
+        FILE* listas = abrir_arquivo_indice(caminho_listas, "rb");
+        FILE* dicionario = listas != NULL ? abrir_arquivo_indice(caminho, "rb") : NULL;
+        int retorno = dicionario != NULL ? indice_invertido_percorrer_arquivo(dicionario, listas, termo, visitar, contexto) : ERRO_ABRIR_ARQUIVO;
+
+        fechar_arquivo_indice(dicionario);
+        fechar_arquivo_indice(listas);
+
+        return retorno;
+}
+
+void indice_invertido_apagar(const char* caminho) {
+        char caminho_listas[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_listas, caminho, EXTENSAO_LISTAS_INVERTIDO);
+        remove(caminho);
+        remove(caminho_listas);
+}
@@ -0,0 +1,787 @@
+#include "../include/juncao.h"
+#include "../include/arquivo.h"
+#include "../include/armazenamento.h"
+#include "../include/tabela_hash.h"
+#include "../include/textos.h"
+#include "../include/utils.h"
+#include "../include/erros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// sobrecusto estimado da tabela hash por chave (vetores com ocupação entre 25% e 50%)
+#define CUSTO_TABELA_POR_CHAVE 52
+
+/*
+ * DICIONARIO_JUNCAO - tabela código -> texto usada na junção hash
+ *
+ * @posicoes - tabela hash que associa o código ao índice do texto
+ * @textos - vetor contínuo com quantidade * tamanho_texto bytes
+ * @tamanho_texto - tamanho de cada texto (incluindo o '\0')
+ * @quantidade - número de textos armazenados
+ * @capacidade - número de textos que cabem no vetor
+ */
+typedef struct {
+        TABELA_HASH* posicoes;
+        char* textos;
+        size_t tamanho_texto;
+        int quantidade;
+        int capacidade;
+} DICIONARIO_JUNCAO;
+
+/*
+ * REGISTRO_JUNCAO - empréstimo em trânsito pelos arquivos temporários da junção por ordenação
+ *
+ * @sequencia - posição do empréstimo na lista original (restaura a ordem de exibição)
+ * @detalhe - empréstimo com os campos já preenchidos até o momento
+ */
+typedef struct {
+        int sequencia;
+        EMPRESTIMO_DETALHADO detalhe;
+} REGISTRO_JUNCAO;
+
+/*
+ * PAR_CODIGO_TEXTO - código de livro/usuário e respectivo título/nome, usado na junção por ordenação
+ */
+typedef struct {
+        unsigned int codigo;
+        char texto[MAX_TITULO + 1];
+} PAR_CODIGO_TEXTO;
+
+/*
+ * le_cabecalho_arquivo - função interna que lê o cabeçalho de um arquivo de lista para uma variável local
+ *
+ * @arquivo - arquivo de lista aberto para leitura
+ * @cabecalho - ponteiro onde o cabeçalho será armazenado
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou ERRO_LER_CABECALHO (-11).
+ */
+static int le_cabecalho_arquivo(FILE* arquivo, CABECALHO* cabecalho) {
+        if(fseek(arquivo, 0, SEEK_SET) != 0 || fread(cabecalho, sizeof(CABECALHO), 1, arquivo) != 1)
+                return ERRO_LER_CABECALHO;
+        return SUCESSO;
+}
+
+/*
+ * abrir_textos_livro - função interna que abre para leitura a área de textos do arquivo de livros
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou os erros de textos_abrir.
+ */
+static int abrir_textos_livro(AREA_TEXTOS* textos, const char* caminho_arquivo_livro) {
+        return textos_abrir(textos, caminho_arquivo_livro, COLUNAS_TEXTO_LIVRO, "rb");
+}
+
+/*
+ * ler_titulo_livro - função interna que lê o título do livro de uma posição da área de textos
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou os erros de textos_ler_referencias e textos_ler.
+ */
+static int ler_titulo_livro(AREA_TEXTOS* textos, int posicao, char* destino, size_t capacidade) {
+        REFERENCIA_TEXTO referencias[COLUNAS_TEXTO_LIVRO];
+        int retorno = textos_ler_referencias(textos, posicao, referencias);
+        if(retorno != SUCESSO)
+                return retorno;
+        return textos_ler(textos, referencias[COLUNA_TITULO], destino, capacidade);
+}
+
+/*
+ * visitante_emprestimo - função interna chamada para cada empréstimo aberto durante o percurso da lista
+ */
+typedef int (*visitante_emprestimo)(const EMPRESTIMO* emprestimo, void* contexto);
+
+/*
+ * percorrer_emprestimos_abertos - função interna que percorre a lista de empréstimos abertos (pos_cabeca)
+ *
+ * @arquivo - arquivo de empréstimos aberto para leitura
+ * @visitar - função chamada para cada empréstimo sem data de devolução
+ * @contexto - ponteiro repassado para a função visitar
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou o primeiro erro encontrado (inclusive o retornado pela função visitar).
+ */
+static int percorrer_emprestimos_abertos(FILE* arquivo, visitante_emprestimo visitar, void* contexto) {
+        CABECALHO cabecalho;
+        int retorno = le_cabecalho_arquivo(arquivo, &cabecalho);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        EMPRESTIMO emprestimo;
+        int pos = cabecalho.pos_cabeca;
+        while(pos != -1) {
+                if(fseek(arquivo, sizeof(CABECALHO) + pos * sizeof(EMPRESTIMO), SEEK_SET) != 0)
+                        return ERRO_ARQUIVO_SEEK;
+                if(fread(&emprestimo, sizeof(EMPRESTIMO), 1, arquivo) != 1)
+                        return ERRO_ARQUIVO_READ;
+
+                if(emprestimo.data_devolucao == DATA_NULA && (retorno = visitar(&emprestimo, contexto)) != SUCESSO)
+                        return retorno;
+
+                pos = emprestimo.proximo;
+        }
+
+        return SUCESSO;
+}
+
+/*
+ * copiar_texto - função interna que copia um texto limitado, garantindo o '\0' final
+ */
+static void copiar_texto(char* destino, const char* origem, size_t tamanho_destino) {
+        size_t tamanho = strlen(origem);
+        if(tamanho > tamanho_destino - 1)
+                tamanho = tamanho_destino - 1;
+        memcpy(destino, origem, tamanho);
+        destino[tamanho] = '\0';
+}
+
+/*
+ * preparar_emprestimo_detalhado - função interna que inicia um EMPRESTIMO_DETALHADO a partir do empréstimo
+ */
+static void preparar_emprestimo_detalhado(EMPRESTIMO_DETALHADO* detalhe, const EMPRESTIMO* emprestimo) {
+        detalhe->codigo_usuario = emprestimo->codigo_usuario;
+        detalhe->nome_usuario[0] = '\0';
+        detalhe->codigo_livro = emprestimo->codigo_livro;
+        detalhe->titulo_livro[0] = '\0';
+        detalhe->data_emprestimo = emprestimo->data_emprestimo;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                              junção hash                                  */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * dicionario_iniciar - função interna que aloca um dicionário para a quantidade esperada de textos
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou ERRO_ALOCAR_MEMORIA (-30).
+ */
+static int dicionario_iniciar(DICIONARIO_JUNCAO* dicionario, int capacidade, size_t tamanho_texto) {
+        if(capacidade < 1)
+                capacidade = 1;
+        dicionario->posicoes = tabela_hash_criar(capacidade);
+        dicionario->textos = malloc((size_t)capacidade * tamanho_texto);
+        dicionario->tamanho_texto = tamanho_texto;
+        dicionario->quantidade = 0;
+        dicionario->capacidade = capacidade;
+        if(dicionario->posicoes == NULL || dicionario->textos == NULL)
+                return ERRO_ALOCAR_MEMORIA;
+        return SUCESSO;
+}
+
+/*
+ * dicionario_liberar - função interna que libera a memória de um dicionário
+ */
+static void dicionario_liberar(DICIONARIO_JUNCAO* dicionario) {
+        tabela_hash_destruir(dicionario->posicoes);
+        free(dicionario->textos);
+        dicionario->posicoes = NULL;
+        dicionario->textos = NULL;
+}
+
+/*
+ * dicionario_adicionar - função interna que associa um texto a um código
+ *
+ * Pós-condições:
+ *      - Códigos repetidos ficam com o último texto informado.
+ *      - Retorna SUCESSO (0) ou ERRO_ALOCAR_MEMORIA (-30).
+ */
+static int dicionario_adicionar(DICIONARIO_JUNCAO* dicionario, unsigned int codigo, const char* texto) {
+        int indice;
+        if(tabela_hash_buscar(dicionario->posicoes, codigo, &indice) != SUCESSO) {
+                if(dicionario->quantidade == dicionario->capacidade)
+                        return ERRO_ALOCAR_MEMORIA;
+                indice = dicionario->quantidade++;
+                if(tabela_hash_inserir(dicionario->posicoes, codigo, indice) != SUCESSO)
+                        return ERRO_ALOCAR_MEMORIA;
+        }
+        copiar_texto(dicionario->textos + (size_t)indice * dicionario->tamanho_texto, texto, dicionario->tamanho_texto);
+        return SUCESSO;
+}
+
+/*
+ * dicionario_consultar - função interna que copia para destino o texto associado ao código (ou "" se não existir)
+ */
+static void dicionario_consultar(const DICIONARIO_JUNCAO* dicionario, unsigned int codigo, char* destino, size_t tamanho_destino) {
+        int indice;
+        if(tabela_hash_buscar(dicionario->posicoes, codigo, &indice) == SUCESSO)
+                copiar_texto(destino, dicionario->textos + (size_t)indice * dicionario->tamanho_texto, tamanho_destino);
+        else
+                destino[0] = '\0';
+}
+
+/*
+ * CONTEXTO_TEXTOS_LIVRO - destino dos títulos e área de onde eles são lidos durante a varredura dos livros
+ */
+typedef struct {
+        void* destino;
+        AREA_TEXTOS* textos;
+} CONTEXTO_TEXTOS_LIVRO;
+
+static int coletar_titulo_livro(const void* registro, int posicao, void* contexto) {
+        const REGISTRO_LIVRO* livro = registro;
+        CONTEXTO_TEXTOS_LIVRO* coleta = contexto;
+        char titulo[MAX_TITULO + 1];
+
+        int retorno = ler_titulo_livro(coleta->textos, posicao, titulo, sizeof(titulo));
+        if(retorno != SUCESSO)
+                return retorno;
+
+        return dicionario_adicionar(coleta->destino, (unsigned int)livro->codigo, titulo);
+}
+
+static int coletar_nome_usuario(const void* registro, int posicao, void* contexto) {
+        (void)posicao;
+        const USUARIO* usuario = registro;
+        return dicionario_adicionar(contexto, usuario->codigo, usuario->nome);
+}
+
+/*
+ * CONTEXTO_JUNCAO_HASH - estado repassado ao percurso dos empréstimos na junção hash
+ */
+typedef struct {
+        const DICIONARIO_JUNCAO* livros;
+        const DICIONARIO_JUNCAO* usuarios;
+        visitante_juncao visitar;
+        void* contexto;
+} CONTEXTO_JUNCAO_HASH;
+
+static int sondar_emprestimo(const EMPRESTIMO* emprestimo, void* contexto) {
+        CONTEXTO_JUNCAO_HASH* juncao = contexto;
+        EMPRESTIMO_DETALHADO detalhe;
+
+        preparar_emprestimo_detalhado(&detalhe, emprestimo);
+        dicionario_consultar(juncao->livros, detalhe.codigo_livro, detalhe.titulo_livro, sizeof(detalhe.titulo_livro));
+        dicionario_consultar(juncao->usuarios, detalhe.codigo_usuario, detalhe.nome_usuario, sizeof(detalhe.nome_usuario));
+
+        // interrupção pedida pelo chamador: encerrar o percurso sem erro
+        return juncao->visitar(&detalhe, juncao->contexto) != SUCESSO ? 1 : SUCESSO;
+}
+
+int juncao_hash_emprestimos_abertos(
+        const char* caminho_arquivo_emprestimo,
+        const char* caminho_arquivo_livro,
+        const char* caminho_arquivo_usuario,
+        visitante_juncao visitar,
+        void* contexto
+) {
+        int retorno = SUCESSO;
+        DICIONARIO_JUNCAO livros = {0};
+        DICIONARIO_JUNCAO usuarios = {0};
+        CABECALHO cabecalho_livro, cabecalho_usuario;
+
+        FILE* arquivo_emprestimo = fopen(caminho_arquivo_emprestimo, "rb");
+        if(!arquivo_emprestimo)
+                return ERRO_ABRIR_ARQUIVO;
+
+        FILE* arquivo_livro = fopen(caminho_arquivo_livro, "rb");
+        if(!arquivo_livro) {
+                retorno = ERRO_ABRIR_ARQUIVO;
+                goto liberar_arquivo_emprestimo;
+        }
+
+        AREA_TEXTOS textos_livro;
+        if((retorno = abrir_textos_livro(&textos_livro, caminho_arquivo_livro)) != SUCESSO)
+                goto liberar_arquivo_livro;
+
+        FILE* arquivo_usuario = fopen(caminho_arquivo_usuario, "rb");
+        if(!arquivo_usuario) {
+                retorno = ERRO_ABRIR_ARQUIVO;
+                goto liberar_textos_livro;
+        }
+
+        if(
+                (retorno = le_cabecalho_arquivo(arquivo_livro, &cabecalho_livro)) != SUCESSO ||
+                (retorno = le_cabecalho_arquivo(arquivo_usuario, &cabecalho_usuario)) != SUCESSO
+        ) {
+                goto liberar_arquivo_usuario;
+        }
+
+        // fase de construção: uma leitura sequencial de cada arquivo
+        CONTEXTO_TEXTOS_LIVRO coleta = { &livros, &textos_livro };
+        if(
+                (retorno = dicionario_iniciar(&livros, cabecalho_livro.num_ativos, MAX_TITULO + 1)) != SUCESSO ||
+                (retorno = dicionario_iniciar(&usuarios, cabecalho_usuario.num_ativos, MAX_NOME + 1)) != SUCESSO ||
+                (retorno = varrer_registros_ativos(arquivo_livro, sizeof(REGISTRO_LIVRO), offsetof(REGISTRO_LIVRO, prox), coletar_titulo_livro, &coleta)) != SUCESSO ||
+                (retorno = varrer_registros_ativos(arquivo_usuario, sizeof(USUARIO), offsetof(USUARIO, proximo), coletar_nome_usuario, &usuarios)) != SUCESSO
+        ) {
+                goto liberar_dicionarios;
+        }
+
+        // fase de sondagem: empréstimos abertos na ordem da lista
+        CONTEXTO_JUNCAO_HASH juncao = { &livros, &usuarios, visitar, contexto };
+        retorno = percorrer_emprestimos_abertos(arquivo_emprestimo, sondar_emprestimo, &juncao);
+        if(retorno > 0)
+                retorno = SUCESSO;
+
+liberar_dicionarios:
+        dicionario_liberar(&livros);
+        dicionario_liberar(&usuarios);
+liberar_arquivo_usuario:
+        fclose(arquivo_usuario);
+liberar_textos_livro:
+        textos_fechar(&textos_livro);
+liberar_arquivo_livro:
+        fclose(arquivo_livro);
+liberar_arquivo_emprestimo:
+        fclose(arquivo_emprestimo);
+
+        return retorno;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                         junção por ordenação                              */
+/* ------------------------------------------------------------------------- */
+
+typedef int (*comparador_registros)(const void* a, const void* b);
+
+static int comparar_inteiros(unsigned int a, unsigned int b) {
+        return (a > b) - (a < b);
+}
+
+static int comparar_pares(const void* a, const void* b) {
+        return comparar_inteiros(((const PAR_CODIGO_TEXTO*)a)->codigo, ((const PAR_CODIGO_TEXTO*)b)->codigo);
+}
+
+static int comparar_por_livro(const void* a, const void* b) {
+        return comparar_inteiros(((const REGISTRO_JUNCAO*)a)->detalhe.codigo_livro, ((const REGISTRO_JUNCAO*)b)->detalhe.codigo_livro);
+}
+
+static int comparar_por_usuario(const void* a, const void* b) {
+        return comparar_inteiros(((const REGISTRO_JUNCAO*)a)->detalhe.codigo_usuario, ((const REGISTRO_JUNCAO*)b)->detalhe.codigo_usuario);
+}
+
+static int comparar_por_sequencia(const void* a, const void* b) {
+        int x = ((const REGISTRO_JUNCAO*)a)->sequencia;
+        int y = ((const REGISTRO_JUNCAO*)b)->sequencia;
+        return (x > y) - (x < y);
+}
+
+/*
+ * intercalar_corridas - função interna que intercala corridas ordenadas em um novo arquivo temporário
+ *
+ * @corridas - arquivos temporários, cada um já ordenado
+ * @quantidade - número de corridas (no máximo MAX_VIAS_INTERCALACAO)
+ * @tamanho_registro - tamanho de cada registro
+ * @comparar - função de comparação dos registros
+ * @saida - ponteiro onde o arquivo intercalado será armazenado
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou um código de erro negativo. As corridas não são fechadas.
+ */
+static int intercalar_corridas(FILE** corridas, int quantidade, size_t tamanho_registro, comparador_registros comparar, FILE** saida) {
+        int retorno = SUCESSO;
+        unsigned char* atuais = malloc((size_t)quantidade * tamanho_registro);
+        int ativas[MAX_VIAS_INTERCALACAO];
+        *saida = tmpfile();
+        if(atuais == NULL || *saida == NULL) {
+                retorno = atuais == NULL ? ERRO_ALOCAR_MEMORIA : ERRO_ABRIR_ARQUIVO;
+                goto liberar_atuais;
+        }
+
+        for(int i = 0; i < quantidade; i++) {
+                rewind(corridas[i]);
+                ativas[i] = fread(atuais + i * tamanho_registro, tamanho_registro, 1, corridas[i]) == 1;
+        }
+
+        for(;;) {
+                int menor = -1;
+                for(int i = 0; i < quantidade; i++) {
+                        if(ativas[i] && (menor == -1 || comparar(atuais + i * tamanho_registro, atuais + menor * tamanho_registro) < 0))
+                                menor = i;
+                }
+                if(menor == -1)
+                        break;
+
+                if(fwrite(atuais + menor * tamanho_registro, tamanho_registro, 1, *saida) != 1) {
+                        retorno = ERRO_ARQUIVO_WRITE;
+                        goto liberar_atuais;
+                }
+                ativas[menor] = fread(atuais + menor * tamanho_registro, tamanho_registro, 1, corridas[menor]) == 1;
+        }
+
+liberar_atuais:
+        free(atuais);
+        if(retorno != SUCESSO && *saida != NULL) {
+                fclose(*saida);
+                *saida = NULL;
+        }
+
+        return retorno;
+}
+
+/*
+ * ordenar_externamente - função interna que substitui um arquivo temporário por sua versão ordenada
+ *
+ * @arquivo - ponteiro para o arquivo temporário; ao final aponta para o arquivo ordenado (rebobinado)
+ * @tamanho_registro - tamanho de cada registro
+ * @comparar - função de comparação dos registros
+ * @limite_memoria - quantidade máxima de bytes carregada em memória por corrida
+ *
+ * O arquivo é dividido em corridas de até limite_memoria bytes, cada uma ordenada com qsort
+ * e gravada em um temporário; as corridas são intercaladas em grupos de MAX_VIAS_INTERCALACAO
+ * até restar apenas uma.
+ *
+ * Pós-condições:
+ *      - O arquivo original é fechado e substituído.
+ *      - Retorna SUCESSO (0) ou um código de erro negativo.
+ */
+static int ordenar_externamente(FILE** arquivo, size_t tamanho_registro, comparador_registros comparar, size_t limite_memoria) {
+        int retorno = SUCESSO;
+        size_t capacidade = limite_memoria / tamanho_registro;
+        if(capacidade < 1)
+                capacidade = 1;
+
+        FILE** corridas = NULL;
+        int num_corridas = 0;
+        int max_corridas = 0;
+        unsigned char* bloco = malloc(capacidade * tamanho_registro);
+        if(bloco == NULL)
+                return ERRO_ALOCAR_MEMORIA;
+
+        // fase 1: corridas ordenadas em memória
+        rewind(*arquivo);
+        size_t lidos;
+        while((lidos = fread(bloco, tamanho_registro, capacidade, *arquivo)) > 0) {
+                qsort(bloco, lidos, tamanho_registro, comparar);
+
+                if(num_corridas == max_corridas) {
+                        int nova_capacidade = max_corridas ? max_corridas * 2 : MAX_VIAS_INTERCALACAO;
+                        FILE** novas = realloc(corridas, nova_capacidade * sizeof(FILE*));
+                        if(novas == NULL) {
+                                retorno = ERRO_ALOCAR_MEMORIA;
+                                goto liberar_corridas;
+                        }
+                        corridas = novas;
+                        max_corridas = nova_capacidade;
+                }
+
+                FILE* corrida = tmpfile();
+                if(corrida == NULL) {
+                        retorno = ERRO_ABRIR_ARQUIVO;
+                        goto liberar_corridas;
+                }
+                corridas[num_corridas++] = corrida;
+                if(fwrite(bloco, tamanho_registro, lidos, corrida) != lidos) {
+                        retorno = ERRO_ARQUIVO_WRITE;
+                        goto liberar_corridas;
+                }
+        }
+        free(bloco);
+        bloco = NULL;
+
+        if(num_corridas == 0) {
+                // arquivo vazio já está ordenado
+                rewind(*arquivo);
+                goto liberar_corridas;
+        }
+
+        // fase 2: intercalação em grupos até restar uma corrida
+        while(num_corridas > 1) {
+                int restantes = 0;
+                for(int inicio = 0; inicio < num_corridas; inicio += MAX_VIAS_INTERCALACAO) {
+                        int quantidade = num_corridas - inicio;
+                        if(quantidade > MAX_VIAS_INTERCALACAO)
+                                quantidade = MAX_VIAS_INTERCALACAO;
+
+                        FILE* intercalado;
+                        retorno = intercalar_corridas(corridas + inicio, quantidade, tamanho_registro, comparar, &intercalado);
+                        for(int i = 0; i < quantidade; i++) {
+                                fclose(corridas[inicio + i]);
+                                corridas[inicio + i] = NULL;
+                        }
+                        if(retorno != SUCESSO) {
+                                // as corridas ainda não intercaladas continuam abertas e serão fechadas abaixo
+                                goto liberar_corridas;
+                        }
+                        corridas[restantes++] = intercalado;
+                }
+                for(int i = restantes; i < num_corridas; i++)
+                        corridas[i] = NULL;
+                num_corridas = restantes;
+        }
+
+        fclose(*arquivo);
+        *arquivo = corridas[0];
+        corridas[0] = NULL;
+        rewind(*arquivo);
+
+liberar_corridas:
+        for(int i = 0; i < num_corridas; i++) {
+                if(corridas[i] != NULL)
+                        fclose(corridas[i]);
+        }
+        free(corridas);
+        free(bloco);
+
+        return retorno;
+}
+
+/*
+ * CONTEXTO_GRAVACAO_EMPRESTIMOS - estado da cópia dos empréstimos abertos para o temporário
+ */
+typedef struct {
+        FILE* destino;
+        int sequencia;
+} CONTEXTO_GRAVACAO_EMPRESTIMOS;
+
+static int gravar_emprestimo_temporario(const EMPRESTIMO* emprestimo, void* contexto) {
+        CONTEXTO_GRAVACAO_EMPRESTIMOS* gravacao = contexto;
+        REGISTRO_JUNCAO registro;
+
+        memset(&registro, 0, sizeof(REGISTRO_JUNCAO));
+        registro.sequencia = gravacao->sequencia++;
+        preparar_emprestimo_detalhado(&registro.detalhe, emprestimo);
+
+        return fwrite(&registro, sizeof(REGISTRO_JUNCAO), 1, gravacao->destino) == 1 ? SUCESSO : ERRO_ARQUIVO_WRITE;
+}
+
+static int gravar_par_livro(const void* registro, int posicao, void* contexto) {
+        const REGISTRO_LIVRO* livro = registro;
+        CONTEXTO_TEXTOS_LIVRO* gravacao = contexto;
+        PAR_CODIGO_TEXTO par;
+
+        memset(&par, 0, sizeof(PAR_CODIGO_TEXTO));
+        par.codigo = (unsigned int)livro->codigo;
+        int retorno = ler_titulo_livro(gravacao->textos, posicao, par.texto, sizeof(par.texto));
+        if(retorno != SUCESSO)
+                return retorno;
+
+        return fwrite(&par, sizeof(PAR_CODIGO_TEXTO), 1, gravacao->destino) == 1 ? SUCESSO : ERRO_ARQUIVO_WRITE;
+}
+
+static int gravar_par_usuario(const void* registro, int posicao, void* contexto) {
+        (void)posicao;
+        const USUARIO* usuario = registro;
+        PAR_CODIGO_TEXTO par;
+
+        memset(&par, 0, sizeof(PAR_CODIGO_TEXTO));
+        par.codigo = usuario->codigo;
+        copiar_texto(par.texto, usuario->nome, sizeof(par.texto));
+
+        return fwrite(&par, sizeof(PAR_CODIGO_TEXTO), 1, contexto) == 1 ? SUCESSO : ERRO_ARQUIVO_WRITE;
+}
+
+/*
+ * intercalar_textos - função interna que completa os empréstimos com os textos de um arquivo de pares
+ *
+ * @registros - ponteiro para o temporário de empréstimos, ordenado pelo código de livro (ou usuário)
+ * @pares - temporário de pares ordenado por código
+ * @preencher_livro - 1 para preencher o título do livro, 0 para preencher o nome do usuário
+ *
+ * Pós-condições:
+ *      - *registros é fechado e substituído por um novo temporário com os textos preenchidos.
+ *      - Retorna SUCESSO (0) ou um código de erro negativo.
+ */
+static int intercalar_textos(FILE** registros, FILE* pares, int preencher_livro) {
+        FILE* saida = tmpfile();
+        if(saida == NULL)
+                return ERRO_ABRIR_ARQUIVO;
+
+        rewind(*registros);
+        rewind(pares);
+
+        REGISTRO_JUNCAO registro;
+        PAR_CODIGO_TEXTO par;
+        int tem_par = fread(&par, sizeof(PAR_CODIGO_TEXTO), 1, pares) == 1;
+
+        while(fread(&registro, sizeof(REGISTRO_JUNCAO), 1, *registros) == 1) {
+                unsigned int codigo = preencher_livro ? registro.detalhe.codigo_livro : registro.detalhe.codigo_usuario;
+
+                while(tem_par && par.codigo < codigo)
+                        tem_par = fread(&par, sizeof(PAR_CODIGO_TEXTO), 1, pares) == 1;
+
+                if(tem_par && par.codigo == codigo) {
+                        if(preencher_livro)
+                                copiar_texto(registro.detalhe.titulo_livro, par.texto, sizeof(registro.detalhe.titulo_livro));
+                        else
+                                copiar_texto(registro.detalhe.nome_usuario, par.texto, sizeof(registro.detalhe.nome_usuario));
+                }
+
+                if(fwrite(&registro, sizeof(REGISTRO_JUNCAO), 1, saida) != 1) {
+                        fclose(saida);
+                        return ERRO_ARQUIVO_WRITE;
+                }
+        }
+
+        fclose(*registros);
+        *registros = saida;
+
+        return SUCESSO;
+}
+
+/*
+ * juntar_com_arquivo - função interna que executa uma etapa da junção por ordenação
+ *
+ * @registros - ponteiro para o temporário de empréstimos
+ * @arquivo - arquivo de livros ou de usuários
+ * @textos_livro - área de textos dos livros (usada apenas com preencher_livro)
+ * @preencher_livro - 1 para juntar com livros, 0 para juntar com usuários
+ * @limite_memoria - memória máxima de cada ordenação
+ *
+ * Pós-condições:
+ *      - *registros é substituído pelos empréstimos completados, ordenados pelo código usado na junção.
+ *      - Retorna SUCESSO (0) ou um código de erro negativo.
+ */
+static int juntar_com_arquivo(FILE** registros, FILE* arquivo, AREA_TEXTOS* textos_livro, int preencher_livro, size_t limite_memoria) {
+        FILE* pares = tmpfile();
+        if(pares == NULL)
+                return ERRO_ABRIR_ARQUIVO;
+
+        CONTEXTO_TEXTOS_LIVRO gravacao = { pares, textos_livro };
+        int retorno = preencher_livro ?
+                varrer_registros_ativos(arquivo, sizeof(REGISTRO_LIVRO), offsetof(REGISTRO_LIVRO, prox), gravar_par_livro, &gravacao) :
+                varrer_registros_ativos(arquivo, sizeof(USUARIO), offsetof(USUARIO, proximo), gravar_par_usuario, pares);
+
+        if(
+                retorno == SUCESSO &&
+                (retorno = ordenar_externamente(&pares, sizeof(PAR_CODIGO_TEXTO), comparar_pares, limite_memoria)) == SUCESSO &&
+                (retorno = ordenar_externamente(
+                        registros, sizeof(REGISTRO_JUNCAO),
+                        preencher_livro ? comparar_por_livro : comparar_por_usuario, limite_memoria
+                )) == SUCESSO
+        ) {
+                retorno = intercalar_textos(registros, pares, preencher_livro);
+        }
+
+        fclose(pares);
+
+        return retorno;
+}
+
+int juncao_ordenacao_emprestimos_abertos(
+        const char* caminho_arquivo_emprestimo,
+        const char* caminho_arquivo_livro,
+        const char* caminho_arquivo_usuario,
+        size_t limite_memoria,
+        visitante_juncao visitar,
+        void* contexto
+) {
+        int retorno = SUCESSO;
+        FILE* registros = NULL;
+
+        FILE* arquivo_emprestimo = fopen(caminho_arquivo_emprestimo, "rb");
+        if(!arquivo_emprestimo)
+                return ERRO_ABRIR_ARQUIVO;
+
+        FILE* arquivo_livro = fopen(caminho_arquivo_livro, "rb");
+        if(!arquivo_livro) {
+                retorno = ERRO_ABRIR_ARQUIVO;
+                goto liberar_arquivo_emprestimo;
+        }
+
+        AREA_TEXTOS textos_livro;
+        if((retorno = abrir_textos_livro(&textos_livro, caminho_arquivo_livro)) != SUCESSO)
+                goto liberar_arquivo_livro;
+
+        FILE* arquivo_usuario = fopen(caminho_arquivo_usuario, "rb");
+        if(!arquivo_usuario) {
+                retorno = ERRO_ABRIR_ARQUIVO;
+                goto liberar_textos_livro;
+        }
+
+        registros = tmpfile();
+        if(registros == NULL) {
+                retorno = ERRO_ABRIR_ARQUIVO;
+                goto liberar_arquivo_usuario;
+        }
+
+        CONTEXTO_GRAVACAO_EMPRESTIMOS gravacao = { registros, 0 };
+        if(
+                (retorno = percorrer_emprestimos_abertos(arquivo_emprestimo, gravar_emprestimo_temporario, &gravacao)) != SUCESSO ||
+                (retorno = juntar_com_arquivo(&registros, arquivo_livro, &textos_livro, 1, limite_memoria)) != SUCESSO ||
+                (retorno = juntar_com_arquivo(&registros, arquivo_usuario, NULL, 0, limite_memoria)) != SUCESSO ||
+                (retorno = ordenar_externamente(&registros, sizeof(REGISTRO_JUNCAO), comparar_por_sequencia, limite_memoria)) != SUCESSO
+        ) {
+                goto liberar_registros;
+        }
+
+        // entregar os empréstimos na ordem original da lista
+        REGISTRO_JUNCAO registro;
+        rewind(registros);
+        while(fread(&registro, sizeof(REGISTRO_JUNCAO), 1, registros) == 1) {
+                if(visitar(&registro.detalhe, contexto) != SUCESSO)
+                        break;
+        }
+
+liberar_registros:
+        fclose(registros);
+liberar_arquivo_usuario:
+        fclose(arquivo_usuario);
+liberar_textos_livro:
+        textos_fechar(&textos_livro);
+liberar_arquivo_livro:
+        fclose(arquivo_livro);
+liberar_arquivo_emprestimo:
+        fclose(arquivo_emprestimo);
+
+        return retorno;
+}
+
+int juntar_emprestimos_abertos(
+        const char* caminho_arquivo_emprestimo,
+        const char* caminho_arquivo_livro,
+        const char* caminho_arquivo_usuario,
+        visitante_juncao visitar,
+        void* contexto
+) {
+        CABECALHO cabecalho_emprestimo, cabecalho_livro, cabecalho_usuario;
+        int retorno;
+
+        // as junções leem os arquivos por stdio: alterações ainda no cache de páginas precisam estar no arquivo
+        if(
+                (retorno = descarregar_caminho_dados(caminho_arquivo_emprestimo)) != SUCESSO ||
+                (retorno = descarregar_caminho_dados(caminho_arquivo_livro)) != SUCESSO ||
+                (retorno = descarregar_caminho_dados(caminho_arquivo_usuario)) != SUCESSO
+        ) {
+                return retorno;
+        }
+
+        FILE* arquivo_emprestimo = fopen(caminho_arquivo_emprestimo, "rb");
+        if(!arquivo_emprestimo)
+                return ERRO_ABRIR_ARQUIVO;
+        retorno = le_cabecalho_arquivo(arquivo_emprestimo, &cabecalho_emprestimo);
+        fclose(arquivo_emprestimo);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        // nenhum empréstimo aberto: não há o que juntar
+        if(cabecalho_emprestimo.emprestimos_abertos == 0)
+                return SUCESSO;
+
+        FILE* arquivo_livro = fopen(caminho_arquivo_livro, "rb");
+        if(!arquivo_livro)
+                return ERRO_ABRIR_ARQUIVO;
+        retorno = le_cabecalho_arquivo(arquivo_livro, &cabecalho_livro);
+        fclose(arquivo_livro);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        FILE* arquivo_usuario = fopen(caminho_arquivo_usuario, "rb");
+        if(!arquivo_usuario)
+                return ERRO_ABRIR_ARQUIVO;
+        retorno = le_cabecalho_arquivo(arquivo_usuario, &cabecalho_usuario);
+        fclose(arquivo_usuario);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        // os dicionários guardam um texto por registro ativo (contador do cabeçalho)
+        double estimativa =
+                (double)cabecalho_livro.num_ativos * (MAX_TITULO + 1 + CUSTO_TABELA_POR_CHAVE) +
+                (double)cabecalho_usuario.num_ativos * (MAX_NOME + 1 + CUSTO_TABELA_POR_CHAVE);
+
+        if(estimativa <= (double)LIMITE_MEMORIA_JUNCAO) {
+                retorno = juncao_hash_emprestimos_abertos(
+                        caminho_arquivo_emprestimo, caminho_arquivo_livro, caminho_arquivo_usuario, visitar, contexto
+                );
+                if(retorno != ERRO_ALOCAR_MEMORIA)
+                        return retorno;
+        }
+
+        return juncao_ordenacao_emprestimos_abertos(
+                caminho_arquivo_emprestimo, caminho_arquivo_livro, caminho_arquivo_usuario,
+                (size_t)LIMITE_MEMORIA_JUNCAO, visitar, contexto
+        );
+}
@@ -1,14 +1,23 @@
 #include "../include/livro.h"
 #include"../include/arquivo.h"
+#include"../include/armazenamento.h"
+#include"../include/biblioteca.h"
 #include"../include/erros.h"
+#include"../include/indice_hash.h"
+#include"../include/arvore_bmais.h"
+#include"../include/indice_invertido.h"
+#include"../include/trigramas.h"
+#include"../include/varredura.h"
+#include"../include/utils.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 
 /*
- * le_no_livro - le um nó do tipo LIVRO em uma determinada posição do arquivo
+ * le_no_livro - le um nó do tipo REGISTRO_LIVRO em uma determinada posição do arquivo
  *
  * @arq - ponteiro para arquivo binário aberto em modo leitura/escrita
  * @pos - posição lógica do livro na lista (índice relativo ao início dos registros)
@@ -18,18 +27,14 @@
  *      - A posição deve ser válida (não negativa e dentro dos limites do arquivo)
  *
  * Pós-condições:
- *      - Um ponteiro para a estrutura LIVRO preenchida com os dados da posição indicada é retornado
+ *      - Um ponteiro para a estrutura REGISTRO_LIVRO preenchida com os dados da posição indicada é retornado
  *      - Em caso de erro (malloc, fseek ou fread), retorna NULL
  */
-static LIVRO* le_no_livro(FILE *arq, int pos) {
-        LIVRO *livro = malloc(sizeof(LIVRO));
+static REGISTRO_LIVRO* le_no_livro(FILE *arq, int pos) {
+        REGISTRO_LIVRO *livro = malloc(sizeof(REGISTRO_LIVRO));
         if (!livro)
                 return NULL;
-        if(fseek(arq, sizeof(CABECALHO)+pos*sizeof(LIVRO), SEEK_SET)!=0) {
-                free(livro);
-                return NULL;
-        }
-        if (fread(livro, sizeof(LIVRO), 1, arq) != 1) {
+        if (ler_registro(arq, pos, sizeof(REGISTRO_LIVRO), livro) != SUCESSO) {
                 free(livro);
                 return NULL;
         }
@@ -37,10 +42,10 @@ static LIVRO* le_no_livro(FILE *arq, int pos) {
 }
 
 /*
- * escreve_no_livro - Escreve um nó do tipo LIVRO em uma posição lógica do arquivo binário
+ * escreve_no_livro - Escreve um nó do tipo REGISTRO_LIVRO em uma posição lógica do arquivo binário
  *
  * @arq   - ponteiro para arquivo binário aberto em modo leitura/escrita
- * @livro - ponteiro para estrutura LIVRO contendo os dados a serem gravados
+ * @livro - ponteiro para estrutura REGISTRO_LIVRO contendo os dados a serem gravados
  * @pos   - posição lógica (índice) onde os dados devem ser gravados
  *
  * Pré-condições:
@@ -49,415 +54,2390 @@ static LIVRO* le_no_livro(FILE *arq, int pos) {
  *      - O ponteiro livro deve apontar para uma estrutura válida e inicializada
  *
  * Pós-condições:
- *      - Os dados da estrutura LIVRO são gravados na posição especificada no arquivo
+ *      - Os dados da estrutura REGISTRO_LIVRO são gravados na posição especificada no arquivo
  *      - Retorna SUCESSO (0) em caso de sucesso
  *      - Retorna código de erro negativo em caso de falha (por exemplo: erro de fseek ou fwrite)
  */
-static int escreve_no_livro(FILE* arq,LIVRO* livro,int pos){
-        if (fseek(arq, sizeof(CABECALHO) + pos * sizeof(LIVRO), SEEK_SET) != 0)
-                return ERRO_ARQUIVO_SEEK;
-        if (fwrite(livro, sizeof(LIVRO), 1, arq) != 1) {
-                return ERRO_ARQUIVO_WRITE;
+static int escreve_no_livro(FILE* arq,REGISTRO_LIVRO* livro,int pos){
+        return escrever_registro(arq, pos, sizeof(REGISTRO_LIVRO), livro);
+}
+
+void preparar_registro_livro(const LIVRO* livro, REGISTRO_LIVRO* registro) {
+        registro->codigo = livro->codigo;
+        registro->edicao = livro->edicao;
+        registro->ano = livro->ano;
+        registro->exemplares = livro->exemplares;
+        registro->prox = livro->prox;
+        registro->primeiro_emprestimo = -1;
+}
+
+int gravar_textos_livro(AREA_TEXTOS* textos, int posicao, const LIVRO* livro) {
+        REFERENCIA_TEXTO referencias[COLUNAS_TEXTO_LIVRO];
+
+        int retorno;
+        if ((retorno = textos_gravar(textos, livro->titulo, &referencias[COLUNA_TITULO])) != SUCESSO ||
+            (retorno = textos_gravar(textos, livro->autor, &referencias[COLUNA_AUTOR])) != SUCESSO ||
+            (retorno = textos_gravar(textos, livro->editora, &referencias[COLUNA_EDITORA])) != SUCESSO) {
+                return retorno;
+        }
+
+        return textos_gravar_referencias(textos, posicao, referencias);
+}
+
+int montar_livro(AREA_TEXTOS* textos, int posicao, const REGISTRO_LIVRO* registro, LIVRO* livro) {
+        livro->codigo = registro->codigo;
+        livro->edicao = registro->edicao;
+        livro->ano = registro->ano;
+        livro->exemplares = registro->exemplares;
+        livro->prox = registro->prox;
+
+        REFERENCIA_TEXTO referencias[COLUNAS_TEXTO_LIVRO];
+        int retorno;
+        if ((retorno = textos_ler_referencias(textos, posicao, referencias)) != SUCESSO ||
+            (retorno = textos_ler(textos, referencias[COLUNA_TITULO], livro->titulo, sizeof(livro->titulo))) != SUCESSO ||
+            (retorno = textos_ler(textos, referencias[COLUNA_AUTOR], livro->autor, sizeof(livro->autor))) != SUCESSO ||
+            (retorno = textos_ler(textos, referencias[COLUNA_EDITORA], livro->editora, sizeof(livro->editora))) != SUCESSO) {
+                return retorno;
         }
+
+        return SUCESSO;
+}
+
+int contabilizar_livro(const void* registro, int posicao, void* contexto) {
+        (void)posicao;
+        const REGISTRO_LIVRO *livro = registro;
+        CABECALHO *cab = contexto;
+        cab->exemplares_disponiveis += livro->exemplares;
         return SUCESSO;
 }
 
 /*
- * verificar_id_livro - verifica se livro já foi cadastrado
- *
- * @caminho_arquivo_livro - caminho completo para o arquivo binário que armazena livros
- * @codigo_livro - código do livro
+ * LIVRO_FORMATO_ANTIGO - registro de livro.dat antes da área de textos (textos dentro do registro)
  *
- * Pré-condições:
- *      - Caminho para o arquivo deve ser válido e pode ser lido.
- *      - Arquivo informado deve ser inicializado (conter cabeçalho).
- * Pós-condições:
- *      - Retorna SUCESSO caso não tenha conflito.
- *      - Retorna valores negativos em caso de erro:
- *              ERRO_CONFLITO_ID: foi identificado conflito.
- *              ERRO_ABRIR_ARQUIVO: não foi possível abrir o arquivo.
- *              ERRO_LER_CABECALHO: não foi possível ler o cabeçalho do arquivo
- *              ERRO_ARQUIVO_SEEK: erro no posicionamento do arquivo (fseek).
- *              ERRO_ARQUIVO_READ: erro na leitura do arquivo (fread).
+ * Os tamanhos são fixos: não acompanham MAX_TITULO, MAX_AUTOR e MAX_EDITORA.
  */
-static int verificar_id_livro(const char* caminho_arquivo_livro, unsigned int codigo_livro) {
-        int retorno = SUCESSO;
-        FILE* arquivo = fopen(caminho_arquivo_livro, "rb");
-        if(!arquivo) {
-                return ERRO_ABRIR_ARQUIVO;
-        }
+typedef struct {
+        int codigo;
+        char titulo[151];
+        char autor[201];
+        char editora[51];
+        int edicao;
+        int ano;
+        int exemplares;
+        int prox;
+} LIVRO_FORMATO_ANTIGO;
 
-        CABECALHO* cabecalho = le_cabecalho(arquivo);
-        if(!cabecalho) {
-                retorno = ERRO_LER_CABECALHO;
-                goto liberar_arquivo;
-        }
+/*
+ * LIVRO_FORMATO_REFERENCIAS - registro de livro.dat com as referências dos textos dentro do registro (sem livro.col)
+ */
+typedef struct {
+        int codigo;
+        REFERENCIA_TEXTO titulo;
+        REFERENCIA_TEXTO autor;
+        REFERENCIA_TEXTO editora;
+        int edicao;
+        int ano;
+        int exemplares;
+        int prox;
+} LIVRO_FORMATO_REFERENCIAS;
 
-        int pos = cabecalho->pos_cabeca;
-        LIVRO livro;
+/*
+ * converter_registro_antigo - função interna que separa um registro antigo em registro novo e referências
+ *
+ * @antigo - registro no formato antigo (LIVRO_FORMATO_ANTIGO ou LIVRO_FORMATO_REFERENCIAS)
+ * @formato_referencias - 1 se o registro é um LIVRO_FORMATO_REFERENCIAS
+ * @livre - 1 se a posição está na lista de livres (seus textos não são copiados)
+ * @textos - área de textos nova, aberta em modo "ab"
+ * @registro - registro novo a ser preenchido
+ * @referencias - referências da posição a serem preenchidas
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou o erro de textos_gravar.
+ */
+static int converter_registro_antigo(
+        void *antigo,
+        int formato_referencias,
+        int livre,
+        AREA_TEXTOS *textos,
+        REGISTRO_LIVRO *registro,
+        REFERENCIA_TEXTO *referencias
+) {
+        memset(referencias, 0, COLUNAS_TEXTO_LIVRO * sizeof(REFERENCIA_TEXTO));
+        registro->primeiro_emprestimo = -1;
 
-        while (pos != -1) {
-                if(fseek(arquivo, sizeof(CABECALHO) + pos * sizeof(LIVRO), SEEK_SET) != 0) {
-                        retorno = ERRO_ARQUIVO_SEEK;
-                        goto liberar_cabecalho;
+        if (formato_referencias) {
+                LIVRO_FORMATO_REFERENCIAS *livro = antigo;
+                registro->codigo = livro->codigo;
+                registro->edicao = livro->edicao;
+                registro->ano = livro->ano;
+                registro->exemplares = livro->exemplares;
+                registro->prox = livro->prox;
+                if (!livre) {
+                        // os textos continuam onde estão em livro.str
+                        referencias[COLUNA_TITULO] = livro->titulo;
+                        referencias[COLUNA_AUTOR] = livro->autor;
+                        referencias[COLUNA_EDITORA] = livro->editora;
                 }
+                return SUCESSO;
+        }
 
-                if(fread(&livro, sizeof(LIVRO), 1, arquivo) != 1) {
-                        retorno = ERRO_ARQUIVO_READ;
-                        goto liberar_cabecalho;
-                }
+        LIVRO_FORMATO_ANTIGO *livro = antigo;
+        registro->codigo = livro->codigo;
+        registro->edicao = livro->edicao;
+        registro->ano = livro->ano;
+        registro->exemplares = livro->exemplares;
+        registro->prox = livro->prox;
+        if (livre)
+                return SUCESSO;
 
-                if(livro.codigo == codigo_livro) {
-                        retorno = ERRO_CONFLITO_ID;
-                        goto liberar_cabecalho; // conflito encontrado
-                }
+        // os vetores antigos podem ter sido preenchidos até o fim, sem '\0'
+        livro->titulo[sizeof(livro->titulo) - 1] = '\0';
+        livro->autor[sizeof(livro->autor) - 1] = '\0';
+        livro->editora[sizeof(livro->editora) - 1] = '\0';
 
-                pos = livro.prox;
+        int retorno;
+        if ((retorno = textos_gravar(textos, livro->titulo, &referencias[COLUNA_TITULO])) != SUCESSO ||
+            (retorno = textos_gravar(textos, livro->autor, &referencias[COLUNA_AUTOR])) != SUCESSO ||
+            (retorno = textos_gravar(textos, livro->editora, &referencias[COLUNA_EDITORA])) != SUCESSO) {
+                return retorno;
         }
-liberar_cabecalho:
-        free(cabecalho);
-liberar_arquivo:
-        fclose(arquivo);
 
-        return retorno;
+        return SUCESSO;
 }
 
 /*
- * cadastrar_livro - Insere um novo livro na lista encadeada mantida em arquivo binário
- *
- * @nome_arq - nome do arquivo binário contendo a lista
- * @livro    - estrutura LIVRO preenchida com os dados do novo livro
+ * converter_registros_antigos - função interna que copia os registros antigos para os novos arquivos
  *
- * Pré-condições:
- *      - O arquivo deve existir e estar corretamente inicializado com um cabeçalho válido
- *      - O arquivo deve estar aberto para leitura e escrita
+ * @antigo - livro.dat no formato antigo, posicionado logo após o cabeçalho
+ * @formato_referencias - 1 para LIVRO_FORMATO_REFERENCIAS, 0 para LIVRO_FORMATO_ANTIGO
+ * @novo - arquivo convertido, posicionado logo após o cabeçalho
+ * @textos - área de textos nova, aberta em modo "ab"
+ * @cab - cabeçalho do arquivo antigo
  *
  * Pós-condições:
- *      - O livro é adicionado no início da lista
- *      - O campo pos_cabeca do cabeçalho é atualizado
- *      - Se houver espaço livre disponível, ele é reutilizado
- *      - Se não houver, o livro é inserido na posição final (pos_topo é incrementado)
- *      - retorno SUCESSO (0) em caso de sucesso
- *      - retorna código de erro negativo em caso de falhas (ex: erro ao abrir, ler, ou escrever)
+ *      - Registros da lista de livres são copiados sem textos.
+ *      - Retorna SUCESSO (0) ou um código de erro negativo.
  */
-int cadastrar_livro(const char *nome_arquivo, LIVRO novo) {
-        if(verificar_id_livro(nome_arquivo, novo.codigo) == ERRO_CONFLITO_ID)
-                return ERRO_CONFLITO_ID;
+static int converter_registros_antigos(FILE *antigo, int formato_referencias, FILE *novo, AREA_TEXTOS *textos, const CABECALHO_VERSAO_0 *cab) {
+        size_t tamanho_antigo = formato_referencias ? sizeof(LIVRO_FORMATO_REFERENCIAS) : sizeof(LIVRO_FORMATO_ANTIGO);
+        size_t deslocamento_prox = formato_referencias ? offsetof(LIVRO_FORMATO_REFERENCIAS, prox) : offsetof(LIVRO_FORMATO_ANTIGO, prox);
 
-        FILE *arq = fopen(nome_arquivo, "rb+");
-        if (!arq) return ERRO_ABRIR_ARQUIVO;
-
-        CABECALHO *cab = le_cabecalho(arq);
-        if (!cab) {
-                fclose(arq);
-                return ERRO_LER_CABECALHO;
+        int retorno = SUCESSO;
+        unsigned char *livres = calloc((size_t)cab->pos_topo / 8 + 1, 1);
+        unsigned char *bloco = malloc(REGISTROS_POR_BLOCO * tamanho_antigo);
+        if (livres == NULL || bloco == NULL) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_vetores;
         }
 
-        int nova_pos;
-        if (cab->pos_livre == -1) {
-                // Sem espaço livre: insere no final
-                nova_pos = cab->pos_topo;
-                if(fseek(arq, 0, SEEK_END)!=0) {
-                        free(cab);
-                        return ERRO_ARQUIVO_SEEK;
+        // marcar posições da lista de livres (limitado a pos_topo passos para não entrar em ciclo)
+        long inicio = ftell(antigo);
+        int pos = cab->pos_livre;
+        for (int passos = 0; pos >= 0 && pos < cab->pos_topo && passos < cab->pos_topo; passos++) {
+                livres[pos / 8] |= (unsigned char)(1 << (pos % 8));
+                if (fseek(antigo, inicio + (long)pos * (long)tamanho_antigo + (long)deslocamento_prox, SEEK_SET) != 0) {
+                        retorno = ERRO_ARQUIVO_SEEK;
+                        goto liberar_vetores;
                 }
-        }
-        else {
-                // Reaproveita espaço
-                nova_pos = cab->pos_livre;
-                LIVRO *livro_removido = le_no_livro(arq, nova_pos);
-                if (livro_removido==NULL) {
-                        free(cab);
-                        fclose(arq);
-                        return ERRO_ARQUIVO_READ;
+                if (fread(&pos, sizeof(int), 1, antigo) != 1) {
+                        retorno = ERRO_ARQUIVO_READ;
+                        goto liberar_vetores;
                 }
-                cab->pos_livre = livro_removido->prox;
-                free(livro_removido);
         }
 
-        // Inserção no início da lista encadeada
-        novo.prox = cab->pos_cabeca;
-        if (escreve_no_livro(arq, &novo, nova_pos) != 0) {
-                free(cab);
-                fclose(arq);
-                return ERRO_ARQUIVO_WRITE;
+        if (fseek(antigo, inicio, SEEK_SET) != 0) {
+                retorno = ERRO_ARQUIVO_SEEK;
+                goto liberar_vetores;
         }
 
-        cab->pos_cabeca = nova_pos;
+        for (int base = 0; base < cab->pos_topo; base += REGISTROS_POR_BLOCO) {
+                int quantidade = cab->pos_topo - base;
+                if (quantidade > REGISTROS_POR_BLOCO)
+                        quantidade = REGISTROS_POR_BLOCO;
+
+                if (fread(bloco, tamanho_antigo, quantidade, antigo) != (size_t)quantidade) {
+                        retorno = ERRO_ARQUIVO_READ;
+                        goto liberar_vetores;
+                }
 
-        if (nova_pos == cab->pos_topo)
-                cab->pos_topo++;
+                for (int i = 0; i < quantidade; i++) {
+                        int posicao = base + i;
+                        int livre = (livres[posicao / 8] & (1 << (posicao % 8))) != 0;
+                        REGISTRO_LIVRO registro;
+                        REFERENCIA_TEXTO referencias[COLUNAS_TEXTO_LIVRO];
 
-        if (escreve_cabecalho(arq, cab) != 0) {
-                free(cab);
-                fclose(arq);
-                return ERRO_ESCREVER_CABECALHO;
+                        if ((retorno = converter_registro_antigo(bloco + (size_t)i * tamanho_antigo, formato_referencias, livre, textos, &registro, referencias)) != SUCESSO ||
+                            (retorno = textos_gravar_referencias(textos, posicao, referencias)) != SUCESSO) {
+                                goto liberar_vetores;
+                        }
+                        if (fwrite(&registro, sizeof(REGISTRO_LIVRO), 1, novo) != 1) {
+                                retorno = ERRO_ARQUIVO_WRITE;
+                                goto liberar_vetores;
+                        }
+                }
         }
 
-        free(cab);
-        fclose(arq);
-        return SUCESSO;
+liberar_vetores:
+        free(livres);
+        free(bloco);
+
+        return retorno;
 }
 
-/*
- * imprimir_livro - Imprime os dados de um livro com base no código fornecido
- *
- * @nome_arq - nome do arquivo binário contendo os livros
- * @codigo   - código do livro a ser impresso
- *
- * Pré-condições:
- *      - O arquivo deve estar aberto para leitura
- *
- * Pós-condições:
- *      - Os dados do livro com o código fornecido são impressos na tela, se encontrado
- *      - Retorna SUCESSO (0) em caso de sucesso
- *      - Retorna código de erro negativo se não encontrado ou ocorrer erro de leitura
- */
-int imprimir_livro(const char *nome_arq, int codigo) {
-        FILE *arq = fopen(nome_arq, "rb");
-        if (!arq) {
+int converter_livros_formato_antigo(const char *nome_arq) {
+        int retorno = SUCESSO;
+        char caminho_referencias[TAM_MAX_CAMINHO];
+        char caminho_textos[TAM_MAX_CAMINHO];
+        char caminho_novo[TAM_MAX_CAMINHO];
+        char caminho_referencias_novo[TAM_MAX_CAMINHO];
+        char caminho_textos_novo[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_referencias, nome_arq, EXTENSAO_REFERENCIAS_TEXTO);
+        trocar_extensao(caminho_textos, nome_arq, EXTENSAO_TEXTOS);
+        trocar_extensao(caminho_novo, nome_arq, "_conv.dat");
+        trocar_extensao(caminho_referencias_novo, caminho_novo, EXTENSAO_REFERENCIAS_TEXTO);
+        trocar_extensao(caminho_textos_novo, caminho_novo, EXTENSAO_TEXTOS);
+
+        // livro.str sem livro.col: textos já estão fora do registro, só as referências mudam de arquivo
+        FILE *textos_existentes = fopen(caminho_textos, "rb");
+        int formato_referencias = textos_existentes != NULL;
+        if (textos_existentes != NULL)
+                fclose(textos_existentes);
+        size_t tamanho_antigo = formato_referencias ? sizeof(LIVRO_FORMATO_REFERENCIAS) : sizeof(LIVRO_FORMATO_ANTIGO);
+
+        // a conversão lê o arquivo por stdio: alterações ainda no cache de páginas precisam estar no arquivo
+        if (descarregar_caminho_dados(nome_arq) != SUCESSO)
+                return ERRO_ARQUIVO_WRITE;
+
+        FILE *antigo = fopen(nome_arq, "rb");
+        if (antigo == NULL)
                 return ERRO_ABRIR_ARQUIVO;
+
+        CABECALHO_VERSAO_0 cab;
+        long tamanho;
+        if (fread(&cab, sizeof(CABECALHO_VERSAO_0), 1, antigo) != 1 || cab.pos_topo < 0) {
+                retorno = ERRO_LER_CABECALHO;
+                goto fechar_antigo;
+        }
+        if (fseek(antigo, 0, SEEK_END) != 0 || (tamanho = ftell(antigo)) < 0 || fseek(antigo, sizeof(CABECALHO_VERSAO_0), SEEK_SET) != 0) {
+                retorno = ERRO_ARQUIVO_SEEK;
+                goto fechar_antigo;
+        }
+        if (tamanho < (long)sizeof(CABECALHO_VERSAO_0) + (long)cab.pos_topo * (long)tamanho_antigo) {
+                retorno = ERRO_ARQUIVO_READ;
+                goto fechar_antigo;
         }
 
-        CABECALHO cab;
-        if (fread(&cab, sizeof(CABECALHO), 1, arq) != 1) {
-                fclose(arq);
-                return ERRO_LER_CABECALHO	;
+        FILE *novo = fopen(caminho_novo, "w+b");
+        if (novo == NULL) {
+                retorno = ERRO_ABRIR_ARQUIVO;
+                goto fechar_antigo;
         }
 
-        int pos = cab.pos_cabeca;
-        LIVRO livro;
-        while (pos != -1) {
-                if (fseek(arq, sizeof(CABECALHO) + pos * sizeof(LIVRO), SEEK_SET) != 0) {
-                        fclose(arq);
-                        return ERRO_ARQUIVO_SEEK;
-                }
+        AREA_TEXTOS textos;
+        if ((retorno = textos_criar(caminho_novo)) != SUCESSO ||
+            (retorno = textos_abrir(&textos, caminho_novo, COLUNAS_TEXTO_LIVRO, "ab")) != SUCESSO) {
+                goto fechar_novo;
+        }
 
-                if (fread(&livro, sizeof(LIVRO), 1, arq) != 1) {
-                        fclose(arq);
-                        return ERRO_ARQUIVO_READ;
-                }
+        // cabeçalho atual; os contadores são calculados depois que os registros forem gravados
+        CABECALHO cab_novo;
+        memset(&cab_novo, 0, sizeof(CABECALHO));
+        cab_novo.pos_cabeca = cab.pos_cabeca;
+        cab_novo.pos_topo = cab.pos_topo;
+        cab_novo.pos_livre = cab.pos_livre;
+        cab_novo.pos_devolvidos = -1;
+        cab_novo.assinatura = ASSINATURA_CABECALHO;
+        cab_novo.versao = VERSAO_CABECALHO;
 
-                if (livro.codigo == codigo) {
-                        printf("Codigo: %d\nTitulo: %s\nAutor: %s\nEditora: %s\nEdicao: %d\nAno: %d\nExemplares: %d\n\n",
-                        livro.codigo, livro.titulo, livro.autor, livro.editora,
-                        livro.edicao, livro.ano, livro.exemplares);
-                        fclose(arq);
-                        return SUCESSO;
-                }
+        if (fwrite(&cab_novo, sizeof(CABECALHO), 1, novo) != 1)
+                retorno = ERRO_ARQUIVO_WRITE;
+        else if ((retorno = converter_registros_antigos(antigo, formato_referencias, novo, &textos, &cab)) == SUCESSO)
+                retorno = recalcular_contadores(novo, sizeof(REGISTRO_LIVRO), offsetof(REGISTRO_LIVRO, prox), contabilizar_livro);
 
-                pos = livro.prox;
+        if (textos_fechar(&textos) != SUCESSO && retorno == SUCESSO)
+                retorno = ERRO_ARQUIVO_WRITE;
+fechar_novo:
+        if (fclose(novo) != 0 && retorno == SUCESSO)
+                retorno = ERRO_ARQUIVO_WRITE;
+fechar_antigo:
+        fclose(antigo);
+
+        if (retorno == SUCESSO && substituir_arquivo(caminho_novo, nome_arq) != 0)
+                retorno = ERRO_ABRIR_ARQUIVO;
+
+        if (retorno != SUCESSO) {
+                remove(caminho_novo);
+                remove(caminho_referencias_novo);
+                remove(caminho_textos_novo);
         }
+        // livro.dat é trocado primeiro e livro.str por último: se uma troca falhar, a próxima
+        // inicialização identifica o formato pelos arquivos que faltam e recusa o livro.dat já
+        // convertido (verificação de tamanho); os arquivos *_conv restantes são mantidos
+        else if (
+                substituir_arquivo(caminho_referencias_novo, caminho_referencias) != 0 ||
+                (formato_referencias ? remove(caminho_textos_novo) : substituir_arquivo(caminho_textos_novo, caminho_textos)) != 0
+        ) {
+                retorno = ERRO_ABRIR_ARQUIVO;
+        }
+
+        // páginas do arquivo antigo guardadas no cache ficaram desatualizadas
+        descartar_caminho_dados(nome_arq);
 
-        //livro nao encontrado
-        fclose(arq);
-	        return ERRO_ENCONTRAR_LIVRO;
+        return retorno;
 }
 
 /*
- * listar_todos_livros - Lista todos os livros cadastrados na lista encadeada do arquivo
+ * reconstruir_indice_livro - Recria o índice hash (livro.idx) percorrendo a lista de livros
  *
  * @nome_arq - nome do arquivo binário contendo os livros
  *
  * Pré-condições:
- *      - O arquivo pode ser aberto para leitura
+ *      - O arquivo deve existir e estar inicializado com um cabeçalho válido
  *
  * Pós-condições:
- *      - Os dados de todos os livros (em ordem lógica) são impressos na tela
+ *      - O arquivo de índice é recriado contendo todos os livros da lista
  *      - Retorna SUCESSO (0) em caso de sucesso
- *      - Retorna valor negativo em caso de erro
+ *      - Retorna código de erro negativo em caso de falha
  */
-int listar_todos_livros(const char *nome_arq) {
-        FILE *arquivo = fopen(nome_arq, "rb");
-        if (!arquivo) {
+int reconstruir_indice_livro(const char *nome_arq) {
+        int retorno = SUCESSO;
+        FILE *arq = abrir_arquivo_dados(nome_arq, "rb");
+        if (!arq) {
                 return ERRO_ABRIR_ARQUIVO;
         }
 
         CABECALHO cab;
-        if (fread(&cab, sizeof(CABECALHO), 1, arquivo) != 1) {
-                fclose(arquivo);
+        if (ler_cabecalho_dados(arq, &cab) != SUCESSO) {
+                fechar_arquivo_dados(arq);
                 return ERRO_LER_CABECALHO;
         }
 
-        int pos = cab.pos_cabeca;
-        LIVRO livro;
-        if (pos == -1) {
-                printf("Nenhum livro cadastrado.\n");
+        // pos_topo é um limite superior para a quantidade de livros ativos
+        int capacidade = cab.pos_topo > 0 ? cab.pos_topo : 1;
+        unsigned long long *chaves = malloc(capacidade * sizeof(unsigned long long));
+        int *posicoes = malloc(capacidade * sizeof(int));
+        if (chaves == NULL || posicoes == NULL) {
+                retorno = ERRO_ESCREVER_INDICE;
+                goto liberar_vetores;
         }
 
-        while (pos != -1) {
-                if (fseek(arquivo, sizeof(CABECALHO) + pos * sizeof(LIVRO), SEEK_SET) != 0) {
-                        fclose(arquivo);
-                        return ERRO_ARQUIVO_SEEK;
+        int quantidade = 0;
+        int pos = cab.pos_cabeca;
+        REGISTRO_LIVRO copia;
+        while (pos != -1 && quantidade < capacidade) {
+                const REGISTRO_LIVRO *livro = acessar_registro(arq, pos, sizeof(REGISTRO_LIVRO), &copia);
+                if (livro == NULL) {
+                        retorno = ERRO_ARQUIVO_READ;
+                        goto liberar_vetores;
                 }
 
-                if (fread(&livro, sizeof(LIVRO), 1, arquivo) != 1) {
-                        fclose(arquivo);
-                        return ERRO_ARQUIVO_READ;
-                }
+                chaves[quantidade] = (unsigned int)livro->codigo;
+                posicoes[quantidade] = pos;
+                quantidade++;
 
-                printf("Codigo: %d | Titulo: %s | Autor: %s | Ano: %d | Exemplares: %d\n",
-                livro.codigo, livro.titulo, livro.autor, livro.ano, livro.exemplares);
-                pos = livro.prox;
+                pos = livro->prox;
         }
 
-        fclose(arquivo);
-        return SUCESSO;
+        char caminho_indice[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_indice, nome_arq, ".idx");
+        retorno = indice_hash_construir(caminho_indice, chaves, posicoes, quantidade);
+
+liberar_vetores:
+        free(chaves);
+        free(posicoes);
+        fechar_arquivo_dados(arq);
+
+        return retorno;
 }
 
 /*
- * buscar_autor_livro - Lista todos os livros escritos por um autor específico
- *
- * @nome_arq - nome do arquivo binário contendo os livros
- * @autor    - nome do autor a ser buscado
+ * trigramas_livro - função interna que monta o conjunto de trigramas de título, autor e editora
  *
- * Pré-condições:
- *      - O arquivo pode ser aberto para leitura
+ * @livro - livro com os textos preenchidos
+ * @trigramas - vetor com capacidade para MAX_TRIGRAMAS_LIVRO trigramas
  *
  * Pós-condições:
- *      - Títulos dos livros do autor são impressos na tela
- *      - Retorna SUCESSO (0) em caso de sucesso
- *      - Retorna código negativo em caso de erro
+ *      - Retorna a quantidade de trigramas distintos, ordenados, no início do vetor.
  */
-int buscar_autor_livro(const char *nome_arq, const char *autor) {
-        FILE *arq = fopen(nome_arq, "rb");
+static int trigramas_livro(const LIVRO *livro, unsigned char *trigramas) {
+        char normalizado[MAX_AUTOR + 1];
+        const char *campos[] = { livro->titulo, livro->autor, livro->editora };
+        int quantidade = 0;
+
+        // cada campo separadamente: não há trigramas atravessando a divisa entre dois campos
+        for (int i = 0; i < COLUNAS_TEXTO_LIVRO; i++) {
+                normalizar_texto(campos[i], normalizado, sizeof(normalizado));
+                quantidade = extrair_trigramas(normalizado, trigramas, quantidade, MAX_TRIGRAMAS_LIVRO);
+        }
+
+        return ordenar_trigramas(trigramas, quantidade);
+}
+
+/*
+ * comparar_pares_trigrama - função interna de comparação para qsort (trigrama e, em seguida, posição em big-endian)
+ */
+static int comparar_pares_trigrama(const void *a, const void *b) {
+        return memcmp(a, b, TAM_TRIGRAMA + 4);
+}
+
+int reconstruir_indice_trigramas(const char *nome_arq) {
+        int retorno = SUCESSO;
+        FILE *arq = abrir_arquivo_dados(nome_arq, "rb");
         if (!arq) {
                 return ERRO_ABRIR_ARQUIVO;
         }
 
+        AREA_TEXTOS textos;
+        if (textos_abrir(&textos, nome_arq, COLUNAS_TEXTO_LIVRO, "rb") != SUCESSO) {
+                fechar_arquivo_dados(arq);
+                return ERRO_ABRIR_ARQUIVO;
+        }
+
+        unsigned char *pares = NULL, *termos = NULL;
+        int *posicoes = NULL;
         CABECALHO cab;
-        if (fread(&cab, sizeof(CABECALHO), 1, arq) != 1) {
-                fclose(arq);
-                return ERRO_LER_CABECALHO;
+        if (ler_cabecalho_dados(arq, &cab) != SUCESSO) {
+                retorno = ERRO_LER_CABECALHO;
+                goto fechar_arquivos;
         }
 
+        // par = trigrama seguido da posição em big-endian; o vetor cresce conforme os livros são lidos
+        size_t tamanho_par = TAM_TRIGRAMA + 4;
+        int quantidade = 0, capacidade = 0;
         int pos = cab.pos_cabeca;
+        REGISTRO_LIVRO copia;
         LIVRO livro;
-        int encontrado = 0;
-
+        unsigned char trigramas[MAX_TRIGRAMAS_LIVRO * TAM_TRIGRAMA];
         while (pos != -1) {
-                if (fseek(arq, sizeof(CABECALHO) + pos * sizeof(LIVRO), SEEK_SET) != 0) {
-                        fclose(arq);
-                        return ERRO_ARQUIVO_SEEK;
+                const REGISTRO_LIVRO *registro = acessar_registro(arq, pos, sizeof(REGISTRO_LIVRO), &copia);
+                if (registro == NULL) {
+                        retorno = ERRO_ARQUIVO_READ;
+                        goto liberar_vetores;
                 }
+                int prox = registro->prox;
+                if ((retorno = montar_livro(&textos, pos, registro, &livro)) != SUCESSO)
+                        goto liberar_vetores;
 
-                if (fread(&livro, sizeof(LIVRO), 1, arq) != 1) {
-                        fclose(arq);
-                        return ERRO_ARQUIVO_READ;
+                int num_trigramas = trigramas_livro(&livro, trigramas);
+                if (quantidade + num_trigramas > capacidade) {
+                        int nova_capacidade = capacidade > 0 ? capacidade * 2 : 4096;
+                        while (nova_capacidade < quantidade + num_trigramas)
+                                nova_capacidade *= 2;
+                        unsigned char *novos = realloc(pares, (size_t)nova_capacidade * tamanho_par);
+                        if (novos == NULL) {
+                                retorno = ERRO_ALOCAR_MEMORIA;
+                                goto liberar_vetores;
+                        }
+                        pares = novos;
+                        capacidade = nova_capacidade;
                 }
-
-                if (strcmp(livro.autor, autor) == 0) {
-                        printf("Titulo: %s | Codigo: %d\n", livro.titulo, livro.codigo);
-                        encontrado = 1;
+                for (int i = 0; i < num_trigramas; i++) {
+                        unsigned char *par = pares + (size_t)quantidade * tamanho_par;
+                        memcpy(par, trigramas + (size_t)i * TAM_TRIGRAMA, TAM_TRIGRAMA);
+                        arvore_bmais_codificar_inteiro((unsigned int)pos, par + TAM_TRIGRAMA);
+                        quantidade++;
                 }
 
-                pos = livro.prox;
+                pos = prox;
         }
-        fclose(arq);
-        return SUCESSO;
+
+        termos = malloc((size_t)(quantidade > 0 ? quantidade : 1) * TAM_TRIGRAMA);
+        posicoes = malloc((size_t)(quantidade > 0 ? quantidade : 1) * sizeof(int));
+        if (termos == NULL || posicoes == NULL) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_vetores;
+        }
+
+        if (quantidade > 0)
+                qsort(pares, quantidade, tamanho_par, comparar_pares_trigrama);
+        for (int i = 0; i < quantidade; i++) {
+                const unsigned char *par = pares + (size_t)i * tamanho_par;
+                memcpy(termos + (size_t)i * TAM_TRIGRAMA, par, TAM_TRIGRAMA);
+                posicoes[i] = (int)arvore_bmais_decodificar_inteiro(par + TAM_TRIGRAMA);
+        }
+
+        char caminho_indice[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_indice, nome_arq, EXTENSAO_INDICE_TRIGRAMA);
+        retorno = indice_invertido_construir(caminho_indice, TAM_TRIGRAMA, termos, posicoes, quantidade);
+
+liberar_vetores:
+        free(pares);
+        free(termos);
+        free(posicoes);
+fechar_arquivos:
+        textos_fechar(&textos);
+        fechar_arquivo_dados(arq);
+
+        return retorno;
 }
 
 /*
- * buscar_titulo_livro - Busca e imprime os dados de um livro com base no título
- *
- * @nome_arq - nome do arquivo binário contendo os livros
- * @titulo   - título do livro a ser buscado
+ * montar_termo_autor - função interna que monta o termo do índice de autores
  *
- * Pré-condições:
- *      - O arquivo deve estar aberto para leitura
+ * @autor - nome do autor (só os TAM_AUTOR_INDICE primeiros bytes entram no termo)
+ * @termo - buffer com TAM_AUTOR_INDICE bytes, completado com '\0'
+ */
+static void montar_termo_autor(const char *autor, unsigned char *termo) {
+        memset(termo, 0, TAM_AUTOR_INDICE);
+        size_t tamanho = strlen(autor);
+        memcpy(termo, autor, tamanho < TAM_AUTOR_INDICE ? tamanho : TAM_AUTOR_INDICE);
+}
+
+/*
+ * indice_invertido_livros - função interna que obtém o dicionário e as listas de um índice invertido dos
+ * livros, mantidos abertos na BIBLIOTECA (biblioteca_indice)
  *
  * Pós-condições:
- *      - Dados do livro encontrado são exibidos na tela
- *      - Retorna SUCESSO (0) em caso de sucesso
- *      - Retorna código de erro negativo se não encontrado ou ocorrer erro de leitura
+ *      - Retorna SUCESSO (0) ou ERRO_ABRIR_ARQUIVO (-10) se algum dos dois arquivos não existir; o
+ *      chamador fecha os índices (biblioteca_fechar_indices) antes de reconstruí-lo.
  */
-int buscar_titulo_livro(const char *nome_arq, const char *titulo) {
-        FILE *arq = fopen(nome_arq, "rb");
+static int indice_invertido_livros(ARQUIVO_BIBLIOTECA *livros, const char *extensao_dicionario, const char *extensao_listas, FILE **dicionario, FILE **listas) {
+        *dicionario = biblioteca_indice(livros, extensao_dicionario);
+        *listas = biblioteca_indice(livros, extensao_listas);
+        return *dicionario != NULL && *listas != NULL ? SUCESSO : ERRO_ABRIR_ARQUIVO;
+}
+
+/*
+ * comparar_pares_autor - função interna de comparação para qsort (termo e, em seguida, posição em big-endian)
+ */
+static int comparar_pares_autor(const void *a, const void *b) {
+        return memcmp(a, b, TAM_AUTOR_INDICE + 4);
+}
+
+int reconstruir_indice_autor(const char *nome_arq) {
+        int retorno = SUCESSO;
+        FILE *arq = abrir_arquivo_dados(nome_arq, "rb");
         if (!arq) {
                 return ERRO_ABRIR_ARQUIVO;
         }
 
+        AREA_TEXTOS textos;
+        if (textos_abrir(&textos, nome_arq, COLUNAS_TEXTO_LIVRO, "rb") != SUCESSO) {
+                fechar_arquivo_dados(arq);
+                return ERRO_ABRIR_ARQUIVO;
+        }
 
         CABECALHO cab;
-        if (fread(&cab, sizeof(CABECALHO), 1, arq) != 1) {
-                fclose(arq);
-                return ERRO_LER_CABECALHO;
+        if (ler_cabecalho_dados(arq, &cab) != SUCESSO) {
+                retorno = ERRO_LER_CABECALHO;
+                goto fechar_arquivos;
         }
 
-        int pos = cab.pos_cabeca;
-        LIVRO livro;
+        // par = termo seguido da posição em big-endian: uma só ordenação agrupa os termos com as posições em ordem
+        int capacidade = cab.pos_topo > 0 ? cab.pos_topo : 1;
+        size_t tamanho_par = TAM_AUTOR_INDICE + 4;
+        unsigned char *pares = malloc((size_t)capacidade * tamanho_par);
+        unsigned char *termos = malloc((size_t)capacidade * TAM_AUTOR_INDICE);
+        int *posicoes = malloc((size_t)capacidade * sizeof(int));
+        if (pares == NULL || termos == NULL || posicoes == NULL) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_vetores;
+        }
 
-        while (pos != -1) {
-                if (fseek(arq, sizeof(CABECALHO) + pos * sizeof(LIVRO), SEEK_SET) != 0) {
-                        fclose(arq);
-                        return ERRO_ARQUIVO_SEEK;
-                }
-                if (fread(&livro, sizeof(LIVRO), 1, arq) != 1) {
-                        fclose(arq);
-                        return ERRO_ARQUIVO_READ;
+        int quantidade = 0;
+        int pos = cab.pos_cabeca;
+        REGISTRO_LIVRO copia;
+        char autor[TAM_AUTOR_INDICE + 1];
+        while (pos != -1 && quantidade < capacidade) {
+                const REGISTRO_LIVRO *livro = acessar_registro(arq, pos, sizeof(REGISTRO_LIVRO), &copia);
+                if (livro == NULL) {
+                        retorno = ERRO_ARQUIVO_READ;
+                        goto liberar_vetores;
                 }
 
-                if (strcmp(livro.titulo, titulo) == 0) {
-                        printf("Codigo: %d\nTitulo: %s\nAutor: %s\nEditora: %s\nEdicao: %d\nAno: %d\nExemplares: %d\n\n",
-                        livro.codigo, livro.titulo, livro.autor, livro.editora,
-                        livro.edicao, livro.ano, livro.exemplares);
-                        fclose(arq);
-                        return SUCESSO;
+                REFERENCIA_TEXTO referencias[COLUNAS_TEXTO_LIVRO];
+                if ((retorno = textos_ler_referencias(&textos, pos, referencias)) != SUCESSO ||
+                    (retorno = textos_ler(&textos, referencias[COLUNA_AUTOR], autor, sizeof(autor))) != SUCESSO) {
+                        goto liberar_vetores;
                 }
 
-                pos = livro.prox;
+                unsigned char *par = pares + (size_t)quantidade * tamanho_par;
+                montar_termo_autor(autor, par);
+                arvore_bmais_codificar_inteiro((unsigned int)pos, par + TAM_AUTOR_INDICE);
+                quantidade++;
+
+                pos = livro->prox;
         }
 
-        printf("Livro com titulo \"%s\" não encontrado.\n", titulo);
-        fclose(arq);
+        qsort(pares, quantidade, tamanho_par, comparar_pares_autor);
+        for (int i = 0; i < quantidade; i++) {
+                const unsigned char *par = pares + (size_t)i * tamanho_par;
+                memcpy(termos + (size_t)i * TAM_AUTOR_INDICE, par, TAM_AUTOR_INDICE);
+                posicoes[i] = (int)arvore_bmais_decodificar_inteiro(par + TAM_AUTOR_INDICE);
+        }
 
-        return ERRO_ENCONTRAR_LIVRO;
+        char caminho_indice[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_indice, nome_arq, EXTENSAO_INDICE_AUTOR);
+        retorno = indice_invertido_construir(caminho_indice, TAM_AUTOR_INDICE, termos, posicoes, quantidade);
+
+liberar_vetores:
+        free(pares);
+        free(termos);
+        free(posicoes);
+fechar_arquivos:
+        textos_fechar(&textos);
+        fechar_arquivo_dados(arq);
+
+        return retorno;
 }
 
 /*
-* calcular_total_livros - retorna a quantia total de livros
-* @nome_arq - nome do arquivo binário contendo os livros
-*
-* Pré-condições:
-*       - O arquivo deve estar aberto para leitura
-*
-* Pós-condições:
-*       - Quantia de livros disponiveis é exibida
-*       - Retorna SUCESSO (0) em caso de sucesso
-*       - Retorna código de erro negativo se não encontrado ou ocorrer erro de leitura
-*
-*/
-int calcular_total_livros(const char *nome_arq){
-        int total=0;
-        FILE *arq = fopen(nome_arq, "rb");
+ * montar_chave_titulo - função interna que monta a chave da árvore de títulos
+ *
+ * @titulo - título do livro (só os TAM_TITULO_INDICE primeiros bytes entram na chave)
+ * @codigo - código do livro, que desempata títulos iguais
+ * @chave - buffer com TAM_CHAVE_TITULO bytes
+ *
+ * O título é completado com '\0', de forma que memcmp preserve a ordem de strcmp; o código
+ * vai em big-endian nos 4 bytes finais.
+ */
+static void montar_chave_titulo(const char *titulo, unsigned int codigo, unsigned char *chave) {
+        memset(chave, 0, TAM_TITULO_INDICE);
+        size_t tamanho = strlen(titulo);
+        memcpy(chave, titulo, tamanho < TAM_TITULO_INDICE ? tamanho : TAM_TITULO_INDICE);
+        arvore_bmais_codificar_inteiro(codigo, chave + TAM_TITULO_INDICE);
+}
+
+/*
+ * comparar_chaves_titulo - função interna de comparação para qsort (ordem das chaves na árvore)
+ */
+static int comparar_chaves_titulo(const void *a, const void *b) {
+        return memcmp(a, b, TAM_CHAVE_TITULO);
+}
+
+int reconstruir_indice_titulo(const char *nome_arq) {
+        int retorno = SUCESSO;
+        FILE *arq = abrir_arquivo_dados(nome_arq, "rb");
         if (!arq) {
-                return ERRO_ABRIR_ARQUIVO	;
+                return ERRO_ABRIR_ARQUIVO;
+        }
+
+        AREA_TEXTOS textos;
+        if (textos_abrir(&textos, nome_arq, COLUNAS_TEXTO_LIVRO, "rb") != SUCESSO) {
+                fechar_arquivo_dados(arq);
+                return ERRO_ABRIR_ARQUIVO;
         }
 
         CABECALHO cab;
-        if (fread(&cab, sizeof(CABECALHO), 1, arq) != 1) {
-                fclose(arq);
-                return ERRO_LER_CABECALHO	;
+        if (ler_cabecalho_dados(arq, &cab) != SUCESSO) {
+                retorno = ERRO_LER_CABECALHO;
+                goto fechar_arquivos;
+        }
+
+        // pos_topo é um limite superior para a quantidade de livros ativos; cada chave leva a posição logo depois
+        int capacidade = cab.pos_topo > 0 ? cab.pos_topo : 1;
+        size_t tamanho_par = TAM_CHAVE_TITULO + sizeof(int);
+        unsigned char *pares = malloc((size_t)capacidade * tamanho_par);
+        unsigned char *chaves = malloc((size_t)capacidade * TAM_CHAVE_TITULO);
+        int *posicoes = malloc((size_t)capacidade * sizeof(int));
+        if (pares == NULL || chaves == NULL || posicoes == NULL) {
+                retorno = ERRO_ESCREVER_INDICE;
+                goto liberar_vetores;
         }
 
+        int quantidade = 0;
         int pos = cab.pos_cabeca;
-        LIVRO livro;
-        while (pos != -1) {
-                if (fseek(arq, sizeof(CABECALHO) + pos * sizeof(LIVRO), SEEK_SET) != 0) {
-                        fclose(arq);
-                        return ERRO_ARQUIVO_SEEK;
+        REGISTRO_LIVRO copia;
+        char titulo[TAM_TITULO_INDICE + 1];
+        while (pos != -1 && quantidade < capacidade) {
+                const REGISTRO_LIVRO *livro = acessar_registro(arq, pos, sizeof(REGISTRO_LIVRO), &copia);
+                if (livro == NULL) {
+                        retorno = ERRO_ARQUIVO_READ;
+                        goto liberar_vetores;
                 }
 
-                if (fread(&livro, sizeof(LIVRO), 1, arq) != 1) {
-                        fclose(arq);
-                        return ERRO_ARQUIVO_READ;
+                // só o trecho do título que entra na chave precisa ser lido
+                REFERENCIA_TEXTO referencias[COLUNAS_TEXTO_LIVRO];
+                if ((retorno = textos_ler_referencias(&textos, pos, referencias)) != SUCESSO ||
+                    (retorno = textos_ler(&textos, referencias[COLUNA_TITULO], titulo, sizeof(titulo))) != SUCESSO) {
+                        goto liberar_vetores;
                 }
 
-                total++;
+                unsigned char *par = pares + (size_t)quantidade * tamanho_par;
+                montar_chave_titulo(titulo, (unsigned int)livro->codigo, par);
+                memcpy(par + TAM_CHAVE_TITULO, &pos, sizeof(int));
+                quantidade++;
 
-                pos = livro.prox;
+                pos = livro->prox;
         }
-        fclose(arq);
-        printf("Total de livros cadastrados: %d\n", total);
-        return 0;
+
+        qsort(pares, quantidade, tamanho_par, comparar_chaves_titulo);
+
+        // a árvore não aceita chaves repetidas (mesmo título e mesmo código)
+        int unicos = 0;
+        for (int i = 0; i < quantidade; i++) {
+                const unsigned char *par = pares + (size_t)i * tamanho_par;
+                if (unicos > 0 && memcmp(par, chaves + (size_t)(unicos - 1) * TAM_CHAVE_TITULO, TAM_CHAVE_TITULO) == 0)
+                        continue;
+                memcpy(chaves + (size_t)unicos * TAM_CHAVE_TITULO, par, TAM_CHAVE_TITULO);
+                memcpy(&posicoes[unicos], par + TAM_CHAVE_TITULO, sizeof(int));
+                unicos++;
+        }
+
+        char caminho_indice[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_indice, nome_arq, EXTENSAO_INDICE_TITULO);
+        retorno = arvore_bmais_construir(caminho_indice, TAM_CHAVE_TITULO, chaves, posicoes, unicos);
+
+liberar_vetores:
+        free(pares);
+        free(chaves);
+        free(posicoes);
+fechar_arquivos:
+        textos_fechar(&textos);
+        fechar_arquivo_dados(arq);
+
+        return retorno;
+}
+
+/*
+ * visitante_titulo - função interna chamada para cada livro que satisfaz uma busca por título
+ *
+ * @biblioteca - base aberta
+ * @posicao - posição do livro em livro.dat
+ * @registro - registro do livro
+ * @referencias - referências dos textos do livro
+ * @contexto - ponteiro repassado pela busca
+ *
+ * Deve retornar SUCESSO (0) ou um código de erro, que interrompe a busca.
+ */
+typedef int (*visitante_titulo)(BIBLIOTECA *biblioteca, int posicao, const REGISTRO_LIVRO *registro, const REFERENCIA_TEXTO *referencias, void *contexto);
+
+/*
+ * TITULO_PENDENTE - struct interna: livro de título longo guardado até o fim do seu grupo de chaves
+ *
+ * @posicao - posição do livro em livro.dat
+ * @registro / @referencias - registro e referências dos textos, repassados ao visitante
+ * @titulo - título completo, lido de livro.str
+ */
+typedef struct {
+        int posicao;
+        REGISTRO_LIVRO registro;
+        REFERENCIA_TEXTO referencias[COLUNAS_TEXTO_LIVRO];
+        char titulo[MAX_TITULO + 1];
+} TITULO_PENDENTE;
+
+/*
+ * CONTEXTO_BUSCA_TITULO - struct interna repassada ao visitante da varredura da árvore de títulos
+ *
+ * @inicial / @final - limites do intervalo de títulos (inclusive); na busca por prefixo, final é NULL
+ * e inicial é o prefixo
+ * @pendentes - livros cujas chaves têm os mesmos TAM_TITULO_INDICE bytes (@prefixo_pendente), que na
+ * árvore ficam em ordem de código e são visitados em ordem de título completo quando o grupo termina
+ */
+typedef struct {
+        BIBLIOTECA *biblioteca;
+        const char *inicial;
+        const char *final;
+        visitante_titulo visitar;
+        void *contexto;
+        int encontrados;
+        int erro;
+        TITULO_PENDENTE *pendentes;
+        int num_pendentes;
+        int capacidade_pendentes;
+        unsigned char prefixo_pendente[TAM_TITULO_INDICE];
+} CONTEXTO_BUSCA_TITULO;
+
+/*
+ * titulo_atende - função interna que verifica se um título satisfaz a busca
+ */
+static int titulo_atende(const CONTEXTO_BUSCA_TITULO *busca, const char *titulo) {
+        if (busca->final == NULL)
+                return strncmp(titulo, busca->inicial, strlen(busca->inicial)) == 0;
+        return strcmp(titulo, busca->inicial) >= 0 && strcmp(titulo, busca->final) <= 0;
+}
+
+/*
+ * comparar_titulos_pendentes - função interna de comparação para qsort (título completo, depois código)
+ */
+static int comparar_titulos_pendentes(const void *a, const void *b) {
+        const TITULO_PENDENTE *x = a, *y = b;
+        int comparacao = strcmp(x->titulo, y->titulo);
+        if (comparacao != 0)
+                return comparacao;
+        return (x->registro.codigo > y->registro.codigo) - (x->registro.codigo < y->registro.codigo);
+}
+
+/*
+ * visitar_pendentes - função interna que visita, em ordem de título completo, os livros do grupo pendente
+ *
+ * Pós-condições:
+ *      - O grupo fica vazio.
+ *      - Retorna 0 ou 1 se o visitante falhar (erro guardado em busca->erro).
+ */
+static int visitar_pendentes(CONTEXTO_BUSCA_TITULO *busca) {
+        int quantidade = busca->num_pendentes;
+        busca->num_pendentes = 0;
+        qsort(busca->pendentes, quantidade, sizeof(TITULO_PENDENTE), comparar_titulos_pendentes);
+
+        for (int i = 0; i < quantidade; i++) {
+                TITULO_PENDENTE *pendente = &busca->pendentes[i];
+                if ((busca->erro = busca->visitar(busca->biblioteca, pendente->posicao, &pendente->registro, pendente->referencias, busca->contexto)) != SUCESSO)
+                        return 1;
+                busca->encontrados++;
+        }
+
+        return 0;
+}
+
+/*
+ * visitar_chave_titulo - função interna chamada para cada chave do intervalo da árvore de títulos
+ *
+ * A chave só guarda os TAM_TITULO_INDICE primeiros bytes do título: títulos mais curtos são
+ * conferidos pela própria chave, sem acesso aos arquivos; os mais longos são lidos de livro.str
+ * e guardados até a primeira chave com outro início, para serem visitados em ordem de título
+ * completo (visitar_pendentes; o último grupo é visitado por buscar_titulos).
+ *
+ * Pós-condições:
+ *      - Retorna 0 para continuar a varredura ou 1 em caso de erro (guardado em busca->erro).
+ */
+static int visitar_chave_titulo(const unsigned char *chave, int posicao, void *contexto) {
+        CONTEXTO_BUSCA_TITULO *busca = contexto;
+        AREA_TEXTOS *textos = &busca->biblioteca->textos_livros;
+        REFERENCIA_TEXTO referencias[COLUNAS_TEXTO_LIVRO];
+        char titulo[MAX_TITULO + 1];
+
+        if (busca->num_pendentes > 0 && memcmp(chave, busca->prefixo_pendente, TAM_TITULO_INDICE) != 0 && visitar_pendentes(busca) != 0)
+                return 1;
+
+        memcpy(titulo, chave, TAM_TITULO_INDICE);
+        titulo[TAM_TITULO_INDICE] = '\0';
+        int completo = strlen(titulo) < TAM_TITULO_INDICE;
+        if (completo && !titulo_atende(busca, titulo))
+                return 0;
+
+        REGISTRO_LIVRO copia;
+        const REGISTRO_LIVRO *registro = acessar_registro(busca->biblioteca->livros.arquivo, posicao, sizeof(REGISTRO_LIVRO), &copia);
+        if (registro == NULL) {
+                busca->erro = ERRO_ARQUIVO_READ;
+                return 1;
+        }
+        if ((busca->erro = textos_ler_referencias(textos, posicao, referencias)) != SUCESSO)
+                return 1;
+
+        if (!completo) {
+                if ((busca->erro = textos_ler(textos, referencias[COLUNA_TITULO], titulo, sizeof(titulo))) != SUCESSO)
+                        return 1;
+                if (!titulo_atende(busca, titulo))
+                        return 0;
+
+                if (busca->num_pendentes == busca->capacidade_pendentes) {
+                        int nova_capacidade = busca->capacidade_pendentes > 0 ? busca->capacidade_pendentes * 2 : 16;
+                        TITULO_PENDENTE *novos = realloc(busca->pendentes, (size_t)nova_capacidade * sizeof(TITULO_PENDENTE));
+                        if (novos == NULL) {
+                                busca->erro = ERRO_ALOCAR_MEMORIA;
+                                return 1;
+                        }
+                        busca->pendentes = novos;
+                        busca->capacidade_pendentes = nova_capacidade;
+                }
+
+                TITULO_PENDENTE *pendente = &busca->pendentes[busca->num_pendentes++];
+                pendente->posicao = posicao;
+                pendente->registro = *registro;
+                memcpy(pendente->referencias, referencias, sizeof(referencias));
+                strcpy(pendente->titulo, titulo);
+                memcpy(busca->prefixo_pendente, chave, TAM_TITULO_INDICE);
+                return 0;
+        }
+
+        // a cópia do registro pode ser sobrescrita pelo visitante (cache de páginas)
+        REGISTRO_LIVRO livro = *registro;
+        if ((busca->erro = busca->visitar(busca->biblioteca, posicao, &livro, referencias, busca->contexto)) != SUCESSO)
+                return 1;
+
+        busca->encontrados++;
+        return 0;
+}
+
+/*
+ * buscar_titulos - função interna que percorre a árvore de títulos em um intervalo ou prefixo
+ *
+ * @biblioteca - base aberta
+ * @inicial - menor título do intervalo, ou o prefixo procurado
+ * @final - maior título do intervalo (inclusive), ou NULL para busca por prefixo
+ * @visitar - função chamada para cada livro encontrado, em ordem de título
+ * @contexto - ponteiro repassado para a função visitar
+ * @encontrados - ponteiro onde a quantidade de livros encontrados é armazenada
+ *
+ * Desce a árvore até o primeiro título do intervalo e segue as folhas: O(log n + k).
+ * Um índice ausente é reconstruído a partir da lista antes da busca.
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou um código de erro negativo.
+ */
+static int buscar_titulos(BIBLIOTECA *biblioteca, const char *inicial, const char *final, visitante_titulo visitar, void *contexto, int *encontrados) {
+        ARQUIVO_BIBLIOTECA *livros = &biblioteca->livros;
+        unsigned char chave_inicial[TAM_CHAVE_TITULO], chave_final[TAM_CHAVE_TITULO];
+
+        montar_chave_titulo(inicial, 0, chave_inicial);
+        if (final != NULL) {
+                montar_chave_titulo(final, 0xFFFFFFFFu, chave_final);
+        }
+        else {
+                // todos os títulos que começam com o prefixo: o restante da chave é completado com 0xFF
+                size_t tamanho = strlen(inicial);
+                if (tamanho > TAM_TITULO_INDICE)
+                        tamanho = TAM_TITULO_INDICE;
+                memset(chave_final, 0xFF, TAM_CHAVE_TITULO);
+                memcpy(chave_final, inicial, tamanho);
+        }
+
+        CONTEXTO_BUSCA_TITULO busca = { biblioteca, inicial, final, visitar, contexto, 0, SUCESSO, NULL, 0, 0, {0} };
+        FILE *indice = biblioteca_indice(livros, EXTENSAO_INDICE_TITULO);
+        if (indice == NULL && reconstruir_indice_titulo(livros->caminho) == SUCESSO)
+                indice = biblioteca_indice(livros, EXTENSAO_INDICE_TITULO);
+        int retorno = indice != NULL ? arvore_bmais_percorrer_intervalo_arquivo(indice, chave_inicial, chave_final, visitar_chave_titulo, &busca) : ERRO_ABRIR_ARQUIVO;
+
+        // o intervalo pode terminar no meio de um grupo de títulos longos
+        if (retorno == SUCESSO && busca.erro == SUCESSO && busca.num_pendentes > 0)
+                visitar_pendentes(&busca);
+        free(busca.pendentes);
+
+        if (retorno == SUCESSO)
+                retorno = busca.erro;
+        *encontrados = busca.encontrados;
+
+        return retorno;
+}
+
+/*
+ * ITEM_VARREDURA - função interna: texto de uma posição dentro do bloco em varredura
+ */
+typedef struct {
+        int posicao;
+        unsigned int deslocamento;
+        unsigned int tamanho;
+        int atende;
+} ITEM_VARREDURA;
+
+/*
+ * comparar_itens_deslocamento / comparar_itens_posicao - funções internas de comparação para qsort
+ */
+static int comparar_itens_deslocamento(const void *a, const void *b) {
+        const ITEM_VARREDURA *x = a, *y = b;
+        return (x->deslocamento > y->deslocamento) - (x->deslocamento < y->deslocamento);
+}
+
+static int comparar_itens_posicao(const void *a, const void *b) {
+        const ITEM_VARREDURA *x = a, *y = b;
+        return (x->posicao > y->posicao) - (x->posicao < y->posicao);
+}
+
+/*
+ * avaliar_grupo - função interna que aplica o filtro aos textos de um trecho lido de livro.str
+ *
+ * @itens - textos do grupo, em ordem de deslocamento
+ * @quantidade - quantidade de textos
+ * @trecho - bytes lidos, do início do primeiro texto ao fim do último
+ * @tamanho_trecho - tamanho do trecho
+ *
+ * Em FILTRO_CONTEM o trecho inteiro (incluindo os textos das outras colunas, entre os do grupo) é
+ * varrido de uma vez; cada ocorrência é atribuída ao texto que a contém, e ocorrências que
+ * atravessam o fim de um texto são descartadas.
+ */
+static void avaliar_grupo(ITEM_VARREDURA *itens, int quantidade, const char *trecho, size_t tamanho_trecho,
+                          int operacao, int ignorar_caixa, const char *padrao, size_t tamanho_padrao) {
+        unsigned int base = itens[0].deslocamento;
+
+        if (operacao != FILTRO_CONTEM) {
+                for (int i = 0; i < quantidade; i++) {
+                        size_t tamanho = itens[i].tamanho;
+                        int cabe = operacao == FILTRO_IGUAL ? tamanho == tamanho_padrao : tamanho >= tamanho_padrao;
+                        itens[i].atende = cabe && varredura_iguais(trecho + (itens[i].deslocamento - base), padrao, tamanho_padrao, ignorar_caixa);
+                }
+                return;
+        }
+
+        size_t inicio = 0;
+        int i = 0;
+        while (i < quantidade && inicio < tamanho_trecho) {
+                size_t ocorrencia = inicio + varredura_procurar(trecho + inicio, tamanho_trecho - inicio, padrao, tamanho_padrao, ignorar_caixa);
+                if (ocorrencia >= tamanho_trecho)
+                        break;
+
+                while (i < quantidade && itens[i].deslocamento - base + itens[i].tamanho <= ocorrencia)
+                        i++;
+                if (i == quantidade)
+                        break;
+
+                size_t comeco = itens[i].deslocamento - base;
+                size_t fim = comeco + itens[i].tamanho;
+                if (ocorrencia < comeco) {
+                        // ocorrência no texto de outra coluna: a busca continua no próximo texto do grupo
+                        inicio = comeco;
+                }
+                else if (ocorrencia + tamanho_padrao <= fim) {
+                        itens[i].atende = 1;
+                        inicio = fim;
+                        i++;
+                }
+                else {
+                        inicio = ocorrencia + 1;
+                }
+        }
+}
+
+/*
+ * varrer_livros - função interna que filtra os livros por uma coluna de texto, sem índice
+ *
+ * @biblioteca - base aberta
+ * @coluna - COLUNA_TITULO, COLUNA_AUTOR ou COLUNA_EDITORA
+ * @operacao - FILTRO_CONTEM, FILTRO_COMECA_COM ou FILTRO_IGUAL
+ * @ignorar_caixa - 1 para não diferenciar letras ASCII maiúsculas e minúsculas
+ * @padrao - texto procurado
+ * @visitar - função chamada para cada livro que atende ao filtro, em ordem de posição (NULL apenas conta)
+ * @contexto - ponteiro repassado para a função visitar
+ * @encontrados - ponteiro onde a quantidade de livros encontrados é armazenada
+ * @bytes_varridos - ponteiro onde a quantidade de bytes de livro.str avaliados é somada (pode ser NULL)
+ *
+ * As referências são lidas em blocos de POSICOES_BLOCO_VARREDURA posições; os textos da coluna,
+ * que ficam em sequência em livro.str, são lidos em trechos contínuos de até TAM_BLOCO_VARREDURA
+ * bytes e avaliados pelo núcleo de varredura (varredura.h). Registros só são lidos para os livros
+ * que atendem ao filtro.
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou um código de erro negativo.
+ */
+static int varrer_livros(BIBLIOTECA *biblioteca, int coluna, int operacao, int ignorar_caixa, const char *padrao,
+                         visitante_titulo visitar, void *contexto, int *encontrados, long long *bytes_varridos) {
+        ARQUIVO_BIBLIOTECA *livros = &biblioteca->livros;
+        AREA_TEXTOS *textos = &biblioteca->textos_livros;
+        int total = livros->cabecalho.pos_topo;
+        size_t tamanho_padrao = strlen(padrao);
+        int retorno = SUCESSO;
+        *encontrados = 0;
+
+        REFERENCIA_TEXTO *referencias = malloc((size_t)POSICOES_BLOCO_VARREDURA * COLUNAS_TEXTO_LIVRO * sizeof(REFERENCIA_TEXTO));
+        ITEM_VARREDURA *itens = malloc((size_t)POSICOES_BLOCO_VARREDURA * sizeof(ITEM_VARREDURA));
+        unsigned char *livres = total > 0 ? calloc((size_t)total, 1) : NULL;
+        char *trecho = NULL;
+        size_t capacidade_trecho = 0;
+        if (referencias == NULL || itens == NULL || (total > 0 && livres == NULL)) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_vetores;
+        }
+
+        // posições da lista de livres não têm livro (nem textos válidos)
+        REGISTRO_LIVRO copia;
+        for (int pos = livros->cabecalho.pos_livre; pos != -1; ) {
+                const REGISTRO_LIVRO *livre = acessar_registro(livros->arquivo, pos, sizeof(REGISTRO_LIVRO), &copia);
+                if (livre == NULL || pos >= total) {
+                        retorno = ERRO_ARQUIVO_READ;
+                        goto liberar_vetores;
+                }
+                livres[pos] = 1;
+                pos = livre->prox;
+        }
+
+        for (int bloco = 0; bloco < total; bloco += POSICOES_BLOCO_VARREDURA) {
+                int num_posicoes = total - bloco < POSICOES_BLOCO_VARREDURA ? total - bloco : POSICOES_BLOCO_VARREDURA;
+                if ((retorno = textos_ler_referencias_intervalo(textos, bloco, num_posicoes, referencias)) != SUCESSO)
+                        goto liberar_vetores;
+
+                // com padrão vazio não há o que ler: atendem todos, exceto textos não vazios em FILTRO_IGUAL;
+                // com padrão não vazio, textos vazios nunca atendem e ficam de fora
+                int num_itens = 0, ordenado = 1;
+                unsigned int ultimo_deslocamento = 0;
+                for (int i = 0; i < num_posicoes; i++) {
+                        REFERENCIA_TEXTO referencia = referencias[i * COLUNAS_TEXTO_LIVRO + coluna];
+                        if (livres[bloco + i] || (referencia.tamanho == 0 && tamanho_padrao > 0))
+                                continue;
+
+                        ITEM_VARREDURA item = { bloco + i, referencia.deslocamento, referencia.tamanho, 0 };
+                        if (tamanho_padrao == 0)
+                                item.atende = operacao != FILTRO_IGUAL || referencia.tamanho == 0;
+                        else if (referencia.deslocamento < ultimo_deslocamento)
+                                ordenado = 0;
+                        ultimo_deslocamento = referencia.deslocamento;
+                        itens[num_itens++] = item;
+                }
+
+                // os textos costumam estar em ordem (gravados junto com os registros); se não estiverem, são ordenados
+                if (!ordenado)
+                        qsort(itens, num_itens, sizeof(ITEM_VARREDURA), comparar_itens_deslocamento);
+
+                int inicio = 0;
+                while (inicio < num_itens && tamanho_padrao > 0) {
+                        // grupo: textos seguidos cujo trecho contínuo em livro.str cabe em TAM_BLOCO_VARREDURA
+                        int fim = inicio + 1;
+                        unsigned int base = itens[inicio].deslocamento;
+                        size_t tamanho_trecho = itens[inicio].tamanho;
+                        while (fim < num_itens && (size_t)(itens[fim].deslocamento - base) + itens[fim].tamanho <= TAM_BLOCO_VARREDURA) {
+                                tamanho_trecho = (size_t)(itens[fim].deslocamento - base) + itens[fim].tamanho;
+                                fim++;
+                        }
+
+                        if (tamanho_trecho > capacidade_trecho) {
+                                char *novo = realloc(trecho, tamanho_trecho);
+                                if (novo == NULL) {
+                                        retorno = ERRO_ALOCAR_MEMORIA;
+                                        goto liberar_vetores;
+                                }
+                                trecho = novo;
+                                capacidade_trecho = tamanho_trecho;
+                        }
+                        if ((retorno = textos_ler_trecho(textos, (long)base, tamanho_trecho, trecho)) != SUCESSO)
+                                goto liberar_vetores;
+
+                        avaliar_grupo(itens + inicio, fim - inicio, trecho, tamanho_trecho, operacao, ignorar_caixa, padrao, tamanho_padrao);
+                        if (bytes_varridos != NULL)
+                                *bytes_varridos += (long long)tamanho_trecho;
+
+                        inicio = fim;
+                }
+
+                // os livros do bloco que atendem ao filtro são entregues em ordem de posição
+                int num_atendem = 0;
+                for (int i = 0; i < num_itens; i++) {
+                        if (itens[i].atende)
+                                itens[num_atendem++] = itens[i];
+                }
+                if (!ordenado)
+                        qsort(itens, num_atendem, sizeof(ITEM_VARREDURA), comparar_itens_posicao);
+
+                for (int i = 0; i < num_atendem; i++) {
+                        (*encontrados)++;
+                        if (visitar == NULL)
+                                continue;
+
+                        const REGISTRO_LIVRO *registro = acessar_registro(livros->arquivo, itens[i].posicao, sizeof(REGISTRO_LIVRO), &copia);
+                        if (registro == NULL) {
+                                retorno = ERRO_ARQUIVO_READ;
+                                goto liberar_vetores;
+                        }
+                        REGISTRO_LIVRO livro = *registro;
+                        if ((retorno = visitar(biblioteca, itens[i].posicao, &livro, &referencias[(itens[i].posicao - bloco) * COLUNAS_TEXTO_LIVRO], contexto)) != SUCESSO)
+                                goto liberar_vetores;
+                }
+        }
+
+liberar_vetores:
+        free(referencias);
+        free(itens);
+        free(livres);
+        free(trecho);
+
+        return retorno;
+}
+
+/*
+ * exibir_titulo_codigo - função interna (visitante_titulo) que imprime título e código, como na busca por autor
+ */
+static int exibir_titulo_codigo(BIBLIOTECA *biblioteca, int posicao, const REGISTRO_LIVRO *registro, const REFERENCIA_TEXTO *referencias, void *contexto) {
+        (void)posicao;
+        (void)contexto;
+
+        char titulo[MAX_TITULO + 1];
+        int retorno = textos_ler(&biblioteca->textos_livros, referencias[COLUNA_TITULO], titulo, sizeof(titulo));
+        if (retorno != SUCESSO)
+                return retorno;
+
+        fprintf(biblioteca->saida, "Titulo: %s | Codigo: %d\n", titulo, registro->codigo);
+        return SUCESSO;
+}
+
+/*
+ * localizar_livro - Busca um livro pelo código utilizando o índice hash do arquivo (livro.idx)
+ *
+ * @livros  - arquivo de livros da biblioteca, que mantém o índice aberto (biblioteca_indice)
+ * @codigo  - código do livro procurado
+ * @livro   - ponteiro onde o registro encontrado será armazenado
+ * @pos     - ponteiro onde a posição do registro no arquivo será armazenada
+ *
+ * Pré-condições:
+ *      - O arquivo deve estar aberto e inicializado com um cabeçalho válido
+ *
+ * Pós-condições:
+ *      - Se o índice não existir ou estiver desatualizado, ele é reconstruído a partir da lista
+ *      - Em caso de sucesso, *livro e *pos recebem o registro e sua posição
+ *      - Retorna SUCESSO (0) se o livro foi encontrado
+ *      - Retorna ERRO_ENCONTRAR_LIVRO (-15) se não existir livro com o código informado
+ *      - Retorna outro código de erro negativo em caso de falha de leitura
+ */
+int localizar_livro(ARQUIVO_BIBLIOTECA *livros, unsigned int codigo, REGISTRO_LIVRO *livro, int *pos) {
+        // segunda tentativa só acontece após reconstruir um índice ausente ou desatualizado
+        for (int tentativa = 0; tentativa < 2; tentativa++) {
+                FILE *indice = biblioteca_indice(livros, ".idx");
+                int retorno = indice != NULL ? indice_hash_buscar_arquivo(indice, codigo, pos) : ERRO_ABRIR_ARQUIVO;
+                if (retorno == ERRO_ENCONTRAR_CHAVE)
+                        return ERRO_ENCONTRAR_LIVRO;
+
+                if (retorno == SUCESSO) {
+                        if ((retorno = ler_registro(livros->arquivo, *pos, sizeof(REGISTRO_LIVRO), livro)) != SUCESSO)
+                                return retorno;
+                        if ((unsigned int)livro->codigo == codigo)
+                                return SUCESSO;
+                }
+                else if (retorno != ERRO_ABRIR_ARQUIVO && retorno != ERRO_LER_INDICE) {
+                        return retorno;
+                }
+
+                if (tentativa == 0) {
+                        biblioteca_fechar_indices(livros);
+                        if ((retorno = reconstruir_indice_livro(livros->caminho)) != SUCESSO)
+                                return retorno;
+                }
+        }
+
+        return ERRO_ENCONTRAR_LIVRO;
+}
+
+/*
+ * verificar_id_livro - verifica se livro já foi cadastrado
+ *
+ * @livros - arquivo de livros aberto na biblioteca
+ * @codigo_livro - código do livro
+ *
+ * Pré-condições:
+ *      - Arquivo informado deve estar aberto e inicializado (conter cabeçalho).
+ * Pós-condições:
+ *      - Retorna SUCESSO caso não tenha conflito.
+ *      - Retorna valores negativos em caso de erro:
+ *              ERRO_CONFLITO_ID: foi identificado conflito.
+ *              ERRO_ARQUIVO_SEEK: erro no posicionamento do arquivo (fseek).
+ *              ERRO_ARQUIVO_READ: erro na leitura do arquivo (fread).
+ */
+static int verificar_id_livro(ARQUIVO_BIBLIOTECA* livros, unsigned int codigo_livro) {
+        REGISTRO_LIVRO livro;
+        int pos;
+        int retorno = localizar_livro(livros, codigo_livro, &livro, &pos);
+        if(retorno == SUCESSO)
+                retorno = ERRO_CONFLITO_ID; // conflito encontrado
+        else if(retorno == ERRO_ENCONTRAR_LIVRO)
+                retorno = SUCESSO;
+
+        return retorno;
+}
+
+/*
+ * indexar_livro_cadastrado - função interna que acrescenta aos índices um livro já confirmado na lista
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou o primeiro erro (os índices seguintes não são atualizados); um índice
+ *	que não existe é reconstruído já com o livro.
+ */
+static int indexar_livro_cadastrado(ARQUIVO_BIBLIOTECA *livros, const LIVRO *novo, int nova_pos) {
+        // manter o índice hash atualizado (se não existir, é reconstruído já com o novo livro)
+        FILE *indice = biblioteca_indice(livros, ".idx");
+        int retorno = indice != NULL ? indice_hash_inserir_arquivo(indice, (unsigned int)novo->codigo, nova_pos) : ERRO_ABRIR_ARQUIVO;
+        if (retorno == ERRO_ABRIR_ARQUIVO)
+                retorno = reconstruir_indice_livro(livros->caminho);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        // o mesmo vale para o índice de títulos
+        unsigned char chave_titulo[TAM_CHAVE_TITULO];
+        montar_chave_titulo(novo->titulo, (unsigned int)novo->codigo, chave_titulo);
+        indice = biblioteca_indice(livros, EXTENSAO_INDICE_TITULO);
+        retorno = indice != NULL ? arvore_bmais_inserir_arquivo(indice, chave_titulo, nova_pos) : ERRO_ABRIR_ARQUIVO;
+        if (retorno == ERRO_ABRIR_ARQUIVO)
+                retorno = reconstruir_indice_titulo(livros->caminho);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        // e para o índice de autores
+        FILE *dicionario, *listas;
+        unsigned char termo_autor[TAM_AUTOR_INDICE];
+        montar_termo_autor(novo->autor, termo_autor);
+        retorno = indice_invertido_livros(livros, EXTENSAO_INDICE_AUTOR, EXTENSAO_LISTAS_AUTOR, &dicionario, &listas);
+        if (retorno == SUCESSO)
+                retorno = indice_invertido_inserir_arquivo(dicionario, listas, termo_autor, nova_pos);
+        if (retorno == ERRO_ABRIR_ARQUIVO) {
+                biblioteca_fechar_indices(livros);
+                retorno = reconstruir_indice_autor(livros->caminho);
+        }
+        if (retorno != SUCESSO)
+                return retorno;
+
+        // e para o índice de trigramas, com uma inserção por trigrama distinto do livro
+        unsigned char trigramas[MAX_TRIGRAMAS_LIVRO * TAM_TRIGRAMA];
+        int num_trigramas = trigramas_livro(novo, trigramas);
+        retorno = indice_invertido_livros(livros, EXTENSAO_INDICE_TRIGRAMA, EXTENSAO_LISTAS_TRIGRAMA, &dicionario, &listas);
+        for (int i = 0; i < num_trigramas && retorno == SUCESSO; i++)
+                retorno = indice_invertido_inserir_arquivo(dicionario, listas, trigramas + (size_t)i * TAM_TRIGRAMA, nova_pos);
+        if (retorno == ERRO_ABRIR_ARQUIVO) {
+                biblioteca_fechar_indices(livros);
+                retorno = reconstruir_indice_trigramas(livros->caminho);
+        }
+
+        return retorno;
+}
+
+/*
+ * refazer_indices_livros - função interna que reconstrói os índices de livros depois de uma atualização que falhou
+ *
+ * Um índice que nem assim fica correto é removido: biblioteca_indice não o encontra e a próxima
+ * consulta (ou a próxima inicialização da base) o reconstrói.
+ */
+static void refazer_indices_livros(ARQUIVO_BIBLIOTECA *livros) {
+        static const struct {
+                int (*reconstruir)(const char *nome_arq);
+                const char *extensoes[2];
+        } indices[] = {
+                {reconstruir_indice_livro, {".idx", NULL}},
+                {reconstruir_indice_titulo, {EXTENSAO_INDICE_TITULO, NULL}},
+                {reconstruir_indice_autor, {EXTENSAO_INDICE_AUTOR, EXTENSAO_LISTAS_AUTOR}},
+                {reconstruir_indice_trigramas, {EXTENSAO_INDICE_TRIGRAMA, EXTENSAO_LISTAS_TRIGRAMA}}
+        };
+
+        biblioteca_fechar_indices(livros);
+        for (size_t i = 0; i < sizeof(indices) / sizeof(indices[0]); i++) {
+                if (indices[i].reconstruir(livros->caminho) == SUCESSO)
+                        continue;
+                for (int j = 0; j < 2 && indices[i].extensoes[j] != NULL; j++) {
+                        char caminho[TAM_MAX_CAMINHO];
+                        trocar_extensao(caminho, livros->caminho, indices[i].extensoes[j]);
+                        remove(caminho);
+                }
+        }
+}
+
+/*
+ * cadastrar_livro_travado - função interna de biblioteca_cadastrar_livro, com os arquivos já travados
+ */
+static int cadastrar_livro_travado(BIBLIOTECA* biblioteca, LIVRO novo) {
+        ARQUIVO_BIBLIOTECA *livros = &biblioteca->livros;
+        if (!livros->arquivo) return ERRO_ABRIR_ARQUIVO;
+
+        if(verificar_id_livro(livros, novo.codigo) == ERRO_CONFLITO_ID)
+                return ERRO_CONFLITO_ID;
+
+        // o cabeçalho residente só é alterado quando a gravação termina
+        CABECALHO cab = livros->cabecalho;
+
+        int nova_pos;
+        if (cab.pos_livre == -1) {
+                // Sem espaço livre: insere no final
+                nova_pos = cab.pos_topo;
+        }
+        else {
+                // Reaproveita espaço
+                nova_pos = cab.pos_livre;
+                REGISTRO_LIVRO *livro_removido = le_no_livro(livros->arquivo, nova_pos);
+                if (livro_removido==NULL) {
+                        return ERRO_ARQUIVO_READ;
+                }
+                cab.pos_livre = livro_removido->prox;
+                cab.num_livres--;
+                free(livro_removido);
+        }
+
+        // textos gravados antes do registro que os referencia
+        REGISTRO_LIVRO registro;
+        novo.prox = cab.pos_cabeca;
+        preparar_registro_livro(&novo, &registro);
+        if (gravar_textos_livro(&biblioteca->textos_livros, nova_pos, &novo) != SUCESSO ||
+            textos_descarregar(&biblioteca->textos_livros) != SUCESSO) {
+                return ERRO_ARQUIVO_WRITE;
+        }
+
+        // Inserção no início da lista encadeada (registro e cabeçalho formam uma operação do diário)
+        biblioteca_iniciar_operacao(biblioteca);
+        if (escreve_no_livro(livros->arquivo, &registro, nova_pos) != 0) {
+                biblioteca_desfazer_operacao(biblioteca);
+                return ERRO_ARQUIVO_WRITE;
+        }
+
+        cab.pos_cabeca = nova_pos;
+        cab.num_ativos++;
+        cab.exemplares_disponiveis += novo.exemplares;
+
+        if (nova_pos == cab.pos_topo)
+                cab.pos_topo++;
+
+        if (biblioteca_gravar_cabecalho(livros, &cab) != 0) {
+                biblioteca_desfazer_operacao(biblioteca);
+                return ERRO_ESCREVER_CABECALHO;
+        }
+
+        int retorno = biblioteca_confirmar_operacao(biblioteca);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        // o livro já está no diário: uma falha nos índices não desfaz o cadastro, só os deixa desatualizados
+        if (indexar_livro_cadastrado(livros, &novo, nova_pos) != SUCESSO)
+                refazer_indices_livros(livros);
+
+        return SUCESSO;
+}
+
+int biblioteca_cadastrar_livro(BIBLIOTECA* biblioteca, LIVRO novo) {
+        int retorno = biblioteca_travar_escrita(biblioteca, BIBLIOTECA_LIVROS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = cadastrar_livro_travado(biblioteca, novo);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * cadastrar_livro - Insere um novo livro na lista encadeada mantida em arquivo binário
+ *
+ * @nome_arq - nome do arquivo binário contendo a lista
+ * @livro    - estrutura LIVRO preenchida com os dados do novo livro
+ *
+ * Pré-condições:
+ *      - O arquivo deve existir e estar corretamente inicializado com um cabeçalho válido
+ *      - O arquivo deve estar aberto para leitura e escrita
+ *
+ * Pós-condições:
+ *      - O livro é adicionado no início da lista
+ *      - O campo pos_cabeca do cabeçalho é atualizado
+ *      - Se houver espaço livre disponível, ele é reutilizado
+ *      - Se não houver, o livro é inserido na posição final (pos_topo é incrementado)
+ *      - retorno SUCESSO (0) em caso de sucesso
+ *      - retorna código de erro negativo em caso de falhas (ex: erro ao abrir, ler, ou escrever)
+ */
+int cadastrar_livro(const char *nome_arquivo, LIVRO novo) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, nome_arquivo, NULL, NULL);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_cadastrar_livro(&biblioteca, novo);
+        biblioteca_fechar_arquivos(&biblioteca);
+        return retorno;
+}
+
+/*
+ * consultar_livro_travado - função interna de biblioteca_consultar_livro, com os arquivos já travados
+ */
+static int consultar_livro_travado(BIBLIOTECA* biblioteca, int codigo, LIVRO* livro) {
+        ARQUIVO_BIBLIOTECA *livros = &biblioteca->livros;
+        if (!livros->arquivo) {
+                return ERRO_ABRIR_ARQUIVO;
+        }
+
+        REGISTRO_LIVRO registro;
+        int pos;
+        int retorno = localizar_livro(livros, codigo, &registro, &pos);
+        if (retorno == SUCESSO)
+                retorno = montar_livro(&biblioteca->textos_livros, pos, &registro, livro);
+
+        return retorno;
+}
+
+int biblioteca_consultar_livro(BIBLIOTECA* biblioteca, int codigo, LIVRO* livro) {
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_LIVROS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = consultar_livro_travado(biblioteca, codigo, livro);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * imprimir_livro_travado - função interna de biblioteca_imprimir_livro, com os arquivos já travados
+ */
+static int imprimir_livro_travado(BIBLIOTECA* biblioteca, int codigo) {
+        LIVRO livro;
+        int retorno = consultar_livro_travado(biblioteca, codigo, &livro);
+        if (retorno == SUCESSO) {
+                fprintf(biblioteca->saida, "Codigo: %d\nTitulo: %s\nAutor: %s\nEditora: %s\nEdicao: %d\nAno: %d\nExemplares: %d\n\n",
+                livro.codigo, livro.titulo, livro.autor, livro.editora,
+                livro.edicao, livro.ano, livro.exemplares);
+        }
+
+        return retorno;
+}
+
+int biblioteca_imprimir_livro(BIBLIOTECA* biblioteca, int codigo) {
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_LIVROS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = imprimir_livro_travado(biblioteca, codigo);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * imprimir_livro - Imprime os dados de um livro com base no código fornecido
+ *
+ * @nome_arq - nome do arquivo binário contendo os livros
+ * @codigo   - código do livro a ser impresso
+ *
+ * Pré-condições:
+ *      - O arquivo deve estar aberto para leitura
+ *
+ * Pós-condições:
+ *      - Os dados do livro com o código fornecido são impressos na tela, se encontrado
+ *      - Retorna SUCESSO (0) em caso de sucesso
+ *      - Retorna código de erro negativo se não encontrado ou ocorrer erro de leitura
+ */
+int imprimir_livro(const char *nome_arq, int codigo) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, nome_arq, NULL, NULL);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_imprimir_livro(&biblioteca, codigo);
+        biblioteca_fechar_arquivos(&biblioteca);
+        return retorno;
+}
+
+/*
+ * listar_todos_livros_travado - função interna de biblioteca_listar_todos_livros, com os arquivos já travados
+ */
+static int listar_todos_livros_travado(BIBLIOTECA* biblioteca) {
+        FILE *arquivo = biblioteca->livros.arquivo;
+        if (!arquivo) {
+                return ERRO_ABRIR_ARQUIVO;
+        }
+
+        int pos = biblioteca->livros.cabecalho.pos_cabeca;
+        REGISTRO_LIVRO copia;
+        REFERENCIA_TEXTO referencias[COLUNAS_TEXTO_LIVRO];
+        char titulo[MAX_TITULO + 1];
+        char autor[MAX_AUTOR + 1];
+        if (pos == -1) {
+                fprintf(biblioteca->saida, "Nenhum livro cadastrado.\n");
+        }
+
+        while (pos != -1) {
+                const REGISTRO_LIVRO *livro = acessar_registro(arquivo, pos, sizeof(REGISTRO_LIVRO), &copia);
+                if (livro == NULL) {
+                        return ERRO_ARQUIVO_READ;
+                }
+
+                int retorno;
+                if ((retorno = textos_ler_referencias(&biblioteca->textos_livros, pos, referencias)) != SUCESSO ||
+                    (retorno = textos_ler(&biblioteca->textos_livros, referencias[COLUNA_TITULO], titulo, sizeof(titulo))) != SUCESSO ||
+                    (retorno = textos_ler(&biblioteca->textos_livros, referencias[COLUNA_AUTOR], autor, sizeof(autor))) != SUCESSO) {
+                        return retorno;
+                }
+
+                fprintf(biblioteca->saida, "Codigo: %d | Titulo: %s | Autor: %s | Ano: %d | Exemplares: %d\n",
+                livro->codigo, titulo, autor, livro->ano, livro->exemplares);
+                pos = livro->prox;
+        }
+
+        return SUCESSO;
+}
+
+int biblioteca_listar_todos_livros(BIBLIOTECA* biblioteca) {
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_LIVROS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = listar_todos_livros_travado(biblioteca);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * listar_todos_livros - Lista todos os livros cadastrados na lista encadeada do arquivo
+ *
+ * @nome_arq - nome do arquivo binário contendo os livros
+ *
+ * Pré-condições:
+ *      - O arquivo pode ser aberto para leitura
+ *
+ * Pós-condições:
+ *      - Os dados de todos os livros (em ordem lógica) são impressos na tela
+ *      - Retorna SUCESSO (0) em caso de sucesso
+ *      - Retorna valor negativo em caso de erro
+ */
+int listar_todos_livros(const char *nome_arq) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, nome_arq, NULL, NULL);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_listar_todos_livros(&biblioteca);
+        biblioteca_fechar_arquivos(&biblioteca);
+        return retorno;
+}
+
+/*
+ * CONTEXTO_BUSCA_AUTOR - struct interna repassada ao visitante da lista de um autor
+ *
+ * @conferir - 1 se o autor tem TAM_AUTOR_INDICE bytes ou mais: o termo pode ser compartilhado
+ * com outros autores de mesmo início, e o autor de cada livro é conferido em livro.str
+ */
+typedef struct {
+        BIBLIOTECA *biblioteca;
+        const char *autor;
+        int conferir;
+        int encontrados;
+        int erro;
+} CONTEXTO_BUSCA_AUTOR;
+
+/*
+ * exibir_livro_autor - função interna (visitante_posicao) que imprime um livro da lista de um autor
+ *
+ * Pós-condições:
+ *      - Retorna 0 para continuar a varredura ou 1 em caso de erro (guardado em busca->erro).
+ */
+static int exibir_livro_autor(int posicao, void *contexto) {
+        CONTEXTO_BUSCA_AUTOR *busca = contexto;
+        AREA_TEXTOS *textos = &busca->biblioteca->textos_livros;
+        REFERENCIA_TEXTO referencias[COLUNAS_TEXTO_LIVRO];
+        char titulo[MAX_TITULO + 1];
+
+        REGISTRO_LIVRO copia;
+        const REGISTRO_LIVRO *livro = acessar_registro(busca->biblioteca->livros.arquivo, posicao, sizeof(REGISTRO_LIVRO), &copia);
+        if (livro == NULL) {
+                busca->erro = ERRO_ARQUIVO_READ;
+                return 1;
+        }
+        int codigo = livro->codigo;
+
+        if ((busca->erro = textos_ler_referencias(textos, posicao, referencias)) != SUCESSO)
+                return 1;
+        if (busca->conferir) {
+                int igual = textos_igual(textos, referencias[COLUNA_AUTOR], busca->autor);
+                if (igual < 0) {
+                        busca->erro = igual;
+                        return 1;
+                }
+                if (!igual)
+                        return 0;
+        }
+
+        if ((busca->erro = textos_ler(textos, referencias[COLUNA_TITULO], titulo, sizeof(titulo))) != SUCESSO)
+                return 1;
+        fprintf(busca->biblioteca->saida, "Titulo: %s | Codigo: %d\n", titulo, codigo);
+        busca->encontrados++;
+
+        return 0;
+}
+
+/*
+ * buscar_autor_livro_travado - função interna de biblioteca_buscar_autor_livro, com os arquivos já travados
+ */
+static int buscar_autor_livro_travado(BIBLIOTECA* biblioteca, const char *autor) {
+        ARQUIVO_BIBLIOTECA *livros = &biblioteca->livros;
+        if (!livros->arquivo) {
+                return ERRO_ABRIR_ARQUIVO;
+        }
+
+        FILE *dicionario, *listas;
+        unsigned char termo[TAM_AUTOR_INDICE];
+        montar_termo_autor(autor, termo);
+
+        // só os livros da lista do autor são lidos, em ordem de posição
+        CONTEXTO_BUSCA_AUTOR busca = { biblioteca, autor, strlen(autor) >= TAM_AUTOR_INDICE, 0, SUCESSO };
+        int retorno = indice_invertido_livros(livros, EXTENSAO_INDICE_AUTOR, EXTENSAO_LISTAS_AUTOR, &dicionario, &listas);
+        if (retorno == SUCESSO)
+                retorno = indice_invertido_percorrer_arquivo(dicionario, listas, termo, exibir_livro_autor, &busca);
+        if (retorno == ERRO_ABRIR_ARQUIVO || retorno == ERRO_LER_INDICE) {
+                biblioteca_fechar_indices(livros);
+                if (reconstruir_indice_autor(livros->caminho) == SUCESSO &&
+                    (retorno = indice_invertido_livros(livros, EXTENSAO_INDICE_AUTOR, EXTENSAO_LISTAS_AUTOR, &dicionario, &listas)) == SUCESSO)
+                        retorno = indice_invertido_percorrer_arquivo(dicionario, listas, termo, exibir_livro_autor, &busca);
+        }
+
+        // índice inutilizável (e não reconstruído): a busca recorre à varredura de livro.str
+        if (retorno == ERRO_ABRIR_ARQUIVO || retorno == ERRO_LER_INDICE)
+                retorno = varrer_livros(biblioteca, COLUNA_AUTOR, FILTRO_IGUAL, 0, autor, exibir_titulo_codigo, NULL, &busca.encontrados, NULL);
+
+        if (retorno == SUCESSO)
+                retorno = busca.erro;
+        if (retorno == SUCESSO && busca.encontrados == 0)
+                fprintf(biblioteca->saida, "Nenhum livro encontrado do autor \"%s\".\n", autor);
+
+        return retorno;
+}
+
+int biblioteca_buscar_autor_livro(BIBLIOTECA* biblioteca, const char *autor) {
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_LIVROS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = buscar_autor_livro_travado(biblioteca, autor);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * buscar_autor_livro - Lista todos os livros escritos por um autor específico
+ *
+ * @nome_arq - nome do arquivo binário contendo os livros
+ * @autor    - nome do autor a ser buscado
+ *
+ * Pré-condições:
+ *      - O arquivo pode ser aberto para leitura
+ *
+ * Pós-condições:
+ *      - Títulos dos livros do autor são impressos na tela (busca pelo índice de autores)
+ *      - Retorna SUCESSO (0) em caso de sucesso
+ *      - Retorna código negativo em caso de erro
+ */
+int buscar_autor_livro(const char *nome_arq, const char *autor) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, nome_arq, NULL, NULL);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_buscar_autor_livro(&biblioteca, autor);
+        biblioteca_fechar_arquivos(&biblioteca);
+        return retorno;
+}
+
+/*
+ * exibir_livro_completo - função interna (visitante_titulo) que imprime todos os dados de um livro
+ */
+static int exibir_livro_completo(BIBLIOTECA *biblioteca, int posicao, const REGISTRO_LIVRO *registro, const REFERENCIA_TEXTO *referencias, void *contexto) {
+        (void)referencias;
+        (void)contexto;
+
+        LIVRO livro;
+        int retorno = montar_livro(&biblioteca->textos_livros, posicao, registro, &livro);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        fprintf(biblioteca->saida, "Codigo: %d\nTitulo: %s\nAutor: %s\nEditora: %s\nEdicao: %d\nAno: %d\nExemplares: %d\n\n",
+        livro.codigo, livro.titulo, livro.autor, livro.editora,
+        livro.edicao, livro.ano, livro.exemplares);
+
+        return SUCESSO;
+}
+
+/*
+ * exibir_livro_resumido - função interna (visitante_titulo) que imprime uma linha por livro, como na listagem
+ */
+static int exibir_livro_resumido(BIBLIOTECA *biblioteca, int posicao, const REGISTRO_LIVRO *registro, const REFERENCIA_TEXTO *referencias, void *contexto) {
+        (void)posicao;
+        (void)contexto;
+
+        char titulo[MAX_TITULO + 1];
+        char autor[MAX_AUTOR + 1];
+        int retorno;
+        if ((retorno = textos_ler(&biblioteca->textos_livros, referencias[COLUNA_TITULO], titulo, sizeof(titulo))) != SUCESSO ||
+            (retorno = textos_ler(&biblioteca->textos_livros, referencias[COLUNA_AUTOR], autor, sizeof(autor))) != SUCESSO) {
+                return retorno;
+        }
+
+        fprintf(biblioteca->saida, "Codigo: %d | Titulo: %s | Autor: %s | Ano: %d | Exemplares: %d\n",
+        registro->codigo, titulo, autor, registro->ano, registro->exemplares);
+
+        return SUCESSO;
+}
+
+/*
+ * buscar_titulo_livro_travado - função interna de biblioteca_buscar_titulo_livro, com os arquivos já travados
+ */
+static int buscar_titulo_livro_travado(BIBLIOTECA* biblioteca, const char *titulo) {
+        if (!biblioteca->livros.arquivo) {
+                return ERRO_ABRIR_ARQUIVO;
+        }
+
+        // intervalo [titulo, titulo]: todos os livros com exatamente esse título, em ordem de código
+        int encontrados;
+        int retorno = buscar_titulos(biblioteca, titulo, titulo, exibir_livro_completo, NULL, &encontrados);
+        if ((retorno == ERRO_ABRIR_ARQUIVO || retorno == ERRO_LER_INDICE) && encontrados == 0) {
+                // índice inutilizável (e não reconstruído): a busca recorre à varredura de livro.str
+                retorno = varrer_livros(biblioteca, COLUNA_TITULO, FILTRO_IGUAL, 0, titulo, exibir_livro_completo, NULL, &encontrados, NULL);
+        }
+        if (retorno != SUCESSO)
+                return retorno;
+
+        if (encontrados == 0) {
+                fprintf(biblioteca->saida, "Livro com titulo \"%s\" não encontrado.\n", titulo);
+                return ERRO_ENCONTRAR_LIVRO;
+        }
+
+        return SUCESSO;
+}
+
+int biblioteca_buscar_titulo_livro(BIBLIOTECA* biblioteca, const char *titulo) {
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_LIVROS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = buscar_titulo_livro_travado(biblioteca, titulo);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * buscar_titulo_livro - Busca e imprime os dados de um livro com base no título
+ *
+ * @nome_arq - nome do arquivo binário contendo os livros
+ * @titulo   - título do livro a ser buscado
+ *
+ * Pré-condições:
+ *      - O arquivo deve estar aberto para leitura
+ *
+ * Pós-condições:
+ *      - Dados do livro encontrado são exibidos na tela
+ *      - Retorna SUCESSO (0) em caso de sucesso
+ *      - Retorna código de erro negativo se não encontrado ou ocorrer erro de leitura
+ */
+int buscar_titulo_livro(const char *nome_arq, const char *titulo) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, nome_arq, NULL, NULL);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_buscar_titulo_livro(&biblioteca, titulo);
+        biblioteca_fechar_arquivos(&biblioteca);
+        return retorno;
+}
+
+/*
+ * buscar_prefixo_titulo_livro_travado - função interna de biblioteca_buscar_prefixo_titulo_livro, com os arquivos já travados
+ */
+static int buscar_prefixo_titulo_livro_travado(BIBLIOTECA* biblioteca, const char *prefixo) {
+        if (!biblioteca->livros.arquivo) {
+                return ERRO_ABRIR_ARQUIVO;
+        }
+
+        int encontrados;
+        int retorno = buscar_titulos(biblioteca, prefixo, NULL, exibir_livro_resumido, NULL, &encontrados);
+        if (retorno == SUCESSO && encontrados == 0)
+                fprintf(biblioteca->saida, "Nenhum livro encontrado com titulo iniciado por \"%s\".\n", prefixo);
+
+        return retorno;
+}
+
+int biblioteca_buscar_prefixo_titulo_livro(BIBLIOTECA* biblioteca, const char *prefixo) {
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_LIVROS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = buscar_prefixo_titulo_livro_travado(biblioteca, prefixo);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * buscar_prefixo_titulo_livro - Lista, em ordem alfabética, os livros cujo título começa com um prefixo
+ *
+ * @nome_arq - nome do arquivo binário contendo os livros
+ * @prefixo  - início do título (vazio lista todos os livros)
+ *
+ * Pré-condições:
+ *      - O arquivo pode ser aberto para leitura
+ *
+ * Pós-condições:
+ *      - Os livros encontrados são impressos em ordem de título (e de código, entre títulos iguais)
+ *      - Retorna SUCESSO (0), inclusive se nenhum livro for encontrado
+ *      - Retorna valor negativo em caso de erro
+ */
+int buscar_prefixo_titulo_livro(const char *nome_arq, const char *prefixo) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, nome_arq, NULL, NULL);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_buscar_prefixo_titulo_livro(&biblioteca, prefixo);
+        biblioteca_fechar_arquivos(&biblioteca);
+        return retorno;
+}
+
+/*
+ * listar_livros_intervalo_titulo_travado - função interna de biblioteca_listar_livros_intervalo_titulo, com os arquivos já travados
+ */
+static int listar_livros_intervalo_titulo_travado(BIBLIOTECA* biblioteca, const char *titulo_inicial, const char *titulo_final) {
+        if (!biblioteca->livros.arquivo) {
+                return ERRO_ABRIR_ARQUIVO;
+        }
+
+        int encontrados = 0;
+        int retorno = SUCESSO;
+        if (strcmp(titulo_inicial, titulo_final) <= 0)
+                retorno = buscar_titulos(biblioteca, titulo_inicial, titulo_final, exibir_livro_resumido, NULL, &encontrados);
+        if (retorno == SUCESSO && encontrados == 0)
+                fprintf(biblioteca->saida, "Nenhum livro encontrado na faixa informada.\n");
+
+        return retorno;
+}
+
+int biblioteca_listar_livros_intervalo_titulo(BIBLIOTECA* biblioteca, const char *titulo_inicial, const char *titulo_final) {
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_LIVROS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = listar_livros_intervalo_titulo_travado(biblioteca, titulo_inicial, titulo_final);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * listar_livros_intervalo_titulo - Lista, em ordem alfabética, os livros com título dentro de uma faixa
+ *
+ * @nome_arq       - nome do arquivo binário contendo os livros
+ * @titulo_inicial - menor título da faixa
+ * @titulo_final   - maior título da faixa (inclusive)
+ *
+ * Pré-condições:
+ *      - O arquivo pode ser aberto para leitura
+ *
+ * Pós-condições:
+ *      - Os livros com titulo_inicial <= título <= titulo_final (ordem de strcmp) são impressos
+ *      - Retorna SUCESSO (0), inclusive se nenhum livro for encontrado
+ *      - Retorna valor negativo em caso de erro
+ */
+int listar_livros_intervalo_titulo(const char *nome_arq, const char *titulo_inicial, const char *titulo_final) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, nome_arq, NULL, NULL);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_listar_livros_intervalo_titulo(&biblioteca, titulo_inicial, titulo_final);
+        biblioteca_fechar_arquivos(&biblioteca);
+        return retorno;
+}
+
+/*
+ * calcular_total_livros_travado - função interna de biblioteca_calcular_total_livros, com os arquivos já travados
+ */
+static int calcular_total_livros_travado(BIBLIOTECA* biblioteca){
+        if (!biblioteca->livros.arquivo) {
+                return ERRO_ABRIR_ARQUIVO;
+        }
+
+        // contador mantido no cabeçalho pelos cadastros: não é preciso percorrer a lista
+        fprintf(biblioteca->saida, "Total de livros cadastrados: %d\n", biblioteca->livros.cabecalho.num_ativos);
+        return 0;
+}
+
+int biblioteca_calcular_total_livros(BIBLIOTECA* biblioteca){
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_LIVROS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = calcular_total_livros_travado(biblioteca);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+* calcular_total_livros - retorna a quantia total de livros
+* @nome_arq - nome do arquivo binário contendo os livros
+*
+* Pré-condições:
+*       - O arquivo deve estar aberto para leitura
+*
+* Pós-condições:
+*       - Quantia de livros disponiveis é exibida
+*       - Retorna SUCESSO (0) em caso de sucesso
+*       - Retorna código de erro negativo se não encontrado ou ocorrer erro de leitura
+*
+*/
+int calcular_total_livros(const char *nome_arq){
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, nome_arq, NULL, NULL);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_calcular_total_livros(&biblioteca);
+        biblioteca_fechar_arquivos(&biblioteca);
+        return retorno;
+}
+
+/*
+ * LISTA_CANDIDATOS - struct interna que acumula as posições das listas dos trigramas da consulta
+ */
+typedef struct {
+        int *posicoes;
+        int quantidade;
+        int capacidade;
+        int erro;
+} LISTA_CANDIDATOS;
+
+/*
+ * acumular_posicao - função interna (visitante_posicao) que acrescenta uma posição à lista de candidatos
+ */
+static int acumular_posicao(int posicao, void *contexto) {
+        LISTA_CANDIDATOS *lista = contexto;
+        if (lista->quantidade == lista->capacidade) {
+                int nova_capacidade = lista->capacidade > 0 ? lista->capacidade * 2 : 256;
+                int *novas = realloc(lista->posicoes, (size_t)nova_capacidade * sizeof(int));
+                if (novas == NULL) {
+                        lista->erro = ERRO_ALOCAR_MEMORIA;
+                        return 1;
+                }
+                lista->posicoes = novas;
+                lista->capacidade = nova_capacidade;
+        }
+        lista->posicoes[lista->quantidade++] = posicao;
+        return 0;
+}
+
+/*
+ * RESULTADO_TEXTO - livro candidato da busca textual
+ *
+ * @posicao - posição do livro em livro.dat
+ * @semelhanca - quantidade de trigramas da consulta presentes no livro
+ * @exato - 1 se a consulta normalizada é trecho de algum dos campos normalizados
+ */
+typedef struct {
+        int posicao;
+        int semelhanca;
+        int exato;
+} RESULTADO_TEXTO;
+
+/*
+ * comparar_resultados_texto - função interna de comparação para qsort (trechos exatos, depois maior semelhança, depois posição)
+ */
+static int comparar_resultados_texto(const void *a, const void *b) {
+        const RESULTADO_TEXTO *x = a, *y = b;
+        if (x->exato != y->exato)
+                return y->exato - x->exato;
+        if (x->semelhanca != y->semelhanca)
+                return y->semelhanca - x->semelhanca;
+        return x->posicao - y->posicao;
+}
+
+/*
+ * contem_trecho - função interna que verifica se a consulta normalizada é trecho de algum campo do livro
+ */
+static int contem_trecho(const LIVRO *livro, const char *consulta) {
+        char normalizado[MAX_AUTOR + 1];
+        const char *campos[] = { livro->titulo, livro->autor, livro->editora };
+        for (int i = 0; i < COLUNAS_TEXTO_LIVRO; i++) {
+                normalizar_texto(campos[i], normalizado, sizeof(normalizado));
+                if (strstr(normalizado, consulta) != NULL)
+                        return 1;
+        }
+        return 0;
+}
+
+/*
+ * coletar_candidatos - função interna que junta as listas dos trigramas da consulta
+ *
+ * @dicionario / @listas - índice de trigramas aberto (indice_invertido_livros)
+ * @trigramas - trigramas distintos da consulta
+ * @num_trigramas - quantidade de trigramas
+ * @lista - lista que recebe as posições (com repetições: uma por trigrama em comum)
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) ou o código de erro de indice_invertido_percorrer_arquivo.
+ */
+static int coletar_candidatos(FILE *dicionario, FILE *listas, const unsigned char *trigramas, int num_trigramas, LISTA_CANDIDATOS *lista) {
+        lista->quantidade = 0;
+        for (int i = 0; i < num_trigramas; i++) {
+                int retorno = indice_invertido_percorrer_arquivo(dicionario, listas, trigramas + (size_t)i * TAM_TRIGRAMA, acumular_posicao, lista);
+                if (retorno != SUCESSO)
+                        return retorno;
+                if (lista->erro != SUCESSO)
+                        return lista->erro;
+        }
+        return SUCESSO;
+}
+
+/*
+ * comparar_posicoes - função interna de comparação para qsort (inteiros crescentes)
+ */
+static int comparar_posicoes(const void *a, const void *b) {
+        int x = *(const int *)a, y = *(const int *)b;
+        return (x > y) - (x < y);
+}
+
+/*
+ * buscar_texto_livro_travado - função interna de biblioteca_buscar_texto_livro, com os arquivos já travados
+ */
+static int buscar_texto_livro_travado(BIBLIOTECA* biblioteca, const char *consulta) {
+        ARQUIVO_BIBLIOTECA *livros = &biblioteca->livros;
+        if (!livros->arquivo) {
+                return ERRO_ABRIR_ARQUIVO;
+        }
+
+        char normalizada[MAX_TITULO + 1];
+        unsigned char trigramas[MAX_TITULO * TAM_TRIGRAMA];
+        normalizar_texto(consulta, normalizada, sizeof(normalizada));
+        int num_trigramas = ordenar_trigramas(trigramas, extrair_trigramas(normalizada, trigramas, 0, MAX_TITULO));
+        if (num_trigramas == 0) {
+                fprintf(biblioteca->saida, "Informe ao menos %d letras ou numeros para a busca.\n", TAM_TRIGRAMA);
+                return SUCESSO;
+        }
+
+        // as listas de todos os trigramas da consulta, juntas: cada posição aparece uma vez por trigrama em comum
+        FILE *dicionario, *listas;
+        LISTA_CANDIDATOS lista = { NULL, 0, 0, SUCESSO };
+        RESULTADO_TEXTO *resultados = NULL;
+        int retorno = indice_invertido_livros(livros, EXTENSAO_INDICE_TRIGRAMA, EXTENSAO_LISTAS_TRIGRAMA, &dicionario, &listas);
+        if (retorno == SUCESSO)
+                retorno = coletar_candidatos(dicionario, listas, trigramas, num_trigramas, &lista);
+        if (retorno == ERRO_ABRIR_ARQUIVO || retorno == ERRO_LER_INDICE) {
+                biblioteca_fechar_indices(livros);
+                if (reconstruir_indice_trigramas(livros->caminho) == SUCESSO &&
+                    (retorno = indice_invertido_livros(livros, EXTENSAO_INDICE_TRIGRAMA, EXTENSAO_LISTAS_TRIGRAMA, &dicionario, &listas)) == SUCESSO)
+                        retorno = coletar_candidatos(dicionario, listas, trigramas, num_trigramas, &lista);
+        }
+        if (retorno != SUCESSO)
+                goto liberar_vetores;
+
+        // ordenadas, as repetições de cada posição ficam juntas e seu número é a semelhança; livros com
+        // todos os trigramas são a interseção das listas e os únicos que podem conter a consulta inteira
+        if (lista.quantidade > 0)
+                qsort(lista.posicoes, lista.quantidade, sizeof(int), comparar_posicoes);
+        resultados = malloc((size_t)(lista.quantidade > 0 ? lista.quantidade : 1) * sizeof(RESULTADO_TEXTO));
+        if (resultados == NULL) {
+                retorno = ERRO_ALOCAR_MEMORIA;
+                goto liberar_vetores;
+        }
+
+        int minimo = (num_trigramas + 1) / 2;
+        int num_resultados = 0;
+        REGISTRO_LIVRO copia;
+        LIVRO livro;
+        for (int i = 0; i < lista.quantidade; ) {
+                int j = i;
+                while (j < lista.quantidade && lista.posicoes[j] == lista.posicoes[i])
+                        j++;
+
+                RESULTADO_TEXTO resultado = { lista.posicoes[i], j - i, 0 };
+                if (resultado.semelhanca == num_trigramas) {
+                        const REGISTRO_LIVRO *registro = acessar_registro(livros->arquivo, resultado.posicao, sizeof(REGISTRO_LIVRO), &copia);
+                        if (registro == NULL) {
+                                retorno = ERRO_ARQUIVO_READ;
+                                goto liberar_vetores;
+                        }
+                        if ((retorno = montar_livro(&biblioteca->textos_livros, resultado.posicao, registro, &livro)) != SUCESSO)
+                                goto liberar_vetores;
+                        resultado.exato = contem_trecho(&livro, normalizada);
+                }
+                if (resultado.semelhanca >= minimo)
+                        resultados[num_resultados++] = resultado;
+
+                i = j;
+        }
+
+        qsort(resultados, num_resultados, sizeof(RESULTADO_TEXTO), comparar_resultados_texto);
+
+        int exibidos = num_resultados < MAX_RESULTADOS_TEXTO ? num_resultados : MAX_RESULTADOS_TEXTO;
+        for (int i = 0; i < exibidos; i++) {
+                const REGISTRO_LIVRO *registro = acessar_registro(livros->arquivo, resultados[i].posicao, sizeof(REGISTRO_LIVRO), &copia);
+                if (registro == NULL) {
+                        retorno = ERRO_ARQUIVO_READ;
+                        goto liberar_vetores;
+                }
+                if ((retorno = montar_livro(&biblioteca->textos_livros, resultados[i].posicao, registro, &livro)) != SUCESSO)
+                        goto liberar_vetores;
+
+                fprintf(biblioteca->saida, "Codigo: %d | Titulo: %s | Autor: %s | Editora: %s | Semelhanca: %d%%\n",
+                livro.codigo, livro.titulo, livro.autor, livro.editora,
+                resultados[i].semelhanca * 100 / num_trigramas);
+        }
+
+        if (num_resultados == 0)
+                fprintf(biblioteca->saida, "Nenhum livro encontrado para \"%s\".\n", consulta);
+        else if (num_resultados > exibidos)
+                fprintf(biblioteca->saida, "... e mais %d livro(s).\n", num_resultados - exibidos);
+
+liberar_vetores:
+        free(lista.posicoes);
+        free(resultados);
+
+        return retorno;
+}
+
+int biblioteca_buscar_texto_livro(BIBLIOTECA* biblioteca, const char *consulta) {
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_LIVROS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = buscar_texto_livro_travado(biblioteca, consulta);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * buscar_texto_livro - Busca livros por trecho de título, autor ou editora, tolerando diferenças
+ *
+ * @nome_arq - nome do arquivo binário contendo os livros
+ * @consulta - texto procurado (maiúsculas, acentos e pontuação são ignorados)
+ *
+ * Pré-condições:
+ *      - O arquivo pode ser aberto para leitura
+ *
+ * Pós-condições:
+ *      - Os livros são impressos por relevância: primeiro os que contêm a consulta como trecho,
+ *      depois os que compartilham mais trigramas com ela (ao menos metade)
+ *      - Retorna SUCESSO (0), inclusive se nenhum livro for encontrado
+ *      - Retorna valor negativo em caso de erro
+ */
+int buscar_texto_livro(const char *nome_arq, const char *consulta) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, nome_arq, NULL, NULL);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_buscar_texto_livro(&biblioteca, consulta);
+        biblioteca_fechar_arquivos(&biblioteca);
+        return retorno;
+}
+
+/*
+ * filtrar_livros_travado - função interna de biblioteca_filtrar_livros, com os arquivos já travados
+ */
+static int filtrar_livros_travado(BIBLIOTECA* biblioteca, int coluna, int operacao, int ignorar_caixa, const char *padrao) {
+        if (!biblioteca->livros.arquivo) {
+                return ERRO_ABRIR_ARQUIVO;
+        }
+        if (coluna < 0 || coluna >= COLUNAS_TEXTO_LIVRO || operacao < FILTRO_CONTEM || operacao > FILTRO_IGUAL) {
+                return ERRO_CAMPOS_INVALIDOS;
+        }
+
+        int encontrados;
+        int retorno = varrer_livros(biblioteca, coluna, operacao, ignorar_caixa, padrao, exibir_livro_resumido, NULL, &encontrados, NULL);
+        if (retorno == SUCESSO && encontrados == 0)
+                fprintf(biblioteca->saida, "Nenhum livro atende ao filtro informado.\n");
+
+        return retorno;
+}
+
+int biblioteca_filtrar_livros(BIBLIOTECA* biblioteca, int coluna, int operacao, int ignorar_caixa, const char *padrao) {
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_LIVROS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = filtrar_livros_travado(biblioteca, coluna, operacao, ignorar_caixa, padrao);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * filtrar_livros - Lista os livros cujo título, autor ou editora atende a um filtro, varrendo livro.str
+ *
+ * @nome_arq      - nome do arquivo binário contendo os livros
+ * @coluna        - COLUNA_TITULO, COLUNA_AUTOR ou COLUNA_EDITORA
+ * @operacao      - FILTRO_CONTEM, FILTRO_COMECA_COM ou FILTRO_IGUAL
+ * @ignorar_caixa - 1 para não diferenciar letras maiúsculas e minúsculas (ASCII)
+ * @padrao        - texto procurado
+ *
+ * Pré-condições:
+ *      - O arquivo pode ser aberto para leitura
+ *
+ * Pós-condições:
+ *      - Os livros que atendem ao filtro são impressos em ordem de posição no arquivo
+ *      - Retorna SUCESSO (0), inclusive se nenhum livro for encontrado
+ *      - Retorna ERRO_CAMPOS_INVALIDOS (-24) para coluna ou operação desconhecida
+ *      - Retorna valor negativo em caso de erro
+ */
+int filtrar_livros(const char *nome_arq, int coluna, int operacao, int ignorar_caixa, const char *padrao) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, nome_arq, NULL, NULL);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_filtrar_livros(&biblioteca, coluna, operacao, ignorar_caixa, padrao);
+        biblioteca_fechar_arquivos(&biblioteca);
+        return retorno;
+}
+
+/*
+ * segundos_desde - função interna que mede o tempo de processador decorrido desde um instante
+ */
+static double segundos_desde(clock_t inicio) {
+        return (double)(clock() - inicio) / CLOCKS_PER_SEC;
+}
+
+/*
+ * medir_varredura_livros_travado - função interna de biblioteca_medir_varredura_livros, com os arquivos já travados
+ */
+static int medir_varredura_livros_travado(BIBLIOTECA* biblioteca, const char *padrao) {
+        AREA_TEXTOS *textos = &biblioteca->textos_livros;
+        if (!biblioteca->livros.arquivo) {
+                return ERRO_ABRIR_ARQUIVO;
+        }
+        if (textos->tamanho == 0 || padrao[0] == '\0') {
+                fprintf(biblioteca->saida, "Nada a medir: a base nao tem textos ou o padrao esta vazio.\n");
+                return SUCESSO;
+        }
+
+        // núcleo: livro.str inteiro em memória, sem leitura de arquivo nem referências
+        size_t tamanho = (size_t)textos->tamanho;
+        size_t tamanho_padrao = strlen(padrao);
+        char *dados = malloc(tamanho);
+        if (dados == NULL)
+                return ERRO_ALOCAR_MEMORIA;
+        int retorno = textos_ler_trecho(textos, 0, tamanho, dados);
+        if (retorno != SUCESSO) {
+                free(dados);
+                return retorno;
+        }
+
+        int maximo = varredura_nivel_maximo();
+        fprintf(biblioteca->saida, "livro.str: %zu bytes; padrao \"%s\", sem diferenciar maiusculas\n\n", tamanho, padrao);
+        fprintf(biblioteca->saida, "%-8s %14s %18s %12s\n", "Nivel", "Nucleo (GB/s)", "Varredura (GB/s)", "Livros");
+
+        for (int nivel = maximo; nivel >= NIVEL_VARREDURA_ESCALAR && retorno == SUCESSO; nivel--) {
+                varredura_definir_nivel(nivel);
+
+                // cada medida repete a operação até somar TEMPO_MEDIDA_VARREDURA segundos
+                long long bytes = 0;
+                double segundos;
+                clock_t inicio = clock();
+                do {
+                        size_t posicao = 0;
+                        while (posicao < tamanho) {
+                                posicao += varredura_procurar(dados + posicao, tamanho - posicao, padrao, tamanho_padrao, 1) + 1;
+                        }
+                        bytes += (long long)tamanho;
+                } while ((segundos = segundos_desde(inicio)) < TEMPO_MEDIDA_VARREDURA);
+                double nucleo = (double)bytes / segundos / 1e9;
+
+                int encontrados = 0;
+                bytes = 0;
+                inicio = clock();
+                do {
+                        retorno = varrer_livros(biblioteca, COLUNA_TITULO, FILTRO_CONTEM, 1, padrao, NULL, NULL, &encontrados, &bytes);
+                } while (retorno == SUCESSO && (segundos = segundos_desde(inicio)) < TEMPO_MEDIDA_VARREDURA);
+
+                if (retorno == SUCESSO)
+                        fprintf(biblioteca->saida, "%-8s %14.2f %18.2f %12d\n", varredura_nome_nivel(nivel), nucleo, (double)bytes / segundos / 1e9, encontrados);
+        }
+
+        varredura_definir_nivel(maximo);
+        free(dados);
+
+        return retorno;
+}
+
+int biblioteca_medir_varredura_livros(BIBLIOTECA* biblioteca, const char *padrao) {
+        int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_LIVROS);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        retorno = medir_varredura_livros_travado(biblioteca, padrao);
+        biblioteca_destravar(biblioteca);
+
+        return retorno;
+}
+
+/*
+ * medir_varredura_livros - Mede a vazão (GB/s) da varredura de textos em cada nível disponível
+ *
+ * @nome_arq - nome do arquivo binário contendo os livros
+ * @padrao   - texto procurado nos títulos
+ *
+ * Para cada nível do núcleo de varredura (AVX2, SSE2, escalar) são medidos o núcleo sozinho,
+ * sobre livro.str inteiro em memória, e o filtro "título contém" completo (biblioteca_filtrar_livros,
+ * com leitura dos arquivos).
+ *
+ * Pré-condições:
+ *      - O arquivo pode ser aberto para leitura
+ *
+ * Pós-condições:
+ *      - Uma tabela com as vazões é impressa; o nível máximo volta a ser usado ao final
+ *      - Retorna SUCESSO (0) ou valor negativo em caso de erro
+ */
+int medir_varredura_livros(const char *nome_arq, const char *padrao) {
+        BIBLIOTECA biblioteca;
+        int retorno = biblioteca_abrir_arquivos(&biblioteca, nome_arq, NULL, NULL);
+        if (retorno != SUCESSO)
+                return retorno;
+
+        retorno = biblioteca_medir_varredura_livros(&biblioteca, padrao);
+        biblioteca_fechar_arquivos(&biblioteca);
+        return retorno;
 }
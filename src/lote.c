@@ -0,0 +1,422 @@
+#include "../include/lote.h"
+#include "../include/carga.h"
+#include "../include/erros.h"
+#include "../include/utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// Em caso de alteração da constante MAX_BUFFER_TEMP, alterar tamanho do sscanf na função 'interpretar_linha_lote' para MAX_BUFFER_TEMP - 1
+#define MAX_BUFFER_TEMP         256
+
+/*
+ * PEDACO_LOTE - conjunto de linhas consecutivas do arquivo de lote
+ *
+ * @primeira_linha - número (no arquivo) da primeira linha do pedaço
+ * @quantidade - quantidade de linhas lidas
+ * @interpretado - indica se todas as linhas já passaram por interpretar_linha_lote
+ * @linhas - texto de cada linha
+ * @resultado - registro montado para cada linha
+ */
+typedef struct {
+        int primeira_linha;
+        int quantidade;
+        int interpretado;
+        char linhas[LINHAS_POR_PEDACO][TAM_LINHA_LOTE];
+        LINHA_LOTE resultado[LINHAS_POR_PEDACO];
+} PEDACO_LOTE;
+
+void interpretar_linha_lote(char* linha, LINHA_LOTE* saida) {
+        linha[strcspn(linha, "\n")] = '\0';
+        trim(linha);
+
+        saida->lidos = 0;
+        // linhas com apenas o tipo não têm campos a ler
+        const char* campos = linha[0] != '\0' && linha[1] != '\0' ? linha + 2 : "";
+
+        if (linha[0] == 'L') {
+                LIVRO* livro = &saida->registro.livro;
+                char titulo_temp[MAX_BUFFER_TEMP] = "", autor_temp[MAX_BUFFER_TEMP] = "", editora_temp[MAX_BUFFER_TEMP] = "";
+
+                saida->tipo = LINHA_LIVRO;
+                saida->lidos = sscanf(campos, "%d;%255[^;];%255[^;];%255[^;];%d;%d;%d",
+                        &livro->codigo,
+                        titulo_temp,
+                        autor_temp,
+                        editora_temp,
+                        &livro->edicao,
+                        &livro->ano,
+                        &livro->exemplares
+                );
+                trim(titulo_temp);
+                trim(autor_temp);
+                trim(editora_temp);
+
+                // os campos são int: valores negativos tornam a linha incorreta
+                if (saida->lidos == 7 && (livro->codigo < 0 || livro->edicao < 0 || livro->ano < 0 || livro->exemplares < 0))
+                        saida->lidos = 0;
+
+                strncpy(livro->titulo, titulo_temp, MAX_TITULO);
+                livro->titulo[MAX_TITULO] = '\0';
+
+                strncpy(livro->autor, autor_temp, MAX_AUTOR);
+                livro->autor[MAX_AUTOR] = '\0';
+
+                strncpy(livro->editora, editora_temp, MAX_EDITORA);
+                livro->editora[MAX_EDITORA] = '\0';
+
+        } else if (linha[0] == 'U') {
+                USUARIO* usuario = &saida->registro.usuario;
+                char nome_temp[MAX_BUFFER_TEMP] = "";
+
+                saida->tipo = LINHA_USUARIO;
+                saida->lidos = sscanf(campos, "%u;%255[^\n]", &usuario->codigo, nome_temp);
+
+                trim(nome_temp);
+                strncpy(usuario->nome, nome_temp, MAX_NOME);
+                usuario->nome[MAX_NOME] = '\0';
+
+        } else if (linha[0] == 'E') {
+                EMPRESTIMO* emprestimo = &saida->registro.emprestimo;
+                char data_emp_temp[MAX_BUFFER_TEMP] = "", data_dev_temp[MAX_BUFFER_TEMP] = "";
+
+                saida->tipo = LINHA_EMPRESTIMO;
+                saida->lidos = sscanf(campos, "%u;%u;%255[^;];%255[^\n]",
+                        &emprestimo->codigo_usuario,
+                        &emprestimo->codigo_livro,
+                        data_emp_temp,
+                        data_dev_temp
+                );
+
+                trim(data_emp_temp);
+                trim(data_dev_temp);
+
+                // datas inválidas tornam a linha incorreta; sem devolução, a data fica DATA_NULA
+                emprestimo->data_devolucao = DATA_NULA;
+                if (saida->lidos >= 3 && converter_data(data_emp_temp, &emprestimo->data_emprestimo) != SUCESSO)
+                        saida->lidos = 0;
+                if (saida->lidos == 4 && data_dev_temp[0] != '\0' &&
+                    converter_data(data_dev_temp, &emprestimo->data_devolucao) != SUCESSO)
+                        saida->lidos = 0;
+
+        } else {
+                saida->tipo = linha_em_branco(linha) ? LINHA_BRANCO : LINHA_DESCONHECIDA;
+        }
+}
+
+/*
+ * aplicar_linha_lote - função interna que executa uma linha já interpretada e imprime os erros
+ *
+ * @carga - carga em lote onde a linha é aplicada
+ * @linha - texto da linha (usado na mensagem de tipo desconhecido)
+ * @interpretada - resultado de interpretar_linha_lote para a linha
+ * @numero_linha - número da linha no arquivo de lote
+ *
+ * Pós-condições:
+ *      - Erros de campos, de conflito de código e de empréstimo/devolução são impressos
+ *      com o número da linha; a carga segue para a próxima linha.
+ */
+static void aplicar_linha_lote(CARGA_LOTE* carga, const char* linha, LINHA_LOTE* interpretada, int numero_linha) {
+        if (interpretada->tipo == LINHA_LIVRO) {
+                int r1 = ERRO_CAMPOS_INVALIDOS;
+                // avaliação em curto-circuito
+                if(interpretada->lidos != 7 || (r1 = carga_cadastrar_livro(carga, interpretada->registro.livro)) != SUCESSO) {
+                        printf("Erro ao processar livro na linha %d", numero_linha);
+                }
+
+                if(r1 == ERRO_CAMPOS_INVALIDOS) {
+                        printf(": Campos incorretos\n");
+                }
+                if(r1 == ERRO_CONFLITO_ID)
+                        printf(": Codigo de livro já utilizado\n");
+
+        } else if (interpretada->tipo == LINHA_USUARIO) {
+                int r2 = ERRO_CAMPOS_INVALIDOS;
+                if (interpretada->lidos != 2 || (r2 = carga_cadastrar_usuario(carga, interpretada->registro.usuario)) != SUCESSO) {
+                        printf("Erro ao processar usuario na linha %d", numero_linha);
+                }
+
+                if(r2 == ERRO_CAMPOS_INVALIDOS) {
+                        printf(": Campos incorretos\n");
+                }
+                if(r2 == ERRO_CONFLITO_ID)
+                        printf(": Codigo de usuario ja utilizado\n");
+
+        } else if (interpretada->tipo == LINHA_EMPRESTIMO) {
+                const EMPRESTIMO* emprestimo = &interpretada->registro.emprestimo;
+
+                if (interpretada->lidos < 3) {
+                        printf("Erro ao processar emprestimo na linha %d: Campos incorretos\n", numero_linha);
+                }
+                else {
+                        int r3 = ERRO_CAMPOS_INVALIDOS;
+                        if ((r3 = carga_emprestar_livro(carga, emprestimo->codigo_usuario, emprestimo->codigo_livro, emprestimo->data_emprestimo)) != SUCESSO) {
+                                printf("Erro ao emprestar livro na linha %d", numero_linha);
+                        }
+                        if(r3 == ERRO_CONFLITO_ID)
+                                printf(": Codigos de livro e usuario ja utilizados\n");
+                        // Se foi fornecida a data de devolução
+                        if (interpretada->lidos == 4 && emprestimo->data_devolucao != DATA_NULA) {
+                                if (carga_devolver_livro(carga, emprestimo->codigo_usuario, emprestimo->codigo_livro, emprestimo->data_devolucao) != SUCESSO) {
+                                        printf("\nErro ao devolver livro na linha %d\n", numero_linha);
+                                }
+                        }
+                }
+
+        } else if (interpretada->tipo == LINHA_DESCONHECIDA) {
+                printf("Linha %d com tipo desconhecido: \"%s\"\n", numero_linha, linha);
+        }
+}
+
+/*
+ * ler_pedaco - função interna que lê até LINHAS_POR_PEDACO linhas do arquivo de lote
+ *
+ * @arquivo - arquivo de lote aberto para leitura
+ * @pedaco - pedaço que recebe as linhas
+ * @primeira_linha - número da primeira linha a ser lida
+ *
+ * Pós-condições:
+ *      - Retorna a quantidade de linhas lidas (menor que LINHAS_POR_PEDACO ao fim do arquivo).
+ */
+static int ler_pedaco(FILE* arquivo, PEDACO_LOTE* pedaco, int primeira_linha) {
+        pedaco->primeira_linha = primeira_linha;
+        pedaco->quantidade = 0;
+        pedaco->interpretado = 0;
+
+        while (pedaco->quantidade < LINHAS_POR_PEDACO
+                && fgets(pedaco->linhas[pedaco->quantidade], TAM_LINHA_LOTE, arquivo))
+                pedaco->quantidade++;
+
+        return pedaco->quantidade;
+}
+
+static void interpretar_pedaco(PEDACO_LOTE* pedaco) {
+        for (int i = 0; i < pedaco->quantidade; i++)
+                interpretar_linha_lote(pedaco->linhas[i], &pedaco->resultado[i]);
+}
+
+static void aplicar_pedaco(CARGA_LOTE* carga, PEDACO_LOTE* pedaco) {
+        for (int i = 0; i < pedaco->quantidade; i++)
+                aplicar_linha_lote(carga, pedaco->linhas[i], &pedaco->resultado[i], pedaco->primeira_linha + i);
+}
+
+/*
+ * executar_sequencial - função interna que lê, interpreta e aplica o lote em uma única thread
+ */
+static void executar_sequencial(FILE* arquivo, CARGA_LOTE* carga, PEDACO_LOTE* pedaco) {
+        int numero_linha = 1;
+
+        while (ler_pedaco(arquivo, pedaco, numero_linha) > 0) {
+                interpretar_pedaco(pedaco);
+                aplicar_pedaco(carga, pedaco);
+                numero_linha += pedaco->quantidade;
+        }
+}
+
+#ifndef _WIN32
+
+/*
+ * PIPELINE_LOTE - estado compartilhado entre as etapas de leitura, interpretação e aplicação
+ *
+ * @arquivo - arquivo de lote (usado apenas pela thread leitora)
+ * @pedacos - anel de num_pedacos pedaços; o pedaço de sequência s ocupa a posição s % num_pedacos
+ * @proximo_ler - sequência do próximo pedaço a ser lido
+ * @proximo_interpretar - sequência do próximo pedaço a ser entregue a uma thread de interpretação
+ * @proximo_aplicar - sequência do próximo pedaço a ser aplicado (ordem do arquivo)
+ * @fim_arquivo - indica que a thread leitora chegou ao fim do arquivo
+ * @encerrar - pede que as threads terminem sem pegar novos pedaços
+ * @trava / @mudou - protegem os campos acima e avisam qualquer mudança de estado
+ *
+ * Uma posição do anel só é reaproveitada depois que o pedaço anterior nela foi aplicado.
+ */
+typedef struct {
+        FILE* arquivo;
+        PEDACO_LOTE* pedacos;
+        int num_pedacos;
+        long proximo_ler;
+        long proximo_interpretar;
+        long proximo_aplicar;
+        int fim_arquivo;
+        int encerrar;
+        pthread_mutex_t trava;
+        pthread_cond_t mudou;
+} PIPELINE_LOTE;
+
+static void* etapa_leitura(void* argumento) {
+        PIPELINE_LOTE* pipeline = argumento;
+        int numero_linha = 1;
+
+        for (;;) {
+                pthread_mutex_lock(&pipeline->trava);
+                while (!pipeline->encerrar && pipeline->proximo_ler - pipeline->proximo_aplicar >= pipeline->num_pedacos)
+                        pthread_cond_wait(&pipeline->mudou, &pipeline->trava);
+                if (pipeline->encerrar) {
+                        pthread_mutex_unlock(&pipeline->trava);
+                        break;
+                }
+                PEDACO_LOTE* pedaco = &pipeline->pedacos[pipeline->proximo_ler % pipeline->num_pedacos];
+                pthread_mutex_unlock(&pipeline->trava);
+
+                int quantidade = ler_pedaco(pipeline->arquivo, pedaco, numero_linha);
+                numero_linha += quantidade;
+
+                pthread_mutex_lock(&pipeline->trava);
+                if (quantidade > 0)
+                        pipeline->proximo_ler++;
+                if (quantidade < LINHAS_POR_PEDACO)
+                        pipeline->fim_arquivo = 1;
+                pthread_cond_broadcast(&pipeline->mudou);
+                pthread_mutex_unlock(&pipeline->trava);
+
+                if (quantidade < LINHAS_POR_PEDACO)
+                        break;
+        }
+
+        return NULL;
+}
+
+static void* etapa_interpretacao(void* argumento) {
+        PIPELINE_LOTE* pipeline = argumento;
+
+        for (;;) {
+                pthread_mutex_lock(&pipeline->trava);
+                while (!pipeline->encerrar && !pipeline->fim_arquivo
+                        && pipeline->proximo_interpretar == pipeline->proximo_ler)
+                        pthread_cond_wait(&pipeline->mudou, &pipeline->trava);
+                if (pipeline->encerrar || pipeline->proximo_interpretar == pipeline->proximo_ler) {
+                        pthread_mutex_unlock(&pipeline->trava);
+                        break;
+                }
+                PEDACO_LOTE* pedaco = &pipeline->pedacos[pipeline->proximo_interpretar++ % pipeline->num_pedacos];
+                pthread_mutex_unlock(&pipeline->trava);
+
+                interpretar_pedaco(pedaco);
+
+                pthread_mutex_lock(&pipeline->trava);
+                pedaco->interpretado = 1;
+                pthread_cond_broadcast(&pipeline->mudou);
+                pthread_mutex_unlock(&pipeline->trava);
+        }
+
+        return NULL;
+}
+
+/*
+ * etapa_aplicacao - função interna que aplica os pedaços interpretados na ordem do arquivo
+ *
+ * Executada pela thread chamadora; é a única etapa que acessa a carga e imprime mensagens.
+ */
+static void etapa_aplicacao(PIPELINE_LOTE* pipeline, CARGA_LOTE* carga) {
+        for (;;) {
+                pthread_mutex_lock(&pipeline->trava);
+                PEDACO_LOTE* pedaco = &pipeline->pedacos[pipeline->proximo_aplicar % pipeline->num_pedacos];
+                while (!(pipeline->proximo_aplicar < pipeline->proximo_ler && pedaco->interpretado)
+                        && !(pipeline->fim_arquivo && pipeline->proximo_aplicar == pipeline->proximo_ler))
+                        pthread_cond_wait(&pipeline->mudou, &pipeline->trava);
+                if (pipeline->proximo_aplicar == pipeline->proximo_ler) {
+                        pthread_mutex_unlock(&pipeline->trava);
+                        break;
+                }
+                pthread_mutex_unlock(&pipeline->trava);
+
+                aplicar_pedaco(carga, pedaco);
+
+                pthread_mutex_lock(&pipeline->trava);
+                pipeline->proximo_aplicar++;
+                pthread_cond_broadcast(&pipeline->mudou);
+                pthread_mutex_unlock(&pipeline->trava);
+        }
+}
+
+/*
+ * calcular_threads_lote - função interna que define quantas threads de interpretação usar
+ *
+ * Pós-condições:
+ *      - Retorna NUM_THREADS_LOTE, se definido, ou o número de processadores menos um
+ *      (reservado para a aplicação), limitado a MAX_THREADS_LOTE. Retorna 0 em máquinas
+ *      com um único processador, indicando execução sequencial.
+ */
+static int calcular_threads_lote(void) {
+        long threads = NUM_THREADS_LOTE;
+        if (threads <= 0)
+                threads = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+        if (threads < 0)
+                threads = 0;
+        if (threads > MAX_THREADS_LOTE)
+                threads = MAX_THREADS_LOTE;
+        return (int)threads;
+}
+
+#endif // _WIN32
+
+int executar_lote(FILE* arquivo, CARGA_LOTE* carga) {
+#ifdef _WIN32
+        PEDACO_LOTE* pedaco = malloc(sizeof(PEDACO_LOTE));
+        if (pedaco == NULL)
+                return ERRO_ALOCAR_MEMORIA;
+
+        executar_sequencial(arquivo, carga, pedaco);
+        free(pedaco);
+        return SUCESSO;
+#else
+        int num_threads = calcular_threads_lote();
+        PIPELINE_LOTE pipeline = {
+                .arquivo = arquivo,
+                .num_pedacos = num_threads > 0 ? 2 * num_threads + 2 : 1
+        };
+
+        pipeline.pedacos = malloc((size_t)pipeline.num_pedacos * sizeof(PEDACO_LOTE));
+        if (pipeline.pedacos == NULL)
+                return ERRO_ALOCAR_MEMORIA;
+
+        if (num_threads == 0)
+                goto sequencial;
+
+        pthread_t leitora;
+        pthread_t interpretadoras[MAX_THREADS_LOTE];
+        int criadas = 0;
+
+        pthread_mutex_init(&pipeline.trava, NULL);
+        pthread_cond_init(&pipeline.mudou, NULL);
+
+        // as interpretadoras ficam à espera até a leitora começar, então uma falha aqui não consome linhas
+        while (criadas < num_threads
+                && pthread_create(&interpretadoras[criadas], NULL, etapa_interpretacao, &pipeline) == 0)
+                criadas++;
+
+        if (criadas == 0 || pthread_create(&leitora, NULL, etapa_leitura, &pipeline) != 0) {
+                pthread_mutex_lock(&pipeline.trava);
+                pipeline.encerrar = 1;
+                pthread_cond_broadcast(&pipeline.mudou);
+                pthread_mutex_unlock(&pipeline.trava);
+
+                for (int i = 0; i < criadas; i++)
+                        pthread_join(interpretadoras[i], NULL);
+                pthread_cond_destroy(&pipeline.mudou);
+                pthread_mutex_destroy(&pipeline.trava);
+                goto sequencial;
+        }
+
+        etapa_aplicacao(&pipeline, carga);
+
+        pthread_join(leitora, NULL);
+        for (int i = 0; i < criadas; i++)
+                pthread_join(interpretadoras[i], NULL);
+        pthread_cond_destroy(&pipeline.mudou);
+        pthread_mutex_destroy(&pipeline.trava);
+
+        free(pipeline.pedacos);
+        return SUCESSO;
+
+sequencial:
+        executar_sequencial(arquivo, carga, &pipeline.pedacos[0]);
+        free(pipeline.pedacos);
+        return SUCESSO;
+#endif // _WIN32
+}
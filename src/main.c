@@ -1,6 +1,8 @@
 #include "../include/arquivo.h"
+#include "../include/biblioteca.h"
 #include "../include/emprestimo.h"
 #include "../include/livro.h"
+#include "../include/servidor.h"
 #include "../include/usuario.h"
 #include "../include/utils.h"
 
@@ -10,21 +12,40 @@
 void limpar_enter (char *str);
 void exibir_menu ();
 
-void opcao_cadastrar_livro (char* caminho_livros);
-void opcao_imprimir_livro(char* caminho_livros);
-void opcao_cadastrar_usuario (char* caminho_usuarios);
-void opcao_buscar_por_titulo (char *caminho_livros);
-void opcao_emprestar_livro(char* caminho_emprestimos, char* caminho_livros, char* caminho_usuarios);
-void opcao_devolver_livro(char* caminho_emprestimos, char* caminho_livros);
-void opcao_total_cadastrados(char *caminho_livros);
-void opcao_carregar_lote(char* caminho_emprestimos, char* caminho_livros, char* caminho_usuarios);
-
-int main () {
+void opcao_cadastrar_livro (BIBLIOTECA* biblioteca);
+void opcao_imprimir_livro(BIBLIOTECA* biblioteca);
+void opcao_cadastrar_usuario (BIBLIOTECA* biblioteca);
+void opcao_buscar_por_titulo (BIBLIOTECA* biblioteca);
+void opcao_emprestar_livro(BIBLIOTECA* biblioteca);
+void opcao_devolver_livro(BIBLIOTECA* biblioteca);
+void opcao_total_cadastrados(BIBLIOTECA* biblioteca);
+void opcao_carregar_lote(BIBLIOTECA* biblioteca);
+void opcao_listar_usuarios_intervalo(BIBLIOTECA* biblioteca);
+void opcao_buscar_prefixo_titulo(BIBLIOTECA* biblioteca);
+void opcao_listar_titulos_intervalo(BIBLIOTECA* biblioteca);
+void opcao_buscar_por_autor(BIBLIOTECA* biblioteca);
+void opcao_buscar_por_texto(BIBLIOTECA* biblioteca);
+void opcao_filtrar_livros(BIBLIOTECA* biblioteca);
+void opcao_medir_varredura(BIBLIOTECA* biblioteca);
+void opcao_listar_emprestimos_periodo(BIBLIOTECA* biblioteca);
+void opcao_listar_emprestimos_usuario(BIBLIOTECA* biblioteca);
+void opcao_listar_emprestimos_livro(BIBLIOTECA* biblioteca);
+void opcao_iniciar_transacao(BIBLIOTECA* biblioteca);
+void opcao_confirmar_transacao(BIBLIOTECA* biblioteca);
+void opcao_desfazer_transacao(BIBLIOTECA* biblioteca);
+int executar_servidor(char* diretorio, const char* caminho_socket);
+
+int main (int argc, char* argv[]) {
         char diretorio[TAM_MAX_CAMINHO];
-        char caminho_livros[TAM_MAX_CAMINHO];
-        char caminho_usuarios[TAM_MAX_CAMINHO];
-        char caminho_emprestimos[TAM_MAX_CAMINHO];
-        int sucesso = 0;
+        BIBLIOTECA* biblioteca = NULL;
+
+        if (argc > 1) {
+                if (argc == 4 && strcmp(argv[1], "--servidor") == 0)
+                        return executar_servidor(argv[2], argv[3]);
+
+                printf("Uso: %s [--servidor <diretorio> <socket>]\n", argv[0]);
+                return 1;
+        }
 
         printf("------ SISTEMA BIBLIOTECA ------\n");
 
@@ -37,24 +58,13 @@ int main () {
                         strcpy(diretorio, ".");
                 }
 
-                strncpy(caminho_livros, diretorio, TAM_MAX_CAMINHO - 1);
-                construir_caminho_completo(caminho_livros, "livro.dat");
-
-                strncpy(caminho_usuarios, diretorio, TAM_MAX_CAMINHO - 1);
-                construir_caminho_completo(caminho_usuarios, "usuario.dat");
-
-                strncpy(caminho_emprestimos, diretorio, TAM_MAX_CAMINHO - 1);
-                construir_caminho_completo(caminho_emprestimos, "emprestimo.dat");
-
-                int r = inicializar_base_de_dados(diretorio);
-                if (r < 0) {
+                // arquivos e cabeçalhos ficam abertos até o fim do programa
+                biblioteca = biblioteca_abrir(diretorio);
+                if (biblioteca == NULL) {
                         printf("Nao foi possivel inicializar os arquivos no diretorio '%s'.\n", diretorio);
                         printf("Verifique se o caminho existe e se ha permissoes de escrita/leitura.\n\n");
                 }
-                else {
-                        sucesso = 1;
-                }
-        } while (!sucesso);
+        } while (biblioteca == NULL);
 
         int opcao;
         do {
@@ -66,34 +76,73 @@ int main () {
 
                 switch (opcao) {
                         case 1:
-                                opcao_cadastrar_livro(caminho_livros);
+                                opcao_cadastrar_livro(biblioteca);
                                 break;
                         case 2:
-                                opcao_imprimir_livro(caminho_livros);
+                                opcao_imprimir_livro(biblioteca);
                                 break;
                         case 3:
-                                listar_todos_livros(caminho_livros);
+                                biblioteca_listar_todos_livros(biblioteca);
                                 break;
                         case 4:
-                                opcao_buscar_por_titulo(caminho_livros);
+                                opcao_buscar_por_titulo(biblioteca);
                                 break;
                         case 5:
-                                opcao_total_cadastrados(caminho_livros);
+                                opcao_total_cadastrados(biblioteca);
                                 break;
                         case 6:
-                                opcao_cadastrar_usuario(caminho_usuarios);
+                                opcao_cadastrar_usuario(biblioteca);
                                 break;
                         case 7:
-                                opcao_emprestar_livro(caminho_emprestimos,caminho_livros,caminho_usuarios);
+                                opcao_emprestar_livro(biblioteca);
                                 break;
                         case 8:
-                                opcao_devolver_livro(caminho_emprestimos,caminho_livros);
+                                opcao_devolver_livro(biblioteca);
                                 break;
                         case 9:
-                                listar_livros_emprestados(caminho_emprestimos, caminho_livros, caminho_usuarios);
+                                biblioteca_listar_livros_emprestados(biblioteca);
                                 break;
                         case 10:
-                                opcao_carregar_lote(caminho_emprestimos, caminho_livros, caminho_usuarios);
+                                opcao_carregar_lote(biblioteca);
+                                break;
+                        case 11:
+                                opcao_listar_usuarios_intervalo(biblioteca);
+                                break;
+                        case 12:
+                                opcao_buscar_prefixo_titulo(biblioteca);
+                                break;
+                        case 13:
+                                opcao_listar_titulos_intervalo(biblioteca);
+                                break;
+                        case 14:
+                                opcao_buscar_por_autor(biblioteca);
+                                break;
+                        case 15:
+                                opcao_buscar_por_texto(biblioteca);
+                                break;
+                        case 16:
+                                opcao_filtrar_livros(biblioteca);
+                                break;
+                        case 17:
+                                opcao_medir_varredura(biblioteca);
+                                break;
+                        case 18:
+                                opcao_listar_emprestimos_periodo(biblioteca);
+                                break;
+                        case 19:
+                                opcao_listar_emprestimos_usuario(biblioteca);
+                                break;
+                        case 20:
+                                opcao_listar_emprestimos_livro(biblioteca);
+                                break;
+                        case 21:
+                                opcao_iniciar_transacao(biblioteca);
+                                break;
+                        case 22:
+                                opcao_confirmar_transacao(biblioteca);
+                                break;
+                        case 23:
+                                opcao_desfazer_transacao(biblioteca);
                                 break;
                         case 0:
                                 printf("Encerrando o programa.\n");
@@ -104,9 +153,47 @@ int main () {
 
         } while (opcao != 0);
 
+        biblioteca_fechar(biblioteca);
+
         return SUCESSO;
 }
 
+/*
+ * executar_servidor - abre a base e a atende pelo socket informado, sem o menu
+ *
+ * @diretorio - diretório dos arquivos da base
+ * @caminho_socket - caminho do socket local (servidor.h)
+ *
+ * Pré-condições:
+ *              - Nenhum outro processo pode estar usando a base.
+ * Pós-condições:
+ *              - A base é fechada quando o servidor recebe SIGINT ou SIGTERM.
+ *              - Retorna SUCESSO (0) ou 1 se a base ou o socket não puderem ser abertos.
+ */
+int executar_servidor(char* diretorio, const char* caminho_socket) {
+        // o servidor concentra todos os acessos à base: sem travas por operação e com confirmação em grupo
+        BIBLIOTECA* biblioteca = biblioteca_abrir_exclusiva(diretorio);
+        if (biblioteca == NULL) {
+                printf("Nao foi possivel abrir a base no diretorio '%s' (ou ela esta em uso por outro processo).\n", diretorio);
+                return 1;
+        }
+
+        printf("Servidor da biblioteca em '%s'. Encerre com Ctrl+C.\n", caminho_socket);
+        fflush(stdout);
+
+        int retorno = servidor_executar(biblioteca, caminho_socket);
+        if (retorno == ERRO_SOCKET)
+                printf("Nao foi possivel criar o socket '%s'.\n", caminho_socket);
+        else if (retorno != SUCESSO)
+                printf("Nao foi possivel iniciar as threads do servidor.\n");
+        else
+                printf("Servidor encerrado.\n");
+
+        biblioteca_fechar(biblioteca);
+
+        return retorno == SUCESSO ? SUCESSO : 1;
+}
+
 /*
  * limpar_enter - remover caractere '\n' de string
  *
@@ -142,6 +229,19 @@ void exibir_menu() {
         printf("8  - DEVOLVER LIVRO\n");
         printf("9  - LISTAR LIVROS EMPRESTADOS\n");
         printf("10 - CARREGAR ARQUIVO\n");
+        printf("11 - LISTAR USUARIOS POR FAIXA DE CODIGO\n");
+        printf("12 - BUSCAR LIVROS POR INICIO DO TITULO\n");
+        printf("13 - LISTAR LIVROS POR FAIXA DE TITULO\n");
+        printf("14 - BUSCAR LIVROS POR AUTOR\n");
+        printf("15 - BUSCAR LIVROS POR TRECHO DE TEXTO\n");
+        printf("16 - FILTRAR LIVROS (VARREDURA)\n");
+        printf("17 - MEDIR VELOCIDADE DA VARREDURA\n");
+        printf("18 - LISTAR EMPRESTIMOS POR PERIODO\n");
+        printf("19 - LISTAR EMPRESTIMOS DE UM USUARIO\n");
+        printf("20 - CONSULTAR CIRCULACAO DE UM LIVRO\n");
+        printf("21 - INICIAR TRANSACAO\n");
+        printf("22 - CONFIRMAR TRANSACAO\n");
+        printf("23 - DESFAZER TRANSACAO\n");
         printf("0  - SAIR\n");
         printf("========================\n");
 }
@@ -149,7 +249,7 @@ void exibir_menu() {
 /*
  * opcao_cadastrar_livro - interage com usuário para cadastrar novo livro
  *
- * @caminho_livros - caminho completo para o arquivo binário que armazena livros.
+ * @biblioteca - base de dados aberta por biblioteca_abrir
  *
  * Pré-condições:
  *              - O caminho para o arquivo deve ser válido.
@@ -157,7 +257,7 @@ void exibir_menu() {
  * Pós-condições:
  *              - Um novo livro é adicionado ao arquivo, se todos os dados forem válidos
  */
-void opcao_cadastrar_livro(char* caminho_livros) {
+void opcao_cadastrar_livro(BIBLIOTECA* biblioteca) {
         LIVRO livro;
 
         printf("\nCodigo do livro: ");
@@ -199,7 +299,7 @@ void opcao_cadastrar_livro(char* caminho_livros) {
         livro.exemplares = exemplares;
 
         int resposta;
-        if((resposta = cadastrar_livro(caminho_livros,livro)) != 0) {
+        if((resposta = biblioteca_cadastrar_livro(biblioteca, livro)) != 0) {
                 printf("\nErro ao cadastrar livro");
 
                 if(resposta == ERRO_CONFLITO_ID)
@@ -215,7 +315,7 @@ void opcao_cadastrar_livro(char* caminho_livros) {
 /*
  * opcao_imprimir_livro - interage com o usuário para imprimir informações sobre livro
  *
- * @caminho_livros - caminho completo para arquivo binário que armazena livros
+ * @biblioteca - base de dados aberta por biblioteca_abrir
  *
  * Pré-condições:
  *              - Caminho para arquivo deve ser válido e ser acessível em modo leitura e escrita.
@@ -223,7 +323,7 @@ void opcao_cadastrar_livro(char* caminho_livros) {
  * Pós-condições:
  *              - Imprime informações sobre livro, se encontrado
  */
-void opcao_imprimir_livro(char* caminho_livros) {
+void opcao_imprimir_livro(BIBLIOTECA* biblioteca) {
         unsigned int codigo;
 
         printf("Digite o codigo do livro: ");
@@ -232,7 +332,7 @@ void opcao_imprimir_livro(char* caminho_livros) {
                 printf("Digite o codigo do livro: ");
         }
 
-        int retorno = imprimir_livro(caminho_livros, codigo);
+        int retorno = biblioteca_imprimir_livro(biblioteca, codigo);
         if (retorno != 0) {
                 if (retorno == ERRO_ENCONTRAR_LIVRO) {
                         printf("\nLivro com codigo \"%d\" não encontrado.\n", codigo);
@@ -246,7 +346,7 @@ void opcao_imprimir_livro(char* caminho_livros) {
 /*
  * opcao_cadastrar_usuario - interage com o usuário para cadastrar usuário
  *
- * @caminho_usuarios - caminho completo para arquivo binário que armazena usuários
+ * @biblioteca - base de dados aberta por biblioteca_abrir
  *
  * Pré-condições:
  *              - Caminho para o arquivo deve ser válido e pode ser aberto em modo leitura e escrita.
@@ -254,7 +354,7 @@ void opcao_imprimir_livro(char* caminho_livros) {
  * Pós-condições:
  *              - Usuário é registrado se todas as informações forem válidas.
  */
-void opcao_cadastrar_usuario (char* caminho_usuarios) {
+void opcao_cadastrar_usuario (BIBLIOTECA* biblioteca) {
         USUARIO usuario;
 
         printf("\nInsira o nome do usuario: ");
@@ -268,7 +368,7 @@ void opcao_cadastrar_usuario (char* caminho_usuarios) {
         }
 
         int retorno;
-        if((retorno = cadastrar_usuario(caminho_usuarios, usuario)) == 0) {
+        if((retorno = biblioteca_cadastrar_usuario(biblioteca, usuario)) == 0) {
                 printf("\nUsuario cadastrado com sucesso!\n");
         }
         else {
@@ -281,7 +381,7 @@ void opcao_cadastrar_usuario (char* caminho_usuarios) {
 /*
  * opcao_buscar_por_titulo - interage com o usuário para realizar busca de livro por título
  *
- * @caminho_livros - caminho completo para arquivo binário que armazena livros
+ * @biblioteca - base de dados aberta por biblioteca_abrir
  *
  * Pré-condições:
  *              - Arquivo deve ser válido e pode ser aberto em leitura e escrita.
@@ -289,22 +389,20 @@ void opcao_cadastrar_usuario (char* caminho_usuarios) {
  * Pós-condições:
  *              - Livro buscado é exibido se for encontrado pelo título.
  */
-void opcao_buscar_por_titulo (char *caminho_livros) {
+void opcao_buscar_por_titulo (BIBLIOTECA* biblioteca) {
         char titulo[MAX_TITULO+1];
 
         printf("\nInsira o nome do livro: ");
         fgets(titulo, MAX_TITULO+1, stdin);
         titulo[strcspn(titulo, "\n")] = '\0';
 
-        buscar_titulo_livro(caminho_livros, titulo);
+        biblioteca_buscar_titulo_livro(biblioteca, titulo);
 }
 
 /*
  * opcao_emprestar_livro - interage com o usuário para realizar empréstimo de livro
  *
- * @caminho_emprestimos - caminho completo para arquivo binário de empréstimos.
- * @caminho_livros - caminho completo para arquivo binário de livros.
- * @caminho_usuarios - caminho completo para arquivo binário de usuários.
+ * @biblioteca - base de dados aberta por biblioteca_abrir
  *
  * Pré-condições:
  *              - Arquivos devem ser válidos com permissões de leitura e escrita.
@@ -313,8 +411,8 @@ void opcao_buscar_por_titulo (char *caminho_livros) {
  *              - Empréstimo é registrado se dados fornecidos forem corretos.
  *              - Quantidade de exemplares do livro emprestado é decrementada.
  */
-void opcao_emprestar_livro (char* caminho_emprestimos, char* caminho_livros, char* caminho_usuarios) {
-        char data[MAX_DATA+1];
+void opcao_emprestar_livro (BIBLIOTECA* biblioteca) {
+        int data;
 	unsigned int codigo_usuario;
 	unsigned int codigo_livro;
 	
@@ -330,13 +428,13 @@ void opcao_emprestar_livro (char* caminho_emprestimos, char* caminho_livros, cha
 	        printf("Digite o codigo do livro: ");
         }
 
-        if(obter_data_atual(data, sizeof(data)) != 0) {
+        if(obter_data_atual(&data) != 0) {
                 printf("\nNao foi possivel obter a data atual. Emprestimo nao registrado.");
                 return;
         }
 
         int res = 0;
-        if((res = emprestar_livro(caminho_emprestimos, caminho_livros, caminho_usuarios, codigo_usuario, codigo_livro, data)) < 0)
+        if((res = biblioteca_emprestar_livro(biblioteca, codigo_usuario, codigo_livro, data)) < 0)
                 printf("\nErro ao realizar o emprestimo do livro\n");
         else
                 printf("\nLivro cadastrado com sucesso\n");
@@ -350,8 +448,7 @@ void opcao_emprestar_livro (char* caminho_emprestimos, char* caminho_livros, cha
 /*
  * opcao_devolver_livro - interage com o usuário para registrar devolução de livro
  *
- * @caminho_emprestimos - caminho completo para arquivo binário de empréstimos.
- * @caminho_livros - caminho completo para arquivo binário de livros.
+ * @biblioteca - base de dados aberta por biblioteca_abrir
  *
  * Pré-condições:
  *              - Arquivos devem ser válidos e podem ser acessados em leitura e escrita.
@@ -360,8 +457,8 @@ void opcao_emprestar_livro (char* caminho_emprestimos, char* caminho_livros, cha
  *              - Devolução de livro é registrada se todos os dados forem corretos.
  *              - Quantidade de exemplares do livro devolvido é incrementada.
  */
-void opcao_devolver_livro (char* caminho_emprestimos, char*caminho_livros) {
-	char data[MAX_DATA + 1];
+void opcao_devolver_livro (BIBLIOTECA* biblioteca) {
+	int data;
 	unsigned int codigo_usuario;
 	unsigned int codigo_livro;
 
@@ -377,13 +474,12 @@ void opcao_devolver_livro (char* caminho_emprestimos, char*caminho_livros) {
 	        printf("Digite o codigo do livro: ");
         }
 
-        if(obter_data_atual(data, sizeof(data)) != 0) {
+        if(obter_data_atual(&data) != 0) {
                 printf("\nNao foi possivel obter a data atual. Devolucao nao registrada.");
                 return;
         }
-        data[MAX_DATA] = '\0';
 
-        if(devolver_livro(caminho_emprestimos, caminho_livros, codigo_usuario, codigo_livro, data ) < 0 )
+        if(biblioteca_devolver_livro(biblioteca, codigo_usuario, codigo_livro, data ) < 0 )
                 printf("Erro ao realizar a devolucao do livro\n");
         else
                 printf("Devolucao realizada com sucesso\n");
@@ -392,7 +488,7 @@ void opcao_devolver_livro (char* caminho_emprestimos, char*caminho_livros) {
 /*
  * opcao_total_cadastrados - exibe quantidade total de livros cadastrados
  *
- * @caminho_livros - caminho completo para arquivo binário de livros
+ * @biblioteca - base de dados aberta por biblioteca_abrir
  *
  * Pré-condições:
  *              - Arquivo deve ser válido e possuir permissões de leitura.
@@ -400,8 +496,8 @@ void opcao_devolver_livro (char* caminho_emprestimos, char*caminho_livros) {
  * Pós-condições:
  *              - Quantidade total de livros cadastrados é exibida.
  */
-void opcao_total_cadastrados(char *caminho_livros) {
-        int quantidade_total_livros = calcular_total_livros(caminho_livros);
+void opcao_total_cadastrados(BIBLIOTECA* biblioteca) {
+        int quantidade_total_livros = biblioteca_calcular_total_livros(biblioteca);
         if(quantidade_total_livros!=0) {
                 printf("Erro ao calcular total de livros\n");
         }
@@ -410,9 +506,7 @@ void opcao_total_cadastrados(char *caminho_livros) {
 /*
  * opcao_carregar_lote - interage com usuário para carregar informações em lote
  *
- * @caminho_emprestimos - caminho completo para arquivo binário de empréstimos
- * @caminho_livros - caminho completo para arquivo binário de livros
- * @caminho_usuarios - caminho completo para arquivo de usuários
+ * @biblioteca - base de dados aberta por biblioteca_abrir
  *
  * Pré-condições:
  *              - Arquivos devem ser válidos e possuir permissões de leitura e escrita.
@@ -421,17 +515,379 @@ void opcao_total_cadastrados(char *caminho_livros) {
  *              - Registro de livros, usuários e empréstimos é feito se estiverem no
  *              formato correto.
  */
-void opcao_carregar_lote(char* caminho_emprestimos, char* caminho_livros, char* caminho_usuarios) {
+void opcao_carregar_lote(BIBLIOTECA* biblioteca) {
         char diretorio[TAM_MAX_CAMINHO];
         printf("\nInforme o caminho para o arquivo contendo os registros\n");
         printf("Ha suporte para o formato \"./nome_exemplo.txt\" para indicar diretorio atual\n");
         fgets(diretorio, TAM_MAX_CAMINHO, stdin);
         diretorio[strcspn(diretorio, "\n")] = '\0';
 
-        int retorno = processar_lote(diretorio, caminho_emprestimos, caminho_livros, caminho_usuarios);
+        int retorno = biblioteca_processar_lote(biblioteca, diretorio);
 
         if(retorno == ERRO_ABRIR_ARQUIVO)
                 printf("\nNao foi possivel abrir o arquivo\n");
+        else if(retorno == ERRO_TRANSACAO)
+                printf("\nConfirme ou desfaca a transacao em andamento antes da carga\n");
+        else if(retorno != SUCESSO)
+                printf("\nErro ao gravar os dados carregados\n");
         else
                 printf("\nCarregamento concluido!\n");
 }
+
+/*
+ * opcao_listar_usuarios_intervalo - interage com o usuário para listar usuários de uma faixa de códigos
+ *
+ * @biblioteca - base de dados aberta por biblioteca_abrir
+ *
+ * Pré-condições:
+ *              - Arquivo deve ser válido e possuir permissões de leitura.
+ *              - Arquivo deve estar inicializado (com cabeçalho).
+ * Pós-condições:
+ *              - Usuários com código dentro da faixa informada são exibidos em ordem crescente.
+ */
+void opcao_listar_usuarios_intervalo(BIBLIOTECA* biblioteca) {
+        unsigned int codigo_inicial, codigo_final;
+
+        printf("\nCodigo inicial: ");
+        while (!ler_unsigned_int_com_zero(&codigo_inicial)) {
+                printf("Digite um valor valido (nao negativo)\n");
+                printf("Codigo inicial: ");
+        }
+
+        printf("\nCodigo final: ");
+        while (!ler_unsigned_int_com_zero(&codigo_final) || codigo_final < codigo_inicial) {
+                printf("Digite um valor valido (maior ou igual ao codigo inicial)\n");
+                printf("Codigo final: ");
+        }
+
+        printf("\n");
+        if (biblioteca_listar_usuarios_intervalo(biblioteca, codigo_inicial, codigo_final) != 0)
+                printf("\nErro ao listar usuarios\n");
+}
+
+/*
+ * opcao_buscar_prefixo_titulo - interage com o usuário para buscar livros pelo início do título
+ *
+ * @biblioteca - base de dados aberta por biblioteca_abrir
+ *
+ * Pré-condições:
+ *              - Arquivo deve ser válido e possuir permissões de leitura.
+ *              - Arquivo deve estar inicializado (com cabeçalho).
+ * Pós-condições:
+ *              - Livros cujo título começa com o texto informado são exibidos em ordem alfabética.
+ */
+void opcao_buscar_prefixo_titulo(BIBLIOTECA* biblioteca) {
+        char prefixo[MAX_TITULO+1];
+
+        printf("\nInsira o inicio do titulo: ");
+        fgets(prefixo, MAX_TITULO+1, stdin);
+        prefixo[strcspn(prefixo, "\n")] = '\0';
+
+        printf("\n");
+        if (biblioteca_buscar_prefixo_titulo_livro(biblioteca, prefixo) != 0)
+                printf("\nErro ao buscar livros\n");
+}
+
+/*
+ * opcao_listar_titulos_intervalo - interage com o usuário para listar livros de uma faixa de títulos
+ *
+ * @biblioteca - base de dados aberta por biblioteca_abrir
+ *
+ * Pré-condições:
+ *              - Arquivo deve ser válido e possuir permissões de leitura.
+ *              - Arquivo deve estar inicializado (com cabeçalho).
+ * Pós-condições:
+ *              - Livros com título entre os dois informados (inclusive) são exibidos em ordem alfabética.
+ */
+void opcao_listar_titulos_intervalo(BIBLIOTECA* biblioteca) {
+        char titulo_inicial[MAX_TITULO+1];
+        char titulo_final[MAX_TITULO+1];
+
+        printf("\nTitulo inicial: ");
+        fgets(titulo_inicial, MAX_TITULO+1, stdin);
+        titulo_inicial[strcspn(titulo_inicial, "\n")] = '\0';
+
+        printf("\nTitulo final: ");
+        fgets(titulo_final, MAX_TITULO+1, stdin);
+        titulo_final[strcspn(titulo_final, "\n")] = '\0';
+
+        printf("\n");
+        if (biblioteca_listar_livros_intervalo_titulo(biblioteca, titulo_inicial, titulo_final) != 0)
+                printf("\nErro ao listar livros\n");
+}
+
+/*
+ * opcao_buscar_por_autor - interage com o usuário para listar os livros de um autor
+ *
+ * @biblioteca - base de dados aberta por biblioteca_abrir
+ *
+ * Pré-condições:
+ *              - Arquivo deve ser válido e possuir permissões de leitura.
+ *              - Arquivo deve estar inicializado (com cabeçalho).
+ * Pós-condições:
+ *              - Título e código de cada livro do autor informado são exibidos.
+ */
+void opcao_buscar_por_autor(BIBLIOTECA* biblioteca) {
+        char autor[MAX_AUTOR+1];
+
+        printf("\nInsira o nome do autor: ");
+        fgets(autor, MAX_AUTOR+1, stdin);
+        autor[strcspn(autor, "\n")] = '\0';
+
+        printf("\n");
+        if (biblioteca_buscar_autor_livro(biblioteca, autor) != 0)
+                printf("\nErro ao buscar livros\n");
+}
+
+/*
+ * opcao_buscar_por_texto - interage com o usuário para buscar livros por trecho de título, autor ou editora
+ *
+ * @biblioteca - base de dados aberta por biblioteca_abrir
+ *
+ * Pré-condições:
+ *              - Arquivo deve ser válido e possuir permissões de leitura.
+ *              - Arquivo deve estar inicializado (com cabeçalho).
+ * Pós-condições:
+ *              - Livros semelhantes ao texto informado são exibidos, dos mais relevantes aos menos.
+ */
+void opcao_buscar_por_texto(BIBLIOTECA* biblioteca) {
+        char consulta[MAX_TITULO+1];
+
+        printf("\nInsira o texto a buscar: ");
+        fgets(consulta, MAX_TITULO+1, stdin);
+        consulta[strcspn(consulta, "\n")] = '\0';
+
+        printf("\n");
+        if (biblioteca_buscar_texto_livro(biblioteca, consulta) != 0)
+                printf("\nErro ao buscar livros\n");
+}
+
+/*
+ * opcao_filtrar_livros - interage com o usuário para filtrar livros por título, autor ou editora, sem índice
+ *
+ * @biblioteca - base de dados aberta por biblioteca_abrir
+ *
+ * Pré-condições:
+ *              - Arquivo deve ser válido e possuir permissões de leitura.
+ *              - Arquivo deve estar inicializado (com cabeçalho).
+ * Pós-condições:
+ *              - Livros cujo campo escolhido contém, começa com ou é igual ao texto informado
+ *                (sem diferenciar maiúsculas e minúsculas) são exibidos em ordem de cadastro.
+ */
+void opcao_filtrar_livros(BIBLIOTECA* biblioteca) {
+        int campo, operacao;
+        char padrao[MAX_TITULO+1];
+
+        printf("\nCampo (1 - titulo, 2 - autor, 3 - editora): ");
+        while (!ler_inteiro_seguro(&campo) || campo < 1 || campo > 3) {
+                printf("Digite 1, 2 ou 3\n");
+                printf("Campo: ");
+        }
+
+        printf("\nOperacao (1 - contem, 2 - comeca com, 3 - igual a): ");
+        while (!ler_inteiro_seguro(&operacao) || operacao < 1 || operacao > 3) {
+                printf("Digite 1, 2 ou 3\n");
+                printf("Operacao: ");
+        }
+
+        printf("\nTexto: ");
+        fgets(padrao, MAX_TITULO+1, stdin);
+        padrao[strcspn(padrao, "\n")] = '\0';
+
+        int colunas[] = { COLUNA_TITULO, COLUNA_AUTOR, COLUNA_EDITORA };
+        int operacoes[] = { FILTRO_CONTEM, FILTRO_COMECA_COM, FILTRO_IGUAL };
+
+        printf("\n");
+        if (biblioteca_filtrar_livros(biblioteca, colunas[campo - 1], operacoes[operacao - 1], 1, padrao) != 0)
+                printf("\nErro ao filtrar livros\n");
+}
+
+/*
+ * opcao_medir_varredura - interage com o usuário para medir a vazão da varredura de textos
+ *
+ * @biblioteca - base de dados aberta por biblioteca_abrir
+ *
+ * Pré-condições:
+ *              - Arquivo deve ser válido e possuir permissões de leitura.
+ *              - Arquivo deve estar inicializado (com cabeçalho).
+ * Pós-condições:
+ *              - A vazão (GB/s) de cada nível da varredura (AVX2, SSE2, escalar) é exibida.
+ */
+void opcao_medir_varredura(BIBLIOTECA* biblioteca) {
+        char padrao[MAX_TITULO+1];
+
+        printf("\nTexto a procurar nos titulos: ");
+        fgets(padrao, MAX_TITULO+1, stdin);
+        padrao[strcspn(padrao, "\n")] = '\0';
+
+        printf("\n");
+        if (biblioteca_medir_varredura_livros(biblioteca, padrao) != 0)
+                printf("\nErro ao medir a varredura\n");
+}
+
+/*
+ * opcao_listar_emprestimos_periodo - interage com o usuário para listar os empréstimos feitos ou devolvidos num período
+ *
+ * @biblioteca - base de dados aberta por biblioteca_abrir
+ *
+ * Pré-condições:
+ *              - Arquivo deve ser válido e possuir permissões de leitura.
+ *              - Arquivo deve estar inicializado (com cabeçalho).
+ * Pós-condições:
+ *              - Os empréstimos cuja data de empréstimo (ou de devolução) está entre as datas
+ *                informadas, inclusive, são exibidos em ordem de data.
+ */
+void opcao_listar_emprestimos_periodo(BIBLIOTECA* biblioteca) {
+        int periodo, data_inicial, data_final;
+        char data[MAX_TITULO+1];
+
+        printf("\nListar emprestimos (1 - feitos no periodo, 2 - devolvidos no periodo): ");
+        while (!ler_inteiro_seguro(&periodo) || periodo < 1 || periodo > 2) {
+                printf("Digite 1 ou 2\n");
+                printf("Opcao: ");
+        }
+
+        printf("\nData inicial (DD/MM/AAAA): ");
+        while (fgets(data, MAX_TITULO+1, stdin) != NULL) {
+                data[strcspn(data, "\n")] = '\0';
+                trim(data);
+                if (converter_data(data, &data_inicial) == SUCESSO)
+                        break;
+                printf("Data invalida\n");
+                printf("Data inicial (DD/MM/AAAA): ");
+        }
+
+        printf("\nData final (DD/MM/AAAA): ");
+        while (fgets(data, MAX_TITULO+1, stdin) != NULL) {
+                data[strcspn(data, "\n")] = '\0';
+                trim(data);
+                if (converter_data(data, &data_final) == SUCESSO && data_final >= data_inicial)
+                        break;
+                printf("Data invalida (deve ser igual ou posterior a data inicial)\n");
+                printf("Data final (DD/MM/AAAA): ");
+        }
+        if (feof(stdin))
+                return;
+
+        printf("\n");
+        if (biblioteca_listar_emprestimos_periodo(biblioteca, periodo == 1 ? PERIODO_EMPRESTIMO : PERIODO_DEVOLUCAO, data_inicial, data_final) != 0)
+                printf("\nErro ao listar emprestimos\n");
+}
+
+/*
+ * opcao_listar_emprestimos_usuario - interage com o usuário para listar os empréstimos de um usuário
+ *
+ * @biblioteca - base de dados aberta por biblioteca_abrir
+ *
+ * Pré-condições:
+ *              - Arquivos devem ser válidos e possuir permissões de leitura.
+ *              - Arquivos devem estar inicializados (com cabeçalho).
+ * Pós-condições:
+ *              - Os empréstimos abertos e devolvidos do usuário informado são exibidos, do último
+ *                registrado para o primeiro.
+ */
+void opcao_listar_emprestimos_usuario(BIBLIOTECA* biblioteca) {
+        unsigned int codigo_usuario;
+
+        printf("\nDigite o codigo do usuario: ");
+        while ((codigo_usuario = ler_unsigned_int_direto()) == 0) {
+                printf("Codigo invalido (deve ser um numero maior que zero)\n");
+                printf("Digite o codigo do usuario: ");
+        }
+
+        printf("\n");
+        int retorno = biblioteca_listar_emprestimos_usuario(biblioteca, codigo_usuario);
+        if (retorno == ERRO_ENCONTRAR_USUARIO)
+                printf("Usuario nao encontrado\n");
+        else if (retorno != 0)
+                printf("\nErro ao listar emprestimos\n");
+}
+
+/*
+ * opcao_listar_emprestimos_livro - interage com o usuário para consultar a circulação de um livro
+ *
+ * @biblioteca - base de dados aberta por biblioteca_abrir
+ *
+ * Pré-condições:
+ *              - Arquivos devem ser válidos e possuir permissões de leitura.
+ *              - Arquivos devem estar inicializados (com cabeçalho).
+ * Pós-condições:
+ *              - São exibidos os empréstimos em aberto do livro informado e, depois, os devolvidos.
+ */
+void opcao_listar_emprestimos_livro(BIBLIOTECA* biblioteca) {
+        unsigned int codigo_livro;
+
+        printf("\nDigite o codigo do livro: ");
+        while ((codigo_livro = ler_unsigned_int_direto()) == 0) {
+                printf("Codigo invalido (deve ser um numero maior que zero)\n");
+                printf("Digite o codigo do livro: ");
+        }
+
+        printf("\n");
+        int retorno = biblioteca_listar_emprestimos_livro(biblioteca, codigo_livro);
+        if (retorno == ERRO_ENCONTRAR_LIVRO)
+                printf("Livro nao encontrado\n");
+        else if (retorno != 0)
+                printf("\nErro ao listar emprestimos\n");
+}
+
+/*
+ * opcao_iniciar_transacao - inicia uma transação com as próximas operações
+ *
+ * @biblioteca - base de dados aberta por biblioteca_abrir
+ *
+ * Pré-condições:
+ *              - Não deve haver transação em andamento.
+ * Pós-condições:
+ *              - Cadastros, empréstimos e devoluções seguintes são gravados juntos na confirmação (opção 22)
+ *              ou descartados juntos (opção 23).
+ */
+void opcao_iniciar_transacao(BIBLIOTECA* biblioteca) {
+        int retorno = biblioteca_iniciar_transacao(biblioteca);
+        if (retorno == ERRO_TRANSACAO)
+                printf("\nJa existe uma transacao em andamento ou a base esta sem diario\n");
+        else if (retorno != SUCESSO)
+                printf("\nErro ao iniciar a transacao\n");
+        else
+                printf("\nTransacao iniciada\n");
+}
+
+/*
+ * opcao_confirmar_transacao - grava no disco as operações da transação em andamento
+ *
+ * @biblioteca - base de dados aberta por biblioteca_abrir
+ *
+ * Pré-condições:
+ *              - Deve haver uma transação iniciada pela opção 21.
+ * Pós-condições:
+ *              - As operações da transação são gravadas de uma só vez.
+ */
+void opcao_confirmar_transacao(BIBLIOTECA* biblioteca) {
+        int retorno = biblioteca_confirmar_transacao(biblioteca);
+        if (retorno == ERRO_TRANSACAO)
+                printf("\nNenhuma transacao em andamento\n");
+        else if (retorno != SUCESSO)
+                printf("\nErro ao confirmar a transacao\n");
+        else
+                printf("\nTransacao confirmada\n");
+}
+
+/*
+ * opcao_desfazer_transacao - descarta as operações da transação em andamento
+ *
+ * @biblioteca - base de dados aberta por biblioteca_abrir
+ *
+ * Pré-condições:
+ *              - Deve haver uma transação iniciada pela opção 21.
+ * Pós-condições:
+ *              - A base volta ao estado do início da transação.
+ */
+void opcao_desfazer_transacao(BIBLIOTECA* biblioteca) {
+        int retorno = biblioteca_desfazer_transacao(biblioteca);
+        if (retorno == ERRO_TRANSACAO)
+                printf("\nNenhuma transacao em andamento\n");
+        else if (retorno != SUCESSO)
+                printf("\nTransacao desfeita, mas houve erro ao reconstruir os indices\n");
+        else
+                printf("\nTransacao desfeita\n");
+}
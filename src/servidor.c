@@ -0,0 +1,1204 @@
+// open_memstream, sigaction e os sockets só são declarados com _POSIX_C_SOURCE em -std=c11
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "../include/servidor.h"
+#include "../include/diario.h"
+#include "../include/emprestimo.h"
+#include "../include/erros.h"
+#include "../include/livro.h"
+#include "../include/lote.h"
+#include "../include/usuario.h"
+#include "../include/utils.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+
+// protocolo de uma conexão, definido pelos primeiros bytes recebidos
+#define PROTOCOLO_INDEFINIDO	0
+#define PROTOCOLO_TEXTO		1
+#define PROTOCOLO_BINARIO	2
+
+// operação interna dos pedidos grandes demais: a resposta é ERRO_CAMPOS_INVALIDOS
+#define PEDIDO_INVALIDO		-1
+
+/*
+ * CONEXAO_SERVIDOR - conexão aberta com um cliente
+ *
+ * @descritor - socket da conexão
+ * @protocolo - PROTOCOLO_* (definido pela thread chamadora antes do primeiro pedido)
+ * @entrada / @usados - bytes recebidos e ainda não transformados em pedidos (só a thread chamadora usa)
+ * @fim_leitura - o cliente fechou o seu lado da conexão (só a thread chamadora usa)
+ * @em_andamento - pedidos da conexão na fila ou em execução (com trava_fila)
+ * @encerrar - a conexão não recebe mais pedidos e é fechada quando em_andamento chega a 0 (com trava_fila)
+ * @falha_envio - um envio falhou e as respostas seguintes são descartadas (com trava_envio)
+ * @trava_envio - impede que duas threads misturem as suas respostas na conexão
+ */
+typedef struct {
+        int descritor;
+        int protocolo;
+        char entrada[TAM_BUFFER_CONEXAO];
+        size_t usados;
+        int fim_leitura;
+        int em_andamento;
+        int encerrar;
+        int falha_envio;
+        pthread_mutex_t trava_envio;
+} CONEXAO_SERVIDOR;
+
+/*
+ * PEDIDO_SERVIDOR - pedido recebido e ainda não respondido
+ *
+ * @proximo - pedido seguinte na fila
+ * @conexao - conexão que enviou o pedido
+ * @identificador - identificador do pedido binário (0 no protocolo de texto)
+ * @operacao - PEDIDO_* (PEDIDO_TEXTO no protocolo de texto) ou PEDIDO_INVALIDO
+ * @sequencia / @retorno / @resposta / @tamanho_resposta - gravação executada e à espera do fsync do diário
+ * @tamanho / @dados - dados do pedido, seguidos de um '\0'
+ */
+typedef struct PEDIDO_SERVIDOR {
+        struct PEDIDO_SERVIDOR* proximo;
+        CONEXAO_SERVIDOR* conexao;
+        unsigned int identificador;
+        int operacao;
+        unsigned long sequencia;
+        int retorno;
+        char* resposta;
+        size_t tamanho_resposta;
+        size_t tamanho;
+        char dados[];
+} PEDIDO_SERVIDOR;
+
+/*
+ * SERVIDOR - estado compartilhado entre a thread que acompanha as conexões e as que executam os pedidos
+ *
+ * @biblioteca - base usada por todas as conexões
+ * @trava_base - serializa as operações sobre a biblioteca, que não pode ser usada por duas threads ao mesmo tempo
+ * @confirmadas - gravações confirmadas (com trava_base)
+ * @duraveis - valor de confirmadas no último fsync do diário (com trava_base)
+ * @aguardando_disco - gravações executadas cujas respostas esperam o fsync do diário (com trava_base)
+ * @sincronizando - uma thread está fazendo o fsync e respondendo as gravações (com trava_base)
+ * @inicio_fila / @fim_fila - pedidos à espera de uma thread, do mais antigo ao mais novo
+ * @encerrar - pede que as threads terminem sem pegar novos pedidos
+ * @trava_fila / @mudou - protegem a fila, encerrar e os contadores das conexões e avisam qualquer mudança
+ * @avisos - pipe em que as threads avisam a thread chamadora de cada pedido respondido
+ */
+typedef struct {
+        BIBLIOTECA* biblioteca;
+        pthread_mutex_t trava_base;
+        unsigned long confirmadas;
+        unsigned long duraveis;
+        PEDIDO_SERVIDOR* aguardando_disco;
+        int sincronizando;
+        PEDIDO_SERVIDOR* inicio_fila;
+        PEDIDO_SERVIDOR* fim_fila;
+        int encerrar;
+        pthread_mutex_t trava_fila;
+        pthread_cond_t mudou;
+        int avisos[2];
+} SERVIDOR;
+
+/*
+ * tratador_pedido - executa um comando de texto sobre a biblioteca, com os campos que vieram depois dele
+ *
+ * Chamado com trava_base obtida; o texto exibido vai para biblioteca->saida.
+ */
+typedef int (*tratador_pedido)(BIBLIOTECA* biblioteca, char* campos);
+
+/*
+ * COMANDO_SERVIDOR - comando aceito pelo protocolo de texto
+ *
+ * @nome - primeira palavra do pedido
+ * @tratar - função que executa o comando
+ * @grava - 1 se o comando altera a base (a resposta espera o fsync do diário)
+ */
+typedef struct {
+        const char* nome;
+        tratador_pedido tratar;
+        int grava;
+} COMANDO_SERVIDOR;
+
+/*
+ * tratador_binario - executa uma operação do protocolo binário sobre a biblioteca
+ *
+ * @dados / @tamanho - dados do pedido (seguidos de um '\0', que não entra no tamanho)
+ *
+ * Chamado com trava_base obtida; os dados da resposta vão para biblioteca->saida.
+ */
+typedef int (*tratador_binario)(BIBLIOTECA* biblioteca, const char* dados, size_t tamanho);
+
+/*
+ * OPERACAO_BINARIA - operação aceita pelo protocolo binário, no índice do seu código PEDIDO_*
+ *
+ * @tratar - função que executa a operação
+ * @grava - 1 se a operação altera a base (a resposta espera o fsync do diário)
+ */
+typedef struct {
+        tratador_binario tratar;
+        int grava;
+} OPERACAO_BINARIA;
+
+// descritores do pipe usado pelo tratador de sinais para acordar a thread chamadora
+static int pipe_encerrar[2] = { -1, -1 };
+
+/*
+ * separar_campo - função interna que separa o primeiro campo de uma lista separada por ';'
+ *
+ * @campos - lista de campos (modificada: o ';' depois do primeiro campo vira '\0')
+ *
+ * Pós-condições:
+ *	- Retorna os campos seguintes (string vazia se não houver mais nenhum); o primeiro campo fica
+ *	em campos, sem espaços nas pontas.
+ */
+static char* separar_campo(char* campos) {
+        char* resto = strchr(campos, ';');
+        if(resto != NULL)
+                *resto++ = '\0';
+        else
+                resto = campos + strlen(campos);
+
+        trim(campos);
+        return resto;
+}
+
+/*
+ * ler_data_pedido - função interna que converte um campo de data (DD/MM/AAAA) de um pedido
+ *
+ * Pós-condições:
+ *	- Campo vazio usa a data atual. Retorna SUCESSO (0), ERRO_DATA_INVALIDA (-26) ou ERRO_OBTER_DATA (-25).
+ */
+static int ler_data_pedido(char* campo, int* data) {
+        trim(campo);
+        if(campo[0] == '\0')
+                return obter_data_atual(data) == SUCESSO ? SUCESSO : ERRO_OBTER_DATA;
+
+        return converter_data(campo, data) == SUCESSO ? SUCESSO : ERRO_DATA_INVALIDA;
+}
+
+/*
+ * ler_codigo_pedido - função interna que lê um código (inteiro maior que zero) de um campo
+ */
+static int ler_codigo_pedido(const char* campo, unsigned int* codigo) {
+        char resto;
+        if(sscanf(campo, "%u %c", codigo, &resto) != 1 || *codigo == 0)
+                return ERRO_CAMPOS_INVALIDOS;
+        return SUCESSO;
+}
+
+static int pedido_livro(BIBLIOTECA* biblioteca, char* campos) {
+        unsigned int codigo;
+        separar_campo(campos);
+        if(ler_codigo_pedido(campos, &codigo) != SUCESSO)
+                return ERRO_CAMPOS_INVALIDOS;
+        return biblioteca_imprimir_livro(biblioteca, (int)codigo);
+}
+
+static int pedido_livros(BIBLIOTECA* biblioteca, char* campos) {
+        (void)campos;
+        return biblioteca_listar_todos_livros(biblioteca);
+}
+
+static int pedido_titulo(BIBLIOTECA* biblioteca, char* campos) {
+        trim(campos);
+        return biblioteca_buscar_titulo_livro(biblioteca, campos);
+}
+
+static int pedido_prefixo(BIBLIOTECA* biblioteca, char* campos) {
+        trim(campos);
+        return biblioteca_buscar_prefixo_titulo_livro(biblioteca, campos);
+}
+
+static int pedido_faixa_titulos(BIBLIOTECA* biblioteca, char* campos) {
+        char* final = separar_campo(campos);
+        trim(final);
+        return biblioteca_listar_livros_intervalo_titulo(biblioteca, campos, final);
+}
+
+static int pedido_autor(BIBLIOTECA* biblioteca, char* campos) {
+        trim(campos);
+        return biblioteca_buscar_autor_livro(biblioteca, campos);
+}
+
+static int pedido_texto(BIBLIOTECA* biblioteca, char* campos) {
+        trim(campos);
+        return biblioteca_buscar_texto_livro(biblioteca, campos);
+}
+
+static int pedido_filtrar(BIBLIOTECA* biblioteca, char* campos) {
+        int coluna, operacao, ignorar_caixa;
+        int deslocamento = 0;
+        if(sscanf(campos, " %d ; %d ; %d ;%n", &coluna, &operacao, &ignorar_caixa, &deslocamento) != 3 || deslocamento == 0)
+                return ERRO_CAMPOS_INVALIDOS;
+        if(coluna < COLUNA_TITULO || coluna > COLUNA_EDITORA || operacao < FILTRO_CONTEM || operacao > FILTRO_IGUAL)
+                return ERRO_CAMPOS_INVALIDOS;
+
+        // o padrão é usado como veio, com os espaços
+        return biblioteca_filtrar_livros(biblioteca, coluna, operacao, ignorar_caixa != 0, campos + deslocamento);
+}
+
+static int pedido_total(BIBLIOTECA* biblioteca, char* campos) {
+        (void)campos;
+        return biblioteca_calcular_total_livros(biblioteca);
+}
+
+static int pedido_usuarios(BIBLIOTECA* biblioteca, char* campos) {
+        unsigned int inicial, final;
+        char* resto = separar_campo(campos);
+        separar_campo(resto);
+        if(sscanf(campos, "%u", &inicial) != 1 || sscanf(resto, "%u", &final) != 1 || inicial > final)
+                return ERRO_CAMPOS_INVALIDOS;
+        return biblioteca_listar_usuarios_intervalo(biblioteca, inicial, final);
+}
+
+static int pedido_emprestados(BIBLIOTECA* biblioteca, char* campos) {
+        (void)campos;
+        return biblioteca_listar_livros_emprestados(biblioteca);
+}
+
+static int pedido_periodo(BIBLIOTECA* biblioteca, char* campos) {
+        char* data_inicial = separar_campo(campos);
+        char* data_final = separar_campo(data_inicial);
+        separar_campo(data_final);
+
+        int periodo;
+        if(strcmp(campos, "E") == 0 || strcmp(campos, "e") == 0)
+                periodo = PERIODO_EMPRESTIMO;
+        else if(strcmp(campos, "D") == 0 || strcmp(campos, "d") == 0)
+                periodo = PERIODO_DEVOLUCAO;
+        else
+                return ERRO_CAMPOS_INVALIDOS;
+
+        int inicio, fim;
+        if(data_inicial[0] == '\0' || data_final[0] == '\0'
+                || converter_data(data_inicial, &inicio) != SUCESSO || converter_data(data_final, &fim) != SUCESSO)
+                return ERRO_DATA_INVALIDA;
+        return biblioteca_listar_emprestimos_periodo(biblioteca, periodo, inicio, fim);
+}
+
+static int pedido_emprestimos_usuario(BIBLIOTECA* biblioteca, char* campos) {
+        unsigned int codigo;
+        separar_campo(campos);
+        if(ler_codigo_pedido(campos, &codigo) != SUCESSO)
+                return ERRO_CAMPOS_INVALIDOS;
+        return biblioteca_listar_emprestimos_usuario(biblioteca, codigo);
+}
+
+static int pedido_circulacao(BIBLIOTECA* biblioteca, char* campos) {
+        unsigned int codigo;
+        separar_campo(campos);
+        if(ler_codigo_pedido(campos, &codigo) != SUCESSO)
+                return ERRO_CAMPOS_INVALIDOS;
+        return biblioteca_listar_emprestimos_livro(biblioteca, codigo);
+}
+
+/*
+ * interpretar_cadastro - função interna que interpreta os campos de um cadastro como uma linha do lote
+ *
+ * @tipo - 'L' ou 'U'
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) se a linha tem todos os campos do tipo, ou ERRO_CAMPOS_INVALIDOS (-24).
+ */
+static int interpretar_cadastro(char tipo, const char* campos, LINHA_LOTE* interpretada) {
+        char linha[TAM_LINHA_LOTE];
+        if(snprintf(linha, sizeof(linha), "%c;%s", tipo, campos) >= (int)sizeof(linha))
+                return ERRO_CAMPOS_INVALIDOS;
+
+        interpretar_linha_lote(linha, interpretada);
+        if(tipo == 'L')
+                return interpretada->tipo == LINHA_LIVRO && interpretada->lidos == 7 ? SUCESSO : ERRO_CAMPOS_INVALIDOS;
+        return interpretada->tipo == LINHA_USUARIO && interpretada->lidos == 2 ? SUCESSO : ERRO_CAMPOS_INVALIDOS;
+}
+
+static int pedido_cadastrar_livro(BIBLIOTECA* biblioteca, char* campos) {
+        LINHA_LOTE interpretada;
+        if(interpretar_cadastro('L', campos, &interpretada) != SUCESSO)
+                return ERRO_CAMPOS_INVALIDOS;
+        return biblioteca_cadastrar_livro(biblioteca, interpretada.registro.livro);
+}
+
+static int pedido_cadastrar_usuario(BIBLIOTECA* biblioteca, char* campos) {
+        LINHA_LOTE interpretada;
+        if(interpretar_cadastro('U', campos, &interpretada) != SUCESSO)
+                return ERRO_CAMPOS_INVALIDOS;
+        return biblioteca_cadastrar_usuario(biblioteca, interpretada.registro.usuario);
+}
+
+/*
+ * ler_emprestimo_pedido - função interna que lê usuário, livro e data (opcional) de um empréstimo ou devolução
+ */
+static int ler_emprestimo_pedido(char* campos, unsigned int* codigo_usuario, unsigned int* codigo_livro, int* data) {
+        char* livro = separar_campo(campos);
+        char* data_texto = separar_campo(livro);
+        separar_campo(data_texto);
+
+        if(ler_codigo_pedido(campos, codigo_usuario) != SUCESSO || ler_codigo_pedido(livro, codigo_livro) != SUCESSO)
+                return ERRO_CAMPOS_INVALIDOS;
+        return ler_data_pedido(data_texto, data);
+}
+
+static int pedido_emprestar(BIBLIOTECA* biblioteca, char* campos) {
+        unsigned int codigo_usuario, codigo_livro;
+        int data;
+        int retorno = ler_emprestimo_pedido(campos, &codigo_usuario, &codigo_livro, &data);
+        if(retorno != SUCESSO)
+                return retorno;
+        return biblioteca_emprestar_livro(biblioteca, codigo_usuario, codigo_livro, data);
+}
+
+static int pedido_devolver(BIBLIOTECA* biblioteca, char* campos) {
+        unsigned int codigo_usuario, codigo_livro;
+        int data;
+        int retorno = ler_emprestimo_pedido(campos, &codigo_usuario, &codigo_livro, &data);
+        if(retorno != SUCESSO)
+                return retorno;
+        return biblioteca_devolver_livro(biblioteca, codigo_usuario, codigo_livro, data);
+}
+
+static const COMANDO_SERVIDOR comandos_servidor[] = {
+        { "livro", pedido_livro, 0 },
+        { "livros", pedido_livros, 0 },
+        { "titulo", pedido_titulo, 0 },
+        { "prefixo", pedido_prefixo, 0 },
+        { "faixa_titulos", pedido_faixa_titulos, 0 },
+        { "autor", pedido_autor, 0 },
+        { "texto", pedido_texto, 0 },
+        { "filtrar", pedido_filtrar, 0 },
+        { "total", pedido_total, 0 },
+        { "usuarios", pedido_usuarios, 0 },
+        { "emprestados", pedido_emprestados, 0 },
+        { "periodo", pedido_periodo, 0 },
+        { "emprestimos_usuario", pedido_emprestimos_usuario, 0 },
+        { "circulacao", pedido_circulacao, 0 },
+        { "cadastrar_livro", pedido_cadastrar_livro, 1 },
+        { "cadastrar_usuario", pedido_cadastrar_usuario, 1 },
+        { "emprestar", pedido_emprestar, 1 },
+        { "devolver", pedido_devolver, 1 },
+};
+
+/*
+ * ler_inteiro_rede - função interna que lê um inteiro de 4 bytes em ordem de rede (big-endian)
+ */
+static unsigned int ler_inteiro_rede(const char* dados) {
+        const unsigned char* bytes = (const unsigned char*)dados;
+        return (unsigned int)bytes[0] << 24 | (unsigned int)bytes[1] << 16 | (unsigned int)bytes[2] << 8 | bytes[3];
+}
+
+/*
+ * escrever_inteiro_rede - função interna que escreve um inteiro de 4 bytes em ordem de rede (big-endian)
+ */
+static void escrever_inteiro_rede(char* destino, unsigned int valor) {
+        destino[0] = (char)(valor >> 24);
+        destino[1] = (char)(valor >> 16);
+        destino[2] = (char)(valor >> 8);
+        destino[3] = (char)valor;
+}
+
+/*
+ * gravar_inteiro_rede - função interna que acrescenta um inteiro de 4 bytes à resposta binária
+ */
+static void gravar_inteiro_rede(FILE* resposta, unsigned int valor) {
+        char bytes[4];
+        escrever_inteiro_rede(bytes, valor);
+        fwrite(bytes, 1, sizeof(bytes), resposta);
+}
+
+/*
+ * gravar_texto_rede - função interna que acrescenta um texto à resposta binária: o tamanho em 2 bytes e os caracteres
+ */
+static void gravar_texto_rede(FILE* resposta, const char* texto) {
+        size_t tamanho = strlen(texto);
+        fputc((int)(tamanho >> 8) & 0xFF, resposta);
+        fputc((int)tamanho & 0xFF, resposta);
+        fwrite(texto, 1, tamanho, resposta);
+}
+
+/*
+ * ler_codigo_binario - função interna que lê um código (maior que zero) de 4 bytes
+ */
+static int ler_codigo_binario(const char* dados, unsigned int* codigo) {
+        *codigo = ler_inteiro_rede(dados);
+        return *codigo == 0 || *codigo > INT_MAX ? ERRO_CAMPOS_INVALIDOS : SUCESSO;
+}
+
+static int binario_livro(BIBLIOTECA* biblioteca, const char* dados, size_t tamanho) {
+        unsigned int codigo;
+        if(tamanho != 4 || ler_codigo_binario(dados, &codigo) != SUCESSO)
+                return ERRO_CAMPOS_INVALIDOS;
+
+        LIVRO livro;
+        int retorno = biblioteca_consultar_livro(biblioteca, (int)codigo, &livro);
+        if(retorno != SUCESSO)
+                return retorno;
+
+        gravar_inteiro_rede(biblioteca->saida, (unsigned int)livro.codigo);
+        gravar_inteiro_rede(biblioteca->saida, (unsigned int)livro.edicao);
+        gravar_inteiro_rede(biblioteca->saida, (unsigned int)livro.ano);
+        gravar_inteiro_rede(biblioteca->saida, (unsigned int)livro.exemplares);
+        gravar_texto_rede(biblioteca->saida, livro.titulo);
+        gravar_texto_rede(biblioteca->saida, livro.autor);
+        gravar_texto_rede(biblioteca->saida, livro.editora);
+        return SUCESSO;
+}
+
+/*
+ * ler_emprestimo_binario - função interna que lê usuário, livro e data de um empréstimo ou devolução binário
+ */
+static int ler_emprestimo_binario(const char* dados, size_t tamanho, unsigned int* codigo_usuario, unsigned int* codigo_livro, int* data) {
+        if(tamanho != 12 || ler_codigo_binario(dados, codigo_usuario) != SUCESSO || ler_codigo_binario(dados + 4, codigo_livro) != SUCESSO)
+                return ERRO_CAMPOS_INVALIDOS;
+
+        *data = (int)ler_inteiro_rede(dados + 8);
+        if(*data == DATA_NULA)
+                return obter_data_atual(data) == SUCESSO ? SUCESSO : ERRO_OBTER_DATA;
+        return *data > 0 ? SUCESSO : ERRO_DATA_INVALIDA;
+}
+
+static int binario_emprestar(BIBLIOTECA* biblioteca, const char* dados, size_t tamanho) {
+        unsigned int codigo_usuario, codigo_livro;
+        int data;
+        int retorno = ler_emprestimo_binario(dados, tamanho, &codigo_usuario, &codigo_livro, &data);
+        if(retorno != SUCESSO)
+                return retorno;
+        return biblioteca_emprestar_livro(biblioteca, codigo_usuario, codigo_livro, data);
+}
+
+static int binario_devolver(BIBLIOTECA* biblioteca, const char* dados, size_t tamanho) {
+        unsigned int codigo_usuario, codigo_livro;
+        int data;
+        int retorno = ler_emprestimo_binario(dados, tamanho, &codigo_usuario, &codigo_livro, &data);
+        if(retorno != SUCESSO)
+                return retorno;
+        return biblioteca_devolver_livro(biblioteca, codigo_usuario, codigo_livro, data);
+}
+
+// um texto binário não pode ter '\0': o tratador o recebe como string
+static int binario_titulo(BIBLIOTECA* biblioteca, const char* dados, size_t tamanho) {
+        if(memchr(dados, '\0', tamanho) != NULL)
+                return ERRO_CAMPOS_INVALIDOS;
+        return biblioteca_buscar_titulo_livro(biblioteca, dados);
+}
+
+static int binario_prefixo(BIBLIOTECA* biblioteca, const char* dados, size_t tamanho) {
+        if(memchr(dados, '\0', tamanho) != NULL)
+                return ERRO_CAMPOS_INVALIDOS;
+        return biblioteca_buscar_prefixo_titulo_livro(biblioteca, dados);
+}
+
+static int binario_autor(BIBLIOTECA* biblioteca, const char* dados, size_t tamanho) {
+        if(memchr(dados, '\0', tamanho) != NULL)
+                return ERRO_CAMPOS_INVALIDOS;
+        return biblioteca_buscar_autor_livro(biblioteca, dados);
+}
+
+static int binario_texto(BIBLIOTECA* biblioteca, const char* dados, size_t tamanho) {
+        if(memchr(dados, '\0', tamanho) != NULL)
+                return ERRO_CAMPOS_INVALIDOS;
+        return biblioteca_buscar_texto_livro(biblioteca, dados);
+}
+
+// PEDIDO_TEXTO é executado pela tabela de comandos
+static const OPERACAO_BINARIA operacoes_binarias[NUM_PEDIDOS_BINARIOS] = {
+        [PEDIDO_LIVRO] = { binario_livro, 0 },
+        [PEDIDO_EMPRESTAR] = { binario_emprestar, 1 },
+        [PEDIDO_DEVOLVER] = { binario_devolver, 1 },
+        [PEDIDO_BUSCAR_TITULO] = { binario_titulo, 0 },
+        [PEDIDO_BUSCAR_PREFIXO] = { binario_prefixo, 0 },
+        [PEDIDO_BUSCAR_AUTOR] = { binario_autor, 0 },
+        [PEDIDO_BUSCAR_TEXTO] = { binario_texto, 0 },
+};
+
+/*
+ * buscar_comando - função interna que procura um comando de texto pelo nome
+ */
+static const COMANDO_SERVIDOR* buscar_comando(const char* nome) {
+        for(size_t i = 0; i < sizeof(comandos_servidor) / sizeof(comandos_servidor[0]); i++)
+                if(strcmp(nome, comandos_servidor[i].nome) == 0)
+                        return &comandos_servidor[i];
+        return NULL;
+}
+
+/*
+ * executar_pedido - função interna que executa um pedido e escreve em resposta os dados da resposta
+ *
+ * @sequencia - recebe o valor de confirmadas depois de uma gravação, ou 0 se o pedido não gravou
+ *
+ * Pós-condições:
+ *	- Retorna o valor da operação ou ERRO_CAMPOS_INVALIDOS (-24) para comando ou operação desconhecidos
+ *	ou campos incorretos.
+ */
+static int executar_pedido(SERVIDOR* servidor, PEDIDO_SERVIDOR* pedido, FILE* resposta, unsigned long* sequencia) {
+        const COMANDO_SERVIDOR* comando = NULL;
+        const OPERACAO_BINARIA* operacao = NULL;
+        char* campos = NULL;
+        *sequencia = 0;
+
+        if(pedido->operacao == PEDIDO_TEXTO) {
+                trim(pedido->dados);
+                campos = separar_campo(pedido->dados);
+                comando = buscar_comando(pedido->dados);
+                if(comando == NULL) {
+                        fprintf(resposta, "Comando desconhecido: \"%s\"\n", pedido->dados);
+                        return ERRO_CAMPOS_INVALIDOS;
+                }
+        } else if(pedido->operacao > PEDIDO_TEXTO && pedido->operacao < NUM_PEDIDOS_BINARIOS) {
+                operacao = &operacoes_binarias[pedido->operacao];
+        } else {
+                return ERRO_CAMPOS_INVALIDOS;
+        }
+
+        pthread_mutex_lock(&servidor->trava_base);
+        servidor->biblioteca->saida = resposta;
+        int retorno = comando != NULL ? comando->tratar(servidor->biblioteca, campos)
+                : operacao->tratar(servidor->biblioteca, pedido->dados, pedido->tamanho);
+        servidor->biblioteca->saida = stdout;
+        int grava = comando != NULL ? comando->grava : operacao->grava;
+        if(grava && retorno == SUCESSO)
+                *sequencia = ++servidor->confirmadas;
+        pthread_mutex_unlock(&servidor->trava_base);
+
+        return retorno;
+}
+
+/*
+ * enviar_tudo - função interna que envia um bloco inteiro pela conexão
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou ERRO_SOCKET (-35) se a conexão foi fechada ou o cliente não recebeu
+ *	os dados em ESPERA_ENVIO_SERVIDOR segundos.
+ */
+static int enviar_tudo(int conexao, const char* dados, size_t tamanho) {
+        while(tamanho > 0) {
+                ssize_t enviados = write(conexao, dados, tamanho);
+                if(enviados < 0 && errno == EINTR)
+                        continue;
+                if(enviados <= 0)
+                        return ERRO_SOCKET;
+                dados += enviados;
+                tamanho -= (size_t)enviados;
+        }
+        return SUCESSO;
+}
+
+/*
+ * responder - função interna que envia a resposta de um pedido: o cabeçalho do protocolo da conexão e os dados
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou ERRO_SOCKET (-35); depois de uma falha, as respostas seguintes da conexão não são enviadas.
+ */
+static int responder(PEDIDO_SERVIDOR* pedido, int retorno, const char* dados, size_t tamanho) {
+        CONEXAO_SERVIDOR* conexao = pedido->conexao;
+        char cabecalho[48];
+        size_t tamanho_cabecalho;
+
+        if(conexao->protocolo == PROTOCOLO_BINARIO) {
+                escrever_inteiro_rede(cabecalho, (unsigned int)tamanho);
+                escrever_inteiro_rede(cabecalho + 4, pedido->identificador);
+                escrever_inteiro_rede(cabecalho + 8, (unsigned int)retorno);
+                tamanho_cabecalho = TAM_CABECALHO_RESPOSTA;
+        } else {
+                tamanho_cabecalho = (size_t)snprintf(cabecalho, sizeof(cabecalho), "%d;%zu\n", retorno, tamanho);
+        }
+
+        pthread_mutex_lock(&conexao->trava_envio);
+        int resultado = conexao->falha_envio ? ERRO_SOCKET : enviar_tudo(conexao->descritor, cabecalho, tamanho_cabecalho);
+        if(resultado == SUCESSO && tamanho > 0)
+                resultado = enviar_tudo(conexao->descritor, dados, tamanho);
+        if(resultado != SUCESSO)
+                conexao->falha_envio = 1;
+        pthread_mutex_unlock(&conexao->trava_envio);
+
+        return resultado;
+}
+
+/*
+ * concluir_pedido - função interna (threads de atendimento) que envia a resposta de um pedido executado e o libera
+ *
+ * @dados / @tamanho - dados da resposta (liberados)
+ */
+static void concluir_pedido(SERVIDOR* servidor, PEDIDO_SERVIDOR* pedido, int retorno, char* dados, size_t tamanho) {
+        CONEXAO_SERVIDOR* conexao = pedido->conexao;
+        int resultado = responder(pedido, retorno, dados, tamanho);
+        free(dados);
+
+        // depois de em_andamento chegar a 0, a thread chamadora pode fechar e liberar a conexão
+        pthread_mutex_lock(&servidor->trava_fila);
+        conexao->em_andamento--;
+        if(resultado != SUCESSO)
+                conexao->encerrar = 1;
+        pthread_mutex_unlock(&servidor->trava_fila);
+
+        char aviso = 0;
+        ssize_t escritos = write(servidor->avisos[1], &aviso, 1);
+        (void)escritos;
+        free(pedido);
+}
+
+/*
+ * retirar_aguardando - função interna (com trava_base) que retira as gravações com sequência até limite
+ *
+ * Pós-condições:
+ *	- Retorna a lista das gravações retiradas.
+ */
+static PEDIDO_SERVIDOR* retirar_aguardando(SERVIDOR* servidor, unsigned long limite) {
+        PEDIDO_SERVIDOR* retirados = NULL;
+        PEDIDO_SERVIDOR** fim_retirados = &retirados;
+        PEDIDO_SERVIDOR** anterior = &servidor->aguardando_disco;
+
+        while(*anterior != NULL) {
+                PEDIDO_SERVIDOR* pedido = *anterior;
+                if(pedido->sequencia <= limite) {
+                        *anterior = pedido->proximo;
+                        pedido->proximo = NULL;
+                        *fim_retirados = pedido;
+                        fim_retirados = &pedido->proximo;
+                } else {
+                        anterior = &pedido->proximo;
+                }
+        }
+        return retirados;
+}
+
+/*
+ * sincronizar_gravacoes - função interna (com trava_base, que é liberada durante o fsync) que torna
+ * duráveis as gravações em aguardando_disco e envia as suas respostas
+ *
+ * Uma thread por vez: ela separa o grupo do diário com todas as gravações confirmadas até então e faz
+ * o fsync sem trava_base, enquanto as outras threads continuam executando e respondendo consultas e
+ * confirmando gravações, que entram em aguardando_disco e vão no fsync seguinte.
+ */
+static void sincronizar_gravacoes(SERVIDOR* servidor) {
+        servidor->sincronizando = 1;
+
+        for(;;) {
+                // gravações que já estavam no grupo de um fsync anterior
+                PEDIDO_SERVIDOR* prontos = retirar_aguardando(servidor, servidor->duraveis);
+                if(prontos == NULL && servidor->aguardando_disco == NULL)
+                        break;
+
+                int retorno = SUCESSO;
+                if(prontos == NULL) {
+                        GRUPO_DIARIO grupo;
+                        unsigned long alvo = servidor->confirmadas;
+                        retorno = diario_separar_grupo(&grupo);
+                        if(retorno == SUCESSO) {
+                                pthread_mutex_unlock(&servidor->trava_base);
+                                retorno = diario_gravar_grupo(&grupo);
+                                pthread_mutex_lock(&servidor->trava_base);
+                                if(retorno == SUCESSO)
+                                        retorno = diario_aplicar_grupo(&grupo);
+                        }
+                        if(retorno == SUCESSO)
+                                servidor->duraveis = alvo;
+                        prontos = retirar_aguardando(servidor, alvo);
+                }
+                pthread_mutex_unlock(&servidor->trava_base);
+
+                while(prontos != NULL) {
+                        PEDIDO_SERVIDOR* pedido = prontos;
+                        prontos = pedido->proximo;
+                        concluir_pedido(servidor, pedido, retorno == SUCESSO ? pedido->retorno : retorno,
+                                pedido->resposta, pedido->tamanho_resposta);
+                }
+
+                pthread_mutex_lock(&servidor->trava_base);
+        }
+
+        servidor->sincronizando = 0;
+}
+
+/*
+ * responder_pedido - função interna (threads de atendimento) que executa um pedido e envia a resposta
+ *
+ * A resposta de uma gravação só é enviada depois do fsync do diário: a gravação entra em
+ * aguardando_disco e a thread passa ao pedido seguinte, a menos que nenhuma outra esteja
+ * sincronizando o diário.
+ */
+static void responder_pedido(SERVIDOR* servidor, PEDIDO_SERVIDOR* pedido) {
+        char* dados = NULL;
+        size_t tamanho = 0;
+
+        FILE* resposta = open_memstream(&dados, &tamanho);
+        if(resposta == NULL) {
+                concluir_pedido(servidor, pedido, ERRO_ALOCAR_MEMORIA, NULL, 0);
+                return;
+        }
+
+        unsigned long sequencia;
+        int retorno = executar_pedido(servidor, pedido, resposta, &sequencia);
+        fclose(resposta);
+        if(sequencia == 0) {
+                concluir_pedido(servidor, pedido, retorno, dados, tamanho);
+                return;
+        }
+
+        pedido->sequencia = sequencia;
+        pedido->retorno = retorno;
+        pedido->resposta = dados;
+        pedido->tamanho_resposta = tamanho;
+
+        pthread_mutex_lock(&servidor->trava_base);
+        pedido->proximo = servidor->aguardando_disco;
+        servidor->aguardando_disco = pedido;
+        if(!servidor->sincronizando)
+                sincronizar_gravacoes(servidor);
+        pthread_mutex_unlock(&servidor->trava_base);
+}
+
+static void* atender_pedidos(void* argumento) {
+        SERVIDOR* servidor = argumento;
+
+        for(;;) {
+                pthread_mutex_lock(&servidor->trava_fila);
+                while(!servidor->encerrar && servidor->inicio_fila == NULL)
+                        pthread_cond_wait(&servidor->mudou, &servidor->trava_fila);
+                if(servidor->encerrar) {
+                        pthread_mutex_unlock(&servidor->trava_fila);
+                        break;
+                }
+                PEDIDO_SERVIDOR* pedido = servidor->inicio_fila;
+                servidor->inicio_fila = pedido->proximo;
+                if(servidor->inicio_fila == NULL)
+                        servidor->fim_fila = NULL;
+                pthread_mutex_unlock(&servidor->trava_fila);
+
+                responder_pedido(servidor, pedido);
+        }
+
+        return NULL;
+}
+
+/*
+ * enfileirar_pedido - função interna (thread chamadora, com trava_fila) que coloca um pedido na fila
+ *
+ * @dados / @tamanho - dados do pedido, copiados
+ *
+ * Pós-condições:
+ *	- Retorna SUCESSO (0) ou ERRO_ALOCAR_MEMORIA (-30).
+ */
+static int enfileirar_pedido(SERVIDOR* servidor, CONEXAO_SERVIDOR* conexao, unsigned int identificador, int operacao,
+        const char* dados, size_t tamanho) {
+        PEDIDO_SERVIDOR* pedido = malloc(sizeof(PEDIDO_SERVIDOR) + tamanho + 1);
+        if(pedido == NULL)
+                return ERRO_ALOCAR_MEMORIA;
+
+        pedido->proximo = NULL;
+        pedido->conexao = conexao;
+        pedido->identificador = identificador;
+        pedido->operacao = operacao;
+        pedido->tamanho = tamanho;
+        memcpy(pedido->dados, dados, tamanho);
+        pedido->dados[tamanho] = '\0';
+
+        if(servidor->fim_fila != NULL)
+                servidor->fim_fila->proximo = pedido;
+        else
+                servidor->inicio_fila = pedido;
+        servidor->fim_fila = pedido;
+        conexao->em_andamento++;
+        pthread_cond_signal(&servidor->mudou);
+        return SUCESSO;
+}
+
+/*
+ * extrair_pedido_texto - função interna que tira uma linha dos bytes recebidos (protocolo de texto)
+ *
+ * @inicio / @disponiveis - bytes recebidos e ainda não consumidos (a linha é modificada)
+ *
+ * Pós-condições:
+ *	- Retorna a quantidade de bytes consumidos, ou 0 se a linha ainda não chegou inteira.
+ */
+static size_t extrair_pedido_texto(SERVIDOR* servidor, CONEXAO_SERVIDOR* conexao, char* inicio, size_t disponiveis) {
+        char* fim = memchr(inicio, '\n', disponiveis);
+        if(fim == NULL || fim - inicio >= TAM_PEDIDO_SERVIDOR) {
+                if(disponiveis < TAM_PEDIDO_SERVIDOR)
+                        return 0;
+                // uma linha grande demais é respondida com erro e encerra a conexão
+                conexao->encerrar = 1;
+                enfileirar_pedido(servidor, conexao, 0, PEDIDO_INVALIDO, "", 0);
+                return 0;
+        }
+
+        *fim = '\0';
+        trim(inicio);
+        if(strcmp(inicio, "sair") == 0)
+                conexao->encerrar = 1;
+        else if(inicio[0] != '\0' && enfileirar_pedido(servidor, conexao, 0, PEDIDO_TEXTO, inicio, strlen(inicio)) != SUCESSO)
+                conexao->encerrar = 1;
+        return (size_t)(fim - inicio) + 1;
+}
+
+/*
+ * extrair_pedido_binario - função interna que tira um pedido dos bytes recebidos (protocolo binário)
+ *
+ * @inicio / @disponiveis - bytes recebidos e ainda não consumidos
+ *
+ * Pós-condições:
+ *	- Retorna a quantidade de bytes consumidos, ou 0 se o pedido ainda não chegou inteiro.
+ */
+static size_t extrair_pedido_binario(SERVIDOR* servidor, CONEXAO_SERVIDOR* conexao, const char* inicio, size_t disponiveis) {
+        if(disponiveis < TAM_CABECALHO_PEDIDO)
+                return 0;
+
+        unsigned int tamanho = ler_inteiro_rede(inicio);
+        unsigned int identificador = ler_inteiro_rede(inicio + 4);
+        int operacao = (unsigned char)inicio[8];
+        if(tamanho > TAM_PEDIDO_SERVIDOR) {
+                // sem ler os dados, o começo do pedido seguinte é desconhecido
+                conexao->encerrar = 1;
+                enfileirar_pedido(servidor, conexao, identificador, PEDIDO_INVALIDO, "", 0);
+                return 0;
+        }
+        if(disponiveis < TAM_CABECALHO_PEDIDO + tamanho)
+                return 0;
+
+        if(enfileirar_pedido(servidor, conexao, identificador, operacao, inicio + TAM_CABECALHO_PEDIDO, tamanho) != SUCESSO)
+                conexao->encerrar = 1;
+        return TAM_CABECALHO_PEDIDO + tamanho;
+}
+
+/*
+ * extrair_pedidos - função interna (thread chamadora) que coloca na fila os pedidos completos de uma conexão
+ *
+ * Uma conexão de texto tem no máximo um pedido na fila ou em execução, para responder na ordem;
+ * uma binária, até MAX_PEDIDOS_CONEXAO.
+ *
+ * Pós-condições:
+ *	- Retorna 1 se a conexão pode ser fechada: não recebe mais pedidos e todos foram respondidos.
+ */
+static int extrair_pedidos(SERVIDOR* servidor, CONEXAO_SERVIDOR* conexao) {
+        if(conexao->protocolo == PROTOCOLO_INDEFINIDO && conexao->usados > 0) {
+                if(conexao->entrada[0] != '\0') {
+                        conexao->protocolo = PROTOCOLO_TEXTO;
+                } else if(conexao->usados >= TAM_ASSINATURA_PROTOCOLO) {
+                        if(memcmp(conexao->entrada, ASSINATURA_PROTOCOLO_BINARIO, TAM_ASSINATURA_PROTOCOLO) != 0)
+                                return 1;
+                        conexao->protocolo = PROTOCOLO_BINARIO;
+                        conexao->usados -= TAM_ASSINATURA_PROTOCOLO;
+                        memmove(conexao->entrada, conexao->entrada + TAM_ASSINATURA_PROTOCOLO, conexao->usados);
+                }
+        }
+
+        size_t consumidos = 0;
+        pthread_mutex_lock(&servidor->trava_fila);
+        if(conexao->protocolo == PROTOCOLO_TEXTO) {
+                while(!conexao->encerrar && conexao->em_andamento == 0) {
+                        size_t linha = extrair_pedido_texto(servidor, conexao, conexao->entrada + consumidos, conexao->usados - consumidos);
+                        if(linha == 0)
+                                break;
+                        consumidos += linha;
+                }
+        } else if(conexao->protocolo == PROTOCOLO_BINARIO) {
+                while(!conexao->encerrar && conexao->em_andamento < MAX_PEDIDOS_CONEXAO) {
+                        size_t pedido = extrair_pedido_binario(servidor, conexao, conexao->entrada + consumidos, conexao->usados - consumidos);
+                        if(pedido == 0)
+                                break;
+                        consumidos += pedido;
+                }
+        }
+        int fechar = conexao->em_andamento == 0 && (conexao->encerrar || conexao->fim_leitura);
+        pthread_mutex_unlock(&servidor->trava_fila);
+
+        conexao->usados -= consumidos;
+        memmove(conexao->entrada, conexao->entrada + consumidos, conexao->usados);
+        return fechar;
+}
+
+static void pedir_encerramento(int sinal) {
+        (void)sinal;
+        char aviso = 0;
+        ssize_t escritos = write(pipe_encerrar[1], &aviso, 1);
+        (void)escritos;
+}
+
+/*
+ * calcular_threads_servidor - função interna que define quantas threads executam os pedidos
+ *
+ * Pós-condições:
+ *      - Retorna NUM_THREADS_SERVIDOR, se definido, ou o número de processadores mais um (a thread que
+ *      espera o fsync do diário não ocupa um processador), entre 1 e MAX_THREADS_SERVIDOR.
+ */
+static int calcular_threads_servidor(void) {
+        long threads = NUM_THREADS_SERVIDOR;
+        if(threads <= 0)
+                threads = sysconf(_SC_NPROCESSORS_ONLN) + 1;
+        if(threads < 1)
+                threads = 1;
+        if(threads > MAX_THREADS_SERVIDOR)
+                threads = MAX_THREADS_SERVIDOR;
+        return (int)threads;
+}
+
+/*
+ * abrir_socket - função interna que cria o socket do servidor no caminho informado
+ *
+ * Pós-condições:
+ *	- Retorna o descritor do socket, já escutando, ou -1 em caso de erro.
+ */
+static int abrir_socket(const char* caminho_socket) {
+        struct sockaddr_un endereco;
+        memset(&endereco, 0, sizeof(endereco));
+        endereco.sun_family = AF_UNIX;
+        if(strlen(caminho_socket) >= sizeof(endereco.sun_path))
+                return -1;
+        strcpy(endereco.sun_path, caminho_socket);
+
+        int escuta = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(escuta < 0)
+                return -1;
+
+        // um socket deixado por um servidor anterior impediria o bind
+        unlink(caminho_socket);
+        if(bind(escuta, (struct sockaddr*)&endereco, sizeof(endereco)) != 0 || listen(escuta, MAX_CONEXOES_SERVIDOR) != 0) {
+                close(escuta);
+                return -1;
+        }
+
+        return escuta;
+}
+
+/*
+ * abrir_pipe_avisos - função interna que cria o pipe de avisos, sem bloqueio nas duas pontas
+ *
+ * Uma thread nunca espera para avisar: com o pipe cheio, a thread chamadora já tem avisos para ler.
+ */
+static int abrir_pipe_avisos(int avisos[2]) {
+        if(pipe(avisos) != 0)
+                return ERRO_SOCKET;
+        if(fcntl(avisos[0], F_SETFL, O_NONBLOCK) != 0 || fcntl(avisos[1], F_SETFL, O_NONBLOCK) != 0) {
+                close(avisos[0]);
+                close(avisos[1]);
+                return ERRO_SOCKET;
+        }
+        return SUCESSO;
+}
+
+/*
+ * aceitar_conexao - função interna (thread chamadora) que aceita uma conexão e a acrescenta às acompanhadas
+ */
+static void aceitar_conexao(CONEXAO_SERVIDOR** conexoes, int* num_conexoes, int escuta) {
+        int descritor = accept(escuta, NULL, NULL);
+        if(descritor < 0)
+                return;
+
+        CONEXAO_SERVIDOR* conexao = calloc(1, sizeof(CONEXAO_SERVIDOR));
+        if(conexao == NULL) {
+                close(descritor);
+                return;
+        }
+
+        // um cliente que não lê as respostas não pode prender uma thread de atendimento
+        struct timeval espera = { .tv_sec = ESPERA_ENVIO_SERVIDOR };
+        setsockopt(descritor, SOL_SOCKET, SO_SNDTIMEO, &espera, sizeof(espera));
+
+        conexao->descritor = descritor;
+        conexao->protocolo = PROTOCOLO_INDEFINIDO;
+        pthread_mutex_init(&conexao->trava_envio, NULL);
+        conexoes[(*num_conexoes)++] = conexao;
+}
+
+/*
+ * fechar_conexao - função interna que fecha uma conexão sem pedidos em andamento e a libera
+ */
+static void fechar_conexao(CONEXAO_SERVIDOR* conexao) {
+        close(conexao->descritor);
+        pthread_mutex_destroy(&conexao->trava_envio);
+        free(conexao);
+}
+
+/*
+ * ler_conexao - função interna (thread chamadora) que lê os bytes disponíveis em uma conexão
+ */
+static void ler_conexao(CONEXAO_SERVIDOR* conexao) {
+        ssize_t lidos = read(conexao->descritor, conexao->entrada + conexao->usados, sizeof(conexao->entrada) - conexao->usados);
+        if(lidos > 0)
+                conexao->usados += (size_t)lidos;
+        else if(lidos == 0 || (errno != EINTR && errno != EAGAIN))
+                conexao->fim_leitura = 1;
+}
+
+/*
+ * acompanhar_conexoes - função interna (thread chamadora) que atende as conexões até um sinal de encerramento
+ *
+ * @conexoes / @num_conexoes - conexões abertas, que continuam abertas ao retornar
+ *
+ * Um único poll espera o sinal de encerramento, os avisos de pedidos respondidos, novas conexões
+ * (enquanto houver menos de MAX_CONEXOES_SERVIDOR) e os pedidos das conexões com espaço de leitura;
+ * uma conexão binária com MAX_PEDIDOS_CONEXAO pedidos em andamento deixa de ter os pedidos extraídos
+ * e, com a entrada cheia, de ser lida, até as respostas abrirem espaço.
+ */
+static void acompanhar_conexoes(SERVIDOR* servidor, int escuta, CONEXAO_SERVIDOR** conexoes, int* num_conexoes) {
+        struct pollfd eventos[MAX_CONEXOES_SERVIDOR + 3];
+        CONEXAO_SERVIDOR* lidas[MAX_CONEXOES_SERVIDOR];
+
+        for(;;) {
+                int num_eventos = 0;
+                eventos[num_eventos++] = (struct pollfd){ .fd = pipe_encerrar[0], .events = POLLIN };
+                eventos[num_eventos++] = (struct pollfd){ .fd = servidor->avisos[0], .events = POLLIN };
+                int aceitar = *num_conexoes < MAX_CONEXOES_SERVIDOR;
+                if(aceitar)
+                        eventos[num_eventos++] = (struct pollfd){ .fd = escuta, .events = POLLIN };
+
+                int primeira = num_eventos;
+                for(int i = 0; i < *num_conexoes; i++) {
+                        if(conexoes[i]->fim_leitura || conexoes[i]->usados == sizeof(conexoes[i]->entrada))
+                                continue;
+                        lidas[num_eventos - primeira] = conexoes[i];
+                        eventos[num_eventos++] = (struct pollfd){ .fd = conexoes[i]->descritor, .events = POLLIN };
+                }
+
+                if(poll(eventos, (nfds_t)num_eventos, -1) < 0) {
+                        if(errno == EINTR)
+                                continue;
+                        return;
+                }
+                if(eventos[0].revents & POLLIN)
+                        return;
+                if(eventos[1].revents & POLLIN) {
+                        char descartados[256];
+                        while(read(servidor->avisos[0], descartados, sizeof(descartados)) > 0)
+                                ;
+                }
+                if(aceitar && (eventos[2].revents & POLLIN))
+                        aceitar_conexao(conexoes, num_conexoes, escuta);
+                for(int i = primeira; i < num_eventos; i++)
+                        if(eventos[i].revents != 0)
+                                ler_conexao(lidas[i - primeira]);
+
+                // de trás para frente: a última conexão ocupa o lugar de uma fechada
+                for(int i = *num_conexoes - 1; i >= 0; i--) {
+                        if(extrair_pedidos(servidor, conexoes[i])) {
+                                fechar_conexao(conexoes[i]);
+                                conexoes[i] = conexoes[--(*num_conexoes)];
+                        }
+                }
+        }
+}
+
+/*
+ * encerrar_threads - função interna que encerra as conexões e espera as threads de atendimento
+ *
+ * Os pedidos ainda na fila são descartados sem resposta.
+ */
+static void encerrar_threads(SERVIDOR* servidor, pthread_t* threads, int criadas, CONEXAO_SERVIDOR** conexoes, int num_conexoes) {
+        pthread_mutex_lock(&servidor->trava_fila);
+        servidor->encerrar = 1;
+        pthread_cond_broadcast(&servidor->mudou);
+        pthread_mutex_unlock(&servidor->trava_fila);
+
+        // os envios bloqueados em clientes que não leem as respostas falham
+        for(int i = 0; i < num_conexoes; i++)
+                shutdown(conexoes[i]->descritor, SHUT_RDWR);
+        for(int i = 0; i < criadas; i++)
+                pthread_join(threads[i], NULL);
+
+        while(servidor->inicio_fila != NULL) {
+                PEDIDO_SERVIDOR* pedido = servidor->inicio_fila;
+                servidor->inicio_fila = pedido->proximo;
+                free(pedido);
+        }
+        servidor->fim_fila = NULL;
+        for(int i = 0; i < num_conexoes; i++)
+                fechar_conexao(conexoes[i]);
+}
+
+#endif // _WIN32
+
+int servidor_executar(BIBLIOTECA* biblioteca, const char* caminho_socket) {
+#ifdef _WIN32
+        (void)biblioteca;
+        (void)caminho_socket;
+        return ERRO_SOCKET;
+#else
+        int retorno = SUCESSO;
+        SERVIDOR servidor = { .biblioteca = biblioteca };
+        pthread_t threads[MAX_THREADS_SERVIDOR];
+        int criadas = 0;
+        CONEXAO_SERVIDOR* conexoes[MAX_CONEXOES_SERVIDOR];
+        int num_conexoes = 0;
+
+        int escuta = abrir_socket(caminho_socket);
+        if(escuta < 0)
+                return ERRO_SOCKET;
+        if(pipe(pipe_encerrar) != 0) {
+                retorno = ERRO_SOCKET;
+                goto fechar_socket;
+        }
+        if(abrir_pipe_avisos(servidor.avisos) != SUCESSO) {
+                retorno = ERRO_SOCKET;
+                goto fechar_pipe;
+        }
+
+        struct sigaction acao, anterior_int, anterior_term, anterior_pipe;
+        memset(&acao, 0, sizeof(acao));
+        sigemptyset(&acao.sa_mask);
+        acao.sa_handler = pedir_encerramento;
+        sigaction(SIGINT, &acao, &anterior_int);
+        sigaction(SIGTERM, &acao, &anterior_term);
+        // um cliente que fecha a conexão antes da resposta não pode encerrar o servidor
+        acao.sa_handler = SIG_IGN;
+        sigaction(SIGPIPE, &acao, &anterior_pipe);
+
+        pthread_mutex_init(&servidor.trava_base, NULL);
+        pthread_mutex_init(&servidor.trava_fila, NULL);
+        pthread_cond_init(&servidor.mudou, NULL);
+
+        // as threads de atendimento herdam os sinais bloqueados: só a thread chamadora os recebe
+        sigset_t sinais, mascara_anterior;
+        sigemptyset(&sinais);
+        sigaddset(&sinais, SIGINT);
+        sigaddset(&sinais, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &sinais, &mascara_anterior);
+
+        int num_threads = calcular_threads_servidor();
+        while(criadas < num_threads) {
+                if(pthread_create(&threads[criadas], NULL, atender_pedidos, &servidor) != 0)
+                        break;
+                criadas++;
+        }
+        pthread_sigmask(SIG_SETMASK, &mascara_anterior, NULL);
+
+        if(criadas == 0)
+                retorno = ERRO_ALOCAR_MEMORIA;
+        else
+                acompanhar_conexoes(&servidor, escuta, conexoes, &num_conexoes);
+
+        encerrar_threads(&servidor, threads, criadas, conexoes, num_conexoes);
+        pthread_cond_destroy(&servidor.mudou);
+        pthread_mutex_destroy(&servidor.trava_fila);
+        pthread_mutex_destroy(&servidor.trava_base);
+
+        sigaction(SIGINT, &anterior_int, NULL);
+        sigaction(SIGTERM, &anterior_term, NULL);
+        sigaction(SIGPIPE, &anterior_pipe, NULL);
+        close(servidor.avisos[0]);
+        close(servidor.avisos[1]);
+
+fechar_pipe:
+        close(pipe_encerrar[0]);
+        close(pipe_encerrar[1]);
+        pipe_encerrar[0] = pipe_encerrar[1] = -1;
+
+fechar_socket:
+        close(escuta);
+        unlink(caminho_socket);
+        return retorno;
+#endif // _WIN32
+}
@@ -0,0 +1,232 @@
+#include "../include/tabela_hash.h"
+#include "../include/erros.h"
+
+#include <stdlib.h>
+
+/*
+ * espalhar_chave - função interna que espalha os bits da chave (finalizador do splitmix64)
+ *
+ * @chave - chave a ser espalhada
+ *
+ * Pós-condições:
+ *      - Retorna um valor de 64 bits bem distribuído, evitando agrupamentos de códigos sequenciais.
+ */
+static unsigned long long espalhar_chave(unsigned long long chave) {
+        chave ^= chave >> 30;
+        chave *= 0xbf58476d1ce4e5b9ULL;
+        chave ^= chave >> 27;
+        chave *= 0x94d049bb133111ebULL;
+        chave ^= chave >> 31;
+        return chave;
+}
+
+/*
+ * alocar_posicoes - função interna que aloca os vetores de uma tabela com a capacidade informada
+ *
+ * @tabela - tabela cujos vetores serão alocados
+ * @capacidade - nova capacidade (potência de 2)
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) com todas as posições vazias.
+ *      - Retorna ERRO_ALOCAR_MEMORIA (-30) em caso de falha, sem alterar a tabela.
+ */
+static int alocar_posicoes(TABELA_HASH* tabela, int capacidade) {
+        unsigned long long* chaves = malloc((size_t)capacidade * sizeof(unsigned long long));
+        int* valores = malloc((size_t)capacidade * sizeof(int));
+        unsigned char* ocupados = calloc((size_t)capacidade, sizeof(unsigned char));
+        if(chaves == NULL || valores == NULL || ocupados == NULL) {
+                free(chaves);
+                free(valores);
+                free(ocupados);
+                return ERRO_ALOCAR_MEMORIA;
+        }
+
+        tabela->chaves = chaves;
+        tabela->valores = valores;
+        tabela->ocupados = ocupados;
+        tabela->capacidade = capacidade;
+        tabela->quantidade = 0;
+
+        return SUCESSO;
+}
+
+/*
+ * procurar_posicao - função interna que encontra a posição de uma chave ou a posição vazia onde ela entraria
+ *
+ * @tabela - tabela consultada
+ * @chave - chave procurada
+ *
+ * Pós-condições:
+ *      - Retorna o índice da posição que contém a chave ou, se ela não existir, da primeira posição vazia da sondagem.
+ */
+static int procurar_posicao(const TABELA_HASH* tabela, unsigned long long chave) {
+        int mascara = tabela->capacidade - 1;
+        int i = (int)(espalhar_chave(chave) & (unsigned long long)mascara);
+
+        while(tabela->ocupados[i] && tabela->chaves[i] != chave)
+                i = (i + 1) & mascara;
+
+        return i;
+}
+
+/*
+ * redimensionar - função interna que dobra a capacidade da tabela e reinsere as chaves
+ *
+ * @tabela - tabela a ser redimensionada
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) em caso de sucesso.
+ *      - Retorna ERRO_ALOCAR_MEMORIA (-30) em caso de falha, mantendo a tabela original intacta.
+ */
+static int redimensionar(TABELA_HASH* tabela) {
+        TABELA_HASH antiga = *tabela;
+        if(alocar_posicoes(tabela, antiga.capacidade * 2) != SUCESSO)
+                return ERRO_ALOCAR_MEMORIA;
+
+        for(int i = 0; i < antiga.capacidade; i++) {
+                if(!antiga.ocupados[i])
+                        continue;
+                int destino = procurar_posicao(tabela, antiga.chaves[i]);
+                tabela->chaves[destino] = antiga.chaves[i];
+                tabela->valores[destino] = antiga.valores[i];
+                tabela->ocupados[destino] = 1;
+        }
+        tabela->quantidade = antiga.quantidade;
+
+        free(antiga.chaves);
+        free(antiga.valores);
+        free(antiga.ocupados);
+
+        return SUCESSO;
+}
+
+/*
+ * tabela_hash_criar - aloca uma tabela hash vazia
+ *
+ * @capacidade_inicial - quantidade esperada de chaves (a tabela cresce se necessário)
+ *
+ * Pós-condições:
+ *      - Retorna um ponteiro para a tabela criada, que deve ser liberada com tabela_hash_destruir.
+ *      - Retorna NULL caso não haja memória disponível.
+ */
+TABELA_HASH* tabela_hash_criar(int capacidade_inicial) {
+        TABELA_HASH* tabela = malloc(sizeof(TABELA_HASH));
+        if(tabela == NULL)
+                return NULL;
+
+        // capacidade mínima com ocupação de até 50%
+        int capacidade = CAPACIDADE_TABELA_HASH_INICIAL;
+        while(capacidade / 2 < capacidade_inicial && capacidade < (1 << 30))
+                capacidade <<= 1;
+
+        if(alocar_posicoes(tabela, capacidade) != SUCESSO) {
+                free(tabela);
+                return NULL;
+        }
+
+        return tabela;
+}
+
+/*
+ * tabela_hash_destruir - libera a memória de uma tabela hash
+ *
+ * @tabela - tabela a ser liberada (pode ser NULL)
+ */
+void tabela_hash_destruir(TABELA_HASH* tabela) {
+        if(tabela == NULL)
+                return;
+        free(tabela->chaves);
+        free(tabela->valores);
+        free(tabela->ocupados);
+        free(tabela);
+}
+
+/*
+ * tabela_hash_inserir - insere (ou atualiza) uma chave na tabela
+ *
+ * @tabela - tabela criada por tabela_hash_criar
+ * @chave - chave a ser inserida
+ * @valor - valor associado à chave
+ *
+ * Pós-condições:
+ *      - Se a chave já existir, seu valor é substituído.
+ *      - Retorna SUCESSO (0) em caso de sucesso.
+ *      - Retorna ERRO_ALOCAR_MEMORIA (-30) se não for possível aumentar a tabela.
+ */
+int tabela_hash_inserir(TABELA_HASH* tabela, unsigned long long chave, int valor) {
+        if((tabela->quantidade + 1) * 2 > tabela->capacidade && redimensionar(tabela) != SUCESSO)
+                return ERRO_ALOCAR_MEMORIA;
+
+        int i = procurar_posicao(tabela, chave);
+        if(!tabela->ocupados[i]) {
+                tabela->ocupados[i] = 1;
+                tabela->chaves[i] = chave;
+                tabela->quantidade++;
+        }
+        tabela->valores[i] = valor;
+
+        return SUCESSO;
+}
+
+/*
+ * tabela_hash_buscar - busca o valor associado a uma chave
+ *
+ * @tabela - tabela criada por tabela_hash_criar
+ * @chave - chave procurada
+ * @valor - ponteiro onde o valor encontrado será armazenado (pode ser NULL)
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) se a chave foi encontrada.
+ *      - Retorna ERRO_ENCONTRAR_CHAVE (-29) caso contrário.
+ */
+int tabela_hash_buscar(const TABELA_HASH* tabela, unsigned long long chave, int* valor) {
+        int i = procurar_posicao(tabela, chave);
+        if(!tabela->ocupados[i])
+                return ERRO_ENCONTRAR_CHAVE;
+
+        if(valor != NULL)
+                *valor = tabela->valores[i];
+
+        return SUCESSO;
+}
+
+/*
+ * tabela_hash_remover - remove uma chave da tabela
+ *
+ * @tabela - tabela criada por tabela_hash_criar
+ * @chave - chave a ser removida
+ *
+ * Após esvaziar a posição, as chaves seguintes da mesma sequência de sondagem são
+ * deslocadas para trás quando a posição ideal delas não fica entre a vaga e a posição atual.
+ *
+ * Pós-condições:
+ *      - Retorna SUCESSO (0) se a chave foi removida.
+ *      - Retorna ERRO_ENCONTRAR_CHAVE (-29) se a chave não estava na tabela.
+ */
+int tabela_hash_remover(TABELA_HASH* tabela, unsigned long long chave) {
+        int mascara = tabela->capacidade - 1;
+        int vaga = procurar_posicao(tabela, chave);
+        if(!tabela->ocupados[vaga])
+                return ERRO_ENCONTRAR_CHAVE;
+
+        tabela->ocupados[vaga] = 0;
+        tabela->quantidade--;
+
+        for(int atual = (vaga + 1) & mascara; tabela->ocupados[atual]; atual = (atual + 1) & mascara) {
+                int ideal = (int)(espalhar_chave(tabela->chaves[atual]) & (unsigned long long)mascara);
+
+                // distância (circular) da posição ideal até a atual e até a vaga
+                int ate_atual = (atual - ideal) & mascara;
+                int ate_vaga = (vaga - ideal) & mascara;
+                if(ate_vaga > ate_atual)
+                        continue;
+
+                tabela->chaves[vaga] = tabela->chaves[atual];
+                tabela->valores[vaga] = tabela->valores[atual];
+                tabela->ocupados[vaga] = 1;
+                tabela->ocupados[atual] = 0;
+                vaga = atual;
+        }
+
+        return SUCESSO;
+}
@@ -0,0 +1,212 @@
+#include "../include/textos.h"
+#include "../include/erros.h"
+#include "../include/utils.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// tamanho do trecho lido de cada vez por textos_igual
+#define TAM_TRECHO_COMPARACAO 256
+
+/*
+ * tamanho_referencias - função interna que calcula quantos bytes as referências de uma posição ocupam
+ */
+static long tamanho_referencias(const AREA_TEXTOS* area) {
+        return (long)area->num_colunas * (long)sizeof(REFERENCIA_TEXTO);
+}
+
+int textos_abrir(AREA_TEXTOS* area, const char* caminho_lista, int num_colunas, const char* modo) {
+        char caminho_referencias[TAM_MAX_CAMINHO];
+        char caminho_textos[TAM_MAX_CAMINHO];
+        trocar_extensao(caminho_referencias, caminho_lista, EXTENSAO_REFERENCIAS_TEXTO);
+        trocar_extensao(caminho_textos, caminho_lista, EXTENSAO_TEXTOS);
+
+        area->num_colunas = num_colunas;
+        area->somente_anexar = modo[0] == 'a';
+        area->posicao_referencias = -1;
+        area->arquivo = NULL;
+
+        // as referências são gravadas por posição mesmo quando os textos são apenas acrescentados
+        area->referencias = fopen(caminho_referencias, area->somente_anexar ? "r+b" : modo);
+        if(area->referencias == NULL)
+                return ERRO_ABRIR_ARQUIVO;
+
+        area->arquivo = fopen(caminho_textos, modo);
+        if(area->arquivo == NULL) {
+                fclose(area->referencias);
+                area->referencias = NULL;
+                return ERRO_ABRIR_ARQUIVO;
+        }
+
+        if(fseek(area->arquivo, 0, SEEK_END) != 0 || (area->tamanho = ftell(area->arquivo)) < 0) {
+                textos_fechar(area);
+                return ERRO_ARQUIVO_SEEK;
+        }
+
+        return SUCESSO;
+}
+
+int textos_criar(const char* caminho_lista) {
+        char caminho[TAM_MAX_CAMINHO];
+        const char* extensoes[] = { EXTENSAO_REFERENCIAS_TEXTO, EXTENSAO_TEXTOS };
+
+        for(int i = 0; i < 2; i++) {
+                trocar_extensao(caminho, caminho_lista, extensoes[i]);
+                FILE* arquivo = fopen(caminho, "wb");
+                if(arquivo == NULL || fclose(arquivo) != 0)
+                        return ERRO_ABRIR_ARQUIVO;
+        }
+
+        return SUCESSO;
+}
+
+int textos_fechar(AREA_TEXTOS* area) {
+        if(area->arquivo == NULL)
+                return SUCESSO;
+
+        int retorno = SUCESSO;
+        if(fclose(area->referencias) != 0)
+                retorno = ERRO_ARQUIVO_WRITE;
+        if(fclose(area->arquivo) != 0)
+                retorno = ERRO_ARQUIVO_WRITE;
+        area->referencias = NULL;
+        area->arquivo = NULL;
+
+        return retorno;
+}
+
+int textos_descarregar(AREA_TEXTOS* area) {
+        if(area->arquivo == NULL)
+                return SUCESSO;
+        if(fflush(area->referencias) != 0 || fflush(area->arquivo) != 0)
+                return ERRO_ARQUIVO_WRITE;
+        return SUCESSO;
+}
+
+int textos_medir(AREA_TEXTOS* area) {
+        if(area->arquivo == NULL)
+                return SUCESSO;
+        if(textos_descarregar(area) != SUCESSO)
+                return ERRO_ARQUIVO_WRITE;
+
+        long tamanho;
+        if(fseek(area->arquivo, 0, SEEK_END) != 0 || (tamanho = ftell(area->arquivo)) < 0)
+                return ERRO_ARQUIVO_SEEK;
+        area->tamanho = tamanho;
+
+        return SUCESSO;
+}
+
+int textos_gravar(AREA_TEXTOS* area, const char* texto, REFERENCIA_TEXTO* referencia) {
+        size_t tamanho = strlen(texto);
+
+        referencia->deslocamento = 0;
+        referencia->tamanho = 0;
+        if(tamanho == 0)
+                return SUCESSO;
+
+        // em modo "a" toda gravação já vai para o fim; reposicionar esvaziaria o buffer a cada texto
+        if(!area->somente_anexar && fseek(area->arquivo, area->tamanho, SEEK_SET) != 0)
+                return ERRO_ARQUIVO_SEEK;
+        if(fwrite(texto, 1, tamanho, area->arquivo) != tamanho)
+                return ERRO_ARQUIVO_WRITE;
+
+        referencia->deslocamento = (unsigned int)area->tamanho;
+        referencia->tamanho = (unsigned int)tamanho;
+        area->tamanho += (long)tamanho;
+
+        return SUCESSO;
+}
+
+int textos_gravar_referencias(AREA_TEXTOS* area, int posicao, const REFERENCIA_TEXTO* referencias) {
+        long deslocamento = (long)posicao * tamanho_referencias(area);
+
+        // posições consecutivas (carga em lote) seguem gravando sem reposicionar, o que esvaziaria o buffer
+        if(area->posicao_referencias != deslocamento && fseek(area->referencias, deslocamento, SEEK_SET) != 0) {
+                area->posicao_referencias = -1;
+                return ERRO_ARQUIVO_SEEK;
+        }
+        if(fwrite(referencias, sizeof(REFERENCIA_TEXTO), (size_t)area->num_colunas, area->referencias) != (size_t)area->num_colunas) {
+                area->posicao_referencias = -1;
+                return ERRO_ARQUIVO_WRITE;
+        }
+
+        area->posicao_referencias = deslocamento + tamanho_referencias(area);
+        return SUCESSO;
+}
+
+int textos_ler_referencias(AREA_TEXTOS* area, int posicao, REFERENCIA_TEXTO* referencias) {
+        // a troca entre gravação e leitura exige um posicionamento
+        area->posicao_referencias = -1;
+        if(fseek(area->referencias, (long)posicao * tamanho_referencias(area), SEEK_SET) != 0)
+                return ERRO_ARQUIVO_SEEK;
+        if(fread(referencias, sizeof(REFERENCIA_TEXTO), (size_t)area->num_colunas, area->referencias) != (size_t)area->num_colunas)
+                return ERRO_ARQUIVO_READ;
+
+        return SUCESSO;
+}
+
+int textos_ler_referencias_intervalo(AREA_TEXTOS* area, int posicao, int quantidade, REFERENCIA_TEXTO* referencias) {
+        size_t total = (size_t)quantidade * (size_t)area->num_colunas;
+
+        area->posicao_referencias = -1;
+        if(fseek(area->referencias, (long)posicao * tamanho_referencias(area), SEEK_SET) != 0)
+                return ERRO_ARQUIVO_SEEK;
+        if(fread(referencias, sizeof(REFERENCIA_TEXTO), total, area->referencias) != total)
+                return ERRO_ARQUIVO_READ;
+
+        return SUCESSO;
+}
+
+int textos_ler(AREA_TEXTOS* area, REFERENCIA_TEXTO referencia, char* destino, size_t capacidade) {
+        size_t tamanho = referencia.tamanho;
+        if(tamanho > capacidade - 1)
+                tamanho = capacidade - 1;
+
+        destino[0] = '\0';
+        if(tamanho == 0)
+                return SUCESSO;
+
+        if(fseek(area->arquivo, (long)referencia.deslocamento, SEEK_SET) != 0)
+                return ERRO_ARQUIVO_SEEK;
+        if(fread(destino, 1, tamanho, area->arquivo) != tamanho)
+                return ERRO_ARQUIVO_READ;
+        destino[tamanho] = '\0';
+
+        return SUCESSO;
+}
+
+int textos_ler_trecho(AREA_TEXTOS* area, long deslocamento, size_t tamanho, char* destino) {
+        if(tamanho == 0)
+                return SUCESSO;
+        if(fseek(area->arquivo, deslocamento, SEEK_SET) != 0)
+                return ERRO_ARQUIVO_SEEK;
+        if(fread(destino, 1, tamanho, area->arquivo) != tamanho)
+                return ERRO_ARQUIVO_READ;
+
+        return SUCESSO;
+}
+
+int textos_igual(AREA_TEXTOS* area, REFERENCIA_TEXTO referencia, const char* texto) {
+        if(strlen(texto) != referencia.tamanho)
+                return 0;
+        if(referencia.tamanho == 0)
+                return 1;
+
+        if(fseek(area->arquivo, (long)referencia.deslocamento, SEEK_SET) != 0)
+                return ERRO_ARQUIVO_SEEK;
+
+        char trecho[TAM_TRECHO_COMPARACAO];
+        size_t restante = referencia.tamanho;
+        while(restante > 0) {
+                size_t quantidade = restante < sizeof(trecho) ? restante : sizeof(trecho);
+                if(fread(trecho, 1, quantidade, area->arquivo) != quantidade)
+                        return ERRO_ARQUIVO_READ;
+                if(memcmp(trecho, texto, quantidade) != 0)
+                        return 0;
+                texto += quantidade;
+                restante -= quantidade;
+        }
+
+        return 1;
+}
@@ -0,0 +1,48 @@
+// F_OFD_SETLK e F_OFD_SETLKW (Linux) só são declarados com _GNU_SOURCE
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "../include/trava.h"
+#include "../include/erros.h"
+
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#endif
+
+int travar_regiao(FILE* arquivo, tipo_trava tipo, long inicio, long tamanho, int esperar) {
+#ifdef _WIN32
+        (void)arquivo;
+        (void)tipo;
+        (void)inicio;
+        (void)tamanho;
+        (void)esperar;
+        return SUCESSO;
+#else
+        struct flock trava;
+        memset(&trava, 0, sizeof(struct flock));    // l_pid deve ser 0 nas travas F_OFD_*
+        trava.l_type = tipo == TRAVA_EXCLUSIVA ? F_WRLCK : (tipo == TRAVA_COMPARTILHADA ? F_RDLCK : F_UNLCK);
+        trava.l_whence = SEEK_SET;
+        trava.l_start = (off_t)inicio;
+        trava.l_len = (off_t)tamanho;
+
+#ifdef F_OFD_SETLK
+        int comando = esperar ? F_OFD_SETLKW : F_OFD_SETLK;
+#else
+        int comando = esperar ? F_SETLKW : F_SETLK;
+#endif
+        while(fcntl(fileno(arquivo), comando, &trava) != 0) {
+                if(errno == EINTR)
+                        continue;
+                if(!esperar && (errno == EACCES || errno == EAGAIN))
+                        return ERRO_TRAVA_OCUPADA;
+                return ERRO_TRAVAR_ARQUIVO;
+        }
+
+        return SUCESSO;
+#endif
+}
@@ -0,0 +1,88 @@
+#include "../include/trigramas.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Letras sem acento correspondentes aos caracteres U+00C0 a U+00FF, codificados em UTF-8 como
+ * 0xC3 seguido de 0x80 a 0xBF. Espaço indica um caractere que não é letra (ex.: "×", "÷").
+ */
+static const char LETRAS_LATIN1[64 + 1] =
+        "aaaaaaaceeeeiiii"      // À Á Â Ã Ä Å Æ Ç È É Ê Ë Ì Í Î Ï
+        "dnooooo ouuuuyts"      // Ð Ñ Ò Ó Ô Õ Ö × Ø Ù Ú Û Ü Ý Þ ß
+        "aaaaaaaceeeeiiii"      // à á â ã ä å æ ç è é ê ë ì í î ï
+        "dnooooo ouuuuyty";     // ð ñ ò ó ô õ ö ÷ ø ù ú û ü ý þ ÿ
+
+size_t normalizar_texto(const char* texto, char* destino, size_t capacidade) {
+        const unsigned char* origem = (const unsigned char*)texto;
+        size_t tamanho = 0;
+        int separar = 0;
+
+        while(*origem != '\0' && tamanho + 1 < capacidade) {
+                unsigned char c = *origem++;
+                char letra;
+
+                if(c >= 'A' && c <= 'Z')
+                        letra = (char)(c - 'A' + 'a');
+                else if((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))
+                        letra = (char)c;
+                else if(c == 0xC3 && *origem >= 0x80 && *origem <= 0xBF)
+                        letra = LETRAS_LATIN1[*origem++ - 0x80];
+                else if(c >= 0x80)
+                        letra = (char)c;        // demais caracteres UTF-8 são mantidos byte a byte
+                else
+                        letra = ' ';
+
+                if(letra == ' ') {
+                        separar = tamanho > 0;
+                        continue;
+                }
+
+                // separadores seguidos viram um único espaço, e nunca no início ou no fim
+                if(separar) {
+                        if(tamanho + 2 >= capacidade)
+                                break;
+                        destino[tamanho++] = ' ';
+                        separar = 0;
+                }
+                destino[tamanho++] = letra;
+        }
+
+        destino[tamanho] = '\0';
+        return tamanho;
+}
+
+int extrair_trigramas(const char* normalizado, unsigned char* trigramas, int quantidade, int capacidade) {
+        size_t tamanho = strlen(normalizado);
+        for(size_t i = 0; i + TAM_TRIGRAMA <= tamanho && quantidade < capacidade; i++) {
+                memcpy(trigramas + (size_t)quantidade * TAM_TRIGRAMA, normalizado + i, TAM_TRIGRAMA);
+                quantidade++;
+        }
+        return quantidade;
+}
+
+/*
+ * comparar_trigramas - função interna de comparação para qsort
+ */
+static int comparar_trigramas(const void* a, const void* b) {
+        return memcmp(a, b, TAM_TRIGRAMA);
+}
+
+int ordenar_trigramas(unsigned char* trigramas, int quantidade) {
+        if(quantidade == 0)
+                return 0;
+
+        qsort(trigramas, (size_t)quantidade, TAM_TRIGRAMA, comparar_trigramas);
+
+        int distintos = 1;
+        for(int i = 1; i < quantidade; i++) {
+                unsigned char* atual = trigramas + (size_t)i * TAM_TRIGRAMA;
+                unsigned char* ultimo = trigramas + (size_t)(distintos - 1) * TAM_TRIGRAMA;
+                if(memcmp(atual, ultimo, TAM_TRIGRAMA) != 0) {
+                        memmove(trigramas + (size_t)distintos * TAM_TRIGRAMA, atual, TAM_TRIGRAMA);
+                        distintos++;
+                }
+        }
+
+        return distintos;
+}
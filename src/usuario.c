@@ -1,6 +1,10 @@
 #include "../include/usuario.h"
 #include "../include/arquivo.h"
+#include "../include/armazenamento.h"
+#include "../include/biblioteca.h"
 #include "../include/erros.h"
+#include "../include/arvore_bmais.h"
+#include "../include/utils.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -26,10 +30,7 @@ static USUARIO* le_no_usuario(FILE* arquivo, int posicao) {
 	if(no_usuario == NULL)
 		return NULL;
 
-	if(
-		fseek(arquivo, sizeof(CABECALHO) + posicao * sizeof(USUARIO), SEEK_SET) != 0 ||
-		fread(no_usuario, sizeof(USUARIO), 1, arquivo) != 1
-	) {
+	if(ler_registro(arquivo, posicao, sizeof(USUARIO), no_usuario) != SUCESSO) {
 		free(no_usuario);
 		return NULL;
 	}
@@ -56,69 +57,216 @@ static USUARIO* le_no_usuario(FILE* arquivo, int posicao) {
  *	- Retorna ERRO_ARQUIVO_WRITE (-2) em caso de erro no fwrite.
  */
 static int escreve_no_usuario(FILE* arquivo, USUARIO* no_usuario, int posicao) {
-	if(fseek(arquivo,sizeof(CABECALHO) + posicao * sizeof(USUARIO), SEEK_SET) != 0)
-		return ERRO_ARQUIVO_SEEK;
-	if(fwrite(no_usuario, sizeof(USUARIO), 1, arquivo) == 0)
-		return ERRO_ARQUIVO_WRITE;
+	return escrever_registro(arquivo, posicao, sizeof(USUARIO), no_usuario);
+}
 
-	return SUCESSO;
+/*
+ * PAR_CODIGO_POSICAO - struct interna usada para ordenar os usuários antes de montar a árvore B+
+ */
+typedef struct {
+	unsigned int codigo;
+	int posicao;
+} PAR_CODIGO_POSICAO;
+
+/*
+ * comparar_pares - função interna de comparação para qsort (ordem crescente de código)
+ */
+static int comparar_pares(const void* a, const void* b) {
+	const PAR_CODIGO_POSICAO* x = a;
+	const PAR_CODIGO_POSICAO* y = b;
+	return (x->codigo > y->codigo) - (x->codigo < y->codigo);
 }
 
 /*
- * verificar_id_usuario - verifica se código do usuário já foi registrado
+ * construir_indice_usuario - monta a árvore B+ de usuários (usuario.idx) a partir de pares código/posição
  *
- * @caminho_arquivo_usuario - caminho completo para o arquivo binário que armazena usuários
+ * @nome_arquivo - caminho para o arquivo binário de usuários
+ * @codigos - códigos dos usuários, em qualquer ordem
+ * @posicoes - posição de cada usuário no arquivo de dados
+ * @quantidade - número de usuários
+ *
+ * Os pares são ordenados por código e a árvore é construída de baixo para cima,
+ * sem nenhuma leitura do arquivo de dados.
+ *
+ * Pós-condições:
+ *	- O arquivo de índice é recriado; em códigos repetidos apenas um deles é mantido.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna ERRO_ESCREVER_INDICE (-28) ou ERRO_ABRIR_ARQUIVO (-10) em caso de erro.
+ */
+int construir_indice_usuario(const char *nome_arquivo, const unsigned int *codigos, const int *posicoes, int quantidade) {
+	int retorno = SUCESSO;
+	int capacidade = quantidade > 0 ? quantidade : 1;
+	PAR_CODIGO_POSICAO* pares = malloc(capacidade * sizeof(PAR_CODIGO_POSICAO));
+	unsigned char* chaves = malloc(capacidade * sizeof(unsigned int));
+	int* valores = malloc(capacidade * sizeof(int));
+	if(pares == NULL || chaves == NULL || valores == NULL) {
+		retorno = ERRO_ESCREVER_INDICE;
+		goto liberar_vetores;
+	}
+
+	for(int i = 0; i < quantidade; i++) {
+		pares[i].codigo = codigos[i];
+		pares[i].posicao = posicoes[i];
+	}
+	qsort(pares, quantidade, sizeof(PAR_CODIGO_POSICAO), comparar_pares);
+
+	// a árvore não aceita chaves repetidas
+	int unicos = 0;
+	for(int i = 0; i < quantidade; i++) {
+		if(unicos > 0 && pares[i].codigo == pares[unicos - 1].codigo)
+			continue;
+		pares[unicos++] = pares[i];
+	}
+
+	for(int i = 0; i < unicos; i++) {
+		arvore_bmais_codificar_inteiro(pares[i].codigo, chaves + i * sizeof(unsigned int));
+		valores[i] = pares[i].posicao;
+	}
+
+	char caminho_indice[TAM_MAX_CAMINHO];
+	trocar_extensao(caminho_indice, nome_arquivo, ".idx");
+	retorno = arvore_bmais_construir(caminho_indice, sizeof(unsigned int), chaves, valores, unicos);
+
+liberar_vetores:
+	free(pares);
+	free(chaves);
+	free(valores);
+
+	return retorno;
+}
+
+/*
+ * reconstruir_indice_usuario - recria a árvore B+ de usuários (usuario.idx) a partir da lista
+ *
+ * @nome_arquivo - caminho para o arquivo binário de usuários
  *
  * Pré-condições:
- *	- Caminho para o arquivo deve ser válido e pode ser aberto para leitura.
- *	- Arquivo deve ser inicializado (conter cabeçalho).
+ *	- O arquivo deve existir e conter um cabeçalho válido.
  * Pós-condições:
- *	- Retorna SUCESSO se não for encontrado conflito.
- *	- Retorna valores negativos em caso de erro:
- *		- ERRO_CONFLITO_ID: foi identificado conflito.
- *		- ERRO_ABRIR_ARQUIVO: não foi possível abrir o arquivo.
- *		- ERRO_LER_CABECALHO: não foi possível ler o cabeçalho do arquivo.
- *		- ERRO_ARQUIVO_SEEK: erro no posicionamento do arquivo (fseek).
- *		- ERRO_ARQUIVO_READ: erro na leitura do arquivo (fread).
+ *	- A árvore é montada de baixo para cima com os códigos ordenados.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valor negativo em caso de erro.
  */
-static int verificar_id_usuario(const char* caminho_arquivo_usuario, unsigned int codigo_usuario) {
+int reconstruir_indice_usuario(const char *nome_arquivo) {
 	int retorno = SUCESSO;
-	FILE* arquivo = fopen(caminho_arquivo_usuario, "rb");
-	if (!arquivo) {
+	FILE* arquivo = abrir_arquivo_dados(nome_arquivo, "rb");
+	if(!arquivo) {
 		return ERRO_ABRIR_ARQUIVO;
 	}
 
 	CABECALHO* cabecalho = le_cabecalho(arquivo);
 	if(!cabecalho) {
-		retorno = ERRO_LER_CABECALHO;
-		goto liberar_arquivo;
+		fechar_arquivo_dados(arquivo);
+		return ERRO_LER_CABECALHO;
 	}
 
-	int pos = cabecalho->pos_cabeca;
-	USUARIO usuario;
+	// pos_topo é um limite superior para a quantidade de usuários ativos
+	int capacidade = cabecalho->pos_topo > 0 ? cabecalho->pos_topo : 1;
+	unsigned int* codigos = malloc(capacidade * sizeof(unsigned int));
+	int* posicoes = malloc(capacidade * sizeof(int));
+	if(codigos == NULL || posicoes == NULL) {
+		retorno = ERRO_ESCREVER_INDICE;
+		goto liberar_vetores;
+	}
 
-	while (pos != -1) {
-		if(fseek(arquivo, sizeof(CABECALHO) + pos * sizeof(USUARIO), SEEK_SET) != 0) {
-			retorno = ERRO_ARQUIVO_SEEK;
-			goto liberar_cabecalho;
+	int quantidade = 0;
+	int pos = cabecalho->pos_cabeca;
+	USUARIO copia;
+	while(pos != -1 && quantidade < capacidade) {
+		const USUARIO* usuario = acessar_registro(arquivo, pos, sizeof(USUARIO), &copia);
+		if(usuario == NULL) {
+			retorno = ERRO_LER_USUARIO;
+			goto liberar_vetores;
 		}
 
-		if(fread(&usuario, sizeof(USUARIO), 1, arquivo) != 1) {
-			retorno = ERRO_ARQUIVO_READ;
-			goto liberar_cabecalho;
-		}
+		codigos[quantidade] = usuario->codigo;
+		posicoes[quantidade] = pos;
+		quantidade++;
+
+		pos = usuario->proximo;
+	}
+
+	retorno = construir_indice_usuario(nome_arquivo, codigos, posicoes, quantidade);
+
+liberar_vetores:
+	free(codigos);
+	free(posicoes);
+	free(cabecalho);
+	fechar_arquivo_dados(arquivo);
+
+	return retorno;
+}
+
+/*
+ * localizar_usuario - busca um usuário pelo código utilizando a árvore B+ do arquivo (usuario.idx)
+ *
+ * @usuarios - arquivo de usuários da biblioteca, que mantém a árvore aberta (biblioteca_indice)
+ * @codigo - código do usuário procurado
+ * @usuario - ponteiro onde o registro encontrado será armazenado
+ * @posicao - ponteiro onde a posição do registro no arquivo será armazenada
+ *
+ * Pré-condições:
+ *	- O arquivo deve estar aberto e conter um cabeçalho válido.
+ * Pós-condições:
+ *	- Se o índice não existir ou estiver desatualizado, ele é reconstruído a partir da lista.
+ *	- Retorna SUCESSO (0) se o usuário foi encontrado.
+ *	- Retorna ERRO_ENCONTRAR_USUARIO (-16) se não existir usuário com o código informado.
+ *	- Retorna outro valor negativo em caso de falha de leitura.
+ */
+int localizar_usuario(ARQUIVO_BIBLIOTECA *usuarios, unsigned int codigo, USUARIO *usuario, int *posicao) {
+	unsigned char chave[sizeof(unsigned int)];
+	arvore_bmais_codificar_inteiro(codigo, chave);
+
+	// segunda tentativa só acontece após reconstruir um índice ausente ou desatualizado
+	for(int tentativa = 0; tentativa < 2; tentativa++) {
+		FILE *indice = biblioteca_indice(usuarios, ".idx");
+		int retorno = indice != NULL ? arvore_bmais_buscar_arquivo(indice, chave, posicao) : ERRO_ABRIR_ARQUIVO;
+		if(retorno == ERRO_ENCONTRAR_CHAVE)
+			return ERRO_ENCONTRAR_USUARIO;
 
-		if(usuario.codigo == codigo_usuario) {
-			retorno = ERRO_CONFLITO_ID;
-			goto liberar_cabecalho; // conflito encontrado
+		if(retorno == SUCESSO) {
+			if(ler_registro(usuarios->arquivo, *posicao, sizeof(USUARIO), usuario) != SUCESSO)
+				return ERRO_LER_USUARIO;
+			if(usuario->codigo == codigo)
+				return SUCESSO;
+		}
+		else if(retorno != ERRO_ABRIR_ARQUIVO && retorno != ERRO_LER_INDICE) {
+			return retorno;
 		}
 
-		pos = usuario.proximo;
+		if(tentativa == 0) {
+			biblioteca_fechar_indices(usuarios);
+			if((retorno = reconstruir_indice_usuario(usuarios->caminho)) != SUCESSO)
+				return retorno;
+		}
 	}
-liberar_cabecalho:
-	free(cabecalho);
-liberar_arquivo:
-	fclose(arquivo);
+
+	return ERRO_ENCONTRAR_USUARIO;
+}
+
+/*
+ * verificar_id_usuario - verifica se código do usuário já foi registrado
+ *
+ * @usuarios - arquivo de usuários aberto na biblioteca
+ * @codigo_usuario - código do usuário
+ *
+ * Pré-condições:
+ *	- Arquivo deve estar aberto e inicializado (conter cabeçalho).
+ * Pós-condições:
+ *	- Retorna SUCESSO se não for encontrado conflito.
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_CONFLITO_ID: foi identificado conflito.
+ *		- ERRO_LER_INDICE: não foi possível consultar a árvore B+.
+ *		- ERRO_LER_USUARIO: erro na leitura do arquivo.
+ */
+static int verificar_id_usuario(ARQUIVO_BIBLIOTECA* usuarios, unsigned int codigo_usuario) {
+	USUARIO usuario;
+	int pos;
+	int retorno = localizar_usuario(usuarios, codigo_usuario, &usuario, &pos);
+	if(retorno == SUCESSO)
+		retorno = ERRO_CONFLITO_ID; // conflito encontrado
+	else if(retorno == ERRO_ENCONTRAR_USUARIO)
+		retorno = SUCESSO;
 
 	return retorno;
 }
@@ -134,7 +282,8 @@ liberar_arquivo:
  *	- O arquivo deve conter um cabeçalho válido para gerenciar a lista encadeada de usuários.
  *
  * Pós-condições:
- *	- Um novo registro de usuário é inserido no arquivo, reutilizando posições livres se existirem.
+ *	- Um novo registro de usuário é inserido no arquivo, reutilizando posições livres se existirem,
+ *	ainda sem empréstimos (primeiro_emprestimo = -1).
  *	- O cabeçalho do arquivo é atualizado para refletir a nova cabeça da lista encadeada e possíveis posições livres.
  *	- Retorna SUCESSO (0) em caso de sucesso.
  *	- Retorna valores negativos em caso de erro:
@@ -146,60 +295,213 @@ liberar_arquivo:
  *		- ERRO_ESCREVER_CABECALHO (-12): falha ao escrever o cabeçalho atualizado no arquivo
  */
 int cadastrar_usuario(const char *nome_arquivo, USUARIO usuario) {
-	if(verificar_id_usuario(nome_arquivo, usuario.codigo) == ERRO_CONFLITO_ID)
+	BIBLIOTECA biblioteca;
+	int retorno = biblioteca_abrir_arquivos(&biblioteca, NULL, nome_arquivo, NULL);
+	if(retorno != SUCESSO)
+		return retorno;
+
+	retorno = biblioteca_cadastrar_usuario(&biblioteca, usuario);
+	biblioteca_fechar_arquivos(&biblioteca);
+
+	return retorno;
+}
+
+/*
+ * cadastrar_usuario_travado - função interna de biblioteca_cadastrar_usuario, com os arquivos já travados
+ */
+static int cadastrar_usuario_travado(BIBLIOTECA* biblioteca, USUARIO usuario) {
+	ARQUIVO_BIBLIOTECA* usuarios = &biblioteca->usuarios;
+	if(usuarios->arquivo == NULL)
+		return ERRO_ABRIR_ARQUIVO;
+
+	if(verificar_id_usuario(usuarios, usuario.codigo) == ERRO_CONFLITO_ID)
 		return ERRO_CONFLITO_ID;
 
 	int retorno = SUCESSO;
 	USUARIO* auxiliar = NULL;
 
-	FILE* arquivo = fopen(nome_arquivo, "r+b");
-	if(arquivo == NULL){
-		retorno = ERRO_ABRIR_ARQUIVO;
-		goto liberar_arquivo;
-	}
-	
-	CABECALHO* cabecalho = le_cabecalho(arquivo);
-	if(cabecalho == NULL){
-		retorno = ERRO_LER_CABECALHO;
-		goto liberar_cabecalho;
-	}
-	
-	usuario.proximo = cabecalho->pos_cabeca;
+	// o cabeçalho residente só é alterado quando a gravação termina
+	CABECALHO cabecalho = usuarios->cabecalho;
 
-	if(cabecalho->pos_livre == -1) {
-		if(escreve_no_usuario(arquivo, &usuario, cabecalho->pos_topo) != 0) {
+	usuario.proximo = cabecalho.pos_cabeca;
+	usuario.primeiro_emprestimo = -1;
+
+	// registro e cabeçalho formam uma operação do diário
+	biblioteca_iniciar_operacao(biblioteca);
+	if(cabecalho.pos_livre == -1) {
+		if(escreve_no_usuario(usuarios->arquivo, &usuario, cabecalho.pos_topo) != 0) {
 			retorno = ERRO_ESCREVER_USUARIO;
-			goto liberar_cabecalho;
+			goto desfazer_operacao;
 		}
-		cabecalho->pos_cabeca = cabecalho->pos_topo;
-		cabecalho->pos_topo++;
+		cabecalho.pos_cabeca = cabecalho.pos_topo;
+		cabecalho.pos_topo++;
 	}
 	else {
-		auxiliar = le_no_usuario(arquivo, cabecalho->pos_livre);
-		if(auxiliar == NULL){
+		auxiliar = le_no_usuario(usuarios->arquivo, cabecalho.pos_livre);
+		if(auxiliar == NULL) {
 			retorno = ERRO_LER_USUARIO;
-			goto liberar_cabecalho;
+			goto desfazer_operacao;
 		}
-		if(escreve_no_usuario(arquivo, &usuario, cabecalho->pos_livre) != 0) {
+		if(escreve_no_usuario(usuarios->arquivo, &usuario, cabecalho.pos_livre) != 0) {
 			retorno = ERRO_ESCREVER_USUARIO;
-			goto liberar_auxiliar;
+			goto desfazer_operacao;
 		}
-		cabecalho->pos_cabeca = cabecalho->pos_livre;
-		cabecalho->pos_livre = auxiliar->proximo;
-		free(auxiliar);
+		cabecalho.pos_cabeca = cabecalho.pos_livre;
+		cabecalho.pos_livre = auxiliar->proximo;
+		cabecalho.num_livres--;
 	}
+	cabecalho.num_ativos++;
 
-	if(escreve_cabecalho(arquivo, cabecalho) != 0) {
+	if(biblioteca_gravar_cabecalho(usuarios, &cabecalho) != 0) {
 		retorno = ERRO_ESCREVER_CABECALHO;
-		goto liberar_cabecalho;
+		goto desfazer_operacao;
 	}
 
+	if((retorno = biblioteca_confirmar_operacao(biblioteca)) != SUCESSO)
+		goto liberar_auxiliar;
+
+	// manter a árvore B+ atualizada (se não existir, é reconstruída já com o novo usuário)
+	unsigned char chave[sizeof(unsigned int)];
+	arvore_bmais_codificar_inteiro(usuario.codigo, chave);
+
+	FILE* indice = biblioteca_indice(usuarios, ".idx");
+	retorno = indice != NULL ? arvore_bmais_inserir_arquivo(indice, chave, cabecalho.pos_cabeca) : ERRO_ABRIR_ARQUIVO;
+	if(retorno == ERRO_ABRIR_ARQUIVO)
+		retorno = reconstruir_indice_usuario(usuarios->caminho);
+
+	// o usuário já está no diário: a falha só deixa a árvore desatualizada, e ela é refeita a partir da
+	// lista (ou removida, para a próxima consulta ou abertura da base a refazer)
+	if(retorno != SUCESSO) {
+		biblioteca_fechar_indices(usuarios);
+		if(reconstruir_indice_usuario(usuarios->caminho) != SUCESSO) {
+			char caminho_indice[TAM_MAX_CAMINHO];
+			trocar_extensao(caminho_indice, usuarios->caminho, ".idx");
+			remove(caminho_indice);
+		}
+		retorno = SUCESSO;
+	}
+	goto liberar_auxiliar;
+
+desfazer_operacao:
+	biblioteca_desfazer_operacao(biblioteca);
 liberar_auxiliar:
-	if(auxiliar != NULL) free(auxiliar);
-liberar_cabecalho:
-	free(cabecalho);
-liberar_arquivo:
-	fclose(arquivo);
+	free(auxiliar);
+
+	return retorno;
+}
+
+int biblioteca_cadastrar_usuario(BIBLIOTECA* biblioteca, USUARIO usuario) {
+	int retorno = biblioteca_travar_escrita(biblioteca, BIBLIOTECA_USUARIOS);
+	if(retorno != SUCESSO)
+		return retorno;
+
+	retorno = cadastrar_usuario_travado(biblioteca, usuario);
+	biblioteca_destravar(biblioteca);
+
+	return retorno;
+}
+
+/*
+ * CONTEXTO_LISTAGEM_USUARIO - struct interna repassada ao visitante da varredura da árvore
+ */
+typedef struct {
+	FILE* arquivo;
+	FILE* saida;
+	int encontrados;
+	int erro;
+} CONTEXTO_LISTAGEM_USUARIO;
+
+/*
+ * exibir_usuario_indexado - função interna chamada para cada chave da faixa de códigos
+ *
+ * @chave - código do usuário codificado em big-endian
+ * @posicao - posição do registro do usuário no arquivo
+ * @contexto - ponteiro para CONTEXTO_LISTAGEM_USUARIO
+ *
+ * Pós-condições:
+ *	- O usuário é lido do arquivo e exibido.
+ *	- Retorna 0 para continuar a varredura ou 1 em caso de erro de leitura.
+ */
+static int exibir_usuario_indexado(const unsigned char* chave, int posicao, void* contexto) {
+	CONTEXTO_LISTAGEM_USUARIO* listagem = contexto;
+	USUARIO copia;
+	(void)chave;
+
+	const USUARIO* usuario = acessar_registro(listagem->arquivo, posicao, sizeof(USUARIO), &copia);
+	if(usuario == NULL) {
+		listagem->erro = ERRO_LER_USUARIO;
+		return 1;
+	}
+
+	fprintf(listagem->saida, "Codigo: %u | Nome: %s\n", usuario->codigo, usuario->nome);
+	listagem->encontrados++;
+	return 0;
+}
+
+/*
+ * listar_usuarios_intervalo - lista, em ordem crescente de código, os usuários de uma faixa de códigos
+ *
+ * @nome_arquivo - caminho para o arquivo binário de usuários
+ * @codigo_inicial - menor código da faixa (inclusive)
+ * @codigo_final - maior código da faixa (inclusive)
+ *
+ * Pré-condições:
+ *	- O arquivo deve existir e conter um cabeçalho válido.
+ * Pós-condições:
+ *	- Código e nome de cada usuário da faixa são exibidos na tela.
+ *	- Caso nenhum usuário seja encontrado, uma mensagem informando isso é exibida.
+ *	- Retorna SUCESSO (0) em caso de sucesso.
+ *	- Retorna valores negativos em caso de erro:
+ *		- ERRO_ABRIR_ARQUIVO (-10): falha ao abrir o arquivo.
+ *		- ERRO_LER_INDICE (-27): falha ao percorrer a árvore B+.
+ *		- ERRO_LER_USUARIO (-13): falha ao ler o nó do usuário no arquivo.
+ */
+int listar_usuarios_intervalo(const char *nome_arquivo, unsigned int codigo_inicial, unsigned int codigo_final) {
+	BIBLIOTECA biblioteca;
+	int retorno = biblioteca_abrir_arquivos(&biblioteca, NULL, nome_arquivo, NULL);
+	if(retorno != SUCESSO)
+		return retorno;
+
+	retorno = biblioteca_listar_usuarios_intervalo(&biblioteca, codigo_inicial, codigo_final);
+	biblioteca_fechar_arquivos(&biblioteca);
+
+	return retorno;
+}
+
+/*
+ * listar_usuarios_intervalo_travado - função interna de biblioteca_listar_usuarios_intervalo, com os arquivos já travados
+ */
+static int listar_usuarios_intervalo_travado(BIBLIOTECA* biblioteca, unsigned int codigo_inicial, unsigned int codigo_final) {
+	ARQUIVO_BIBLIOTECA* usuarios = &biblioteca->usuarios;
+	if(usuarios->arquivo == NULL) {
+		return ERRO_ABRIR_ARQUIVO;
+	}
+
+	unsigned char chave_inicial[sizeof(unsigned int)], chave_final[sizeof(unsigned int)];
+	arvore_bmais_codificar_inteiro(codigo_inicial, chave_inicial);
+	arvore_bmais_codificar_inteiro(codigo_final, chave_final);
+
+	CONTEXTO_LISTAGEM_USUARIO listagem = { usuarios->arquivo, biblioteca->saida, 0, SUCESSO };
+	FILE* indice = biblioteca_indice(usuarios, ".idx");
+	if(indice == NULL && reconstruir_indice_usuario(usuarios->caminho) == SUCESSO)
+		indice = biblioteca_indice(usuarios, ".idx");
+	int retorno = indice != NULL ? arvore_bmais_percorrer_intervalo_arquivo(indice, chave_inicial, chave_final, exibir_usuario_indexado, &listagem) : ERRO_ABRIR_ARQUIVO;
+
+	if(retorno == SUCESSO)
+		retorno = listagem.erro;
+	if(retorno == SUCESSO && listagem.encontrados == 0)
+		fprintf(biblioteca->saida, "Nenhum usuario encontrado na faixa informada.\n");
+
+	return retorno;
+}
+
+int biblioteca_listar_usuarios_intervalo(BIBLIOTECA* biblioteca, unsigned int codigo_inicial, unsigned int codigo_final) {
+	int retorno = biblioteca_travar_leitura(biblioteca, BIBLIOTECA_USUARIOS);
+	if(retorno != SUCESSO)
+		return retorno;
+
+	retorno = listar_usuarios_intervalo_travado(biblioteca, codigo_inicial, codigo_final);
+	biblioteca_destravar(biblioteca);
 
 	return retorno;
 }
@@ -171,28 +171,133 @@ void trim(char *str) {
 }
 
 /*
- * obter_data_atual - obtém a data atual formatada como string
+ * trocar_extensao - monta o caminho de um arquivo auxiliar trocando a extensão do caminho original
  *
- * @buffer - buffer onde a data será escrita
- * @tamanho - tamanho máximo do buffer
+ * @destino - buffer onde o novo caminho será escrito (tamanho mínimo TAM_MAX_CAMINHO)
+ * @caminho - caminho original (ex.: "/dados/livro.dat")
+ * @extensao - nova extensão, incluindo o ponto (ex.: ".idx")
+ *
+ * Pre-condicoes:
+ *      - destino deve ter espaco para TAM_MAX_CAMINHO caracteres.
+ *      - caminho e extensao devem ser strings validas.
+ *
+ * Pos-condicoes:
+ *      - destino recebe o caminho original com a extensao trocada (ex.: "/dados/livro.idx").
+ *      - Caso o nome do arquivo nao tenha extensao, a nova extensao e apenas concatenada.
+ */
+void trocar_extensao(char* destino, const char* caminho, const char* extensao) {
+        strncpy(destino, caminho, TAM_MAX_CAMINHO - 1);
+        destino[TAM_MAX_CAMINHO - 1] = '\0';
+
+        // o ponto só conta como extensão se estiver depois do último separador
+        char* ponto = strrchr(destino, '.');
+        char* separador = strrchr(destino, SEPARADOR_DIRETORIO[0]);
+#ifdef _WIN32
+        char* barra = strrchr(destino, '/');
+        if(barra > separador)
+                separador = barra;
+#endif
+        if(ponto != NULL && (separador == NULL || ponto > separador))
+                *ponto = '\0';
+
+        strncat(destino, extensao, TAM_MAX_CAMINHO - strlen(destino) - 1);
+}
+
+/*
+ * substituir_arquivo - troca um arquivo pelo arquivo temporário que o reescreveu
+ *
+ * @origem - arquivo novo (ex.: "/dados/livro_conv.dat")
+ * @destino - arquivo a ser substituído (ex.: "/dados/livro.dat")
+ *
+ * Pos-condicoes:
+ *      - Retorna 0 em caso de sucesso ou valor diferente de 0 se a troca falhar.
+ */
+int substituir_arquivo(const char* origem, const char* destino) {
+        if(rename(origem, destino) == 0)
+                return 0;
+
+        // Windows não renomeia sobre um arquivo existente
+        remove(destino);
+        return rename(origem, destino);
+}
+
+/*
+ * dias_no_mes - função interna que retorna a quantidade de dias de um mês
+ */
+static int dias_no_mes(int mes, int ano) {
+        static const int dias[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+        int bissexto = (ano % 4 == 0 && ano % 100 != 0) || ano % 400 == 0;
+        return dias[mes - 1] + (mes == 2 && bissexto);
+}
+
+/*
+ * dias_da_data - função interna que converte dia, mês e ano (já validados) em número de dias
+ *
+ * Conta os anos a partir de março, para que o dia extra dos anos bissextos fique no fim do ano.
+ */
+static int dias_da_data(int dia, int mes, int ano) {
+        if(mes <= 2)
+                ano--;
+        int dia_do_ano = (153 * (mes > 2 ? mes - 3 : mes + 9) + 2) / 5 + dia - 1;
+        int dias_antes_do_ano = 365 * ano + ano / 4 - ano / 100 + ano / 400;
+        // 306: dias de 01/03/0000 até 01/01/0001, que é o dia 1
+        return dias_antes_do_ano + dia_do_ano - 306 + 1;
+}
+
+int converter_data(const char* texto, int* dias) {
+        int dia, mes, ano, inicio_ano = 0, lidos = 0;
+        if(sscanf(texto, "%2d/%2d/%n%4d%n", &dia, &mes, &inicio_ano, &ano, &lidos) != 3 || texto[lidos] != '\0' || lidos - inicio_ano != 4)
+                return ERRO_DATA_INVALIDA;
+        if(ano < 1 || mes < 1 || mes > 12 || dia < 1 || dia > dias_no_mes(mes, ano))
+                return ERRO_DATA_INVALIDA;
+
+        *dias = dias_da_data(dia, mes, ano);
+        return SUCESSO;
+}
+
+void formatar_data(int dias, char* buffer, size_t tamanho) {
+        if(dias == DATA_NULA) {
+                if(tamanho > 0)
+                        buffer[0] = '\0';
+                return;
+        }
+        if(dias < 0) {
+                snprintf(buffer, tamanho, "--/--/----");
+                return;
+        }
+
+        // inverso de dias_da_data, em ciclos de 400 anos (146097 dias) contados a partir de 01/03/0000
+        int dias_marco = dias - 1 + 306;
+        int ciclo = dias_marco / 146097;
+        int dia_ciclo = dias_marco % 146097;
+        int ano_ciclo = (dia_ciclo - dia_ciclo / 1460 + dia_ciclo / 36524 - dia_ciclo / 146096) / 365;
+        int dia_do_ano = dia_ciclo - (365 * ano_ciclo + ano_ciclo / 4 - ano_ciclo / 100);
+        int mes_marco = (5 * dia_do_ano + 2) / 153;
+        int dia = dia_do_ano - (153 * mes_marco + 2) / 5 + 1;
+        int mes = mes_marco < 10 ? mes_marco + 3 : mes_marco - 9;
+        int ano = ciclo * 400 + ano_ciclo + (mes <= 2);
+
+        snprintf(buffer, tamanho, "%02d/%02d/%04d", dia, mes, ano);
+}
+
+/*
+ * obter_data_atual - obtém a data atual (local) em número de dias
+ *
+ * @dias - ponteiro onde a data será armazenada
  *
  * Pré-condições:
- *      - 'buffer' deve ser um ponteiro v�lido com espa�o suficiente.
+ *      - 'dias' deve ser um ponteiro válido.
  * Pós-condições:
- *      - Em caso de sucesso, grava a data atual no formato DD/MM/AAAA no buffer.
  *      - Retorna SUCESSO (0) se a operação for bem-sucedida.
- *      - Retorna ERRO_OBTER_DATA (-12) se não for possível obter a data.
+ *      - Retorna ERRO_OBTER_DATA (-25) se não for possível obter a data.
  */
-int obter_data_atual(char *buffer, size_t tamanho) {
+int obter_data_atual(int *dias) {
         time_t t = time(NULL);
         struct tm *data_local = localtime(&t);
-
-        if (data_local) {
-                strftime(buffer, tamanho, "%d/%m/%Y", data_local);
-        } else {
-                buffer[0] = '\0'; // string vazia em caso de erro
+        if(data_local == NULL)
                 return ERRO_OBTER_DATA;
-        }
+
+        *dias = dias_da_data(data_local->tm_mday, data_local->tm_mon + 1, data_local->tm_year + 1900);
         return SUCESSO;
 }
 
@@ -0,0 +1,230 @@
+#include "../include/varredura.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#if !defined(VARREDURA_SOMENTE_ESCALAR) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+        #define VARREDURA_X86
+        #include <immintrin.h>
+#endif
+
+// -1 enquanto o processador não foi consultado; atômico porque as threads do servidor varrem ao mesmo tempo
+static _Atomic int nivel_atual = -1;
+
+/*
+ * dobrar_caixa - função interna que converte uma letra ASCII maiúscula em minúscula
+ */
+static unsigned char dobrar_caixa(unsigned char c) {
+        return (c >= 'A' && c <= 'Z') ? (unsigned char)(c | 0x20) : c;
+}
+
+/*
+ * iguais_escalar - função interna que compara dois blocos byte a byte
+ */
+static int iguais_escalar(const unsigned char* a, const unsigned char* b, size_t tamanho, int ignorar_caixa) {
+        if(!ignorar_caixa)
+                return memcmp(a, b, tamanho) == 0;
+
+        for(size_t i = 0; i < tamanho; i++) {
+                if(dobrar_caixa(a[i]) != dobrar_caixa(b[i]))
+                        return 0;
+        }
+        return 1;
+}
+
+/*
+ * procurar_escalar - função interna que procura um padrão (tamanho_padrao >= 1) posição a posição
+ */
+static size_t procurar_escalar(const unsigned char* texto, size_t tamanho, const unsigned char* padrao, size_t tamanho_padrao, int ignorar_caixa) {
+        unsigned char primeiro = ignorar_caixa ? dobrar_caixa(padrao[0]) : padrao[0];
+        for(size_t i = 0; i + tamanho_padrao <= tamanho; i++) {
+                unsigned char c = ignorar_caixa ? dobrar_caixa(texto[i]) : texto[i];
+                if(c == primeiro && iguais_escalar(texto + i + 1, padrao + 1, tamanho_padrao - 1, ignorar_caixa))
+                        return i;
+        }
+        return tamanho;
+}
+
+#ifdef VARREDURA_X86
+
+/*
+ * dobrar_caixa_sse2 / dobrar_caixa_avx2 - funções internas que convertem para minúsculas as
+ * letras ASCII de um vetor; com caixa zerada, o vetor não muda
+ *
+ * A comparação é com sinal: bytes a partir de 0x80 são negativos e nunca ficam entre 'A' e 'Z'.
+ */
+__attribute__((target("sse2")))
+static __m128i dobrar_caixa_sse2(__m128i v, __m128i caixa) {
+        __m128i maiuscula = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+        return _mm_or_si128(v, _mm_and_si128(maiuscula, caixa));
+}
+
+__attribute__((target("avx2")))
+static __m256i dobrar_caixa_avx2(__m256i v, __m256i caixa) {
+        __m256i maiuscula = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('A' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), v));
+        return _mm256_or_si256(v, _mm256_and_si256(maiuscula, caixa));
+}
+
+__attribute__((target("sse2")))
+static int iguais_sse2(const unsigned char* a, const unsigned char* b, size_t tamanho, int ignorar_caixa) {
+        const __m128i caixa = _mm_set1_epi8(ignorar_caixa ? 0x20 : 0);
+        size_t i = 0;
+        for(; i + 16 <= tamanho; i += 16) {
+                __m128i x = dobrar_caixa_sse2(_mm_loadu_si128((const __m128i*)(a + i)), caixa);
+                __m128i y = dobrar_caixa_sse2(_mm_loadu_si128((const __m128i*)(b + i)), caixa);
+                if(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF)
+                        return 0;
+        }
+        return iguais_escalar(a + i, b + i, tamanho - i, ignorar_caixa);
+}
+
+__attribute__((target("avx2")))
+static int iguais_avx2(const unsigned char* a, const unsigned char* b, size_t tamanho, int ignorar_caixa) {
+        const __m256i caixa = _mm256_set1_epi8(ignorar_caixa ? 0x20 : 0);
+        size_t i = 0;
+        for(; i + 32 <= tamanho; i += 32) {
+                __m256i x = dobrar_caixa_avx2(_mm256_loadu_si256((const __m256i*)(a + i)), caixa);
+                __m256i y = dobrar_caixa_avx2(_mm256_loadu_si256((const __m256i*)(b + i)), caixa);
+                if((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != 0xFFFFFFFFu)
+                        return 0;
+        }
+        return iguais_sse2(a + i, b + i, tamanho - i, ignorar_caixa);
+}
+
+/*
+ * procurar_sse2 / procurar_avx2 - funções internas que procuram um padrão (tamanho_padrao >= 1)
+ *
+ * Cada iteração carrega o bloco a partir de i e a partir de i + tamanho_padrao - 1 e marca as
+ * posições em que o primeiro e o último byte do padrão coincidem; só essas são conferidas.
+ * O final do texto, menor que um bloco, é tratado pela versão escalar.
+ */
+__attribute__((target("sse2")))
+static size_t procurar_sse2(const unsigned char* texto, size_t tamanho, const unsigned char* padrao, size_t tamanho_padrao, int ignorar_caixa) {
+        const __m128i caixa = _mm_set1_epi8(ignorar_caixa ? 0x20 : 0);
+        const unsigned char primeiro = ignorar_caixa ? dobrar_caixa(padrao[0]) : padrao[0];
+        const unsigned char ultimo = ignorar_caixa ? dobrar_caixa(padrao[tamanho_padrao - 1]) : padrao[tamanho_padrao - 1];
+        const __m128i vetor_primeiro = _mm_set1_epi8((char)primeiro);
+        const __m128i vetor_ultimo = _mm_set1_epi8((char)ultimo);
+
+        size_t i = 0;
+        for(; i + tamanho_padrao - 1 + 16 <= tamanho; i += 16) {
+                __m128i inicio = dobrar_caixa_sse2(_mm_loadu_si128((const __m128i*)(texto + i)), caixa);
+                __m128i fim = dobrar_caixa_sse2(_mm_loadu_si128((const __m128i*)(texto + i + tamanho_padrao - 1)), caixa);
+                unsigned int candidatos = (unsigned int)_mm_movemask_epi8(
+                        _mm_and_si128(_mm_cmpeq_epi8(inicio, vetor_primeiro), _mm_cmpeq_epi8(fim, vetor_ultimo)));
+
+                while(candidatos != 0) {
+                        size_t j = i + (size_t)__builtin_ctz(candidatos);
+                        if(tamanho_padrao <= 2 || iguais_escalar(texto + j + 1, padrao + 1, tamanho_padrao - 2, ignorar_caixa))
+                                return j;
+                        candidatos &= candidatos - 1;
+                }
+        }
+
+        return i + procurar_escalar(texto + i, tamanho - i, padrao, tamanho_padrao, ignorar_caixa);
+}
+
+__attribute__((target("avx2")))
+static size_t procurar_avx2(const unsigned char* texto, size_t tamanho, const unsigned char* padrao, size_t tamanho_padrao, int ignorar_caixa) {
+        const __m256i caixa = _mm256_set1_epi8(ignorar_caixa ? 0x20 : 0);
+        const unsigned char primeiro = ignorar_caixa ? dobrar_caixa(padrao[0]) : padrao[0];
+        const unsigned char ultimo = ignorar_caixa ? dobrar_caixa(padrao[tamanho_padrao - 1]) : padrao[tamanho_padrao - 1];
+        const __m256i vetor_primeiro = _mm256_set1_epi8((char)primeiro);
+        const __m256i vetor_ultimo = _mm256_set1_epi8((char)ultimo);
+
+        size_t i = 0;
+        for(; i + tamanho_padrao - 1 + 32 <= tamanho; i += 32) {
+                __m256i inicio = dobrar_caixa_avx2(_mm256_loadu_si256((const __m256i*)(texto + i)), caixa);
+                __m256i fim = dobrar_caixa_avx2(_mm256_loadu_si256((const __m256i*)(texto + i + tamanho_padrao - 1)), caixa);
+                unsigned int candidatos = (unsigned int)_mm256_movemask_epi8(
+                        _mm256_and_si256(_mm256_cmpeq_epi8(inicio, vetor_primeiro), _mm256_cmpeq_epi8(fim, vetor_ultimo)));
+
+                while(candidatos != 0) {
+                        size_t j = i + (size_t)__builtin_ctz(candidatos);
+                        if(tamanho_padrao <= 2 || iguais_escalar(texto + j + 1, padrao + 1, tamanho_padrao - 2, ignorar_caixa))
+                                return j;
+                        candidatos &= candidatos - 1;
+                }
+        }
+
+        return i + procurar_sse2(texto + i, tamanho - i, padrao, tamanho_padrao, ignorar_caixa);
+}
+
+#endif // VARREDURA_X86
+
+int varredura_nivel_maximo(void) {
+#ifdef VARREDURA_X86
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+                return NIVEL_VARREDURA_AVX2;
+        if(__builtin_cpu_supports("sse2"))
+                return NIVEL_VARREDURA_SSE2;
+#endif
+        return NIVEL_VARREDURA_ESCALAR;
+}
+
+int varredura_definir_nivel(int nivel) {
+        int maximo = varredura_nivel_maximo();
+        if(nivel > maximo)
+                nivel = maximo;
+        if(nivel < NIVEL_VARREDURA_ESCALAR)
+                nivel = NIVEL_VARREDURA_ESCALAR;
+        atomic_store_explicit(&nivel_atual, nivel, memory_order_relaxed);
+        return nivel;
+}
+
+#ifdef VARREDURA_X86
+
+/*
+ * nivel_em_uso - função interna que retorna o nível escolhido, consultando o processador na primeira chamada
+ */
+static int nivel_em_uso(void) {
+        int nivel = atomic_load_explicit(&nivel_atual, memory_order_relaxed);
+        if(nivel < 0)
+                nivel = varredura_definir_nivel(NIVEL_VARREDURA_AVX2);
+        return nivel;
+}
+
+#endif // VARREDURA_X86
+
+const char* varredura_nome_nivel(int nivel) {
+        switch(nivel) {
+                case NIVEL_VARREDURA_AVX2:
+                        return "AVX2";
+                case NIVEL_VARREDURA_SSE2:
+                        return "SSE2";
+                default:
+                        return "escalar";
+        }
+}
+
+size_t varredura_procurar(const char* texto, size_t tamanho, const char* padrao, size_t tamanho_padrao, int ignorar_caixa) {
+        if(tamanho_padrao == 0)
+                return 0;
+        if(tamanho_padrao > tamanho)
+                return tamanho;
+
+        const unsigned char* t = (const unsigned char*)texto;
+        const unsigned char* p = (const unsigned char*)padrao;
+#ifdef VARREDURA_X86
+        int nivel = nivel_em_uso();
+        if(nivel == NIVEL_VARREDURA_AVX2)
+                return procurar_avx2(t, tamanho, p, tamanho_padrao, ignorar_caixa);
+        if(nivel == NIVEL_VARREDURA_SSE2)
+                return procurar_sse2(t, tamanho, p, tamanho_padrao, ignorar_caixa);
+#endif
+        return procurar_escalar(t, tamanho, p, tamanho_padrao, ignorar_caixa);
+}
+
+int varredura_iguais(const char* a, const char* b, size_t tamanho, int ignorar_caixa) {
+        const unsigned char* x = (const unsigned char*)a;
+        const unsigned char* y = (const unsigned char*)b;
+#ifdef VARREDURA_X86
+        int nivel = nivel_em_uso();
+        if(nivel == NIVEL_VARREDURA_AVX2)
+                return iguais_avx2(x, y, tamanho, ignorar_caixa);
+        if(nivel == NIVEL_VARREDURA_SSE2)
+                return iguais_sse2(x, y, tamanho, ignorar_caixa);
+#endif
+        return iguais_escalar(x, y, tamanho, ignorar_caixa);
+}
@@ -0,0 +1,435 @@
+/*
+ * Teste do diário: confirmação em grupo, transações e recuperação depois de uma queda (POSIX)
+ *
+ * Um segundo processo (o próprio programa, executado de novo com o diretório e o modo) abre a
+ * base, confirma uma transação com dois livros, faz cadastros, empréstimos e devoluções que ficam
+ * no grupo atual do diário, deixa outra transação em andamento, faz o fsync do grupo e se mata com
+ * SIGKILL antes de aplicá-lo aos arquivos. Ao reabrir a base, a recuperação tem de reaplicar tudo o
+ * que foi confirmado (e nada da transação em andamento), com as listas encadeadas, os cabeçalhos e
+ * os índices coerentes. Em uma segunda base, o último registro do diário é cortado: a operação dele
+ * não pode aparecer. Uma terceira base repete a queda em modo compartilhado, em que cada operação é
+ * aplicada ao ser confirmada. Por fim, transações desfeitas e confirmadas são conferidas sem queda.
+ *
+ * Compilação, a partir da raiz do repositório:
+ *	gcc -pthread -Iinclude testes/teste_diario.c $(ls src/[a-z]*.c | grep -v main.c) -o teste_diario
+ *
+ * Pós-condições:
+ *	- Retorna 0 se todas as bases recuperadas estiverem corretas; 1 caso contrário, com a falha na saída de erro.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "../include/biblioteca.h"
+#include "../include/diario.h"
+#include "../include/emprestimo.h"
+#include "../include/erros.h"
+#include "../include/livro.h"
+#include "../include/usuario.h"
+#include "../include/utils.h"
+
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define LIVROS_TRANSACAO        2       // códigos 1 e 2, na transação confirmada
+#define PRIMEIRO_LIVRO_GRUPO    11
+#define LIVROS_GRUPO            10      // códigos 11 a 20, no grupo sem fsync até a queda
+#define USUARIOS                5       // o usuário i empresta o livro 10 + i
+#define DEVOLUCOES              2       // os usuários 1 e 2 devolvem
+#define LIVRO_ULTIMO            99      // última operação do grupo (cortada na segunda base)
+#define LIVRO_EM_ANDAMENTO      50      // transação em andamento na queda
+#define DATA_EMPRESTIMO         19000
+#define DATA_DEVOLUCAO          19010
+
+/*
+ * cadastrar - cadastra um livro de teste com o código informado
+ */
+static int cadastrar(BIBLIOTECA* biblioteca, int codigo) {
+        LIVRO livro;
+        memset(&livro, 0, sizeof(LIVRO));
+        livro.codigo = codigo;
+        snprintf(livro.titulo, sizeof(livro.titulo), "Livro %d", codigo);
+        strcpy(livro.autor, "Autor");
+        strcpy(livro.editora, "Editora");
+        livro.edicao = 1;
+        livro.ano = 2000;
+        livro.exemplares = 1;
+        return biblioteca_cadastrar_livro(biblioteca, livro);
+}
+
+/*
+ * executar_ate_cair - o segundo processo: grava na base e se mata antes de aplicar o grupo
+ */
+static int executar_ate_cair(char* diretorio, int compartilhada) {
+        BIBLIOTECA* biblioteca = compartilhada ? biblioteca_abrir(diretorio) : biblioteca_abrir_exclusiva(diretorio);
+        if(biblioteca == NULL)
+                return 1;
+
+        // transação confirmada: um fsync e a aplicação aos arquivos, sem esperar o grupo
+        if(biblioteca_iniciar_transacao(biblioteca) != SUCESSO)
+                return 1;
+        for(int codigo = 1; codigo <= LIVROS_TRANSACAO; codigo++)
+                if(cadastrar(biblioteca, codigo) != SUCESSO)
+                        return 1;
+        if(biblioteca_confirmar_transacao(biblioteca) != SUCESSO)
+                return 1;
+
+        // operações que ficam no grupo atual (em modo exclusivo, sem fsync nem aplicação)
+        for(int codigo = PRIMEIRO_LIVRO_GRUPO; codigo < PRIMEIRO_LIVRO_GRUPO + LIVROS_GRUPO; codigo++)
+                if(cadastrar(biblioteca, codigo) != SUCESSO)
+                        return 1;
+        for(unsigned int codigo = 1; codigo <= USUARIOS; codigo++) {
+                USUARIO usuario;
+                memset(&usuario, 0, sizeof(USUARIO));
+                usuario.codigo = codigo;
+                snprintf(usuario.nome, sizeof(usuario.nome), "Usuario %u", codigo);
+                if(biblioteca_cadastrar_usuario(biblioteca, usuario) != SUCESSO)
+                        return 1;
+        }
+        for(unsigned int codigo = 1; codigo <= USUARIOS; codigo++)
+                if(biblioteca_emprestar_livro(biblioteca, codigo, PRIMEIRO_LIVRO_GRUPO - 1 + codigo, DATA_EMPRESTIMO) != SUCESSO)
+                        return 1;
+        for(unsigned int codigo = 1; codigo <= DEVOLUCOES; codigo++)
+                if(biblioteca_devolver_livro(biblioteca, codigo, PRIMEIRO_LIVRO_GRUPO - 1 + codigo, DATA_DEVOLUCAO) != SUCESSO)
+                        return 1;
+        if(cadastrar(biblioteca, LIVRO_ULTIMO) != SUCESSO)
+                return 1;
+
+        // transação que nunca é confirmada: as suas gravações não chegam ao diário
+        if(biblioteca_iniciar_transacao(biblioteca) != SUCESSO || cadastrar(biblioteca, LIVRO_EM_ANDAMENTO) != SUCESSO)
+                return 1;
+
+        // fsync do grupo sem a aplicação: a queda fica entre os dois
+        GRUPO_DIARIO grupo;
+        if(diario_separar_grupo(&grupo) != SUCESSO || diario_gravar_grupo(&grupo) != SUCESSO)
+                return 1;
+        kill(getpid(), SIGKILL);
+        return 1;
+}
+
+/*
+ * executar_outro_processo - executa o programa em outro processo e retorna o sinal que o encerrou
+ *
+ * Pós-condições:
+ *	- Retorna o número do sinal, 0 se o processo terminou normalmente ou -1 se não pôde ser executado.
+ */
+static int executar_outro_processo(const char* programa, char* diretorio, int compartilhada) {
+        pid_t filho = fork();
+        if(filho < 0)
+                return -1;
+        if(filho == 0) {
+                execl(programa, programa, diretorio, compartilhada ? "compartilhada" : "exclusiva", (char*)NULL);
+                _exit(127);
+        }
+
+        int situacao;
+        if(waitpid(filho, &situacao, 0) != filho)
+                return -1;
+        return WIFSIGNALED(situacao) ? WTERMSIG(situacao) : 0;
+}
+
+/*
+ * conferir - exibe a falha e a conta quando a condição não vale
+ */
+static int conferir(int condicao, const char* descricao) {
+        if(!condicao)
+                fprintf(stderr, "FALHA: %s\n", descricao);
+        return condicao ? 0 : 1;
+}
+
+/*
+ * ler_cabecalho - lê o cabeçalho de um arquivo de lista direto do disco
+ */
+static int ler_cabecalho(const char* diretorio, const char* nome, CABECALHO* cabecalho) {
+        char caminho[TAM_MAX_CAMINHO];
+        snprintf(caminho, sizeof(caminho), "%s/%s", diretorio, nome);
+        FILE* arquivo = fopen(caminho, "rb");
+        if(arquivo == NULL)
+                return 0;
+        int lido = fread(cabecalho, sizeof(CABECALHO), 1, arquivo) == 1;
+        fclose(arquivo);
+        return lido;
+}
+
+/*
+ * tamanho_diario - tamanho de diario.log no diretório (-1 se não existir)
+ */
+static long tamanho_diario(const char* diretorio) {
+        char caminho[TAM_MAX_CAMINHO];
+        struct stat informacoes;
+        snprintf(caminho, sizeof(caminho), "%s/%s", diretorio, NOME_ARQUIVO_DIARIO);
+        return stat(caminho, &informacoes) == 0 ? (long)informacoes.st_size : -1;
+}
+
+/*
+ * LISTA_PERCORRIDA - resultado de percorrer uma lista encadeada de um arquivo fechado
+ *
+ * @quantidade - registros da lista (-1 se ela sai do arquivo ou tem um ciclo)
+ * @soma - soma do campo inteiro informado em percorrer_lista
+ * @abertos - registros de empréstimo sem data de devolução
+ */
+typedef struct {
+        int quantidade;
+        long soma;
+        int abertos;
+} LISTA_PERCORRIDA;
+
+/*
+ * percorrer_lista - segue uma lista encadeada a partir de uma posição, lendo os registros pelo caminho
+ *
+ * @deslocamento_proximo - posição do campo com o próximo registro
+ * @deslocamento_soma - posição de um campo inteiro a somar (-1 para nenhum)
+ */
+static LISTA_PERCORRIDA percorrer_lista(const char* diretorio, const char* nome, size_t tamanho_registro,
+                                        size_t deslocamento_proximo, long deslocamento_soma, int inicio, int topo) {
+        LISTA_PERCORRIDA resultado = {0, 0, 0};
+        char caminho[TAM_MAX_CAMINHO];
+        snprintf(caminho, sizeof(caminho), "%s/%s", diretorio, nome);
+        FILE* arquivo = fopen(caminho, "rb");
+        unsigned char registro[512];
+        if(arquivo == NULL || tamanho_registro > sizeof(registro)) {
+                if(arquivo != NULL)
+                        fclose(arquivo);
+                resultado.quantidade = -1;
+                return resultado;
+        }
+
+        for(int posicao = inicio; posicao != -1; resultado.quantidade++) {
+                if(posicao < 0 || posicao >= topo || resultado.quantidade > topo ||
+                   fseek(arquivo, (long)sizeof(CABECALHO) + (long)posicao * (long)tamanho_registro, SEEK_SET) != 0 ||
+                   fread(registro, tamanho_registro, 1, arquivo) != 1) {
+                        resultado.quantidade = -1;
+                        break;
+                }
+                int valor;
+                if(deslocamento_soma >= 0) {
+                        memcpy(&valor, registro + deslocamento_soma, sizeof(int));
+                        resultado.soma += valor;
+                }
+                if(tamanho_registro == sizeof(EMPRESTIMO) && ((EMPRESTIMO*)registro)->data_devolucao == DATA_NULA)
+                        resultado.abertos++;
+                memcpy(&posicao, registro + deslocamento_proximo, sizeof(int));
+        }
+
+        fclose(arquivo);
+        return resultado;
+}
+
+/*
+ * conferir_listas - confere, com a base fechada, as listas encadeadas contra os cabeçalhos gravados
+ */
+static int conferir_listas(const char* diretorio) {
+        int falhas = 0;
+        CABECALHO livros, usuarios, emprestimos;
+        if(
+                !ler_cabecalho(diretorio, "livro.dat", &livros) ||
+                !ler_cabecalho(diretorio, "usuario.dat", &usuarios) ||
+                !ler_cabecalho(diretorio, "emprestimo.dat", &emprestimos)
+        ) {
+                return conferir(0, "leitura dos cabeçalhos");
+        }
+
+        LISTA_PERCORRIDA lista = percorrer_lista(diretorio, "livro.dat", sizeof(REGISTRO_LIVRO), offsetof(REGISTRO_LIVRO, prox),
+                                                 (long)offsetof(REGISTRO_LIVRO, exemplares), livros.pos_cabeca, livros.pos_topo);
+        falhas += conferir(lista.quantidade == livros.num_ativos, "lista de livros com num_ativos registros");
+        falhas += conferir(lista.soma == livros.exemplares_disponiveis, "exemplares disponíveis iguais à soma da lista");
+        lista = percorrer_lista(diretorio, "livro.dat", sizeof(REGISTRO_LIVRO), offsetof(REGISTRO_LIVRO, prox), -1, livros.pos_livre, livros.pos_topo);
+        falhas += conferir(lista.quantidade == livros.num_livres, "lista de livres de livros com num_livres registros");
+
+        lista = percorrer_lista(diretorio, "usuario.dat", sizeof(USUARIO), offsetof(USUARIO, proximo), -1, usuarios.pos_cabeca, usuarios.pos_topo);
+        falhas += conferir(lista.quantidade == usuarios.num_ativos, "lista de usuários com num_ativos registros");
+
+        LISTA_PERCORRIDA abertos = percorrer_lista(diretorio, "emprestimo.dat", sizeof(EMPRESTIMO), offsetof(EMPRESTIMO, proximo), -1,
+                                                   emprestimos.pos_cabeca, emprestimos.pos_topo);
+        LISTA_PERCORRIDA devolvidos = percorrer_lista(diretorio, "emprestimo.dat", sizeof(EMPRESTIMO), offsetof(EMPRESTIMO, proximo), -1,
+                                                      emprestimos.pos_devolvidos, emprestimos.pos_topo);
+        falhas += conferir(abertos.quantidade >= 0 && abertos.abertos == abertos.quantidade &&
+                           abertos.quantidade == emprestimos.emprestimos_abertos, "lista de empréstimos abertos");
+        falhas += conferir(devolvidos.quantidade >= 0 && devolvidos.abertos == 0 &&
+                           abertos.quantidade + devolvidos.quantidade == emprestimos.num_ativos, "lista de empréstimos devolvidos");
+
+        return falhas;
+}
+
+/*
+ * contar_titulos - quantidade de livros que a busca por início do título (índice B+) encontra
+ */
+static int contar_titulos(BIBLIOTECA* biblioteca, const char* prefixo) {
+        FILE* saida = tmpfile();
+        if(saida == NULL)
+                return -1;
+        FILE* anterior = biblioteca->saida;
+        biblioteca->saida = saida;
+        int retorno = biblioteca_buscar_prefixo_titulo_livro(biblioteca, prefixo);
+        biblioteca->saida = anterior;
+
+        int quantidade = 0;
+        char linha[512];
+        rewind(saida);
+        while(fgets(linha, sizeof(linha), saida) != NULL)
+                if(strncmp(linha, "Codigo:", 7) == 0)
+                        quantidade++;
+        fclose(saida);
+        return retorno == SUCESSO || retorno == ERRO_ENCONTRAR_LIVRO ? quantidade : -1;
+}
+
+/*
+ * conferir_recuperada - reabre a base depois da queda e confere o que foi recuperado
+ *
+ * @ultimo_cortado - 1 se o último registro do diário foi cortado (LIVRO_ULTIMO não pode aparecer)
+ */
+static int conferir_recuperada(char* diretorio, int ultimo_cortado, const char* nome) {
+        int falhas = 0;
+        char descricao[160];
+        LIVRO livro;
+
+        long antes = tamanho_diario(diretorio);
+        BIBLIOTECA* biblioteca = biblioteca_abrir_exclusiva(diretorio);
+        if(biblioteca == NULL) {
+                fprintf(stderr, "FALHA: %s: base não pôde ser reaberta\n", nome);
+                return 1;
+        }
+
+        int livros_esperados = LIVROS_TRANSACAO + LIVROS_GRUPO + (ultimo_cortado ? 0 : 1);
+        snprintf(descricao, sizeof(descricao), "%s: total de livros recuperados", nome);
+        falhas += conferir(biblioteca->livros.cabecalho.num_ativos == livros_esperados, descricao);
+        snprintf(descricao, sizeof(descricao), "%s: usuários, empréstimos abertos e devolvidos recuperados", nome);
+        falhas += conferir(
+                biblioteca->usuarios.cabecalho.num_ativos == USUARIOS &&
+                biblioteca->emprestimos.cabecalho.num_ativos == USUARIOS &&
+                biblioteca->emprestimos.cabecalho.emprestimos_abertos == USUARIOS - DEVOLUCOES,
+                descricao
+        );
+
+        // o índice hash (reconstruído na recuperação) encontra exatamente os livros confirmados
+        int encontrados = 0;
+        for(int codigo = 1; codigo <= LIVROS_TRANSACAO; codigo++)
+                encontrados += biblioteca_consultar_livro(biblioteca, codigo, &livro) == SUCESSO;
+        for(int codigo = PRIMEIRO_LIVRO_GRUPO; codigo < PRIMEIRO_LIVRO_GRUPO + LIVROS_GRUPO; codigo++)
+                encontrados += biblioteca_consultar_livro(biblioteca, codigo, &livro) == SUCESSO && livro.codigo == codigo;
+        snprintf(descricao, sizeof(descricao), "%s: livros confirmados encontrados pelo índice", nome);
+        falhas += conferir(encontrados == LIVROS_TRANSACAO + LIVROS_GRUPO, descricao);
+        snprintf(descricao, sizeof(descricao), "%s: último livro do diário %s", nome, ultimo_cortado ? "ausente" : "presente");
+        falhas += conferir((biblioteca_consultar_livro(biblioteca, LIVRO_ULTIMO, &livro) == SUCESSO) == !ultimo_cortado, descricao);
+        snprintf(descricao, sizeof(descricao), "%s: livro da transação em andamento ausente", nome);
+        falhas += conferir(biblioteca_consultar_livro(biblioteca, LIVRO_EM_ANDAMENTO, &livro) == ERRO_ENCONTRAR_LIVRO, descricao);
+
+        // exemplares: emprestados descontados, devolvidos de volta
+        snprintf(descricao, sizeof(descricao), "%s: exemplares depois dos empréstimos e devoluções", nome);
+        int exemplares_emprestado = biblioteca_consultar_livro(biblioteca, PRIMEIRO_LIVRO_GRUPO + DEVOLUCOES, &livro) == SUCESSO ? livro.exemplares : -1;
+        int exemplares_devolvido = biblioteca_consultar_livro(biblioteca, PRIMEIRO_LIVRO_GRUPO, &livro) == SUCESSO ? livro.exemplares : -1;
+        falhas += conferir(exemplares_emprestado == 0 && exemplares_devolvido == 1, descricao);
+
+        snprintf(descricao, sizeof(descricao), "%s: índice de títulos reconstruído com os livros recuperados", nome);
+        falhas += conferir(contar_titulos(biblioteca, "Livro ") == livros_esperados, descricao);
+
+        biblioteca_fechar(biblioteca);
+
+        snprintf(descricao, sizeof(descricao), "%s: diário esvaziado depois da recuperação", nome);
+        long depois = tamanho_diario(diretorio);
+        falhas += conferir(depois >= 0 && depois < antes, descricao);
+        int falhas_listas = conferir_listas(diretorio);
+        if(falhas_listas > 0)
+                fprintf(stderr, "(listas de %s)\n", nome);
+
+        return falhas + falhas_listas;
+}
+
+/*
+ * preparar_queda - cria uma base em um diretório temporário e executa o processo que cai nela
+ */
+static int preparar_queda(const char* programa, char* diretorio, int compartilhada, const char* nome) {
+        if(mkdtemp(diretorio) == NULL) {
+                perror("mkdtemp");
+                return 1;
+        }
+        int sinal = executar_outro_processo(programa, diretorio, compartilhada);
+        char descricao[160];
+        snprintf(descricao, sizeof(descricao), "%s: processo encerrado por SIGKILL", nome);
+        return conferir(sinal == SIGKILL, descricao);
+}
+
+/*
+ * conferir_transacoes - transações desfeitas e confirmadas em uma base aberta, sem queda
+ */
+static int conferir_transacoes(char* diretorio) {
+        int falhas = 0;
+        LIVRO livro;
+        BIBLIOTECA* biblioteca = biblioteca_abrir_exclusiva(diretorio);
+        if(biblioteca == NULL)
+                return conferir(0, "transações: base não pôde ser aberta");
+
+        int ativos = biblioteca->livros.cabecalho.num_ativos;
+        falhas += conferir(biblioteca_confirmar_transacao(biblioteca) == ERRO_TRANSACAO, "confirmação sem transação");
+
+        falhas += conferir(biblioteca_iniciar_transacao(biblioteca) == SUCESSO, "início da transação a desfazer");
+        falhas += conferir(cadastrar(biblioteca, 201) == SUCESSO && cadastrar(biblioteca, 202) == SUCESSO, "cadastros na transação a desfazer");
+        falhas += conferir(biblioteca_consultar_livro(biblioteca, 201, &livro) == SUCESSO, "livro visível dentro da transação");
+        falhas += conferir(biblioteca_desfazer_transacao(biblioteca) == SUCESSO, "transação desfeita");
+        falhas += conferir(biblioteca->livros.cabecalho.num_ativos == ativos, "total de livros depois de desfazer");
+        falhas += conferir(biblioteca_consultar_livro(biblioteca, 201, &livro) == ERRO_ENCONTRAR_LIVRO &&
+                           biblioteca_consultar_livro(biblioteca, 202, &livro) == ERRO_ENCONTRAR_LIVRO, "livros desfeitos ausentes");
+
+        falhas += conferir(biblioteca_iniciar_transacao(biblioteca) == SUCESSO, "início da transação a confirmar");
+        falhas += conferir(cadastrar(biblioteca, 203) == SUCESSO && cadastrar(biblioteca, 204) == SUCESSO, "cadastros na transação a confirmar");
+        falhas += conferir(biblioteca_confirmar_transacao(biblioteca) == SUCESSO, "transação confirmada");
+        falhas += conferir(biblioteca->livros.cabecalho.num_ativos == ativos + 2, "total de livros depois de confirmar");
+        biblioteca_fechar(biblioteca);
+
+        // o espaço dos livros desfeitos não pode ter ficado preso: as listas continuam fechando com os cabeçalhos
+        falhas += conferir_listas(diretorio);
+
+        biblioteca = biblioteca_abrir_exclusiva(diretorio);
+        if(biblioteca == NULL)
+                return falhas + conferir(0, "transações: base não pôde ser reaberta");
+        falhas += conferir(biblioteca_consultar_livro(biblioteca, 203, &livro) == SUCESSO &&
+                           biblioteca_consultar_livro(biblioteca, 204, &livro) == SUCESSO, "livros confirmados depois de reabrir");
+        falhas += conferir(biblioteca_consultar_livro(biblioteca, 201, &livro) == ERRO_ENCONTRAR_LIVRO, "livro desfeito ausente depois de reabrir");
+        biblioteca_fechar(biblioteca);
+
+        return falhas;
+}
+
+int main(int argc, char* argv[]) {
+        // segundo processo: grava na base e cai antes de aplicar o grupo
+        if(argc == 3)
+                return executar_ate_cair(argv[1], strcmp(argv[2], "compartilhada") == 0);
+
+        int falhas = 0;
+        char exclusiva[] = "/tmp/teste_diario_XXXXXX";
+        char cortada[] = "/tmp/teste_diario_XXXXXX";
+        char compartilhada[] = "/tmp/teste_diario_XXXXXX";
+
+        falhas += preparar_queda(argv[0], exclusiva, 0, "exclusiva");
+        falhas += preparar_queda(argv[0], cortada, 0, "cortada");
+        falhas += preparar_queda(argv[0], compartilhada, 1, "compartilhada");
+        if(falhas > 0)
+                return 1;
+
+        // confirmação em grupo: o grupo recebeu fsync, mas nenhum dos seus bytes chegou aos arquivos
+        CABECALHO livros;
+        falhas += conferir(ler_cabecalho(exclusiva, "livro.dat", &livros) && livros.num_ativos <= LIVROS_TRANSACAO,
+                           "livro.dat sem os livros do grupo antes da recuperação");
+        falhas += conferir(tamanho_diario(exclusiva) > 0, "diário com registros antes da recuperação");
+
+        // um byte a menos: a soma de verificação do último registro não confere
+        char caminho[TAM_MAX_CAMINHO];
+        snprintf(caminho, sizeof(caminho), "%s/%s", cortada, NOME_ARQUIVO_DIARIO);
+        falhas += conferir(truncate(caminho, tamanho_diario(cortada) - 1) == 0, "corte do último registro do diário");
+
+        falhas += conferir_recuperada(exclusiva, 0, "exclusiva");
+        falhas += conferir_recuperada(cortada, 1, "cortada");
+        falhas += conferir_recuperada(compartilhada, 0, "compartilhada");
+        falhas += conferir_transacoes(exclusiva);
+
+        if(falhas == 0)
+                printf("teste_diario: ok\n");
+        return falhas == 0 ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+/*
+ * Teste de reabertura da base com alterações de outro processo (POSIX)
+ *
+ * O processo principal cadastra livros e fecha a base; um segundo processo (o próprio programa,
+ * executado de novo com o diretório e o código a cadastrar) abre a base, cadastra outro livro e
+ * fecha. Ao reabrir a base, o processo principal deve enxergar o livro novo no cabeçalho e no
+ * índice, e um cadastro seguinte não pode ocupar a posição dele. Ao fechar a base por último, o
+ * arquivo de livros deve ficar só com o tamanho ocupado (com ARMAZENAMENTO_MMAP, sem as extensões).
+ *
+ * Compilação, a partir da raiz do repositório:
+ *	gcc -pthread -Iinclude testes/teste_reabertura.c $(ls src/[a-z]*.c | grep -v main.c) -o teste_reabertura
+ *
+ * Pós-condições:
+ *	- Retorna 0 se a base reaberta estiver correta; 1 caso contrário, com a falha na saída de erro.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "../include/biblioteca.h"
+#include "../include/erros.h"
+#include "../include/livro.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define CODIGO_OUTRO_PROCESSO   777
+#define CODIGO_APOS_REABRIR     555
+#define LIVROS_INICIAIS         3
+
+/*
+ * cadastrar - cadastra um livro de teste com o código informado
+ */
+static int cadastrar(BIBLIOTECA* biblioteca, int codigo) {
+        LIVRO livro;
+        memset(&livro, 0, sizeof(LIVRO));
+        livro.codigo = codigo;
+        snprintf(livro.titulo, sizeof(livro.titulo), "Livro %d", codigo);
+        strcpy(livro.autor, "Autor");
+        strcpy(livro.editora, "Editora");
+        livro.edicao = 1;
+        livro.ano = 2000;
+        livro.exemplares = 1;
+        return biblioteca_cadastrar_livro(biblioteca, livro);
+}
+
+/*
+ * executar_outro_processo - executa o programa em outro processo para cadastrar um livro e espera o fim
+ */
+static int executar_outro_processo(const char* programa, char* diretorio, int codigo) {
+        char texto_codigo[16];
+        snprintf(texto_codigo, sizeof(texto_codigo), "%d", codigo);
+
+        pid_t filho = fork();
+        if(filho < 0)
+                return -1;
+        if(filho == 0) {
+                execl(programa, programa, diretorio, texto_codigo, (char*)NULL);
+                _exit(127);
+        }
+
+        int situacao;
+        if(waitpid(filho, &situacao, 0) != filho || !WIFEXITED(situacao))
+                return -1;
+        return WEXITSTATUS(situacao);
+}
+
+/*
+ * conferir - exibe a falha e a conta quando a condição não vale
+ */
+static int conferir(int condicao, const char* descricao) {
+        if(!condicao)
+                fprintf(stderr, "FALHA: %s\n", descricao);
+        return condicao ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+        // segundo processo: cadastra um livro com a base aberta só durante o cadastro
+        if(argc == 3) {
+                BIBLIOTECA* biblioteca = biblioteca_abrir(argv[1]);
+                if(biblioteca == NULL)
+                        return 1;
+                int retorno = cadastrar(biblioteca, atoi(argv[2]));
+                biblioteca_fechar(biblioteca);
+                return retorno == SUCESSO ? 0 : 1;
+        }
+
+        char diretorio[] = "/tmp/teste_reabertura_XXXXXX";
+        if(mkdtemp(diretorio) == NULL) {
+                perror("mkdtemp");
+                return 1;
+        }
+
+        BIBLIOTECA* biblioteca = biblioteca_abrir(diretorio);
+        if(biblioteca == NULL) {
+                fprintf(stderr, "FALHA: base não pôde ser aberta\n");
+                return 1;
+        }
+        int falhas = 0;
+        for(int codigo = 1; codigo <= LIVROS_INICIAIS; codigo++)
+                falhas += conferir(cadastrar(biblioteca, codigo) == SUCESSO, "cadastro inicial");
+        biblioteca_fechar(biblioteca);
+
+        // base fechada aqui: a alteração do outro processo não passa pelas gerações do diário
+        falhas += conferir(executar_outro_processo(argv[0], diretorio, CODIGO_OUTRO_PROCESSO) == 0, "cadastro no outro processo");
+
+        biblioteca = biblioteca_abrir(diretorio);
+        if(biblioteca == NULL) {
+                fprintf(stderr, "FALHA: base não pôde ser reaberta\n");
+                return 1;
+        }
+
+        LIVRO livro;
+        falhas += conferir(biblioteca->livros.cabecalho.num_ativos == LIVROS_INICIAIS + 1, "total de livros depois de reabrir");
+        falhas += conferir(biblioteca_consultar_livro(biblioteca, CODIGO_OUTRO_PROCESSO, &livro) == SUCESSO, "livro do outro processo depois de reabrir");
+        falhas += conferir(cadastrar(biblioteca, CODIGO_APOS_REABRIR) == SUCESSO, "cadastro depois de reabrir");
+        falhas += conferir(biblioteca_consultar_livro(biblioteca, CODIGO_OUTRO_PROCESSO, &livro) == SUCESSO && livro.codigo == CODIGO_OUTRO_PROCESSO, "livro do outro processo depois do cadastro");
+        falhas += conferir(biblioteca_consultar_livro(biblioteca, CODIGO_APOS_REABRIR, &livro) == SUCESSO && livro.codigo == CODIGO_APOS_REABRIR, "livro cadastrado depois de reabrir");
+        falhas += conferir(biblioteca->livros.cabecalho.num_ativos == LIVROS_INICIAIS + 2, "total de livros depois do cadastro");
+        long ocupado = (long)sizeof(CABECALHO) + (long)biblioteca->livros.cabecalho.pos_topo * (long)sizeof(REGISTRO_LIVRO);
+        biblioteca_fechar(biblioteca);
+
+        char caminho[sizeof(diretorio) + 16];
+        struct stat informacoes;
+        snprintf(caminho, sizeof(caminho), "%s/livro.dat", diretorio);
+        falhas += conferir(stat(caminho, &informacoes) == 0 && (long)informacoes.st_size == ocupado, "tamanho de livro.dat depois de fechar");
+
+        if(falhas == 0)
+                printf("teste_reabertura: ok\n");
+        return falhas == 0 ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/*
+ * Teste dos núcleos de varredura (AVX2, SSE2 e escalar)
+ *
+ * Cada nível suportado pelo processador procura padrões e compara blocos nos mesmos textos
+ * aleatórios, e o resultado tem de ser igual ao de uma busca ingênua byte a byte. Os textos usam
+ * poucas letras, em maiúsculas e minúsculas e com bytes acima de 0x7F, para que o primeiro e o
+ * último byte do padrão coincidam com frequência; os tamanhos são ímpares e não múltiplos de 16
+ * ou 32, e os padrões são tirados de posições que atravessam o fim dos blocos.
+ *
+ * Compilação, a partir da raiz do repositório:
+ *	gcc -pthread -Iinclude testes/teste_varredura.c $(ls src/[a-z]*.c | grep -v main.c) -o teste_varredura
+ *
+ * Pós-condições:
+ *	- Retorna 0 se todos os níveis coincidirem com a busca ingênua; 1 caso contrário, com a falha na saída de erro.
+ */
+
+#include "../include/varredura.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TAMANHO_MAXIMO_TEXTO    300
+#define TEXTOS_POR_TAMANHO      8
+
+/*
+ * minuscula - converte uma letra ASCII maiúscula em minúscula, como o núcleo de varredura
+ */
+static unsigned char minuscula(unsigned char c) {
+        return (c >= 'A' && c <= 'Z') ? (unsigned char)(c | 0x20) : c;
+}
+
+/*
+ * iguais_ingenuo - comparação de referência, byte a byte
+ */
+static int iguais_ingenuo(const char* a, const char* b, size_t tamanho, int ignorar_caixa) {
+        for(size_t i = 0; i < tamanho; i++) {
+                unsigned char x = (unsigned char)a[i], y = (unsigned char)b[i];
+                if(ignorar_caixa ? minuscula(x) != minuscula(y) : x != y)
+                        return 0;
+        }
+        return 1;
+}
+
+/*
+ * procurar_ingenuo - busca de referência, testando cada deslocamento
+ */
+static size_t procurar_ingenuo(const char* texto, size_t tamanho, const char* padrao, size_t tamanho_padrao, int ignorar_caixa) {
+        if(tamanho_padrao == 0)
+                return 0;
+        for(size_t i = 0; i + tamanho_padrao <= tamanho; i++)
+                if(iguais_ingenuo(texto + i, padrao, tamanho_padrao, ignorar_caixa))
+                        return i;
+        return tamanho;
+}
+
+/*
+ * preencher - sorteia bytes de um alfabeto pequeno, com caixa trocada e bytes não ASCII
+ */
+static void preencher(char* destino, size_t tamanho) {
+        static const char alfabeto[] = "abAB\xe1\xc1";
+        for(size_t i = 0; i < tamanho; i++)
+                destino[i] = alfabeto[rand() % (int)(sizeof(alfabeto) - 1)];
+}
+
+/*
+ * conferir_nivel - compara o nível informado com a referência em textos de todos os tamanhos
+ *
+ * Pós-condições:
+ *	- Retorna a quantidade de divergências (a primeira de cada tipo é exibida).
+ */
+static int conferir_nivel(int nivel) {
+        // o bloco inteiro fica no heap para que leituras além do fim apareçam em ferramentas como o ASan
+        char* texto = malloc(TAMANHO_MAXIMO_TEXTO);
+        char* copia = malloc(TAMANHO_MAXIMO_TEXTO);
+        char padrao[40];
+        int falhas = 0;
+        if(texto == NULL || copia == NULL) {
+                free(texto);
+                free(copia);
+                return 1;
+        }
+
+        srand(1234);
+        for(size_t tamanho = 1; tamanho < TAMANHO_MAXIMO_TEXTO; tamanho += 2) {
+                for(int repeticao = 0; repeticao < TEXTOS_POR_TAMANHO; repeticao++) {
+                        preencher(texto, tamanho);
+
+                        for(int ignorar_caixa = 0; ignorar_caixa <= 1; ignorar_caixa++) {
+                                // padrões copiados do texto, começando em volta dos limites de 16 e 32 bytes
+                                size_t inicios[] = {0, 13, 15, 16, 29, 31, 32, 47, 63, tamanho / 2, tamanho - 1};
+                                for(size_t k = 0; k < sizeof(inicios) / sizeof(inicios[0]); k++) {
+                                        for(size_t tamanho_padrao = 1; tamanho_padrao <= sizeof(padrao) && inicios[k] + tamanho_padrao <= tamanho; tamanho_padrao += 3) {
+                                                memcpy(padrao, texto + inicios[k], tamanho_padrao);
+                                                if(ignorar_caixa)
+                                                        for(size_t j = 0; j < tamanho_padrao; j += 2)
+                                                                padrao[j] = (char)(minuscula((unsigned char)padrao[j]) == (unsigned char)padrao[j] ? padrao[j] & ~0x20 : padrao[j] | 0x20);
+
+                                                size_t esperado = procurar_ingenuo(texto, tamanho, padrao, tamanho_padrao, ignorar_caixa);
+                                                size_t obtido = varredura_procurar(texto, tamanho, padrao, tamanho_padrao, ignorar_caixa);
+                                                if(obtido != esperado) {
+                                                        if(falhas++ == 0)
+                                                                fprintf(stderr, "FALHA: %s procurar (texto %zu, padrão %zu, caixa %d): %zu em vez de %zu\n",
+                                                                        varredura_nome_nivel(nivel), tamanho, tamanho_padrao, ignorar_caixa, obtido, esperado);
+                                                }
+                                        }
+                                }
+
+                                // padrões sorteados, que em geral não ocorrem ou ocorrem em posições imprevisíveis
+                                size_t tamanho_padrao = 1 + (size_t)rand() % sizeof(padrao);
+                                preencher(padrao, tamanho_padrao);
+                                if(varredura_procurar(texto, tamanho, padrao, tamanho_padrao, ignorar_caixa) != procurar_ingenuo(texto, tamanho, padrao, tamanho_padrao, ignorar_caixa)) {
+                                        if(falhas++ == 0)
+                                                fprintf(stderr, "FALHA: %s procurar padrão sorteado (texto %zu, padrão %zu)\n",
+                                                        varredura_nome_nivel(nivel), tamanho, tamanho_padrao);
+                                }
+
+                                // blocos iguais e com uma única diferença em cada posição
+                                memcpy(copia, texto, tamanho);
+                                if(varredura_iguais(texto, copia, tamanho, ignorar_caixa) != 1) {
+                                        if(falhas++ == 0)
+                                                fprintf(stderr, "FALHA: %s iguais em blocos idênticos (%zu)\n", varredura_nome_nivel(nivel), tamanho);
+                                }
+                                for(size_t posicao = 0; posicao < tamanho; posicao++) {
+                                        copia[posicao] = (char)(copia[posicao] ^ (rand() % 2 ? 0x20 : 0x01));
+                                        int esperado = iguais_ingenuo(texto, copia, tamanho, ignorar_caixa);
+                                        if(varredura_iguais(texto, copia, tamanho, ignorar_caixa) != esperado) {
+                                                if(falhas++ == 0)
+                                                        fprintf(stderr, "FALHA: %s iguais (bloco %zu, diferença em %zu, caixa %d)\n",
+                                                                varredura_nome_nivel(nivel), tamanho, posicao, ignorar_caixa);
+                                        }
+                                        copia[posicao] = texto[posicao];
+                                }
+                        }
+                }
+        }
+
+        free(texto);
+        free(copia);
+        return falhas;
+}
+
+int main(void) {
+        int falhas = 0;
+        int maximo = varredura_nivel_maximo();
+
+        for(int nivel = NIVEL_VARREDURA_ESCALAR; nivel <= maximo; nivel++) {
+                if(varredura_definir_nivel(nivel) != nivel) {
+                        fprintf(stderr, "FALHA: nível %s não pôde ser escolhido\n", varredura_nome_nivel(nivel));
+                        falhas++;
+                        continue;
+                }
+                int falhas_nivel = conferir_nivel(nivel);
+                if(falhas_nivel > 0)
+                        fprintf(stderr, "%s: %d divergências\n", varredura_nome_nivel(nivel), falhas_nivel);
+                falhas += falhas_nivel;
+        }
+
+        if(falhas == 0)
+                printf("teste_varredura: ok (níveis até %s)\n", varredura_nome_nivel(maximo));
+        return falhas == 0 ? 0 : 1;
+}